@@ -4,8 +4,10 @@ use warnings;
 
 use Anorman::Fasta;
 use Anorman::Kmer;
+use Anorman::Kmer::Counter;
 use Anorman::Counts;
 use Anorman::Seq;
+use Anorman::DNA qw(gc_content);
 use Anorman::Math::Common;
 
 use Getopt::Long;
@@ -21,7 +23,13 @@ my (
     $SUBDIVIDE,
     $CHUNK_SIZE,
     $WINDOW_SIZE,
-    $OUTPUT
+    $OUTPUT,
+    $GC,
+    $COUNTS,
+    $PARTS,
+    $MEMORY,
+    $SPILL,
+    $MIN_COUNT
     );
 
 $MIN_LENGTH      = 500;
@@ -30,6 +38,12 @@ $KSIZE           = 4;
 
 $METHOD = 'raw';
 
+my @STDIN_SEQS;
+
+$PARTS     = 64;
+$MEMORY    = 0;
+$MIN_COUNT = 1;
+
 &GetOptions (   "help"        => \$HELP,
 	        "input=s"     => \$FILE,
 		"kmersize=i"  => \$KSIZE,
@@ -39,7 +53,13 @@ $METHOD = 'raw';
 		"maxlen=i"    => \$MAX_LENGTH,
 		"subdivide=i" => \$CHUNK_SIZE,
 		"winsize=i"   => \$WINDOW_SIZE,
-		"output=s"    => \$OUTPUT
+		"output=s"    => \$OUTPUT,
+		"gc"          => \$GC,
+		"counts=s"    => \$COUNTS,
+		"parts=i"     => \$PARTS,
+		"memory=i"    => \$MEMORY,      # MB of k-mers held before spilling
+		"spill=s"     => \$SPILL,
+		"mincount=i"  => \$MIN_COUNT
 	      );
 
 if ($CHUNK_SIZE) {
@@ -59,6 +79,13 @@ if ($CHUNK_SIZE) {
 	}
 }
 
+# Large k, or an explicit count file, go to the native counter. The
+# dense table below has 4^k columns and is limited to k <= 7
+if (defined $COUNTS || $KSIZE > 7) {
+	&count_native;
+	exit;
+}
+
 # Initiate objects
 my $fasta_o  = Anorman::Fasta->new;
 my $table_o  = Anorman::Counts->new;
@@ -147,11 +174,89 @@ sub add_kmer_counts_to_table {
 
 	# transfer sequence info to row info
 	@row_info{ @keys } = @{ $seq_r }{ @keys };
+	$row_info{'gc'}    = gc_content( $seq_r->{'seq'} ) if $GC;
 
 	# create new row in table
 	$table_o->add_row( \%row_info, @row_data );
 }
 
+#== native counting ==
+# The whole input is counted first, then every sequence (or fragment) is
+# printed as a sparse row of k-mer rank:count pairs against the sorted
+# spectrum, which is saved to --counts when given
+sub count_native {
+	my $counter = Anorman::Kmer::Counter->new( $KSIZE, parts => $PARTS, memory => $MEMORY * (1 << 20), spill => $SPILL );
+
+	warn "Counting Kmers ($KSIZE nt, native)\n" if $VERBOSE;
+
+	&each_fragment( sub { $counter->add( $_[0]->{'seq'} ) } );
+
+	my $n = $counter->count;
+	warn "\n$n distinct k-mers in " . $counter->total . "\n" if $VERBOSE;
+
+	$counter->save( $COUNTS ) if defined $COUNTS;
+
+	my $fh = \*STDOUT;
+	if (defined $OUTPUT) {
+		open ($fh, '>', $OUTPUT) or die "Could not write $OUTPUT: $!\n";
+	}
+
+	print {$fh} "# k\t$KSIZE\n";
+	print {$fh} "# columns\t$n\n";
+	print {$fh} "# name\tlength" . ($GC ? "\tgc" : "") . "\tkmers\n";
+
+	&each_fragment( sub {
+		my $seq_r = shift;
+		my ($columns, $values) = $counter->row( $seq_r->{'seq'}, $MIN_COUNT );
+
+		my @fields = ( $seq_r->{'name'}, $seq_r->{'length'} );
+		push @fields, gc_content( $seq_r->{'seq'} ) if $GC;
+		push @fields, join (" ", map { "$columns->[$_]:$values->[$_]" } 0 .. $#{ $columns });
+
+		print {$fh} join ("\t", @fields), "\n";
+	});
+
+	close $fh if defined $OUTPUT;
+}
+
+# calls $code on every sequence or fragment of the input. Standard input
+# is read once and kept for the second pass
+sub each_fragment {
+	my $code  = shift;
+	my $seq_o = Anorman::Seq->new;
+	my $tid   = 0;
+
+	my $call = sub {
+		my ($name, $length, $seq) = @_;
+
+		return if $length < $MIN_LENGTH;
+		@{ $seq_o }{ qw/tid name length seq/ } = ( $tid++, $name, $length, $seq );
+
+		if ($SUBDIVIDE && $length >= ($CHUNK_SIZE + $MIN_LENGTH)) {
+			$code->( $_ ) foreach $seq_o->subdivide( $CHUNK_SIZE, $WINDOW_SIZE, $MIN_LENGTH );
+		} else {
+			$code->( $seq_o );
+		}
+	};
+
+	if (!defined $FILE && @STDIN_SEQS) {
+		$call->( @{ $_ } ) foreach @STDIN_SEQS;
+		return;
+	}
+
+	my $fasta_o = Anorman::Fasta->new;
+	$fasta_o->open( $FILE ) if defined $FILE;
+
+	while ($fasta_o->iterator) {
+		my @entry = ( $fasta_o->header, $fasta_o->length, $fasta_o->seq );
+
+		push @STDIN_SEQS, \@entry unless defined $FILE;
+		$call->( @entry );
+	}
+
+	$fasta_o->close if defined $FILE;
+}
+
 =pod
 
 =head1 NAME
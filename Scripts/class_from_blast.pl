@@ -4,6 +4,7 @@ use strict;
 use warnings;
 
 use Anorman::ESOM::File;
+use Anorman::HitTable::TopHits;
 use Getopt::Long;
 use Pod::Usage;
 
@@ -27,23 +28,25 @@ $names->load;
 $subseq_index = $names->subseq_index;
 
 
-# Load blast table
-open (my $FH, '<', $blast_file) or die "ERROR opening $blast_file: $!";
+# Load blast table, keeping the best hit of every query
+my $hits = Anorman::HitTable::TopHits->new( 'blast', top => 1 );
+$hits->read( $blast_file );
+
+warn $hits->skipped, " malformed lines in $blast_file skipped\n" if $hits->skipped;
 
 my %BLAST_RESULT = ();
 my %CLASS_NAME   = ();
 
-while (defined (my $line = <$FH>)) {
-	next if $line =~ /^#/;
-	chomp $line;
-	my ($query,$hit) = split ("\t", $line);
+while (my $r = $hits->next_record) {
+	my ($query, $hit) = @{ $r }{ qw/q_id s_id/ };
+
 	$BLAST_RESULT{ $query } = $hit;
 	$CLASS_NAME{ $hit } ||= 0;
 	$CLASS_NAME{ $hit } += scalar @{ $subseq_index->{ $query } }
 		if exists $subseq_index->{ $query };
 }
 
-close $FH;
+undef $hits;
 
 
 # Make new classes according to blast hits
@@ -111,6 +114,11 @@ B<-c> I<file>
 
 =back
 
+=head1 DESCRIPTION
+
+Every sequence is classed by the subject of its best hit (highest bit
+score, the first one on ties) in a tabular BLAST table (-outfmt 6).
+
 =head1 OPTIONS
 
 
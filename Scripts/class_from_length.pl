@@ -10,29 +10,35 @@ use Getopt::Long;
 $Anorman::Common::VERBOSE = 1;
 
 my ($cls_file, $input, $min, $max);
+my $by = 'length';
 
 &GetOptions(
 	'input=s'	=> \$input,
 	'cls=s'		=> \$cls_file,
-	'min=i'		=> \$min,
-	'max=i'		=> \$max
+	'min=f'		=> \$min,
+	'max=f'		=> \$max,
+	'by=s'		=> \$by
 );
 
+# row info to classify by: sequence length, or GC content as added by
+# calc_kmer_freq.pl --gc
+die "Classes are made by length or gc\n" unless $by =~ m/^(?:length|gc)$/;
+
 my $t = Anorman::Counts->new;
 my $e = Anorman::ESOM->new;
 
 $t->open($input);
 
 my $rows = $t->[0][0]->{'rows'};
-my @lengths = map { $_->{'length'} } $t->row_info;
+my @lengths = map { $_->{ $by } } $t->row_info;
 my $stats = $t->calc_stats( \@lengths, 'full' );
 
 $max = defined $max ? $max : $stats->{'_max'};
 $min = defined $min ? $min : $stats->{'_min'};
 
-warn "Minimum length: $min\n";
-warn "Maximum length: $max\n";
-warn "Median length: $stats->{'_median'}\n";
+warn "Minimum $by: $min\n";
+warn "Maximum $by: $max\n";
+warn "Median $by: $stats->{'_median'}\n";
 
 # Load the Jet color gradient
 $e->load_color_table("jet");
@@ -40,12 +46,16 @@ $e->load_color_table("jet");
 my $partitions  = $e->color_table->size;
 my $interval     = ($max - $min) / $partitions;
 
-my @breakpoints = map { $min + int( $_ *  $interval ) } (1 .. $partitions);
+my @breakpoints = $by eq 'gc'
+                ? map { $min + $_ * $interval } (1 .. $partitions)
+                : map { $min + int( $_ *  $interval ) } (1 .. $partitions);
 
 my $classes = $e->class_table;
 
 foreach my $class_num(0..$partitions - 1) {
-	$classes->add( $class_num, $breakpoints[ $class_num ] . "_bp" , $e->color_table->data->[ $class_num ] );
+	my $name = $by eq 'gc' ? sprintf( "%.3f_GC", $breakpoints[ $class_num ] ) : $breakpoints[ $class_num ] . "_bp";
+
+	$classes->add( $class_num, $name, $e->color_table->data->[ $class_num ] );
 }
 
 my $cls = $e->data_classes;
@@ -7,6 +7,7 @@ use warnings;
 use Anorman::Common qw($VERBOSE);
 
 use Anorman::ESOM;
+use Anorman::Data::Algorithms::MahalanobisDistance;
 use Getopt::Long qw( :config no_auto_abbrev no_ignore_case );
 use Pod::Usage;
 
@@ -61,7 +62,18 @@ if ($lrnfile) {
 	$esom->load_data( $lrnfile );
 
 	# Project training data onto grid and save bm-file
-	unless ( $distances ) {
+	if ($distances && defined $distances{ $distances } && $distances{ $distances } eq 'mahalanobis') {
+		# data and weights are whitened once by the data covariance and projected as usual.
+		# The search yields squared euclidean distances in whitened space, their roots
+		# are the mahalanobis distances written with each bestmatch
+		$esom->metric( Anorman::Data::Algorithms::MahalanobisDistance->new( $esom->training_data->data ) );
+
+		my $bm   = $esom->bestmatches;
+		my $dist = $esom->distances;
+
+		$bm->get_quick( $_ )->distance( sqrt $dist->get( $_ ) ) for (0 .. $bm->size - 1);
+		$bm->save( $bmfile );
+	} elsif ( !$distances ) {
 		$esom->bestmatches->save( $bmfile );
 	} else {
 		$esom->bestmatch_distances->save( $bmfile );
@@ -126,6 +138,10 @@ Training file (*.lrn) with data patterns to be projected onto the ESOM map
 
 Bestmatches file (*.bm) with positions of the closest matched neuron.
 
+=item B<-d, --dist> I<metric>
+
+Distance metric used for projection (euc, man or mahal). With mahal the data and weights are whitened by the covariance of the training data, so the search itself stays euclidean, and the bm-file gets the Mahalanobis distance of each data point to its bestmatch as an extra column
+
 =item B<-m, --cmx> I<file>
 
 Class Mask file (*.cmx) with classifications of ESOM grid positions. This will classify bestmatches as they are projected
@@ -10,8 +10,6 @@ use Anorman::ESOM::ImageRenderer;
 use Getopt::Long;
 use Pod::Usage;
 
-use GD;
-
 my (	$bmfile,
 	$clsfile,
 	$force,
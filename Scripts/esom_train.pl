@@ -33,6 +33,17 @@ my $COOL_LEARN   = 'lin';
 my $INIT 	 = 'norm_mean_2std';
 my $OUTPUT       = 'out';
 my $RATIO;
+my $SEED;
+my $METRICS;
+my $METRICS_FORMAT = 'tsv';
+my $EARLY_STOP     = 0;
+my $STOP_TOLERANCE = 0.001;
+my $GROW_STEPS     = 2;
+my $GROW_METHOD    = 'mean';
+my $SNAPSHOT;
+my $SNAPSHOT_EVERY = 1;
+my $SNAPSHOT_ZOOM  = 1;
+my $SNAPSHOT_COLORS;
 my $optimize_ratio;
 
 my $LRN_FILE     = '';
@@ -60,6 +71,17 @@ my ($ROWS,$COLS);
 	'ratio|r'		=> \$optimize_ratio,
 	'K|k=f'			=> \$dk,
 	'output|o=s'		=> \$OUTPUT,
+	'seed=i'		=> \$SEED,
+	'metrics=s'		=> \$METRICS,
+	'metrics-format=s'	=> \$METRICS_FORMAT,
+	'early-stop=i'		=> \$EARLY_STOP,
+	'stop-tolerance=f'	=> \$STOP_TOLERANCE,
+	'grow-steps=i'		=> \$GROW_STEPS,
+	'grow-method=s'		=> \$GROW_METHOD,
+	'snapshot=s'		=> \$SNAPSHOT,
+	'snapshot-every=i'	=> \$SNAPSHOT_EVERY,
+	'snapshot-zoom=i'	=> \$SNAPSHOT_ZOOM,
+	'snapshot-colors=s'	=> \$SNAPSHOT_COLORS,
 	'verbose'		=> \$VERBOSE,
 	'help|h'		=> sub { pod2usage( verbose => 1 ) },
 	'manual'		=> sub { pod2usage( verbose => 2 ) }
@@ -96,10 +118,27 @@ if ($METHOD eq 'kbatch') {
 	$som = Anorman::ESOM::SOM::Online->new;
 } elsif ($METHOD eq 'slowbatch') {
 	$som = Anorman::ESOM::SOM::SlowBatch->new;
+} elsif ($METHOD eq 'gesom') {
+	$som = Anorman::ESOM::SOM::GESOM->new;
+	$som->grow_steps( $GROW_STEPS );
+	$som->grow_method( $GROW_METHOD );
+	print STDERR " (grid grown $GROW_STEPS times, $GROW_METHOD interpolation)";
 } else { die "unkown training method" }
 
 warn"\n";
 
+# one seed drives grid initialization and all permutations
+$som->seed( $SEED ) if defined $SEED;
+warn "Random seed: ", $som->seed, "\n";
+
+# per-epoch quality metrics and early stopping
+$som->metrics( $METRICS, $METRICS_FORMAT ) if defined $METRICS;
+$som->early_stop( $EARLY_STOP, $STOP_TOLERANCE ) if $EARLY_STOP;
+
+# animation of the U-matrix as it trains
+$som->snapshot( $SNAPSHOT, every => $SNAPSHOT_EVERY, zoom => $SNAPSHOT_ZOOM, colorscheme => $SNAPSHOT_COLORS )
+	if defined $SNAPSHOT;
+
 # Initialize neighborhood (default is gaussian)
 if ($NEIGHBORHOOD eq 'mexhat') {
 	$som->neighborhood( Anorman::ESOM::Neighborhood::MexicanHat->new );
@@ -196,7 +235,11 @@ $esom->train( $som );
 
 warn "Writing output files...\n";
 
-# write output files
+# write output files, recording the seed to reproduce them
+foreach my $file ($esom->umatrix, $esom->weights, $esom->bestmatches) {
+	$file->add_comment( "seed: " . $som->seed );
+}
+
 $esom->umatrix->save("$OUTPUT.epoch" . $som->epochs . ".umx");
 $esom->weights->save("$OUTPUT.epoch" . $som->epochs . ".wts");
 $esom->bestmatches->save("$OUTPUT.epoch" . $som->epochs . ".bm");
@@ -226,6 +269,11 @@ esom_train.pl - ESOM training tool
 [-lc I<STR>]
 [-bms I<STR>]
 [-bmc I<INT>]
+[--seed I<INT>]
+[--metrics I<file>]
+[--early-stop I<INT>]
+[--grow-steps I<INT>]
+[--snapshot I<file>]
 
 =back
 
@@ -246,7 +294,8 @@ wts-file (*.wts) with weights to begin training with
 The training algorithm. Possible choices are:
 C<online> (default),
 C<slowbatch>,
-C<kbatch>
+C<kbatch>,
+C<gesom> (online training on a grid that starts small and grows, see --grow-steps)
 
 =item B<-g, --grid>
 
@@ -305,6 +354,50 @@ C<faster>
 
 The output prefix. Will be used to generate names for the output wts-, umx- and bm-files. Default: C<out>
 
+=item B<--metrics> I<file>
+
+Write training metrics for every epoch to I<file> (C<-> for STDERR): mean and max quantization error, topographic error, fraction of patterns whose bestmatch moved, distance evaluations and early exits, and wall time per phase. The last line (epoch C<final>) describes the finished map
+
+=item B<--metrics-format> I<STR>
+
+Format of the metrics lines: C<tsv> (default, with a header line) or C<json>
+
+=item B<--early-stop> I<INT>
+
+Stop training when the mean quantization error has not improved for this many epochs (default: 0, never)
+
+=item B<--stop-tolerance> I<FLOAT>
+
+Relative improvement of the quantization error that counts as progress for --early-stop (default: 0.001)
+
+=item B<--grow-steps> I<INT>
+
+With C<-a gesom>, the number of times the grid grows. Training starts on a grid about 2^steps times smaller along each side and the epochs are divided evenly between the sizes (default: 2)
+
+=item B<--grow-method> I<STR>
+
+With C<-a gesom>, how new neurons are interpolated when the grid grows: C<mean> (default) of the old neurons on either side, or C<bilinear>
+
+=item B<--snapshot> I<file>
+
+Write the U-matrix of the map after every epoch as a frame of an animated PNG. A file name with a printf conversion, e.g. C<train.%03d.png>, writes one PNG per epoch instead. Frames are rendered from the weights in memory and written in the background
+
+=item B<--snapshot-every> I<INT>
+
+Take a snapshot every this many epochs (default: 1)
+
+=item B<--snapshot-zoom> I<INT>
+
+Pixels per neuron in the snapshots (default: 1)
+
+=item B<--snapshot-colors> I<STR>
+
+Color table of the snapshots, as for esom_render.pl (default: grayscale)
+
+=item B<--seed> I<INT>
+
+Random seed for grid initialization and data permutation. A run with the same seed, data and options gives the same map. Without this option a seed is chosen from the clock; it is printed at startup and written as a comment to the output files
+
 =back
 
 =head1 AUTHOR
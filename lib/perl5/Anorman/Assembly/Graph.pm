@@ -3,33 +3,52 @@ package Anorman::Assembly::Graph;
 use strict;
 
 use Anorman::Common qw(trace_error);
-use Anorman::Common::Iterator;
 
+use Anorman::Assembly::Graph::Store;
 use Anorman::Assembly::Graph::Nodes;
 use Anorman::Assembly::Graph::Edges;
 use Anorman::Assembly::Graph::Components;
-use Anorman::Math::UnionFind;
 
 our $DEBUG = 1;
 
+# An assembly graph held natively in columns (Anorman::Assembly::Graph::Store).
+# Nodes, edges and components are handed out as light views:
+#
+#	my $graph = Anorman::Assembly::Graph->new( node_file => $nf, edge_file => $ef );
+#	$graph->nodes->filter( length => [ '>=', 500 ] );
+#	$graph->edges->filter( connections => [ '>=', 3 ] );
+#	$graph->init;
+#
+#	foreach my $comp ($graph->components) {
+#		my @walk = $comp->traverse( undef, 'bfs' );
+#	}
+#
+# Connected components are rebuilt natively whenever nodes or edges were
+# dropped since they were last asked for
+
 sub new {
 	warn "Initializing Object\n" if $DEBUG;
 
 	my $class = shift;
 	my $self  = bless ( { @_ }, $class );
-	
-	$self->{'_NODES'} 	= Anorman::Assembly::Graph::Nodes->new;
-	$self->{'_EDGES'} 	= Anorman::Assembly::Graph::Edges->new;
-	$self->{'_UNION'} 	= Anorman::Math::UnionFind->new;
-	$self->{'_COMPONENTS'} 	= Anorman::Assembly::Graph::Components->new;	
-	
+	my $store = Anorman::Assembly::Graph::Store->new;
+
+	$self->{'_STORE'}      = $store;
+	$self->{'_NODES'}      = Anorman::Assembly::Graph::Nodes->new( $store );
+	$self->{'_EDGES'}      = Anorman::Assembly::Graph::Edges->new( $store );
+	$self->{'_COMPONENTS'} = Anorman::Assembly::Graph::Components->new( $store );
+
 	return $self;
 }
 
+sub store {
+	my $self = shift;
+	return $self->{'_STORE'};
+}
+
 sub edges {
 	my $self = shift;
-	
-	return wantarray ? @{ $self->{'_EDGES'} } : $self->{'_EDGES'};
+	return wantarray ? $self->{'_EDGES'}->list : $self->{'_EDGES'};
 }
 
 sub nodes {
@@ -39,121 +58,57 @@ sub nodes {
 
 sub components {
 	my $self = shift;
-	return wantarray ? @{ $self->{'_COMPONENTS'} } : $self->{'_COMPONENTS'};
-}
-
-sub unionfind {
-	my $self = shift;
-	return $self->{'_UNION'};
+	return wantarray ? $self->{'_COMPONENTS'}->list : $self->{'_COMPONENTS'};
 }
 
 sub edge_file {
-
+	my $self = shift;
+	$self->{'edge_file'} = shift if defined $_[0];
+	return $self->{'edge_file'};
 }
 
 sub node_file {
-
+	my $self = shift;
+	$self->{'node_file'} = shift if defined $_[0];
+	return $self->{'node_file'};
 }
 
+# name of the node carrying a sequence id
 sub seqid2index {
 	my $self  = shift;
 	my $seqid = shift;
+	my $id    = $self->store->seqid_node( $seqid );
 
-	return undef unless exists $self->{'_seqid_cache'}->{ $seqid };
-	return $self->{'_seqid_cache'}->{ $seqid };
+	return undef if $id < 0;
+	return $self->store->node_name( $id );
 }
 
 sub init {
 	my $self = shift;
-	my $iter = Anorman::Common::Iterator->new( 'IG' => qr/^[#\n]/ );
 
 	(exists $self->{'node_file'} or $self->_error("No nodes file specified"));
 	(exists $self->{'edge_file'} or $self->_error("No edges file specified"));
-	
-	my $counter = 0;
-	
-	warn "Adding nodes...\n" if $DEBUG;
-	$iter->open( $self->{'node_file'} );
-
-		$iter->NEXT;
-		$counter++;
 
-		my @node_fields = qw/name seqid length coverage degree/;
-		while ($iter->MORE) {
-			$self->nodes->add( $iter->HASH(@node_fields) );
-			$iter->NEXT;
-			$counter++;
-		}
+	warn "Adding nodes...\n" if $DEBUG;
+	my $counter = $self->store->load_nodes( $self->{'node_file'} );
 
-	$iter->close;
-	$self->_cache_seqids;
+	$self->nodes->_apply_filters;
 
 	print $self->nodes->size, " nodes (out of $counter)\n";
-	
-	warn "Adding edges...\n" if $DEBUG;
-	$iter->open( $self->{'edge_file'} );
-
-		$iter->NEXT;
-
-		my @edge_fields = qw/node1 node2 type connections ratio score/;
 
-		while ($iter->MORE) {
-			my $edge = Anorman::Assembly::Graph::Edge->new( $iter->HASH(@edge_fields), $self->nodes );
-			my $connected = $self->edges->connect( $edge, $self->nodes );
-
-			if ($connected) {
-				my $key1 = $edge->node1->name;
-				my $key2 = $edge->node2->name;
-				
-				$self->unionfind->union( $key1, $key2 );
-			}
-			$iter->NEXT;
-		}
+	warn "Adding edges...\n" if $DEBUG;
+	my ($lines, $skipped) = $self->store->load_edges( $self->{'edge_file'} );
 
-	$iter->close;
+	$self->edges->_apply_filters;
 
 	print $self->edges->size, " edges\n";
-	
+	warn "$skipped edges between unknown nodes skipped\n" if $DEBUG && $skipped;
+
 	warn "Construct connected components\n";
-	$self->_make_components;
+	$self->components->_sync;
 
 	warn $self->components->size, " components created\n";
-}
-
-sub _make_components {
-	my $self = shift;
-	
-	my %disjoint_sets = ();
-	my @orphans = ();
-
-	while (my ($key, $node) = $self->nodes->iterate) {
-			if ( $self->unionfind->has( $key ) ) {
-				my $set = $self->unionfind->find( $key );
-				push @{ $disjoint_sets{ $set } }, $key;
-			} else {
-				push @orphans, $node;
-			}	
-	}
-
-	# create connected components in descending order of size
-	foreach my $set( sort { @{ $b } <=> @{ $a } } values %disjoint_sets ){
-		my @cc = map { $self->nodes->get( $_ ) } @{ $set };
-	
-		$self->components->add( \@cc );
-	}
-
-	warn scalar @orphans, " orphan nodes\n";
-}
-
-sub _cache_seqids {
-	my $self = shift;
-	my %index = ();
-
-	while (my ($key, $node) =  $self->nodes->iterate ) {
-		$index{ $node->seqid } = $key;
-	}
-
-	$self->{'_seqid_cache'} = \%index;	
+	warn $self->components->orphans, " orphan nodes\n";
 }
 
 sub _error {
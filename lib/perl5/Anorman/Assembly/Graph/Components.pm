@@ -2,67 +2,112 @@ package Anorman::Assembly::Graph::Components;
 
 use parent 'Anorman::Assembly::Graph';
 
-# disable filtering by default
-my $FILTER = sub { return 1 };
-my $INDEX  = 0;
+# Connected components of a graph store, largest first. They are found
+# natively with a parallel union-find over the active edges and rebuilt
+# on demand after nodes or edges were dropped, re-applying the filters:
+#
+#	$comps->filter( size => [ '>=', 3 ], length => [ '>=', 10000 ] );
+#	$comps->filter( sub { $_[0]->avg_coverage > 20 } );
+#
+# Nodes without active edges belong to no component
 
 sub new {
 	my $class = shift;
-	my $graph = shift;
-	my $self  = bless( [], $class || ref $class);
+	my $store = shift;
 
-	return $self;
+	return bless( { '_STORE' => $store, '_FILTERS' => [] }, ref $class || $class );
 }
 
-sub add {
-	my $self = shift;
-	my $comp = shift;
+sub store {
+	return $_[0]->{'_STORE'};
+}
 
-	if (ref $comp eq 'ARRAY') {
-		$comp =  Anorman::Assembly::Graph::Component->new( $comp );
-	} 
+sub get {
+	my $self  = shift;
+	my $index = shift;
 
-	if ($self->filter( $comp )) {
-		foreach ( $comp->nodes ) {
-			$_->member_of( $INDEX );
-		}
+	$self->_sync;
 
-		$INDEX++;
+	my $id = $self->store->component_id( $index );
 
-		push @{ $self }, $comp 	
-	}
+	$self->_error("Component $index does not exists") if $id < 0;
+	return Anorman::Assembly::Graph::Component->new( $self->store, $id );
+}
 
+sub size {
+	my $self = shift;
+
+	$self->_sync;
+	return $self->store->n_components;
 }
 
-sub get {
-	my $self  = shift;
-	my $index = shift;
+sub list {
+	my $self = shift;
 
-	$self->_error("Component $index does not exists") unless defined $self->[ $index ];
-	return $self->[ $index ];
+	$self->_sync;
+	return map { Anorman::Assembly::Graph::Component->new( $self->store, $self->store->component_id( $_ ) ) }
+		0 .. $self->store->n_components - 1;
 }
 
-sub size {
+# active nodes outside any component
+sub orphans {
 	my $self = shift;
-	return scalar @{ $self };
-} 
+
+	$self->_sync;
+	return scalar grep { $self->store->node_degree( $_ ) == 0 } $self->store->active_nodes;
+}
 
 sub filter {
+	my $self = shift;
+
+	return 0 unless @_;
+
+	if (ref $_[0] eq 'Anorman::Assembly::Graph::Component') {
+		my $comp = shift;
+
+		foreach my $filter(grep { ref $_ eq 'CODE' } @{ $self->{'_FILTERS'} }) {
+			return 0 unless $filter->( $comp, @_ );
+		}
+
+		return 1;
+	}
+
+	my $filter = ref $_[0] eq 'CODE' ? $_[0] : [ @_ ];
+
+	$self->_error("Filter argument must either be a CODE block or column => [ op, value ] pairs")
+		if ref $filter eq 'ARRAY' && @{ $filter } % 2;
+
+	push @{ $self->{'_FILTERS'} }, $filter;
+
+	return $self->store->components_valid ? $self->_filter( $filter ) : 0;
+}
+
+sub _filter {
 	my $self   = shift;
 	my $filter = shift;
-	my $data   = shift;
-
-	if (defined $filter) {
-		if (ref ($filter) eq 'CODE') {
-			$FILTER = $filter;
-		} elsif (ref $filter eq 'Anorman::Assembly::Graph::Component') {
-			return $FILTER->( $filter, $data );
-		} else {
-			$self->_error("Filter argument must be either be a CODE block or a Component object");
-		}
-	} 
-	
-	return $FILTER;
+
+	return $self->store->filter( 'components', @{ $filter } ) if ref $filter eq 'ARRAY';
+
+	my $removed = 0;
+
+	foreach my $comp($self->list) {
+		next if $filter->( $comp );
+
+		$self->store->drop_component( $comp->id );
+		$removed++;
+	}
+
+	return $removed;
+}
+
+# rebuild components if the graph changed since
+sub _sync {
+	my $self = shift;
+
+	return if $self->store->components_valid;
+
+	$self->store->build_components;
+	$self->_filter( $_ ) foreach @{ $self->{'_FILTERS'} };
 }
 
 1;
@@ -72,64 +117,77 @@ package Anorman::Assembly::Graph::Component;
 use parent -norequire,'Anorman::Assembly::Graph';
 use strict;
 
+# a component id in a graph store, valid until the graph changes
 sub new {
 	my $class = shift;
-	my $nodes = shift;
+	my ($store, $id) = @_;
+
+	return bless ([ $store, $id ], $class || ref $class);
+}
+
+sub id {
+	return $_[0]->[1];
+}
 
-	return bless ($nodes, $class || ref $class);
+# position among the components, as used by Components::get
+sub rank {
+	my $self = shift;
+	return $self->[0]->component_rank( $self->[1] );
 }
 
 sub nodes {
 	my $self = shift;
-	return @{ $self };
+	return map { Anorman::Assembly::Graph::Node->new( $self->[0], $_ ) } $self->[0]->component_nodes( $self->[1] );
 }
 
 sub size {
 	my $self = shift;
-	return scalar @{ $self };
+	return $self->[0]->component_size( $self->[1] );
 }
 
 sub length {
 	my $self = shift;
-	my $length = 0;
-
-	foreach my $node( $self->nodes ) {
-		$length += $node->length;
-	}
-
-	return $length;
+	return $self->[0]->component_length( $self->[1] );
 }
 
+# length weighted
 sub avg_coverage {
 	my $self = shift;
-	my $component_length = $self->length;
-
-	my $coverage = 0;
-
-	foreach my $node( $self->nodes ) {
-		$coverage += ($node->coverage * ($node->length / $component_length));
-	}
-	
-	return $coverage;
+	return $self->[0]->component_coverage( $self->[1] );
 }
 
 sub num_edges {
 	my $self = shift;
-	my $num_edges = 0;
-
-	foreach my $node( $self->nodes ) {
-		$num_edges += $node->edges_out;
-	}
-
-	return $num_edges;
+	return $self->[0]->component_edges( $self->[1] );
 }
 
 sub edges {
 	my $self = shift;
-	return map { $_->edges_out } $self->nodes
+	return map { $_->edges_out } $self->nodes;
 }
 
+# nodes in breadth first (default) or depth first order from $start, a
+# member node or name, or the first member. Edges are followed in both
+# directions
 sub traverse {
-	# TODO: a function that traverses the component
+	my $self  = shift;
+	my $start = shift;
+	my $order = shift || 'bfs';
+
+	$self->_error("Traversal order must be bfs or dfs") unless $order eq 'bfs' || $order eq 'dfs';
+
+	my $id;
+
+	if (!defined $start) {
+		($id) = $self->[0]->component_nodes( $self->[1] );
+	} elsif (ref $start) {
+		$id = $start->id;
+	} else {
+		$id = $self->[0]->node_id( $start );
+		$self->_error("No such node: $start") if $id < 0;
+	}
+
+	return map { Anorman::Assembly::Graph::Node->new( $self->[0], $_ ) } $self->[0]->traverse( $id, $order eq 'dfs' ? 1 : 0 );
 }
+
 1;
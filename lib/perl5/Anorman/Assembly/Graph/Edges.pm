@@ -2,68 +2,117 @@ package Anorman::Assembly::Graph::Edges;
 
 use parent 'Anorman::Assembly::Graph';
 
-my $FILTER = sub { return 1 };
+# The edges of a graph store. Column filters are scanned natively and in
+# parallel:
+#
+#	$edges->filter( connections => [ '>=', 3 ], type => [ '!=', 'rf' ] );
+#
+# CODE blocks are called with each Edge. Filters are remembered and
+# applied again when the graph is loaded
 
 sub new {
 	my $class = shift;
+	my $store = shift;
 
-	return bless( [], $class || ref $class );
+	return bless( { '_STORE' => $store, '_FILTERS' => [] }, ref $class || $class );
 }
 
+sub store {
+	return $_[0]->{'_STORE'};
+}
+
+# connect two known nodes from a hash of node1, node2, type, connections,
+# ratio and score. Returns 0 if a node is missing or a filter fails
 sub connect {
-	my $self  = shift;
-	my $edge  = shift;
-	my $nodes = shift;
-	
-
-	if (ref $edge eq 'HASH') {
-		$self->_error("Need nodes passed if handed a hash instead of edge object") unless defined $nodes;
-		$edge = Anorman::Assembly::Graph::Edge->new( $edge );
-	} 
-	
-	$self->_error("Not a valid edge object") unless ref $edge eq 'Anorman::Assembly::Graph::Edge';
-
-	return 0 unless ($nodes->get( $edge->node1) && $nodes->get( $edge->node2 ) );
-
-	if ($FILTER->( $edge )) {
-		$edge->_attach_nodes( $edge->nodes, $nodes );
-		push @{ $self }, $edge;
-		return 1;
-	} else {
-		undef $edge;
-		return 0;
+	my $self = shift;
+	my $edge = shift;
+
+	$self->_error("Edges are connected from a hash") unless ref $edge eq 'HASH';
+
+	my $id = $self->store->add_edge( @{ $edge }{ qw/node1 node2/ }, $edge->{'type'} // '',
+		$edge->{'connections'} || 0, $edge->{'ratio'} || 0, $edge->{'score'} || 0 );
+
+	return 0 if $id < 0;
+
+	my $new = Anorman::Assembly::Graph::Edge->new( $self->store, $id );
+
+	foreach my $filter(grep { ref $_ eq 'CODE' } @{ $self->{'_FILTERS'} }) {
+		unless ($filter->( $new )) {
+			$self->store->drop_edge( $id );
+			return 0;
+		}
 	}
+
+	return 1;
 }
 
 sub size {
 	my $self = shift;
-	return scalar @{ $self };
+	return $self->store->count_edges;
 }
 
 sub filter {
 	my $self = shift;
-	
-	if (defined $_[0]) { 
-		if (ref $_[0] eq 'CODE') {
-			$FILTER = shift;
-		} elsif (ref $_[0] eq 'Anorman::Assembly::Graph::Edge') {
-			return $FILTER->(@_);
-		} else {
-			$self->_error("Filter argument must be either be a CODE block or an Edge object");
+
+	return 0 unless @_;
+
+	if (ref $_[0] eq 'Anorman::Assembly::Graph::Edge') {
+		my $edge = shift;
+
+		foreach my $filter(grep { ref $_ eq 'CODE' } @{ $self->{'_FILTERS'} }) {
+			return 0 unless $filter->( $edge, @_ );
 		}
-	} 
 
-	return $FILTER;
+		return 1;
+	}
+
+	my $filter = ref $_[0] eq 'CODE' ? $_[0] : [ @_ ];
+
+	$self->_error("Filter argument must either be a CODE block or column => [ op, value ] pairs")
+		if ref $filter eq 'ARRAY' && @{ $filter } % 2;
+
+	push @{ $self->{'_FILTERS'} }, $filter;
+
+	return $self->_filter( $filter );
 }
 
+# edge by load index, the last one by default
 sub get {
 	my $self  = shift;
 	my $index = shift;
 
-	return $self->[ -1 ] unless defined $index;
-	$self->_error("Index ($index) out of bounds. No such Edge exists") if $index > $self->size;
-	
-	return $self->[ $index ];
+	$index = $self->store->n_edges - 1 unless defined $index;
+	$self->_error("Index ($index) out of bounds. No such Edge exists") unless $index >= 0 && $index < $self->store->n_edges;
+
+	return Anorman::Assembly::Graph::Edge->new( $self->store, $index );
+}
+
+sub list {
+	my $self = shift;
+	return map { Anorman::Assembly::Graph::Edge->new( $self->store, $_ ) } $self->store->active_edges;
+}
+
+sub _filter {
+	my $self   = shift;
+	my $filter = shift;
+
+	return $self->store->filter( 'edges', @{ $filter } ) if ref $filter eq 'ARRAY';
+
+	my $removed = 0;
+
+	foreach my $edge($self->list) {
+		next if $filter->( $edge );
+
+		$self->store->drop_edge( $edge->id );
+		$removed++;
+	}
+
+	return $removed;
+}
+
+sub _apply_filters {
+	my $self = shift;
+	$self->_filter( $_ ) foreach @{ $self->{'_FILTERS'} };
 }
 
 1;
@@ -72,92 +121,66 @@ package Anorman::Assembly::Graph::Edge;
 
 use parent -norequire,'Anorman::Assembly::Graph';
 
+# an edge id in a graph store
 sub new {
 	my $class = shift;
-	my $edge  = defined $_[0] ? shift : {};
+	my ($store, $id) = @_;
 
-	return bless( $edge, ref $class || $class );
+	return bless( [ $store, $id ], ref $class || $class );
+}
+
+sub id {
+	return $_[0]->[1];
 }
 
 sub node1 {
 	my $self = shift;
-	$self->{'node1'} = $_[0] if defined $_[0];
-	return $self->{'node1'};	
+	return Anorman::Assembly::Graph::Node->new( $self->[0], $self->[0]->edge_src( $self->[1] ) );
 }
 
 sub node2 {
 	my $self = shift;
-	$self->{'node2'} = $_[0] if defined $_[0];
-	return $self->{'node2'};
+	return Anorman::Assembly::Graph::Node->new( $self->[0], $self->[0]->edge_dst( $self->[1] ) );
 }
 
 sub nodes {
 	my $self = shift;
-	return ($self->{'node1'}, $self->{'node2'});
+	return ($self->node1, $self->node2);
 }
 
 sub connections {
 	my $self = shift;
-	return $self->{'connections'};	
+	return $self->[0]->edge_connections( $self->[1] );
 }
 
 sub type {
 	my $self = shift;
-	return $self->{'type'};
+	return $self->[0]->edge_type( $self->[1] );
 }
 
 sub score {
 	my $self = shift;
-	return $self->{'score'};	
+	return $self->[0]->edge_score( $self->[1] );
 }
 
+# edges are weighted by their score
 sub weight {
 	my $self = shift;
-	return $self->{'weight'};
+	return $self->score;
 }
 
 sub ratio {
 	my $self = shift;
-	$self->{'ratio'} = $_[0] if defined $_[0];
-	return $self->{'ratio'};
-}
-
-sub merge {
-
+	return $self->[0]->edge_ratio( $self->[1] );
 }
 
-sub DESTROY {
-	my $self  = shift;
-
-	my $node1 = $self->node1;
-	my $node2 = $self->node2;
-
-	$node1->{'degree'}--;
-	$node2->{'degree'}--;
-
-	undef %{ $self };
-}
-
-sub _attach_nodes {
+sub active {
 	my $self = shift;
-	my ($node1, $node2, $nodes) = @_;
-
-	# attach node1
-	$node1 = $nodes->get( $self->node1 );
+	return $self->[0]->edge_active( $self->[1] );
+}
 
-	$self->_error("Cannot connect: node1 is not a valid Node Object",1)
-		unless ref $node1 eq 'Anorman::Assembly::Graph::Node';
-	$node1->_attach_out_edge( $self );
-	$self->node1( $node1 );
-	
-	# attach node 2
-	$node2 = $nodes->get( $self->node2 );
-	$self->_error("Cannot connect: node2 is not a valid Node Object",1)
-		unless ref $node2 eq 'Anorman::Assembly::Graph::Node';
+sub merge {
 
-	$node2->_attach_in_edge( $self );
-	$self->node2( $node2 );
 }
 
 1;
-
@@ -2,78 +2,137 @@ package Anorman::Assembly::Graph::Nodes;
 
 use parent 'Anorman::Assembly::Graph';
 
-# pass-all filter
-my $FILTER = sub { return 1 };
+# The nodes of a graph store. Filters are either column predicates,
+# scanned natively:
+#
+#	$nodes->filter( length => [ '>=', 1000 ], coverage => [ '<', 500 ] );
+#
+# or a CODE block called with each Node, which is slow but general.
+# Filters are remembered and applied again when the graph is loaded
 
 sub new {
 	my $class = shift;
-	
-	return bless ( {}, $class || ref $class );
+	my $store = shift;
+
+	return bless ( { '_STORE' => $store, '_FILTERS' => [], '_ITER' => undef }, ref $class || $class );
+}
+
+sub store {
+	return $_[0]->{'_STORE'};
 }
 
 sub get {
 	my $self = shift;
-	my $node = shift;
+	my $name = shift;
+	my $id   = $self->store->node_id( $name );
 
-	return undef unless exists $self->{ $node };
-	return $self->{ $node }; 
+	return undef unless $id >= 0 && $self->store->node_active( $id );
+	return Anorman::Assembly::Graph::Node->new( $self->store, $id );
 }
 
 sub add {
 	my $self = shift;
 	my $node = shift;
 
-	if (ref $node eq 'HASH') {
-		$node = Anorman::Assembly::Graph::Node->new( $node );
-	}
+	$self->_error("Nodes are added from a hash") unless ref $node eq 'HASH';
 
-	$self->_error("Not a valid Node object") unless ref $node eq 'Anorman::Assembly::Graph::Node';
+	my $id = $self->store->add_node( @{ $node }{ qw/name seqid/ }, $node->{'length'} || 0, $node->{'coverage'} || 0 );
 
-	if ($self->filter( $node )) {
-		$node->degree( 0 );
-		$self->{ $node->name } = $node;
-		return 1;
+	$self->_error("Failed to add node $node->{'name'}") if $id < 0;
+
+	my $new = Anorman::Assembly::Graph::Node->new( $self->store, $id );
+
+	foreach my $filter(grep { ref $_ eq 'CODE' } @{ $self->{'_FILTERS'} }) {
+		unless ($filter->( $new )) {
+			$self->store->drop_node( $id );
+			return 0;
+		}
 	}
+
+	return 1;
 }
 
 sub size {
 	my $self = shift;
-	return scalar keys %{ $self };
+	return $self->store->count_nodes;
 }
 
 sub remove {
 	my $self = shift;
-	my $node = shift;
-	$self->{ $node }->DESTROY;
-	delete $self->{ $node };
+	my $name = shift;
+	my $id   = $self->store->node_id( $name );
+
+	$self->store->drop_node( $id ) if $id >= 0;
 }
 
 sub filter {
-	my $self   = shift;
-	my $filter = shift;
-	my $data   = shift;
-
-	if (defined $filter) { 
-		if (ref $filter eq 'CODE') {
-			$FILTER = $filter;
-		} elsif (ref $filter eq 'Anorman::Assembly::Graph::Node') {
-			return $FILTER->( $filter, $data );
-		} else {
-			$self->_error("Filter argument must be either be a CODE block or a Node object");
+	my $self = shift;
+
+	return 0 unless @_;
+
+	# test a single node against the CODE filters
+	if (ref $_[0] eq 'Anorman::Assembly::Graph::Node') {
+		my $node = shift;
+
+		foreach my $filter(grep { ref $_ eq 'CODE' } @{ $self->{'_FILTERS'} }) {
+			return 0 unless $filter->( $node, @_ );
 		}
-	} 
 
-	return $FILTER;
+		return 1;
+	}
+
+	my $filter = ref $_[0] eq 'CODE' ? $_[0] : [ @_ ];
+
+	$self->_error("Filter argument must either be a CODE block or column => [ op, value ] pairs")
+		if ref $filter eq 'ARRAY' && @{ $filter } % 2;
+
+	push @{ $self->{'_FILTERS'} }, $filter;
+
+	return $self->_filter( $filter );
 }
 
 sub iterate {
 	my $self = shift;
-	return each %{ $self };
+
+	$self->{'_ITER'} = [ $self->store->active_nodes ] unless defined $self->{'_ITER'};
+
+	my $id = shift @{ $self->{'_ITER'} };
+
+	unless (defined $id) {
+		$self->{'_ITER'} = undef;
+		return;
+	}
+
+	return ($self->store->node_name( $id ), Anorman::Assembly::Graph::Node->new( $self->store, $id ));
 }
 
+# active nodes in load order
 sub list {
 	my $self = shift;
-	return map { $self->get( $_ ) } sort { $a <=> $b } keys %{ $self };
+	return map { Anorman::Assembly::Graph::Node->new( $self->store, $_ ) } $self->store->active_nodes;
+}
+
+sub _filter {
+	my $self   = shift;
+	my $filter = shift;
+
+	return $self->store->filter( 'nodes', @{ $filter } ) if ref $filter eq 'ARRAY';
+
+	my $removed = 0;
+
+	foreach my $node($self->list) {
+		next if $filter->( $node );
+
+		$self->store->drop_node( $node->id );
+		$removed++;
+	}
+
+	return $removed;
+}
+
+sub _apply_filters {
+	my $self = shift;
+	$self->_filter( $_ ) foreach @{ $self->{'_FILTERS'} };
 }
 
 1;
@@ -82,57 +141,57 @@ package Anorman::Assembly::Graph::Node;
 
 use parent -norequire,'Anorman::Assembly::Graph';
 
+# a node id in a graph store
 sub new {
 	my $class = shift;
-	my $node  = defined $_[0] ? shift : {};
+	my ($store, $id) = @_;
 
-	return bless( $node, ref $class || $class );	
+	return bless( [ $store, $id ], ref $class || $class );
+}
+
+sub id {
+	return $_[0]->[1];
 }
 
 sub name {
 	my $self = shift;
-	$self->{'name'} = shift if defined $_[0];
-	return $self->{'name'};
+	return $self->[0]->node_name( $self->[1] );
 }
 
 sub seqid {
 	my $self = shift;
-	$self->{'seqid'} = shift if defined $_[0];
-	return $self->{'seqid'};
+	return $self->[0]->node_seqid( $self->[1] );
 }
 
 sub coverage {
 	my $self = shift;
-	$self->{'coverage'} = shift if defined $_[0];
-	return $self->{'coverage'};
+	return $self->[0]->node_coverage( $self->[1] );
 }
 
 sub degree {
 	my $self = shift;
-	$self->{'degree'} = shift if defined $_[0];
-	return $self->{'degree'};
+	return $self->[0]->node_degree( $self->[1] );
 }
 
 sub length {
 	my $self = shift;
-	$self->{'seqid'} = shift if defined $_[0];
-	return $self->{'length'};
+	return $self->[0]->node_length( $self->[1] );
 }
 
 sub edges_in {
 	my $self = shift;
-	return @{ $self->{'_EDGES_IN'} };
+	return map { Anorman::Assembly::Graph::Edge->new( $self->[0], $_ ) } $self->[0]->node_edges( $self->[1], 1 );
 }
 
 sub edges_out {
 	my $self = shift;
-	return @{ $self->{'_EDGES_OUT'} };
+	return map { Anorman::Assembly::Graph::Edge->new( $self->[0], $_ ) } $self->[0]->node_edges( $self->[1], 0 );
 }
 
+# index of the connected component holding the node, -1 for orphans
 sub member_of {
-	my $self      = shift;
-	$self->{'member_of'} = shift if defined $_[0];
-	return $self->{'member_of'};
+	my $self = shift;
+	return $self->[0]->node_component( $self->[1] );
 }
 
 sub merge {
@@ -140,40 +199,13 @@ sub merge {
 }
 
 sub neighbors {
-	my $self = shift;
-	
-	my @neighbors = ();
-	foreach my $edge( $self->edges_out ) {
-		push @neighbors, $edge->node2->name;
-	}
-	
-	foreach my $edge( $self->edges_in ) {
-		push @neighbors, $edge->node1->name;
-	}
-	
-	return @neighbors;
-}
-
-sub _attach_in_edge {
-	my $self = shift;
-	my $edge = shift;
-
-	$self->_error("Not a valid edge object") unless ref $edge eq 'Anorman::Assembly::Graph::Edge';
+	my $self  = shift;
+	my $store = $self->[0];
 
-	push @{ $self->{'_EDGES_IN'} }, $edge;
+	my @neighbors = map { $store->node_name( $store->edge_dst( $_ ) ) } $store->node_edges( $self->[1], 0 );
+	push @neighbors, map { $store->node_name( $store->edge_src( $_ ) ) } $store->node_edges( $self->[1], 1 );
 
-	$self->{'degree'}++;
-}
-
-sub _attach_out_edge {
-	my $self = shift;
-	my $edge = shift;
-
-	$self->_error("Not a valid edge object") unless ref $edge eq 'Anorman::Assembly::Graph::Edge';
-
-	push @{ $self->{'_EDGES_OUT'} }, $edge;
-
-	$self->{'degree'}++;
+	return @neighbors;
 }
 
 1;
@@ -0,0 +1,507 @@
+package Anorman::Assembly::Graph::Store;
+
+# Native column store behind Anorman::Assembly::Graph (see
+# src/anorman/lib/graph.c). Nodes, edges and components are addressed by
+# dense integer ids; the Nodes, Edges and Components classes wrap these
+# ids in thin view objects
+
+use strict;
+use warnings;
+
+use Anorman::Common;
+
+# filter operators and columns, as in graph.h
+our %OPS = (
+	'<'  => 0,
+	'<=' => 1,
+	'>'  => 2,
+	'>=' => 3,
+	'==' => 4,
+	'!=' => 5
+);
+
+our %COLUMNS = (
+	'nodes'      => { 'length' => 0, 'coverage' => 1, 'degree' => 2 },
+	'edges'      => { 'connections' => 0, 'ratio' => 1, 'score' => 2, 'type' => 3 },
+	'components' => { 'size' => 0, 'length' => 1, 'avg_coverage' => 2, 'coverage' => 2, 'num_edges' => 3, 'edges' => 3 }
+);
+
+my %KIND = ( 'nodes' => 0, 'edges' => 1, 'components' => 2 );
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	return _XS_new( $class );
+}
+
+# apply column predicates: filter( 'nodes', length => [ '>=', 1000 ], ... ).
+# Returns the number of nodes, edges or components dropped
+sub filter {
+	my $self = shift;
+	my $kind = shift;
+	my $removed = 0;
+
+	trace_error("Unknown graph element '$kind'") unless exists $KIND{ $kind };
+
+	while (my ($column, $spec) = splice @_, 0, 2) {
+		my ($op, $value) = ref $spec eq 'ARRAY' ? @{ $spec } : ( '>=', $spec );
+
+		trace_error("Cannot filter $kind on '$column'") unless exists $COLUMNS{ $kind }{ $column };
+		trace_error("Unknown filter operator '$op'") unless exists $OPS{ $op };
+
+		# edge types are compared by their interned id
+		$value = $self->type_id( $value ) if $kind eq 'edges' && $column eq 'type';
+
+		$removed += $self->_XS_filter( $KIND{ $kind }, $COLUMNS{ $kind }{ $column }, $OPS{ $op }, $value );
+	}
+
+	return $removed;
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Assembly::Graph::Store',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lm -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "perl2c.h"
+#include "error.h"
+#include "threads.h"
+#include "intern.h"
+#include "unionfind.h"
+#include "graph.h"
+
+#include "../lib/threads.c"
+#include "../lib/intern.c"
+#include "../lib/unionfind.c"
+#include "../lib/graph.c"
+
+static SV* c_graph_string( StrIntern* si, size_t id ) {
+    size_t len;
+    const char* s = c_intern_name( si, id, &len );
+    return s ? newSVpvn( s, len ) : &PL_sv_undef;
+}
+
+static int c_graph_has_node( AsmGraph* g, IV id ) {
+    return id >= 0 && (size_t) id < g->n_nodes;
+}
+
+static int c_graph_has_edge( AsmGraph* g, IV id ) {
+    return id >= 0 && (size_t) id < g->n_edges;
+}
+
+static int c_graph_has_component( AsmGraph* g, IV id ) {
+    return g->components_valid && id >= 0 && (size_t) id < g->n_components;
+}
+
+SV* _XS_new( SV* sv_class_name ) {
+    AsmGraph* g = c_graph_alloc();
+    SV* self;
+
+    if (g == NULL) {
+        croak("Failed to allocate graph");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( g, self, class_name );
+
+    return self;
+}
+
+IV load_nodes( SV* self, char* path ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    const int64_t n = c_graph_load_nodes( g, path );
+
+    if (n < 0) {
+        croak("Failed to load nodes from %s", path);
+    }
+
+    return (IV) n;
+}
+
+/* (lines read, edges skipped) */
+void load_edges( SV* self, char* path ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    size_t skipped = 0;
+    const int64_t n = c_graph_load_edges( g, path, &skipped );
+
+    if (n < 0) {
+        croak("Failed to load edges from %s", path);
+    }
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    Inline_Stack_Push( sv_2mortal( newSVuv( (UV) n ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVuv( (UV) skipped ) ) );
+
+    Inline_Stack_Done;
+}
+
+IV add_node( SV* self, SV* sv_name, SV* sv_seqid, UV length, double coverage ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    STRLEN l1, l2;
+    const char* name  = SvPV( sv_name, l1 );
+    const char* seqid = SvPV( sv_seqid, l2 );
+
+    return (IV) c_graph_add_node( g, name, l1, seqid, l2, (uint64_t) length, coverage );
+}
+
+IV add_edge( SV* self, SV* sv_node1, SV* sv_node2, SV* sv_type, UV connections, double ratio, double score ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    STRLEN l1, l2, l3;
+    const char* node1 = SvPV( sv_node1, l1 );
+    const char* node2 = SvPV( sv_node2, l2 );
+    const char* type  = SvPV( sv_type, l3 );
+
+    return (IV) c_graph_add_edge( g, node1, l1, node2, l2, type, l3, (uint32_t) connections, ratio, score );
+}
+
+IV node_id( SV* self, SV* sv_name ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    STRLEN len;
+    const char* name = SvPV( sv_name, len );
+
+    return (IV) c_intern_lookup( g->names, name, len );
+}
+
+IV seqid_node( SV* self, SV* sv_seqid ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    STRLEN len;
+    const char* seqid = SvPV( sv_seqid, len );
+    const int64_t sid = c_intern_lookup( g->seqids, seqid, len );
+
+    return sid < 0 ? -1 : (IV) g->seqid_node[ sid ];
+}
+
+IV type_id( SV* self, SV* sv_type ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    STRLEN len;
+    const char* type = SvPV( sv_type, len );
+
+    return (IV) c_intern_lookup( g->types, type, len );
+}
+
+UV n_nodes( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return (UV) g->n_nodes;
+}
+
+UV n_edges( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return (UV) g->n_edges;
+}
+
+UV count_nodes( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    size_t i, n = 0;
+    for (i = 0; i < g->n_nodes; i++) {
+        n += g->node_active[ i ];
+    }
+
+    return (UV) n;
+}
+
+UV count_edges( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    size_t i, n = 0;
+    for (i = 0; i < g->n_edges; i++) {
+        n += g->edge_active[ i ];
+    }
+
+    return (UV) n;
+}
+
+/* ids of the active nodes and edges, in load order */
+void active_nodes( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t i;
+    for (i = 0; i < g->n_nodes; i++) {
+        if (g->node_active[ i ]) {
+            Inline_Stack_Push( sv_2mortal( newSVuv( (UV) i ) ) );
+        }
+    }
+
+    Inline_Stack_Done;
+}
+
+void active_edges( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t i;
+    for (i = 0; i < g->n_edges; i++) {
+        if (g->edge_active[ i ]) {
+            Inline_Stack_Push( sv_2mortal( newSVuv( (UV) i ) ) );
+        }
+    }
+
+    Inline_Stack_Done;
+}
+
+SV* node_name( SV* self, IV v ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_node( g, v ) ? c_graph_string( g->names, (size_t) v ) : &PL_sv_undef;
+}
+
+SV* node_seqid( SV* self, IV v ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_node( g, v ) ? c_graph_string( g->seqids, g->node_seqid[ v ] ) : &PL_sv_undef;
+}
+
+SV* node_length( SV* self, IV v ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_node( g, v ) ? newSVuv( (UV) g->length[ v ] ) : &PL_sv_undef;
+}
+
+SV* node_coverage( SV* self, IV v ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_node( g, v ) ? newSVnv( g->coverage[ v ] ) : &PL_sv_undef;
+}
+
+SV* node_degree( SV* self, IV v ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_node( g, v ) ? newSVuv( (UV) g->degree[ v ] ) : &PL_sv_undef;
+}
+
+IV node_active( SV* self, IV v ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_node( g, v ) ? (IV) g->node_active[ v ] : 0;
+}
+
+/* position of the node's component among the active ones, -1 if none */
+IV node_component( SV* self, IV v ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (!c_graph_has_node( g, v ) || !g->components_valid || g->component[ v ] < 0) {
+        return -1;
+    }
+
+    return (IV) g->comp_rank[ g->component[ v ] ];
+}
+
+/* active out (in) edges of a node */
+void node_edges( SV* self, IV v, IV incoming ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (!c_graph_has_node( g, v ) || c_graph_index( g ) != C_SUCCESS) {
+        croak("Failed to index graph");
+    }
+
+    const size_t*   ptr  = incoming ? g->in_ptr : g->out_ptr;
+    const uint32_t* edge = incoming ? g->in_edge : g->out_edge;
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t i;
+    for (i = ptr[ v ]; i < ptr[ v + 1 ]; i++) {
+        if (g->edge_active[ edge[ i ] ]) {
+            Inline_Stack_Push( sv_2mortal( newSVuv( (UV) edge[ i ] ) ) );
+        }
+    }
+
+    Inline_Stack_Done;
+}
+
+SV* edge_src( SV* self, IV e ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_edge( g, e ) ? newSVuv( (UV) g->src[ e ] ) : &PL_sv_undef;
+}
+
+SV* edge_dst( SV* self, IV e ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_edge( g, e ) ? newSVuv( (UV) g->dst[ e ] ) : &PL_sv_undef;
+}
+
+SV* edge_type( SV* self, IV e ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_edge( g, e ) ? c_graph_string( g->types, g->type[ e ] ) : &PL_sv_undef;
+}
+
+SV* edge_connections( SV* self, IV e ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_edge( g, e ) ? newSVuv( (UV) g->connections[ e ] ) : &PL_sv_undef;
+}
+
+SV* edge_ratio( SV* self, IV e ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_edge( g, e ) ? newSVnv( g->ratio[ e ] ) : &PL_sv_undef;
+}
+
+SV* edge_score( SV* self, IV e ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_edge( g, e ) ? newSVnv( g->score[ e ] ) : &PL_sv_undef;
+}
+
+IV edge_active( SV* self, IV e ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_edge( g, e ) ? (IV) g->edge_active[ e ] : 0;
+}
+
+void drop_node( SV* self, IV v ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (c_graph_has_node( g, v )) {
+        c_graph_drop_node( g, (uint32_t) v );
+    }
+}
+
+void drop_edge( SV* self, IV e ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (c_graph_has_edge( g, e )) {
+        c_graph_drop_edge( g, (uint32_t) e );
+    }
+}
+
+IV components_valid( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return (IV) g->components_valid;
+}
+
+void build_components( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (c_graph_components( g ) != C_SUCCESS) {
+        croak("Failed to construct connected components");
+    }
+}
+
+/* components are handed out by rank, largest first, and addressed
+   internally by id */
+UV n_components( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return g->components_valid ? (UV) g->n_active_components : 0;
+}
+
+IV component_id( SV* self, IV rank ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (!g->components_valid || rank < 0 || (size_t) rank >= g->n_active_components) {
+        return -1;
+    }
+
+    return (IV) g->comp_order[ rank ];
+}
+
+IV component_rank( SV* self, IV c ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_component( g, c ) ? (IV) g->comp_rank[ c ] : -1;
+}
+
+void component_nodes( SV* self, IV c ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (!c_graph_has_component( g, c )) {
+        croak("No such component");
+    }
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t i;
+    for (i = g->comp_ptr[ c ]; i < g->comp_ptr[ c + 1 ]; i++) {
+        Inline_Stack_Push( sv_2mortal( newSVuv( (UV) g->comp_nodes[ i ] ) ) );
+    }
+
+    Inline_Stack_Done;
+}
+
+SV* component_size( SV* self, IV c ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_component( g, c ) ? newSVuv( (UV) (g->comp_ptr[ c + 1 ] - g->comp_ptr[ c ]) ) : &PL_sv_undef;
+}
+
+SV* component_length( SV* self, IV c ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_component( g, c ) ? newSVuv( (UV) g->comp_length[ c ] ) : &PL_sv_undef;
+}
+
+SV* component_coverage( SV* self, IV c ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_component( g, c ) ? newSVnv( g->comp_coverage[ c ] ) : &PL_sv_undef;
+}
+
+SV* component_edges( SV* self, IV c ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    return c_graph_has_component( g, c ) ? newSVuv( (UV) g->comp_edges[ c ] ) : &PL_sv_undef;
+}
+
+void drop_component( SV* self, IV c ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (c_graph_has_component( g, c ) && g->comp_active[ c ]) {
+        g->comp_active[ c ] = 0;
+        c_graph_rank_components( g );
+    }
+}
+
+UV _XS_filter( SV* self, IV kind, IV column, IV op, double value ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    switch (kind) {
+        case 0:  return (UV) c_graph_filter_nodes( g, (int) column, (int) op, value );
+        case 1:  return (UV) c_graph_filter_edges( g, (int) column, (int) op, value );
+        default: return g->components_valid ? (UV) c_graph_filter_components( g, (int) column, (int) op, value ) : 0;
+    }
+}
+
+/* node ids reachable from v over active edges */
+void traverse( SV* self, IV v, IV dfs ) {
+    SV_2STRUCT( self, AsmGraph, g );
+
+    if (!c_graph_has_node( g, v )) {
+        croak("No such node");
+    }
+
+    uint32_t* out;
+    Newx( out, g->n_nodes, uint32_t );
+
+    const int64_t n = c_graph_traverse( g, (uint32_t) v, (int) dfs, out );
+
+    if (n < 0) {
+        Safefree( out );
+        croak("Failed to traverse graph");
+    }
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    int64_t i;
+    for (i = 0; i < n; i++) {
+        Inline_Stack_Push( sv_2mortal( newSVuv( (UV) out[ i ] ) ) );
+    }
+
+    Safefree( out );
+
+    Inline_Stack_Done;
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, AsmGraph, g );
+    c_graph_free( g );
+}
+
+END_OF_C_CODE
+
+1;
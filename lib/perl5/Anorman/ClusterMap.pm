@@ -0,0 +1,512 @@
+package Anorman::ClusterMap;
+
+# Native sequence clusters (src/anorman/lib/clustermap.c) from a
+# USEARCH/UCLUST .uc file or a QIIME OTU map. The file is memory mapped,
+# labels are interned, and membership is kept as arrays by label and by
+# cluster, so 10^8 reads load without a Perl scalar per read:
+#
+#	my $map = Anorman::ClusterMap->new;
+#	$map->load_uc( $file );
+#
+#	foreach my $c($map->sort_by( 'CLST_SIZE', 1 )) {
+#		print $map->cluster_name( $c ), "\t", $map->size( $c ), "\n";
+#	}
+#
+# Clusters and labels are addressed by id, 0 .. n_clusters - 1 and
+# 0 .. n_labels - 1, in order of first appearance
+
+use strict;
+use warnings;
+
+use Anorman::Common qw(trace_error);
+use Anorman::Math::Random;
+use Anorman::Data::List::PackedInt;
+
+# sort and prune keys, as named in the cluster hashes
+my %COLUMNS = (
+	'CLST_NUM'       => 0,
+	'CLST_SIZE'      => 1,
+	'CLST_SEEDLEN'   => 2,
+	'CLST_PCTID_AVG' => 3
+);
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	return _XS_new( $class );
+}
+
+# Both loaders may be called on several files in turn and return the
+# number of records read
+sub load_uc {
+	my ($self, $file) = @_;
+	return $self->_load( $file, 0 );
+}
+
+sub load_otu_map {
+	my ($self, $file) = @_;
+	return $self->_load( $file, 1 );
+}
+
+sub _load {
+	my ($self, $file, $format) = @_;
+	my $n = $self->_XS_load( $file, $format );
+
+	trace_error("Could not open file $file: $!") if $n == -1;
+	trace_error("$file is not a correctly formatted cluster file") if $n < 0;
+
+	return $n;
+}
+
+# cluster ids ordered by a column, active clusters only
+sub sort_by {
+	my ($self, $key, $reverse) = @_;
+	return $self->_XS_sort( _column( $key ), $reverse ? 1 : 0 );
+}
+
+# deactivate clusters with a column below $min. Returns their number
+sub prune {
+	my ($self, $key, $min) = @_;
+	return $self->_XS_prune( _column( $key ), $min );
+}
+
+# split every label into its sample name, the label up to the first
+# $delimiter ('_'). Returns the sample names by sample id
+sub samples {
+	my $self  = shift;
+	my $delim = defined $_[0] ? shift : '_';
+
+	trace_error("Empty sample delimiter") unless length $delim;
+
+	return $self->_XS_samples( $delim );
+}
+
+# members per cluster and sample, for all or the named samples. Returns
+# the sample names counted
+sub count_samples {
+	my ($self, @include) = @_;
+	my @samples = $self->sample_names;
+
+	trace_error("Call samples() first") unless @samples;
+
+	my $flags;
+
+	if (@include) {
+		my %want = map { $_ => 1 } @include;
+		$flags   = pack( 'C*', map { $want{ $_ } ? 1 : 0 } @samples );
+		@samples = grep { $want{ $_ } } @samples;
+	}
+
+	$self->_XS_count_samples( $flags );
+
+	return @samples;
+}
+
+# Rarefaction over the labels in random order. Returns one array ref
+# per $step labels taken: the labels taken, then per sample (by sample
+# id) the labels and the distinct clusters seen so far. Options
+# min_size (clusters with fewer members are left out, 10), step (10000)
+# and seed (Anorman::Math::Random::seed)
+sub rarefy {
+	my $self = shift;
+	my %opt  = @_;
+
+	my $min_size = defined $opt{'min_size'} ? $opt{'min_size'} : 10;
+	my $step     = $opt{'step'} || 10000;
+	my $seed     = defined $opt{'seed'} ? $opt{'seed'} : Anorman::Math::Random::seed();
+
+	trace_error("Call samples() first") unless $self->n_samples;
+
+	my $order = Anorman::Data::List::PackedInt->range( 0, $self->n_labels, 'uint32' );
+	$order->shuffle( $seed );
+
+	my $width = 1 + 2 * $self->n_samples;
+	my @row   = unpack( 'Q*', $self->_XS_rarefy( $min_size, $order->to_packed, $step ) );
+	my @rows;
+
+	push @rows, [ splice( @row, 0, $width ) ] while @row;
+
+	return @rows;
+}
+
+# a cluster as the hash of the original parser: CLST_NUM, CLST_SEED,
+# CLST_SEEDLEN, CLST_SIZE, CLST_PCTID_AVG ('*' if not given),
+# CLST_LIBFLAG, CLST_HITS (label => identity) and, once samples are
+# counted, CLST_SMPLCOUNT
+sub cluster {
+	my ($self, $c) = @_;
+	my $seed  = $self->seed_label( $c );
+	my $pctid = $self->pctid_avg( $c );
+
+	my %cluster = (
+		'CLST_NUM'       => $self->cluster_name( $c ),
+		'CLST_SEED'      => defined $seed ? $seed : '',
+		'CLST_SEEDLEN'   => $self->seed_len( $c ),
+		'CLST_SIZE'      => $self->size( $c ),
+		'CLST_PCTID_AVG' => defined $pctid ? $pctid : '*',
+		'CLST_LIBFLAG'   => $self->libflag( $c ),
+		'CLST_HITS'      => $self->hits( $c )
+	);
+
+	my $counts = $self->sample_counts( $c );
+	$cluster{'CLST_SMPLCOUNT'} = $counts if defined $counts;
+
+	return \%cluster;
+}
+
+sub _column {
+	my $key = shift;
+
+	trace_error("Unknown cluster column \"$key\"") unless exists $COLUMNS{ $key };
+
+	return $COLUMNS{ $key };
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::ClusterMap',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lm',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include <math.h>
+
+#include "perl2c.h"
+#include "error.h"
+#include "intern.h"
+#include "clustermap.h"
+
+#include "../lib/intern.c"
+#include "../lib/clustermap.c"
+
+static SV* c_cm_name_sv( StrIntern* si, int64_t id ) {
+    size_t len;
+
+    if (si == NULL || id < 0 || (size_t) id >= c_intern_size( si )) {
+        return &PL_sv_undef;
+    }
+
+    const char* s = c_intern_name( si, (size_t) id, &len );
+
+    return newSVpvn( s, len );
+}
+
+static size_t c_cm_check( ClusterMap* cm, UV c ) {
+    if (c >= c_cm_clusters( cm )) {
+        croak("Cluster %lu out of range", (unsigned long) c);
+    }
+
+    return (size_t) c;
+}
+
+SV* _XS_new( SV* sv_class_name ) {
+    ClusterMap* cm = c_cm_alloc();
+    SV* self;
+
+    if (cm == NULL) {
+        croak("Failed to allocate cluster map");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( cm, self, class_name );
+
+    return self;
+}
+
+IV _XS_load( SV* self, char* path, IV format ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return (IV) (format ? c_cm_load_otu_map( cm, path ) : c_cm_load_uc( cm, path ));
+}
+
+UV n_clusters( SV* self ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return (UV) c_cm_clusters( cm );
+}
+
+UV n_labels( SV* self ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return (UV) c_cm_labels( cm );
+}
+
+SV* cluster_name( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return c_cm_name_sv( cm->names, (int64_t) c );
+}
+
+IV cluster_id( SV* self, SV* name ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    STRLEN len;
+    const char* s = SvPV( name, len );
+    return (IV) c_intern_lookup( cm->names, s, (size_t) len );
+}
+
+SV* label( SV* self, UV l ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return c_cm_name_sv( cm->labels, (int64_t) l );
+}
+
+IV label_id( SV* self, SV* name ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    STRLEN len;
+    const char* s = SvPV( name, len );
+    return (IV) c_intern_lookup( cm->labels, s, (size_t) len );
+}
+
+/* cluster id of a label, -1 if unclustered */
+IV label_cluster( SV* self, UV l ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return l < c_cm_labels( cm ) ? (IV) cm->member_cluster[ l ] : -1;
+}
+
+UV size( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return (UV) cm->size[ c_cm_check( cm, c ) ];
+}
+
+SV* seed_label( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return c_cm_name_sv( cm->labels, cm->seed[ c_cm_check( cm, c ) ] );
+}
+
+UV seed_len( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return (UV) cm->seed_len[ c_cm_check( cm, c ) ];
+}
+
+SV* pctid_avg( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    const double v = cm->pctid_avg[ c_cm_check( cm, c ) ];
+    return isnan( v ) ? &PL_sv_undef : newSVnv( v );
+}
+
+void set_pctid_avg( SV* self, UV c, NV v ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    cm->pctid_avg[ c_cm_check( cm, c ) ] = (double) v;
+}
+
+SV* mean_pctid( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    const double v = c_cm_mean_pctid( cm, c_cm_check( cm, c ) );
+    return isnan( v ) ? &PL_sv_undef : newSVnv( v );
+}
+
+IV libflag( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return (IV) cm->libflag[ c_cm_check( cm, c ) ];
+}
+
+IV is_active( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return (IV) cm->active[ c_cm_check( cm, c ) ];
+}
+
+/* member labels of a cluster */
+void members( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    c_cm_check( cm, c );
+
+    if (c_cm_build( cm ) != C_SUCCESS) {
+        croak("Failed to build cluster members");
+    }
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t i;
+    for (i = cm->ptr[ c ]; i < cm->ptr[ c + 1 ]; i++) {
+        Inline_Stack_Push( sv_2mortal( c_cm_name_sv( cm->labels, cm->members[ i ] ) ) );
+    }
+
+    Inline_Stack_Done;
+}
+
+/* label => identity of the members other than the seed */
+SV* hits( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    c_cm_check( cm, c );
+
+    if (c_cm_build( cm ) != C_SUCCESS) {
+        croak("Failed to build cluster members");
+    }
+
+    HV* hv = newHV();
+
+    size_t i;
+    for (i = cm->ptr[ c ]; i < cm->ptr[ c + 1 ]; i++) {
+        const uint32_t l = cm->members[ i ];
+
+        if ((int64_t) l == cm->seed[ c ]) {
+            continue;
+        }
+
+        size_t len;
+        const char* s = c_intern_name( cm->labels, l, &len );
+        const float v = cm->member_pctid[ l ];
+
+        (void) hv_store( hv, s, (I32) len, isnan( v ) ? newSVpvs( "*" ) : newSVnv( v ), 0 );
+    }
+
+    return newRV_noinc( (SV*) hv );
+}
+
+/* cluster ids in order of their seeds */
+void order( SV* self ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t i;
+    for (i = 0; i < cm->n_order; i++) {
+        Inline_Stack_Push( sv_2mortal( newSVuv( cm->order[ i ] ) ) );
+    }
+
+    Inline_Stack_Done;
+}
+
+void _XS_sort( SV* self, IV column, IV reverse ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    uint32_t* ids;
+
+    Newx( ids, c_cm_clusters( cm ) + 1, uint32_t );
+    const size_t n = c_cm_sort( cm, (int) column, (int) reverse, ids );
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        Inline_Stack_Push( sv_2mortal( newSVuv( ids[ i ] ) ) );
+    }
+
+    Safefree( ids );
+    Inline_Stack_Done;
+}
+
+UV _XS_prune( SV* self, IV column, NV min ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return (UV) c_cm_prune( cm, (int) column, (double) min );
+}
+
+void _XS_samples( SV* self, SV* sv_delim ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    STRLEN len;
+    const char* delim = SvPV( sv_delim, len );
+
+    if (c_cm_samples( cm, delim, (size_t) len ) != C_SUCCESS) {
+        croak("Failed to assign samples");
+    }
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t s;
+    for (s = 0; s < c_intern_size( cm->samples ); s++) {
+        Inline_Stack_Push( sv_2mortal( c_cm_name_sv( cm->samples, (int64_t) s ) ) );
+    }
+
+    Inline_Stack_Done;
+}
+
+UV n_samples( SV* self ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    return cm->samples ? (UV) c_intern_size( cm->samples ) : 0;
+}
+
+void sample_names( SV* self ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t s;
+    for (s = 0; cm->samples && s < c_intern_size( cm->samples ); s++) {
+        Inline_Stack_Push( sv_2mortal( c_cm_name_sv( cm->samples, (int64_t) s ) ) );
+    }
+
+    Inline_Stack_Done;
+}
+
+/* one byte per sample, or undef for all */
+void _XS_count_samples( SV* self, SV* sv_include ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    const uint8_t* include = NULL;
+
+    if (SvOK( sv_include )) {
+        STRLEN len;
+        include = (const uint8_t*) SvPV( sv_include, len );
+
+        if (len != c_intern_size( cm->samples )) {
+            croak("Sample flags do not match the samples");
+        }
+    }
+
+    if (c_cm_count_samples( cm, include ) != C_SUCCESS) {
+        croak("Failed to count samples");
+    }
+}
+
+/* sample => members of a cluster, for the samples counted */
+SV* sample_counts( SV* self, UV c ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    c_cm_check( cm, c );
+
+    if (cm->sample_count == NULL) {
+        return &PL_sv_undef;
+    }
+
+    const size_t S  = c_intern_size( cm->samples );
+    HV*          hv = newHV();
+
+    size_t s;
+    for (s = 0; s < S; s++) {
+        if (cm->sample_include[ s ]) {
+            size_t len;
+            const char* name = c_intern_name( cm->samples, s, &len );
+
+            (void) hv_store( hv, name, (I32) len, newSVuv( cm->sample_count[ c * S + s ] ), 0 );
+        }
+    }
+
+    return newRV_noinc( (SV*) hv );
+}
+
+/* rows of native uint64 */
+SV* _XS_rarefy( SV* self, UV min_size, SV* sv_order, UV step ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    STRLEN len;
+    const uint32_t* order = (const uint32_t*) SvPV( sv_order, len );
+    const size_t    n     = len / sizeof(uint32_t);
+    const size_t    width = 1 + 2 * c_intern_size( cm->samples );
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        if (order[ i ] >= c_cm_labels( cm )) {
+            croak("Label %lu out of range", (unsigned long) order[ i ]);
+        }
+    }
+
+    SV* out = newSV( (n / step + 1) * width * sizeof(uint64_t) );
+    SvPOK_on( out );
+
+    const int64_t rows = c_cm_rarefy( cm, (uint32_t) min_size, order, n, (size_t) step, (uint64_t*) SvPVX( out ) );
+
+    if (rows < 0) {
+        SvREFCNT_dec( out );
+        croak("Rarefaction failed");
+    }
+
+    SvCUR_set( out, (size_t) rows * width * sizeof(uint64_t) );
+
+    return out;
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, ClusterMap, cm );
+    c_cm_free( cm );
+}
+
+END_OF_C_CODE
+
+1;
@@ -312,6 +312,16 @@ sub normalize {
     my $method = defined $_[0] ? shift : 'by_sum';
     my $opt    = shift;
 
+    # optimize all Box-Cox lambdas up front so columns can be processed in parallel
+    my %boxcox_fits = ();
+
+    if ($method eq 'BoxCox_opt' && ref($ref->[-1]) eq 'ARRAY') {
+        my @columns = map { [ @{ $_ }[ (ref($_->[0]) eq 'HASH' ? 1 : 0) .. $#{ $_ } ] ] } @{ $ref };
+        my @fits    = &Anorman::Math::Common::optimize_BoxCox_lambdas( \@columns, -10, 10 );
+
+        @boxcox_fits{ @{ $ref } } = @fits;
+    }
+
     my %METHODS = 
     
     ( 
@@ -354,10 +364,11 @@ sub normalize {
                                     
                                   },
 	'BoxCox_opt'   => sub     { my $data_r = shift;
+				    my $fit_r  = $boxcox_fits{ $data_r };
 	                            my $info_r = shift_info( $data_r );
 
-				    my $lambda1 = &Anorman::Math::Common::optimize_BoxCox_lambda( $data_r, -10, 10 );
-				    my $lambda2;# = &Anorman::Math::Common::optimize_BoxCox_shift_parameter( $data_r, $lambda1 );
+				    my ($lambda1, $lambda2) = defined $fit_r ? @{ $fit_r } :
+				        (&Anorman::Math::Common::optimize_BoxCox_lambda( $data_r, -10, 10 ), undef);
 					
 				    &Anorman::Math::Common::normalize_BoxCox( $data_r, $lambda1, $lambda2 );
 				    1;
@@ -1,8 +1,17 @@
 package Anorman::DNA;
 
+# Nucleotide sequence helpers. Composition and 2-bit packing run on the
+# native kernels of src/anorman/lib/dna.c, which classify a sequence in
+# one pass and pack 4 bases per byte
+#
+# The packed layout is that of vec( $bits, $i, 2 ) with T = 0, C = 1,
+# G = 2 and A = 3, so a packed string is also usable from Perl
+
 use strict;
 use warnings;
 
+use Anorman::Common;
+
 use Exporter;
 
 use vars qw(@ISA @EXPORT @EXPORT_OK %EXPORT_TAGS);
@@ -12,10 +21,14 @@ use vars qw(@ISA @EXPORT @EXPORT_OK %EXPORT_TAGS);
 @EXPORT_OK = qw(
 	reverse_complement
 	clean_nt
+	composition
 	gc_content
 	mono_nt_freq
 	N_vs_nonN
 	non_DNA
+	pack_2bit
+	unpack_2bit
+	reverse_complement_2bit
 );
 
 %EXPORT_TAGS = ( all => [ @EXPORT_OK ] );
@@ -40,73 +53,152 @@ sub clean_nt {
 }
 
 
+# counts of A, C, G, T, N, other IUPAC codes (ambiguity codes and
+# '.' or '-') and non-DNA characters, either case
+sub composition {
+	return (0) x 7 unless defined $_[0];
+	return _XS_composition( $_[0] );
+}
+
 sub gc_content {
-	my $GC = $_[0] =~ tr/GgCc/GgCc/;
-	my $AT = $_[0] =~ tr/AaTt/AaTt/;
+	my ($A, $C, $G, $T) = composition( $_[0] );
+	my $ACGT = $A + $C + $G + $T;
 
-	return ($GC/($GC + $AT));
+	return undef unless $ACGT;
+	return ($G + $C) / $ACGT;
 }
 
 sub mono_nt_freq {
 	my $length = length $_[0];
-	my @freqs = ();
 
-	$freqs[0] = ($_[0] =~ tr/Aa/Aa/) / $length;
-	$freqs[1] = ($_[0] =~ tr/Cc/Cc/) / $length;
-	$freqs[2] = ($_[0] =~ tr/Tt/Tt/) / $length;
-	$freqs[3] = ($_[0] =~ tr/Gg/Gg/) / $length;
+	return (0) x 4 unless $length;
+
+	my ($A, $C, $G, $T) = composition( $_[0] );
 
-	return @freqs;
+	return map { $_ / $length } ($A, $C, $T, $G);
 }
 
 sub N_vs_nonN {
-	my $N = $_[0] =~ tr/Nn/Nn/;
+	my $length = length $_[0];
 
-	return ($N / length $_[0]);
+	return 0 unless $length;
+	return (composition( $_[0] ))[4] / $length;
 }
 
 sub non_DNA {
-	my $Non_DNA = $_[0] =~ tr/AaCcTtGgRrYySsWwKkMmBbDdHhVvNn.-/AaCcTtGgRrYySsWwKkMmBbDdHhVvNn.-/c;
+	return (composition( $_[0] ))[6];
 }
 
-#### EXPERIMENTAL #####
+# 4 bases per byte. Bases other than ACGT pack as T
 sub pack_2bit {
-	my %dna2val = ('T' => 0, 'C' => 1, 'G' => 2, 'A' => 3 );
-	my $bits   = '';
-	my $seq    = shift;
-	my $pos    = 0;
-
-	while (my $nt = substr $seq, $pos, 1 || 0) {
-		vec ($bits, $pos, 2) = $dna2val{ $nt };
-		$pos++;
-	}
-	return $bits;
+	my $seq = shift;
+
+	return '' unless defined $seq;
+	return _XS_pack_2bit( $seq );
 }
 
+# $length bases, all four of every byte by default
 sub unpack_2bit {
-	my @val2dna = ( 'T', 'C', 'G', 'A' );
-	my $deq_seq = '';
-	my $string  = shift;
-	my $length  = length $string;
-	my $pos     = 0;	
-
-	while ($pos < (4 * $length)) { 
-		my $bval = vec( $string, $pos, 2);
-        	$deq_seq .= $val2dna[ $bval ];
-		$pos++;
-	}
-	return $deq_seq;
+	my $bits   = shift;
+	my $length = _packed_length( $bits, shift );
+
+	return _XS_unpack_2bit( $bits, $length );
 }
 
 sub reverse_complement_2bit {
-	my $rev_seq = '';
-	my $bits = shift;
-	my $unpacked_length = 4 * (length $bits);
-	
-	for (my $pos = $unpacked_length - 1; $pos >= 0; $pos--) {
-		vec ($rev_seq, $pos, 2) = vec($bits, $unpacked_length - ($pos + 1),2);
-	}
-	return ~$rev_seq;
+	my $bits   = shift;
+	my $length = _packed_length( $bits, shift );
+
+	return _XS_reverse_complement_2bit( $bits, $length );
 }
 
+sub _packed_length {
+	my ($bits, $length) = @_;
+	my $max = 4 * length $bits;
+
+	return $max unless defined $length;
+
+	trace_error("$length bases do not fit $max packed") if $length > $max;
+
+	return $length;
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::DNA',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "perl2c.h"
+#include "dna.h"
+
+#include "../lib/dna.c"
+
+void _XS_composition( SV* sv_seq ) {
+    STRLEN len;
+    const char* seq = SvPV( sv_seq, len );
+    uint64_t counts[ C_NT_CLASSES ];
+
+    c_dna_composition( seq, (size_t) len, counts );
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    int i;
+    for (i = 0; i < C_NT_CLASSES; i++) {
+        Inline_Stack_Push( sv_2mortal( newSVuv( (UV) counts[i] ) ) );
+    }
+
+    Inline_Stack_Done;
+}
+
+SV* _XS_pack_2bit( SV* sv_seq ) {
+    STRLEN len;
+    const char*  seq   = SvPV( sv_seq, len );
+    const size_t bytes = c_dna_packed_size( (size_t) len );
+
+    SV* out = newSV( bytes + 1 );
+    SvPOK_on( out );
+
+    c_dna_pack_2bit( seq, (size_t) len, (uint8_t*) SvPVX( out ) );
+    SvCUR_set( out, bytes );
+    *SvEND( out ) = '\0';
+
+    return out;
+}
+
+SV* _XS_unpack_2bit( SV* sv_bits, UV n ) {
+    STRLEN len;
+    const uint8_t* bits = (const uint8_t*) SvPV( sv_bits, len );
+
+    SV* out = newSV( n + 1 );
+    SvPOK_on( out );
+
+    c_dna_unpack_2bit( bits, (size_t) n, SvPVX( out ) );
+    SvCUR_set( out, n );
+    *SvEND( out ) = '\0';
+
+    return out;
+}
+
+SV* _XS_reverse_complement_2bit( SV* sv_bits, UV n ) {
+    STRLEN len;
+    const uint8_t* bits  = (const uint8_t*) SvPV( sv_bits, len );
+    const size_t   bytes = c_dna_packed_size( (size_t) n );
+
+    SV* out = newSV( bytes + 1 );
+    SvPOK_on( out );
+
+    c_dna_revcomp_2bit( bits, (size_t) n, (uint8_t*) SvPVX( out ) );
+    SvCUR_set( out, bytes );
+    *SvEND( out ) = '\0';
+
+    return out;
+}
+
+END_OF_C_CODE
+
 1;
@@ -46,6 +46,21 @@ sub random_vector {
 	return $self->vector($_[0])->assign( sub { rand } );
 }
 
+# mostly empty data, e.g. k-mer spectra for large k
+sub sparse_vector {
+	my $self = shift;
+
+	require Anorman::Data::Vector::Sparse;
+	return Anorman::Data::Vector::Sparse->new(@_);
+}
+
+sub sparse_matrix {
+	my $self = shift;
+
+	require Anorman::Data::Matrix::Sparse;
+	return Anorman::Data::Matrix::Sparse->new(@_);
+}
+
 sub general_matrix {
 	my $self = shift;
 
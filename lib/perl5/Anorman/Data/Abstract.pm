@@ -57,6 +57,12 @@ sub _clone_self {
 
 sub _set_view  { $_[0]->{'_VIEW'} = 1 }
 
+# Deferred arithmetic, see Anorman::Data::Expression
+sub lazy {
+	require Anorman::Data::Expression;
+	return Anorman::Data::Expression->new( $_[0] );
+}
+
 # Overloaded operations
 sub _sub { my $r = $_[0]->copy; $r->_sub_assign($_[1],$_[2]);$r }
 sub _add { my $r = $_[0]->copy; $r->_add_assign($_[1],$_[2]);$r }
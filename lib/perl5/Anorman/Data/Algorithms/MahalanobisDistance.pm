@@ -73,6 +73,8 @@ sub covariance {
 		$self->{'_n'} = $C->rows;
 	}
 
+	delete $self->{'_LLT'};
+
 	if (is_identity( $C )) {
 		$self->{'_func'} = $VF->EUCLID;
 	} else {	
@@ -81,6 +83,7 @@ sub covariance {
 
 		if ($chol->is_symmetric_positive_definite) {
 			$self->{'_func'} = $VF->MAHALANOBIS( $chol );
+			$self->{'_LLT'}  = $chol->LLT;
 		} else {
 			warn "Matrix was not positive-definite. Trying LU decomposition...\n" if $VERBOSE;
 			my $lu = Anorman::Data::LinAlg::LUDecomposition->new( $C );
@@ -136,4 +139,76 @@ sub get_function {
 	return $_[0]->{'_func'};
 }
 
+sub can_whiten {
+	# true if distances can be computed as euclidean distances between whitened data
+	my $self = shift;
+	return (defined $self->{'_LLT'} || (defined $self->{'covariance'} && is_identity( $self->{'covariance'} )));
+}
+
+sub whiten {
+	# returns a copy of the matrix with every row x replaced by L^-1 x, where LL' is the
+	# covariance matrix. Mahalanobis distances between rows of whitened matrices are
+	# plain euclidean distances, so whitening data and weights once lets any euclidean
+	# bestmatch search stand in for the mahalanobis metric
+	my $self = shift;
+	my $A    = shift;
+
+	check_matrix( $A );
+
+	trace_error("Cannot whiten data: covariance matrix is not positive-definite") unless $self->can_whiten;
+	trace_error("Matrix has the wrong number of columns") if ($A->columns != $self->{'_n'});
+
+	my $W = $A->copy;
+
+	return $W unless defined $self->{'_LLT'};
+
+	if (is_packed( $W ) && is_packed( $self->{'_LLT'} )) {
+		&_XS_whiten( $self->{'_LLT'}, $W );
+	} else {
+		my $L    = $self->{'_LLT'};
+
+		# forward substitution row by row
+		my $i = $W->rows;
+		while ( --$i >= 0 ) {
+			my $row = $W->view_row( $i );
+			my $j   = -1;
+			while ( ++$j < $W->columns ) {
+				my $sum = $row->get_quick( $j );
+				my $k   = -1;
+				while ( ++$k < $j ) {
+					$sum -= $L->get_quick( $j, $k ) * $row->get_quick( $k );
+				}
+				$row->set_quick( $j, $sum / $L->get_quick( $j, $j ) );
+			}
+		}
+	}
+
+	return $W;
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Algorithms::MahalanobisDistance',
+		LIBS      => '-L/usr/local/opt/openblas/lib -L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lopenblas -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include -I/usr/local/opt/openblas/include'
+	   );
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "error.h"
+#include "perl2c.h"
+#include "linalg/mahalanobis.h"
+
+#include "../lib/threads.c"
+#include "../lib/linalg/mahalanobis.c"
+
+void _XS_whiten( SV* sv_LLT, SV* sv_X ) {
+    SV_2STRUCT( sv_LLT, Matrix, LLT );
+    SV_2STRUCT( sv_X, Matrix, X );
+
+    c_mahalanobis_whiten( LLT, X );
+}
+
+END_OF_C_CODE
+
 1;
@@ -12,19 +12,35 @@ use vars qw(@ISA @EXPORT @EXPORT_OK %EXPORT_TAGS);
 	covariance
 	correlation
 	distance
+	column_statistics
+	column_quantiles
+	truncated_pca
 );
 
 %EXPORT_TAGS = ( all => [ @EXPORT_OK ] );
 
 use Anorman::Common;
 use Anorman::Data;
-use Anorman::Data::LinAlg::Property qw( :matrix );
+use Anorman::Data::LinAlg::Property qw( :matrix is_vector );
 use Anorman::Math::VectorFunctions;
+use Anorman::Math::Common;
 
 my $VF = Anorman::Math::VectorFunctions->new;
 
 sub covariance {
-	return &distance( $_[0], $VF->covariance );
+	my $A = shift;
+
+	# packed data is handled by a single dsyrk call
+	if (is_packed( $A )) {
+		my $means = &column_statistics( $A )->{'means'};
+		my $C     = Anorman::Data->matrix( $A->columns, $A->columns );
+
+		&_XS_covariance( $A, $means, $C );
+
+		return $C;
+	}
+
+	return &distance( $A, $VF->covariance );
 }
 
 sub correlation {
@@ -65,4 +81,264 @@ sub distance {
 	return $D;
 }
 
+sub column_statistics {
+	# per-column count, minima, maxima, means and variances in a single pass
+	# over the data. Returns a hash reference with vectors for each statistic
+	my $A = shift;
+
+	check_matrix($A);
+
+	# sparse rows are summarized from their non-zeros alone
+	return $A->column_statistics if $A->isa('Anorman::Data::Matrix::CSR');
+
+	my $M = $A->columns;
+	my $N = $A->rows;
+
+	my %stats = map { $_ => $A->like_vector( $M ) } qw(minima maxima means variances);
+
+	if (is_packed( $A ) && is_vector( $stats{'means'} ) && is_packed( $stats{'means'} )) {
+		&_XS_column_statistics( $A, @stats{ qw/minima maxima means variances/ } );
+	} else {
+		&_PP_column_statistics( $A, @stats{ qw/minima maxima means variances/ } );
+	}
+
+	$stats{'size'} = $N;
+
+	return \%stats;
+}
+
+sub column_quantiles {
+	# approximate quantiles (P-square sketches) of every column.
+	# Returns one vector per requested quantile
+	my $A    = shift;
+	my $phis = shift;
+
+	check_matrix($A);
+	trace_error("Second argument must be an ARRAY reference") unless ref $phis eq 'ARRAY';
+
+	my @quantiles = map { $A->like_vector( $A->columns ) } @{ $phis };
+
+	if (is_packed( $A ) && is_packed( $quantiles[0] )) {
+		&_XS_column_quantiles( $A, $phis, \@quantiles );
+	} else {
+		my $j = $A->columns;
+		while ( --$j >= 0 ) {
+			my @sorted = sort { $a <=> $b } @{ $A->view_column( $j ) };
+			my $k = -1;
+			while ( ++$k < @{ $phis } ) {
+				$quantiles[ $k ]->set_quick( $j, Anorman::Math::Common::quantile( $phis->[ $k ], \@sorted ) );
+			}
+		}
+	}
+
+	return @quantiles;
+}
+
+sub truncated_pca {
+	# top k principal components of the data. Method is either 'eigen' (dsyrk covariance
+	# and a partial dsyevr) or 'randomized' (randomized SVD of the centred data).
+	# Returns a vector of eigenvalues (descending) and a matrix with one eigenvector per column
+	my ($A, $means, $k, $method) = @_;
+
+	check_matrix($A);
+
+	$method = 'eigen' unless defined $method;
+	$means  = &column_statistics( $A )->{'means'} unless defined $means;
+
+	trace_error("Unknown PCA method '$method'") unless ($method eq 'eigen' || $method eq 'randomized');
+	trace_error("Number of components must be between 1 and " . $A->columns) if ($k < 1 || $k > $A->columns);
+	trace_error("Truncated PCA requires packed data") unless is_packed( $A );
+
+	my $values  = $A->like_vector( $k );
+	my $vectors = Anorman::Data->matrix( $A->columns, $k );
+
+	&_XS_truncated_pca( $A, $means, $values, $vectors, $k, $method eq 'randomized' ? 1 : 0 );
+
+	return ($values, $vectors);
+}
+
+sub _PP_column_statistics {
+	# Welford update of all columns, one row at a time
+	my ($A, $minima, $maxima, $means, $variances) = @_;
+
+	my $M = $A->columns;
+	my $N = $A->rows;
+
+	my (@min, @max, @mean, @M2);
+
+	my $i = -1;
+	while ( ++$i < $N ) {
+		my $j = $M;
+		while ( --$j >= 0 ) {
+			my $x = $A->get_quick( $i, $j );
+			my $d = $x - ($mean[ $j ] || 0);
+
+			$mean[ $j ] += $d / ($i + 1);
+			$M2[ $j ]   += $d * ($x - $mean[ $j ]);
+			$min[ $j ]   = $x if (!defined $min[ $j ] || $x < $min[ $j ]);
+			$max[ $j ]   = $x if (!defined $max[ $j ] || $x > $max[ $j ]);
+		}
+	}
+
+	$minima->assign( \@min );
+	$maxima->assign( \@max );
+	$means->assign( \@mean );
+	$variances->assign( [ map { $N > 1 ? $_ / ($N - 1) : 0 } @M2 ] );
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Algorithms::Statistic',
+		LIBS      => '-L/usr/local/opt/openblas/lib -L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lopenblas -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include -I/usr/local/opt/openblas/include'
+	   );
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "perl2c.h"
+#include "threads.h"
+#include "functions/colstats.h"
+#include "linalg/pca.h"
+
+#include "../lib/threads.c"
+#include "../lib/functions/colstats.c"
+#include "../lib/linalg/pca.c"
+
+/* copy a packed vector into a contiguous C array */
+static double* _vector_2doubles( Vector* v ) {
+    double* x;
+    Newx( x, v->size, double );
+
+    size_t i;
+    for (i = 0; i < v->size; i++) {
+        x[ i ] = c_v_get_quick( v, i );
+    }
+
+    return x;
+}
+
+void _XS_column_statistics( SV* sv_A, SV* sv_min, SV* sv_max, SV* sv_mean, SV* sv_var ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+    SV_2STRUCT( sv_min, Vector, minima );
+    SV_2STRUCT( sv_max, Vector, maxima );
+    SV_2STRUCT( sv_mean, Vector, means );
+    SV_2STRUCT( sv_var, Vector, variances );
+
+    ColumnStats* s = c_colstats_alloc( A->columns );
+
+    c_m_column_stats( A, s );
+
+    size_t j;
+    for (j = 0; j < A->columns; j++) {
+        c_v_set_quick( minima, j, s->min[ j ] );
+        c_v_set_quick( maxima, j, s->max[ j ] );
+        c_v_set_quick( means, j, s->mean[ j ] );
+        c_v_set_quick( variances, j, c_colstats_variance( s, j ) );
+    }
+
+    c_colstats_free( s );
+}
+
+void _XS_column_quantiles( SV* sv_A, AV* av_phis, AV* av_quantiles ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+
+    const size_t nphis = (size_t) av_len( av_phis ) + 1;
+
+    if (nphis == 0 || (size_t) av_len( av_quantiles ) + 1 != nphis) {
+        C_ERROR_VOID("Need one result vector per quantile", C_EINVAL );
+    }
+
+    double* phis;
+    double* result;
+
+    Newx( phis, nphis, double );
+    Newx( result, nphis * A->columns, double );
+
+    size_t j, k;
+    for (k = 0; k < nphis; k++) {
+        phis[ k ] = (double) SvNV( *av_fetch( av_phis, k, 0 ) );
+    }
+
+    c_m_column_quantiles( A, phis, nphis, result );
+
+    for (k = 0; k < nphis; k++) {
+        SV_2STRUCT( *av_fetch( av_quantiles, k, 0 ), Vector, q );
+
+        for (j = 0; j < A->columns; j++) {
+            c_v_set_quick( q, j, result[ j * nphis + k ] );
+        }
+    }
+
+    Safefree( phis );
+    Safefree( result );
+}
+
+void _XS_covariance( SV* sv_A, SV* sv_means, SV* sv_C ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+    SV_2STRUCT( sv_means, Vector, mv );
+    SV_2STRUCT( sv_C, Matrix, C );
+
+    const size_t M = A->columns;
+
+    if (C->rows != M || C->columns != M || mv->size != M) {
+        C_ERROR_VOID("Covariance matrix must be square with the same dimension as the data", C_EBADLEN );
+    }
+
+    double* means = _vector_2doubles( mv );
+    double* cov;
+    Newx( cov, M * M, double );
+
+    c_pca_covariance( A, means, cov );
+
+    size_t i, j;
+    for (i = 0; i < M; i++) {
+        for (j = 0; j < M; j++) {
+            c_m_set_quick( C, i, j, cov[ i * M + j ] );
+        }
+    }
+
+    Safefree( means );
+    Safefree( cov );
+}
+
+void _XS_truncated_pca( SV* sv_A, SV* sv_means, SV* sv_values, SV* sv_vectors, UV k, IV method ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+    SV_2STRUCT( sv_means, Vector, mv );
+    SV_2STRUCT( sv_values, Vector, values );
+    SV_2STRUCT( sv_vectors, Matrix, vectors );
+
+    const size_t M = A->columns;
+
+    if (mv->size != M || values->size != k || vectors->rows != M || vectors->columns != k) {
+        C_ERROR_VOID("Result dimensions do not match data", C_EBADLEN );
+    }
+
+    double* means = _vector_2doubles( mv );
+    double* evals;
+    double* evecs;
+
+    Newx( evals, k, double );
+    Newx( evecs, M * k, double );
+
+    c_pca_truncated( A, means, (size_t) k, (int) method, evals, evecs );
+
+    size_t i, j;
+    for (j = 0; j < k; j++) {
+        c_v_set_quick( values, j, evals[ j ] );
+
+        for (i = 0; i < M; i++) {
+            c_m_set_quick( vectors, i, j, evecs[ i * k + j ] );
+        }
+    }
+
+    Safefree( means );
+    Safefree( evals );
+    Safefree( evecs );
+}
+
+END_OF_C_CODE
+
 1;
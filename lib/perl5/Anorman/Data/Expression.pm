@@ -0,0 +1,362 @@
+package Anorman::Data::Expression;
+
+# Deferred elementwise arithmetic on vectors and matrices.
+#
+# $v->lazy wraps a vector or matrix in an expression leaf. The usual
+# operators on expressions build a tree instead of computing anything:
+#
+#	$x->assign( ($x->lazy - $mean) / $sd );
+#	$sum += $a->lazy * $b;
+#	my $z = (($x->lazy - $mu) * $w)->eval;
+#
+# Assignment, an op-assignment or an explicit eval then runs the whole
+# tree as one fused native loop when all operands are packed, without
+# allocating intermediate results. Anything else is evaluated with the
+# ordinary overloaded operators.
+#
+# Counts keeps its tables as plain perl arrays and Descriptives only maps
+# single functions over its vectors, so neither has expressions to fuse;
+# the scripts reach this through Vector and Matrix normalize/ztrans
+
+use strict;
+use warnings;
+
+use Anorman::Common qw(trace_error);
+use Anorman::Data::LinAlg::Property qw(is_packed is_vector is_matrix is_expression);
+
+use Scalar::Util qw(blessed refaddr looks_like_number);
+
+use overload
+	'+'    => '_add',
+	'-'    => '_sub',
+	'*'    => '_mul',
+	'/'    => '_div',
+	'neg'  => '_neg',
+	'""'   => '_to_string',
+	'0+'   => '_numify',
+	'bool' => sub { 1 };
+
+# opcodes of the native program, see expression.h
+my %OPCODE = (
+	'leaf'  => 0,
+	'const' => 1,
+	'+'     => 2,
+	'-'     => 3,
+	'*'     => 4,
+	'/'     => 5,
+	'neg'   => 6
+);
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+	my $data  = shift;
+
+	trace_error("Can only defer vectors and matrices") unless (is_vector($data) || is_matrix($data));
+
+	return bless ( { _OP => 'leaf', _DATA => $data }, $class );
+}
+
+sub eval {
+	my $self   = shift;
+	my $result = $self->_template->like;
+
+	$self->_eval_into( $result );
+
+	return $result;
+}
+
+# Operator overloading
+sub _add { _binary( '+', @_ ) }
+sub _sub { _binary( '-', @_ ) }
+sub _mul { _binary( '*', @_ ) }
+sub _div { _binary( '/', @_ ) }
+
+sub _neg {
+	my $self = shift;
+	return bless ( { _OP => 'neg', _ARGS => [ $self ] }, ref $self );
+}
+
+sub _numify {
+	trace_error("Deferred expression used as a number. Call ->eval or assign it first");
+}
+
+sub _binary {
+	my ($op, $self, $other, $swap) = @_;
+
+	my ($l, $r) = $swap ? (_wrap( $other ), $self) : ($self, _wrap( $other ));
+
+	return bless ( { _OP => $op, _ARGS => [ $l, $r ] }, ref $self );
+}
+
+sub _wrap {
+	my $x = shift;
+
+	return $x if is_expression($x);
+	return __PACKAGE__->new($x) if (is_vector($x) || is_matrix($x));
+	return bless ( { _OP => 'const', _VALUE => $x }, __PACKAGE__ ) if looks_like_number($x);
+
+	trace_error("Illegal operand in expression");
+}
+
+sub _to_string {
+	my $self = shift;
+	my $op   = $self->{'_OP'};
+
+	return 'x' . refaddr( $self->{'_DATA'} ) if $op eq 'leaf';
+	return $self->{'_VALUE'} if $op eq 'const';
+	return '-' . $self->{'_ARGS'}->[0]->_to_string if $op eq 'neg';
+
+	return '(' . $self->{'_ARGS'}->[0]->_to_string . " $op " . $self->{'_ARGS'}->[1]->_to_string . ')';
+}
+
+# all vectors and matrices in the tree, left to right
+sub _leaves {
+	my $self = shift;
+	my $op   = $self->{'_OP'};
+
+	return ( $self->{'_DATA'} ) if $op eq 'leaf';
+	return () if $op eq 'const';
+	return map { $_->_leaves } @{ $self->{'_ARGS'} };
+}
+
+sub _template {
+	my $self = shift;
+	my ($template) = $self->_leaves;
+
+	trace_error("Expression does not contain a vector or matrix") unless defined $template;
+
+	return $template;
+}
+
+# $target op= $self, called from the op-assign methods of the data classes
+sub _assign_op {
+	my ($self, $target, $op) = @_;
+
+	trace_error("Illegal operator $op") unless exists $OPCODE{ $op };
+
+	my $tree = bless ( { _OP => $op, _ARGS => [ __PACKAGE__->new($target), $self ] }, ref $self );
+
+	return $tree->_eval_into( $target );
+}
+
+sub _eval_into {
+	my ($self, $target) = @_;
+	my @leaves = $self->_leaves;
+	my $kind   = is_matrix($target) ? \&is_matrix : \&is_vector;
+
+	# fall back to plain operators unless everything is packed and alike
+	if (!is_packed($target) || grep { !is_packed($_) || !$kind->($_) } @leaves) {
+		$target->assign( $self->_eval_eager );
+		return $target;
+	}
+
+	foreach my $leaf (@leaves) {
+		if (is_matrix($target)) {
+			$target->check_shape( $leaf );
+		} else {
+			$target->_check_size( $leaf );
+		}
+
+		# blocks of the target are written while later blocks of an
+		# overlapping operand are still to be read
+		next if refaddr($leaf) == refaddr($target);
+
+		if ($target->_have_shared_cells( $leaf )) {
+			my $tmp = $target->like;
+			$self->_eval_into( $tmp );
+			$target->assign( $tmp );
+			return $target;
+		}
+	}
+
+	my ($program, $operands, $constants) = $self->_compile;
+
+	if (is_matrix($target)) {
+		_XS_eval_matrix( $program, $operands, $constants, $target );
+	} else {
+		_XS_eval_vector( $program, $operands, $constants, $target );
+	}
+
+	return $target;
+}
+
+# flatten the tree to a postfix program of (opcode, argument) pairs
+sub _compile {
+	my $self = shift;
+
+	my (@program, @operands, @constants, %seen);
+
+	my $emit;
+	$emit = sub {
+		my $node = shift;
+		my $op   = $node->{'_OP'};
+
+		if ($op eq 'leaf') {
+			my $addr = refaddr( $node->{'_DATA'} );
+
+			unless (exists $seen{ $addr }) {
+				$seen{ $addr } = scalar @operands;
+				push @operands, $node->{'_DATA'};
+			}
+
+			push @program, $OPCODE{'leaf'}, $seen{ $addr };
+		} elsif ($op eq 'const') {
+			push @program, $OPCODE{'const'}, scalar @constants;
+			push @constants, $node->{'_VALUE'};
+		} else {
+			$emit->( $_ ) foreach @{ $node->{'_ARGS'} };
+			push @program, $OPCODE{ $op }, 0;
+		}
+	};
+
+	$emit->( $self );
+	undef $emit;
+
+	return (\@program, \@operands, \@constants);
+}
+
+# evaluate with the overloaded operators of the data classes
+sub _eval_eager {
+	my $self = shift;
+	my $op   = $self->{'_OP'};
+
+	return $self->{'_DATA'}  if $op eq 'leaf';
+	return $self->{'_VALUE'} if $op eq 'const';
+
+	my @args = map { $_->_eval_eager } @{ $self->{'_ARGS'} };
+
+	if ($op eq 'neg') {
+		return ref $args[0] ? $args[0] * -1 : -$args[0];
+	}
+
+	my ($l, $r) = @args;
+
+	# scalar on the left of a non-commutative operator
+	if (!ref $l && ref $r) {
+		return $r + $l if $op eq '+';
+		return $r * $l if $op eq '*';
+		return $r->copy->assign( sub { $l - $_[0] } ) if $op eq '-';
+		return $r->copy->assign( sub { $l / $_[0] } );
+	}
+
+	return $l + $r if $op eq '+';
+	return $l - $r if $op eq '-';
+	return $l * $r if $op eq '*';
+	return $l / $r;
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Expression',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "expression.h"
+
+#include "../lib/expression.c"
+
+static ExprInstr* _av_2program( AV* av, size_t* n ) {
+    const size_t N = (size_t) (av_len( av ) + 1) / 2;
+
+    ExprInstr* prog;
+    Newx( prog, N, ExprInstr );
+
+    size_t i;
+    for (i = 0; i < N; i++) {
+        prog[ i ].op  = (int)    SvIV( *av_fetch( av, 2 * i, 0 ) );
+        prog[ i ].arg = (size_t) SvUV( *av_fetch( av, 2 * i + 1, 0 ) );
+    }
+
+    *n = N;
+
+    return prog;
+}
+
+static double* _av_2constants( AV* av ) {
+    const size_t N = (size_t) (av_len( av ) + 1);
+
+    double* c;
+    Newx( c, N + 1, double );
+
+    size_t i;
+    for (i = 0; i < N; i++) {
+        c[ i ] = SvNV( *av_fetch( av, i, 0 ) );
+    }
+
+    return c;
+}
+
+void _XS_eval_vector( AV* av_prog, AV* av_operands, AV* av_constants, SV* sv_dst ) {
+    SV_2STRUCT( sv_dst, Vector, dst );
+
+    size_t n_instr;
+    const size_t n_operands = (size_t) (av_len( av_operands ) + 1);
+
+    ExprInstr* prog      = _av_2program( av_prog, &n_instr );
+    double*    constants = _av_2constants( av_constants );
+
+    Vector** operands;
+    Newx( operands, n_operands + 1, Vector* );
+
+    size_t i;
+    for (i = 0; i < n_operands; i++) {
+        SV* sv_v = *av_fetch( av_operands, i, 0 );
+        SV_2STRUCT( sv_v, Vector, v );
+        operands[ i ] = v;
+    }
+
+    const int status = c_expr_eval_vector( prog, n_instr, operands, n_operands,
+                                           constants, (size_t) (av_len( av_constants ) + 1), dst );
+
+    Safefree( prog );
+    Safefree( constants );
+    Safefree( operands );
+
+    if (status != C_SUCCESS) {
+        croak("Expression evaluation failed");
+    }
+}
+
+void _XS_eval_matrix( AV* av_prog, AV* av_operands, AV* av_constants, SV* sv_dst ) {
+    SV_2STRUCT( sv_dst, Matrix, dst );
+
+    size_t n_instr;
+    const size_t n_operands = (size_t) (av_len( av_operands ) + 1);
+
+    ExprInstr* prog      = _av_2program( av_prog, &n_instr );
+    double*    constants = _av_2constants( av_constants );
+
+    Matrix** operands;
+    Newx( operands, n_operands + 1, Matrix* );
+
+    size_t i;
+    for (i = 0; i < n_operands; i++) {
+        SV* sv_m = *av_fetch( av_operands, i, 0 );
+        SV_2STRUCT( sv_m, Matrix, m );
+        operands[ i ] = m;
+    }
+
+    const int status = c_expr_eval_matrix( prog, n_instr, operands, n_operands,
+                                           constants, (size_t) (av_len( av_constants ) + 1), dst );
+
+    Safefree( prog );
+    Safefree( constants );
+    Safefree( operands );
+
+    if (status != C_SUCCESS) {
+        croak("Expression evaluation failed");
+    }
+}
+
+END_OF_C_CODE
+
+1;
@@ -15,7 +15,7 @@ use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::Data::Functions::VectorVector',
 		ENABLE    => AUTOWRAP =>
-		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -lvector',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -lvector -landata',
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
 	   );
 use Inline C => <<'END_OF_C_CODE';
@@ -25,9 +25,11 @@ use Inline C => <<'END_OF_C_CODE';
 #include "vector.h"
 #include "functions/vector.h"
 #include "functions/vectorvector.h"
+#include "functions/kernels.h"
 
 #include "../lib/vector.c"
 #include "../lib/functions/functions.c"
+#include "../lib/functions/kernels.c"
 #include "../lib/functions/vector.c"
 #include "../lib/functions/vectorvector.c"
 
@@ -8,6 +8,7 @@ use Anorman::Data;
 use Anorman::Data::LinAlg::Property qw( :all );
 use Anorman::Data::LinAlg::BLAS qw( :L1 :L2 );
 use Anorman::Data::LinAlg::CBLAS;
+use Anorman::Data::LinAlg::LAPACK;
 use Anorman::Math::Common qw(quiet_sqrt);
 
 use List::Util qw(max);
@@ -33,6 +34,18 @@ sub decompose {
 	check_matrix($A);
 	check_square($A);
 
+	if (is_packed($A)) {
+		# LAPACK dpotrf. Factors are stored as below, L and its transpose
+		my $LLT  = $A->copy;
+		my $info = XS_call_lapack_potrf( $LLT );
+
+		$self->{'_is_symmetric_positive_definite'} = ($info == 0);
+		$self->{'_LLT'} = $LLT;
+
+		return $LLT if $info == 0;
+		return;
+	}
+
 	my ($i,$j,$k);
 	my $M = $A->rows;
 	my $LLT = $A->copy;
@@ -6,6 +6,7 @@ use Anorman::Common;
 use Anorman::Math::Common;
 use Anorman::Data;
 use Anorman::Data::LinAlg::Property qw( :matrix );
+use Anorman::Data::LinAlg::LAPACK;
 
 use List::Util qw(max);
 
@@ -22,6 +23,23 @@ sub new {
 	
 	my $n = $A->rows;
 
+	if (is_packed($A) && is_symmetric($A)) {
+		# LAPACK dsyevd. Eigenvalues are ascending, as from the QL iterations
+		my $d = $A->like_vector( $n );
+		my $V = $A->like( $n, $n );
+
+		my $info = XS_call_lapack_syevd( $A, $d, $V );
+		trace_error("Eigenvalue decomposition did not converge") if $info > 0;
+
+		$self->{'_n'}      = $n;
+		$self->{'_native'} = 1;
+		$self->{'_V'}      = $V;
+		$self->{'_d'}      = $d;
+		$self->{'_e'}      = [ (0) x $n ];
+
+		return $self;
+	}
+
 	# set up internals
 	$self->{'_n'}                      = $n;
 	$self->{'_V'}->[ $n - 1][ $n - 1 ] = undef;
@@ -88,11 +106,13 @@ sub getD {
 
 sub getV {
 	my $self = shift;
+	return $self->{'_V'}->copy if $self->{'_native'};
 	return Anorman::Data->matrix($self->{'_V'});
 }
 
 sub getRealEigenvalues {
 	my $self = shift;
+	return $self->{'_d'}->copy if $self->{'_native'};
 	return Anorman::Data->vector($self->{'_d'});
 }
 
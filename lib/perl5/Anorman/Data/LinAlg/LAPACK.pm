@@ -0,0 +1,108 @@
+package Anorman::Data::LinAlg::LAPACK;
+
+use strict;
+use warnings;
+
+# Native LAPACK backends for the decompositions in Data::LinAlg.
+# All functions work on packed matrices and return the LAPACK info
+# code, which is positive when the factorization broke down
+# numerically (e.g. matrix not positive definite)
+
+use Anorman::Common;
+use Exporter;
+
+our (@ISA, @EXPORT_OK, @EXPORT);
+
+@ISA = qw(Exporter);
+
+@EXPORT_OK = qw(
+    XS_call_lapack_potrf
+    XS_call_lapack_getrf
+    XS_call_lapack_geqrf
+    XS_call_lapack_syevd
+    XS_call_lapack_gesdd
+);
+
+@EXPORT = @EXPORT_OK;
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::LinAlg::LAPACK',
+		INC  => '-I' . $Anorman::Common::AN_SRC_DIR . '/include -I/usr/local/opt/openblas/include',
+		LIBS => '-L/usr/local/opt/openblas/lib -L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -lopenblas -landata'
+
+           );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+
+#include "linalg/decomp.h"
+
+#include "../lib/linalg/decomp.c"
+
+int
+XS_call_lapack_potrf( SV* sv_A ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+
+    return c_linalg_cholesky( A );
+}
+
+IV
+XS_call_lapack_getrf( SV* sv_A, AV* av_perm ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+
+    const size_t N = A->rows;
+
+    size_t* perm;
+    int     signum;
+
+    Newx( perm, N, size_t );
+
+    c_linalg_lu( A, perm, &signum );
+
+    av_clear( av_perm );
+    av_extend( av_perm, N );
+
+    size_t i;
+    for (i = 0; i < N; i++) {
+        av_store( av_perm, i, newSVuv( perm[ i ] ) );
+    }
+
+    Safefree( perm );
+
+    return (IV) signum;
+}
+
+int
+XS_call_lapack_geqrf( SV* sv_A, SV* sv_tau ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+    SV_2STRUCT( sv_tau, Vector, tau );
+
+    return c_linalg_qr( A, tau );
+}
+
+int
+XS_call_lapack_syevd( SV* sv_A, SV* sv_eval, SV* sv_V ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+    SV_2STRUCT( sv_eval, Vector, eval );
+    SV_2STRUCT( sv_V, Matrix, V );
+
+    return c_linalg_symm_eigen( A, eval, V );
+}
+
+int
+XS_call_lapack_gesdd( SV* sv_A, SV* sv_S, SV* sv_U, SV* sv_V ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+    SV_2STRUCT( sv_S, Vector, S );
+    SV_2STRUCT( sv_U, Matrix, U );
+    SV_2STRUCT( sv_V, Matrix, V );
+
+    return c_linalg_svd( A, S, U, V );
+}
+
+END_OF_C_CODE
+
+1;
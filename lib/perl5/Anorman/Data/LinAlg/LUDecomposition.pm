@@ -7,6 +7,7 @@ use Anorman::Common;
 use Anorman::Data;
 use Anorman::Data::LinAlg::BLAS qw ( :L2 blas_axpy );
 use Anorman::Data::LinAlg::CBLAS;
+use Anorman::Data::LinAlg::LAPACK;
 use Anorman::Data::LinAlg::Property qw( :all );
 use Anorman::Data::LinAlg::Algebra qw( permute_rows );
 use List::Util qw(min max);
@@ -32,6 +33,18 @@ sub decompose {
 	my $N  = $A->rows;
 	my $LU = $A->copy;
 
+	if (is_packed($A)) {
+		# LAPACK dgetrf
+		my $p = [];
+
+		$self->{'pivsign'}  = XS_call_lapack_getrf( $LU, $p );
+		$self->{'piv'}      = $p;
+		$self->{'singular'} = $self->singular($LU);
+		$self->{'LU'}       = $LU;
+
+		return $LU;
+	}
+
 	my $signum = 1;
 	my $p      = [(0 .. $N - 1)];
 
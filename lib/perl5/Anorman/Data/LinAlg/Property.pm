@@ -20,6 +20,7 @@ use vars qw(@ISA @EXPORT @EXPORT_OK %EXPORT_TAGS);
 	check_rectangular
 	check_square
 	check_vector
+	is_expression
 	is_packed
 	is_identity
 	is_diagonal
@@ -27,6 +28,7 @@ use vars qw(@ISA @EXPORT @EXPORT_OK %EXPORT_TAGS);
 	is_square
 	is_singular
 	is_diagonal
+	is_sparse
 	is_symmetric
 	is_vector
 	matrix_equals_matrix
@@ -35,8 +37,8 @@ use vars qw(@ISA @EXPORT @EXPORT_OK %EXPORT_TAGS);
 	vector_equals_value
 );
  
-%EXPORT_TAGS = ( vector => [ qw(is_packed is_vector check_vector vector_equals_vector vector_equals_value) ],
-                 matrix => [ qw(is_packed is_matrix is_symmetric is_diagonal is_square is_singular is_diagonal is_identity
+%EXPORT_TAGS = ( vector => [ qw(is_packed is_vector is_expression check_vector vector_equals_vector vector_equals_value) ],
+                 matrix => [ qw(is_packed is_matrix is_expression is_symmetric is_diagonal is_square is_singular is_diagonal is_identity
                              check_matrix check_rectangular check_square matrix_equals_matrix matrix_equals_value) ],
 		 all => [ @EXPORT_OK ] );
 
@@ -255,6 +257,11 @@ sub is_packed {
 	return $class =~ m/Anorman::Data::\w+::\w+Packed/;
 }
 
+sub is_sparse {
+	return undef unless defined (my $class = blessed($_[0]));
+	return $class =~ m/Anorman::Data::\w+::(?:Sparse|CSR)$/;
+}
+
 sub is_matrix {
 	return undef unless defined (my $class = blessed($_[0]));
 	return $class->isa('Anorman::Data::Matrix'); 
@@ -265,6 +272,11 @@ sub is_vector {
 	return $class->isa('Anorman::Data::Vector');
 }
 
+sub is_expression {
+	return undef unless defined (my $class = blessed($_[0]));
+	return $class->isa('Anorman::Data::Expression');
+}
+
 sub check_vector {
 	trace_error("Not a vector") unless &is_vector( $_[0] );
 }
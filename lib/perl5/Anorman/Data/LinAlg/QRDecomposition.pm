@@ -8,6 +8,7 @@ use Anorman::Data;
 use Anorman::Data::LinAlg::BLAS qw( :L2 );
 use Anorman::Data::LinAlg::Property qw( :all );
 use Anorman::Data::LinAlg::Householder qw( :all );
+use Anorman::Data::LinAlg::LAPACK;
 use Anorman::Math::Common qw(hypot);
 
 use List::Util qw(min);
@@ -89,6 +90,16 @@ sub decompose {
 	my $tau = $A->like_vector($n);
 	my $QR  = $A->copy;
 
+	if (is_packed($A)) {
+		# LAPACK dgeqrf uses the same Householder representation
+		XS_call_lapack_geqrf( $QR, $tau );
+
+		$self->{'_QR'}  = $QR;
+		$self->{'_tau'} = $tau;
+
+		return;
+	}
+
 	my $i = -1;
 	while ( ++$i < $n ) {
 
@@ -5,6 +5,7 @@ use warnings;
 
 use Anorman::Common;
 use Anorman::Data::LinAlg::Property qw( :matrix );
+use Anorman::Data::LinAlg::LAPACK;
 use Anorman::Math::Common qw(hypot);
 
 use List::Util qw(min max);
@@ -19,6 +20,8 @@ sub new {
 	check_matrix($_[0]);
 	check_rectangular($_[0]);
 
+	return $class->_new_lapack($_[0]) if is_packed($_[0]);
+
 	# convert matrix to 2D array
 	my $A = \@{ $_[0] };	
 
@@ -519,6 +522,34 @@ sub new {
 
 }
 
+sub _new_lapack {
+	# LAPACK dgesdd (divide and conquer), thin U and V
+	my $class = shift;
+	my $A     = shift;
+
+	my $m  = $A->rows;
+	my $n  = $A->columns;
+	my $nu = min($m,$n);
+
+	my $S = $A->like_vector( $nu );
+	my $U = $A->like( $m, $nu );
+	my $V = $A->like( $n, $nu );
+
+	my $info = XS_call_lapack_gesdd( $A, $S, $U, $V );
+	trace_error("Singular value decomposition did not converge") if $info > 0;
+
+	my $self = {
+		'_U'      => $U,
+		'_V'      => $V,
+		'_s'      => [ @{ $S } ],
+		'_m'      => $m,
+		'_n'      => $n,
+		'_native' => 1
+	};
+
+	return bless ( $self, ref $class || $class );
+}
+
 sub cond {
 	my $self = shift;
 	my $s    = $self->{'_s'};
@@ -553,12 +584,14 @@ sub singular_values {
 sub U {
 	my $self = shift;
 
+	return $self->{'_U'}->copy if $self->{'_native'};
 	return Anorman::Data->matrix( $self->{'_U'} )->view_part(0,0,$self->{'_m'}, min( $self->{'_m'} + 1, $self->{'_n'}) );
 }
 
 sub V {
 	my $self = shift;
 
+	return $self->{'_V'}->copy if $self->{'_native'};
 	return Anorman::Data->matrix($self->{'_V'});
 }
 
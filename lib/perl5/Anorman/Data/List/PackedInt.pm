@@ -1,143 +1,305 @@
 package Anorman::Data::List::PackedInt;
 
-use Inline (C => Config =>
-		DIRECTORY => '/home/anorman/tmp',
-		NAME      => 'Anorman::Data::List::PackedInt',
-		ENABLE    => AUTOWRAP =>
-		LIBS      => '-L/home/anorman/src/anorman/lib -lvector',
-		INC       => '-I/home/anorman/src/anorman/include'
-	   );
-use Inline C => <<'END_OF_C_CODE';
+# A growable list of native integers (src/anorman/lib/intlist.c). Cells
+# are int32 (default), int64 or uint32, so a list of a few million row
+# indexes takes megabytes rather than the hundreds of megabytes of a
+# Perl array. Follows the interface of Anorman::Data::List:
+#
+#	my $bm = Anorman::Data::List::PackedInt->new( $rows );
+#	$bm->set( $i, $neuron );
+#
+#	my $perm = Anorman::Data::List::PackedInt->range( 0, $rows, 'uint32' );
+#	$perm->shuffle( $seed, $epoch );
+#
+# index_of and contains scan the list unless use_index(1) was called,
+# which keeps a native value -> position hash alongside
+
+use strict;
+use warnings;
+
+use Anorman::Common qw(trace_error);
+
+use overload
+	'""'  => '_stringify';
+
+my %TYPES = (
+	'int32'  => 0,
+	'int64'  => 1,
+	'uint32' => 2
+);
+
+# pack templates matching the cell layout
+my @PACK_TEMPLATE = ( 'l', 'q', 'L' );
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+	my $init  = shift;
+	my $type  = _type_code( shift );
+
+	if (ref $init eq 'ARRAY') {
+		my $self = _XS_new( $class, $type, scalar @{ $init } );
+		$self->_XS_assign_packed( pack( $PACK_TEMPLATE[ $type ] . '*', @{ $init } ) );
+		return $self;
+	}
+
+	my $self = _XS_new( $class, $type, $init || 0 );
+	$self->resize( $init ) if $init;
+
+	return $self;
+}
 
-#include "data.h"
+# $n consecutive values starting at $from
+sub range {
+	my ($that, $from, $n, $type) = @_;
 
-#define SV_2LIST( sv, ptr_name )    IntList* ptr_name = (IntList*) SvIV( SvRV( sv ) )
+	my $self = $that->new( undef, $type );
+	$self->_XS_fill_range( $from, $n );
 
+	return $self;
+}
 
-#define SVADDR_2PTR( sv_name, ptr_name )            \
-     UV ptr_name = INT2PTR( char*, SvUV( sv_name ) ) 
+sub from_packed {
+	my ($that, $string, $type) = @_;
 
-#define PTR_2SVADDR( ptr_name, sv_name )        \
-    SV* sv_name = newSVuv( PTR2UV( ptr_name ) )
+	my $self = $that->new( undef, $type );
+	$self->assign_packed( $string );
 
-#define ELEMS_BEG( ptr_name, x )               \
-    int* ptr_name =  (int *) x->elements     \
+	return $self;
+}
 
-#define ALLOC_ELEMS( slots, sv_name )          \
-    char* _ELEMS;                              \
-    Newxc( _ELEMS, slots, int, char* );     \
-    SV* sv_name = newSVuv(PTR2UV( _ELEMS ))    \
+sub type {
+	my $code = $_[0]->_type;
+	my ($name) = grep { $TYPES{ $_ } == $code } keys %TYPES;
+	return $name;
+}
 
-SV* _alloc_elements( SV*, UV );
+sub get {
+	my $self = shift;
+	$self->_check_index( $_[0] );
+	return $self->get_quick( $_[0] );
+}
+
+sub set {
+	my $self = shift;
+	$self->_check_index( $_[0] );
+	$self->set_quick( $_[0], $_[1] );
+}
+
+sub add {
+	my $self = shift;
+	$self->push_quick( $_ ) foreach @_;
+}
 
-SV*  _get_elements_addr( SV* );
-void _set_elements_addr( SV*, SV* );
+sub push { shift->add(@_) }
 
-/* object constructor */
-SV* new( SV* sv_class_name,...) {
+sub pop {
+	my $self = shift;
+	return undef if $self->size == 0;
+	return $self->_XS_pop;
+}
 
-    Inline_Stack_Vars;
-    IntList* l;
+sub contains {
+	return $_[0]->index_of( $_[1] ) >= 0;
+}
 
-     /* set up object variables */
-    char* class_name = SvPV_nolen( sv_class_name );
-    SV*   self       = newSViv(0);
-    SV*   obj        = newSVrv( self, class_name );
+# in place Fisher-Yates. The same seed and stream (see
+# Anorman::Math::Random) give the same permutation
+sub shuffle {
+	my $self   = shift;
+	my $seed   = defined $_[0] ? $_[0] : int( rand( 2**32 ) );
+	my $stream = defined $_[1] ? $_[1] : 0;
 
-    /* allocate struct memory */
-    Newxz(l, 1, IntList);
+	$self->_XS_shuffle( $seed, $stream );
+}
 
-    /* set object address */
-    sv_setiv( obj, (IV)v);
-    SvREADONLY_on( obj );
+# the cells as a native-endian binary string and back
+sub to_packed     { $_[0]->_XS_to_packed }
+sub assign_packed { $_[0]->_XS_assign_packed( $_[1] ) }
+
+sub to_array {
+	my $self = shift;
+	return [ unpack( $PACK_TEMPLATE[ $self->_type ] . '*', $self->_XS_to_packed ) ];
+}
+
+sub _type_code {
+	my $type = shift;
+
+	return 0 unless defined $type;
+	trace_error("Unknown integer type $type") unless exists $TYPES{ $type };
+
+	return $TYPES{ $type };
+}
+
+sub _check_index {
+	if ($_[1] < 0 || $_[1] >= $_[0]->size) {
+		trace_error("List index $_[1] out of bounds");
+	}
+}
+
+sub _stringify {
+	my $self = shift;
+	return "{" . join (",", @{ $self->to_array }) . "}";
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::List::PackedInt',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lm -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
 
-    size_t initial_capacity;
-    
-    if (Inline_Stack_Items > 1) {
-        initial_capacity = (size_t) SvIV( Inline_Stack_Item(1) );
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "threads.h"
+#include "rng.h"
+#include "intlist.h"
+
+#include "../lib/threads.c"
+#include "../lib/rng.c"
+#include "../lib/intlist.c"
+
+SV* _XS_new( SV* sv_class_name, IV type, UV capacity ) {
+    IntList* l = c_il_alloc( (int) type, (size_t) capacity );
+    SV* self;
+
+    if (l == NULL) {
+        croak("Could not create integer list");
     }
 
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( l, self, class_name );
+
     return self;
 }
 
+SV* copy( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+
+    IntList* n = c_il_copy( l );
+    SV* copy;
+
+    if (n == NULL) {
+        croak("Could not copy integer list");
+    }
 
-/* object accessors */
-IV size(SV* self) {
-    return (UV) ((List*)SvIV(SvRV(self)))->size;
+    const char* class_name = sv_reftype( SvRV( self ), TRUE );
+    BLESS_STRUCT( n, copy, class_name );
+
+    return copy;
 }
 
+UV size( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+    return (UV) l->size;
+}
 
-NV get_quick(SV* self, IV index) {
+UV capacity( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+    return (UV) l->capacity;
+}
 
-    SV_2VECTOR( self, v );
-    
-    return (NV) c_v_get_quick( v, (int) index );
+IV _type( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+    return (IV) l->type;
 }
 
-void set_quick(SV* self, IV index, NV value) {
- 
-    SV_2VECTOR( self, v );
+IV get_quick( SV* self, UV index ) {
+    SV_2STRUCT( self, IntList, l );
+    return (IV) c_il_get( l, (size_t) index );
+}
 
-    c_v_set_quick( v, (int)index, (double)value );
+void set_quick( SV* self, UV index, IV value ) {
+    SV_2STRUCT( self, IntList, l );
+    c_il_set( l, (size_t) index, (int64_t) value );
 }
 
-/* elements pointer address manipulation */
-SV* _get_elements_addr (SV* self) {
+void push_quick( SV* self, IV value ) {
+    SV_2STRUCT( self, IntList, l );
 
-    SV_2VECTOR( self, v );
-    PTR_2SVADDR( v->elements, sv_addr );
+    if (c_il_push( l, (int64_t) value ) != C_SUCCESS) {
+        croak("Could not grow integer list");
+    }
+}
 
-    return sv_addr;
+IV _XS_pop( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+    return (IV) c_il_pop( l );
 }
 
-void _set_elements_addr (SV* self, SV* sv_addr ) {
+void clear( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+    c_il_clear( l );
+}
 
-    SVADDR_2PTR( sv_addr, elems_ptr );
-    SV_2VECTOR( self, v );
+void resize( SV* self, UV size ) {
+    SV_2STRUCT( self, IntList, l );
 
-    /* some sanity checls */
-    if (v->elements == 0) {
-        v->elements = (char*) elems_ptr;
-    } else if (&elems_ptr == (*v->elements) ) {
-        PerlIO_printf( PerlIO_stderr(), "Elements pointer is already assigned to this address (%)x\n", &elems_ptr );
-    } else {
-        PerlIO_printf( PerlIO_stderr(), "Cannot assign (%x) to an already assigned pointer (%p)\n", elems_ptr, (*v->elements) );
-    }   
+    if (c_il_resize( l, (size_t) size ) != C_SUCCESS) {
+        croak("Could not resize integer list");
+    }
 }
 
-/* object destruction */
-void DESTROY(SV* self) {
-    SV_2LIST( self, v );
+void reserve( SV* self, UV capacity ) {
+    SV_2STRUCT( self, IntList, l );
 
-    if (v == NULL) {
-        PerlIO_printf( PerlIO_stderr(), "Struct was NULL!\n" );
+    if (c_il_reserve( l, (size_t) capacity ) != C_SUCCESS) {
+        croak("Could not grow integer list");
     }
-    /* do not free matrix elements unless object
-       is not in view mode                       */
-    if (v->elements != NULL && v->view_flag != TRUE) {
-        Safefree( v->elements );
+}
+
+void _XS_fill_range( SV* self, IV from, UV n ) {
+    SV_2STRUCT( self, IntList, l );
+
+    if (c_il_fill_range( l, (int64_t) from, (size_t) n ) != C_SUCCESS) {
+        croak("Could not grow integer list");
     }
-    
-    Safefree( v );
-}
-
-/* DEBUGGING */
-void show_struct( IntList* l ) {
-    
-    PerlIO_printf( PerlIO_stderr(), "\nContents of Vector struct:\n" );
-    PerlIO_printf( PerlIO_stderr(), "\tsize\t(%p): %d\n", &v->size, (int) v->size );
-    PerlIO_printf( PerlIO_stderr(), "\tview\t(%p): %d\n", &v->view_flag, (int) v->view_flag );
-    PerlIO_printf( PerlIO_stderr(), "\t0\t(%p): %d\n",  &v->zero, v->zero );
-    PerlIO_printf( PerlIO_stderr(), "\tstride\t(%p): %d\n", &v->stride, v->stride );
-
-    if (v->elements == NULL) {
-        PerlIO_printf( PerlIO_stderr(), "\telems\t(%p): null\n\n",  &v->elements );
-    } else {
-        PerlIO_printf( PerlIO_stderr(), "\telems\t(%p): [ %p ]\n\n",  &v->elements, v->elements );
+}
+
+SV* _XS_to_packed( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+    return newSVpvn( (const char*) l->elements, l->size * c_il_width( l->type ) );
+}
+
+void _XS_assign_packed( SV* self, SV* sv_string ) {
+    SV_2STRUCT( self, IntList, l );
+
+    STRLEN len;
+    const char* bytes = SvPV( sv_string, len );
+
+    if (c_il_assign_bytes( l, bytes, (size_t) len ) != C_SUCCESS) {
+        croak("Could not assign packed integers");
     }
 }
 
-END_OF_C_CODE
+void use_index( SV* self, IV flag ) {
+    SV_2STRUCT( self, IntList, l );
+    c_il_use_index( l, (int) flag );
+}
+
+IV index_of( SV* self, IV value ) {
+    SV_2STRUCT( self, IntList, l );
+    return (IV) c_il_index_of( l, (int64_t) value );
+}
+
+void sort( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+    c_il_sort( l );
+}
+
+void _XS_shuffle( SV* self, UV seed, UV stream ) {
+    SV_2STRUCT( self, IntList, l );
+    c_il_shuffle( l, (uint64_t) seed, (uint64_t) stream );
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, IntList, l );
+    c_il_free( l );
+}
 
+END_OF_C_CODE
 
 1;
@@ -0,0 +1,159 @@
+package Anorman::Data::Map::IntDouble;
+
+# Native counterpart of Anorman::Data::Map for unsigned integer keys and
+# numeric values (src/anorman/lib/map.c). Same open addressing scheme,
+# but the table lives in three flat C arrays instead of Perl arrays.
+#
+# Zero is the implicit value of every absent key: storing 0 removes the
+# key, which is what the sparse vectors and matrices built on this map
+# need
+
+use strict;
+use warnings;
+
+use Anorman::Common qw(trace_error);
+
+my $DEFAULT_CAPACITY        = 277;
+my $DEFAULT_MIN_LOAD_FACTOR = 0.2;
+my $DEFAULT_MAX_LOAD_FACTOR = 0.5;
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	my $init_capacity   = defined $_[0] ? $_[0] : $DEFAULT_CAPACITY;
+	my $min_load_factor = defined $_[1] ? $_[1] : $DEFAULT_MIN_LOAD_FACTOR;
+	my $max_load_factor = defined $_[2] ? $_[2] : $DEFAULT_MAX_LOAD_FACTOR;
+
+	return _XS_new( $class, $init_capacity, $min_load_factor, $max_load_factor );
+}
+
+sub is_empty { $_[0]->size == 0 }
+
+sub get {
+	my ($self, $key) = @_;
+	return undef unless $self->key_exists( $key );
+	return $self->get_quick( $key );
+}
+
+sub remove { $_[0]->_XS_remove( $_[1] ) }
+
+# keys and values in ascending key order
+sub keys   { ( $_[0]->pairs )[0] }
+sub values { ( $_[0]->pairs )[1] }
+
+sub pairs {
+	my $self = shift;
+	my ($keys, $values) = ([], []);
+
+	$self->_XS_pairs( $keys, $values );
+
+	return ($keys, $values);
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Map::IntDouble',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "map.h"
+
+SV* _XS_new( SV* sv_class_name, UV capacity, NV min_load_factor, NV max_load_factor ) {
+    IntDoubleMap* map = c_idm_alloc( (size_t) capacity, (double) min_load_factor, (double) max_load_factor );
+    SV* self;
+
+    if (map == NULL) {
+        croak("Could not create hash map");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( map, self, class_name );
+
+    return self;
+}
+
+UV size( SV* self ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    return (UV) c_idm_size( map );
+}
+
+UV capacity( SV* self ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    return (UV) map->capacity;
+}
+
+void clear( SV* self ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    c_idm_clear( map );
+}
+
+void put( SV* self, UV key, NV value ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    c_idm_put( map, (size_t) key, (double) value );
+}
+
+void add( SV* self, UV key, NV delta ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    c_idm_add( map, (size_t) key, (double) delta );
+}
+
+NV get_quick( SV* self, UV key ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    return (NV) c_idm_get( map, (size_t) key );
+}
+
+IV key_exists( SV* self, UV key ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    return (IV) c_idm_contains( map, (size_t) key );
+}
+
+IV _XS_remove( SV* self, UV key ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    return (IV) c_idm_remove( map, (size_t) key );
+}
+
+void _XS_pairs( SV* self, AV* av_keys, AV* av_values ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+
+    const size_t n = c_idm_size( map );
+
+    size_t* keys;
+    double* values;
+    Newx( keys, n + 1, size_t );
+    Newx( values, n + 1, double );
+
+    c_idm_pairs( map, keys, values );
+
+    av_extend( av_keys, n );
+    av_extend( av_values, n );
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        av_store( av_keys, i, newSVuv( (UV) keys[ i ] ) );
+        av_store( av_values, i, newSVnv( values[ i ] ) );
+    }
+
+    Safefree( keys );
+    Safefree( values );
+}
+
+UV _map_address( SV* self ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    return PTR2UV( map );
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, IntDoubleMap, map );
+    c_idm_free( map );
+}
+
+END_OF_C_CODE
+
+1;
@@ -56,6 +56,28 @@ sub view_row {
 	return $self->_like_vector($view_size, $view_zero, $view_stride);
 }
 
+sub row_cursor {
+	# A row view that seek_row moves to other rows in place. Loops over
+	# rows need a single cursor instead of a new view per row:
+	#
+	#	my $row = $matrix->row_cursor;
+	#	$matrix->seek_row( $row, $_ ) and $f->( $row ) for (0 .. $matrix->rows - 1);
+	#
+	# The cursor is an ordinary vector, valid as long as the matrix is
+	my $self = shift;
+
+	return $self->view_row( defined $_[0] ? $_[0] : 0 );
+}
+
+sub seek_row {
+	my ($self, $cursor, $row) = @_;
+
+	$self->_check_row( $row );
+	$cursor->{'zero'} = $self->_index( $row, 0 );
+
+	return $cursor;
+}
+
 sub view_column {
 	my $self = shift;
 
@@ -158,6 +180,8 @@ sub assign {
 	my $self = $_[0];
 	my $type = sniff_scalar($_[1]);
 
+	return $_[1]->_eval_into( $self ) if is_expression($_[1]);
+
 	$ASSIGN_DISPATCH{ $type }->( @_ );
 }
 
@@ -211,6 +235,9 @@ sub normalize {
 
 	return if ($min == 0 && $max == 1);
 
+	# packed data is rescaled in a single fused pass
+	return $self->assign( ($self->lazy - $min) / ($max - $min) ) if is_packed($self);
+
 	$self->assign( $F->minus($min)      );
 	$self->assign( $F->div($max - $min) );
 }
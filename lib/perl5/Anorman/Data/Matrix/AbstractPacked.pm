@@ -16,7 +16,8 @@ use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::Data::Matrix::AbstractPacked',
 		ENABLE    => AUTOWRAP =>
-		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lpthread'
 
            );
 
@@ -29,6 +30,8 @@ use Inline C => <<'END_OF_C_CODE';
 #include "perl2c.h"
 #include "error.h"
 #include "../lib/matrix.c"
+#include "../lib/threads.c"
+#include "../lib/linalg/gemm.c"
 
 /*===========================================================================
  Abstract matrix functions
@@ -40,7 +43,7 @@ SV* _bless_matrix_struct( SV* sv_class_name ) {
     SV* self;
 
     /* allocate struct memory */
-    Newxz(m, 1, Matrix);
+    m = c_matrix_header_alloc();
 
     const char* class_name = SvPV_nolen( sv_class_name );
     BLESS_STRUCT( m, self, class_name );
@@ -56,7 +59,7 @@ SV* _clone_self( SV* self ) {
     SV* clone;
 
     /* clone struct */
-    Newx( n, 1, Matrix );
+    n = c_matrix_header_alloc();
     StructCopy( m, n, Matrix );
 
     /* make a blessed perl object */
@@ -0,0 +1,423 @@
+package Anorman::Data::Matrix::CSR;
+
+# Read-only compressed sparse row matrix. Rows are stored back to back
+# with sorted column indexes, so a row can be streamed against a dense
+# vector in nnz operations. This is the input format for sparse k-mer
+# spectra in the SOM: bestmatch/bestmatches search a packed weight
+# matrix and add_row_to applies the training update, without ever
+# expanding a profile to its full width. The SOM trainer takes a CSR
+# matrix as its data directly (see ESOM::SOM::data)
+#
+#	my $X = Anorman::Data::Matrix::CSR->new( $columns, \@profiles );
+#	my ($bm, $dist) = $X->bestmatch( $i, $weights );
+#	$w->assign( $w * (1 - $h) );
+#	$X->add_row_to( $i, $h, $w );
+
+use strict;
+use warnings;
+
+use parent qw(Anorman::Data::Abstract Anorman::Data::Matrix);
+
+use Anorman::Common qw(trace_error);
+use Anorman::Data::LinAlg::Property qw( :matrix is_vector is_sparse );
+use Anorman::Data::Map::IntDouble;
+
+use Scalar::Util qw(blessed);
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	# from a sparse matrix
+	if (@_ == 1) {
+		trace_error("Argument must be a sparse matrix")
+			unless (blessed($_[0]) && $_[0]->isa('Anorman::Data::Matrix::Sparse'));
+
+		return _XS_from_sparse( $class, $_[0] );
+	}
+
+	trace_error("Wrong number of arguments") unless (@_ == 2 && ref $_[1] eq 'ARRAY');
+
+	# from a list of rows. Each row is a sparse vector, an IntDouble map
+	# or a hash of column => value
+	my ($columns, $rows) = @_;
+	my @maps;
+
+	foreach my $row (@{ $rows }) {
+		if (blessed($row) && ($row->isa('Anorman::Data::Vector::Sparse') || $row->isa('Anorman::Data::Map::IntDouble'))) {
+			push @maps, $row;
+		} elsif (ref $row eq 'HASH') {
+			my $map = Anorman::Data::Map::IntDouble->new( 2 * keys %{ $row } );
+			$map->put( $_, $row->{ $_ } ) foreach keys %{ $row };
+			push @maps, $map;
+		} else {
+			trace_error("Illegal row type");
+		}
+	}
+
+	return _XS_from_maps( $class, $columns, [ map { $_->_map_address } @maps ] );
+}
+
+sub like {
+	my $self = shift;
+
+	require Anorman::Data::Matrix::Sparse;
+	return Anorman::Data::Matrix::Sparse->new( @_ == 2 ? @_ : ($self->rows, $self->columns) );
+}
+
+sub set_quick { trace_error("CSR matrices are read-only") }
+
+sub view_row {
+	trace_error("CSR matrices do not support row views. Use row_to_dense");
+}
+
+# x_i . v
+sub row_dot {
+	my ($self, $i, $v) = @_;
+
+	$self->_check_row( $i );
+	$self->_check_vector( $v );
+
+	return $self->_XS_row_dot( $i, $v ) if is_packed($v);
+
+	my ($columns, $values) = $self->row_nonzeros( $i );
+	my $sum = 0;
+
+	$sum += $values->[ $_ ] * $v->get_quick( $columns->[ $_ ] ) foreach (0 .. $#{ $values });
+
+	return $sum;
+}
+
+# |x_i - v|^2
+sub row_squared_distance {
+	my ($self, $i, $v) = @_;
+
+	$self->_check_row( $i );
+	$self->_check_vector( $v );
+
+	return $self->_XS_row_squared_distance( $i, $v ) if is_packed($v);
+
+	my $n2 = 0;
+	$n2 += $_ * $_ foreach @{ $v->_to_array };
+
+	my $d = $self->_XS_row_norm2( $i ) - 2 * $self->row_dot( $i, $v ) + $n2;
+
+	return $d > 0 ? $d : 0;
+}
+
+# nearest row of a packed matrix (e.g. SOM weights) to x_i
+sub bestmatch {
+	my ($self, $i, $W) = @_;
+
+	$self->_check_row( $i );
+	$self->_check_weights( $W );
+
+	return $self->_XS_bestmatch( $i, $W );
+}
+
+# best matches of all rows, computed in parallel. Returns the indexes and,
+# in list context, the squared distances
+sub bestmatches {
+	my ($self, $W) = @_;
+	my ($indexes, $distances) = ([], []);
+
+	$self->_check_weights( $W );
+	$self->_XS_bestmatches( $W, $indexes, $distances );
+
+	return wantarray ? ($indexes, $distances) : $indexes;
+}
+
+sub row_to_dense {
+	my ($self, $i, $v) = @_;
+
+	$self->_check_row( $i );
+
+	unless (defined $v) {
+		require Anorman::Data;
+		$v = Anorman::Data->vector( $self->columns );
+	}
+
+	$self->_check_vector( $v );
+
+	if (is_packed($v)) {
+		$self->_XS_row_to_dense( $i, $v );
+	} else {
+		my ($columns, $values) = $self->row_nonzeros( $i );
+		$v->assign(0);
+		$v->set_quick( $columns->[ $_ ], $values->[ $_ ] ) foreach (0 .. $#{ $values });
+	}
+
+	return $v;
+}
+
+# v += alpha * x_i
+sub add_row_to {
+	my ($self, $i, $alpha, $v) = @_;
+
+	$self->_check_row( $i );
+	$self->_check_vector( $v );
+
+	if (is_packed($v)) {
+		$self->_XS_add_row_to( $i, $alpha, $v );
+	} else {
+		my ($columns, $values) = $self->row_nonzeros( $i );
+		foreach my $k (0 .. $#{ $values }) {
+			my $j = $columns->[ $k ];
+			$v->set_quick( $j, $v->get_quick( $j ) + $alpha * $values->[ $k ] );
+		}
+	}
+
+	return $v;
+}
+
+# per-column minima, maxima, means and variances from the non-zeros, as
+# Data::Algorithms::Statistic::column_statistics for dense matrices
+sub column_statistics {
+	my $self = shift;
+
+	require Anorman::Data;
+	my %stats = map { $_ => Anorman::Data->packed_vector( $self->columns ) } qw(minima maxima means variances);
+
+	$self->_XS_column_statistics( @stats{ qw/minima maxima means variances/ } );
+	$stats{'size'} = $self->rows;
+
+	return \%stats;
+}
+
+sub row_nonzeros {
+	my ($self, $i) = @_;
+	my ($columns, $values) = ([], []);
+
+	$self->_check_row( $i );
+	$self->_XS_row_nonzeros( $i, $columns, $values );
+
+	return ($columns, $values);
+}
+
+sub _check_row {
+	trace_error("Row index $_[1] out of bounds") if ($_[1] < 0 || $_[1] >= $_[0]->rows);
+}
+
+sub _check_vector {
+	my ($self, $v) = @_;
+
+	trace_error("Not a vector") unless is_vector($v);
+	trace_error("Vector has " . $v->size . " elements, expected " . $self->columns) if $v->size != $self->columns;
+}
+
+sub _check_weights {
+	my ($self, $W) = @_;
+
+	trace_error("Weights must be a packed matrix") unless (is_matrix($W) && is_packed($W));
+	trace_error("Weights must have " . $self->columns . " columns") if $W->columns != $self->columns;
+}
+
+sub _to_short_string {
+	my $self = shift;
+	return "[ " . $self->rows . " x " . $self->columns . " (" . $self->nnz . " non-zero) ]";
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Matrix::CSR',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "map.h"
+#include "sparse.h"
+
+#include "../lib/vector.c"
+#include "../lib/matrix.c"
+#include "../lib/threads.c"
+#include "../lib/sparse.c"
+
+static SV* _bless_csr( CSRMatrix* csr, SV* sv_class_name ) {
+    SV* self;
+
+    if (csr == NULL) {
+        croak("Could not create CSR matrix");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( csr, self, class_name );
+
+    return self;
+}
+
+SV* _XS_from_sparse( SV* sv_class_name, SV* sv_m ) {
+    SV_2STRUCT( sv_m, Matrix, m );
+
+    return _bless_csr( c_csr_from_sparse( m ), sv_class_name );
+}
+
+SV* _XS_from_maps( SV* sv_class_name, UV columns, AV* av_maps ) {
+    const size_t rows = (size_t) (av_len( av_maps ) + 1);
+
+    IntDoubleMap** maps;
+    Newx( maps, rows + 1, IntDoubleMap* );
+
+    size_t i;
+    for (i = 0; i < rows; i++) {
+        maps[ i ] = INT2PTR( IntDoubleMap*, SvUV( *av_fetch( av_maps, i, 0 ) ) );
+    }
+
+    CSRMatrix* csr = c_csr_from_maps( maps, rows, (size_t) columns );
+
+    Safefree( maps );
+
+    return _bless_csr( csr, sv_class_name );
+}
+
+UV rows( SV* self ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    return (UV) csr->rows;
+}
+
+UV columns( SV* self ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    return (UV) csr->columns;
+}
+
+UV nnz( SV* self ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    return (UV) csr->nnz;
+}
+
+UV cardinality( SV* self ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    return (UV) csr->nnz;
+}
+
+NV get_quick( SV* self, UV row, UV column ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    return (NV) c_csr_get( csr, (size_t) row, (size_t) column );
+}
+
+NV _XS_row_norm2( SV* self, UV row ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    return (NV) c_csr_row_norm2( csr, (size_t) row );
+}
+
+NV _XS_row_dot( SV* self, UV row, SV* sv_v ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    SV_2STRUCT( sv_v, Vector, v );
+
+    return (NV) c_csr_row_dot( csr, (size_t) row, v );
+}
+
+NV _XS_row_squared_distance( SV* self, UV row, SV* sv_v ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    SV_2STRUCT( sv_v, Vector, v );
+
+    return (NV) c_csr_row_sqdist( csr, (size_t) row, v, c_vv_dot_product( v, v, 0, v->size ) );
+}
+
+void _XS_bestmatch( SV* self, UV row, SV* sv_W ) {
+    Inline_Stack_Vars;
+
+    SV_2STRUCT( self, CSRMatrix, csr );
+    SV_2STRUCT( sv_W, Matrix, W );
+
+    double* norms;
+    Newx( norms, W->rows + 1, double );
+
+    c_m_row_norms2( W, norms );
+
+    double dist;
+    const size_t best = c_csr_row_bestmatch( csr, (size_t) row, W, norms, &dist );
+
+    Safefree( norms );
+
+    Inline_Stack_Reset;
+    Inline_Stack_Push( sv_2mortal( newSVuv( (UV) best ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVnv( dist ) ) );
+    Inline_Stack_Done;
+}
+
+void _XS_bestmatches( SV* self, SV* sv_W, AV* av_indexes, AV* av_distances ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    SV_2STRUCT( sv_W, Matrix, W );
+
+    size_t* indexes;
+    double* distances;
+    Newx( indexes, csr->rows + 1, size_t );
+    Newx( distances, csr->rows + 1, double );
+
+    if (c_csr_bestmatches( csr, W, indexes, distances ) != C_SUCCESS) {
+        Safefree( indexes );
+        Safefree( distances );
+        croak("Best match search failed");
+    }
+
+    av_extend( av_indexes, csr->rows );
+    av_extend( av_distances, csr->rows );
+
+    size_t i;
+    for (i = 0; i < csr->rows; i++) {
+        av_store( av_indexes, i, newSVuv( (UV) indexes[ i ] ) );
+        av_store( av_distances, i, newSVnv( distances[ i ] ) );
+    }
+
+    Safefree( indexes );
+    Safefree( distances );
+}
+
+void _XS_row_to_dense( SV* self, UV row, SV* sv_v ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    SV_2STRUCT( sv_v, Vector, v );
+
+    c_csr_row_to_dense( csr, (size_t) row, v );
+}
+
+void _XS_add_row_to( SV* self, UV row, NV alpha, SV* sv_v ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    SV_2STRUCT( sv_v, Vector, v );
+
+    c_csr_row_axpy( csr, (size_t) row, (double) alpha, v );
+}
+
+void _XS_column_statistics( SV* self, SV* sv_min, SV* sv_max, SV* sv_means, SV* sv_vars ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    SV_2STRUCT( sv_min, Vector, minima );
+    SV_2STRUCT( sv_max, Vector, maxima );
+    SV_2STRUCT( sv_means, Vector, means );
+    SV_2STRUCT( sv_vars, Vector, variances );
+
+    if (c_csr_column_stats( csr, minima->elements + minima->zero, maxima->elements + maxima->zero,
+                            means->elements + means->zero, variances->elements + variances->zero ) != C_SUCCESS) {
+        croak("Column statistics failed");
+    }
+}
+
+void _XS_row_nonzeros( SV* self, UV row, AV* av_columns, AV* av_values ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+
+    const size_t from = csr->row_ptr[ row ];
+    const size_t to   = csr->row_ptr[ row + 1 ];
+
+    av_extend( av_columns, to - from );
+    av_extend( av_values, to - from );
+
+    size_t k;
+    for (k = from; k < to; k++) {
+        av_store( av_columns, k - from, newSVuv( (UV) csr->col_idx[ k ] ) );
+        av_store( av_values, k - from, newSVnv( csr->values[ k ] ) );
+    }
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, CSRMatrix, csr );
+    c_csr_free( csr );
+}
+
+END_OF_C_CODE
+
+1;
@@ -8,7 +8,7 @@ use parent qw(Anorman::Data::Matrix::Abstract Anorman::Data::Matrix);
 use Anorman::Common qw(trace_error sniff_scalar);
 use Anorman::Data::Vector::Dense;
 use Anorman::Data::Matrix::SelectedDense;
-use Anorman::Data::LinAlg::Property qw( is_matrix );
+use Anorman::Data::LinAlg::Property qw( is_matrix is_expression );
 use Anorman::Math::Functions;
 
 my $F = Anorman::Math::Functions->new;
@@ -86,6 +86,9 @@ sub assign {
 	my $self = shift;
 	my $type = sniff_scalar($_[0]);
 
+	# deferred expressions evaluate straight into this object
+	return $_[0]->_eval_into( $self ) if is_expression($_[0]);
+
 
 	# determine type of data passed
 	if (@_ == 2) {
@@ -153,10 +156,10 @@ sub sum {
 	return $sum;
 }
 
-sub _add_assign { is_matrix($_[1]) ? $_[0]->assign($_[1], $F->plus ) : $_[0]->assign( $F->bind_arg2( $F->plus , $_[1] ) ) } 
-sub _sub_assign { is_matrix($_[1]) ? $_[0]->assign($_[1], $F->minus) : $_[0]->assign( $F->bind_arg2( $F->minus, $_[1] ) ) } 
-sub _mul_assign { is_matrix($_[1]) ? $_[0]->assign($_[1], $F->mult ) : $_[0]->assign( $F->bind_arg2( $F->mult , $_[1] ) ) }
-sub _div_assign { is_matrix($_[1]) ? $_[0]->assign($_[1], $F->div  ) : $_[0]->assign( $F->bind_arg2( $F->div  , $_[1] ) ) }
+sub _add_assign { return $_[1]->_assign_op($_[0], '+') if is_expression($_[1]); is_matrix($_[1]) ? $_[0]->assign($_[1], $F->plus ) : $_[0]->assign( $F->bind_arg2( $F->plus , $_[1] ) ) } 
+sub _sub_assign { return $_[1]->_assign_op($_[0], '-') if is_expression($_[1]); is_matrix($_[1]) ? $_[0]->assign($_[1], $F->minus) : $_[0]->assign( $F->bind_arg2( $F->minus, $_[1] ) ) } 
+sub _mul_assign { return $_[1]->_assign_op($_[0], '*') if is_expression($_[1]); is_matrix($_[1]) ? $_[0]->assign($_[1], $F->mult ) : $_[0]->assign( $F->bind_arg2( $F->mult , $_[1] ) ) }
+sub _div_assign { return $_[1]->_assign_op($_[0], '/') if is_expression($_[1]); is_matrix($_[1]) ? $_[0]->assign($_[1], $F->div  ) : $_[0]->assign( $F->bind_arg2( $F->div  , $_[1] ) ) }
 
 sub _index {
 	my ($s, $r, $c) = @_;
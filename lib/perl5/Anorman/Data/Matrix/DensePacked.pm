@@ -5,11 +5,15 @@ use warnings;
 
 use parent qw(Anorman::Data::Matrix::Abstract Anorman::Data::Matrix);
 
-use Anorman::Common qw(sniff_scalar trace_error);
-use Anorman::Data::LinAlg::Property qw(is_packed);
+use Anorman::Common qw(sniff_scalar trace_error $VERBOSE);
+use Anorman::Data::LinAlg::Property qw(is_matrix is_packed is_expression);
+use Sys::Hostname;
 use Anorman::Data::Vector::DensePacked;
 use Anorman::Data::Matrix::SelectedDensePacked;
 
+# blocking parameters of the packed matrix product tuned for this host
+our $GEMM_PARAMS = $Anorman::Common::AN_TMP_DIR . '/gemm-' . hostname() . '.params';
+
 my %ASSIGN_DISPATCH = (
 	'NUMBER'      => \&_assign_DensePackedMatrix_from_NUMBER,
 	'2D_MATRIX'   => \&_assign_DensePackedMatrix_from_2D_MATRIX,
@@ -81,6 +85,9 @@ sub assign {
 	my $self = shift;
 	my $type = sniff_scalar($_[0]);
 
+	# deferred expressions evaluate straight into this object
+	return $_[0]->_eval_into( $self ) if is_expression($_[0]);
+
 	# pass to parent class if matrices are different types
 	if ($type eq 'OBJECT') {
 		$self->check_shape( $_[0] );
@@ -122,11 +129,24 @@ sub _view_selection_like {
 	return Anorman::Data::Matrix::SelectedDensePacked->new( $self->_elements, $_[0], $_[1], 0 );
 }
 
+sub gemm_autotune {
+	# Times a few cache blockings for the packed matrix product and
+	# stores the fastest for this host. Later sessions pick it up on load
+	my $self = shift;
+	my $file = shift || $GEMM_PARAMS;
+
+	my ($mc, $kc, $nc) = _gemm_autotune();
+
+	warn "GEMM blocking MC=$mc KC=$kc NC=$nc saved to $file\n" if $VERBOSE;
+
+	return _gemm_save_params( $file ) == 0;
+}
+
 sub _have_shared_cells_raw {
 	my ($self, $other) = @_;
 
-	return undef unless (is_packed($self) && is_packed($other));
-	return $self->_elements == $other->_elements;
+	return undef unless (is_matrix($other) && is_packed($other));
+	return $self->_packed_overlap( $other );
 }
 
 use Inline (C => Config =>
@@ -134,7 +154,7 @@ use Inline (C => Config =>
 		NAME      => 'Anorman::Data::Matrix::DensePacked',
 		ENABLE    => AUTOWRAP =>
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include',
-		LIBS      => '-I' . $Anorman::Common::AN_SRC_DIR . '/lib -landata'
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lpthread'
 
            );
 
@@ -145,10 +165,12 @@ use Inline C => <<'END_OF_C_CODE';
 #include "matrix.h"
 #include "perl2c.h"
 #include "error.h"
+#include "threads.h"
+#include "linalg/gemm.h"
 
-/*
 #include "../lib/matrix.c"
-*/
+#include "../lib/threads.c"
+#include "../lib/linalg/gemm.c"
 
 /*===========================================================================
  Abstract matrix functions
@@ -160,7 +182,7 @@ SV* _bless_matrix_struct( SV* sv_class_name ) {
     SV* self;
 
     /* allocate struct memory */
-    Newxz(m, 1, Matrix);
+    m = c_matrix_header_alloc();
 
     const char* class_name = SvPV_nolen( sv_class_name );
     BLESS_STRUCT( m, self, class_name );
@@ -176,7 +198,7 @@ SV* _clone_self( SV* self ) {
     SV* clone;
 
     /* clone struct */
-    Newx( n, 1, Matrix );
+    n = c_matrix_header_alloc();
     StructCopy( m, n, Matrix );
 
     /* make a blessed perl object */
@@ -338,6 +360,21 @@ SV* _v_part( SV* self, UV row, UV column, UV height, UV width ) {
     return self;
 }
 
+/* move a row cursor (see Data::Matrix::row_cursor) without allocating */
+SV* seek_row( SV* self, SV* cursor, IV row ) {
+    SV_2STRUCT( self, Matrix, m );
+    SV_2STRUCT( cursor, Vector, v );
+
+    if (row < 0) {
+        C_ERROR_NULL("Row index out of bounds", C_EINVAL );
+    }
+
+    c_m_seek_row( m, v, (size_t) row );
+
+    SvREFCNT_inc( cursor );
+    return cursor;
+}
+
 /* Matrix destruction */
 void DESTROY(SV* self) {
     SV_2STRUCT( self, Matrix, m );
@@ -405,9 +442,38 @@ SV* _allocate_elements( SV* self, UV num_elems ) {
         
     return sv_addr;
 }
+/* $self op= $expression is handed back to Data::Expression, which
+   evaluates the whole tree in one pass */
+static int _is_expression( SV* sv ) {
+    return sv_isobject( sv ) && sv_derived_from( sv, "Anorman::Data::Expression" );
+}
+
+static void _expression_assign_op( SV* self, SV* expr, const char* op ) {
+    dSP;
+
+    ENTER;
+    SAVETMPS;
+    PUSHMARK( SP );
+    XPUSHs( expr );
+    XPUSHs( self );
+    XPUSHs( sv_2mortal( newSVpv( op, 0 ) ) );
+    PUTBACK;
+
+    call_method( "_assign_op", G_DISCARD );
+
+    FREETMPS;
+    LEAVE;
+}
+
 SV* _sub_assign( SV* self, SV* other, SV* swap ) {
     SV_2STRUCT( self, Matrix, u );
 
+    if (_is_expression( other )) {
+        _expression_assign_op( self, other, "-" );
+        SvREFCNT_inc( self );
+        return self;
+    }
+
     if (!SvROK(other)) {
         c_m_add_constant( u, -( SvNV( other )));
     } else {
@@ -422,6 +488,12 @@ SV* _sub_assign( SV* self, SV* other, SV* swap ) {
 SV* _add_assign( SV* self, SV* other, SV* swap ) {
     SV_2STRUCT( self, Matrix, u );
 
+    if (_is_expression( other )) {
+        _expression_assign_op( self, other, "+" );
+        SvREFCNT_inc( self );
+        return self;
+    }
+
     if (!SvROK(other)) {
         c_m_add_constant( u, SvNV( other ));
     } else {
@@ -436,6 +508,12 @@ SV* _add_assign( SV* self, SV* other, SV* swap ) {
 SV* _div_assign( SV* self, SV* other, SV* swap ) {
     SV_2STRUCT( self, Matrix, u );
 
+    if (_is_expression( other )) {
+        _expression_assign_op( self, other, "/" );
+        SvREFCNT_inc( self );
+        return self;
+    }
+
     if (!SvROK(other)) {
         c_m_scale( u, 1 / SvNV( other ) );
     } else {
@@ -450,6 +528,12 @@ SV* _div_assign( SV* self, SV* other, SV* swap ) {
 SV* _mul_assign( SV* self, SV* other, SV* swap ) {
     SV_2STRUCT( self, Matrix, u );
 
+    if (_is_expression( other )) {
+        _expression_assign_op( self, other, "*" );
+        SvREFCNT_inc( self );
+        return self;
+    }
+
     if (!SvROK(other)) {
         c_m_scale( u, SvNV( other ) );
     } else {
@@ -522,13 +606,17 @@ void _assign_DensePackedMatrix_from_OBJECT ( SV* self, SV* other ) {
 
     LEAVE;
 
-    /* straight up memcopy if neither marix is a view */
-    if (!A->view_flag && !B->view_flag) {
-        Copy( B->elements, A->elements, (UV) (A->rows * A->columns), double );
-        return; 
+    /* memmove for contiguous matrices, staged copy for overlapping views */
+    if (c_mm_copy( A, B ) != C_SUCCESS) {
+        croak("Failed to copy matrix");
     }
+}
+
+IV _packed_overlap( SV* self, SV* other ) {
+    SV_2STRUCT( self, Matrix, A );
+    SV_2STRUCT( other, Matrix, B );
 
-    c_mm_copy( A, B );
+    return (IV) c_mm_overlap( A, B );
 }
 
 void _assign_DensePackedMatrix_from_CODE( SV* self, SV* code ) {
@@ -670,7 +758,33 @@ void _mult_matrix_matrix ( SV* self,
     double alpha = (double) SvNV( sv_alpha );
     double beta  = (double) SvNV( sv_beta );
 
-    c_mm_mult( A, B, C, alpha, beta );
+    if (c_mm_mult( A, B, C, alpha, beta ) == NULL) {
+        croak("Matrix multiplication failed");
+    }
+}
+
+/* GEMM blocking parameters */
+int _gemm_load_params( char* path ) {
+    return c_gemm_load_params( path );
+}
+
+int _gemm_save_params( char* path ) {
+    return c_gemm_save_params( path );
+}
+
+void _gemm_autotune() {
+    Inline_Stack_Vars;
+
+    size_t mc, kc, nc;
+
+    c_gemm_autotune();
+    c_gemm_get_params( &mc, &kc, &nc );
+
+    Inline_Stack_Reset;
+    Inline_Stack_Push( sv_2mortal( newSVuv( mc ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVuv( kc ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVuv( nc ) ) );
+    Inline_Stack_Done;
 }
 
 void _mult_matrix_vector ( SV* self, SV* other, SV* result, SV* sv_alpha, SV* sv_beta, SV* sv_transA ) {
@@ -709,4 +823,6 @@ void _mult_matrix_vector ( SV* self, SV* other, SV* result, SV* sv_alpha, SV* sv
 
 END_OF_C_CODE
 
+_gemm_load_params( $GEMM_PARAMS ) if -e $GEMM_PARAMS;
+
 1;
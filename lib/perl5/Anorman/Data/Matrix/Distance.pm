@@ -81,7 +81,7 @@ sub data {
 		
 		my $data = shift;
 
-		$self->{'data'} = [ map { $data->view_row( $_ ) } (0 .. $data->rows - 1) ];
+		$self->{'data'} = $data;
 		$self->{'n'}    = $data->rows;
 	} else {
 		return $self->{'data'};
@@ -162,19 +162,25 @@ sub _calculate_distances {
 
 	my $size = ($self->{'n'} * ($self->{'n'} - 1)) / 2;
 
-	if (is_packed($self->{'data'}->[0])) {
+	if (is_packed($self->{'data'})) {
 		$self->{'_ELEMS'} = Anorman::Data->packed_vector( $size );
 	} else {
 		$self->{'_ELEMS'} = Anorman::Data->vector( $size );
 	}
 	
+	my $data  = $self->{'data'};
+	my $row_i = $data->row_cursor;
+	my $row_j = $data->row_cursor;
+
 	warn "Calculating $size distances...\n";
 	my $i = -1;
 	while (++$i < ($self->{'n'} - 1)) {
+		$data->seek_row( $row_i, $i );
 
 		my $j = $i;
 		while (++$j < $self->{'n'}) {
-			$self->{'_ELEMS'}->set_quick( $self->_index( $i, $j ), $self->{'_FUNC'}->apply( $self->{'data'}->[ $i ], $self->{'data'}->[ $j ] ));
+			$data->seek_row( $row_j, $j );
+			$self->{'_ELEMS'}->set_quick( $self->_index( $i, $j ), $self->{'_FUNC'}->apply( $row_i, $row_j ));
 		}
 	}
 	warn "Done\n";
@@ -1,287 +1,286 @@
 package Anorman::Data::Matrix::Image;
 
+# Image filters over matrices (src/anorman/lib/image.c), such as the
+# U-matrix of a SOM. Images wrap around at the edges like the toroid
+# grids they are drawn from, and every filter runs natively over the
+# packed storage of the matrix, a band of rows per thread:
+#
+#	my $U = Anorman::ESOM::UMatrixRenderer->new->render( $grid );
+#	my ($mask, $threshold) = edge_mask( $U, blur => 1 );
+#
+# The Gaussian and Sobel kernels are the separable 5x5 binomial ones,
+# [1 4 6 4 1] / 16 for smoothing and [1 2 0 -2 -1] for the derivative.
+# Edge masks hold the gradient direction, 0 .. 7 in steps of 45 degrees,
+# on edges and MASK (-3) elsewhere
+
 use warnings;
 use strict;
 
-use Anorman::Common;
+use Anorman::Common qw(trace_error);
+use Anorman::Data::LinAlg::Property qw(is_matrix is_packed);
+use Anorman::Data::Matrix::DensePacked;
 
-# Sobel operator kernels (3x3 matrices in list form)
-#my @GX = qw/-1 0 1 -2 0 2 -1 0 1/;
-#my @GY = qw/1 2 1 0 0 0 -1 -2 -1/;
+use Exporter;
 
-# Enhanced Sobel operators
+use vars qw(@ISA @EXPORT_OK);
 
-# X-direction
-my @GX   = ( 2, 3, 0,-3,-2,
-             3, 4, 0,-4,-3,
-             6, 6, 0,-6,-6,
-             3, 4, 0,-4,-3,
-             2, 3, 0,-3,-2 );
+@ISA       = qw(Exporter);
+@EXPORT_OK = qw(
+	histogram
+	calculate_threshold
+	gaussian_noise_reduction
+	edge_enhance
+	gradient_image
+	edge_mask
+);
 
-# 45-degree direction
-my @G45  = ( 6, 2, 3, 2, 0,
-             2, 6, 4, 0,-2,
-             3, 4, 0,-4,-2,
-             2, 0,-4,-6,-2,
-             0,-2,-3,-2,-6 );
+use constant MASK => -3;
 
-# Y-direction
-my @GY   = ( 2, 3, 6, 3, 2,
-             3, 4, 6, 4, 3,
-             0, 0, 0, 0, 0,
-            -3,-4,-6,-4,-3,
-            -2,-3,-6,-3,-2 );
+# counts of grayscale values (0..255) of an image of [0..1] values
+sub histogram {
+	my $image = _packed( shift );
+	return [ _XS_histogram( $image ) ];
+}
 
-# 135-degree direction
-my @G135 = ( 0, 2, 3, 2, 6,
-            -2, 0, 4, 6, 2,
-            -3,-4, 0, 4, 3,
-            -2,-6,-4, 0, 2,
-            -6,-2,-3,-2, 0 );
+# gradient image edge detection threshold [0..1] based on Otsu's method
+sub calculate_threshold {
+	my $image = _packed( shift );
+	return _XS_otsu( $image );
+}
 
+sub gaussian_noise_reduction {
+	my $image = _packed( shift );
+	my $out   = _blank( $image );
 
-# edge enhance 3x3 kernel
-my @US = (0.5,  1,0.5,
-            1, -6,  1,
-          0.5,  1,0.5 );
+	_XS_blur( $image, $out );
 
-# Gaussian blur kernel (sigma=1)
-my @GF     = ( 1, 4, 7, 4, 1,
-               4,16,26,16, 4,
-               7,26,41,26, 7,
-               4,14,26,16, 4,
-               1, 4, 7, 4, 1);
+	return $out;
+}
 
-my $GF_SUM = 273;
+sub edge_enhance {
+	my $image = _packed( shift );
+	my $out   = _blank( $image );
 
-use constant PI => 4 * atan2(1, 1);
+	_XS_enhance( $image, $out );
 
-sub histogram {
-	# generates a histogram of grayscale values in the U-Matrix (0..255)
-	my $self = shift;
-	my @hist = (0) x 256;
+	return $out;
+}
 
-	
-	$hist[ $_ ]++ for map { 0xFF & (255 * $_) } $self->values;
+# gradient magnitudes, and in list context directions, of the image
+sub gradient_image {
+	my $image     = _packed( shift );
+	my $magnitude = _blank( $image );
+	my $direction = _blank( $image );
+
+	_XS_sobel( $image, $magnitude, $direction );
 
-	return \@hist;
+	return wantarray ? ($magnitude, $direction) : $magnitude;
 }
 
-sub gradient_image {
+# Edge mask by non-maximum suppression of the gradient. Magnitudes are
+# scaled to [0..1] and compared to threshold, by default the Otsu
+# threshold of their histogram. Returns the mask and, in list context,
+# the threshold and the scaled magnitudes
+sub edge_mask {
+	my $image = _packed( shift );
+	my %opt   = ( 'blur' => 1, 'threshold' => undef, @_ );
+
+	my $mask      = _blank( $image );
+	my $magnitude = _blank( $image );
+	my $threshold = defined $opt{'threshold'} ? $opt{'threshold'} : -1;
+
+	trace_error("Threshold must be in [0..1]") if (defined $opt{'threshold'} && ($threshold < 0 || $threshold > 1));
 
-	# creates a gradient image of the U-matrix
-	# based on the Sobel method
-	my $self   = shift;
-	my $data   = shift;
-
-	$self->_check_data_size( $data ) if defined $data;
-
-	my $grid   = $self->{'_grid'};
-
-	my @magnitude = ();
-	my @direction = ();
-	my @mask      = ();
-
-	#warn "Sniffing pixels...\n";
-	while (defined (my $p = $self->iterate)) {
-	
-		my $sumX   = 0;
-		#my $sum45  = 0;
-		my $sumY   = 0;
-		#my $sum135 = 0;
-
-		my $i    = 0;
-
-		foreach my $n( $grid->neighbors_XbyX( $p,5 ) ) {
-			my $h = defined $data ? $data->[ $n ] : $self->get( $n );
-			
-			my ($x, $y) = ($grid->index2row( $n ), $grid->index2col( $n ));
-
-			#warn "$n\t($x,$y)\t$h\t$i\t$GX[ $i ]\t$GY[ $i ]\n";
-
-			$sumX   += $h * $GX[ $i ];
-			#$sum45  += $h * $G45[ $i ];
-			$sumY   += $h * $GY[ $i ];
-			#$sum135 += $h * $G135[ $i ];
-			
-			$i++;
-		}
-
-		#my $maxG = 0;
-
-		#warn "GX: $sumX GY: $sumY G45: $sum45 G135: $sum135\n";
-		#my @locD =  ($sumX, $sum45, $sumY, $sum135);
-
-		#print STDERR join ("\t", @locD), "\n";
-		
-		#my $D    = 0;
-		#my $maxD = 0;
-
-		#while ($D < 4) {
-		#	if (abs($locD[ $D ]) > $maxG) {
-		#		$maxD = $D;
-		#		$maxG = abs($locD[$D]);
-		#	} 
-		#	$D++;
-		#}
-
-		my $G = sqrt( ($sumX * $sumX) + ($sumY * $sumY) );
-		my $theta = atan2($sumY, $sumX);
-		my $D = int( (4 * ($theta + PI) ) / PI );
-		
-		#warn "P: $p SUMX: $sumX SUMY: $sumY THETA: $theta G: $G D: $D\n\n";
-		push @magnitude, $G;
-		push @direction, $D;
-		#exit;
-
-	}
-	return \@magnitude;
-	
-	warn "Normalizing magnitudes...\n";
-
-	&Anorman::Math::Common::normalize_zero_to_one(\@magnitude);
-
-	warn "Resniffing pixels...\n";
-
-	while (defined (my $p = $self->iterate)) {
-		my @neighM = map { $magnitude[ $_ ] } $grid->neighbors_XbyX( $p, 3 );
-
-		# re-arrange neighbors to correspond with gradient directions
-		my @dirM     = @neighM[7,6,3,0,1,2,5,8];
-		my @rev_dirM = @neighM[1,2,5,8,7,6,3,0];
-
-		my $locD     = $direction[ $p ];
-		my $locM     = $magnitude[ $p ];
-		my $mask_bit = ($locM > $dirM[ $locD ] && $locM > $rev_dirM[ $locD ]);
-
-		#if ($locD == 0) {
-		#	$mask_bit = ($locM > $neighM[1] && $locM > $neighM[7]);
-		#} elsif ($locD == 1) {
-		#	$mask_bit = ($locM > $neighM[0] && $locM > $neighM[8]);
-		#} elsif ($locD == 2) {
-		#	$mask_bit = ($locM > $neighM[3] && $locM > $neighM[5]);
-		#} else {
-		#	$mask_bit = ($locM > $neighM[2] && $locM > $neighM[6]);
-		#}
-
-		my $color = ($mask_bit && $locM > 0.05) ? $locD : -3;
-		push @mask, $color;
-
-	}
-	return \@mask;
+	$threshold = _XS_edges( $image, $opt{'blur'} ? 1 : 0, $threshold, $mask, $magnitude );
+
+	return wantarray ? ($mask, $threshold, $magnitude) : $mask;
 }
 
-sub gaussian_noise_reduction {
-	my $self   = shift;
-	my $data   = shift if defined $_[0];
-	
-	$self->_check_size( $data ) if defined $data;
+sub _blank {
+	return Anorman::Data::Matrix::DensePacked->new( $_[0]->rows, $_[0]->columns );
+}
 
-	my $grid   = $self->{'_grid'};
-	my @values = ();
+# packed copy of a matrix of another type
+sub _packed {
+	my $image = shift;
 
-	while (defined (my $p = $self->iterate)) {
-	
-		my $i   = 0;
-		my $sum = 0;
-	
-		foreach my $n( $grid->neighbors_XbyX( $p, 5) ) {
-			my $A = defined $data ? $data->[ $n ] : $self->get( $n );
+	trace_error("Not a matrix") unless is_matrix($image);
 
-			$sum += $A * $GF[ $i ];
+	return $image if is_packed($image);
+	return Anorman::Data::Matrix::DensePacked->new( $image->rows, $image->columns )->assign( $image );
+}
 
-			$i++;
-		}
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Matrix::Image',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lm -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "matrix.h"
+#include "image.h"
+
+#include "../lib/threads.c"
+#include "../lib/image.c"
+
+/* Row by row pixels of a matrix. Plain matrices are used in place,
+   views are copied and must be released with _release */
+static double* _pixels( Matrix* m ) {
+    if (m->offsets == NULL && m->column_stride == 1 && m->row_stride == m->columns) {
+        return m->elements + m->row_zero + m->column_zero;
+    }
+
+    double* p;
+    Newx( p, m->rows * m->columns + 1, double );
+
+    size_t i, j;
+    for (i = 0; i < m->rows; i++) {
+        for (j = 0; j < m->columns; j++) {
+            p[ i * m->columns + j ] = c_m_get_quick( m, i, j );
+        }
+    }
+
+    return p;
+}
 
-		my $B = ( 1 / $GF_SUM ) * $sum;
-		push @values, $B;
-	}
+static void _release( Matrix* m, double* p ) {
+    if (p != m->elements + m->row_zero + m->column_zero) {
+        Safefree( p );
+    }
+}
 
-	return \@values;
+static void _check_shape( Matrix* a, Matrix* b ) {
+    if (a->rows != b->rows || a->columns != b->columns) {
+        croak("Images differ in shape");
+    }
 }
 
-sub edge_enhance {
-	my $self   = shift;
-	my $data   = shift;
+void _XS_histogram( SV* sv_m ) {
+    Inline_Stack_Vars;
 
-	$self->_check_data_size( $data ) if defined $data;
+    SV_2STRUCT( sv_m, Matrix, m );
 
-	my $grid   = $self->{'_grid'};
-	my @values = ();
+    uint64_t hist[ 256 ];
+    double*  p = _pixels( m );
 
-	while (defined (my $p = $self->iterate)) {
+    c_img_histogram( p, m->rows * m->columns, hist );
+    _release( m, p );
 
-		my $i = 0;	
-		my $B = 0;
+    Inline_Stack_Reset;
 
-		foreach my $n( $grid->neighbors_XbyX( $p,3 ) ) {
-			my $A  = defined $data ? $data->[ $n ] : $self->get( $n );
-			my $F  = $US[ $i ];
+    int t;
+    for (t = 0; t < 256; t++) {
+        Inline_Stack_Push( sv_2mortal( newSVuv( (UV) hist[ t ] ) ) );
+    }
 
-			$i++;
-				
-			#next if $A < 0.03;
-			$B += $A * $F;
-		}
+    Inline_Stack_Done;
+}
 
-		push @values, $B;
+NV _XS_otsu( SV* sv_m ) {
+    SV_2STRUCT( sv_m, Matrix, m );
 
-	}
+    uint64_t hist[ 256 ];
+    double*  p = _pixels( m );
 
-	return \@values;
+    c_img_histogram( p, m->rows * m->columns, hist );
+    _release( m, p );
+
+    return (NV) c_img_otsu( hist );
 }
 
-sub normalize {
-	# normalize U-matrix heights to [0..1] values
-	my $self = shift;
+void _XS_blur( SV* sv_in, SV* sv_out ) {
+    SV_2STRUCT( sv_in, Matrix, in );
+    SV_2STRUCT( sv_out, Matrix, out );
+
+    _check_shape( in, out );
 
-	&Anorman::Math::Common::normalize_zero_to_one( $self->{'values'} );
+    double* p = _pixels( in );
+    double* q = _pixels( out );
+
+    c_img_blur( p, q, in->rows, in->columns );
+
+    _release( in, p );
+    _release( out, q );
 }
 
-sub calculate_threshold {
-	# gradient image edge detection threshold [0..1] based on sotu method
-	my $self = shift;
-	my $hist = $self->histogram;
+void _XS_enhance( SV* sv_in, SV* sv_out ) {
+    SV_2STRUCT( sv_in, Matrix, in );
+    SV_2STRUCT( sv_out, Matrix, out );
 
-	my $max_level_value = 0;
-	
-	my $sum = 0;
-	foreach my $h(0..255) {
-		$sum += $h * $hist->[ $h ];
-		$max_level_value = $hist->[ $h ] if $hist->[ $h ] > $max_level_value;
-	}
+    _check_shape( in, out );
 
-	my $sumB = 0;
-	my $wB   = 0;
-	my $wF   = 0; 
+    double* p = _pixels( in );
+    double* q = _pixels( out );
 
-	my $varMax    = 0;
-	my $threshold = 0;
+    c_img_enhance( p, q, in->rows, in->columns );
 
-	foreach my $t(0..255) {
-		$wB += $hist->[ $t ];
+    _release( in, p );
+    _release( out, q );
+}
 
-		next if ($wB == 0);
+/* integer outputs are written back as doubles */
+static void _store_ints( Matrix* m, double* q, const int* v ) {
+    size_t i;
+    for (i = 0; i < m->rows * m->columns; i++) {
+        q[ i ] = (double) v[ i ];
+    }
+}
 
-		$wF = $self->{'_size'} - $wB;
+void _XS_sobel( SV* sv_in, SV* sv_magnitude, SV* sv_direction ) {
+    SV_2STRUCT( sv_in, Matrix, in );
+    SV_2STRUCT( sv_magnitude, Matrix, mag );
+    SV_2STRUCT( sv_direction, Matrix, dir );
 
-		last if ($wF == 0);
+    _check_shape( in, mag );
+    _check_shape( in, dir );
 
-		$sumB += $t * $hist->[ $t ];
+    int* d;
+    Newx( d, in->rows * in->columns + 1, int );
 
-		my $mB = $sumB / $wB;
-		my $mF = ($sum - $sumB) / $wF;
+    double* p = _pixels( in );
+    double* q = _pixels( mag );
+    double* r = _pixels( dir );
 
-		my $varBetween = $wB * $wF * ($mB - $mF) * ($mB - $mF);
+    c_img_sobel( p, q, d, in->rows, in->columns );
+    _store_ints( dir, r, d );
 
-		if ($varBetween > $varMax) {
-			$varMax = $varBetween;
-			$threshold = $t;
-		}
-	}
+    _release( in, p );
+    _release( mag, q );
+    _release( dir, r );
+    Safefree( d );
+}
+
+NV _XS_edges( SV* sv_in, IV blur, NV threshold, SV* sv_mask, SV* sv_magnitude ) {
+    SV_2STRUCT( sv_in, Matrix, in );
+    SV_2STRUCT( sv_mask, Matrix, mask );
+    SV_2STRUCT( sv_magnitude, Matrix, mag );
+
+    _check_shape( in, mask );
+    _check_shape( in, mag );
+
+    int* d;
+    Newx( d, in->rows * in->columns + 1, int );
+
+    double* p = _pixels( in );
+    double* q = _pixels( mag );
+    double* r = _pixels( mask );
 
-	return ($threshold / 255);
+    const double t = c_img_edges( p, in->rows, in->columns, (int) blur, (double) threshold, q, d, NULL );
+    _store_ints( mask, r, d );
+
+    _release( in, p );
+    _release( mag, q );
+    _release( mask, r );
+    Safefree( d );
+
+    return (NV) t;
 }
 
-1;
+END_OF_C_CODE
 
+1;
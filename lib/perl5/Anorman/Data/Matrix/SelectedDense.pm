@@ -115,6 +115,15 @@ sub view_row {
 	return Anorman::Data::Vector::SelectedDense->new( $size, $self->{'_ELEMS'}, $zero, $stride, $offsets, $offset );
 }
 
+sub seek_row {
+	my ($self, $cursor, $row) = @_;
+	$self->_check_row( $row );
+
+	$cursor->{'offset'} = $self->{'offset'} + $self->_row_offset( $self->_row_rank( $row ) );
+
+	return $cursor;
+}
+
 sub view_column {
 	my $self = shift;
 	$self->_check_column($_[0]);
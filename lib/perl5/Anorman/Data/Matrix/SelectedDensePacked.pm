@@ -136,7 +136,7 @@ use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::Data::Matrix::SelectedDensePacked',
 		ENABLE    => AUTOWRAP =>
-		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
 
            );
@@ -165,7 +165,7 @@ SV* _bless_matrix_struct( SV* sv_class_name ) {
     SV* self;
 
     /* allocate struct memory */
-    Newxz(m, 1, Matrix);
+    m = c_matrix_header_alloc();
 
     const char* class_name = SvPV_nolen( sv_class_name );
     BLESS_STRUCT( m, self, class_name );
@@ -183,7 +183,7 @@ SV* _clone_self( SV* self ) {
     SV* clone;
 
     /* clone struct */
-    Newx( n, 1, Matrix );
+    n = c_matrix_header_alloc();
     StructCopy( m, n, Matrix );
 
     /* make a blessed perl object */
@@ -348,6 +348,21 @@ SV* _v_part( SV* self, UV row, UV column, UV height, UV width ) {
     return self;
 }
 
+/* move a row cursor (see Data::Matrix::row_cursor) without allocating */
+SV* seek_row( SV* self, SV* cursor, IV row ) {
+    SV_2STRUCT( self, Matrix, m );
+    SV_2STRUCT( cursor, Vector, v );
+
+    if (row < 0) {
+        C_ERROR_NULL("Row index out of bounds", C_EINVAL );
+    }
+
+    c_m_seek_row( m, v, (size_t) row );
+
+    SvREFCNT_inc( cursor );
+    return cursor;
+}
+
 
 /* Matrix destruction */
 
@@ -0,0 +1,226 @@
+package Anorman::Data::Matrix::Sparse;
+
+# A matrix that only stores its non-zero cells, in a native hash map
+# keyed by row * columns + column. Good for collecting sparse data cell
+# by cell (e.g. k-mer counts per sequence). For reading it row by row,
+# convert it with to_csr
+
+use strict;
+use warnings;
+
+use parent qw(Anorman::Data::Abstract Anorman::Data::Matrix);
+
+use Anorman::Common qw(sniff_scalar trace_error);
+use Anorman::Data::LinAlg::Property qw( :matrix is_sparse );
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	trace_error("Wrong number of arguments") if @_ != 2;
+
+	return _XS_new( $class, $_[0], $_[1] );
+}
+
+sub copy { $_[0]->_XS_copy }
+
+sub assign {
+	my $self = shift;
+
+	if (@_ == 1 && sniff_scalar($_[0]) eq 'NUMBER' && $_[0] == 0) {
+		$self->clear;
+		return $self;
+	}
+
+	return $self->SUPER::assign(@_);
+}
+
+# rows, columns and values of the non-zero cells in row-major order
+sub nonzeros {
+	my $self = shift;
+	my ($rows, $columns, $values) = ([], [], []);
+
+	$self->_XS_nonzeros( $rows, $columns, $values );
+
+	return ($rows, $columns, $values);
+}
+
+sub to_csr {
+	require Anorman::Data::Matrix::CSR;
+	return Anorman::Data::Matrix::CSR->new( $_[0] );
+}
+
+sub to_dense {
+	my $self = shift;
+
+	require Anorman::Data;
+	my $dense = Anorman::Data->matrix( $self->rows, $self->columns );
+
+	my ($rows, $columns, $values) = $self->nonzeros;
+	$dense->set_quick( $rows->[ $_ ], $columns->[ $_ ], $values->[ $_ ] ) foreach (0 .. $#{ $values });
+
+	return $dense;
+}
+
+sub view_row {
+	trace_error("Sparse matrices do not support row views. Use to_csr");
+}
+
+sub _to_short_string {
+	my $self = shift;
+	return "[ " . $self->rows . " x " . $self->columns . " (" . $self->cardinality . " non-zero) ]";
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Matrix::Sparse',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "map.h"
+#include "sparse.h"
+
+#include "../lib/vector.c"
+#include "../lib/matrix.c"
+#include "../lib/threads.c"
+#include "../lib/sparse.c"
+
+SV* _XS_new( SV* sv_class_name, UV rows, UV columns ) {
+    Matrix* m = c_sm_alloc( (size_t) rows, (size_t) columns );
+    SV* self;
+
+    if (m == NULL) {
+        croak("Could not create sparse matrix");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( m, self, class_name );
+
+    return self;
+}
+
+SV* _clone_self( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+
+    Matrix* n;
+    SV* clone;
+
+    n = c_matrix_header_alloc();
+    StructCopy( m, n, Matrix );
+
+    const char* class_name = sv_reftype( SvRV( self ), TRUE );
+    BLESS_STRUCT( n, clone, class_name );
+
+    return clone;
+}
+
+SV* _XS_copy( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+
+    Matrix* n;
+    SV* copy;
+
+    n = c_matrix_header_alloc();
+    StructCopy( m, n, Matrix );
+    n->view_flag = 0;
+    n->hash_map  = c_idm_copy( m->hash_map );
+
+    const char* class_name = sv_reftype( SvRV( self ), TRUE );
+    BLESS_STRUCT( n, copy, class_name );
+
+    return copy;
+}
+
+UV rows( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+    return (UV) m->rows;
+}
+
+UV columns( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+    return (UV) m->columns;
+}
+
+UV size( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+    return (UV) (m->rows * m->columns);
+}
+
+UV cardinality( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+    return (UV) c_idm_size( m->hash_map );
+}
+
+UV _is_view( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+    return (UV) m->view_flag;
+}
+
+void _set_view( SV* self, IV flag ) {
+    SV_2STRUCT( self, Matrix, m );
+    m->view_flag = (int) flag;
+}
+
+NV get_quick( SV* self, UV row, UV column ) {
+    SV_2STRUCT( self, Matrix, m );
+    return (NV) c_sm_get( m, (size_t) row, (size_t) column );
+}
+
+void set_quick( SV* self, UV row, UV column, NV value ) {
+    SV_2STRUCT( self, Matrix, m );
+    c_sm_set( m, (size_t) row, (size_t) column, (double) value );
+}
+
+void add_quick( SV* self, UV row, UV column, NV delta ) {
+    SV_2STRUCT( self, Matrix, m );
+    c_idm_add( m->hash_map, (size_t) row * m->columns + (size_t) column, (double) delta );
+}
+
+void clear( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+    c_idm_clear( m->hash_map );
+}
+
+void _XS_nonzeros( SV* self, AV* av_rows, AV* av_columns, AV* av_values ) {
+    SV_2STRUCT( self, Matrix, m );
+
+    const size_t n = c_idm_size( m->hash_map );
+
+    size_t* keys;
+    double* values;
+    Newx( keys, n + 1, size_t );
+    Newx( values, n + 1, double );
+
+    c_idm_pairs( m->hash_map, keys, values );
+
+    av_extend( av_rows, n );
+    av_extend( av_columns, n );
+    av_extend( av_values, n );
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        av_store( av_rows, i, newSVuv( (UV) (keys[ i ] / m->columns) ) );
+        av_store( av_columns, i, newSVuv( (UV) (keys[ i ] % m->columns) ) );
+        av_store( av_values, i, newSVnv( values[ i ] ) );
+    }
+
+    Safefree( keys );
+    Safefree( values );
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, Matrix, m );
+    c_m_free( m );
+}
+
+END_OF_C_CODE
+
+1;
@@ -0,0 +1,82 @@
+package Anorman::Data::Memory;
+
+use strict;
+use warnings;
+
+# Access to the native allocator behind the packed vectors and matrices
+# (src/anorman/lib/memory.c). The counters are process wide and can be
+# used to check that a loop does not allocate:
+#
+#	reset_allocation_stats();
+#	... train ...
+#	my $s = allocation_stats();
+#	print "$s->{element_allocs} buffers, $s->{slab_chunks} slab refills\n";
+#
+# header_allocs counts views taken from the slab pools, which is cheap
+# but not free of Perl object overhead
+
+use Anorman::Common;
+use Exporter;
+
+our (@ISA, @EXPORT_OK, %EXPORT_TAGS);
+
+@ISA = qw(Exporter);
+
+@EXPORT_OK = qw(
+	allocation_stats
+	reset_allocation_stats
+	hugepages
+);
+
+%EXPORT_TAGS = ( all => [ @EXPORT_OK ] );
+
+# get or set huge page backing of large element buffers
+sub hugepages {
+	_set_hugepages( $_[0] ? 1 : 0 ) if @_;
+	return _hugepages();
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Memory',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "memory.h"
+
+SV* allocation_stats() {
+    MemStats s;
+    c_mem_stats( &s );
+
+    HV* hv = newHV();
+
+    hv_stores( hv, "element_allocs", newSVuv( (UV) s.element_allocs ) );
+    hv_stores( hv, "element_frees",  newSVuv( (UV) s.element_frees ) );
+    hv_stores( hv, "element_bytes",  newSVuv( (UV) s.element_bytes ) );
+    hv_stores( hv, "huge_allocs",    newSVuv( (UV) s.huge_allocs ) );
+    hv_stores( hv, "header_allocs",  newSVuv( (UV) s.header_allocs ) );
+    hv_stores( hv, "header_frees",   newSVuv( (UV) s.header_frees ) );
+    hv_stores( hv, "slab_chunks",    newSVuv( (UV) s.slab_chunks ) );
+
+    return newRV_noinc( (SV*) hv );
+}
+
+void reset_allocation_stats() {
+    c_mem_reset_stats();
+}
+
+IV _hugepages() {
+    return (IV) c_mem_hugepages();
+}
+
+void _set_hugepages( IV flag ) {
+    c_mem_set_hugepages( (int) flag );
+}
+
+END_OF_C_CODE
+
+1;
@@ -91,6 +91,9 @@ sub normalize {
 
 	return if ($max == 1 && $min == 0);
 
+	# packed data is rescaled in a single fused pass
+	return $self->assign( ($self->lazy - $min) / ($max - $min) ) if is_packed($self);
+
 	$self->assign( $F->minus($min) );
 	$self->assign( $F->div($max-$min));
 }
@@ -104,6 +107,8 @@ sub ztrans {
 	my $mean = $VF->mean->( $self );
 	my $std  = $VF->stdev->( $self );
 
+	return $self->assign( ($self->lazy - $mean) / $std ) if is_packed($self);
+
 	$self->assign( $F->minus( $mean ) );
 	$self->assign( $F->div( $std ) );
 }
@@ -117,6 +122,8 @@ sub rztrans {
 	my $mean = $VF->robust_mean->( $self );
 	my $std  = $VF->robust_stdev->( $self );
 
+	return $self->assign( ($self->lazy - $mean) / $std ) if is_packed($self);
+
 	$self->assign( $F->minus( $mean ) );
 	$self->assign( $F->div( $std ) );
 }
@@ -141,6 +148,9 @@ sub view_selection {
 
 sub assign {
 	my ($self,$type) = ($_[0], sniff_scalar($_[1]));
+
+	return $_[1]->_eval_into( $self ) if is_expression($_[1]);
+
 	$ASSIGN_DISPATCH{ $type }->(@_); 
 }
 
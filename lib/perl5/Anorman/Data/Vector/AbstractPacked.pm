@@ -11,7 +11,7 @@ use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::Data::Vector::AbstractPacked',
 		AUTOWRAP  => ENABLE =>
-		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -lvector',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -lvector -landata',
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
 	   );
 use Inline C => <<'END_OF_C_CODE';
@@ -35,7 +35,7 @@ SV* _bless_vector_struct( SV* sv_class_name ) {
     SV* self;
 
     /* allocate struct memory */
-    Newxz(v, 1, Vector);
+    v = c_vector_header_alloc();
 
     const char* class_name = SvPV_nolen( sv_class_name );
     BLESS_STRUCT( v, self, class_name );
@@ -51,7 +51,7 @@ SV* _clone_self( SV* self ) {
     SV* clone;
 
     /* clone struct */
-    Newx( n, 1, Vector);
+    n = c_vector_header_alloc();
     StructCopy( v, n, Vector);
 
     /* make a blessed perl object */
@@ -66,6 +66,9 @@ sub assign {
 	my $self = shift;
 	my $type = sniff_scalar($_[0]);
 
+	# deferred expressions evaluate straight into this object
+	return $_[0]->_eval_into( $self ) if is_expression($_[0]);
+
 	# determine type of data passed
 	if (@_ == 2) {
 		my $arg2_type = sniff_scalar( $_[1] );
@@ -199,10 +202,10 @@ sub sum {
 	return $sum;
 }
 
-sub _add_assign { is_vector($_[1]) ? $_[0]->assign($_[1], sub{$_[0]+$_[1]}) : my $v=$_[1]; $_[0]->assign( sub {$_[0]+$v })} 
-sub _sub_assign { is_vector($_[1]) ? $_[0]->assign($_[1], sub{$_[0]-$_[1]}) : my $v=$_[1]; $_[0]->assign( sub {$_[0]-$v })} 
-sub _mul_assign { is_vector($_[1]) ? $_[0]->assign($_[1], sub{$_[0]*$_[1]}) : my $v=$_[1]; $_[0]->assign( sub {$_[0]*$v })}
-sub _div_assign { is_vector($_[1]) ? $_[0]->assign($_[1], sub{$_[0]/$_[1]}) : my $v=$_[1]; $_[0]->assign( sub {$_[0]/$v })}
+sub _add_assign { return $_[1]->_assign_op($_[0], '+') if is_expression($_[1]); my $v=$_[1]; is_vector($v) ? $_[0]->assign($v, sub{$_[0]+$_[1]}) : $_[0]->assign( sub {$_[0]+$v })} 
+sub _sub_assign { return $_[1]->_assign_op($_[0], '-') if is_expression($_[1]); my $v=$_[1]; is_vector($v) ? $_[0]->assign($v, sub{$_[0]-$_[1]}) : $_[0]->assign( sub {$_[0]-$v })} 
+sub _mul_assign { return $_[1]->_assign_op($_[0], '*') if is_expression($_[1]); my $v=$_[1]; is_vector($v) ? $_[0]->assign($v, sub{$_[0]*$_[1]}) : $_[0]->assign( sub {$_[0]*$v })}
+sub _div_assign { return $_[1]->_assign_op($_[0], '/') if is_expression($_[1]); my $v=$_[1]; is_vector($v) ? $_[0]->assign($v, sub{$_[0]/$_[1]}) : $_[0]->assign( sub {$_[0]/$v })}
 
 # Assignment functions
 
@@ -66,11 +66,21 @@ sub _view_selection_like {
 	return Anorman::Data::Vector::SelectedDensePacked->new( $_[0]->_elements, $_[1] );
 }
 
+sub _have_shared_cells_raw {
+	my ($self, $other) = @_;
+
+	return undef unless (is_vector($other) && is_packed($other));
+	return $self->_packed_overlap( $other );
+}
+
 sub assign {
 	my $self = shift;
 	my $type = sniff_scalar($_[0]);
 	my $instance = ref $_[0];
 
+	# deferred expressions evaluate straight into this object
+	return $_[0]->_eval_into( $self ) if is_expression($_[0]);
+
 	if ($type eq 'OBJECT') {
 		$self->_check_size($_[0] );	
 		return $self->SUPER::assign(@_) if ($instance ne 'Anorman::Data::Vector::DensePacked');
@@ -135,7 +145,7 @@ use Inline (C => Config =>
 		NAME      => 'Anorman::Data::Vector::DensePacked',
 		AUTOWRAP  => ENABLE =>
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include',
-		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -landata'
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata'
 	   );
 
 use Inline C => <<'END_OF_C_CODE';
@@ -163,7 +173,7 @@ SV* _bless_vector_struct( SV* sv_class_name ) {
     SV* self;
 
     /* allocate struct memory */
-    Newxz(v, 1, Vector);
+    v = c_vector_header_alloc();
 
     const char* class_name = SvPV_nolen( sv_class_name );
     BLESS_STRUCT( v, self, class_name );
@@ -179,7 +189,7 @@ SV* _clone_self( SV* self ) {
     SV* clone;
 
     /* clone struct */
-    Newx( n, 1, Vector);
+    n = c_vector_header_alloc();
     StructCopy( v, n, Vector);
 
     /* make a blessed perl object */
@@ -367,13 +377,17 @@ void _assign_DensePackedVector_from_OBJECT( SV* self, SV* other ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    if (!u->view_flag && !v->view_flag) {
-        /* direct memcopy when it is safe to do so */
-        Copy( v->elements, u->elements, (UV) u->size, double );
-        return;
-    } else { 
-        c_vv_copy( u, v );
-    } 
+    /* memmove for contiguous vectors, staged copy for overlapping views */
+    if (c_vv_copy( u, v ) != C_SUCCESS) {
+        croak("Failed to copy vector");
+    }
+}
+
+IV _packed_overlap( SV* self, SV* other ) {
+    SV_2STRUCT( self, Vector, u );
+    SV_2STRUCT( other, Vector, v );
+
+    return (IV) c_vv_overlap( u, v );
 }
 
 void _assign_DensePackedVector_from_NUMBER( SV* self, NV value ) {
@@ -473,9 +487,38 @@ NV sum( SV* self ) {
     return c_v_sum( v );
 }
 
+/* $self op= $expression is handed back to Data::Expression, which
+   evaluates the whole tree in one pass */
+static int _is_expression( SV* sv ) {
+    return sv_isobject( sv ) && sv_derived_from( sv, "Anorman::Data::Expression" );
+}
+
+static void _expression_assign_op( SV* self, SV* expr, const char* op ) {
+    dSP;
+
+    ENTER;
+    SAVETMPS;
+    PUSHMARK( SP );
+    XPUSHs( expr );
+    XPUSHs( self );
+    XPUSHs( sv_2mortal( newSVpv( op, 0 ) ) );
+    PUTBACK;
+
+    call_method( "_assign_op", G_DISCARD );
+
+    FREETMPS;
+    LEAVE;
+}
+
 SV* _sub_assign( SV* self, SV* other, SV* swap ) {
     SV_2STRUCT( self, Vector, u );
 
+    if (_is_expression( other )) {
+        _expression_assign_op( self, other, "-" );
+        SvREFCNT_inc( self );
+        return self;
+    }
+
     if (!SvROK(other)) {
         c_v_add_constant( u, -( SvNV( other )));
     } else {
@@ -490,6 +533,12 @@ SV* _sub_assign( SV* self, SV* other, SV* swap ) {
 SV* _add_assign( SV* self, SV* other, SV* swap ) {
     SV_2STRUCT( self, Vector, u );
 
+    if (_is_expression( other )) {
+        _expression_assign_op( self, other, "+" );
+        SvREFCNT_inc( self );
+        return self;
+    }
+
     if (!SvROK(other)) {
         c_v_add_constant( u, SvNV( other ));
     } else {
@@ -504,6 +553,12 @@ SV* _add_assign( SV* self, SV* other, SV* swap ) {
 SV* _div_assign( SV* self, SV* other, SV* swap ) {
     SV_2STRUCT( self, Vector, u );
 
+    if (_is_expression( other )) {
+        _expression_assign_op( self, other, "/" );
+        SvREFCNT_inc( self );
+        return self;
+    }
+
     if (!SvROK(other)) {
         c_v_scale( u, 1 / SvNV( other ) );
     } else {
@@ -518,6 +573,12 @@ SV* _div_assign( SV* self, SV* other, SV* swap ) {
 SV* _mul_assign( SV* self, SV* other, SV* swap ) {
     SV_2STRUCT( self, Vector, u );
 
+    if (_is_expression( other )) {
+        _expression_assign_op( self, other, "*" );
+        SvREFCNT_inc( self );
+        return self;
+    }
+
     if (!SvROK(other)) {
         c_v_scale( u, SvNV( other ) );
     } else {
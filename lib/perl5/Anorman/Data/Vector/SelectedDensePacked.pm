@@ -71,23 +71,23 @@ sub _like_vector {
 
 sub _have_shared_cells_raw {
 	my ($self, $other) = @_;
-	trace_error("BREAK");
+
 	return undef unless (is_vector($other) && is_packed($other));
 	return $self->_elements == $other->_elements;
 }
 
 #TODO: These methods should be called from Vector class. Invesitage why methods are always overwritten by Abstract Data Class
-sub _add_assign { is_vector($_[1]) ? $_[0]->assign($_[1], sub{$_[0]+$_[1]}) : my $v=$_[1]; $_[0]->assign( sub {$_[0]+$v })} 
+sub _add_assign { return $_[1]->_assign_op($_[0], '+') if is_expression($_[1]); my $v=$_[1]; is_vector($v) ? $_[0]->assign($v, sub{$_[0]+$_[1]}) : $_[0]->assign( sub {$_[0]+$v })} 
 #sub _sub_assign { is_vector($_[1]) ? $_[0]->assign($_[1], sub{$_[0]-$_[1]}) : my $v=$_[1]; $_[0]->assign( sub {$_[0]-$v })} 
-sub _sub_assign { $_[0]->_assign_Vector_from_OBJECT_and_CODE($_[1], sub{$_[0]-$_[1]}) } 
-sub _mul_assign { is_vector($_[1]) ? $_[0]->assign($_[1], sub{$_[0]*$_[1]}) : my $v=$_[1]; $_[0]->assign( sub {$_[0]*$v })}
-sub _div_assign { is_vector($_[1]) ? $_[0]->assign($_[1], sub{$_[0]/$_[1]}) : my $v=$_[1]; $_[0]->assign( sub {$_[0]/$v })}
+sub _sub_assign { return $_[1]->_assign_op($_[0], '-') if is_expression($_[1]); $_[0]->_assign_Vector_from_OBJECT_and_CODE($_[1], sub{$_[0]-$_[1]}) } 
+sub _mul_assign { return $_[1]->_assign_op($_[0], '*') if is_expression($_[1]); my $v=$_[1]; is_vector($v) ? $_[0]->assign($v, sub{$_[0]*$_[1]}) : $_[0]->assign( sub {$_[0]*$v })}
+sub _div_assign { return $_[1]->_assign_op($_[0], '/') if is_expression($_[1]); my $v=$_[1]; is_vector($v) ? $_[0]->assign($v, sub{$_[0]/$_[1]}) : $_[0]->assign( sub {$_[0]/$v })}
 
 use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::Data::Vector::SelectedDensePacked',
 		ENABLE    => AUTOWRAP =>
-		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR  . '/include'
 
            );
@@ -114,7 +114,7 @@ SV* _bless_vector_struct( SV* sv_class_name ) {
     SV* self;
 
     /* allocate struct memory */
-    Newxz(v, 1, Vector);
+    v = c_vector_header_alloc();
 
     const char* class_name = SvPV_nolen( sv_class_name );
     BLESS_STRUCT( v, self, class_name );
@@ -130,7 +130,7 @@ SV* _clone_self( SV* self ) {
     SV* clone;
 
     /* clone struct */
-    Newx( n, 1, Vector);
+    n = c_vector_header_alloc();
     StructCopy( v, n, Vector);
 
     /* make a blessed perl object */
@@ -0,0 +1,308 @@
+package Anorman::Data::Vector::Sparse;
+
+# A vector that only stores its non-zero cells, in a native hash map
+# (see Anorman::Data::Map::IntDouble). Meant for very wide and mostly
+# empty data, such as k-mer spectra with k >= 6. Products and distances
+# against packed dense vectors run over the non-zero cells only
+
+use strict;
+use warnings;
+
+use parent qw(Anorman::Data::Abstract Anorman::Data::Vector);
+
+use Anorman::Common qw(sniff_scalar trace_error);
+use Anorman::Data::LinAlg::Property qw( :vector is_sparse );
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	trace_error("Wrong number of arguments") if @_ != 1;
+
+	if (ref $_[0] eq 'ARRAY') {
+		my $self = _XS_new( $class, scalar @{ $_[0] } );
+		my $i    = @{ $_[0] };
+
+		while (--$i >= 0) {
+			$self->set_quick( $i, $_[0]->[ $i ] ) if $_[0]->[ $i ];
+		}
+
+		return $self;
+	}
+
+	return _XS_new( $class, $_[0] );
+}
+
+sub like {
+	my $self = shift;
+	return $self->new( @_ == 1 ? $_[0] : $self->size );
+}
+
+sub copy { $_[0]->_XS_copy }
+
+sub assign {
+	my $self = shift;
+
+	# zero is the state of an empty map
+	if (@_ == 1 && sniff_scalar($_[0]) eq 'NUMBER' && $_[0] == 0) {
+		$self->clear;
+		return $self;
+	}
+
+	return $self->SUPER::assign(@_);
+}
+
+# indexes and values of the non-zero cells, in ascending order
+sub nonzeros {
+	my $self = shift;
+	my ($indexes, $values) = ([], []);
+
+	$self->_XS_nonzeros( $indexes, $values );
+
+	return ($indexes, $values);
+}
+
+sub dot_product {
+	my ($self, $other) = @_;
+
+	return $self->SUPER::dot_product(@_) if @_ > 2;
+
+	$self->_check_size( $other );
+
+	return $self->_XS_dot_sparse( $other ) if is_sparse($other);
+	return $self->_XS_dot_dense( $other )  if is_packed($other);
+
+	my ($indexes, $values) = $self->nonzeros;
+	my $sum = 0;
+
+	$sum += $values->[ $_ ] * $other->get_quick( $indexes->[ $_ ] ) foreach (0 .. $#{ $indexes });
+
+	return $sum;
+}
+
+# squared euclidean distance to a dense vector
+sub squared_distance {
+	my ($self, $other) = @_;
+
+	$self->_check_size( $other );
+
+	return $self->_XS_squared_distance( $other ) if is_packed($other);
+
+	my $dot = $self->dot_product( $other );
+	my $n2  = 0;
+
+	$n2 += $_ * $_ foreach @{ $other->_to_array };
+
+	my $d = $self->_XS_norm2 - 2 * $dot + $n2;
+
+	return $d > 0 ? $d : 0;
+}
+
+sub to_dense {
+	my $self  = shift;
+
+	require Anorman::Data;
+	my $dense = Anorman::Data->vector( $self->size );
+
+	if (is_packed($dense)) {
+		$self->_XS_to_dense( $dense );
+	} else {
+		my ($indexes, $values) = $self->nonzeros;
+		$dense->set_quick( $indexes->[ $_ ], $values->[ $_ ] ) foreach (0 .. $#{ $indexes });
+	}
+
+	return $dense;
+}
+
+sub _check_index {
+	if ($_[1] < 0 || $_[1] >= $_[0]->size) {
+		trace_error("Index $_[1] out of bounds");
+	}
+}
+
+sub _to_short_string {
+	my $self = shift;
+	return "[ " . $self->size . " (" . $self->cardinality . " non-zero) ]";
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Data::Vector::Sparse',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "map.h"
+#include "sparse.h"
+
+#include "../lib/vector.c"
+#include "../lib/matrix.c"
+#include "../lib/threads.c"
+#include "../lib/sparse.c"
+
+SV* _XS_new( SV* sv_class_name, UV size ) {
+    Vector* v = c_sv_alloc( (size_t) size );
+    SV* self;
+
+    if (v == NULL) {
+        croak("Could not create sparse vector");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( v, self, class_name );
+
+    return self;
+}
+
+/* views share the map of their parent */
+SV* _clone_self( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+
+    Vector* n;
+    SV* clone;
+
+    n = c_vector_header_alloc();
+    StructCopy( v, n, Vector );
+
+    const char* class_name = sv_reftype( SvRV( self ), TRUE );
+    BLESS_STRUCT( n, clone, class_name );
+
+    return clone;
+}
+
+SV* _XS_copy( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+
+    Vector* n;
+    SV* copy;
+
+    n = c_vector_header_alloc();
+    n->size     = v->size;
+    n->stride   = 1;
+    n->hash_map = c_idm_copy( v->hash_map );
+
+    const char* class_name = sv_reftype( SvRV( self ), TRUE );
+    BLESS_STRUCT( n, copy, class_name );
+
+    return copy;
+}
+
+UV size( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+    return (UV) v->size;
+}
+
+UV cardinality( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+    return (UV) c_idm_size( v->hash_map );
+}
+
+UV _is_view( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+    return (UV) v->view_flag;
+}
+
+void _set_view( SV* self, IV flag ) {
+    SV_2STRUCT( self, Vector, v );
+    v->view_flag = (int) flag;
+}
+
+NV get_quick( SV* self, UV index ) {
+    SV_2STRUCT( self, Vector, v );
+    return (NV) c_sv_get( v, (size_t) index );
+}
+
+void set_quick( SV* self, UV index, NV value ) {
+    SV_2STRUCT( self, Vector, v );
+    c_sv_set( v, (size_t) index, (double) value );
+}
+
+void add_quick( SV* self, UV index, NV delta ) {
+    SV_2STRUCT( self, Vector, v );
+    c_idm_add( v->hash_map, (size_t) index, (double) delta );
+}
+
+void clear( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+    c_idm_clear( v->hash_map );
+}
+
+void _XS_nonzeros( SV* self, AV* av_indexes, AV* av_values ) {
+    SV_2STRUCT( self, Vector, v );
+
+    const size_t n = c_idm_size( v->hash_map );
+
+    size_t* indexes;
+    double* values;
+    Newx( indexes, n + 1, size_t );
+    Newx( values, n + 1, double );
+
+    c_idm_pairs( v->hash_map, indexes, values );
+
+    av_extend( av_indexes, n );
+    av_extend( av_values, n );
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        av_store( av_indexes, i, newSVuv( (UV) indexes[ i ] ) );
+        av_store( av_values, i, newSVnv( values[ i ] ) );
+    }
+
+    Safefree( indexes );
+    Safefree( values );
+}
+
+NV _XS_norm2( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+    return (NV) c_sv_norm2( v );
+}
+
+NV _XS_dot_sparse( SV* self, SV* other ) {
+    SV_2STRUCT( self, Vector, a );
+    SV_2STRUCT( other, Vector, b );
+
+    return (NV) c_sv_dot_sparse( a, b );
+}
+
+NV _XS_dot_dense( SV* self, SV* other ) {
+    SV_2STRUCT( self, Vector, s );
+    SV_2STRUCT( other, Vector, d );
+
+    return (NV) c_sv_dot_dense( s, d );
+}
+
+NV _XS_squared_distance( SV* self, SV* other ) {
+    SV_2STRUCT( self, Vector, s );
+    SV_2STRUCT( other, Vector, d );
+
+    return (NV) c_sv_sqdist_dense( s, d, c_vv_dot_product( d, d, 0, d->size ) );
+}
+
+void _XS_to_dense( SV* self, SV* other ) {
+    SV_2STRUCT( self, Vector, s );
+    SV_2STRUCT( other, Vector, d );
+
+    c_sv_to_dense( s, d );
+}
+
+/* the map is also exposed for building CSR matrices */
+UV _map_address( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+    return PTR2UV( v->hash_map );
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, Vector, v );
+    c_v_free( v );
+}
+
+END_OF_C_CODE
+
+1;
@@ -70,7 +70,7 @@ sub bestmatches {
 	return $self->{'bm'} if &_has_bm($self);
 
 	if (&_has_wts($self) && &_has_lrn($self)) {
-		($self->{'bm'}, $self->{'distances'}) = project( $self->{'lrn'}, $self->{'wts'} ); 
+		($self->{'bm'}, $self->{'distances'}) = project( $self->{'lrn'}, $self->{'wts'}, $self->{'metric'} ); 
 	} else {
 		$self->{'bm'} = Anorman::ESOM::File::BM->new();
 	}
@@ -78,6 +78,19 @@ sub bestmatches {
 	return $self->{'bm'};
 }
 
+# distance metric used for projection. Undefined means euclidean
+sub metric {
+	my $self = shift;
+
+	if (@_) {
+		$self->{'metric'} = shift;
+		delete $self->{'bm'};
+		delete $self->{'distances'};
+	}
+
+	return $self->{'metric'};
+}
+
 # returns a vector of calculated bestmatch distances
 sub distances {
 	my $self = shift;
@@ -414,7 +427,7 @@ sub train {
 	my $i = -1;
 	while ( ++$i < $self->datapoints ) {
 		my $key = $i + 1;
-		my $neuron_i = $bm_neurons->[$i];
+		my $neuron_i = $bm_neurons->get_quick( $i );
 		my $row = $grid->index2row( $neuron_i );
 		my $col = $grid->index2col( $neuron_i );
 
@@ -8,7 +8,7 @@ use Anorman::Common;
 use Exporter;
 use vars qw(@ISA @EXPORT_OK);
 
-@EXPORT_OK = qw(bm_brute_force_search bm_local_search bm_indexed_search);
+@EXPORT_OK = qw(bm_brute_force_search bm_local_search bm_indexed_search bm_search_rows);
 @ISA       = qw(Exporter);
 
 sub new {
@@ -18,6 +18,9 @@ sub new {
 
 sub som { $_[0]->{'_SOM'} = $_[1] if @_ > 1; $_[0]->{'_SOM'} }
 
+# an Anorman::ESOM::Metrics collecting quality counters, or undef
+sub metrics { $_[0]->{'_metrics'} = $_[1] if @_ > 1; $_[0]->{'_metrics'} }
+
 sub old_bestmatches {}
 
 sub init {}
@@ -35,7 +38,7 @@ sub permutation {}
 use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::ESOM::BMSearch',
-		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lm -lpthread',
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
 
            );
@@ -43,56 +46,133 @@ use Inline C => <<'END_OF_C_CODE';
 
 #include "data.h"
 #include "perl2c.h"
+#include "error.h"
+#include "threads.h"
+#include "rng.h"
+#include "intlist.h"
+#include "metrics.h"
 #include <float.h>
 
-void bm_brute_force_search( SV* vector, SV* weights ) {
+#include "../lib/threads.c"
+#include "../lib/rng.c"
+#include "../lib/intlist.c"
+#include "../lib/metrics.c"
+
+/* the searches take optional trailing (metrics, data row) arguments */
+static TrainMetrics* _bm_metrics( SV* sv_metrics ) {
+    if (!SvROK( sv_metrics )) {
+        return NULL;
+    }
+
+    SV_2STRUCT( sv_metrics, TrainMetrics, m );
+
+    return m;
+}
+
+static const double* _bm_neuron( Matrix* w, size_t i ) {
+    return w->elements + w->row_zero + i * w->row_stride + w->column_zero;
+}
+
+void bm_brute_force_search( SV* vector, SV* weights, ... ) {
     /* search all weights for bestmatch */
     SV_2STRUCT( vector, Vector, v );
     SV_2STRUCT( weights, Matrix, w );
 
-    IV bm  = -1;
-    double min = DBL_MAX;
-    double threshold = min;
-    double dist2; /* square distance */	
+    Inline_Stack_Vars;
 
-    long double diff;
+    TrainMetrics* m     = Inline_Stack_Items > 3 ? _bm_metrics( Inline_Stack_Item(2) ) : NULL;
+    const double  start = m ? c_metrics_clock() : 0.0;
 
-    double* v_elems = v->elements;
-    double* w_elems = w->elements;
+    const double* v_elems = v->elements + v->zero;
+
+    BMScan scan;
+    c_bm_scan_init( &scan );
 
-    /* highly optimized search. Will only measure euclidean distance */    
+    /* partial distances are abandoned once they exceed the best (or
+       second best when collecting metrics) match. Euclidean only */
     size_t i;
     for (i = 0; i < w->rows; i++) {
-        size_t w_index = (v->size + i * w->row_stride) - 1;
-        size_t v_index = (v->zero + v->size - 1);
+        c_bm_scan_neuron( &scan, v_elems, _bm_neuron( w, i ), v->size, i, m != NULL );
+    }
 
-        diff = v_elems[ v_index ] - w_elems[ w_index ];
-        dist2 = (diff * diff); 
-    
-        int k = v->size - 1;
-        while ( --k >= 0) {
-            v_index--;
-            w_index--;
-            if (dist2 > threshold)
-            break;
-            diff   = v_elems[ v_index ] - w_elems[ w_index ];
-            dist2 += (diff * diff);
+    if (m) {
+        c_metrics_record( m, &m->c, &scan, (size_t) SvUV( Inline_Stack_Item(3) ) );
+        m->c.search_time += c_metrics_clock() - start;
+    }
+
+    /* Prepare return values */
+    Inline_Stack_Reset;
+    Inline_Stack_Push(sv_2mortal(newSViv((IV) scan.bm)));
+    Inline_Stack_Push(sv_2mortal(newSVnv(scan.dist)));
+    Inline_Stack_Done;
+}
+
+struct bm_rows_job_struct
+{
+    Matrix*       data;
+    Matrix*       w;
+    IntList*      bestmatches;
+    Vector*       distances;
+    TrainMetrics* metrics;
+};
+
+typedef struct bm_rows_job_struct BMRowsJob;
+
+static void _bm_rows_range( size_t begin, size_t end, void* arg ) {
+    BMRowsJob*      job   = (BMRowsJob*) arg;
+    TrainMetrics*   m     = job->metrics;
+    const double    start = m ? c_metrics_clock() : 0.0;
+    MetricsCounters local = { 0 };
+
+    size_t r;
+    for (r = begin; r < end; r++) {
+        const double* x = _bm_neuron( job->data, r );
+
+        BMScan scan;
+        c_bm_scan_init( &scan );
+
+        size_t i;
+        for (i = 0; i < job->w->rows; i++) {
+            c_bm_scan_neuron( &scan, x, _bm_neuron( job->w, i ), job->data->columns, i, m != NULL );
         }
 
-        if ( dist2 < min ) {
-             min = dist2;
-             bm  = (IV) i;
-             threshold = dist2;
+        if (m) {
+            c_metrics_record( m, &local, &scan, r );
         }
+
+        c_il_store( job->bestmatches, r, (int64_t) scan.bm );
+        job->distances->elements[ c_v_index( job->distances, r ) ] = scan.dist;
     }
 
-    /* Prepare return values */
-    Inline_Stack_Vars;
+    if (m) {
+        local.search_time = c_metrics_clock() - start;
+        c_metrics_merge( &m->c, &local );
+    }
+}
 
-    Inline_Stack_Reset;
-    Inline_Stack_Push(sv_2mortal(newSViv(bm)));
-    Inline_Stack_Push(sv_2mortal(newSVnv(min)));
-    Inline_Stack_Done;
+/* brute force bestmatches of all data rows, in parallel. Fills the
+   bestmatch list and the squared distances by row */
+void bm_search_rows( SV* sv_data, SV* weights, SV* sv_bestmatches, SV* sv_distances, SV* sv_metrics ) {
+    SV_2STRUCT( sv_data, Matrix, data );
+    SV_2STRUCT( weights, Matrix, w );
+    SV_2STRUCT( sv_bestmatches, IntList, bestmatches );
+    SV_2STRUCT( sv_distances, Vector, distances );
+
+    if (data->columns != w->columns) {
+        croak("Data and weights must have the same number of columns");
+    }
+
+    if (bestmatches->size < data->rows || distances->size < data->rows) {
+        croak("Bestmatch list or distance vector is too short");
+    }
+
+    BMRowsJob job = { data, w, bestmatches, distances, _bm_metrics( sv_metrics ) };
+
+    if (c_parallel_for( data->rows, 16, &_bm_rows_range, &job ) != C_SUCCESS) {
+        croak("Bestmatch search failed");
+    }
+
+    bestmatches->index_stale = 1;
 }
 
 void bm_indexed_search( SV* vector, SV* weights, AV* indices ) {
@@ -147,19 +227,20 @@ void bm_indexed_search( SV* vector, SV* weights, AV* indices ) {
     Inline_Stack_Done;
 }
 
-void bm_local_search( SV* vector, SV* weights, IV top, IV left, IV bottom, IV right, IV grid_rows, IV grid_columns ) {
+void bm_local_search( SV* vector, SV* weights, IV top, IV left, IV bottom, IV right, IV grid_rows, IV grid_columns, ... ) {
     /* search a square area for the best match */
     SV_2STRUCT( vector, Vector, v );
     SV_2STRUCT( weights, Matrix, w );
 
-    double* v_elems = v->elements;
-    double* w_elems = w->elements;
-    
-    int    bm        = -1;
-    double min       = DBL_MAX;
-    double threshold = min;
-    double dist2; /* square distance */	
-    double diff;
+    Inline_Stack_Vars;
+
+    TrainMetrics* m     = Inline_Stack_Items > 9 ? _bm_metrics( Inline_Stack_Item(8) ) : NULL;
+    const double  start = m ? c_metrics_clock() : 0.0;
+
+    const double* v_elems = v->elements + v->zero;
+
+    BMScan scan;
+    c_bm_scan_init( &scan );
 
     int i  = (int) top - 1;
     while ( ++i <= bottom ) {
@@ -170,37 +251,19 @@ void bm_local_search( SV* vector, SV* weights, IV top, IV left, IV bottom, IV ri
             /* locate neuron on grid */
             int neuron_index = (((i + grid_rows) % grid_rows) * grid_columns) + ((j + grid_columns) % grid_columns);
 
-            /* locate vector in weights matrix */
-            int w_index = (neuron_index * w->columns) + w->columns - 1;
-            int v_index = (int) (v->zero + v->size - 1);
-
-            diff = v_elems[ v_index ] - w_elems[ w_index ];
-            dist2 = (diff * diff); 
-    
-            int k = v->size - 1;
-            while ( --k >= 0) {
-                v_index--;
-                w_index--;
-                if (dist2 > threshold)
-                break;
-                diff   = v_elems[ v_index ] - w_elems[ w_index ];
-                dist2  += (diff * diff);
-            }
-
-            if ( dist2 < min ) {
-                 min = dist2;
-                 bm  = neuron_index;
-                 threshold = dist2;
-            }
+            c_bm_scan_neuron( &scan, v_elems, _bm_neuron( w, neuron_index ), v->size, neuron_index, m != NULL );
         }
     }
 
-    /* Prepare return values */
-    Inline_Stack_Vars;
+    if (m) {
+        c_metrics_record( m, &m->c, &scan, (size_t) SvUV( Inline_Stack_Item(9) ) );
+        m->c.search_time += c_metrics_clock() - start;
+    }
 
+    /* Prepare return values */
     Inline_Stack_Reset;
-    Inline_Stack_Push(sv_2mortal(newSViv(bm)));
-    Inline_Stack_Push(sv_2mortal(newSVnv(min)));
+    Inline_Stack_Push(sv_2mortal(newSViv((IV) scan.bm)));
+    Inline_Stack_Push(sv_2mortal(newSVnv(scan.dist)));
     Inline_Stack_Done;
 }
 
@@ -219,29 +282,29 @@ sub new { return shift->SUPER::new() };
 
 sub find_bestmatch {
 	my $self = shift;
-	return Anorman::ESOM::BMSearch::bm_brute_force_search( $_[1], $_[2] );
+
+	return Anorman::ESOM::BMSearch::bm_brute_force_search( $_[1], $_[2] ) unless $self->{'_metrics'};
+	return Anorman::ESOM::BMSearch::bm_brute_force_search( $_[1], $_[2], $self->{'_metrics'}, $_[0] );
 } 
 
 sub slow_find_bestmatch {
 	my $self = shift;
 	my ($func, $vector, $neurons) = @_;
 
-	my $neuron = $neurons->view_row( 0 );
-	my $dim    = $vector->size;
+	my $neuron = $neurons->row_cursor;
 
 	my ($bm, $dist);
 	my $min = DBL_MAX;
 
 	my $i = -1;
 	while ( ++$i < $neurons->rows ) {
+		$neurons->seek_row( $neuron, $i );
 		$dist = $func->( $vector, $neuron, $min );
 
 		if ($dist < $min) {
 			$min        = $dist;
 			$bm         = $i;
 		}
-
-		$neuron->_setup( $neuron->size, $neuron->_zero + $dim, 1 );
 	}
 
 	return ($bm, $dist);
@@ -270,11 +333,13 @@ sub find_bestmatch {
 
 	my ($index, $vector, $weights, $epoch) = @_;
 
+	my @metrics = $self->{'_metrics'} ? ( $self->{'_metrics'}, $index ) : ();
+
 	if ($epoch < 1) {
-		return Anorman::ESOM::BMSearch::bm_brute_force_search( $vector, $weights );
+		return Anorman::ESOM::BMSearch::bm_brute_force_search( $vector, $weights, @metrics );
 	} else {
 		my $range = $self->get_range( $epoch, $index );
-		my $oldbm = $self->{'_old_bestmatches'}->[ $index ];
+		my $oldbm = $self->{'_old_bestmatches'}->get_quick( $index );
 		
 		# find center
 		my $r = $self->som->grid->index2row( $oldbm );
@@ -290,7 +355,7 @@ sub find_bestmatch {
 		my $bottom = int min( $r + ( $rows / 2), $r + $range );
 		my $right  = int min( $c + ( $cols / 2), $c + $range );
 
-		return Anorman::ESOM::BMSearch::bm_local_search( $vector, $weights, $top, $left, $bottom, $right, $rows, $cols );
+		return Anorman::ESOM::BMSearch::bm_local_search( $vector, $weights, $top, $left, $bottom, $right, $rows, $cols, @metrics );
 	}	
 	
 }
@@ -351,10 +416,10 @@ sub old_bestmatches {
 	return $self->{'_old_bestmatches'} if !defined $_[0];
 
 	if (!exists $self->{'_old_bestmatches'}) {
-		$self->{'_old_bestmatches'} = [ @{ $_[0] } ];
+		$self->{'_old_bestmatches'} = $_[0]->copy;
 	} else {
-		$self->{'_older_bestmatches'} = [ @{ $self->{'_old_bestmatches' } } ];
-		$self->{'_old_bestmatches'}   = [ @{ $_[0] } ];
+		$self->{'_older_bestmatches'} = $self->{'_old_bestmatches'};
+		$self->{'_old_bestmatches'}   = $_[0]->copy;
 
 	}
 }
@@ -367,8 +432,8 @@ sub get_range {
 		return $self->som->grid->columns / 2;
 	} else {
 		my $grid    = $self->som->grid;
-		my $oldbm   = $self->{'_old_bestmatches'}->[ $index ];
-		my $olderbm = $self->{'_older_bestmatches'}->[ $index ];
+		my $oldbm   = $self->{'_old_bestmatches'}->get_quick( $index );
+		my $olderbm = $self->{'_older_bestmatches'}->get_quick( $index );
 
 		return $self->{'constant'} if $oldbm == $olderbm;
 
@@ -28,40 +28,40 @@ sub new {
 	return bless ( $self, $class );
 }
 
+# All bestmatches are gathered into packed rows, columns and color
+# numbers, then stamped onto the renderer's image in one native pass
 sub render {
 	my ($self, $renderer) = @_;
 
-	my ($size, $Index);
-	
 	my $esom = $renderer->esom;
 
 	if (defined (my $bestmatches = $esom->bestmatches)) {
 		my $zoom = $renderer->zoom;
-		my $w 	 = $esom->columns * $zoom;
-		my $h    = $esom->rows    * $zoom;
+		my $size = $zoom <= 2 ? $zoom * $self->{'bmsize'} : ($zoom - 2) * $self->{'bmsize'};
+
+		my (@rows, @columns, @classes);
+
+		# color 0 is the favourite color, classes follow as they appear
+		$self->{'palette'} = [ $self->{'favouritecolor'} ];
+		$self->{'slots'}   = {};
 
-		$self->{'gd'} = $renderer->image;
-		
-		# Render bestmatches
 		my $i = -1;
 		while ( ++$i < $bestmatches->data->size ) {
-			my $bm    = $bestmatches->data->get( $i );
-			my $index = $bm->index;
-			my $size  = $zoom <= 2 ? $zoom * $self->{'bmsize'} : ($zoom - 2) * $self->{'bmsize'};
-			my $x     = $bm->column * $zoom;
-			my $y     = $bm->row    * $zoom;
-
-			my @options = ($size, $size, $index, $renderer);
-
-			$self->_draw_bestmatch( $x, $y, @options);
-			
-			# Draw other quadrants in toroid mode
-			if ($renderer->tiled) {
-				$self->_draw_bestmatch(($x + $w) % (2 * $w), $y                  , @options);
-				$self->_draw_bestmatch($x                  , ($y + $h) % (2 * $h), @options);
-				$self->_draw_bestmatch(($x + $w) % (2 * $w), ($y + $h) % (2 * $h), @options);
-			}
+			my $bm = $bestmatches->data->get( $i );
+
+			push @rows,    $bm->row;
+			push @columns, $bm->column;
+			push @classes, $self->_get_color( $bm->index );
 		}
+
+		$renderer->image->glyphs( \@rows, \@columns, \@classes, $self->{'palette'},
+			'map_rows'    => $esom->rows,
+			'map_columns' => $esom->columns,
+			'zoom'        => $zoom,
+			'size'        => $size,
+			'circle'      => $self->{'circle'} ? 1 : 0,
+			'tiled'       => $renderer->tiled ? 1 : 0
+		);
 	}
 }
 
@@ -71,35 +71,30 @@ sub classification {
 	$self->{'classification'} = $_[0] if $_[0]->isa("Anorman::ESOM::File::Cls");
 }
 
-sub _draw_bestmatch {
-	my $self = shift;
-	my ($x, $y, $sizex, $sizey, $index, $renderer) = @_;
-
-	my $c = $self->_get_color($index);
-
-	if ($self->{'circle'}) {
-		$self->{'gd'}->filledEllipse($x, $y, $sizex, $sizey, $c); 
-	} else {
-		$self->{'gd'}->filledRectangle( $x, $y, $x + $sizex - 1, $y + $sizey - 1, $c );
-	}
-}
-
+# palette number of the color of a datapoint
 sub _get_color {
 	my ($self,$index) = @_;
 
-	my $gd = $self->{'gd'};
-	my $c  = $self->{'favouritecolor'};
-
 	# Apply class color if a classification table is present
-	if (defined (my $cls = $self->{'classification'})) {
-		my $class_i = $cls->get_by_index( $index );
-		my $class   = $cls->classes->get( $class_i );
+	my $cls = $self->{'classification'};
+	return 0 unless defined $cls;
+
+	my $class_i = $cls->get_by_index( $index );
+	return 0 unless defined $class_i;
+
+	unless (exists $self->{'slots'}->{ $class_i }) {
+		my $class = $cls->classes->get( $class_i );
+		my $slot  = 0;
+
+		if (defined $class && defined $class->color) {
+			push @{ $self->{'palette'} }, $class->color;
+			$slot = $#{ $self->{'palette'} };
+		}
 
-		$c = $class->color if defined $class->color;
+		$self->{'slots'}->{ $class_i } = $slot;
 	}
 
-	# Return index of existing- or newly allocated color	
-	return $gd->colorResolve( $c->rgb );
+	return $self->{'slots'}->{ $class_i };
 }
 
 1;
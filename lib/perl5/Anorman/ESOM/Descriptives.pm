@@ -20,9 +20,13 @@ sub new {
 		     '_minima' => undef,
 		     '_means'  => undef,
 		     '_stdevs' => undef,
+		     '_variances' => undef,
+		     '_quantiles' => {},
 		     '_cov'    => undef,
 		     '_ev'     => undef,
-		     '_evd'    => undef
+		     '_evals'  => undef,
+		     '_pca_method' => 'eigen',
+		     '_pca_k'  => 3
 	};
 
 	bless ( $self, ref $class || $class);
@@ -37,10 +41,43 @@ sub stdevs { $_[0]->{'_stdevs'} }
 sub means  { $_[0]->{'_means'}  }
 sub size   { $_[0]->{'_size'}   }
 
+sub variances { $_[0]->{'_variances'} }
+
+sub quantile {
+	# approximate column quantiles, computed on first request
+	my $self = shift;
+	my $phi  = shift;
+
+	if (!exists $self->{'_quantiles'}->{ $phi }) {
+		($self->{'_quantiles'}->{ $phi }) = 
+			Anorman::Data::Algorithms::Statistic::column_quantiles( $self->{'_data'}, [ $phi ] );
+	}
+
+	return $self->{'_quantiles'}->{ $phi };
+}
+
+sub medians { $_[0]->quantile(0.5) }
+
+sub pca_method {
+	# 'eigen' or 'randomized'. Only the leading components are ever computed
+	my $self = shift;
+
+	if (@_) {
+		my $method = shift;
+		trace_error("Unknown PCA method '$method'") unless ($method eq 'eigen' || $method eq 'randomized');
+
+		$self->{'_pca_method'} = $method;
+		$self->{'_ev'}         = undef;
+		$self->{'_evals'}      = undef;
+	}
+
+	return $self->{'_pca_method'};
+}
+
 sub covariance {
 	my $self = shift;
 
-	$self->_calc_pca unless defined $self->{'_cov'};
+	$self->{'_cov'} = Anorman::Data::Algorithms::Statistic::covariance( $self->{'_data'} ) unless defined $self->{'_cov'};
 
 	return $self->{'_cov'};
 }
@@ -49,7 +86,7 @@ sub eigenvalue {
 	my $self = shift;
 	my $i    = shift;
 
-	return $self->eigenvalues->get( $self->{'_data'}->columns - $i - 1 );
+	return $self->eigenvalues->get( $i );
 }
 
 sub first_eigenvalue {
@@ -72,9 +109,9 @@ sub third_eigenvalue {
 sub eigenvalues {
 	my $self = shift;
 	
-	$self->_calc_pca unless defined $self->{'_evd'};
+	$self->_calc_pca unless defined $self->{'_evals'};
 
-	return $self->{'_evd'}->getRealEigenvalues;
+	return $self->{'_evals'};
 }
 
 sub eigenvectors {
@@ -88,7 +125,7 @@ sub eigenvectors {
 sub eigenvector {
 	my $self = shift;
 	my $i    = shift;
-	return $self->eigenvectors->view_column( $self->{'_data'}->columns - $i - 1);
+	return $self->eigenvectors->view_column( $i );
 }
 
 sub first_eigenvector {
@@ -110,9 +147,9 @@ sub projection {
 	my $self = shift;
 	my $i    = shift;
 
-	$self->_calc_pca unless defined $self->{'_evd'};
+	$self->_calc_pca unless defined $self->{'_ev'};
 
-	my $ev = $self->get_eigenvector($i);
+	my $ev = $self->eigenvector($i);
 
 }
 
@@ -120,75 +157,44 @@ sub _calculate_descriptives {
 	my $self = shift;
 	my $A    = $self->{'_data'};
 
-	my $M = $A->columns;
-	my $N = $A->rows;
-	my $v = $A->like_vector( $M );
-
-	# this pre-loads first row into minima, maxima and sums
-	my $row0   = [ @{ $A->view_row(0) } ];
-	my $sums   = [ @{ $row0 } ];
-	my $minima = [ @{ $row0 } ];
-	my $maxima = [ @{ $row0 } ];
-
-	my $stdevs = [];
-	my $means  = [];
-
-	my ($i,$j);
-	
 	warn "Calculating descriptives...\n" if $VERBOSE;
 
-	$i = $N;
-
-	# skips first row, since it was already loaded
-	while ( --$i > 0 ) {
-	
-		$j = $M;
-		while ( --$j >= 0 ) {
-			my $val   = $A->get_quick( $i, $j );
-
-			$sums->[ $j ]  += $val;
-			$minima->[ $j ] = $minima->[ $j ] < $val ? $minima->[ $j ] : $val;
-			$maxima->[ $j ] = $maxima->[ $j ] > $val ? $maxima->[ $j ] : $val;
-		}
-
-	}
-	
-	$j = $M;
-	while ( --$j >= 0 ) {
-		$means->[ $j ] = $sums->[ $j ] / $N;
-	}
-	
-	$i = $N;
-	while ( --$i >= 0 ) {
-	
-		$j = $M;
-		while ( --$j >= 0 ) {
-			my $diff = $means->[ $j ] - $A->get_quick( $i, $j );
+	# one fused pass over the data (see Data::Algorithms::Statistic)
+	my $stats = Anorman::Data::Algorithms::Statistic::column_statistics( $A );
 
-			$stdevs->[ $j ] += ($diff * $diff);
-		}
-
-	}
-
-	foreach (@{ $stdevs }) { $_ = sqrt( $_ / ($N - 1) )};
-
-	$self->{'_minima'} = $v->like->assign( $minima );
-	$self->{'_maxima'} = $v->like->assign( $maxima );
-	$self->{'_means'}  = $v->like->assign( $means  );
-	$self->{'_stdevs'} = $v->like->assign( $stdevs );
-	$self->{'_size'}   = $N;
+	$self->{'_minima'}    = $stats->{'minima'};
+	$self->{'_maxima'}    = $stats->{'maxima'};
+	$self->{'_means'}     = $stats->{'means'};
+	$self->{'_variances'} = $stats->{'variances'};
+	$self->{'_stdevs'}    = $stats->{'variances'}->copy->assign( sub { sqrt $_[0] } );
+	$self->{'_size'}      = $stats->{'size'};
 }
 
 sub _calc_pca {
+	# leading principal components, largest first
 	my $self = shift;
 	my $data = $self->{'_data'};
+	my $k    = $self->{'_pca_k'} < $data->columns ? $self->{'_pca_k'} : $data->columns;
+
+	trace_error("No principal components of sparse data, use another grid initialization")
+		if $data->isa('Anorman::Data::Matrix::CSR');
 
-	warn "Calculating Covariance matrix...\n" if $VERBOSE;
-	$self->{'_cov'} = Anorman::Data::Algorithms::Statistic::covariance( $data );
+	if (is_packed( $data )) {
+		warn "Calculating $k principal components ($self->{'_pca_method'})...\n" if $VERBOSE;
+
+		($self->{'_evals'}, $self->{'_ev'}) = 
+			Anorman::Data::Algorithms::Statistic::truncated_pca( $data, $self->{'_means'}, $k, $self->{'_pca_method'} );
+
+		return;
+	}
 
 	warn "Calculating Eigenvalues...\n" if $VERBOSE;
-	$self->{'_evd'} = Anorman::Data::LinAlg::EigenValueDecomposition->new( $self->{'_cov'} );
-	$self->{'_ev'}  = $self->{'_evd'}->getV;
+	my $evd  = Anorman::Data::LinAlg::EigenValueDecomposition->new( $self->covariance );
+	my @desc = reverse( ($data->columns - $k) .. ($data->columns - 1) );
+
+	# decomposition returns ascending eigenvalues
+	$self->{'_evals'} = $evd->getRealEigenvalues->view_selection( \@desc )->copy;
+	$self->{'_ev'}    = $evd->getV->view_selection( undef, \@desc )->copy;
 }
 
 1;
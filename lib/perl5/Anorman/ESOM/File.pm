@@ -96,6 +96,7 @@ sub new {
 	my $self   = {  'type'     => $type,
 			'filename' => $filename,
 			'header'   => [],
+			'comments' => [],
 			'parser'   => $parser
 		     }; 
 	return bless ( $self, $class ); 
@@ -142,6 +143,10 @@ sub save {
 
 	$self->_build_header;
 
+	foreach my $line(@{ $self->{'comments'} }) {
+		print $FH "$COMMENT_PREFIX $line\n";
+	}
+
 	foreach my $line(@{ $self->{'header'} }) {
 		print $FH "%$line\n"; 
 	}
@@ -162,6 +167,10 @@ sub save {
 # Internal parser of the current data type
 sub parser     { $_[0]->{'parser'} }
 sub header     { $_[0]->{'header'} }
+
+# free text written as comment lines on save, e.g. the training seed.
+# Comments are skipped when a file is loaded
+sub add_comment { push @{ $_[0]->{'comments'} }, $_[1] }
 sub type       { $_[0]->{'type'} }
 sub rows       { $_[0]->{'rows'} }
 sub keys       { $_[0]->{'keys'} }
@@ -6,6 +6,7 @@ use warnings;
 use parent 'Anorman::ESOM::File::Matrix';
 
 use Anorman::Common;
+use Anorman::Data::List::PackedInt;
 
 sub new {
 	my $class = shift;
@@ -40,8 +41,8 @@ sub _init {
 	}
 
 	$self->SUPER::_init( $self->{'datapoints'}, $self->{'dim'} );
-	$self->{'keys'} = Anorman::Data::List->new($rows);
-	@{ $self->{'keys'} } = (1 .. $rows);
+	$self->{'keys'} = Anorman::Data::List::PackedInt->range( 1, $rows, 'uint32' );
+	$self->{'keys'}->use_index(1);
 }
 
 sub var_names {
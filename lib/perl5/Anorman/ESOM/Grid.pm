@@ -7,8 +7,7 @@ use Anorman::Math::VectorFunctions;
 use Anorman::Data::LinAlg::Property qw(is_matrix);
 
 # Random number generators
-use Math::Random::MT::Auto qw(gaussian);
-use Math::Random::MT::Auto::Range;
+use Anorman::Math::Random qw(fill_uniform fill_gaussian grid_stream);
 
 sub new {
 	my $class = shift;
@@ -69,64 +68,40 @@ sub init {
 	$method = 'zero' if !defined $desc;
 
 	my $dim  = $self->dim;
-	my $size = $self->size;  
 
 	warn "Initializing grid (Method: $method)\n" if $VERBOSE;
 
 	trace_error("Grid weights have not been set. Cannot initialize") unless is_matrix( $self->get_weights );
 
+	# columns are filled natively, each from its own stream of the run seed
+	my $W = $self->get_weights;
+
 	if ($method eq 'norm_mean_2std') {
 		# generate random vectors based on gaussian distribution [ mean ± 2stdevs ] from input descriptives
 		my $j = -1;
 		while (++$j < $dim) {
 			my $sd   = $desc->stdevs->[ $j ];
 			my $mean = $desc->means->[ $j ];
-			my $i = $size;
-			my $vals = [];
-
-			while (--$i >= 0) {
-				$vals->[ $i ] =  gaussian( 2 * $sd, $mean ); 
-			}
 
-			$self->get_weights->view_column( $j )->assign( $vals );
+			fill_gaussian( $W->view_column( $j ), $mean, 2 * $sd, grid_stream( $j ) );
 		}
 	} elsif ($method eq 'uni_min_max') {
 		# generate random vectors based on uniform distribution [ min, max ]
-		my $uniform = Math::Random::MT::Auto::Range->new( LO => 0.0 , HI => 1.0, TYPE => 'DOUBLE');
-
 		my $j = -1;
 		while ( ++$j < $dim ) {
 			my $min = $desc->minima->[ $j ];
 			my $max = $desc->maxima->[ $j ];
 
-			$uniform->set_range( $min, $max );
-			my $i = $size;
-			my $vals = [];
-
-			while ( --$i >= 0 ) {
-				$vals->[ $i ] = $uniform->rrand()
-			}
-
-			$self->get_weights->view_column( $j )->assign( $vals );
+			fill_uniform( $W->view_column( $j ), $min, $max, grid_stream( $j ) );
 		}
 
 	} elsif ($method eq 'uni_mean_2std') {
-		my $uniform = Math::Random::MT::Auto::Range->new( LO => 0.0 , HI => 1.0, TYPE => 'DOUBLE');
-
 		my $j = -1;
 		while ( ++$j < $dim ) {
 			my $sd   = $desc->stdevs->[ $j ];
 			my $mean = $desc->means->[ $j ];
 
-			$uniform->set_range( $mean - (2 * $sd), $mean + (2 * $sd) );
-			my $i = $size;
-			my $vals = [];
-
-			while ( --$i >= 0 ) {
-				$vals->[ $i ] = $uniform->rrand()
-			}
-
-			$self->get_weights->view_column( $j )->assign( $vals );
+			fill_uniform( $W->view_column( $j ), $mean - (2 * $sd), $mean + (2 * $sd), grid_stream( $j ) );
 		}
 
 	} elsif ($method eq 'zero') {
@@ -293,24 +268,12 @@ sub init {
 	
 	if (defined $method && $method eq 'pca') {
 		warn "Initializing grid using the pca method\n" if $VERBOSE;
-		my $i = 0;
-		while ( ++$i <= $self->rows ) {
-			my $row_factor = ( $i - ($self->rows / 2) - 0.5) / (($self->rows / 2) - 0.5);
-
-			my $j = 0;
-			while ( ++$j < $self->columns ) {
-				my $col_factor = ($j - ($self->columns / 2) - 0.5) / (($self->columns / 2) - 0.5);
-				my $neuron = $self->get_neuron( $i - 1, $j - 1);
-				my $d = -1;
-
-				while ( ++$d < $self->dim ) {
-					$neuron->set( $d, $desc->means->[ $d ] 
-					+ (2 * $row_factor * $desc->first_eigenvalue  * $desc->first_eigenvector->get($d))
-					+ (2 * $col_factor * $desc->second_eigenvalue * $desc->second_eigenvector->get($d)));
-				}
-			}
-		
-		}
+
+		# spread the grid across the plane of the two leading principal components
+		_pca_fill( $self->get_weights, $desc->means, 
+			   $desc->first_eigenvector, $desc->second_eigenvector,
+			   $desc->first_eigenvalue, $desc->second_eigenvalue,
+			   $self->rows, $self->columns );
 	} else {
 		$self->SUPER::init(@_);
 	}
@@ -381,6 +344,9 @@ use Inline (C => Config =>
 use Inline C => <<'END_OF_C_CODE';
 
 #include "perl2c.h"
+#include "data.h"
+#include "vector.h"
+#include "matrix.h"
 #include <stddef.h>
 
 static int min( int, int );
@@ -594,6 +560,52 @@ int max ( int x, int y ) {
 	return x > y ? x : y;
 }
 
+/* w(i,j) = mean + 2 * rf(i) * l1 * v1 + 2 * cf(j) * l2 * v2 */
+void _pca_fill( SV* sv_W, SV* sv_means, SV* sv_v1, SV* sv_v2, double l1, double l2, int rows, int columns ) {
+    SV_2STRUCT( sv_W, Matrix, W );
+    SV_2STRUCT( sv_means, Vector, mean );
+    SV_2STRUCT( sv_v1, Vector, v1 );
+    SV_2STRUCT( sv_v2, Vector, v2 );
+
+    const size_t dim = W->columns;
+
+    if (W->rows != (size_t) (rows * columns) || mean->size != dim || v1->size != dim || v2->size != dim) {
+        croak("Grid and descriptives dimensions do not match");
+    }
+
+    double* a = (double*) malloc( dim * sizeof(double) );
+    double* b = (double*) malloc( dim * sizeof(double) );
+    double* m = (double*) malloc( dim * sizeof(double) );
+
+    size_t d;
+    for (d = 0; d < dim; d++) {
+        a[ d ] = 2 * l1 * c_v_get_quick( v1, d );
+        b[ d ] = 2 * l2 * c_v_get_quick( v2, d );
+        m[ d ] = c_v_get_quick( mean, d );
+    }
+
+    const double half_r = rows / 2.0;
+    const double half_c = columns / 2.0;
+
+    int i, j;
+    for (i = 1; i <= rows; i++) {
+        const double rf = ( i - half_r - 0.5 ) / ( half_r - 0.5 );
+
+        for (j = 1; j <= columns; j++) {
+            const double cf  = ( j - half_c - 0.5 ) / ( half_c - 0.5 );
+            const size_t row = (size_t) (i - 1) * columns + (j - 1);
+
+            for (d = 0; d < dim; d++) {
+                c_m_set_quick( W, row, d, m[ d ] + rf * a[ d ] + cf * b[ d ] );
+            }
+        }
+    }
+
+    free( a );
+    free( b );
+    free( m );
+}
+
 END_OF_C_CODE
 
 1;
@@ -1,219 +1,65 @@
 package Anorman::ESOM::GrowGrid;
 
 # A module for handling growing of ESOM weight grids
-# Internally, the grid is copied and expanded in both directions. New weight
-# vectors are interpolated according to their neighboring vectors
+# The old neurons are spread evenly over a new, larger grid of the same
+# type and the neurons inserted between them are interpolated from
+# their old neighbours, the mean of both sides or weighted by distance
+# (bilinear). Growing is native, straight into the new weight matrix
+# (src/anorman/lib/grow.c)
 
 use vars qw($VERSION @EXPORT @ISA);
 
 require Exporter;
 
 @ISA = qw(Exporter);
-@EXPORT = qw (grow_grid);
+@EXPORT = qw (grow_grid grow_bestmatches);
 
-$VERSION = '0.4';
+$VERSION = '0.5';
 
+use strict;
 
 use Anorman::Common;
 use Anorman::ESOM::Grid;
-use Anorman::Data::Matrix;
-use POSIX qw(floor);
-use List::Util qw(min max);
+use Anorman::Data::LinAlg::Property qw(is_matrix);
 
-# default internal interpolator
-my $interp   = Anorman::ESOM::GrowGrid::Interpolator::Mean->new();
+my %METHODS = ( 'mean' => 0, 'bilinear' => 1 );
 
 # grows the grid and interpolates between old neurons to fill in larger grid
 sub grow_grid {
 	&_check_grid($_[0]);
 	&_check_growth_dims(@_);
 
-	my ( $old_grid, $new_rows, $new_cols ) = @_;
-
-	warn "Grow grid [ " . $old_grid->rows . " x " . $old_grid->columns . " ] => [ $new_rows x $new_cols ]\n";
-
-	my $tmp_grid    = Anorman::ESOM::Grid::ToroidEuclidean->new;
-	my $tmp_weights = Anorman::Data::Matrix::DensePacked->new( $new_cols * $old_grid->rows, $old_grid->dim );
-
-	$tmp_grid->rows( $old_grid->rows );
-	$tmp_grid->columns( $new_cols );
-	$tmp_grid->dim( $old_grid->dim );
-	$tmp_grid->set_weights( $tmp_weights );
-	
-	$interp->set_grid( $tmp_grid );
+	my ( $old_grid, $new_rows, $new_cols, $method ) = @_;
 
-	&_grow_columns( $old_grid, $tmp_grid );
+	$method = 'mean' unless defined $method;
+	trace_error("Unknown interpolation method $method") unless exists $METHODS{ $method };
 
-	my $new_grid    = Anorman::ESOM::Grid::ToroidEuclidean->new;
-	my $new_weights = Anorman::Data::Matrix::DensePacked->new( $new_rows * $new_cols, $tmp_grid->dim );
+	warn "Grow grid [ " . $old_grid->rows . " x " . $old_grid->columns . " ] => [ $new_rows x $new_cols ] ($method)\n" if $VERBOSE;
 
-	$new_grid->rows( $new_rows);
-	$new_grid->columns( $new_cols );
-	$new_grid->dim( $tmp_grid->dim );
-	$new_grid->set_weights( $new_weights );
+	my $new_grid = ref($old_grid)->new( $new_rows, $new_cols, $old_grid->dim );
+	$new_grid->distance_function( $old_grid->distance_function );
 
-	$interp->set_grid( $new_grid );
+	trace_error("Grid weights have not been set. Cannot grow") unless is_matrix( $old_grid->get_weights );
 
-	&_grow_rows( $tmp_grid, $new_grid );
+	_XS_grow( $old_grid->get_weights, $new_grid->get_weights,
+		  $old_grid->rows, $old_grid->columns, $new_rows, $new_cols,
+		  _is_toroid( $old_grid ), $METHODS{ $method } );
 
-	warn "Done growing\n";
-
-	return $new_grid; 
+	return $new_grid;
 }
 
-sub _grow_rows {
-	warn "Growing rows...\n";
-	my ($old_grid, $new_grid ) = @_;
-
-	my ($old_rows, $old_cols) = ($old_grid->rows, $old_grid->columns);
-	my ($new_rows, $new_cols) = ($new_grid->rows, $new_grid->columns);
-	my $dim = $old_grid->dim;
-
-	my $new_weights = $new_grid->get_weights;
-
-	# calculate number of interpolation steps per row
-	my $row_step = max(1,floor( 0.5 + ($old_rows / max( 1, $new_rows - $old_rows)))); 	
-
-	my $counter_all = 0;
-	my $counter     = 0;
-
-	my ($c, $r, $s);
-
-	$c = -1;
-	while ( ++$c < $new_cols ) {
-		
-		# create buffer for row slice (i.e. a row of neruon-vectors)
-		my $row = Anorman::Data::Matrix::DensePacked->new( $new_rows, $dim );
-
-		my $counter_row = 0;
-		my $counter_nan = 0;
-
-		$r = -1;
-		while ( ++$r < $new_rows) {
-			
-			# transfer existing neuron from old grid
-			$s = -1;
-			while ( ++$s < $row_step ) {
-				if ($r < $new_rows) {
-					my $old_index  = $old_grid->coords2index($r - $counter_nan, $c);
-					my $old_neuron = $old_grid->get_neuron( $old_index );
-
-					$row->view_row( $r )->assign( $old_neuron );
-					$r++;
-					$counter_row++;
-				}
-
-			}
-
-			# insert empty neuron
-			if ($r < $new_rows) {
-				$row->view_row( $r )->assign( nan );
-				$counter_row++;
-				$counter_nan++;
-			}
-		}
-
-		# transfer expanded row slice to new grid
-		my $a = $counter_all - 1;
-		while ( ++$a < ($counter_all + $counter_row) ) {
-			my $index = (( $a - $counter_all) * $new_cols) + $counter;
-			my $buffer_row = $new_weights->view_row( $index );
-			my $row_slice  = $row->view_row( $a - $counter_all );
-
-			$buffer_row->assign( $row_slice );
-			
-		}
-
-		$counter_all += $counter_row;
-		$counter++;
-	}
-
-	print STDERR $new_weights;
-	# interpolate into empty neurons
-	my $i = -1;
-	while ( ++$i < $new_weights->rows ) {
-		my $probe_val = $new_weights->view_row( $i )->get(0);
-		
-		if ($probe_val != $probe_val) { # test for NaN values
-			$new_weights->view_row( $i )->assign( $interp->interpolate_row($i) );
-		}
-	}	
-}
-
-sub _grow_columns {
-	warn "Growing columns...\n";
-	my ($old_grid, $new_grid ) = @_;
-
-	my ($old_rows, $old_cols) = ($old_grid->rows, $old_grid->columns);
-	my ($new_rows, $new_cols) = ($new_grid->rows, $new_grid->columns);
-
-	my $dim     = $old_grid->dim;
-	my $new_weights = $new_grid->get_weights;
-
-	# calculate number of interpolation steps per column
-	my $col_step = max(1,floor( 0.5 + ($old_cols / max( 1, $new_cols - $old_cols)))); 	
-
-	my $counter_all = 0;
-
-	my ($c, $r, $s);
-
-	$r = -1;
-	while ( ++$r < $old_rows ) {
-		
-		# create buffer for column slice
-		my $col = Anorman::Data::Matrix::DensePacked->new( $new_cols, $dim );
+# moves a list of bestmatches (Anorman::Data::List::PackedInt) in place
+# to the positions of the same neurons on a grown grid
+sub grow_bestmatches {
+	my ($bestmatches, $old_grid, $new_grid) = @_;
 
-		my $counter_col = 0;
-		my $counter_nan = 0;
+	&_check_grid($old_grid);
+	&_check_grid($new_grid);
 
-		$c = -1;
-		while ( ++$c < $new_cols) {
-			
-			# transfer existing neuron from old grid
-			$s = -1;
-			while ( ++$s < $col_step ) {
-				if ($c < $new_cols) {
-					my $old_index  = $old_grid->coords2index($r, $c - $counter_nan );
-					my $old_neuron = $old_grid->get_neuron( $old_index );
+	_XS_grow_bestmatches( $bestmatches, $old_grid->rows, $old_grid->columns, $new_grid->rows, $new_grid->columns,
+			      _is_toroid( $old_grid ) );
 
-					$col->view_row( $c )->assign( $old_neuron );
-					$c++;
-					$counter_col++;
-				}
-
-			}
-
-			# insert empty neuron
-			if ($c < $new_cols) {
-				$col->view_row( $c )->assign( nan );
-				$counter_col++;
-				$counter_nan++;
-			}
-		}
-
-		# transfer expanded row slice to new grid
-		my $a = $counter_all - 1;
-		while ( ++$a < ($counter_all + $counter_col) ) {
-			my $buffer_col = $new_weights->view_row( $a );
-			my $col_slice  = $col->view_row( $a - $counter_all );
-
-			$buffer_col->assign( $col_slice );
-			
-		}
-
-		$counter_all += $counter_col;
-	}
-
-	print STDERR $new_weights;
-	# interpolate into empty neurons
-	my $i = -1;
-	while ( ++$i < $new_weights->rows ) {
-		my $probe_val = $new_weights->view_row( $i )->get(0);
-			
-		if ($probe_val != $probe_val) { # test for NaN values
-			$new_weights->view_row( $i )->assign( $interp->interpolate_col($i) );
-		}
-	}
+	return $bestmatches;
 }
 
 sub _check_growth_dims {
@@ -232,97 +78,98 @@ sub _is_grid {
 	return ref($_[0]) =~ m/Anorman::ESOM::Grid::/;
 }
 
-package Anorman::ESOM::GrowGrid::Interpolator;
-
-use strict;
-
-use Anorman::Common;
-
-sub new {
-	return bless ( { '_rec_grid' => undef }, $_[0] );
-} 
-
-sub set_grid {
-	my $self = shift;
-	Anorman::ESOM::GrowGrid::_check_grid($_[0]);
-	$self->{'_rec_grid'} = $_[0];
-}
-
-1;
-
-package Anorman::ESOM::GrowGrid::Interpolator::Mean;
-
-# empty neurons are fed the adjoining neurons (unless they are also empty) and divided by the number of added neighbors
-
-use strict;
-use parent -norequire, 'Anorman::ESOM::GrowGrid::Interpolator';
-
-use Anorman::Data::LinAlg::Property qw( :vector );
-use Anorman::Data::Vector;
-
-sub interpolate {
-	my $self = shift;
-	my $rec_grid = $self->{'_rec_grid'};
-
-	my ($r, $c) = ($rec_grid->rows, $rec_grid->columns );
-
-	my @neighbors = $rec_grid->immediate_neighbors( $_[0] );
-
-	my $tmp_neuron = Anorman::Data::Vector::DensePacked->new( $rec_grid->dim );
-	my $count      = 0;
-
-	foreach my $n(@neighbors) {
-		my $neigh_vec = $rec_grid->get_weights->view_row($n);
-		my $probe_val = $neigh_vec->get(0);
-	
-		if ($probe_val == $probe_val) { # any values here?
-
-			# Add neighbor to temporary vector
-			$tmp_neuron += $neigh_vec;
-			$count++;
-		}
-	}
-
-	# Take the mean of the neuron
-	$tmp_neuron /= $count unless ($count == 0);
-
-	return $tmp_neuron;
-}
-
-sub interpolate_row {
-	my $self = shift;
-	return $self->interpolate($_[0]);
+sub _is_toroid {
+	return $_[0]->isa('Anorman::ESOM::Grid::ToroidRectangular') ? 1 : 0;
 }
 
-sub interpolate_col {
-	my $self = shift;
-	return $self->interpolate($_[0]);
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::ESOM::GrowGrid',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "matrix.h"
+#include "intlist.h"
+#include "grow.h"
+
+#include "../lib/threads.c"
+#include "../lib/rng.c"
+#include "../lib/intlist.c"
+#include "../lib/grow.c"
+
+void _XS_grow( SV* sv_old, SV* sv_new, UV rows, UV columns, UV new_rows, UV new_columns, IV toroid, IV method ) {
+    SV_2STRUCT( sv_old, Matrix, w );
+    SV_2STRUCT( sv_new, Matrix, out );
+
+    if (w->rows != rows * columns || out->rows != new_rows * new_columns || out->columns != w->columns) {
+        croak("Weights do not fit the grids");
+    }
+
+    if (out->offsets != NULL || out->column_stride != 1) {
+        croak("New weights must be a packed matrix");
+    }
+
+    /* old neurons in place, or copied out of a view */
+    double* copy   = NULL;
+    double* p      = w->elements + c_m_index( w, 0, 0 );
+    size_t  stride = w->row_stride;
+
+    if (w->offsets != NULL || w->column_stride != 1) {
+        size_t i, j;
+
+        Newx( copy, w->rows * w->columns + 1, double );
+        for (i = 0; i < w->rows; i++) {
+            for (j = 0; j < w->columns; j++) {
+                copy[ i * w->columns + j ] = c_m_get_quick( w, i, j );
+            }
+        }
+
+        p      = copy;
+        stride = w->columns;
+    }
+
+    GrowAxis* ar = c_grow_axis_alloc( (size_t) rows, (size_t) new_rows, (int) toroid, (int) method );
+    GrowAxis* ac = c_grow_axis_alloc( (size_t) columns, (size_t) new_columns, (int) toroid, (int) method );
+
+    const int status = c_grow_weights( p, stride, w->columns, ar, ac,
+                                       out->elements + c_m_index( out, 0, 0 ), out->row_stride );
+
+    c_grow_axis_free( ar );
+    c_grow_axis_free( ac );
+    Safefree( copy );
+
+    if (status != C_SUCCESS) {
+        croak("Failed to grow grid");
+    }
 }
 
+void _XS_grow_bestmatches( SV* sv_list, UV rows, UV columns, UV new_rows, UV new_columns, IV toroid ) {
+    SV_2STRUCT( sv_list, IntList, l );
 
-1;
-
-package Anorman::ESOM::GrowGrid::Interpolator::PreviousNeighbor;
-
-# empty class for now...
+    GrowAxis* ar = c_grow_axis_alloc( (size_t) rows, (size_t) new_rows, (int) toroid, C_GROW_MEAN );
+    GrowAxis* ac = c_grow_axis_alloc( (size_t) columns, (size_t) new_columns, (int) toroid, C_GROW_MEAN );
 
-use strict;
-use parent -norequire, 'Anorman::ESOM::GrowGrid::Interpolator';
-
-use Anorman::Data::LinAlg::Property qw( :vector );
-use Anorman::Data::Vector;
+    const size_t N = (size_t) (rows * columns);
+    size_t i;
 
-sub interpolate {
-
-}
+    for (i = 0; i < l->size; i++) {
+        const int64_t bm = c_il_get( l, i );
 
-sub interpolate_row {
+        if (bm >= 0 && (size_t) bm < N) {
+            c_il_set( l, i, (int64_t) c_grow_index( ar, ac, (size_t) bm ) );
+        }
+    }
 
+    c_grow_axis_free( ar );
+    c_grow_axis_free( ac );
 }
 
-sub interpolate_col {
-
-}
+END_OF_C_CODE
 
 1;
-
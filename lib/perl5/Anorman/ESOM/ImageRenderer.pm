@@ -9,10 +9,7 @@ use Anorman::ESOM::Config;
 use Anorman::ESOM::File::ColorTable;
 use Anorman::ESOM::UMatrixRenderer;
 use Anorman::ESOM::BestMatchRenderer;
-
-use GD;
-
-use List::Util qw(max);
+use Anorman::ESOM::Raster;
 
 my %DEFAULTS = (
 	'zoom'	 	=> 1,
@@ -67,22 +64,19 @@ sub new {
 sub render {
 	my ($self, $fn) = @_;
 
-	warn "Rendering background...\n" if $VERBOSE;
-
-	# Render a zoomed background
-	$self->_zoom_background;
+	my $matrix = $self->{'matrix'};
+	trace_error("No height matrix present") unless defined $matrix;
 
-	# Draw a bitmap image of the zoomed background
-	$self->_draw_background;
+	warn "Rendering background...\n" if $VERBOSE;
 
-	# Clone background image
-	$self->_clone_bg_image;
+	# zoomed, colored and tiled natively in one go
+	my $zoom  = $self->{'zoom'};
+	my $tiles = $self->{'tiled'} ? 2 : 1;
+	my $image = Anorman::ESOM::Raster->new( $tiles * $zoom * $matrix->columns, $tiles * $zoom * $matrix->rows );
 
-	# Apply tiling to the background
-	$self->_tile_background;
+	$image->background( $matrix, $self->colors, $zoom, $self->{'tiled'} );
 
-	# Clone the image
-	$self->_clone_image;
+	$self->{'image'} = $image;
 
 	warn "Rendering foreground...\n" if $VERBOSE;
 
@@ -115,7 +109,13 @@ sub colorscheme {
 	}
 }
 
-sub bmsize { $_[1] ? $_[0]->{'bmzise'} = $_[1] : $_[0]->{'bmsize'} }
+sub bmsize { $_[1] ? $_[0]->{'bmsize'} = $_[1] : $_[0]->{'bmsize'} }
+
+# the color table as a list of Anorman::Common::Color
+sub colors {
+	my $colors = $_[0]->{'colors'}->data;
+	return [ map { $colors->[ $_ ] } 0 .. $colors->size - 1 ];
+}
 
 sub clip {
 	...
@@ -162,144 +162,4 @@ sub render_background {
 	}
 }
 
-sub _clone_bg_image {
-	my $self = shift;
-	if (defined $self->{'bg_image'}) {
-		$self->{'cloned_bg_image'} = $self->{'bg_image'}->clone;
-	}
-}
-
-sub _clone_image {
-	my $self = shift;
-	if (defined $self->{'tiled_image'}) {
-		$self->{'image'} = $self->{'tiled_image'}->clone;
-	}
-}
-
-sub _draw_background {
-	my $self   = shift;
-	my $matrix = $self->{'zoomed_matrix'};
-
-	my $bg_image;
-
-	if (defined $matrix) {
-		my $colors = $self->{'colors'}->data;
-		my $num_colors = $colors->size;
-
-		my $h = max( 1, $matrix->rows    );
-		my $w = max( 1, $matrix->columns );
-
-		$bg_image  = GD::Image->new( $w, $h );
-
-		# Allocate colors
-		my $i = -1;
-		while ( ++$i < $num_colors ) {
-			$bg_image->colorAllocate( $colors->[ $i ]->rgb );
-		}	
-
-		my $y = -1;
-		while ( ++$y < $h ) {
-			my $x = -1;
-			while ( ++$x < $w ) {
-				my $local_val = $matrix->get_quick( $y, $x );
-				my $color_i   = int ($local_val * $num_colors );
-
-				$bg_image->setPixel($x, $y, $color_i );
-			}
-		}
-	} else {
-		trace_error("No zoomed matrix present");
-	}
-
-	$self->{'bg_image'} = $bg_image;	
-}
-
-sub _tile_background {
-	my $self  = shift;
-
-	if (defined $self->{'cloned_bg_image'}) {
-		my $cloned_bg_image = $self->{'cloned_bg_image'};
-
-		# Get image dimensions
-		my ($w, $h) = $cloned_bg_image->getBounds;
-
-		# Allocate new tiled image
-		my $tiled_image = GD::Image->new( 2 * $w, 2 * $h );
-
-		# Tile image by copying image into 4 quadrants
-		$tiled_image->copy( $cloned_bg_image, 0 , 0 , 0, 0, $w, $h );
-		$tiled_image->copy( $cloned_bg_image, $w, 0 , 0, 0, $w, $h );
-		$tiled_image->copy( $cloned_bg_image, 0 , $h, 0, 0, $w, $h );
-		$tiled_image->copy( $cloned_bg_image, $w, $h, 0, 0, $w, $h );
-
-		$self->{'tiled_image'} = $tiled_image;
-	}
-}
-
-sub _zoom_background {
-	my $self   = shift;
-	my $zoom   = $self->{'zoom'};
-	my $matrix = $self->{'matrix'};
-
-	if (defined $matrix) {
-		if ($self->{'zoom'} > 1) {
-			my $zoomed_matrix = $matrix->like( $self->{'height'} * $zoom, 
-							   $self->{'width'}  * $zoom );
-
-			my $shift = int ($zoom / 2);
-
-			my $h = $self->{'height'};
-			my $w = $self->{'width'};
-
-			my ($fx,$fy,$ul,$ur,$ll,$lr);
-
-			if ($self->{'tiled'}) {
-				my $y = -1;
-				while ( ++$y < $h ) {
-					my $x = -1;
-					while ( ++$x < $w ) {
-
-						# Get heights from 4 adjacent points
-						$ul = $matrix->get_quick(           $y,            $x);
-						$ur = $matrix->get_quick(           $y, ($x + 1) % $w);
-						$ll = $matrix->get_quick(($y + 1) % $h,            $x);
-						$lr = $matrix->get_quick(($y + 1) % $h, ($x + 1) % $w);
-
-						my $yz = -1;
-						while ( ++$yz < $zoom ) {
-							$fy = $yz / $zoom;
-
-							my $xz = -1;
-							while ( ++$xz < $zoom ) {
-								$fx = $xz / $zoom;
-
-								# Calculate interpolated XY-coordinates
-								my $ix = (($y * $zoom) + $yz + $shift) % ($h * $zoom);
-								my $iy = (($x * $zoom) + $xz + $shift) % ($w * $zoom);
-
-								# Calculate interpolated height
-								my $ih = ((1 - $fy) * (((1 - $fx) * $ul) + 
-								         ($fx * $ur))) + 
-								         ($fy * (((1 - $fx) * $ll) +
-								         ($fx * $lr)));
-
-								$zoomed_matrix->set_quick($ix, $iy, $ih);
-							}
-						} 
-					}
-				}
-			} else {
-				...
-			}
-
-			$self->{'zoomed_matrix'} = $zoomed_matrix;
-		} else {
-			$self->{'zoomed_matrix'} = $matrix->copy;
-		}
-	} else {
-		trace_error("No height matrix present");
-	}
-}
-
 1;
-
@@ -0,0 +1,169 @@
+package Anorman::ESOM::Metrics;
+
+# Training quality counters filled natively by the bestmatch searches
+# (src/anorman/lib/metrics.c):
+#
+#	my $m = Anorman::ESOM::Metrics->new( $grid );
+#	$bmsearch->metrics( $m );
+#	$m->begin_epoch( $old_bestmatches );
+#	... train one epoch ...
+#	my $s = $m->stats;
+#	printf "QE %.4f TE %.4f\n", $s->{'qe_mean'}, $s->{'topographic_error'};
+#
+# The topographic error counts patterns whose best and second best
+# matching neurons are not neighbours on the grid, diagonal neighbours
+# included. Bestmatch churn is
+# measured against the list passed to begin_epoch
+
+use strict;
+use warnings;
+
+use Anorman::Common;
+
+use Scalar::Util qw(refaddr);
+
+# columns of the TSV output, in order
+our @FIELDS = qw(
+	epoch
+	patterns
+	qe_mean
+	qe_max
+	topographic_error
+	bm_churn
+	distance_evals
+	distances_skipped
+	search_time
+);
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+	my $self  = _XS_new( $class );
+
+	$self->grid( $_[0] ) if defined $_[0];
+
+	return $self;
+}
+
+# take the layout of a rectangular (toroid) grid
+sub grid {
+	my ($self, $grid) = @_;
+
+	if ($grid->can('rows') && defined $grid->rows) {
+		$self->_XS_set_grid( $grid->rows, $grid->columns, $grid->isa('Anorman::ESOM::Grid::ToroidRectangular') ? 1 : 0 );
+	} else {
+		$self->_XS_set_grid( 0, 0, 0 );
+	}
+}
+
+# the native counters read the list given to begin_epoch through a raw
+# pointer, so it is kept alive here until the next epoch
+my %PREVIOUS;
+
+# reset the counters. Churn is counted against $previous, a
+# Anorman::Data::List::PackedInt indexed by data row (optional)
+sub begin_epoch {
+	my ($self, $previous) = @_;
+
+	$PREVIOUS{ refaddr $self } = $previous;
+	$self->_XS_begin_epoch( $previous );
+}
+
+sub DESTROY {
+	my $self = shift;
+
+	delete $PREVIOUS{ refaddr $self };
+	$self->_XS_free;
+}
+
+sub stats {
+	my $self = shift;
+	my $s    = $self->_XS_counters;
+	my $n    = $s->{'patterns'};
+
+	$s->{'qe_mean'}           = $n ? $s->{'qe_sum'} / $n : 0;
+	$s->{'topographic_error'} = $n ? $s->{'topo_errors'} / $n : 0;
+	$s->{'bm_churn'}          = $n ? $s->{'bm_moved'} / $n : 0;
+
+	return $s;
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::ESOM::Metrics',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lm -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "threads.h"
+#include "rng.h"
+#include "intlist.h"
+#include "metrics.h"
+
+#include "../lib/threads.c"
+#include "../lib/rng.c"
+#include "../lib/intlist.c"
+#include "../lib/metrics.c"
+
+SV* _XS_new( SV* sv_class_name ) {
+    TrainMetrics* m;
+    SV* self;
+
+    Newxz( m, 1, TrainMetrics );
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( m, self, class_name );
+
+    return self;
+}
+
+void _XS_set_grid( SV* self, UV rows, UV columns, IV toroid ) {
+    SV_2STRUCT( self, TrainMetrics, m );
+
+    m->rows    = (size_t) rows;
+    m->columns = (size_t) columns;
+    m->toroid  = (int) toroid;
+}
+
+void _XS_begin_epoch( SV* self, SV* sv_previous ) {
+    SV_2STRUCT( self, TrainMetrics, m );
+
+    c_metrics_reset( m );
+    m->previous = NULL;
+
+    if (SvROK( sv_previous )) {
+        SV_2STRUCT( sv_previous, IntList, l );
+        m->previous = l;
+    }
+}
+
+SV* _XS_counters( SV* self ) {
+    SV_2STRUCT( self, TrainMetrics, m );
+
+    HV* hv = newHV();
+
+    hv_stores( hv, "patterns",          newSVuv( (UV) m->c.patterns ) );
+    hv_stores( hv, "topo_errors",       newSVuv( (UV) m->c.topo_errors ) );
+    hv_stores( hv, "bm_moved",          newSVuv( (UV) m->c.bm_moved ) );
+    hv_stores( hv, "distance_evals",    newSVuv( (UV) m->c.dist_evals ) );
+    hv_stores( hv, "distances_skipped", newSVuv( (UV) m->c.dist_skipped ) );
+    hv_stores( hv, "qe_sum",            newSVnv( m->c.qe_sum ) );
+    hv_stores( hv, "qe_max",            newSVnv( m->c.qe_max ) );
+    hv_stores( hv, "search_time",       newSVnv( m->c.search_time ) );
+
+    return newRV_noinc( (SV*) hv );
+}
+
+void _XS_free( SV* self ) {
+    SV_2STRUCT( self, TrainMetrics, m );
+    Safefree( m );
+}
+
+END_OF_C_CODE
+
+1;
@@ -18,9 +18,11 @@ use vars qw(@ISA @EXPORT_OK);
 
 sub project {
 	# projects multivariate data onto an ESOM grid
-	# accepts a lrn-file object and a wts-file object.
+	# accepts a lrn-file object and a wts-file object, and optionally a
+	# metric object (e.g. Data::Algorithms::MahalanobisDistance) that can whiten
+	# both data sets so the euclidean search applies.
 	# returns a bm-file object
-	my ($lrn, $wts) = @_;
+	my ($lrn, $wts, $metric) = @_;
 
 	trace_error("Not a lrn-file") unless $lrn->isa('Anorman::ESOM::File::Lrn');
 	trace_error("Not a wts-file") unless $wts->isa('Anorman::ESOM::File::Wts');
@@ -29,6 +31,7 @@ sub project {
 	my $rows    = $wts->rows;
 	my $columns = $wts->columns;
 	my $neurons = $wts->data; 
+	my $data    = $lrn->data;
 	my $size    = $lrn->size;
 	my $bm      = &_new_bm_file( $rows, $columns, $lrn->datapoints );
 	my $dist    = Anorman::Data->vector( $size );
@@ -37,12 +40,22 @@ sub project {
 	$grid->rows( $rows );
 	$grid->columns( $columns );
 
+	if (defined $metric) {
+		trace_error("Metric cannot be reduced to euclidean distances") unless $metric->can_whiten;
+
+		warn "Whitening data and weights...\n" if $VERBOSE;
+		$data    = $metric->whiten( $data );
+		$neurons = $metric->whiten( $neurons );
+	}
+
 	warn "Projecting data onto weights...\n" if $VERBOSE;
 
+	my $vector = $data->row_cursor;
+
 	my $i = -1;
 	while ( ++$i < $size ) {
 		my $index  = $lrn->keys->get( $i );
-		my $vector = $lrn->data->view_row( $i );
+		$data->seek_row( $vector, $i );
 
 		my ($neuron_i, $distance) = bm_brute_force_search( $vector, $neurons );
 		my $bestmatch = Anorman::ESOM::DataItem::BestMatch->new( $index,
@@ -75,12 +88,18 @@ sub bestmatch_distances {
 	} else {
 		warn "Calculating bestmatch distances...\n" if $VERBOSE;
 
+		my $data    = $lrn->data;
+		my $weights = $grid->get_weights;
+		my $vector  = $data->row_cursor;
+		my $neuron  = $weights->row_cursor;
+
 		my $i = -1;
 		while ( ++$i < $size ) {
 			my $index     = $lrn->keys->get( $i );
-			my $vector    = $lrn->data->view_row( $i );
 			my $bestmatch = $bm->get_quick( $i );
-			my $neuron    = $grid->get_neuron( $bestmatch->row, $bestmatch->column );
+
+			$data->seek_row( $vector, $i );
+			$weights->seek_row( $neuron, $grid->coords2index( $bestmatch->row, $bestmatch->column ) );
 
 			# Execute the distance-function embedded into the grid on each vector/neuron pair.
 			my $bm_dist      = $func->apply( $vector, $neuron );
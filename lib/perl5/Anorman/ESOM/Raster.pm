@@ -0,0 +1,205 @@
+package Anorman::ESOM::Raster;
+
+# Native RGBA image of a rendered ESOM (src/anorman/lib/raster.c). The
+# ImageRenderer draws the U-matrix background into it and the
+# BestMatchRenderer stamps the bestmatches, both in a single native
+# pass a strip of rows per thread, and the result is encoded as PNG
+# without going through GD:
+#
+#	my $image = Anorman::ESOM::ImageRenderer->new( $esom, zoom => 4 )->render;
+#	print $FH $image->png;
+
+use strict;
+use warnings;
+
+use Anorman::Common qw(trace_error);
+use Anorman::Data::LinAlg::Property qw(is_matrix is_packed);
+use Anorman::Data::Matrix::DensePacked;
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	my ($width, $height) = @_;
+
+	trace_error("Image dimensions must be positive") unless ($width && $height && $width > 0 && $height > 0);
+
+	return _XS_new( $class, $width, $height );
+}
+
+# heights in [0..1] coloured from a list of Anorman::Common::Color
+sub background {
+	my ($self, $matrix, $colors, $zoom, $tiled) = @_;
+
+	trace_error("Not a matrix") unless is_matrix($matrix);
+	trace_error("Empty color table") unless @{ $colors };
+
+	$matrix = Anorman::Data::Matrix::DensePacked->new( $matrix->rows, $matrix->columns )->assign( $matrix )
+		unless is_packed($matrix);
+
+	my $status = $self->_XS_background( $matrix, _palette( $colors ), $zoom, $tiled ? 1 : 0 );
+	trace_error("Image does not fit a " . $matrix->rows . " x " . $matrix->columns . " map at zoom $zoom") if $status;
+
+	return $self;
+}
+
+# Bestmatch glyphs. Takes array references of rows, columns and color
+# numbers of each point, the colors, and the map and glyph geometry:
+# map_rows, map_columns, zoom, size, circle and tiled
+sub glyphs {
+	my ($self, $rows, $columns, $classes, $colors, %opt) = @_;
+
+	trace_error("Point arrays differ in length") unless (@{ $rows } == @{ $columns } && @{ $rows } == @{ $classes });
+	trace_error("Empty color table") unless @{ $colors };
+
+	my $status = $self->_XS_glyphs(
+		pack( 'L*', @{ $rows } ),
+		pack( 'L*', @{ $columns } ),
+		pack( 'L*', @{ $classes } ),
+		_palette( $colors ),
+		map { $opt{ $_ } || 0 } qw(map_rows map_columns zoom size circle tiled)
+	);
+
+	trace_error("Invalid glyph geometry") if $status;
+
+	return $self;
+}
+
+# PNG file contents, at zlib level 1 unless told otherwise
+sub png {
+	my ($self, $level) = @_;
+	my $png = $self->_XS_png( defined $level ? $level : 1 );
+
+	trace_error("PNG encoding failed") unless defined $png;
+
+	return $png;
+}
+
+# the image as a GD::Image, for further drawing
+sub gd {
+	my $self = shift;
+
+	require GD;
+	return GD::Image->newFromPngData( $self->png, 1 );
+}
+
+sub _palette {
+	return pack( 'C*', map { $_->rgb } @{ $_[0] } );
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::ESOM::Raster',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lz -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "matrix.h"
+#include "raster.h"
+
+#include "../lib/threads.c"
+#include "../lib/raster.c"
+
+SV* _XS_new( SV* sv_class_name, UV width, UV height ) {
+    SV* self;
+
+    Raster* r = c_raster_alloc( (size_t) width, (size_t) height );
+
+    if (r == NULL) {
+        croak("Failed to allocate image");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( r, self, class_name );
+
+    return self;
+}
+
+UV width( SV* self ) {
+    SV_2STRUCT( self, Raster, r );
+    return (UV) r->width;
+}
+
+UV height( SV* self ) {
+    SV_2STRUCT( self, Raster, r );
+    return (UV) r->height;
+}
+
+IV _XS_background( SV* self, SV* sv_m, SV* sv_palette, UV zoom, IV tiled ) {
+    SV_2STRUCT( self, Raster, r );
+    SV_2STRUCT( sv_m, Matrix, m );
+
+    STRLEN n;
+    const uint8_t* palette = (const uint8_t*) SvPV( sv_palette, n );
+
+    /* heights row by row, copied out of views */
+    double* h;
+    Newx( h, m->rows * m->columns + 1, double );
+
+    size_t i, j;
+    for (i = 0; i < m->rows; i++) {
+        for (j = 0; j < m->columns; j++) {
+            h[ i * m->columns + j ] = c_m_get_quick( m, i, j );
+        }
+    }
+
+    const int status = c_raster_background( r, h, m->rows, m->columns, (size_t) zoom, (int) tiled,
+                                            palette, (size_t) (n / 3) );
+
+    Safefree( h );
+
+    return (IV) status;
+}
+
+IV _XS_glyphs( SV* self, SV* sv_rows, SV* sv_columns, SV* sv_classes, SV* sv_palette,
+               UV map_rows, UV map_columns, UV zoom, UV size, IV circle, IV tiled ) {
+    SV_2STRUCT( self, Raster, r );
+
+    STRLEN n, n_palette;
+
+    RasterGlyphs g;
+    g.rows        = (const uint32_t*) SvPV( sv_rows, n );
+    g.columns     = (const uint32_t*) SvPV_nolen( sv_columns );
+    g.classes     = (const uint32_t*) SvPV_nolen( sv_classes );
+    g.palette     = (const uint8_t*) SvPV( sv_palette, n_palette );
+    g.n           = n / sizeof(uint32_t);
+    g.colors      = n_palette / 3;
+    g.map_rows    = (size_t) map_rows;
+    g.map_columns = (size_t) map_columns;
+    g.zoom        = (size_t) zoom;
+    g.size        = (size_t) size;
+    g.circle      = (int) circle;
+    g.tiled       = (int) tiled;
+
+    return (IV) c_raster_glyphs( r, &g );
+}
+
+SV* _XS_png( SV* self, IV level ) {
+    SV_2STRUCT( self, Raster, r );
+
+    uint8_t* png;
+    size_t   n;
+
+    if (c_raster_png( r, (int) level, &png, &n ) != C_SUCCESS) {
+        return &PL_sv_undef;
+    }
+
+    SV* sv = newSVpvn( (const char*) png, n );
+    free( png );
+
+    return sv;
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, Raster, r );
+    c_raster_free( r );
+}
+
+END_OF_C_CODE
+
+1;
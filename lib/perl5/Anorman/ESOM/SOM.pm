@@ -10,10 +10,14 @@ use Anorman::ESOM::BMSearch;
 use Anorman::ESOM::Neighborhood;
 use Anorman::ESOM::Cooling;
 use Anorman::ESOM::Descriptives;
+use Anorman::ESOM::Metrics;
+use Anorman::ESOM::Snapshots;
 use Anorman::Math::DistanceFactory;
 
-use List::Util qw(shuffle);
+use Anorman::Data::List::PackedInt;
+use Anorman::Math::Random qw(epoch_stream);
 use Time::HiRes qw(time);
+use List::Util qw(min);
 
 my $TRAIN_BEG;
 my $TRAIN_END;
@@ -32,6 +36,15 @@ my %DEFAULTS = (
 	'cool-learn'      => 'lin',
 	'start-learn'     => 0.5,
 	'end-learn'       => 0.1,
+	'seed'            => undef,
+	'metrics'         => undef,
+	'metrics-format'  => 'tsv',
+	'early-stop'      => 0,
+	'stop-tolerance'  => 0.001,
+	'snapshot'        => undef,
+	'snapshot-every'  => 1,
+	'snapshot-colors' => undef,
+	'snapshot-zoom'   => 1,
 );
 
 sub new {
@@ -97,9 +110,19 @@ sub new {
 	$self->{'_init_method'}    = $opt{'init_method'};
 	$self->{'_permute'}        = $opt{'permute'};
 
+	# grid init and permutations all derive from one seed
+	$self->{'_seed'}           = Anorman::Math::Random::seed( defined $opt{'seed'} ? $opt{'seed'} : () );
+
 	$self->{'_bmsearch'}->constant( $opt{'bmconstant'} );
 
-	return bless ( $self, $class );
+	bless ( $self, $class );
+
+	$self->metrics( $opt{'metrics'}, $opt{'metrics-format'} ) if defined $opt{'metrics'};
+	$self->early_stop( $opt{'early-stop'}, $opt{'stop-tolerance'} ) if $opt{'early-stop'};
+	$self->snapshot( $opt{'snapshot'}, every => $opt{'snapshot-every'}, colorscheme => $opt{'snapshot-colors'},
+			 zoom => $opt{'snapshot-zoom'} ) if defined $opt{'snapshot'};
+
+	return $self;
 }
 
 sub init {
@@ -124,30 +147,61 @@ sub train {
 	$TRAIN_BEG = time ();
 
 	my $self    = shift;
-	my $weights = $self->grid->get_weights;
+	my $grid    = $self->grid;
+	my $weights = $grid->get_weights;
 	
 	$self->{'_epoch'} = 0;
 	$self->{'_bmsearch'}->som( $self );
 
-	warn "[ ", sprintf("%.2f", $TRAIN_BEG - $TIME) , "s ] Training begin\n";
+	# quality counters are collected by the bestmatch search
+	my $metrics = $self->_need_metrics ? Anorman::ESOM::Metrics->new( $self->grid ) : undef;
+
+	$self->{'_bmsearch'}->metrics( $metrics );
+	$self->{'_qe_history'} = [];
+
+	warn "[ ", sprintf("%.2f", $TRAIN_BEG - $TIME) , "s ] Training begin (seed $self->{'_seed'})\n";
 
 	until ( $self->stop ) {
+		my $t0 = time();
 		
 		# tasks to perform before each epoch
 		$self->before_epoch;
+
+		# a growing trainer may have replaced the grid
+		if ($self->grid != $grid) {
+			$grid = $self->grid;
+			$metrics->grid( $grid ) if $metrics;
+		}
+
+		$weights = $grid->get_weights;
+
+		# churn is measured against the bestmatches of the last epoch
+		$metrics->begin_epoch( $self->{'_epoch'} ? $self->{'_bestmatches'} : undef ) if $metrics;
+
+		my $t1 = time();
 		
 		warn "\tTraining...\n" if $VERBOSE;
 
 		my $pos = 0;
 
+		# one cursor is moved over the data rows instead of a view per pattern.
+		# Sparse rows are expanded one at a time into a single dense pattern
+		my $data   = $self->data;
+		my $sparse = _is_csr( $data );
+		my $vector = $sparse ? Anorman::Data->packed_vector( $data->columns ) : $data->row_cursor;
+
 		my $i = -1;
-		while ( ++$i < $self->data->rows ) {
+		while ( ++$i < $data->rows ) {
 
 			# Retrive row index from the current permutation
-			my $index = $self->{'_permutation'}->[ $i ];
+			my $index = $self->{'_permutation'}->get_quick( $i );
 
 			# Retrieve data vector
-			my $vector = $self->get_pattern( $index );
+			if ($sparse) {
+				$data->row_to_dense( $index, $vector );
+			} else {
+				$data->seek_row( $vector, $index );
+			}
 
 			# Locate the bestmatch neuron
 			my ($bm, $dist) = $self->{'_bmsearch'}->find_bestmatch( $index,
@@ -157,7 +211,7 @@ sub train {
                                                                               ); 
 			
 			# Store the best match
-			$self->{'_bestmatches'}->[ $index ] = $bm;
+			$self->{'_bestmatches'}->set_quick( $index, $bm );
 
 			# Store the distance
 			$self->{'_distances'}->set( $i, $dist );
@@ -166,14 +220,19 @@ sub train {
 			$self->update( $vector, $bm, $pos );
 
 			# stuff to do after neuron has been updated
-			$self->after_update( $bm, $index );
+			$self->after_update( $bm, $index, $vector );
 		
 			$pos++;
 
 		}
 
+		my $t2 = time();
+
 		# after epoch stuff
 		$self->after_epoch;
+		$self->_snapshot if defined $self->{'_snapshot_file'};
+
+		$self->_epoch_metrics( $metrics, $self->{'_epoch'}, $t1 - $t0, $t2 - $t1, time() - $t2 ) if $metrics;
 		$self->{'_epoch'}++;
 	}
 
@@ -182,15 +241,50 @@ sub train {
 
 	warn "[ ", sprintf("%.2f", $TRAIN_END - $TIME) ," ] Total training time: ", $DURATION, "\n";
 
+	# let the writer drain its queue
+	if (my $snapshots = delete $self->{'_snapshots'}) {
+		$snapshots->close;
+	}
+
 	# Final round of bestmatch searching (Always uses brute force search)
-	my $i  = -1;
-	while ( ++$i < $self->data->rows ) {
-		my $index = $self->{'_permutation'}->[ $i ];
-		my $vector = $self->get_pattern( $index );
-		my ($bm, $dist) = Anorman::ESOM::BMSearch::bm_brute_force_search( $vector, $weights );
-		
-		$self->{'_bestmatches'}->[ $index ] = $bm;		 
-		$self->{'_distances'}->set( $i, $dist );
+	my $data = $self->data;
+	my $t0   = time();
+
+	$metrics->begin_epoch( $self->{'_bestmatches'} ) if $metrics;
+
+	if (is_packed( $data ) && is_packed( $self->{'_distances'} )) {
+		# all rows at once, in parallel. Distances are stored by row
+		Anorman::ESOM::BMSearch::bm_search_rows( $data, $weights, $self->{'_bestmatches'}, $self->{'_distances'}, $metrics );
+	} elsif (_is_csr( $data ) && !$metrics) {
+		# sparse rows against the weights in parallel, without expanding them
+		my ($bms, $dists) = $data->bestmatches( $weights );
+
+		my $i  = -1;
+		while ( ++$i < $data->rows ) {
+			$self->{'_bestmatches'}->set_quick( $i, $bms->[ $i ] );
+			$self->{'_distances'}->set( $i, $dists->[ $i ] );
+		}
+	} else {
+		my $sparse = _is_csr( $data );
+		my $vector = $sparse ? Anorman::Data->packed_vector( $data->columns ) : $data->row_cursor;
+
+		my $i  = -1;
+		while ( ++$i < $data->rows ) {
+			if ($sparse) {
+				$data->row_to_dense( $i, $vector );
+			} else {
+				$data->seek_row( $vector, $i );
+			}
+			my ($bm, $dist) = Anorman::ESOM::BMSearch::bm_brute_force_search( $vector, $weights, $metrics ? ( $metrics, $i ) : () );
+
+			$self->{'_bestmatches'}->set_quick( $i, $bm );
+			$self->{'_distances'}->set( $i, $dist );
+		}
+	}
+
+	if ($metrics) {
+		$self->_epoch_metrics( $metrics, 'final', 0, time() - $t0, 0 );
+		$self->{'_bmsearch'}->metrics( undef );
 	}
 }
 
@@ -217,7 +311,7 @@ sub before_epoch {
 	if ($self->{'_permute'}) {	
 		# shuffle data vectors
 		warn "\tPermuting data patterns\n" if $VERBOSE;
-		@{ $self->{'_permutation'} } = shuffle @{ $self->{'_permutation'} };
+		$self->{'_permutation'}->shuffle( $self->{'_seed'}, epoch_stream( $self->{'_epoch'} ) );
 	}
 };
 
@@ -251,7 +345,7 @@ sub cool {
 	my $n = $self->{'_neighborhood'};
 	my $g = $self->{'_grid'};
 
-	$self->{'_radius'} = $self->{'_radius_cooling'}->get_as_int( $self->{'_epoch'} );
+	$self->{'_radius'} = $self->scale_radius( $self->{'_radius_cooling'}->get_as_int( $self->{'_epoch'} ) );
 	$self->{'_rate'}   = $self->{'_rate_cooling'}->get( $self->{'_epoch'} );
 
 	# re-calculate new neighborhoods if ratio or learning rate has changed
@@ -268,17 +362,163 @@ sub cool {
 	}
 }
 
+# radius of the cooling schedule on the current grid, before the
+# neighborhood is built from it
+sub scale_radius { $_[1] };
+
 sub update {};
 
 sub stop {
 	my $self = shift;
-	return ( $self->{'_epoch'} >= $self->{'_epochs'});
+
+	return 1 if $self->{'_epoch'} >= $self->{'_epochs'};
+	return 0 unless $self->{'_early_stop'};
+
+	# stop when the mean quantization error of the last epochs has not
+	# improved on the best one before them by more than the tolerance
+	my $patience = $self->{'_early_stop'};
+	my $history  = $self->{'_qe_history'};
+
+	return 0 if @{ $history } <= $patience;
+
+	my $best = min( @{ $history }[ 0 .. $#{ $history } - $patience ] );
+
+	foreach my $qe (@{ $history }[ -$patience .. -1 ]) {
+		return 0 if $qe < $best * (1 - $self->{'_stop_tolerance'});
+	}
+
+	warn "[ ", sprintf("%.2f", time() - $TIME), "s ] Early stop after epoch ", $self->{'_epoch'} - 1,
+	     ": no quantization error improvement in $patience epochs\n";
+
+	return 1;
 }
 
 sub bestmatches { $_[0]->{'_bestmatches'} }
 
+# write per-epoch metrics to a file ('-' for STDERR) as 'tsv' or 'json' lines
+sub metrics {
+	my $self   = shift;
+	my $file   = shift;
+	my $format = defined $_[0] ? shift : 'tsv';
+
+	return $self->{'_metrics_file'} unless defined $file;
+
+	trace_error("Unknown metrics format $format") unless ($format eq 'tsv' || $format eq 'json');
+
+	$self->{'_metrics_file'}   = $file;
+	$self->{'_metrics_format'} = $format;
+}
+
+# stop when the mean quantization error stalls for $patience epochs
+sub early_stop {
+	my $self = shift;
+
+	return $self->{'_early_stop'} unless defined $_[0];
+
+	$self->{'_early_stop'}     = shift;
+	$self->{'_stop_tolerance'} = defined $_[0] ? shift : 0.001;
+}
+
+# Render the U-matrix of the weights to an animated PNG every $every
+# epochs while training. Options other than every go to
+# Anorman::ESOM::Snapshots
+sub snapshot {
+	my $self = shift;
+	my $file = shift;
+
+	return $self->{'_snapshot_file'} unless defined $file;
+
+	my %opt   = @_;
+	my $every = exists $opt{'every'} ? delete $opt{'every'} : 1;
+
+	trace_error("Snapshot interval must be a positive integer") unless ($every =~ /^\d+$/ && $every > 0);
+
+	$self->{'_snapshot_file'}  = $file;
+	$self->{'_snapshot_every'} = $every;
+	$self->{'_snapshot_opt'}   = { map { $_ => $opt{ $_ } } grep { defined $opt{ $_ } } keys %opt };
+}
+
+# the frame of this epoch, opening the writer on the first
+sub _snapshot {
+	my $self = shift;
+
+	return if $self->{'_epoch'} % $self->{'_snapshot_every'};
+
+	my ($rows, $columns) = $self->_final_size;
+
+	$self->{'_snapshots'} ||= Anorman::ESOM::Snapshots->new( $self->{'_snapshot_file'}, $self->grid,
+								  %{ $self->{'_snapshot_opt'} },
+								  rows => $rows, columns => $columns );
+
+	$self->{'_snapshots'}->add( $self->grid, $self->{'_epoch'} );
+}
+
+# rows and columns of the finished map
+sub _final_size {
+	my $self = shift;
+	return ( $self->grid->rows, $self->grid->columns );
+}
+
+sub _is_csr       { $_[0]->isa('Anorman::Data::Matrix::CSR') }
+
+sub _need_metrics { defined $_[0]->{'_metrics_file'} || $_[0]->{'_early_stop'} }
+
+# the counters of one epoch plus wall time per phase
+sub _epoch_metrics {
+	my ($self, $metrics, $epoch, $t_before, $t_train, $t_after) = @_;
+
+	my $s = $metrics->stats;
+
+	$s->{'epoch'}       = $epoch;
+	$s->{'time_before'} = $t_before;
+	$s->{'time_train'}  = $t_train;
+	$s->{'time_update'} = $t_train > $s->{'search_time'} ? $t_train - $s->{'search_time'} : 0;
+	$s->{'time_after'}  = $t_after;
+
+	push @{ $self->{'_qe_history'} }, $s->{'qe_mean'} if $epoch ne 'final';
+
+	warn sprintf("\tQE: %.4f (max %.4f), TE: %.4f, BM churn: %.4f\n",
+		@{ $s }{ qw/qe_mean qe_max topographic_error bm_churn/ } ) if $VERBOSE;
+
+	$self->_write_metrics( $s ) if defined $self->{'_metrics_file'};
+
+	return $s;
+}
+
+my @METRICS_FIELDS = ( @Anorman::ESOM::Metrics::FIELDS, qw(time_before time_train time_update time_after) );
+
+sub _write_metrics {
+	my ($self, $s) = @_;
+
+	my $FH = $self->{'_metrics_fh'};
+
+	unless (defined $FH) {
+		if ($self->{'_metrics_file'} eq '-') {
+			$FH = \*STDERR;
+		} else {
+			open ($FH, '>', $self->{'_metrics_file'}) or trace_error("Could not write to file $self->{'_metrics_file'}. $!");
+		}
+
+		$FH->autoflush( 1 );
+		$self->{'_metrics_fh'} = $FH;
+
+		print $FH join ("\t", @METRICS_FIELDS), "\n" if $self->{'_metrics_format'} eq 'tsv';
+	}
+
+	my @values = map { $_ eq 'epoch' ? $s->{ $_ } : 0 + sprintf("%.6g", $s->{ $_ }) } @METRICS_FIELDS;
+
+	if ($self->{'_metrics_format'} eq 'json') {
+		my $i = 0;
+		print $FH "{", join (",", map { my $v = $values[ $i++ ]; "\"$_\":" . ($v =~ m/^-?[\d.eE+-]+$/ ? $v : "\"$v\"") } @METRICS_FIELDS), "}\n";
+	} else {
+		print $FH join ("\t", @values), "\n";
+	}
+}
+
 sub descriptives { $_[0]->{'_descriptives'} }
 
+# training data, a dense matrix or a sparse Data::Matrix::CSR (e.g. high-k
+# k-mer spectra). Sparse data is never densified as a whole
 sub data {
 	my $self = shift;
 	my $data = shift;
@@ -295,9 +535,9 @@ sub data {
 		$self->{'_descriptives'} = Anorman::ESOM::Descriptives->new( $data );
 
 		# Initialize bestmatches and permutations
-		$#{ $self->{'_bestmatches'} }  = $data->rows - 1;
-		$self->{'_distances'} = Anorman::Data->vector( $data->rows );
-		$self->{'_permutation'} = [ 0 .. $data->rows - 1 ];
+		$self->{'_bestmatches'} = Anorman::Data::List::PackedInt->new( $data->rows );
+		$self->{'_distances'}   = Anorman::Data->vector( $data->rows );
+		$self->{'_permutation'} = Anorman::Data::List::PackedInt->range( 0, $data->rows, 'uint32' );
 	} else {
 		return $self->{'data'};
 	}
@@ -305,6 +545,7 @@ sub data {
 
 sub get_pattern {
 	my $self = shift;
+	return $self->{'data'}->row_to_dense( $_[0] ) if _is_csr( $self->{'data'} );
 	return $self->{'data'}->view_row( $_[0] );
 }
 
@@ -319,6 +560,17 @@ sub distance_function {
 	return $self->{'_distance_function'};
 }
 
+# the random seed of the run. Setting it reseeds grid initialization too
+sub seed {
+	my $self = shift;
+
+	if (defined $_[0]) {
+		$self->{'_seed'} = Anorman::Math::Random::seed( $_[0] );
+	}
+
+	return $self->{'_seed'};
+}
+
 sub epochs {
 	my $self = shift;
 	$self->{'_epochs'} = shift if defined $_[0];
@@ -389,7 +641,7 @@ sub save_bestmatches {
 	my $size = $self->data->size;
 	my $i = -1;
 	while ( ++$i < $size ) {
-		my $key = $self->keys->[ $i ];
+		my $key = $self->keys->get( $i );
 		my $row = $grid->index2row( $i );
 		my $col = $grid->index2col( $i );
 		$bm->add( $key, $row, $col )
@@ -402,7 +654,7 @@ use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::ESOM::SOM',
 		ENABLE    => AUTOWRAP =>
-		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
 	   );
 
@@ -585,8 +837,8 @@ sub after_update {
 		return;
 	}
 	
-	my ($bm, $i) = @_;
-	my $vector = $self->get_pattern( $i );
+	my ($bm, $i, $vector) = @_;
+	$vector = $self->get_pattern( $i ) unless defined $vector;
 
 	$self->_store_bestmatch( $bm, $vector);
 }
@@ -660,12 +912,13 @@ sub after_epoch {
 	my $self = shift;
 	$self->SUPER::after_epoch;
 
-	warn "\tSlow batch-update ", scalar @{ $self->{'_bestmatches'} }, " bestmatches\n";
+	my $bestmatches = $self->{'_bestmatches'};
+
+	warn "\tSlow batch-update ", $bestmatches->size, " bestmatches\n";
 
-	my $i = 0;
-	foreach my $bm(@{ $self->{'_bestmatches'} }) {
-		$self->update_neighborhood( $self->get_pattern( $i ), $bm );
-		$i++;
+	my $i = -1;
+	while ( ++$i < $bestmatches->size ) {
+		$self->update_neighborhood( $self->get_pattern( $i ), $bestmatches->get_quick( $i ) );
 	}
 }
 
@@ -673,27 +926,158 @@ sub after_epoch {
 
 package Anorman::ESOM::SOM::GESOM;
 
+# Growing ESOM. Training starts on a grid a fraction of the size of the
+# one given and grows it in steps at evenly spaced epochs, so the coarse
+# early epochs run on a fraction of the neurons. Each step doubles
+# (about) both sides and interpolates the inserted neurons natively;
+# bestmatches move along with their neurons and the neighborhood radius
+# is scaled to the current grid. Updates are online
+
 use parent -norequire,'Anorman::ESOM::SOM';
 
+use Anorman::Common;
 use Anorman::ESOM::GrowGrid;
+use POSIX qw(ceil floor);
+use List::Util qw(max min);
+use Scalar::Util qw(refaddr);
+use Time::HiRes qw(time);
 
-sub new { $_[0]->SUPER::new(@_) };
+my $MIN_SIDE = 4;
+
+sub new {
+	my $class = shift;
+	my $self  = $class->SUPER::new(@_);
+
+	$self->{'_grow_steps'}  = 2;
+	$self->{'_grow_method'} = 'mean';
+
+	return $self;
+}
+
+# number of times the grid grows
+sub grow_steps {
+	my $self = shift;
+	$self->{'_grow_steps'} = shift if defined $_[0];
+	return $self->{'_grow_steps'};
+}
+
+# interpolation of inserted neurons, 'mean' or 'bilinear'
+sub grow_method {
+	my $self = shift;
+	$self->{'_grow_method'} = shift if defined $_[0];
+	return $self->{'_grow_method'};
+}
 
 sub update {
 	my $self = shift;
 	$self->update_neighborhood( @_ );
 }
 
+# replaces the grid by the smallest one of the schedule and initializes it
 sub init {
 	my $self = shift;
-	my $rows    = $self->{'_grid'}->rows;
-	my $columns = $self->{'_grid'}->columns;
 
+	trace_error("Cannot initialize trainer with no grid loaded") unless $self->{'_grid'};
+
+	my $grid    = $self->{'_grid'};
+	my $rows    = $grid->rows;
+	my $columns = $grid->columns;
+	my $steps   = $self->{'_grow_steps'};
+
+	my $r0 = min( $rows,    max( $MIN_SIDE, ceil( $rows / 2 ** $steps ) ) );
+	my $c0 = min( $columns, max( $MIN_SIDE, ceil( $columns / 2 ** $steps ) ) );
+
+	# sizes grow geometrically and stages get an equal share of the epochs
+	my @stages;
+	foreach my $s(0 .. $steps) {
+		my $f = $steps ? $s / $steps : 1;
+
+		push @stages, [ floor( $s * $self->{'_epochs'} / ($steps + 1) ),
+				floor( 0.5 + $r0 * ($rows / $r0) ** $f ),
+				floor( 0.5 + $c0 * ($columns / $c0) ** $f ) ];
+	}
+
+	$stages[-1]->[1] = $rows;
+	$stages[-1]->[2] = $columns;
+
+	$self->{'_grow_target'} = [ $rows, $columns ];
+	$self->{'_grow_stages'} = [ grep { $_->[1] != $r0 || $_->[2] != $c0 } @stages[ 1 .. $#stages ] ];
+
+	if ($r0 != $rows || $c0 != $columns) {
+		my $small = ref($grid)->new( $r0, $c0, $grid->dim );
+		$small->distance_function( $grid->distance_function );
+
+		$self->grid( $small );
+	}
 
+	$self->SUPER::init(@_);
 }
 
 sub before_epoch {
+	my $self  = shift;
+	my $stage = $self->{'_grow_stages'};
+
+	if ($stage && @{ $stage } && $stage->[0]->[0] <= $self->{'_epoch'}) {
+		my (undef, $rows, $columns) = @{ shift @{ $stage } };
+		$self->_grow( $rows, $columns );
+	}
+
+	$self->SUPER::before_epoch;
+}
+
+# a map that stops improving before it reaches its full size grows
+# early instead of stopping
+sub stop {
+	my $self = shift;
+
+	return 0 unless $self->SUPER::stop;
+
+	my $stage = $self->{'_grow_stages'};
+	return 1 unless ($stage && @{ $stage } && $self->{'_epoch'} < $self->{'_epochs'});
 
+	$stage->[0]->[0] = $self->{'_epoch'};
+	@{ $self->{'_qe_history'} } = ();
+
+	return 0;
+}
+
+# the cooling schedule is in neurons of the full grid
+sub scale_radius {
+	my ($self, $radius) = @_;
+
+	return $radius unless $self->{'_grow_target'};
+
+	my $g = $self->{'_grid'};
+	my ($rows, $columns) = @{ $self->{'_grow_target'} };
+	my $scale = sqrt( ($g->rows * $g->columns) / ($rows * $columns) );
+
+	return $scale < 1 ? max( 1, floor( 0.5 + $radius * $scale ) ) : $radius;
+}
+
+sub _grow {
+	my ($self, $rows, $columns) = @_;
+
+	my $old = $self->grid;
+	my $new = grow_grid( $old, $rows, $columns, $self->{'_grow_method'} );
+
+	warn "[ ", sprintf("%.2f", time() - $TIME), "s ] Grid grown to [ $rows x $columns ]\n";
+
+	# last bestmatches point at the same neurons on the new grid
+	my %seen;
+	foreach my $list($self->{'_bestmatches'}, $self->BMSearch->old_bestmatches) {
+		next if (!defined $list || $seen{ refaddr $list }++);
+		grow_bestmatches( $list, $old, $new );
+	}
+
+	$self->grid( $new );
+
+	# the grown grid has no cached distances, the next cool rebuilds them
+	$self->{'_radius'} = 0;
+}
+
+sub _final_size {
+	my $self = shift;
+	return $self->{'_grow_target'} ? @{ $self->{'_grow_target'} } : $self->SUPER::_final_size;
 }
 	
 1;
@@ -0,0 +1,256 @@
+package Anorman::ESOM::Snapshots;
+
+# Training progress as an animation. Each snapshot takes the U-matrix
+# of the live weights natively, measuring again only the neurons that
+# moved since the last one, colors it as the ImageRenderer would and
+# hands the frame to a background thread that compresses and writes
+# it (src/anorman/lib/umatrix.c, raster.c and frames.c):
+#
+#	my $s = Anorman::ESOM::Snapshots->new( 'training.png', $grid, zoom => 2 );
+#	$s->add( $grid, $epoch ) foreach ...;
+#	$s->close;
+#
+# A file name with a printf conversion for the epoch, e.g.
+# 'som.epoch%03d.png', writes one PNG per snapshot instead of an
+# animated PNG; any other '%' in such a name is written '%%'. Frames are the size of the grid given to new, or of
+# rows x columns when given: a smaller grid, as while a GESOM grows,
+# is stretched to it bilinearly
+
+use strict;
+use warnings;
+
+use Anorman::Common qw(trace_error);
+use Anorman::Data::LinAlg::Property qw(is_matrix is_packed);
+use Anorman::ESOM::ImageRenderer;
+
+my %DEFAULTS = (
+	'colorscheme' => undef,
+	'zoom'        => 1,
+	'tiled'       => 1,
+	'delay'       => 200,
+	'level'       => 1,
+	'rows'        => undef,
+	'columns'     => undef
+);
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	my ($file, $grid, %user_opt) = @_;
+
+	do { trace_error("Illegal argument $_") unless exists $DEFAULTS{ $_ } } for keys %user_opt;
+	my %opt = (%DEFAULTS, %user_opt);
+
+	trace_error("Not an ESOM grid") unless (defined $grid && $grid->isa("Anorman::ESOM::Grid"));
+	trace_error("Zoom must be a positive integer") unless ($opt{'zoom'} =~ /^\d+$/ && $opt{'zoom'} > 0);
+
+	# the name is the printf format of numbered files
+	if ($file =~ /%/) {
+		(my $plain = $file) =~ s/%%//g;
+		trace_error("File name $file needs one %d conversion for the epoch, and '%%' for other '%'")
+			unless ($plain =~ /^[^%]*%0?\d*d[^%]*$/);
+	}
+
+	# the color table of the renderer, grayscale by default
+	my $colors  = Anorman::ESOM::ImageRenderer->new( undef, colorscheme => $opt{'colorscheme'} )->colors;
+	my $palette = pack( 'C*', map { $_->rgb } @{ $colors } );
+	my $toroid  = $grid->isa("Anorman::ESOM::Grid::ToroidRectangular") ? 1 : 0;
+
+	my $rows    = defined $opt{'rows'}    ? $opt{'rows'}    : $grid->rows;
+	my $columns = defined $opt{'columns'} ? $opt{'columns'} : $grid->columns;
+
+	my $self = _XS_new( $class, $file, $rows, $columns, $grid->dim, $toroid, $palette,
+			    $opt{'zoom'}, $opt{'tiled'} ? 1 : 0, $opt{'delay'}, $opt{'level'} );
+
+	trace_error("Could not write $file: $!") unless defined $self;
+
+	return $self;
+}
+
+# a frame of the grid after $epoch
+sub add {
+	my ($self, $grid, $epoch) = @_;
+	my $weights = $grid->get_weights;
+
+	trace_error("Weights must be a packed matrix") unless (is_matrix($weights) && is_packed($weights));
+	trace_error("Writing snapshots failed") unless $self->_XS_add( $weights, $grid->rows, $grid->columns, $epoch || 0 );
+}
+
+sub close {
+	my $self = shift;
+	trace_error("Writing snapshots failed") unless $self->_XS_close;
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::ESOM::Snapshots',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lz -lm -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "matrix.h"
+#include "raster.h"
+#include "umatrix.h"
+#include "frames.h"
+#include "grow.h"
+
+#include "../lib/threads.c"
+#include "../lib/raster.c"
+#include "../lib/umatrix.c"
+#include "../lib/frames.c"
+#include "../lib/grow.c"
+
+struct snapshots_struct
+{
+    UMatrix*     umx;
+    FrameWriter* fw;
+    size_t       rows;       /* of the frames */
+    size_t       columns;
+    size_t       dim;
+    int          toroid;
+    double*      heights;
+    uint8_t*     palette;
+    size_t       colors;
+    size_t       zoom;
+    int          tiled;
+};
+
+typedef struct snapshots_struct Snapshots;
+
+SV* _XS_new( SV* sv_class_name, char* path, UV rows, UV columns, UV dim, IV toroid, SV* sv_palette,
+             UV zoom, IV tiled, UV delay, IV level ) {
+    SV* self;
+
+    STRLEN n;
+    const char* palette = SvPV( sv_palette, n );
+
+    FrameWriter* fw = c_fw_open( path, (int) level, (unsigned) delay );
+
+    if (fw == NULL) {
+        return &PL_sv_undef;
+    }
+
+    Snapshots* s;
+    Newxz( s, 1, Snapshots );
+    Newx( s->heights, rows * columns + 1, double );
+    Newx( s->palette, n + 1, uint8_t );
+
+    Copy( palette, s->palette, n, uint8_t );
+
+    s->fw      = fw;
+    s->rows    = (size_t) rows;
+    s->columns = (size_t) columns;
+    s->dim     = (size_t) dim;
+    s->toroid  = (int) toroid;
+    s->colors = n / 3;
+    s->zoom   = (size_t) zoom;
+    s->tiled  = (int) tiled;
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( s, self, class_name );
+
+    return self;
+}
+
+IV _XS_add( SV* self, SV* sv_w, UV rows, UV columns, UV epoch ) {
+    SV_2STRUCT( self, Snapshots, s );
+    SV_2STRUCT( sv_w, Matrix, w );
+
+    if (s->fw == NULL) {
+        croak("Snapshots are closed");
+    }
+
+    if (rows > s->rows || columns > s->columns || w->rows != rows * columns || w->columns != s->dim) {
+        croak("Weights do not fit the grid");
+    }
+
+    /* edges are kept for one grid size, a new size starts over */
+    if (s->umx == NULL || s->umx->rows != rows || s->umx->columns != columns) {
+        c_umx_free( s->umx );
+        s->umx = c_umx_alloc( (size_t) rows, (size_t) columns, s->dim, s->toroid );
+    }
+
+    UMatrix* u = s->umx;
+
+    /* neuron rows in place, or copied out of a view */
+    double* copy = NULL;
+    double* p    = w->elements + c_m_index( w, 0, 0 );
+    size_t  stride = w->row_stride;
+
+    if (w->offsets != NULL || w->column_stride != 1) {
+        size_t i, j;
+
+        Newx( copy, w->rows * w->columns + 1, double );
+        for (i = 0; i < w->rows; i++) {
+            for (j = 0; j < w->columns; j++) {
+                copy[ i * w->columns + j ] = c_m_get_quick( w, i, j );
+            }
+        }
+
+        p      = copy;
+        stride = w->columns;
+    }
+
+    if (u->rows == s->rows && u->columns == s->columns) {
+        c_umx_update( u, p, stride, s->heights );
+    } else {
+        double* h;
+        Newx( h, u->rows * u->columns + 1, double );
+
+        c_umx_update( u, p, stride, h );
+
+        GrowAxis* ar = c_grow_axis_alloc( u->rows, s->rows, s->toroid, C_GROW_BILINEAR );
+        GrowAxis* ac = c_grow_axis_alloc( u->columns, s->columns, s->toroid, C_GROW_BILINEAR );
+
+        c_grow_weights( h, 1, 1, ar, ac, s->heights, 1 );
+
+        c_grow_axis_free( ar );
+        c_grow_axis_free( ac );
+        Safefree( h );
+    }
+
+    Safefree( copy );
+
+    const size_t tiles = s->tiled ? 2 : 1;
+    Raster* r = c_raster_alloc( tiles * s->zoom * s->columns, tiles * s->zoom * s->rows );
+
+    c_raster_background( r, s->heights, s->rows, s->columns, s->zoom, s->tiled, s->palette, s->colors );
+
+    return c_fw_push( s->fw, r, (size_t) epoch ) == C_SUCCESS;
+}
+
+IV _XS_close( SV* self ) {
+    SV_2STRUCT( self, Snapshots, s );
+
+    if (s->fw == NULL) {
+        return 1;
+    }
+
+    const int status = c_fw_close( s->fw );
+    s->fw = NULL;
+
+    return status == C_SUCCESS;
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, Snapshots, s );
+
+    if (s->fw) {
+        c_fw_close( s->fw );
+    }
+
+    c_umx_free( s->umx );
+    Safefree( s->heights );
+    Safefree( s->palette );
+    Safefree( s );
+}
+
+END_OF_C_CODE
+
+1;
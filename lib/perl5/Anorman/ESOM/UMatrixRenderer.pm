@@ -29,9 +29,11 @@ sub render {
 		my $df = $grid->distance_function;
 
 		my $matrix = Anorman::Data->matrix( $h, $w );
-		
-		warn "Caching neuron views...\n" if $VERBOSE;
-		my @neurons = map { $grid->get_neuron( $_ ) } (0 .. $grid->size - 1); #NOTE: potential memory leak;
+
+		# two cursors over the neurons instead of a view per neuron
+		my $weights  = $grid->get_weights;
+		my $neuron_i = $weights->row_cursor;
+		my $neuron_j = $weights->row_cursor;
 
 		warn "Calculating U-Matrix heights ...\n" if $VERBOSE;
 		my $row = $h;
@@ -45,9 +47,11 @@ sub render {
 				my $sum   = 0;
 				my $n     = 0;
 
+				$weights->seek_row( $neuron_i, $i );
+
 				foreach my $j( $grid->immediate_neighbors( $i ) ) {
-					#$sum += $grid->distance_function->apply_quick( $grid->get_neuron( $i ),  $grid->get_neuron( $j ) );
-					$sum += $grid->distance_function->( $neurons[ $i ], $neurons[ $j ] );
+					$weights->seek_row( $neuron_j, $j );
+					$sum += $df->( $neuron_i, $neuron_j );
 					$n++;
 				}
 
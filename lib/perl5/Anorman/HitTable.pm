@@ -11,6 +11,7 @@ package Anorman::HitTable;
 
 use strict;
 use Anorman::Common;
+use Anorman::HitTable::TopHits;
 
 sub new {
 	my $class = shift;
@@ -92,6 +93,20 @@ sub store_record {
 	push @{ $records }, $r;
 }
 
+# read the opened table natively from the top, keeping only the best $n hits
+# (default 1) by bit score of each query, or of each query domain when $by
+# is 'domain'. Much leaner than store_record / uniq_records on large tables
+sub top_records {
+	my $self = shift;
+	my $n    = shift || 1;
+	my $by   = shift || 'query';
+
+	my $top  = Anorman::HitTable::TopHits->new( $self->{'_format'}, top => $n, by => $by );
+	$top->read( defined $self->{'_file'} ? $self->{'_file'} : '-' );
+
+	return $top->records;
+}
+
 sub fetch_record {
 	my $self  = shift;
 	my $index = shift;
@@ -181,6 +196,7 @@ sub _initialize {
 	}
 
 	$self->{'_fh'}      = $FH;
+	$self->{'_format'}  = $format;
 	$self->{'_parser'}  = $parse_types{ $format }->();
 	$self->{'_file'}    = $file;
 	$self->{'_records'} = [];
@@ -0,0 +1,220 @@
+package Anorman::HitTable::TopHits;
+
+# Native streaming reader for hit tables (src/anorman/lib/hittable.c).
+# Only the best $top hits by bit score of every query (or of every query
+# domain) are kept while the table is read, so a multi-GB search output
+# costs memory by the number of queries:
+#
+#	my $hits = Anorman::HitTable::TopHits->new( 'blast', top => 1 );
+#	$hits->read( $file );
+#
+#	while (my $r = $hits->next_record) {
+#		print "$r->{'q_id'}\t$r->{'s_id'}\t$r->{'bit_score'}\n";
+#	}
+#
+# Records are hashes keyed as by Anorman::HitTable, handed out query by
+# query in order of first appearance, best hit first
+
+use strict;
+use warnings;
+
+use Anorman::Common qw(trace_error);
+
+my %FORMATS = (
+	'blast'      => 0,
+	'hmmscan'    => 1,
+	'hmmscandom' => 2
+);
+
+my %GROUP_BY = (
+	'query'  => 0,
+	'domain' => 1
+);
+
+# format as for Anorman::HitTable::open; options top (hits kept per
+# group, 1) and by ('query', or 'domain' for domain tables)
+sub new {
+	my $that   = shift;
+	my $class  = ref $that || $that;
+	my $format = shift;
+	my %opt    = @_;
+
+	trace_error("Unknown table type \"$format\"") unless exists $FORMATS{ $format };
+
+	my $by  = $opt{'by'}  || 'query';
+	my $top = $opt{'top'} || 1;
+
+	trace_error("Hits are grouped by query or domain") unless exists $GROUP_BY{ $by };
+
+	return _XS_new( $class, $FORMATS{ $format }, $GROUP_BY{ $by }, $top );
+}
+
+# read a table, STDIN if no file is given. May be called on several
+# tables in turn. Returns the number of data lines
+sub read {
+	my $self = shift;
+	my $file = defined $_[0] ? shift : '-';
+	my $n    = $self->_XS_read( $file );
+
+	trace_error("Could not read $file: $!") if $n < 0;
+
+	$self->rewind;
+
+	return $n;
+}
+
+sub rewind {
+	$_[0]->_XS_rewind;
+}
+
+# the surviving records one at a time
+sub next_record {
+	my $self = shift;
+	return $self->_XS_next;
+}
+
+sub records {
+	my $self = shift;
+	my @records;
+
+	foreach my $g(0 .. $self->groups - 1) {
+		push @records, map { $self->_XS_record( $g, $_ ) } 0 .. $self->_XS_count( $g ) - 1;
+	}
+
+	return @records;
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::HitTable::TopHits',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "perl2c.h"
+#include "error.h"
+#include "intern.h"
+#include "hittable.h"
+
+#include "../lib/intern.c"
+#include "../lib/hittable.c"
+
+static void c_hits_store_name( HV* hv, const char* key, StrIntern* si, uint32_t id ) {
+    size_t len;
+    const char* s = id == UINT32_MAX ? NULL : c_intern_name( si, id, &len );
+
+    (void) hv_store( hv, key, (I32) strlen( key ), s ? newSVpvn( s, len ) : newSV( 0 ), 0 );
+}
+
+SV* _XS_new( SV* sv_class_name, IV format, IV group_by, UV top_n ) {
+    HitTable* h = c_hits_alloc( (int) format, (int) group_by, (size_t) top_n );
+    SV* self;
+
+    if (h == NULL) {
+        croak("Failed to allocate hit table");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( h, self, class_name );
+
+    return self;
+}
+
+IV _XS_read( SV* self, char* path ) {
+    SV_2STRUCT( self, HitTable, h );
+    return (IV) c_hits_read( h, path );
+}
+
+UV lines( SV* self ) {
+    SV_2STRUCT( self, HitTable, h );
+    return (UV) h->lines;
+}
+
+UV skipped( SV* self ) {
+    SV_2STRUCT( self, HitTable, h );
+    return (UV) h->skipped;
+}
+
+UV groups( SV* self ) {
+    SV_2STRUCT( self, HitTable, h );
+    return (UV) c_hits_groups( h );
+}
+
+UV _XS_count( SV* self, UV group ) {
+    SV_2STRUCT( self, HitTable, h );
+    return (UV) c_hits_count( h, (size_t) group );
+}
+
+/* a record with the keys of the table layout */
+static SV* c_hits_record_sv( HitTable* h, const HitRecord* r ) {
+    if (r == NULL) {
+        return &PL_sv_undef;
+    }
+
+    HV* hv = newHV();
+
+    c_hits_store_name( hv, "q_id", h->names, r->q_id );
+    c_hits_store_name( hv, "s_id", h->names, r->s_id );
+
+    hv_stores( hv, "eval",      newSVnv( r->eval ) );
+    hv_stores( hv, "bit_score", newSVnv( r->bit_score ) );
+
+    if (h->format == C_HIT_BLAST) {
+        hv_stores( hv, "pct_id",      newSVnv( r->pct_id ) );
+        hv_stores( hv, "aln_len",     newSVuv( r->aln_len ) );
+        hv_stores( hv, "mistmatches", newSVuv( r->mismatches ) );
+        hv_stores( hv, "gap_open",    newSVuv( r->gap_open ) );
+        hv_stores( hv, "q_beg",       newSVuv( r->q_beg ) );
+        hv_stores( hv, "q_end",       newSVuv( r->q_end ) );
+        hv_stores( hv, "s_beg",       newSVuv( r->s_beg ) );
+        hv_stores( hv, "s_end",       newSVuv( r->s_end ) );
+
+        return newRV_noinc( (SV*) hv );
+    }
+
+    c_hits_store_name( hv, "q_acc", h->accs, r->q_acc );
+    c_hits_store_name( hv, "s_acc", h->accs, r->s_acc );
+
+    hv_stores( hv, "bias", newSVnv( r->bias ) );
+
+    const int64_t d = r->s_id < h->s_desc_capacity ? h->s_desc[ r->s_id ] : -1;
+    c_hits_store_name( hv, "s_desc", h->descs, d < 0 ? UINT32_MAX : (uint32_t) d );
+
+    if (h->format == C_HIT_DOMTBLOUT) {
+        hv_stores( hv, "s_len",   newSVuv( r->s_len ) );
+        hv_stores( hv, "q_len",   newSVuv( r->q_len ) );
+        hv_stores( hv, "dom_num", newSVuv( r->dom_num ) );
+        hv_stores( hv, "s_beg",   newSVuv( r->s_beg ) );
+        hv_stores( hv, "s_end",   newSVuv( r->s_end ) );
+        hv_stores( hv, "q_beg",   newSVuv( r->q_beg ) );
+        hv_stores( hv, "q_end",   newSVuv( r->q_end ) );
+    }
+
+    return newRV_noinc( (SV*) hv );
+}
+
+SV* _XS_record( SV* self, UV group, UV k ) {
+    SV_2STRUCT( self, HitTable, h );
+    return c_hits_record_sv( h, c_hits_get( h, (size_t) group, (size_t) k ) );
+}
+
+SV* _XS_next( SV* self ) {
+    SV_2STRUCT( self, HitTable, h );
+    return c_hits_record_sv( h, c_hits_next( h ) );
+}
+
+void _XS_rewind( SV* self ) {
+    SV_2STRUCT( self, HitTable, h );
+    c_hits_rewind( h );
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, HitTable, h );
+    c_hits_free( h );
+}
+
+END_OF_C_CODE
+
+1;
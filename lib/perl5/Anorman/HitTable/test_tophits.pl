@@ -0,0 +1,32 @@
+#!/usr/bin/env perl
+
+# reading a table after the records of an earlier one were handed out
+# must still keep the best hits
+
+use strict;
+use warnings;
+
+use File::Temp qw(tempfile);
+use Anorman::HitTable::TopHits;
+
+sub table {
+	my ($fh, $file) = tempfile( UNLINK => 1 );
+	printf $fh ("q1\t%s\t99.0\t100\t1\t0\t1\t100\t1\t100\t1e-20\t%g\n", @{ $_ }) foreach @_;
+	close $fh;
+	return $file;
+}
+
+my $hits = Anorman::HitTable::TopHits->new( 'blast', top => 3 );
+
+$hits->read( table( [ 'a', 30 ], [ 'b', 20 ], [ 'c', 10 ] ) );
+my @first = map { $_->{'bit_score'} } $hits->records;
+
+$hits->read( table( [ 'd', 25 ], [ 'e', 5 ] ) );
+my @second = map { $_->{'bit_score'} } $hits->records;
+
+print "first : @first\nsecond: @second\n";
+
+die "Expected 30 20 10 after the first table\n"  unless "@first"  eq "30 20 10";
+die "Expected 30 25 20 after the second table\n" unless "@second" eq "30 25 20";
+
+print "ok\n";
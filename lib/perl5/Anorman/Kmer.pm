@@ -3,7 +3,7 @@ package Anorman::Kmer;
 use strict;
 
 use Anorman::Common;
-use Anorman::DNA qw(mono_nt_freq);
+use Anorman::DNA qw(composition);
 
 our $VERSION = 0.8;
 
@@ -44,6 +44,14 @@ sub seq {
 		%{ $self->{'_mono_nt_freq'} } = ();
 		$self->{'ksum'}               = 0;
 
+		# one native pass gives the base counts, and tells whether
+		# any k-mer can hold a non-ACGT base at all
+		my @counts = composition( $self->{'seq'} );
+
+		$self->{'_composition'} = \@counts;
+		$self->{'_acgt_only'}   = $counts[0] + $counts[1] + $counts[2] + $counts[3] == length $self->{'seq'}
+		                          && !($self->{'seq'} =~ tr/acgt//);
+
 		$self->_count_kmers;
 	} else {
 		return $self->{'seq'};
@@ -75,9 +83,10 @@ sub relative_kmer_abundance {
 	my @KMER = split //, $kmer;
 
 	unless (%{ $self->{'_mono_nt_freq'} }) {
-		# analyze mononucleotide frequencies
+		# mononucleotide frequencies from the counts taken by seq()
+		my $length = length $self->{'seq'};
 		my %mono_nt_freq        = ();
-		@mono_nt_freq{ qw/A C T G/ } = mono_nt_freq( $self->{'seq'} );
+		@mono_nt_freq{ qw/A C G T/ } = map { $_ / $length } @{ $self->{'_composition'} }[0 .. 3];
 
 		$self->{'_mono_nt_freq'} = \%mono_nt_freq;
 	}		
@@ -137,7 +146,7 @@ sub _count_kmers {
 	while (defined (my $kmer = $self->_pick_kmer($pos) ) ) {
 		
 		# skip illegal Kmers entirely
-		if ($self->$kmer =~ m/[^ACTG]/) {
+		if (!$self->{'_acgt_only'} && $kmer =~ m/[^ACTG]/) {
 			$pos += $self->{'ksize'};
 			next;
 		} 
@@ -145,7 +154,7 @@ sub _count_kmers {
 		my $rckmer = reverse $kmer;
 		$rckmer =~ tr/ACTG/TGAC/;
 
-		$kmer = $kmer cmp $rckmer ? $kmer : $rckmer;
+		$kmer = $kmer lt $rckmer ? $kmer : $rckmer;
 		$self->{'kmers'}->{ $kmer }++;
 		
 		$pos++;
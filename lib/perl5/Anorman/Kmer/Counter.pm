@@ -0,0 +1,349 @@
+package Anorman::Kmer::Counter;
+
+# Native canonical k-mer counting (src/anorman/lib/kmer.c) for any k up
+# to 63. Where Anorman::Kmer keeps one hash key per k-mer, this counts
+# into minimizer partitioned tables on all threads ($AN_THREADS) and
+# keeps the spectrum as one sorted array, so large k and large inputs
+# stay within memory:
+#
+#	my $kc = Anorman::Kmer::Counter->new( 31, parts => 64, spill => '/scratch' );
+#	$kc->add( $_ ) foreach @seqs;
+#	$kc->count;
+#	$kc->save( 'reads.k31' );
+#
+#	my $X = $kc->matrix( \@seqs, 2 );  # Anorman::Data::Matrix::CSR
+#
+# The spectrum is addressed by rank, 0 .. size - 1, in key order. Matrix
+# columns are ranks, so rows built from one spectrum line up. The matrix
+# is SOM training data as it is (Anorman::ESOM::SOM::data takes CSR);
+# vector.c, matrix.c and sparse.c are compiled in, gemm, map and the
+# allocator come from libandata
+
+use strict;
+use warnings;
+
+use Anorman::Common qw(trace_error);
+use Anorman::Data::Matrix::CSR;
+
+my %DEFAULTS = (
+	'parts'  => 16,
+	'memory' => 0,
+	'spill'  => undef
+);
+
+sub new {
+	my $that  = shift;
+	my $class = ref $that || $that;
+	my $k     = shift;
+
+	trace_error("k-mer size must be 1 .. 63") unless (defined $k && $k =~ /^\d+$/ && $k >= 1 && $k <= 63);
+
+	my %opt = (%DEFAULTS, @_);
+
+	trace_error("Spill directory $opt{'spill'} is not writable") if (defined $opt{'spill'} && !-w $opt{'spill'});
+
+	return _XS_new( $class, $k, $opt{'parts'}, $opt{'memory'}, $opt{'spill'} );
+}
+
+# a count file written by save
+sub load {
+	my ($that, $file) = @_;
+	my $class = ref $that || $that;
+
+	my $self = _XS_load( $class, $file );
+	trace_error("$file is not a readable k-mer count file") unless defined $self;
+
+	return $self;
+}
+
+sub add {
+	my $self = shift;
+
+	trace_error("k-mers have already been counted") if $self->is_counted;
+
+	# full batches are counted into partitions, and spilled past the
+	# memory limit
+	foreach my $seq(@_) {
+		trace_error("Could not add sequence. Check the spill directory: $!") unless $self->_XS_add( $seq );
+	}
+
+	return $self;
+}
+
+sub count {
+	my $self = shift;
+
+	trace_error("Could not count k-mers. Check the spill directory: $!") unless $self->_XS_count;
+
+	return $self->size;
+}
+
+sub save {
+	my ($self, $file) = @_;
+
+	trace_error("Count k-mers before saving them") unless $self->is_counted;
+	trace_error("Could not write $file: $!") unless $self->_XS_save( $file );
+}
+
+sub count_of {
+	my ($self, $kmer) = @_;
+	my $i = $self->index_of( $kmer );
+
+	return $i < 0 ? 0 : $self->count_at( $i );
+}
+
+# (ranks, counts) of the k-mers in $seq seen at least $min_count times
+sub row {
+	my ($self, $seq, $min_count) = @_;
+	my ($columns, $values) = ([], []);
+
+	$self->_check_counted;
+	$self->_XS_row( $seq, $min_count || 1, $columns, $values );
+
+	return ($columns, $values);
+}
+
+# one row per sequence, one column per k-mer of the spectrum
+sub matrix {
+	my ($self, $seqs, $min_count) = @_;
+
+	$self->_check_counted;
+	trace_error("Sequences must be an array reference") unless ref $seqs eq 'ARRAY';
+
+	return $self->_XS_matrix( $seqs, $min_count || 1 );
+}
+
+sub _check_counted {
+	trace_error("k-mers have not been counted") unless $_[0]->is_counted;
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Kmer::Counter',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "map.h"
+#include "sparse.h"
+#include "kmer.h"
+
+#include "../lib/vector.c"
+#include "../lib/matrix.c"
+#include "../lib/threads.c"
+#include "../lib/sparse.c"
+#include "../lib/kmer.c"
+
+static SV* _bless_counter( KmerCounter* kc, SV* sv_class_name ) {
+    SV* self;
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( kc, self, class_name );
+
+    return self;
+}
+
+static void _encode( KmerCounter* kc, SV* sv_kmer, uint64_t* key, int* valid ) {
+    STRLEN len;
+    const char* s = SvPV( sv_kmer, len );
+
+    *valid = c_kc_encode( kc, s, (size_t) len, key ) == C_SUCCESS;
+}
+
+SV* _XS_new( SV* sv_class_name, UV k, UV parts, UV memory, SV* sv_spill ) {
+    const char* spill = SvOK( sv_spill ) ? SvPV_nolen( sv_spill ) : NULL;
+
+    KmerCounter* kc = c_kc_alloc( (size_t) k, (size_t) parts, (size_t) memory, spill );
+
+    if (kc == NULL) {
+        croak("Failed to allocate k-mer counter");
+    }
+
+    return _bless_counter( kc, sv_class_name );
+}
+
+SV* _XS_load( SV* sv_class_name, char* path ) {
+    KmerCounter* kc = c_kc_load( path );
+
+    if (kc == NULL) {
+        return &PL_sv_undef;
+    }
+
+    return _bless_counter( kc, sv_class_name );
+}
+
+IV _XS_add( SV* self, SV* sv_seq ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+
+    STRLEN len;
+    const char* s = SvPV( sv_seq, len );
+
+    return c_kc_add( kc, s, (size_t) len ) == C_SUCCESS;
+}
+
+IV _XS_count( SV* self ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+    return c_kc_count( kc ) == C_SUCCESS;
+}
+
+IV _XS_save( SV* self, char* path ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+    return c_kc_save( kc, path ) == C_SUCCESS;
+}
+
+IV is_counted( SV* self ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+    return kc->counted;
+}
+
+UV k( SV* self ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+    return (UV) kc->k;
+}
+
+UV size( SV* self ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+    return (UV) kc->n;
+}
+
+NV total( SV* self ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+    return (NV) kc->total;
+}
+
+SV* kmer( SV* self, UV i ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+
+    if (i >= kc->n) {
+        croak("k-mer %lu out of range", (unsigned long) i);
+    }
+
+    SV* sv = newSV( kc->k + 1 );
+    SvPOK_on( sv );
+    c_kc_decode( kc, kc->keys + i * kc->words, SvPVX( sv ) );
+    SvCUR_set( sv, kc->k );
+    *SvEND( sv ) = '\0';
+
+    return sv;
+}
+
+UV count_at( SV* self, UV i ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+
+    if (i >= kc->n) {
+        croak("k-mer %lu out of range", (unsigned long) i);
+    }
+
+    return (UV) kc->counts[ i ];
+}
+
+IV index_of( SV* self, SV* sv_kmer ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+
+    uint64_t key[ 2 ];
+    int valid;
+
+    _encode( kc, sv_kmer, key, &valid );
+
+    return valid ? (IV) c_kc_find( kc, key ) : -1;
+}
+
+void _XS_row( SV* self, SV* sv_seq, UV min_count, AV* av_columns, AV* av_values ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+
+    STRLEN len;
+    const char* s = SvPV( sv_seq, len );
+
+    size_t* cols;
+    double* vals;
+    Newx( cols, len + 1, size_t );
+    Newx( vals, len + 1, double );
+
+    const int64_t nnz = c_kc_row( kc, s, (size_t) len, (uint32_t) min_count, cols, vals );
+
+    int64_t k;
+    for (k = 0; k < nnz; k++) {
+        av_push( av_columns, newSVuv( (UV) cols[ k ] ) );
+        av_push( av_values, newSVnv( vals[ k ] ) );
+    }
+
+    Safefree( cols );
+    Safefree( vals );
+}
+
+SV* _XS_matrix( SV* self, AV* av_seqs, UV min_count ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+
+    const size_t rows = (size_t) (av_len( av_seqs ) + 1);
+
+    /* rows first, then the matrix at its final size */
+    size_t* row_ptr;
+    Newxz( row_ptr, rows + 1, size_t );
+
+    size_t  capacity = 1024, nnz = 0;
+    size_t* cols;
+    double* vals;
+    Newx( cols, capacity, size_t );
+    Newx( vals, capacity, double );
+
+    size_t i;
+    for (i = 0; i < rows; i++) {
+        SV** svp = av_fetch( av_seqs, i, 0 );
+
+        STRLEN len = 0;
+        const char* s = (svp != NULL && SvOK( *svp )) ? SvPV( *svp, len ) : "";
+
+        while (nnz + len + 1 > capacity) {
+            capacity *= 2;
+            Renew( cols, capacity, size_t );
+            Renew( vals, capacity, double );
+        }
+
+        const int64_t n = c_kc_row( kc, s, (size_t) len, (uint32_t) min_count, cols + nnz, vals + nnz );
+
+        nnz += n > 0 ? (size_t) n : 0;
+        row_ptr[ i + 1 ] = nnz;
+    }
+
+    CSRMatrix* csr = c_csr_alloc( rows, kc->n, nnz );
+
+    if (csr == NULL) {
+        Safefree( row_ptr );
+        Safefree( cols );
+        Safefree( vals );
+        croak("Could not create CSR matrix");
+    }
+
+    memcpy( csr->row_ptr, row_ptr, (rows + 1) * sizeof(size_t) );
+    memcpy( csr->col_idx, cols, nnz * sizeof(size_t) );
+
+    size_t k;
+    for (k = 0; k < nnz; k++) {
+        csr->values[ k ] = vals[ k ];
+    }
+
+    Safefree( row_ptr );
+    Safefree( cols );
+    Safefree( vals );
+
+    SV* sv_csr;
+    BLESS_STRUCT( csr, sv_csr, "Anorman::Data::Matrix::CSR" );
+
+    return sv_csr;
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, KmerCounter, kc );
+    c_kc_free( kc );
+}
+
+END_OF_C_CODE
+
+1;
@@ -45,7 +45,7 @@ use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::Math::CVectorFunctions',
 		ENABLE    => AUTOWRAP =>
-		LIBS      => '-L/usr/local/opt/openblas/lib -L' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lopenblas',
+		LIBS      => '-L/usr/local/opt/openblas/lib -L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lopenblas',
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include -I/usr/local/opt/openblas/include'
 	   );
 use Inline C => <<'END_OF_C_CODE';
@@ -58,11 +58,13 @@ use Inline C => <<'END_OF_C_CODE';
 #include "functions/functions.h"
 #include "functions/vector.h"
 #include "functions/vectorvector.h"
+#include "functions/kernels.h"
 
 /*
 #include "../lib/vector.c"
 */
 
+#include "../lib/functions/kernels.c"
 #include "../lib/functions/vector.c"
 #include "../lib/functions/vectorvector.c"
 #include "../lib/functions/functions.c"
@@ -83,57 +83,20 @@ sub stats_quick {
 	# and has no requirement for sorted values
 	return undef unless @_ >= 1;
 	
-	my $n = scalar @_;
-	
-	my $min    = inf;
-	my $max    = -inf;
-	my $nz_min = inf;
-	my $sum    = 0;
-
-	foreach (@_) {
-		$min = $min < $_ ? $min : $_;
-		$max = $max > $_ ? $max : $_;
-		$sum += $_;
-
-		next unless $_ > 0;
-		$nz_min = $nz_min < $_ ? $nz_min : $_;
-	}
-
-	my $mean = $sum / $n;
+	my ($n, $min, $nz_min, $max, $sum, $mean) = &_XS_stats( \@_, 0 );
 
 	return ( { _n => $n, _min => $min, _nz_min => $nz_min, _max => $max, _sum => $sum, _mean => $mean } );
 }
 
 sub stats_lite {
 	# calculates the same as quick stats but also calculates variance and standard deviation
-	# requires two passes, as the mean value needs to be calculated first
+	# variance is accumulated in the same pass (Welford), only the average deviation needs a second
 	return undef unless @_ > 1;
 	
-	my $r        = &stats_quick(@_);
-	my $mean     = $r->{'_mean'};
-	my $n        = $r->{'_n'};
-
-	my $variance = 0;
-	my $stdev    = 0;
-	my $avdev    = 0;
-	
-	foreach (@_) {
-		my $d1 = $_ - $mean;
-		my $d2 = $d1**2;
-
-		$avdev    += abs($d1);
-		$variance += $d2;
-	}
-
-	$variance /= ($n - 1);
-	$avdev    /= $n;
-	$stdev     = sqrt($variance);
+	my ($n, $min, $nz_min, $max, $sum, $mean, $variance, $avdev) = &_XS_stats( \@_, 1 );
 
-	$r->{'_stdev'}    = $stdev;
-	$r->{'_avdev'}    = $avdev;
-	$r->{'_variance'} = $variance;
-
-	return $r;
+	return ( { _n => $n, _min => $min, _nz_min => $nz_min, _max => $max, _sum => $sum, _mean => $mean,
+	           _variance => $variance, _stdev => sqrt( $variance ), _avdev => $avdev } );
 }
 
 sub stats_full {
@@ -245,21 +208,35 @@ sub optimize_BoxCox_lambda {
 	my $data_r  = shift;
 	my $lmin    = shift;
 	my $lmax    = shift;
-	my $lambda2 = defined $_[0] ? shift : &_calc_lambda2( derefify( $data_r) );
+	my $lambda2 = shift;
+
+	my ($fit) = &optimize_BoxCox_lambdas( [ $data_r ], $lmin, $lmax, $lambda2 );
+
+	return $fit->[0];
+}
+
+sub optimize_BoxCox_lambdas {
+	# optimizes lambda1 for a list of columns in one native call. Columns are
+	# processed in parallel (see $AN_THREADS). Returns one [ lambda1, lambda2 ]
+	# pair per column
+	my $columns = shift;
+	my $lmin    = shift;
+	my $lmax    = shift;
+	my $lambda2 = shift;
+	my $tau     = defined $_[0] ? shift : 1e-3;
 
 	$lmin = -1 unless defined $lmin;
 	$lmax =  1 unless defined $lmax;
-        
+
 	trace_error("Lmin <$lmin> must be smaller than Lmax <$lmax>") unless $lmin < $lmax;
-	
-	warn "Optimize BoxCox lambda: ($lmin, $lmax)\n";
-	warn "\nlambda1\tlambda2\tLmax\n";
-	warn "-------\t-------\t----\n";
+	trace_error("First argument must be an ARRAY reference") unless ref $columns eq 'ARRAY';
 
-	my $func = sub { my $lambda1 = shift; return &_BoxCox_lambda_likelihood( $data_r, $lambda1, $lambda2 ) };
-	my $tau  = 1e-3;
-	
-	return golden_section_search( $func, $lmin, $lmax, $tau );
+	warn "Optimize BoxCox lambda: ($lmin, $lmax) for " . @{ $columns } . " column(s)\n" if $VERBOSE;
+
+	# lambda2 is estimated per column unless given
+	my @fits = &_XS_optimize_BoxCox_lambdas( $columns, $lmin, $lmax, $tau, $lambda2 );
+
+	return map { [ @fits[ 2 * $_, 2 * $_ + 1 ] ] } (0 .. $#{ $columns });
 }
 
 sub optimize_BoxCox_shift_parameter {
@@ -325,4 +302,150 @@ sub refify {
 	
 }
 
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Math::Common',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lm -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+use Inline C => <<'END_OF_C_CODE';
+
+#include <math.h>
+
+#include "error.h"
+#include "perl2c.h"
+#include "threads.h"
+#include "functions/boxcox.h"
+
+#include "../lib/threads.c"
+#include "../lib/functions/boxcox.c"
+
+/* copies a Perl array of numbers (or scalar references) into a C array */
+static double* _av_2doubles( AV* av, size_t* n ) {
+    const size_t size = (size_t) av_len( av ) + 1;
+
+    double* x;
+    Newx( x, size ? size : 1, double );
+
+    size_t i;
+    for (i = 0; i < size; i++) {
+        SV** svp = av_fetch( av, i, 0 );
+        SV*  sv  = svp ? *svp : &PL_sv_undef;
+
+        if (SvROK( sv ) && SvTYPE( SvRV( sv ) ) < SVt_PVAV) {
+            sv = SvRV( sv );
+        }
+
+        x[ i ] = (double) SvNV( sv );
+    }
+
+    *n = size;
+
+    return x;
+}
+
+/* n, min, nz_min, max, sum, mean (and variance, average deviation) */
+void _XS_stats( AV* values, IV with_deviations ) {
+    size_t n;
+    double* x = _av_2doubles( values, &n );
+
+    double min    =  INFINITY;
+    double max    = -INFINITY;
+    double nz_min =  INFINITY;
+    double mean   = 0.0;
+    double M2     = 0.0;
+    long double sum = 0;
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const double v = x[ i ];
+        const double d = v - mean;
+
+        mean += d / (double) (i + 1);
+        M2   += d * (v - mean);
+        sum  += v;
+
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+
+        if (v > 0 && v < nz_min) nz_min = v;
+    }
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    Inline_Stack_Push( sv_2mortal( newSVuv( n ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVnv( min ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVnv( nz_min ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVnv( max ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVnv( (double) sum ) ) );
+    Inline_Stack_Push( sv_2mortal( newSVnv( (double) sum / (double) n ) ) );
+
+    if (with_deviations) {
+        double avdev = 0.0;
+        const double m = (double) sum / (double) n;
+
+        for (i = 0; i < n; i++) {
+            avdev += fabs( x[ i ] - m );
+        }
+
+        Inline_Stack_Push( sv_2mortal( newSVnv( n > 1 ? M2 / (double) (n - 1) : 0.0 ) ) );
+        Inline_Stack_Push( sv_2mortal( newSVnv( avdev / (double) n ) ) );
+    }
+
+    Safefree( x );
+
+    Inline_Stack_Done;
+}
+
+void _XS_optimize_BoxCox_lambdas( AV* columns, NV lmin, NV lmax, NV tol, SV* sv_lambda2 ) {
+    const size_t ncols = (size_t) av_len( columns ) + 1;
+
+    /* undef: estimated for every column */
+    const double lambda2 = SvOK( sv_lambda2 ) ? SvNV( sv_lambda2 ) : NAN;
+
+    /* columns are checked before anything is allocated */
+    size_t j;
+    for (j = 0; j < ncols; j++) {
+        SV** svp = av_fetch( columns, j, 0 );
+
+        if (!svp || !SvROK( *svp ) || SvTYPE( SvRV( *svp ) ) != SVt_PVAV) {
+            croak("Columns must be ARRAY references");
+        }
+    }
+
+    double**   data;
+    size_t*    sizes;
+    BoxCoxFit* fits;
+
+    Newx( data, ncols ? ncols : 1, double* );
+    Newx( sizes, ncols ? ncols : 1, size_t );
+    Newx( fits, ncols ? ncols : 1, BoxCoxFit );
+
+    /* all Perl data is copied out before any worker thread starts */
+    for (j = 0; j < ncols; j++) {
+        SV** svp = av_fetch( columns, j, 0 );
+        data[ j ] = _av_2doubles( (AV*) SvRV( *svp ), &sizes[ j ] );
+    }
+
+    c_boxcox_optimize_columns( data, sizes, ncols, lmin, lmax, tol, lambda2, fits );
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    for (j = 0; j < ncols; j++) {
+        Inline_Stack_Push( sv_2mortal( newSVnv( fits[ j ].lambda1 ) ) );
+        Inline_Stack_Push( sv_2mortal( newSVnv( fits[ j ].lambda2 ) ) );
+        Safefree( data[ j ] );
+    }
+
+    Safefree( data );
+    Safefree( sizes );
+    Safefree( fits );
+
+    Inline_Stack_Done;
+}
+
+END_OF_C_CODE
+
 1;
@@ -15,17 +15,11 @@ sub data {
 	my $self   = shift;
 	my $data_r = shift;
 
+	# rows are visited through cursors, no per-row views are kept
 	if (defined $data_r) {
-		my $N = $data_r->rows;
-		my $row_cache = [];
-		my $i = -1;
-		while ( ++$i < $N ) {
-			$row_cache->[ $i ] = $data_r->view_row( $i );
-		}
-
-		$self->{'data'}   = $row_cache;
+		$self->{'data'}   = $data_r;
 		$self->{'data2d'} = $data_r;
-		$self->{'_n'}     = $N;
+		$self->{'_n'}     = $data_r->rows;
 	} else {
 		return $self->{'data'};
 	}
@@ -63,7 +57,8 @@ sub get_distances {
 
 sub _calculate_distances {
 	my $self   = shift;
-	my $data   = $self->{'data'} || trace_error("No DATA loaded");
+	my $data   = $self->{'data'};
+	trace_error("No DATA loaded") unless defined $data;
 	my $dist   = $self->{'distance_func'} or trace_error("No distance function set");
 	my $N      = $self->{'_n'};
 	my $size   = ($N * ($N - 1)) >> 1; 
@@ -72,13 +67,19 @@ sub _calculate_distances {
 	$self->{'distances'} = Anorman::Data::Matrix::Pseudo::HollowSymmetric->new( $N );
 	warn "Calculating $size Distances from $N weights\n";
 
+	my $row_i = $data->row_cursor;
+	my $row_j = $data->row_cursor;
+
 	my ($i,$j);
 
 	$i = -1;
 	while ( ++$i < $N ) {
+		$data->seek_row( $row_i, $i );
+
 		$j = -1;
 		while ( ++$j < $i ) {
-			$self->{'distances'}->set_quick( $i, $j, $dist->( $data->[ $i ], $data->[ $j ] ));
+			$data->seek_row( $row_j, $j );
+			$self->{'distances'}->set_quick( $i, $j, $dist->( $row_i, $row_j ));
 		}
 	}
 }
@@ -94,16 +94,21 @@ sub calculate_densities {
 
 		$self->{'densities'} = Anorman::Data->vector($m);
 
+		my $center = $centers->row_cursor;
+		my $point  = $data->row_cursor;
+
 		warn "Calculating Densities (radius: $r)\n" if $VERBOSE;
 		my ($i,$j);
 
 		$i = -1;
 		while ( ++$i < $m ) {
 			my $sum = -1;
+			$centers->seek_row( $center, $i );
 
 			$j = -1;
 			while ( ++$j < $self->{'_n'} ) {
-				$sum++ if $df->( $centers->view_row($i), $data->[$j], $r) <= $r;
+				$data->seek_row( $point, $j );
+				$sum++ if $df->( $center, $point, $r) <= $r;
 			}
 
 			$self->{'densities'}->set( $i, $sum );
@@ -0,0 +1,129 @@
+package Anorman::Math::Random;
+
+use strict;
+use warnings;
+
+# Reproducible native random numbers (src/anorman/lib/rng.c).
+#
+# All draws derive from one process wide seed and a stream number, so
+# a training run is repeated exactly by passing the recorded seed back:
+#
+#	seed( 1234 );
+#	fill_gaussian( $W->view_column( $j ), $mean, $sd, grid_stream( $j ) );
+#	$permutation->shuffle( seed(), epoch_stream( $epoch ) );
+#
+# Without an explicit seed one is taken from the clock and the pid the
+# first time it is needed. Fills run in parallel and give the same
+# numbers for any $AN_THREADS
+
+use Anorman::Common;
+use Anorman::Data::LinAlg::Property qw(is_packed is_vector);
+use Exporter;
+
+our (@ISA, @EXPORT_OK, %EXPORT_TAGS);
+
+@ISA = qw(Exporter);
+
+@EXPORT_OK = qw(
+	seed
+	fill_uniform
+	fill_gaussian
+	grid_stream
+	epoch_stream
+);
+
+%EXPORT_TAGS = ( all => [ @EXPORT_OK ] );
+
+my $SEED;
+
+# streams of different purposes never overlap
+use constant {
+	GRID_STREAM  => 1 << 32,
+	EPOCH_STREAM => 2 << 32
+};
+
+sub seed {
+	if (@_) {
+		trace_error("Seed must be a non-negative integer") unless $_[0] =~ m/^\d+$/;
+		$SEED = $_[0];
+	}
+
+	$SEED = (time() ^ ($$ << 15)) & 0xFFFFFFFF unless defined $SEED;
+
+	return $SEED;
+}
+
+sub grid_stream  { GRID_STREAM  + $_[0] }
+sub epoch_stream { EPOCH_STREAM + $_[0] }
+
+# uniform on [ $lo, $hi )
+sub fill_uniform {
+	my ($v, $lo, $hi, $stream) = @_;
+
+	_fill( \&_XS_fill_uniform, $v, $lo, $hi, $stream );
+}
+
+sub fill_gaussian {
+	my ($v, $mean, $sd, $stream) = @_;
+
+	_fill( \&_XS_fill_gaussian, $v, $mean, $sd, $stream );
+}
+
+sub _fill {
+	my ($func, $v, $a, $b, $stream) = @_;
+
+	trace_error("Can only fill vectors") unless is_vector( $v );
+
+	$stream = 0 unless defined $stream;
+
+	if (is_packed( $v )) {
+		$func->( $v, $a, $b, seed(), $stream );
+		return $v;
+	}
+
+	# draw into a packed buffer so plain vectors get the same numbers
+	require Anorman::Data::Vector::DensePacked;
+	my $tmp = Anorman::Data::Vector::DensePacked->new( $v->size );
+
+	$func->( $tmp, $a, $b, seed(), $stream );
+
+	return $v->assign( $tmp );
+}
+
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Math::Random',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lm -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "data.h"
+#include "perl2c.h"
+#include "error.h"
+#include "threads.h"
+#include "rng.h"
+
+#include "../lib/threads.c"
+#include "../lib/rng.c"
+
+void _XS_fill_uniform( SV* sv_v, double lo, double hi, UV seed, UV stream ) {
+    SV_2STRUCT( sv_v, Vector, v );
+
+    if (c_rng_fill_uniform( v, lo, hi, (uint64_t) seed, (uint64_t) stream ) != C_SUCCESS) {
+        croak("Could not fill vector with uniform deviates");
+    }
+}
+
+void _XS_fill_gaussian( SV* sv_v, double mean, double sd, UV seed, UV stream ) {
+    SV_2STRUCT( sv_v, Vector, v );
+
+    if (c_rng_fill_gaussian( v, mean, sd, (uint64_t) seed, (uint64_t) stream ) != C_SUCCESS) {
+        croak("Could not fill vector with gaussian deviates");
+    }
+}
+
+END_OF_C_CODE
+
+1;
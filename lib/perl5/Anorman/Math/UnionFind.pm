@@ -1,118 +1,318 @@
 package Anorman::Math::UnionFind;
 
+# Disjoint sets over dense integer ids (src/anorman/lib/unionfind.c),
+# with path halving and union by size. Elements may be given by name,
+# in which case they are interned to ids on first sight:
+#
+#	my $uf = Anorman::Math::UnionFind->new;
+#	$uf->union( 'contig_1', 'contig_7' );
+#	print $uf->find( 'contig_7' ), "\n";	# contig_1
+#
+# or by id, where a million edges are best united in one go, optionally
+# on all threads:
+#
+#	my $uf = Anorman::Math::UnionFind->new( $n );
+#	$uf->union_edges( \@src, \@dst, 1 );
+#	my @labels = $uf->roots;
+
 use strict;
+use warnings;
 
-use constant { 
-	PARENT => 0,
-	RANK   => 1
-};
+use Anorman::Common qw(trace_error);
 
+# $n integer ids to start with, 0 .. n-1
 sub new {
-	my $class = shift;
-	return bless ( {} , ref ($class) || $class );
+	my $that  = shift;
+	my $class = ref $that || $that;
+
+	return _XS_new( $class, shift || 0 );
 }
 
-# add a new element to the Union-Find data structure
+# add an element by name. Returns its id
 sub add {
-	my $self    = shift;
-	my $element = shift;
-
-	$self->{ $element } = [ $element, 0 ] unless defined $self->{ $element };
+	my $self = shift;
+	return $self->_XS_intern( $_[0], 1 );
 }
 
-# check if element has already been added to Union-Find
 sub has {
-	my $self    = shift;
-	my $element = shift;
-
-	return exists $self->{ $element };
+	my $self = shift;
+	return $self->_XS_intern( $_[0], 0 ) >= 0;
 }
 
-# returns the parent of the element, if any 
-sub _parent {
-	my $self    = shift;
-	my ($element, $parent) = @_;
-
-	return undef unless defined $element;
+# id of a named element, undef if unknown
+sub id {
+	my $self = shift;
+	my $id   = $self->_XS_intern( $_[0], 0 );
 
-	if (defined $parent) {
-		$self->{ $element }->[ PARENT ] = $parent;
-	} else {
-		return $self->has( $element ) ? $self->{ $element }->[ PARENT ] : undef;
-	}
+	return $id < 0 ? undef : $id;
 }
 
-sub _rank {
+# root of the set holding a named element, by name
+sub find {
 	my $self = shift;
-	my ($element, $rank) = @_;
+	my $id   = $self->id( $_[0] );
+
+	return undef unless defined $id;
+	return $self->element( $self->find_id( $id ) );
+}
 
-	return undef unless defined $element;
+sub union {
+	my $self = shift;
+	my ($x, $y) = @_;
 
-	if (defined $rank) {
-		$self->{ $element }->[ RANK ] = $rank;
-	} else {
-		return $self->has( $element ) ? $self->{ $element }->[ RANK ] : undef;
-	}
+	return $self->union_ids( $self->add( $x ), $self->add( $y ) );
 }
 
-# Find root element of a stack
-sub find {
+# determine whether two elements are part of the same set
+sub same {
 	my $self = shift;
-	my $x    = shift;
+	my ($u, $v) = map { $self->id( $_ ) } @_;
 
-	my $parent = $self->_parent( $x );
+	return undef unless defined $u && defined $v;
+	return $self->find_id( $u ) == $self->find_id( $v );
+}
 
-	return unless defined $parent;
+# number of elements in the set of a named element
+sub set_size {
+	my $self = shift;
+	my $id   = $self->id( $_[0] );
 
-	$self->_parent( $x, $self->find( $parent ) ) if $parent ne $x;
-	return $self->_parent( $x );
+	return defined $id ? $self->set_size_id( $id ) : undef;
 }
 
-# merge two sets;
-sub union {
+# unite $src->[i] with $dst->[i] for all i. The id lists may be array refs,
+# Anorman::Data::List::PackedInt lists or strings packed with 'L*'. When
+# $parallel is true the edges are united on all threads with lock-free
+# linking. Returns the number of merges
+sub union_edges {
 	my $self = shift;
-	my ($x, $y) = @_;
+	my ($src, $dst, $parallel) = @_;
 
-	# check if elements are aready in set
-	$self->add( $x ) unless $self->has( $x );
-	$self->add( $y ) unless $self->has( $y );
-
-	# locate roots of both elements
-	my $root_x = $self->find( $x );
-	my $root_y = $self->find( $y );
-
-	# quit if already in same component
-	return if $root_x eq $root_y;
-
-	# determine the rank of both elements
-	my $rank_x = $self->_rank( $root_x );
-	my $rank_y = $self->_rank( $root_y );
-
-	# merge x and y if they are not in the same set
-	if ( $rank_x > $rank_y ) {
-		$self->_parent( $root_y, $root_x );
-	} elsif ( $rank_y < $rank_x )  {
-		$self->_parent( $root_x, $root_y );
-	} else {
-		$self->_parent( $root_y, $root_x );
-		$self->_rank( $root_y, $rank_x + 1 );	
+	return $self->_XS_union_edges( _packed_ids( $src ), _packed_ids( $dst ), $parallel ? 1 : 0 );
+}
+
+sub _packed_ids {
+	my $ids = shift;
+
+	return pack( 'L*', @{ $ids } ) if ref $ids eq 'ARRAY';
+	return $ids unless ref $ids;
+
+	if ($ids->isa('Anorman::Data::List::PackedInt')) {
+		return $ids->type eq 'uint32' ? $ids->to_packed : pack( 'L*', $ids->to_array );
 	}
+
+	trace_error("Ids must be given as an array, a PackedInt list or a packed string");
 }
 
-# determine whether two elements are part of the same set
-sub same {
-	my $self    = shift;
-	my ($u, $v) = @_; 
+use Inline (C => Config =>
+		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
+		NAME      => 'Anorman::Math::UnionFind',
+		LIBS      => '-L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lpthread',
+		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include'
+	   );
+
+use Inline C => <<'END_OF_C_CODE';
+
+#include "perl2c.h"
+#include "error.h"
+#include "threads.h"
+#include "intern.h"
+#include "unionfind.h"
+
+#include "../lib/threads.c"
+#include "../lib/intern.c"
+#include "../lib/unionfind.c"
+
+/* named elements share the id space with plain ids */
+struct uf_names_struct
+{
+    UnionFind* uf;
+    StrIntern* names;
+};
 
-	my $root_u = $self->find( $u );
+typedef struct uf_names_struct UFNames;
 
-	return undef unless defined $root_u;
+SV* _XS_new( SV* sv_class_name, UV size ) {
+    UFNames* u;
+    SV* self;
 
-	my $root_v = $self->find( $v );
+    Newxz( u, 1, UFNames );
 
-	return undef unless defined $root_v;
+    u->uf    = c_uf_alloc( (size_t) size );
+    u->names = c_intern_alloc( (size_t) size );
 
-	return ($root_u eq $root_u); 	
+    if (u->uf == NULL || u->names == NULL) {
+        c_uf_free( u->uf );
+        c_intern_free( u->names );
+        Safefree( u );
+        croak("Failed to allocate union-find");
+    }
+
+    const char* class_name = SvPV_nolen( sv_class_name );
+    BLESS_STRUCT( u, self, class_name );
+
+    return self;
 }
 
+/* names are numbered after the plain ids */
+IV _XS_intern( SV* self, SV* sv_name, IV add ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    STRLEN len;
+    const char* name = SvPV( sv_name, len );
+
+    int64_t id = c_intern_lookup( u->names, name, len );
+
+    if (id >= 0 || !add) {
+        return (IV) id;
+    }
+
+    if (u->uf->size > c_intern_size( u->names )) {
+        /* pad the table so that names and ids line up */
+        char buf[ 32 ];
+
+        while (c_intern_size( u->names ) < u->uf->size) {
+            const int n = snprintf( buf, sizeof(buf), "\001%lu", (unsigned long) c_intern_size( u->names ) );
+            c_intern_add( u->names, buf, (size_t) n );
+        }
+    }
+
+    id = c_intern_add( u->names, name, len );
+
+    if (id < 0 || c_uf_resize( u->uf, (size_t) id + 1 ) != C_SUCCESS) {
+        croak("Failed to add element to union-find");
+    }
+
+    return (IV) id;
+}
+
+/* name of an id, undef for plain ids */
+SV* element( SV* self, UV id ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    size_t len;
+    const char* name = c_intern_name( u->names, (size_t) id, &len );
+
+    if (name == NULL || (len && name[ 0 ] == '\001')) {
+        return &PL_sv_undef;
+    }
+
+    return newSVpvn( name, len );
+}
+
+/* number of ids */
+UV size( SV* self ) {
+    SV_2STRUCT( self, UFNames, u );
+    return (UV) u->uf->size;
+}
+
+/* number of disjoint sets */
+UV count( SV* self ) {
+    SV_2STRUCT( self, UFNames, u );
+    return (UV) u->uf->n_sets;
+}
+
+void resize( SV* self, UV size ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    if (c_uf_resize( u->uf, (size_t) size ) != C_SUCCESS) {
+        croak("Failed to grow union-find");
+    }
+}
+
+UV find_id( SV* self, UV x ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    if (x >= u->uf->size) {
+        croak("Id %lu out of range", (unsigned long) x);
+    }
+
+    return (UV) c_uf_find( u->uf, (uint32_t) x );
+}
+
+/* ids beyond the current size are added */
+IV union_ids( SV* self, UV a, UV b ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    const UV n = (a > b ? a : b) + 1;
+
+    if (n > u->uf->size && c_uf_resize( u->uf, (size_t) n ) != C_SUCCESS) {
+        croak("Failed to grow union-find");
+    }
+
+    return (IV) c_uf_union( u->uf, (uint32_t) a, (uint32_t) b );
+}
+
+UV set_size_id( SV* self, UV x ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    if (x >= u->uf->size) {
+        croak("Id %lu out of range", (unsigned long) x);
+    }
+
+    return (UV) c_uf_set_size( u->uf, (uint32_t) x );
+}
+
+UV _XS_union_edges( SV* self, SV* sv_src, SV* sv_dst, IV parallel ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    STRLEN l1, l2;
+    const uint32_t* src = (const uint32_t*) SvPV( sv_src, l1 );
+    const uint32_t* dst = (const uint32_t*) SvPV( sv_dst, l2 );
+
+    if (l1 != l2 || l1 % sizeof(uint32_t)) {
+        croak("Edge id lists differ in length");
+    }
+
+    const size_t n = l1 / sizeof(uint32_t);
+    uint32_t max = 0;
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        max = src[ i ] > max ? src[ i ] : max;
+        max = dst[ i ] > max ? dst[ i ] : max;
+    }
+
+    if (n && c_uf_resize( u->uf, (size_t) max + 1 ) != C_SUCCESS) {
+        croak("Failed to grow union-find");
+    }
+
+    if (!parallel) {
+        return (UV) c_uf_union_edges( u->uf, src, dst, n );
+    }
+
+    const size_t before = u->uf->n_sets;
+
+    if (c_uf_union_edges_atomic( u->uf, src, dst, NULL, n ) != C_SUCCESS) {
+        croak("Failed to unite edges");
+    }
+
+    return (UV) (before - u->uf->n_sets);
+}
+
+/* root id of every id */
+void roots( SV* self ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    Inline_Stack_Vars;
+    Inline_Stack_Reset;
+
+    size_t i;
+    for (i = 0; i < u->uf->size; i++) {
+        Inline_Stack_Push( sv_2mortal( newSVuv( (UV) c_uf_find( u->uf, (uint32_t) i ) ) ) );
+    }
+
+    Inline_Stack_Done;
+}
+
+void DESTROY( SV* self ) {
+    SV_2STRUCT( self, UFNames, u );
+
+    c_uf_free( u->uf );
+    c_intern_free( u->names );
+    Safefree( u );
+}
+
+END_OF_C_CODE
+
 1;
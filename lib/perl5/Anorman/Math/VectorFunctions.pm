@@ -441,10 +441,86 @@ sub _PP_cosine_distance {
 
 sub MAHALANOBIS {
 	my $A = $_[1];
+
+	# packed Cholesky factors go through the native kernel
+	if ($Anorman::Data::Config::PACK_DATA == 1 && $A->isa('Anorman::Data::LinAlg::CholeskyDecomposition')) {
+		my $LLT = $A->LLT;
+		return sub { &_XS_mahalanobis_distance_chol( $_[0], $_[1], $LLT ) };
+	}
+
 	return sub { my $diff = $_[0] - $_[1]; return sqrt( $A->solve( $diff )->dot_product( $diff ) ) }
 }
 
 
+#==============================================
+# Row distance functions: y = D( A[i], B[j] )
+#==============================================
+
+# exponents of the named LP distances
+my %LP_EXPONENT = (
+	LQUARTER => 0.25,
+	LTHIRD   => 1/3,
+	LHALF    => 0.5,
+	LP1      => 1,
+	LP2      => 2,
+	LP3      => 3,
+	LP4      => 4
+);
+
+sub row_distance {
+	# returns D( A, i, B, j ) for the named distance. Packed matrices are
+	# measured natively, without creating row views
+	my ($self, $name) = @_;
+	my ($id, $p) = &_distance_id( $name );
+
+	if ($Anorman::Data::Config::PACK_DATA == 1) {
+		return sub { &_XS_row_distance( $_[0], $_[1], $_[2], $_[3], $id, $p ) };
+	}
+
+	my $f = $FUNCTIONS{ $name }->();
+
+	return sub { $f->( $_[0]->view_row( $_[1] ), $_[2]->view_row( $_[3] ) ) };
+}
+
+sub row_distances {
+	# returns D( A, i, B, out ), which stores the distances between row i
+	# of A and every row of B in out
+	my ($self, $name) = @_;
+	my ($id, $p) = &_distance_id( $name );
+
+	if ($Anorman::Data::Config::PACK_DATA == 1) {
+		return sub { &_XS_row_distances( $_[0], $_[1], $_[2], $_[3], $id, $p ); $_[3] };
+	}
+
+	my $f = $FUNCTIONS{ $name }->();
+
+	return sub {
+		my ($A, $i, $B, $out) = @_;
+
+		my $a = $A->view_row( $i );
+		my $b = $B->row_cursor;
+
+		my $j = -1;
+		while ( ++$j < $B->rows ) {
+			$B->seek_row( $b, $j );
+			$out->set_quick( $j, $f->( $a, $b ) );
+		}
+
+		return $out;
+	}
+}
+
+sub _distance_id {
+	# position in @DISTANCE_FUNCTIONS (the switch in _row_distance) and P
+	my $name = shift;
+
+	my ($id) = grep { $DISTANCE_FUNCTIONS[ $_ ] eq $name } (0 .. $#DISTANCE_FUNCTIONS);
+
+	trace_error("Unknown distance function $name") unless defined $id;
+
+	return ($id, exists $LP_EXPONENT{ $name } ? $LP_EXPONENT{ $name } : 0);
+}
+
 #=========================================
 # Wrappers for vector aggreation functions
 #=========================================
@@ -526,7 +602,7 @@ use Inline (C => Config =>
 		DIRECTORY => $Anorman::Common::AN_TMP_DIR,
 		NAME      => 'Anorman::Math::VectorFunctions',
 		ENABLE    => AUTOWRAP =>
-		LIBS      => '-L/usr/local/opt/openblas/lib -L' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lopenblas',
+		LIBS      => '-L/usr/local/opt/openblas/lib -L' . $Anorman::Common::AN_SRC_DIR . '/lib -Wl,-rpath,' . $Anorman::Common::AN_SRC_DIR . '/lib -landata -lopenblas -lpthread',
 		INC       => '-I' . $Anorman::Common::AN_SRC_DIR . '/include -I/usr/local/opt/openblas/include'
 	   );
 use Inline C => <<'END_OF_C_CODE';
@@ -535,18 +611,24 @@ use Inline C => <<'END_OF_C_CODE';
 #include "cblas.h"
 #include "error.h"
 #include "vector.h"
+#include "matrix.h"
 #include "perl2c.h"
 #include "functions/functions.h"
 #include "functions/vector.h"
 #include "functions/vectorvector.h"
+#include "functions/kernels.h"
+#include "linalg/mahalanobis.h"
 
 /*
 #include "../lib/vector.c"
 */
 
+#include "../lib/functions/kernels.c"
 #include "../lib/functions/vector.c"
 #include "../lib/functions/vectorvector.c"
 #include "../lib/functions/functions.c"
+#include "../lib/threads.c"
+#include "../lib/linalg/mahalanobis.c"
 
 
 /* Unary functions */
@@ -583,7 +665,7 @@ NV _XS_sum ( SV* self ) {
 
 NV _XS_stdev ( SV* self ) {
     SV_2STRUCT( self, Vector, v );
-    return (NV) sqrt( c_v_variance2( v->size, v ) );
+    return (NV) sqrt( c_v_variance( v->size, v ) );
 }
 
 
@@ -623,14 +705,14 @@ NV _XS_manhattan_distance( SV* self, SV* other ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) c_vv_aggregate_quick( u->size, u, v, &c_plus, &c_abs_diff );
+    return (NV) c_vv_dist_manhattan( u->size, u, v );
 }
 
 NV _XS_manhattan_distance_upto( SV* self, SV* other, NV th ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) c_vv_aggregate_quick_upto( u->size, u, v, &c_plus, &c_abs_diff, th );
+    return (NV) c_vv_dist_manhattan_upto( u->size, u, v, th );
 }
 
 
@@ -640,28 +722,28 @@ NV _XS_euclidean_distance( SV* self, SV* other ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) sqrt( c_vv_aggregate_quick( u->size, u, v, &c_plus, &c_square_diff ) );
+    return (NV) c_vv_dist_euclidean( u->size, u, v );
 }
 
 NV _XS_euclidean_distance_upto( SV* self, SV* other, NV th ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) sqrt( c_vv_aggregate_quick_upto( u->size, u, v, &c_plus, &c_square_diff, th * th ) );
+    return (NV) c_vv_dist_euclidean_upto( u->size, u, v, th );
 }
 
 NV _XS_squared_euclidean_distance( SV* self, SV* other ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) c_vv_aggregate_quick( u->size, u, v, &c_plus, &c_square_diff );
+    return (NV) c_vv_squared_dist_euclidean( u->size, u, v );
 }
 
 NV _XS_squared_euclidean_distance_upto( SV* self, SV* other, NV th ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) c_vv_aggregate_quick_upto( u->size, u, v, &c_plus, &c_square_diff, th );
+    return (NV) c_vv_dist_squared_euclidean_upto( u->size, u, v, th );
 }
 
 
@@ -671,14 +753,14 @@ NV _XS_maximum_distance( SV* self, SV* other ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) c_vv_aggregate_quick( u->size, u, v, &c_max, &c_abs_diff );    
+    return (NV) c_vv_dist_maximum( u->size, u, v );
 }
 
 NV _XS_maximum_distance_upto( SV* self, SV* other, NV th ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) c_vv_aggregate_quick_upto( u->size, u, v, &c_max, &c_abs_diff, th );    
+    return (NV) c_vv_dist_maximum_upto( u->size, u, v, th );
 }
 
 
@@ -688,8 +770,7 @@ NV _XS_bray_curtis_distance( SV* self, SV* other ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) c_vv_aggregate_quick( u->size, u, v, &c_plus, &c_abs_diff ) /
-                c_vv_aggregate_quick( u->size, u, v, &c_plus, &c_plus );    
+    return (NV) c_vv_dist_bray_curtis( u->size, u, v );
 }
 
 
@@ -699,7 +780,7 @@ NV _XS_correlation_distance( SV* self, SV* other ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) ( 1 - c_vv_correlation( u->size, u, v ) );    
+    return (NV) c_vv_dist_correlation( u->size, u, v );
 }
 
 
@@ -709,7 +790,7 @@ NV _XS_canberra_distance( SV* self, SV* other ) {
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    return (NV) c_vv_aggregate_quick( u->size, u, v, &c_plus, &c_canberra_diff );
+    return (NV) c_vv_dist_canberra( u->size, u, v );
 }
 
 /* Cosine */
@@ -722,13 +803,7 @@ NV _XS_cosine_distance( SV* self, SV* other ) {
         C_ERROR("Vectors must have same length", C_EINVAL);
     }
 
-    size_t size = u->size;
-    
-    double ab = c_vv_dot_product( u, v, 0, size );	
-    double aa = c_vv_dot_product( u, u, 0, size );	
-    double bb = c_vv_dot_product( v, v, 0, size );
-
-    return (NV) 1 - ab / sqrt(aa) / sqrt(bb);	
+    return (NV) c_vv_dist_cosine( u->size, u, v );
 }
 
 /* LP (Minkowskyi) distances */
@@ -737,95 +812,97 @@ NV _XS_LP_distance( SV* self, SV* other, NV p_value ) {
     SV_2STRUCT(  self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    const size_t size = u->size;
-    const double p    = (const double) p_value;
-
-    double result = c_p_diff( c_v_get_quick( u, 0 ), c_v_get_quick( v, 0 ), p );
-    
-    size_t i;
-    for (i = 1; i < size; i++ ) {
-        result += c_p_diff( c_v_get_quick( u, i ), c_v_get_quick( v, i ), p );
-    }
-
-    return (NV) pow( result, 1 / p );
+    return (NV) c_vv_dist_lp( u->size, u, v, (double) p_value );
 }
 
 NV _XS_LP_distance_upto( SV* self, SV* other, NV p_value, NV nv_th ) {
     SV_2STRUCT(  self, Vector, u );
     SV_2STRUCT( other, Vector, v );
 
-    const size_t size = u->size;
-    const double p    = (const double) p_value;
-    const double th   = pow( nv_th, p );
-    
-    double result = c_p_diff( c_v_get_quick( u, 0 ), c_v_get_quick( v, 0 ), p );
-    
-    size_t i;
-    for (i = 1; i < size; i++ ) {
-        if (result > th)
-        break;
-
-        result += c_p_diff( c_v_get_quick( u, i ), c_v_get_quick( v, i ), p );
-    }
-
-    return (NV) pow( result, 1 / p );    
+    return (NV) c_vv_dist_lp_upto( u->size, u, v, (double) p_value, (double) nv_th );
 }
 
-SV* _XS_mahalanobis_distance_chol( SV* self, SV* other, SV* sv_LLT ) {
+NV _XS_mahalanobis_distance_chol( SV* self, SV* other, SV* sv_LLT ) {
     /* Mahalanobis distance based on a Cholesky decomposition
        Requires the input matrix to be symmetric positive-definite */
     SV_2STRUCT( self, Vector, u );
     SV_2STRUCT( other, Vector, v );
     SV_2STRUCT( sv_LLT, Matrix, LLT );
 
-    SV* mahal_dist = newSVnv(0);
-
-    const size_t size = u->size;
-
-    Vector* diff;
-
-    /* Allocate temporary space for difference vector */
-    Newxz( diff, 1, Vector );
+    return (NV) c_mahalanobis_chol( u, v, LLT );
+}
+
+/*****************************
+ ** Row distance functions  **
+ *****************************/
+
+/* id follows @DISTANCE_FUNCTIONS, p is the exponent of the LP distances */
+static double _row_distance( IV id, Vector* u, Vector* v, double p ) {
+    switch (id) {
+        case 0:  return c_vv_dist_manhattan( u->size, u, v );
+        case 1:  return c_vv_dist_euclidean( u->size, u, v );
+        case 2:  return c_vv_squared_dist_euclidean( u->size, u, v );
+        case 3:
+        case 4:
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+        case 9:  return c_vv_dist_lp( u->size, u, v, p );
+        case 10: return c_vv_dist_maximum( u->size, u, v );
+        case 11: return c_vv_dist_canberra( u->size, u, v );
+        case 12: return c_vv_dist_bray_curtis( u->size, u, v );
+        case 13: return c_vv_dist_correlation( u->size, u, v );
+        case 14: return c_vv_dist_cosine( u->size, u, v );
+    }
 
-    diff->size      = size;
-    diff->stride    = 1;
+    C_ERROR_VAL("Unknown distance function", C_EINVAL, 0);
+}
 
-    diff->elements  = c_v_alloc( diff, size );
+NV _XS_row_distance( SV* sv_A, UV i, SV* sv_B, UV j, IV id, NV p ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+    SV_2STRUCT( sv_B, Matrix, B );
 
-    /* copy elements */
-    c_vv_copy( diff, u );
+    if (i >= A->rows || j >= B->rows) {
+        C_ERROR_VAL("Row index out of bounds", C_EINVAL, 0);
+    }
 
-   /* subtract second vector */
-    c_vv_sub( diff, v );
+    if (A->columns != B->columns) {
+        C_ERROR_VAL("Rows must have equal length", C_EBADLEN, 0);
+    }
 
+    Vector u, v;
+    VectorOffsets u_offs, v_offs;
 
-    double* LLT_data =  LLT->elements + (LLT->row_zero + LLT->column_zero);
-    double* diff_data = diff->elements + diff->zero;
+    c_m_row_view( A, (size_t) i, &u, &u_offs );
+    c_m_row_view( B, (size_t) j, &v, &v_offs );
 
-    double result;
-    double* tmp;
+    return (NV) _row_distance( id, &u, &v, (double) p );
+}
 
-    /* store temporary vector for dot product calculation */
-    Newx( tmp, size, double );
-    Copy( diff->elements, tmp, size, double );
+void _XS_row_distances( SV* sv_A, UV i, SV* sv_B, SV* sv_out, IV id, NV p ) {
+    SV_2STRUCT( sv_A, Matrix, A );
+    SV_2STRUCT( sv_B, Matrix, B );
+    SV_2STRUCT( sv_out, Vector, out );
 
-    /* Solve (equivalent to multiplying with the inverse covariance matrix) */
-    cblas_dtrsv(CblasRowMajor, CblasLower, CblasNoTrans, CblasNonUnit, (int) size, LLT_data, LLT->row_stride,
-                diff_data, (int) diff->stride);
+    if (i >= A->rows) {
+        C_ERROR_VOID("Row index out of bounds", C_EINVAL);
+    }
 
-    cblas_dtrsv(CblasRowMajor, CblasUpper, CblasNoTrans, CblasNonUnit, (int) size, LLT_data, LLT->row_stride,
-                diff_data, (int) diff->stride);
+    if (A->columns != B->columns || out->size != B->rows) {
+        C_ERROR_VOID("Incompatible dimensions", C_EBADLEN);
+    }
 
-    result = cblas_ddot( (int) size, diff_data, 1, tmp, 1 );
-   
-    sv_setnv( mahal_dist, sqrt( result ) );
+    Vector u, v;
+    VectorOffsets u_offs, v_offs;
 
-    /* Free all temporary elements */
-    Safefree( diff->elements );
-    Safefree( diff );
-    Safefree( tmp );
+    c_m_row_view( A, (size_t) i, &u, &u_offs );
 
-    return mahal_dist;    
+    size_t j;
+    for (j = 0; j < B->rows; j++) {
+        c_m_row_view( B, j, &v, &v_offs );
+        c_v_set_quick( out, j, _row_distance( id, &u, &v, (double) p ) );
+    }
 }
 
 END_OF_C_CODE
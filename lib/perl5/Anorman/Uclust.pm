@@ -2,9 +2,10 @@ package Anorman::Uclust;
 
 use strict;
 use warnings;
-use Common::Math;
 
-our $VERSION = 0.3;
+use Anorman::ClusterMap;
+
+our $VERSION = 0.4;
 
 
 =head1
@@ -36,124 +37,58 @@ NOTE: For some reason PctID is in field 8 for D type clusters
 
 QueryStart and SeedStart are zero-based relative to start of sequence.
 If minus strand, SeedStart is relative to reverse-complemented seed.
+
+The clusters come back as an Anorman::ClusterMap, addressed by cluster
+id. The functions below take the map and cluster ids; the hashes of
+earlier versions are had per cluster with $map->cluster( $id ).
 =cut
 
 sub GetUcClusters {
+	my ($FileName) = @_;
 
-	my ($FileName) 		= @_;
-	my %CLUSTER_INDEX	= ( 'LIST' => [], 'SEQUENCES' => {}, 'CLUSTERS'  => {} );
-	
-	open ( my $CLUSTER_FH, '<', $FileName ) or die "Could not open file $FileName, $!\n";
-
-	my $Counter = 0;
-
-	while ( defined( my $line = <$CLUSTER_FH> ) ) {
-
-		next unless $line =~ m/^[LSHRDCN]\s+/;
-		chomp $line;
-
-		my @fields = split( "\t", $line );
-
-		die "$FileName is Not a correctly formatted cluster file" if 9 > @fields;
-
-		# Fetch variables for each field
-		my (
-			$Type,   $ClstrNr, $Size,      $PctId, $Strand,
-			$QStart, $SStart,  $Alignment, $Label, $Target
-		) = @fields;
-
-		unless ( exists $CLUSTER_INDEX{ 'CLUSTERS' }{ $ClstrNr } ) {
-			$CLUSTER_INDEX{ 'CLUSTERS' }{ $ClstrNr } =
-			{    # Initialize standard keys for any new clusters
-				'CLST_NUM' => 0,	'CLST_SEED' => '',	
-				'CLST_HITS' => {},	'CLST_SIZE' => 0,
-				'CLST_PCTID_AVG' => '*','CLST_LIBFLAG' => 0,
-				'CLST_SEEDLEN' => 0
-			}	
-		}
-		
-		my $ClusterRef 		    = $CLUSTER_INDEX{ 'CLUSTERS' }{ $ClstrNr };
-		my $ListRef		    = $CLUSTER_INDEX{ 'LIST' };
-
-		$ClusterRef->{ 'CLST_NUM' } = $ClstrNr;
+	my $ClusterMap = Anorman::ClusterMap->new;
+	$ClusterMap->load_uc( $FileName );
 
-		if ( $Type eq 'S' ) {
-			$ClusterRef->{ 'CLST_SEED' }    = $Label;
-			$ClusterRef->{ 'CLST_SEEDLEN' } = $Size;
-			$ClusterRef->{ 'CLST_SIZE' }++;
-			push @{$ListRef}, $ClstrNr;
-
-			$CLUSTER_INDEX{'SEQUENCES'}{$Label} = $ClstrNr;
-		}
-		elsif ( $Type eq 'L' ) {
-			$ClusterRef->{ 'CLST_SEED' }    = $Label;
-			$ClusterRef->{ 'CLST_SEEDLEN' } = $Size;
-			$ClusterRef->{ 'CLST_LIBFLAG' } = 1;
-			push @{$ListRef}, $ClstrNr;
-		}
-		elsif ( $Type eq 'C' ) {
-			$ClusterRef->{ 'CLST_PCTID_AVG' } = $PctId;
-		}
-		elsif ( $Type eq 'D' ) {
-			$ClusterRef->{ 'CLST_PCTID_AVG' } = $Alignment;
-		}
-		else {
-			# Types H, N and R 
-			$ClusterRef->{ 'CLST_HITS' }->{ $Label } = $PctId;
-			$ClusterRef->{ 'CLST_SIZE' }++;
-
-			$CLUSTER_INDEX{ 'SEQUENCES' }{ $Label }  = $ClstrNr;
-		}
-
-		print STDERR '.' unless ($Counter % 10000);
-		$Counter++;
-	}
-	close $CLUSTER_FH;
-
-	return \%CLUSTER_INDEX;
+	return $ClusterMap;
 }
 
 sub ReCalcMeanPctId {
+	# Replace the average identity of a cluster by the mean of its hits
+	my ( $ClusterMap, $ClusterId ) = @_;
 
-	# Will take the mean of each pct. identity
-	my ($ClusterRef) = @_;
-
-	return if $ClusterRef->{ 'CLST_PCTID_AVG' } eq '*';
-	return if $ClusterRef->{ 'CLST_SIZE' } == 0;
+	return unless defined $ClusterMap->pctid_avg( $ClusterId );
+	return if $ClusterMap->size( $ClusterId ) == 0;
 
-	my @PctIds    = values %{ $ClusterRef->{ 'CLST_HITS' } };
-	my $MeanPctId = Math::Common::Mean( @PctIds );
+	my $MeanPctId = $ClusterMap->mean_pctid( $ClusterId );
 
-	$ClusterRef->{ 'CLST_PCTID_AVG' } = $MeanPctId;
+	$ClusterMap->set_pctid_avg( $ClusterId, $MeanPctId ) if defined $MeanPctId;
 }
 
 sub RareFact {
-
-	my ($ClusterRef) = @_;
-	my %CLUSTER_COUNT;
-	my %SAMPLE_COUNT;
-	my $Counter = 1;
-	while (my ($Label, $ClusterNr) = each %{ $ClusterRef->{'SEQUENCES'} }) {
-		next if $ClusterNr eq '*';
-		next if ($ClusterRef->{'CLUSTERS'}->{$ClusterNr}->{'CLST_SIZE'} < 10);
-		my $SampleName = substr ( $Label, 0, index ( $Label, '_' ));
-		$SAMPLE_COUNT{ $SampleName }++;
-		$CLUSTER_COUNT{ $SampleName }{ $ClusterNr } = 1;
-		unless ($Counter % 10000) {
-			print $Counter;
-			foreach my $SampleName(sort { $a cmp $b } keys %CLUSTER_COUNT) {
-				print "\t" . $SAMPLE_COUNT{$SampleName} . "\t", scalar keys %{ $CLUSTER_COUNT{ $SampleName } };
-			}
-			print "\n";
+	# Prints the sequences and distinct clusters per sample for every
+	# 10000 sequences taken in random order. Clusters of fewer than 10
+	# sequences are left out. Samples are named by the label up to the
+	# first '_'; options as for Anorman::ClusterMap::rarefy
+	my ( $ClusterMap, %Options ) = @_;
+
+	my @Samples = $ClusterMap->samples( '_' );
+	my @Order   = sort { $Samples[ $a ] cmp $Samples[ $b ] } 0 .. $#Samples;
+
+	# one pair of columns for every sample seen so far, by name
+	foreach my $Row( $ClusterMap->rarefy( %Options ) ) {
+		print $Row->[0];
+		foreach my $s(@Order) {
+			next unless $Row->[ 1 + 2 * $s ];
+			print "\t" . $Row->[ 1 + 2 * $s ] . "\t", $Row->[ 2 + 2 * $s ];
 		}
-		$Counter++;
+		print "\n";
 	}
-
 }
+
 sub PrintCluster {
-	my ($ClusterRef) = @_;
+	my ( $ClusterMap, $ClusterId ) = @_;
 
-	return if not ref $ClusterRef eq 'HASH';
+	my $ClusterRef = $ClusterMap->cluster( $ClusterId );
 	
 	my @ClusterVals = (	$ClusterRef->{ 'CLST_NUM' },		$ClusterRef->{ 'CLST_SIZE' },
 				$ClusterRef->{ 'CLST_SEEDLEN' },  	$ClusterRef->{ 'CLST_PCTID_AVG' },
@@ -174,99 +109,43 @@ sub PrintCluster {
 }
 	
 sub PruneCluster {
-	my ( $ClusterRef, $PruneKey, $Value ) = @_;
+	# Drops clusters whose CLST_SIZE, CLST_SEEDLEN, CLST_PCTID_AVG or
+	# CLST_NUM is below a value from sorting and counting. Returns the
+	# number of clusters dropped
+	my ( $ClusterMap, $PruneKey, $Value ) = @_;
 
-	return unless $ClusterRef->$PruneKey < $Value;
+	return $ClusterMap->prune( $PruneKey, $Value );
 }
 
 sub SortClusters {
+	# Cluster ids ordered by a key as for PruneCluster. Clusters without
+	# an average identity go last
+	my ( $ClusterMap, $SortKey, $ReverseBit ) = @_;
 
-	my ( $ClusterRef, $SortKey, $ReverseBit ) = @_;
-	my @SortList;
-	
-	if ( $ReverseBit ) {
-		@SortList = sort { 	
-			$ClusterRef->{ 'CLUSTERS' }->{ $b }->{ $SortKey }
-			<=>
-			$ClusterRef->{ 'CLUSTERS' }->{ $a }->{ $SortKey }
-			} keys %{ $ClusterRef->{ 'CLUSTERS' }};
-	}
-	else {
-		@SortList = sort {
-                        $ClusterRef->{ 'CLUSTERS' }->{ $a }->{ $SortKey }
-                        <=>
-                        $ClusterRef->{ 'CLUSTERS' }->{ $b }->{ $SortKey }
-                        } keys %{ $ClusterRef->{ 'CLUSTERS' }};
-	}
-
-	return \@SortList; 
+	return [ $ClusterMap->sort_by( $SortKey, $ReverseBit ) ];
 }
 
 sub CountSamples {
-	# Needs a hash reference to the cluster index and the delimiter
-	# that specifies the break-point for the sample-name
+	# Needs the cluster map and the delimiter that specifies the
+	# break-point for the sample-name
 	# I.e the sample name ABC_FX008N01XGHFS and elimiter '_' 
 	# would indicate that the tag FX008N01XGHFS belongs to sample ABC
 	# By default all samples will be counted but individual sample names can also be specified
 
-	my ( $ClusterRef, $Delimiter, @CountIncludeList ) = @_;
-
-	my (%SAMPLE_NAMES,%SAMPLE_INCLUDE);
-	my $CountListBit = 0;
-
-	if (scalar @CountIncludeList >= 1) {
-		$CountListBit = 1;
-		%SAMPLE_INCLUDE = map { $_ => 1 } @CountIncludeList;
-	}
+	my ( $ClusterMap, $Delimiter, @CountIncludeList ) = @_;
 
 	$Delimiter = '_' unless defined $Delimiter;
-	
-	#### NOTE: Insert some sort of Delimiter sanity check here ###
-	my $Counter = 0;
-	
-	while ( my ( $Label, $ClusterNum ) = each %{ $ClusterRef->{ 'SEQUENCES' }}) {
-
-		# Skip counting seeds in type D clusters
-		if ( $ClusterRef->{ 'CLUSTERS' }->{ $ClusterNum }->{ 'CLST_SEED' } eq $Label ) {
-			next if $ClusterRef->{ 'CLUSTERS' }->{ $ClusterNum }->{ 'CLST_LIBFLAG' };
-		}
 
-		my $SampleName;
-		$SampleName = $1 if $Label =~ m/(.*)_scaffold/;
-		$SampleName = $1 if $Label =~ m/(.*)_contig/;
-		
-		if ($CountListBit) {
-			next unless (exists $SAMPLE_INCLUDE{ $SampleName });
-		}
+	my %SAMPLE_NAMES = map { $_ => 1 } $ClusterMap->samples( $Delimiter );
 
-		$SAMPLE_NAMES{ $SampleName } = 1 unless exists $SAMPLE_NAMES{ $SampleName };
-		$ClusterRef->{'CLUSTERS'}->{ $ClusterNum }->{ 'CLST_SMPLCOUNT' }->{ $SampleName } ++;
-	
-		print STDERR '.' unless ($Counter % 10000);
-		$Counter++;
+	foreach my $SampleName(@CountIncludeList) {
+		warn "WARNING: No samples named $SampleName were found\n" if not exists $SAMPLE_NAMES{ $SampleName };
 	}
-	
-	if (%SAMPLE_NAMES) {
-		foreach my $SampleName(keys %SAMPLE_INCLUDE) {
-			warn "WARNING: No samples named $SampleName were found\n" if not exists $SAMPLE_NAMES{ $SampleName };
-		}
-	} else {
+
+	unless ($ClusterMap->count_samples( @CountIncludeList )) {
 		warn "WARNING: No sample names were found\n";
 		return;
 	}
-	
-	# Add zero sample count if no samples were counted in a cluster
-	foreach my $SampleName( keys %SAMPLE_NAMES ) {
-		foreach my $ClusterNum( keys %{ $ClusterRef->{'CLUSTERS' }}) {
-			my $NumSam = scalar $ClusterRef->{ 'CLUSTERS' }->{ $ClusterNum }->{ 'CLST_SMPLCOUNT' };
-			next if scalar keys %SAMPLE_NAMES == $NumSam;
-			unless ( exists $ClusterRef->{ 'CLUSTERS' }->{ $ClusterNum }->{ 'CLST_SMPLCOUNT' }->{ $SampleName }) {
-				$ClusterRef->{ 'CLUSTERS' }->{ $ClusterNum }->{ 'CLST_SMPLCOUNT' }->{ $SampleName } = 0;
-				print STDERR '.' unless ($Counter % 10000);
-				$Counter++;
-			}
-		}
-	}
 }
 
 1;
@@ -0,0 +1,93 @@
+#ifndef __ANORMAN_CLUSTERMAP_H__
+#define __ANORMAN_CLUSTERMAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
+/* sortable and prunable cluster columns */
+enum {
+    C_CM_NUM     = 0,   /* cluster name, numerically */
+    C_CM_SIZE    = 1,
+    C_CM_SEEDLEN = 2,
+    C_CM_PCTID   = 3
+};
+
+/* Sequence clusters from a USEARCH/UCLUST .uc file or a QIIME OTU map.
+   Labels and cluster names are interned; membership is kept both ways,
+   as member -> cluster and, once built, cluster -> members (CSR) */
+struct cluster_map_struct
+{
+    StrIntern* labels;
+    StrIntern* names;           /* cluster names */
+
+    /* by label id */
+    int64_t*   member_cluster;  /* -1 for unclustered labels and library seeds */
+    float*     member_pctid;    /* identity to the seed, NAN if not given */
+    size_t     member_capacity;
+
+    /* by cluster id */
+    int64_t*   seed;            /* label id, -1 if none */
+    uint32_t*  seed_len;
+    uint32_t*  size;            /* members, as counted from the records */
+    double*    pctid_avg;       /* NAN for '*' */
+    uint8_t*   libflag;
+    uint8_t*   active;          /* cleared by pruning */
+    size_t     cluster_capacity;
+
+    /* clusters in order of their seed records */
+    uint32_t*  order;
+    size_t     n_order;
+
+    /* CSR of the members, valid while built is set */
+    int        built;
+    size_t*    ptr;
+    uint32_t*  members;
+
+    /* optional per label sample, see c_cm_samples */
+    StrIntern* samples;
+    uint32_t*  member_sample;
+    uint32_t*  sample_count;    /* clusters x samples, see c_cm_count_samples */
+    uint8_t*   sample_include;  /* samples counted */
+};
+
+typedef struct cluster_map_struct ClusterMap;
+
+ClusterMap* c_cm_alloc( void );
+void c_cm_free( ClusterMap* );
+
+/* Returns the records read, -1 if the file could not be mapped, or
+   -2 if it is malformed */
+int64_t c_cm_load_uc( ClusterMap*, const char* );
+int64_t c_cm_load_otu_map( ClusterMap*, const char* );
+
+size_t c_cm_clusters( ClusterMap* );
+size_t c_cm_labels( ClusterMap* );
+
+/* cluster -> member CSR */
+int c_cm_build( ClusterMap* );
+
+double c_cm_value( ClusterMap*, size_t, int );
+double c_cm_mean_pctid( ClusterMap*, size_t );
+
+/* active cluster ids ordered by a column. Returns the count */
+size_t c_cm_sort( ClusterMap*, int, int, uint32_t* );
+
+/* deactivate clusters whose column is below a value. Returns the count */
+size_t c_cm_prune( ClusterMap*, int, double );
+
+/* sample of each label: the label up to the first delimiter */
+int c_cm_samples( ClusterMap*, const char*, size_t );
+
+/* members per cluster and sample into sample_count. Library seeds are
+   not counted. include (by sample) may be NULL for all samples */
+int c_cm_count_samples( ClusterMap*, const uint8_t* );
+
+/* rarefaction: labels of clusters with at least min_size members are
+   taken in the given order. After every step labels a row goes to out:
+   the labels taken, then per sample the labels and the distinct
+   clusters seen so far (1 + 2 x samples columns). Returns the rows
+   written, or -1 */
+int64_t c_cm_rarefy( ClusterMap*, uint32_t, const uint32_t*, size_t, size_t, uint64_t* );
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __ANORMAN_CONTIGUOUS_H__
+#define __ANORMAN_CONTIGUOUS_H__
+
+#include <stddef.h>
+#include <string.h>
+
+#include "data.h"
+
+/* Unit-stride loops for elementwise operations.
+ *
+ * vector.c and matrix.c route dense, unit-stride operands through
+ * these. The restrict qualifiers let the compiler vectorize, so they
+ * are only valid when the operands do not overlap; callers check
+ * with c_vv_overlap / c_mm_overlap first and fall back to the strided
+ * loops otherwise
+ */
+
+#define C_CONTIG_VV_OP( name, op )                                           \
+static inline void                                                           \
+name( size_t n, double* restrict a, const double* restrict b ) {             \
+    size_t i;                                                                \
+    for (i = 0; i < n; i++) {                                                \
+        a[ i ] op b[ i ];                                                    \
+    }                                                                        \
+}
+
+#define C_CONTIG_V_OP( name, op )                                            \
+static inline void                                                           \
+name( size_t n, double* restrict a, const double x ) {                       \
+    size_t i;                                                                \
+    for (i = 0; i < n; i++) {                                                \
+        a[ i ] op x;                                                         \
+    }                                                                        \
+}
+
+C_CONTIG_VV_OP( c_contig_add, += )
+C_CONTIG_VV_OP( c_contig_sub, -= )
+C_CONTIG_VV_OP( c_contig_mul, *= )
+C_CONTIG_VV_OP( c_contig_div, /= )
+
+C_CONTIG_V_OP( c_contig_scale, *= )
+C_CONTIG_V_OP( c_contig_add_constant, += )
+
+static inline void
+c_contig_swap( size_t n, double* restrict a, double* restrict b ) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const double tmp = a[ i ];
+        a[ i ] = b[ i ];
+        b[ i ] = tmp;
+    }
+}
+
+static inline void
+c_contig_set_all( size_t n, double* a, const double x ) {
+    static const double zero = 0.0;
+
+    /* only +0.0 is all bits zero, -0.0 has the sign bit set */
+    if (memcmp( &x, &zero, sizeof(double) ) == 0) {
+        memset( a, 0, n * sizeof(double) );
+    } else {
+        size_t i;
+        for (i = 0; i < n; i++) {
+            a[ i ] = x;
+        }
+    }
+}
+
+/* unit stride and no index selection */
+static inline int
+c_v_is_contiguous( Vector* v ) {
+    return v->offsets == NULL && v->stride == 1;
+}
+
+/* unit column stride, rows may be padded */
+static inline int
+c_m_has_contiguous_rows( Matrix* m ) {
+    return m->offsets == NULL && m->column_stride == 1;
+}
+
+/* the whole matrix is one unbroken block, so 2-D loops collapse to one */
+static inline int
+c_m_is_contiguous( Matrix* m ) {
+    return c_m_has_contiguous_rows( m ) && (m->rows == 1 || m->row_stride == m->columns);
+}
+
+#endif
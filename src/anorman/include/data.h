@@ -16,10 +16,17 @@
 
 #define MAX_NUM_ELEMENTS 2147483647
 
+/* growable integer list (see intlist.c). elements holds int32_t, int64_t
+   or uint32_t cells depending on type. index is an optional side hash of
+   value -> first position + 1, rebuilt when stale */
 struct intlist_struct
 {
     size_t size;
-    int*   elements;
+    size_t capacity;
+    int    type;
+    void*  elements;
+    struct int_double_map_struct* index;
+    int    index_stale;
 };
 
 struct doublelist_struct
@@ -31,11 +38,15 @@ struct doublelist_struct
 typedef struct intlist_struct IntList;
 typedef struct doublelist_struct DoubleList;
 
+/* open addressing hash map with double hashing (see map.c) */
 struct int_double_map_struct
 {
     uint8_t  * states;
-    size_t   * values;
-    double   * table;
+    size_t   * keys;
+    double   * values;
+    size_t   capacity;
+    size_t   distinct;
+    size_t   free_entries;
     size_t   low_water_mark;
     size_t   high_water_mark;
     double   min_load_factor;
@@ -44,6 +55,19 @@ struct int_double_map_struct
 
 typedef struct int_double_map_struct IntDoubleMap;
 
+/* compressed sparse rows. Columns are sorted within each row */
+struct csr_matrix_struct
+{
+    size_t   rows;
+    size_t   columns;
+    size_t   nnz;
+    size_t * row_ptr;
+    size_t * col_idx;
+    double * values;
+};
+
+typedef struct csr_matrix_struct CSRMatrix;
+
 
 struct vector_offsets_struct
 {
@@ -0,0 +1,35 @@
+#ifndef __ANORMAN_DNA_H__
+#define __ANORMAN_DNA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* composition classes, either case. IUPAC covers the ambiguity codes
+   R Y S W K M B D H V and the gap characters '.' and '-'; anything else
+   (U included) is other */
+enum {
+    C_NT_A = 0,
+    C_NT_C,
+    C_NT_G,
+    C_NT_T,
+    C_NT_N,
+    C_NT_IUPAC,
+    C_NT_OTHER,
+    C_NT_CLASSES
+};
+
+/* counts of every class in one pass */
+void c_dna_composition( const char*, size_t, uint64_t* );
+
+/* 2-bit codes T = 0, C = 1, G = 2, A = 3, so the complement of a code
+   is code ^ 3. Base i sits in byte i / 4 at bit 2 * (i % 4), the layout
+   of Perl's vec( $bits, $i, 2 ). Bases other than ACGT pack as T */
+size_t c_dna_packed_size( size_t );
+
+void c_dna_pack_2bit( const char*, size_t, uint8_t* );
+void c_dna_unpack_2bit( const uint8_t*, size_t, char* );
+
+/* reverse complement of n packed bases */
+void c_dna_revcomp_2bit( const uint8_t*, size_t, uint8_t* );
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __ANORMAN_EXPRESSION_H__
+#define __ANORMAN_EXPRESSION_H__
+
+#include <stddef.h>
+#include "data.h"
+
+/* elements per evaluation block */
+#define C_EXPR_BLOCK 256
+
+/* opcodes of a postfix expression program */
+enum {
+    C_EXPR_LOAD  = 0,   /* push operand arg    */
+    C_EXPR_CONST = 1,   /* push constant arg   */
+    C_EXPR_ADD   = 2,
+    C_EXPR_SUB   = 3,
+    C_EXPR_MUL   = 4,
+    C_EXPR_DIV   = 5,
+    C_EXPR_NEG   = 6
+};
+
+struct expr_instr_struct
+{
+    int    op;
+    size_t arg;
+};
+
+typedef struct expr_instr_struct ExprInstr;
+
+/* dst <- program( operands, constants ). All operands have the shape of
+   dst. The program is checked against the operand and constant counts
+   before anything is evaluated */
+int c_expr_eval_vector( const ExprInstr*, size_t, Vector**, size_t, const double*, size_t, Vector* );
+int c_expr_eval_matrix( const ExprInstr*, size_t, Matrix**, size_t, const double*, size_t, Matrix* );
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef __ANORMAN_FRAMES_H__
+#define __ANORMAN_FRAMES_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "raster.h"
+
+/* Frames written by a background thread, either as one animated PNG or,
+ * if the path holds a printf conversion for the frame number (such as
+ * "som.epoch%03d.png", other '%' written "%%"), as a sequence of PNG
+ * files. Frames are queued and the caller only waits when the queue is
+ * full. All frames of an animation must have the size of the first */
+struct frame_writer_struct
+{
+    char*            path;
+    int              animate;
+    int              level;
+    unsigned         delay;      /* ms a frame */
+
+    /* animation */
+    FILE*            fp;
+    size_t           width;
+    size_t           height;
+    uint32_t         frames;
+    uint32_t         sequence;
+    long             actl;       /* offset of the frame count */
+
+    /* queue */
+    Raster**         queue;
+    size_t*          numbers;
+    size_t           head;
+    size_t           n;
+    size_t           capacity;
+    int              closing;
+    int              status;
+
+    pthread_t        thread;
+    pthread_mutex_t  lock;
+    pthread_cond_t   ready;
+    pthread_cond_t   room;
+};
+
+typedef struct frame_writer_struct FrameWriter;
+
+/* path, zlib level and frame delay. NULL if the path holds more than
+   one %d conversion or a '%' that is neither that nor '%%', if the
+   file cannot be written or the thread cannot be started */
+FrameWriter* c_fw_open( const char*, int, unsigned );
+
+/* queue a raster as frame number n. The writer owns and frees it.
+   Returns C_EFAULT once a write has failed */
+int c_fw_push( FrameWriter*, Raster*, size_t );
+
+/* write out the queue, finish the file and free the writer */
+int c_fw_close( FrameWriter* );
+
+#endif
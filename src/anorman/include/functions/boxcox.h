@@ -0,0 +1,21 @@
+#ifndef __ANORMAN_FUNCTIONS_BOXCOX_H__
+#define __ANORMAN_FUNCTIONS_BOXCOX_H__
+
+#include <stddef.h>
+
+struct boxcox_fit_struct
+{
+    double lambda1;
+    double lambda2;
+    double likelihood;
+};
+
+typedef struct boxcox_fit_struct BoxCoxFit;
+
+double c_boxcox_shift( const double*, size_t );
+double c_boxcox_prepare( double*, size_t, double );
+double c_boxcox_likelihood( const double*, size_t, double, double );
+BoxCoxFit c_boxcox_optimize( double*, size_t, double, double, double, double );
+int c_boxcox_optimize_columns( double**, const size_t*, size_t, double, double, double, double, BoxCoxFit* );
+
+#endif
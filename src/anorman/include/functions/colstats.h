@@ -0,0 +1,48 @@
+#ifndef __ANORMAN_FUNCTIONS_COLSTATS_H__
+#define __ANORMAN_FUNCTIONS_COLSTATS_H__
+
+#include "data.h"
+
+/* running (Welford) statistics for every column of a matrix.
+ * Stored as separate arrays so that one row can update all
+ * columns with contiguous (vectorizable) loads */
+struct column_stats_struct
+{
+    size_t  columns;
+    size_t  n;
+    double* min;
+    double* max;
+    double* mean;
+    double* M2;
+};
+
+typedef struct column_stats_struct ColumnStats;
+
+/* P-square streaming quantile estimator (Jain & Chlamtac, 1985) */
+struct p2_quantile_struct
+{
+    double phi;
+    double q[5];
+    double np[5];
+    double dn[5];
+    size_t pos[5];
+    size_t count;
+};
+
+typedef struct p2_quantile_struct P2Quantile;
+
+ColumnStats* c_colstats_alloc( size_t );
+void c_colstats_free( ColumnStats* );
+void c_colstats_reset( ColumnStats* );
+void c_colstats_add_row( ColumnStats*, const double*, size_t );
+void c_colstats_merge( ColumnStats*, const ColumnStats* );
+double c_colstats_variance( const ColumnStats*, size_t );
+
+int c_m_column_stats( Matrix*, ColumnStats* );
+int c_m_column_quantiles( Matrix*, const double*, size_t, double* );
+
+void c_p2_init( P2Quantile*, double );
+void c_p2_add( P2Quantile*, double );
+double c_p2_result( const P2Quantile* );
+
+#endif
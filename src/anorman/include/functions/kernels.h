@@ -0,0 +1,219 @@
+#ifndef __ANORMAN_FUNCTIONS_KERNELS_H__
+#define __ANORMAN_FUNCTIONS_KERNELS_H__
+
+#include "data.h"
+
+/* Specialized vector kernels.
+ *
+ * A kernel K is described by three macros: K_STATE declares the
+ * accumulators, K_BODY folds one element pair (x, y) into them and
+ * K_RESULT turns them into the return value. C_VV_KERNEL then
+ * generates a contiguous, a strided and an offset-indexed loop over
+ * the same body plus a dispatcher picking one of them, so the
+ * compiler sees the whole reduction and can inline and vectorize it.
+ * Kernels may read extra parameters (p-values, means) from param.
+ *
+ * C_VV_KERNEL_UPTO does the same for early-exit kernels that stop
+ * once the accumulator passes a threshold. The test is made once per
+ * block of C_KERNEL_BLOCK elements to keep the inner loop branch free
+ */
+
+#define C_KERNEL_BLOCK 16
+
+#define C_VV_KERNEL( name, K )                                                       \
+static double                                                                        \
+name##_contig( size_t n, const double* restrict a, const double* restrict b,         \
+               const double* param ) {                                               \
+    K##_STATE;                                                                       \
+    size_t i;                                                                        \
+    (void) param;                                                                    \
+    for (i = 0; i < n; i++) {                                                        \
+        const double x = a[ i ];                                                     \
+        const double y = b[ i ];                                                     \
+        K##_BODY;                                                                    \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+static double                                                                        \
+name##_strided( size_t n, const double* a, size_t sa, const double* b, size_t sb,    \
+                const double* param ) {                                              \
+    K##_STATE;                                                                       \
+    size_t i;                                                                        \
+    (void) param;                                                                    \
+    for (i = 0; i < n; i++) {                                                        \
+        const double x = a[ i * sa ];                                                \
+        const double y = b[ i * sb ];                                                \
+        K##_BODY;                                                                    \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+static double                                                                        \
+name##_indexed( size_t n, Vector* u, Vector* v, const double* param ) {              \
+    K##_STATE;                                                                       \
+    size_t i;                                                                        \
+    (void) param;                                                                    \
+    for (i = 0; i < n; i++) {                                                        \
+        const double x = c_v_get_quick( u, i );                                      \
+        const double y = c_v_get_quick( v, i );                                      \
+        K##_BODY;                                                                    \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+double                                                                               \
+name( size_t n, Vector* u, Vector* v, const double* param ) {                        \
+    if (u->offsets || v->offsets) {                                                  \
+        return name##_indexed( n, u, v, param );                                     \
+    }                                                                                \
+                                                                                     \
+    const double* a = u->elements + u->zero;                                         \
+    const double* b = v->elements + v->zero;                                         \
+                                                                                     \
+    if (u->stride == 1 && v->stride == 1) {                                          \
+        return name##_contig( n, a, b, param );                                      \
+    }                                                                                \
+                                                                                     \
+    return name##_strided( n, a, u->stride, b, v->stride, param );                   \
+}
+
+#define C_VV_KERNEL_UPTO( name, K )                                                  \
+static double                                                                        \
+name##_contig( size_t n, const double* restrict a, const double* restrict b,         \
+               const double* param, const double th ) {                              \
+    K##_STATE;                                                                       \
+    size_t i = 0;                                                                    \
+    (void) param;                                                                    \
+    while (i < n) {                                                                  \
+        const size_t end = i + C_KERNEL_BLOCK < n ? i + C_KERNEL_BLOCK : n;          \
+        for (; i < end; i++) {                                                       \
+            const double x = a[ i ];                                                 \
+            const double y = b[ i ];                                                 \
+            K##_BODY;                                                                \
+        }                                                                            \
+        if (K##_RESULT > th) break;                                                  \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+static double                                                                        \
+name##_strided( size_t n, const double* a, size_t sa, const double* b, size_t sb,    \
+                const double* param, const double th ) {                             \
+    K##_STATE;                                                                       \
+    size_t i = 0;                                                                    \
+    (void) param;                                                                    \
+    while (i < n) {                                                                  \
+        const size_t end = i + C_KERNEL_BLOCK < n ? i + C_KERNEL_BLOCK : n;          \
+        for (; i < end; i++) {                                                       \
+            const double x = a[ i * sa ];                                            \
+            const double y = b[ i * sb ];                                            \
+            K##_BODY;                                                                \
+        }                                                                            \
+        if (K##_RESULT > th) break;                                                  \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+static double                                                                        \
+name##_indexed( size_t n, Vector* u, Vector* v, const double* param,                 \
+                const double th ) {                                                  \
+    K##_STATE;                                                                       \
+    size_t i;                                                                        \
+    (void) param;                                                                    \
+    for (i = 0; i < n; i++) {                                                        \
+        const double x = c_v_get_quick( u, i );                                      \
+        const double y = c_v_get_quick( v, i );                                      \
+        K##_BODY;                                                                    \
+        if (K##_RESULT > th) break;                                                  \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+double                                                                               \
+name( size_t n, Vector* u, Vector* v, const double* param, const double th ) {       \
+    if (u->offsets || v->offsets) {                                                  \
+        return name##_indexed( n, u, v, param, th );                                 \
+    }                                                                                \
+                                                                                     \
+    const double* a = u->elements + u->zero;                                         \
+    const double* b = v->elements + v->zero;                                         \
+                                                                                     \
+    if (u->stride == 1 && v->stride == 1) {                                          \
+        return name##_contig( n, a, b, param, th );                                  \
+    }                                                                                \
+                                                                                     \
+    return name##_strided( n, a, u->stride, b, v->stride, param, th );               \
+}
+
+/* single vector reductions, the element is x */
+#define C_V_KERNEL( name, K )                                                        \
+static double                                                                        \
+name##_contig( size_t n, const double* restrict a ) {                                \
+    K##_STATE;                                                                       \
+    size_t i;                                                                        \
+    for (i = 0; i < n; i++) {                                                        \
+        const double x = a[ i ];                                                     \
+        K##_BODY;                                                                    \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+static double                                                                        \
+name##_strided( size_t n, const double* a, size_t sa ) {                             \
+    K##_STATE;                                                                       \
+    size_t i;                                                                        \
+    for (i = 0; i < n; i++) {                                                        \
+        const double x = a[ i * sa ];                                                \
+        K##_BODY;                                                                    \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+static double                                                                        \
+name##_indexed( size_t n, Vector* u ) {                                              \
+    K##_STATE;                                                                       \
+    size_t i;                                                                        \
+    for (i = 0; i < n; i++) {                                                        \
+        const double x = c_v_get_quick( u, i );                                      \
+        K##_BODY;                                                                    \
+    }                                                                                \
+    return K##_RESULT;                                                               \
+}                                                                                    \
+                                                                                     \
+double                                                                               \
+name( size_t n, Vector* u ) {                                                        \
+    if (u->offsets) {                                                                \
+        return name##_indexed( n, u );                                               \
+    }                                                                                \
+                                                                                     \
+    const double* a = u->elements + u->zero;                                         \
+                                                                                     \
+    if (u->stride == 1) {                                                            \
+        return name##_contig( n, a );                                                \
+    }                                                                                \
+                                                                                     \
+    return name##_strided( n, a, u->stride );                                        \
+}
+
+/* generated kernels */
+double c_kernel_sum( size_t, Vector* );
+double c_kernel_min( size_t, Vector* );
+double c_kernel_max( size_t, Vector* );
+
+double c_kernel_manhattan( size_t, Vector*, Vector*, const double* );
+double c_kernel_squared_euclidean( size_t, Vector*, Vector*, const double* );
+double c_kernel_maximum( size_t, Vector*, Vector*, const double* );
+double c_kernel_canberra( size_t, Vector*, Vector*, const double* );
+double c_kernel_bray_curtis( size_t, Vector*, Vector*, const double* );
+double c_kernel_cosine( size_t, Vector*, Vector*, const double* );
+double c_kernel_comoment( size_t, Vector*, Vector*, const double* );
+double c_kernel_correlation( size_t, Vector*, Vector*, const double* );
+double c_kernel_lp( size_t, Vector*, Vector*, const double* );
+
+double c_kernel_manhattan_upto( size_t, Vector*, Vector*, const double*, const double );
+double c_kernel_squared_euclidean_upto( size_t, Vector*, Vector*, const double*, const double );
+double c_kernel_maximum_upto( size_t, Vector*, Vector*, const double*, const double );
+double c_kernel_lp_upto( size_t, Vector*, Vector*, const double*, const double );
+
+#endif
@@ -10,9 +10,19 @@ typedef double ( *vv_thr_func ) ( size_t, Vector*, Vector*, double );
 double c_vv_aggregate_quick( size_t, Vector*, Vector*, dd_func, dd_func );
 double c_vv_aggregate_quick_upto( size_t size, Vector* a, Vector* b, dd_func aggr, dd_func f, const double threshold ); 
 double c_vv_covariance( size_t, Vector*, Vector* );
+double c_vv_correlation( size_t, Vector*, Vector* );
 double c_vv_dist_manhattan( size_t, Vector*, Vector* );
 double c_vv_dist_euclidean( size_t, Vector*, Vector* );
 double c_vv_dist_manhattan_upto( size_t, Vector*, Vector*, double );
 double c_vv_dist_euclidean_upto( size_t, Vector*, Vector*, double );
 double c_vv_squared_dist_euclidean( size_t, Vector*, Vector* );
+double c_vv_dist_squared_euclidean_upto( size_t, Vector*, Vector*, double );
+double c_vv_dist_maximum( size_t, Vector*, Vector* );
+double c_vv_dist_maximum_upto( size_t, Vector*, Vector*, double );
+double c_vv_dist_lp( size_t, Vector*, Vector*, double );
+double c_vv_dist_lp_upto( size_t, Vector*, Vector*, double, double );
+double c_vv_dist_canberra( size_t, Vector*, Vector* );
+double c_vv_dist_bray_curtis( size_t, Vector*, Vector* );
+double c_vv_dist_cosine( size_t, Vector*, Vector* );
+double c_vv_dist_correlation( size_t, Vector*, Vector* );
 #endif
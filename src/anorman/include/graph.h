@@ -0,0 +1,129 @@
+#ifndef __ANORMAN_GRAPH_H__
+#define __ANORMAN_GRAPH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
+/* filter operators */
+enum {
+    C_GRAPH_LT = 0,
+    C_GRAPH_LE = 1,
+    C_GRAPH_GT = 2,
+    C_GRAPH_GE = 3,
+    C_GRAPH_EQ = 4,
+    C_GRAPH_NE = 5
+};
+
+/* filterable columns */
+enum {
+    C_GRAPH_NODE_LENGTH   = 0,
+    C_GRAPH_NODE_COVERAGE = 1,
+    C_GRAPH_NODE_DEGREE   = 2
+};
+
+enum {
+    C_GRAPH_EDGE_CONNECTIONS = 0,
+    C_GRAPH_EDGE_RATIO       = 1,
+    C_GRAPH_EDGE_SCORE       = 2,
+    C_GRAPH_EDGE_TYPE        = 3
+};
+
+enum {
+    C_GRAPH_COMP_SIZE      = 0,
+    C_GRAPH_COMP_LENGTH    = 1,
+    C_GRAPH_COMP_COVERAGE  = 2,
+    C_GRAPH_COMP_EDGES     = 3
+};
+
+/* An assembly graph in columns. Nodes and edges are numbered in the
+   order they were loaded; edges are additionally indexed by source
+   (CSR) and by target (CSC). Filtered nodes, edges and components stay
+   in place with their active flag cleared */
+struct asm_graph_struct
+{
+    StrIntern* names;           /* node name -> node id */
+    StrIntern* seqids;
+    StrIntern* types;           /* edge types */
+
+    /* node columns */
+    size_t    n_nodes;
+    size_t    node_capacity;
+    uint32_t* node_seqid;
+    uint64_t* length;
+    double*   coverage;
+    uint32_t* degree;           /* active incident edges */
+    uint8_t*  node_active;
+    int64_t*  seqid_node;       /* seqid id -> node id */
+
+    /* edge columns */
+    size_t    n_edges;
+    size_t    edge_capacity;
+    uint32_t* src;
+    uint32_t* dst;
+    uint32_t* type;
+    uint32_t* connections;
+    double*   ratio;
+    double*   score;
+    uint8_t*  edge_active;
+
+    /* CSR / CSC of all edges, rebuilt when edges were added */
+    int       indexed;
+    size_t*   out_ptr;
+    uint32_t* out_edge;
+    size_t*   in_ptr;
+    uint32_t* in_edge;
+
+    /* connected components of the active edges, largest first. Nodes
+       without active edges do not belong to any */
+    int       components_valid;
+    size_t    n_components;
+    int64_t*  component;        /* by node, -1 for orphans */
+    size_t*   comp_ptr;
+    uint32_t* comp_nodes;
+    uint64_t* comp_length;
+    double*   comp_coverage;    /* length weighted mean */
+    size_t*   comp_edges;
+    uint8_t*  comp_active;
+    int64_t*  comp_rank;        /* position among the active components */
+    size_t    n_active_components;
+    uint32_t* comp_order;
+
+    /* traversal scratch */
+    uint32_t* visit_stamp;
+    uint32_t  stamp;
+    uint32_t* visit_stack;
+    size_t*   visit_pos;
+};
+
+typedef struct asm_graph_struct AsmGraph;
+
+AsmGraph* c_graph_alloc( void );
+void c_graph_free( AsmGraph* );
+
+int64_t c_graph_add_node( AsmGraph*, const char*, size_t, const char*, size_t, uint64_t, double );
+int64_t c_graph_add_edge( AsmGraph*, const char*, size_t, const char*, size_t, const char*, size_t, uint32_t, double, double );
+
+/* tab separated files, '#' comments. Returns the number of lines read or
+   -1; edges between unknown nodes are counted in *skipped */
+int64_t c_graph_load_nodes( AsmGraph*, const char* );
+int64_t c_graph_load_edges( AsmGraph*, const char*, size_t* );
+
+int c_graph_index( AsmGraph* );
+void c_graph_degrees( AsmGraph* );
+int c_graph_components( AsmGraph* );
+
+/* drop single nodes (with their edges) and edges */
+void c_graph_drop_node( AsmGraph*, uint32_t );
+void c_graph_drop_edge( AsmGraph*, uint32_t );
+
+size_t c_graph_filter_nodes( AsmGraph*, int, int, double );
+size_t c_graph_filter_edges( AsmGraph*, int, int, double );
+size_t c_graph_filter_components( AsmGraph*, int, int, double );
+void c_graph_rank_components( AsmGraph* );
+
+/* nodes reachable from start over active edges in either direction, in
+   breadth or depth first order. Returns the count, or -1 */
+int64_t c_graph_traverse( AsmGraph*, uint32_t, int, uint32_t* );
+
+#endif
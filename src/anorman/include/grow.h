@@ -0,0 +1,42 @@
+#ifndef __ANORMAN_GROW_H__
+#define __ANORMAN_GROW_H__
+
+#include <stddef.h>
+
+/* interpolation of inserted neurons */
+enum {
+    C_GROW_MEAN     = 0,    /* mean of the old neurons on either side */
+    C_GROW_BILINEAR = 1     /* weighted by the distance to either side */
+};
+
+/* One axis of a grid grown from n to m positions. Old position k is
+ * placed at place[k], spread evenly over the new axis; on toroids the
+ * gap after the last wraps around to the first. New position j lies
+ * between old positions lo[j] and hi[j], at fraction t[j] of the way
+ * (0 on old positions) */
+struct grow_axis_struct
+{
+    size_t  n;
+    size_t  m;
+    size_t* place;
+    size_t* lo;
+    size_t* hi;
+    double* t;
+};
+
+typedef struct grow_axis_struct GrowAxis;
+
+/* n, m, toroid and method */
+GrowAxis* c_grow_axis_alloc( size_t, size_t, int, int );
+void c_grow_axis_free( GrowAxis* );
+
+/* Weights of the grown grid, one neuron a row. Takes the old weights
+   and their row stride, the neuron dimension, the row and column axes
+   and the new weights and their row stride. Columns are grown first,
+   then rows, each pass a band of grid rows per thread */
+int c_grow_weights( const double*, size_t, size_t, const GrowAxis*, const GrowAxis*, double*, size_t );
+
+/* index of an old neuron on the grown grid */
+size_t c_grow_index( const GrowAxis*, const GrowAxis*, size_t );
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef __ANORMAN_HITTABLE_H__
+#define __ANORMAN_HITTABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
+/* table layouts */
+enum {
+    C_HIT_BLAST      = 0,   /* BLAST / diamond -outfmt 6 */
+    C_HIT_TBLOUT     = 1,   /* hmmscan --tblout */
+    C_HIT_DOMTBLOUT  = 2    /* hmmscan --domtblout */
+};
+
+/* hits compete within */
+enum {
+    C_HIT_BY_QUERY        = 0,
+    C_HIT_BY_QUERY_DOMAIN = 1
+};
+
+/* one typed hit. Names are ids into the tables of the reader, -1 (as
+   UINT32_MAX) where a layout has no such column */
+struct hit_record_struct
+{
+    double   eval;
+    double   bit_score;
+    double   bias;
+    double   pct_id;
+    uint64_t line;          /* order in the input, breaks score ties */
+    uint32_t q_id;
+    uint32_t s_id;
+    uint32_t q_acc;
+    uint32_t s_acc;
+    uint32_t aln_len;
+    uint32_t mismatches;
+    uint32_t gap_open;
+    uint32_t q_beg;
+    uint32_t q_end;
+    uint32_t s_beg;
+    uint32_t s_end;
+    uint32_t q_len;
+    uint32_t s_len;
+    uint32_t dom_num;
+};
+
+typedef struct hit_record_struct HitRecord;
+
+/* Best hits per group (query, or query and domain), kept in a min-heap
+   of at most top_n records per group while the table streams past */
+struct hit_table_struct
+{
+    int        format;
+    int        group_by;
+    size_t     top_n;
+
+    StrIntern* names;       /* query and subject names */
+    StrIntern* accs;
+    StrIntern* descs;
+    StrIntern* groups;
+    int64_t*   s_desc;      /* description id by subject name id */
+    size_t     s_desc_capacity;
+
+    HitRecord* heap;        /* top_n cells per group */
+    size_t*    count;       /* filled cells per group */
+    size_t     capacity;    /* groups the arrays hold */
+
+    uint64_t   lines;
+    uint64_t   skipped;     /* malformed lines */
+    int        sorted;
+    size_t     next_group;  /* position of c_hits_next */
+    size_t     next_k;
+
+    char*      scratch;     /* group keys and descriptions */
+    size_t     scratch_size;
+};
+
+typedef struct hit_table_struct HitTable;
+
+HitTable* c_hits_alloc( int, int, size_t );
+void c_hits_free( HitTable* );
+
+/* parse one data line, modified in place. C_EINVAL for malformed lines */
+int c_hits_add_line( HitTable*, char*, size_t );
+
+/* a whole file, "-" for standard input. Returns the data lines read, or -1 */
+int64_t c_hits_read( HitTable*, const char* );
+
+/* order every group best first. Lines added afterwards turn the groups
+   back into heaps */
+void c_hits_sort( HitTable* );
+
+size_t c_hits_groups( HitTable* );
+size_t c_hits_count( HitTable*, size_t );
+HitRecord* c_hits_get( HitTable*, size_t, size_t );
+
+/* all kept records group by group, NULL at the end */
+HitRecord* c_hits_next( HitTable* );
+void c_hits_rewind( HitTable* );
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __ANORMAN_IMAGE_H__
+#define __ANORMAN_IMAGE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Filters over toroidal rows x columns images stored row by row, such
+   as a U-matrix. Pixels beyond an edge wrap around to the other side */
+
+/* pixel value of edge detection masks off an edge */
+#define C_IMG_NO_EDGE -3
+
+/* 5x5 binomial blur, [1 4 6 4 1] / 16 both ways */
+int c_img_blur( const double*, double*, size_t, size_t );
+
+/* 3x3 edge enhancement, 0.5 1 0.5 / 1 -6 1 / 0.5 1 0.5 */
+int c_img_enhance( const double*, double*, size_t, size_t );
+
+/* 5x5 Sobel gradient: magnitude and direction, 0 .. 7 in steps of 45
+   degrees. Either output may be NULL */
+int c_img_sobel( const double*, double*, int*, size_t, size_t );
+
+/* 256 bins of (int) (255 * value) & 0xFF */
+void c_img_histogram( const double*, size_t, uint64_t* );
+
+/* Otsu threshold of a histogram, in [0, 1] */
+double c_img_otsu( const uint64_t* );
+
+/* Edge mask: optional blur, Sobel gradient, magnitudes scaled to
+   [0, 1] and their histogram, then pixels that are a local maximum
+   along their direction and above threshold keep the direction, the
+   rest C_IMG_NO_EDGE. A negative threshold means the Otsu threshold,
+   which is returned. magnitude (n doubles) and hist (256) may be NULL */
+double c_img_edges( const double*, size_t, size_t, int, double, double*, int*, uint64_t* );
+
+#endif
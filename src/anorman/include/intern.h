@@ -0,0 +1,39 @@
+#ifndef __ANORMAN_INTERN_H__
+#define __ANORMAN_INTERN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define C_INTERN_DEFAULT_CAPACITY 1024
+
+/* Strings mapped to dense ids 0, 1, 2... in order of first insertion.
+   The characters live in one growing arena, NUL terminated */
+struct str_intern_struct
+{
+    char*     arena;
+    size_t    arena_size;
+    size_t    arena_capacity;
+
+    size_t*   offsets;      /* arena offset by id */
+    uint32_t* lengths;
+    uint32_t* hashes;
+    size_t    size;
+    size_t    capacity;
+
+    uint32_t* slots;        /* id + 1, 0 is free. Power of two */
+    size_t    n_slots;
+};
+
+typedef struct str_intern_struct StrIntern;
+
+StrIntern* c_intern_alloc( size_t );
+void c_intern_free( StrIntern* );
+
+/* id of a string, -1 if absent (lookup) or out of memory (add) */
+int64_t c_intern_lookup( StrIntern*, const char*, size_t );
+int64_t c_intern_add( StrIntern*, const char*, size_t );
+
+const char* c_intern_name( StrIntern*, size_t, size_t* );
+size_t c_intern_size( StrIntern* );
+
+#endif
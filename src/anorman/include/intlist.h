@@ -0,0 +1,46 @@
+#ifndef __ANORMAN_INTLIST_H__
+#define __ANORMAN_INTLIST_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "data.h"
+
+/* cell types */
+enum {
+    C_IL_INT32  = 0,
+    C_IL_INT64  = 1,
+    C_IL_UINT32 = 2
+};
+
+#define C_IL_DEFAULT_CAPACITY 16
+
+size_t c_il_width( int );
+
+IntList* c_il_alloc( int, size_t );
+void c_il_free( IntList* );
+IntList* c_il_copy( IntList* );
+
+int c_il_reserve( IntList*, size_t );
+int c_il_resize( IntList*, size_t );
+void c_il_clear( IntList* );
+
+/* values are converted to the cell type of the list */
+int64_t c_il_get( IntList*, size_t );
+void c_il_set( IntList*, size_t, int64_t );
+int c_il_push( IntList*, int64_t );
+int64_t c_il_pop( IntList* );
+
+int c_il_fill_range( IntList*, int64_t, size_t );
+
+/* raw native-endian cells, as produced by pack("l*"), pack("q*") or pack("L*") */
+int c_il_assign_bytes( IntList*, const char*, size_t );
+
+/* position of the first occurrence of a value, -1 if absent */
+int c_il_use_index( IntList*, int );
+ptrdiff_t c_il_index_of( IntList*, int64_t );
+
+void c_il_sort( IntList* );
+/* seed, stream */
+void c_il_shuffle( IntList*, uint64_t, uint64_t );
+
+#endif
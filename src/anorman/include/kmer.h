@@ -0,0 +1,80 @@
+#ifndef __ANORMAN_KMER_H__
+#define __ANORMAN_KMER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* k-mers are 2 bits a base (A = 0, C = 1, G = 2, T = 3), one word for
+   k <= 31 and two (high word first) for k <= 63 */
+#define C_KMER_MAX_K    63
+#define C_KMER_MAX_K64  31
+
+/* Canonical k-mer spectrum of a set of sequences.
+ *
+ * Sequences are queued and scanned in batches by all threads. Every
+ * k-mer goes to one of parts bins by the hash of its minimizer, and the
+ * bins are written to spill_dir once they outgrow memory bytes (if
+ * both are given). Counting then fills one open-addressing table per
+ * bin. The result is one sorted array of the distinct k-mers */
+struct kmer_counter_struct
+{
+    size_t     k;
+    size_t     words;           /* per k-mer */
+    size_t     m;               /* minimizer length */
+    size_t     parts;
+
+    size_t     memory;          /* bin bytes before spilling, 0 for no limit */
+    char*      spill_path;      /* file name prefix, NULL to keep all in memory */
+
+    /* sequences waiting for a batch */
+    char*      seqs;
+    size_t     seqs_size;
+    size_t     seqs_capacity;
+    size_t*    seq_end;
+    size_t     n_seqs;
+    size_t     seq_capacity;
+
+    /* k-mers by partition */
+    uint64_t** bin;
+    size_t*    bin_n;
+    size_t*    bin_capacity;
+    size_t*    spill_n;         /* k-mers written out per partition */
+
+    /* the spectrum, once counted or loaded */
+    int        counted;
+    size_t     n;
+    uint64_t*  keys;            /* n x words, ascending */
+    uint32_t*  counts;          /* saturating */
+    uint64_t   total;           /* k-mers seen */
+};
+
+typedef struct kmer_counter_struct KmerCounter;
+
+/* k, partitions, memory and spill directory (may be NULL) */
+KmerCounter* c_kc_alloc( size_t, size_t, size_t, const char* );
+void c_kc_free( KmerCounter* );
+
+/* queue a sequence. Bases other than ACGT (either case) break k-mers */
+int c_kc_add( KmerCounter*, const char*, size_t );
+
+/* count everything queued */
+int c_kc_count( KmerCounter* );
+
+/* sorted binary count file. Loading returns NULL if the file cannot be
+   read or is not a count file */
+int c_kc_save( KmerCounter*, const char* );
+KmerCounter* c_kc_load( const char* );
+
+/* canonical key of a k letter string, C_EINVAL if it is no k-mer */
+int c_kc_encode( KmerCounter*, const char*, size_t, uint64_t* );
+void c_kc_decode( KmerCounter*, const uint64_t*, char* );
+
+/* rank of a key in the spectrum, or -1 */
+int64_t c_kc_find( KmerCounter*, const uint64_t* );
+
+/* k-mers of one sequence as (rank, count) pairs in rank order, for the
+   k-mers of the spectrum counted at least min_count times. The arrays
+   hold one cell per base. Returns the pairs, or -1 */
+int64_t c_kc_row( KmerCounter*, const char*, size_t, uint32_t, size_t*, double* );
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __ANORMAN_LAPACK_H__
+#define __ANORMAN_LAPACK_H__
+
+/* Prototypes for the Fortran LAPACK routines exported by OpenBLAS.
+ * All matrices are column-major. A row-major matrix handed to these
+ * routines is therefore seen as its transpose */
+
+void dsyevr_( const char* jobz, const char* range, const char* uplo, const int* n,
+              double* a, const int* lda, const double* vl, const double* vu,
+              const int* il, const int* iu, const double* abstol, int* m,
+              double* w, double* z, const int* ldz, int* isuppz, double* work,
+              const int* lwork, int* iwork, const int* liwork, int* info );
+
+void dgeqrf_( const int* m, const int* n, double* a, const int* lda, double* tau,
+              double* work, const int* lwork, int* info );
+
+void dorgqr_( const int* m, const int* n, const int* k, double* a, const int* lda,
+              const double* tau, double* work, const int* lwork, int* info );
+
+void dpotrf_( const char* uplo, const int* n, double* a, const int* lda, int* info );
+
+void dgetrf_( const int* m, const int* n, double* a, const int* lda, int* ipiv, int* info );
+
+void dsyevd_( const char* jobz, const char* uplo, const int* n, double* a, const int* lda,
+              double* w, double* work, const int* lwork, int* iwork, const int* liwork,
+              int* info );
+
+void dgesdd_( const char* jobz, const int* m, const int* n, double* a, const int* lda,
+              double* s, double* u, const int* ldu, double* vt, const int* ldvt,
+              double* work, const int* lwork, int* iwork, int* info );
+
+#endif
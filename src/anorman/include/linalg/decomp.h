@@ -0,0 +1,12 @@
+#ifndef __ANORMAN_LINALG_DECOMP_H__
+#define __ANORMAN_LINALG_DECOMP_H__
+
+#include "data.h"
+
+int c_linalg_cholesky( Matrix* );
+int c_linalg_lu( Matrix*, size_t*, int* );
+int c_linalg_qr( Matrix*, Vector* );
+int c_linalg_symm_eigen( Matrix*, Vector*, Matrix* );
+int c_linalg_svd( Matrix*, Vector*, Matrix*, Matrix* );
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef __ANORMAN_LINALG_GEMM_H__
+#define __ANORMAN_LINALG_GEMM_H__
+
+#include <stddef.h>
+
+/* register block of the micro-kernel */
+#define C_GEMM_MR 6
+#define C_GEMM_NR 8
+
+/* C <- alpha * A * B + beta * C for M x K A, K x N B and M x N C given
+   as base pointers with row and column strides */
+int c_gemm( size_t M, size_t N, size_t K, double alpha,
+            const double* A, size_t rsA, size_t csA,
+            const double* B, size_t rsB, size_t csB,
+            double beta, double* C, size_t rsC, size_t csC );
+
+/* cache blocking */
+void c_gemm_get_params( size_t* mc, size_t* kc, size_t* nc );
+int c_gemm_set_params( size_t mc, size_t kc, size_t nc );
+int c_gemm_load_params( const char* path );
+int c_gemm_save_params( const char* path );
+int c_gemm_autotune( void );
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __ANORMAN_LINALG_MAHALANOBIS_H__
+#define __ANORMAN_LINALG_MAHALANOBIS_H__
+
+#include "data.h"
+
+int c_mahalanobis_whiten( Matrix*, Matrix* );
+double c_mahalanobis_chol( Vector*, Vector*, Matrix* );
+
+#endif
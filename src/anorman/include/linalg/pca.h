@@ -0,0 +1,16 @@
+#ifndef __ANORMAN_LINALG_PCA_H__
+#define __ANORMAN_LINALG_PCA_H__
+
+#include "data.h"
+
+enum {
+    PCA_EIGEN      = 0,
+    PCA_RANDOMIZED = 1
+};
+
+int c_pca_covariance( Matrix*, const double*, double* );
+int c_pca_top_eigen( double*, size_t, size_t, double*, double* );
+int c_pca_randomized( Matrix*, const double*, size_t, size_t, size_t, double*, double* );
+int c_pca_truncated( Matrix*, const double*, size_t, int, double*, double* );
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __ANORMAN_MAP_H__
+#define __ANORMAN_MAP_H__
+
+#include <stddef.h>
+#include "data.h"
+
+#define C_IDM_DEFAULT_CAPACITY        277
+#define C_IDM_DEFAULT_MIN_LOAD_FACTOR 0.2
+#define C_IDM_DEFAULT_MAX_LOAD_FACTOR 0.5
+
+/* slot states */
+enum {
+    C_IDM_FREE    = 0,
+    C_IDM_FULL    = 1,
+    C_IDM_REMOVED = 2
+};
+
+size_t c_idm_next_prime( size_t );
+
+IntDoubleMap* c_idm_alloc( size_t, double, double );
+void c_idm_free( IntDoubleMap* );
+void c_idm_clear( IntDoubleMap* );
+IntDoubleMap* c_idm_copy( IntDoubleMap* );
+
+/* put / add return C_SUCCESS or an error code. Storing 0.0 removes a key */
+int c_idm_put( IntDoubleMap*, size_t, double );
+int c_idm_add( IntDoubleMap*, size_t, double );
+double c_idm_get( IntDoubleMap*, size_t );
+int c_idm_contains( IntDoubleMap*, size_t );
+int c_idm_remove( IntDoubleMap*, size_t );
+
+size_t c_idm_size( IntDoubleMap* );
+
+/* all pairs, sorted by key. Returns the number of pairs */
+size_t c_idm_pairs( IntDoubleMap*, size_t*, double* );
+
+#endif
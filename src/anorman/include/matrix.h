@@ -4,8 +4,9 @@
 #include <stddef.h>
 #include "data.h"
 
-void c_mm_copy( Matrix*, Matrix* );
+int c_mm_copy( Matrix*, Matrix* );
 double c_m_sum( Matrix* );
+int c_mm_overlap( Matrix*, Matrix* );
 
 
 /* Get-set calls */
@@ -14,6 +15,11 @@ size_t c_m_index( Matrix*, const size_t, const size_t );
 double c_m_get_quick( Matrix*, const size_t, const size_t );
 void   c_m_set_quick( Matrix*, const size_t, const size_t, const double);
 
+/* Row cursors */
+
+void c_m_row_view( Matrix*, size_t, Vector*, VectorOffsets* );
+int c_m_seek_row( Matrix*, Vector*, size_t );
+
 
 /* Mathematical operations */
 
@@ -0,0 +1,47 @@
+#ifndef __ANORMAN_MEMORY_H__
+#define __ANORMAN_MEMORY_H__
+
+#include <stddef.h>
+#include "data.h"
+
+/* element buffers start on a cache line */
+#define C_MEM_ALIGN 64
+
+/* buffers of at least C_MEM_HUGE_MIN bytes are aligned to (transparent)
+   huge pages unless $AN_HUGEPAGES is 0 */
+#define C_MEM_HUGE_PAGE (2 * 1024 * 1024)
+#define C_MEM_HUGE_MIN  (4 * 1024 * 1024)
+
+/* Vector / Matrix headers carved per slab chunk */
+#define C_MEM_SLAB_CHUNK 64
+
+struct mem_stats_struct
+{
+    size_t element_allocs;
+    size_t element_frees;
+    size_t element_bytes;   /* requested in total */
+    size_t huge_allocs;
+    size_t header_allocs;
+    size_t header_frees;
+    size_t slab_chunks;
+};
+
+typedef struct mem_stats_struct MemStats;
+
+/* zeroed, aligned element buffers. Buffers are compatible with free() */
+double* c_elements_alloc( size_t );
+void c_elements_free( double* );
+
+/* zeroed struct headers from the slab pools */
+Vector* c_vector_header_alloc( void );
+void c_vector_header_free( Vector* );
+Matrix* c_matrix_header_alloc( void );
+void c_matrix_header_free( Matrix* );
+
+int c_mem_hugepages( void );
+void c_mem_set_hugepages( int );
+
+void c_mem_stats( MemStats* );
+void c_mem_reset_stats( void );
+
+#endif
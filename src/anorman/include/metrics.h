@@ -0,0 +1,63 @@
+#ifndef __ANORMAN_METRICS_H__
+#define __ANORMAN_METRICS_H__
+
+#include <stddef.h>
+#include "data.h"
+
+/* counters of one training epoch */
+struct metrics_counters_struct
+{
+    size_t patterns;
+    size_t topo_errors;     /* best and second best match not adjacent (8-neighbourhood) */
+    size_t bm_moved;        /* bestmatch differs from the last epoch */
+    size_t dist_evals;      /* distances started */
+    size_t dist_skipped;    /* ... and abandoned by early exit */
+    double qe_sum;          /* quantization error, euclidean */
+    double qe_max;
+    double search_time;     /* seconds spent in bestmatch search */
+};
+
+typedef struct metrics_counters_struct MetricsCounters;
+
+struct train_metrics_struct
+{
+    MetricsCounters c;
+
+    /* grid layout for the topographic error. No errors are counted
+       when columns is 0 */
+    size_t rows;
+    size_t columns;
+    int    toroid;
+
+    /* bestmatches of the previous epoch, or NULL */
+    IntList* previous;
+};
+
+typedef struct train_metrics_struct TrainMetrics;
+
+/* result of a bestmatch scan */
+struct bm_scan_struct
+{
+    ptrdiff_t bm;
+    double    dist;
+    ptrdiff_t bm2;
+    double    dist2;
+    size_t    evals;
+    size_t    skipped;
+};
+
+typedef struct bm_scan_struct BMScan;
+
+void c_bm_scan_init( BMScan* );
+void c_bm_scan_neuron( BMScan*, const double*, const double*, size_t, size_t, int );
+
+void c_metrics_reset( TrainMetrics* );
+int c_metrics_adjacent( TrainMetrics*, size_t, size_t );
+void c_metrics_record( TrainMetrics*, MetricsCounters*, BMScan*, size_t );
+
+/* lock-free merge of thread local counters */
+void c_metrics_merge( MetricsCounters*, const MetricsCounters* );
+
+double c_metrics_clock( void );
+
+#endif
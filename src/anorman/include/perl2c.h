@@ -2,6 +2,7 @@
 #define __ANORMAN_PERL2C_H__
 
 #include "ppport.h"
+#include "memory.h"
 
 /* Defines. extract struct from Perl scalars */
 
@@ -21,8 +22,7 @@
     SV* sv_name = newSVuv( PTR2UV( ptr_name ) )
 
 #define ALLOC_ELEMS( slots, sv_name )          \
-    double* _ELEMS;                            \
-    Newxz( _ELEMS, slots, double );            \
+    double* _ELEMS = c_elements_alloc( slots ); \
     PTR_2SVADDR( _ELEMS, sv_name )
 
 #define BLESS_STRUCT( x, sv_name, class_name ) \
@@ -0,0 +1,66 @@
+#ifndef __ANORMAN_RASTER_H__
+#define __ANORMAN_RASTER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* RGBA image, 4 bytes a pixel, row by row */
+struct raster_struct
+{
+    size_t   width;
+    size_t   height;
+    uint8_t* pixels;
+};
+
+typedef struct raster_struct Raster;
+
+Raster* c_raster_alloc( size_t, size_t );
+void c_raster_free( Raster* );
+
+/* Background of a rows x columns height map in [0, 1]. Each height is
+   zoomed by bilinear interpolation to zoom x zoom pixels and coloured
+   from an n colour RGB palette, entry (int) (height * n). When tiled,
+   the map is a toroid: interpolation wraps around and the image is
+   drawn 2 x 2 times. The raster must be (tiled ? 2 : 1) * zoom times
+   the size of the map */
+int c_raster_background( Raster*, const double*, size_t, size_t, size_t, int, const uint8_t*, size_t );
+
+/* Glyphs of n points at (rows[i], columns[i]) of a rows x columns map,
+   coloured from an RGB palette by classes[i]. A glyph is a size x size
+   square at the zoomed position, or a filled ellipse centred on it, and
+   is drawn in all four tiles when tiled. Later points cover earlier */
+struct raster_glyphs_struct
+{
+    size_t          n;
+    const uint32_t* rows;
+    const uint32_t* columns;
+    const uint32_t* classes;
+    const uint8_t*  palette;
+    size_t          colors;
+
+    size_t          map_rows;
+    size_t          map_columns;
+    size_t          zoom;
+    size_t          size;
+    int             circle;
+    int             tiled;
+};
+
+typedef struct raster_glyphs_struct RasterGlyphs;
+
+int c_raster_glyphs( Raster*, const RasterGlyphs* );
+
+/* PNG file of the raster at zlib level 0-9. The buffer is malloc'ed.
+   Returns C_SUCCESS, or C_EFAULT if zlib fails */
+int c_raster_png( const Raster*, int, uint8_t**, size_t* );
+
+/* parts of a PNG file: the compressed image data (malloc'ed, as for
+   c_raster_png), the 13 bytes of the header chunk, the file signature
+   and big-endian integers */
+int c_raster_deflate( const Raster*, int, uint8_t**, size_t* );
+void c_raster_ihdr( const Raster*, uint8_t* );
+void c_raster_be32( uint8_t*, uint32_t );
+
+extern const uint8_t c_raster_signature[ 8 ];
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __ANORMAN_RNG_H__
+#define __ANORMAN_RNG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "data.h"
+
+/* elements drawn from one substream by the block fills. Each block is
+   independent, so fills are reproducible for any number of threads */
+#define C_RNG_BLOCK 4096
+
+/* Philox4x32-10 stream. The key is the seed, the counter holds the block
+   position, a substream and a 64 bit stream id */
+struct rng_struct
+{
+    uint32_t key[2];
+    uint32_t ctr[4];
+    uint32_t buf[4];
+    int      have;
+};
+
+typedef struct rng_struct Rng;
+
+void c_rng_init( Rng*, uint64_t, uint64_t );
+void c_rng_substream( Rng*, uint32_t );
+
+uint32_t c_rng_next_u32( Rng* );
+uint64_t c_rng_next_u64( Rng* );
+
+/* [0,1) with 53 random bits */
+double c_rng_uniform( Rng* );
+
+/* unbiased integer in [0,n) */
+uint32_t c_rng_bounded( Rng*, uint32_t );
+
+/* standard normal, Ziggurat method */
+double c_rng_gaussian( Rng* );
+
+/* fill a vector (or a row / column view) in place */
+int c_rng_fill_uniform( Vector*, double, double, uint64_t, uint64_t );
+int c_rng_fill_gaussian( Vector*, double, double, uint64_t, uint64_t );
+
+/* Fisher-Yates on an array of indexes */
+void c_rng_shuffle_u32( uint32_t*, size_t, uint64_t, uint64_t );
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __ANORMAN_SPARSE_H__
+#define __ANORMAN_SPARSE_H__
+
+#include <stddef.h>
+#include "data.h"
+
+/* Sparse vectors and matrices keep their non-zero cells in the hash_map
+   of an ordinary Vector / Matrix struct (elements is NULL). Matrix cells
+   are keyed by i * columns + j */
+
+Vector* c_sv_alloc( size_t );
+Matrix* c_sm_alloc( size_t, size_t );
+
+double c_sv_get( Vector*, size_t );
+int c_sv_set( Vector*, size_t, double );
+double c_sm_get( Matrix*, size_t, size_t );
+int c_sm_set( Matrix*, size_t, size_t, double );
+
+/* sparse . sparse, sparse . dense */
+double c_sv_dot_sparse( Vector*, Vector* );
+double c_sv_dot_dense( Vector*, Vector* );
+double c_sv_norm2( Vector* );
+double c_sv_sqdist_dense( Vector*, Vector*, double );
+void c_sv_to_dense( Vector*, Vector* );
+
+/* compressed sparse rows */
+CSRMatrix* c_csr_alloc( size_t, size_t, size_t );
+void c_csr_free( CSRMatrix* );
+CSRMatrix* c_csr_from_sparse( Matrix* );
+CSRMatrix* c_csr_from_maps( IntDoubleMap**, size_t, size_t );
+double c_csr_get( CSRMatrix*, size_t, size_t );
+
+double c_csr_row_dot( CSRMatrix*, size_t, Vector* );
+double c_csr_row_norm2( CSRMatrix*, size_t );
+double c_csr_row_sqdist( CSRMatrix*, size_t, Vector*, double );
+void c_csr_row_to_dense( CSRMatrix*, size_t, Vector* );
+void c_csr_row_axpy( CSRMatrix*, size_t, double, Vector* );
+
+/* column minima, maxima, means and sample variances, the implicit zeros
+   included, from the non-zeros alone */
+int c_csr_column_stats( CSRMatrix*, double*, double*, double*, double* );
+
+/* squared row norms of a dense matrix, for the distance kernels */
+void c_m_row_norms2( Matrix*, double* );
+
+/* nearest row of a dense (weight) matrix to every sparse row */
+size_t c_csr_row_bestmatch( CSRMatrix*, size_t, Matrix*, const double*, double* );
+int c_csr_bestmatches( CSRMatrix*, Matrix*, size_t*, double* );
+
+#endif
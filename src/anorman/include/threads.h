@@ -0,0 +1,13 @@
+#ifndef __ANORMAN_THREADS_H__
+#define __ANORMAN_THREADS_H__
+
+#include <stddef.h>
+
+/* a worker processes the half-open range [begin, end) of a job */
+typedef void ( *range_func ) ( size_t begin, size_t end, void* arg );
+
+size_t c_num_threads( void );
+int c_parallel_for( size_t n, size_t min_chunk, range_func f, void* arg );
+double* c_thread_scratch( size_t n );
+
+#endif
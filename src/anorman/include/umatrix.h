@@ -0,0 +1,36 @@
+#ifndef __ANORMAN_UMATRIX_H__
+#define __ANORMAN_UMATRIX_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* U-matrix of a rows x columns grid of neurons, the mean Euclidean
+ * distance of every neuron to its 4 immediate neighbours, kept up to
+ * date between epochs. Distances are stored per edge and only edges
+ * of neurons whose weights changed since the last update are measured
+ * again. Planar grids leave out neighbours beyond the edge */
+struct umatrix_struct
+{
+    size_t   rows;
+    size_t   columns;
+    size_t   dim;
+    int      toroid;
+
+    double*  last;       /* weights at the last update */
+    double*  right;      /* distance to the right neighbour */
+    double*  down;       /* distance to the neighbour below */
+    uint8_t* changed;
+    int      primed;
+};
+
+typedef struct umatrix_struct UMatrix;
+
+/* rows, columns, dim and toroid */
+UMatrix* c_umx_alloc( size_t, size_t, size_t, int );
+void c_umx_free( UMatrix* );
+
+/* heights from weights with one neuron a row (row stride given),
+   scaled to [0, 1]. Returns the number of neurons that changed */
+size_t c_umx_update( UMatrix*, const double*, size_t, double* );
+
+#endif
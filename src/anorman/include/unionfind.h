@@ -0,0 +1,46 @@
+#ifndef __ANORMAN_UNIONFIND_H__
+#define __ANORMAN_UNIONFIND_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* disjoint sets over the dense ids 0 .. size-1 */
+struct union_find_struct
+{
+    size_t    size;
+    size_t    capacity;
+    uint32_t* parent;
+    uint32_t* sizes;        /* set size, valid at roots */
+    size_t    n_sets;
+};
+
+typedef struct union_find_struct UnionFind;
+
+UnionFind* c_uf_alloc( size_t );
+void c_uf_free( UnionFind* );
+
+/* add singletons up to the new size */
+int c_uf_resize( UnionFind*, size_t );
+
+/* path halving and union by size. Returns 1 if two sets were merged */
+uint32_t c_uf_find( UnionFind*, uint32_t );
+int c_uf_union( UnionFind*, uint32_t, uint32_t );
+size_t c_uf_set_size( UnionFind*, uint32_t );
+
+/* unite src[i] and dst[i] for all i. Returns the number of merges */
+size_t c_uf_union_edges( UnionFind*, const uint32_t*, const uint32_t*, size_t );
+
+/* safe to call from several threads at once. Roots are always the
+   smallest id of their set, unless sequential unions were mixed in.
+   Set sizes are not kept up to date */
+uint32_t c_uf_find_atomic( UnionFind*, uint32_t );
+int c_uf_union_atomic( UnionFind*, uint32_t, uint32_t );
+
+/* unite src[i] and dst[i] for every i with active[i] set (or all when
+   active is NULL), in parallel. Set sizes and counts are redone after */
+int c_uf_union_edges_atomic( UnionFind*, const uint32_t*, const uint32_t*, const uint8_t*, size_t );
+
+/* recompute set sizes and the number of sets */
+void c_uf_recount( UnionFind* );
+
+#endif
@@ -18,6 +18,7 @@ int c_v_scale ( Vector* a, const double );
 
 int c_vv_copy ( Vector* , Vector* );
 int c_vv_swap ( Vector* , Vector* );
+int c_vv_overlap ( Vector* , Vector* );
 
 double c_v_sum( Vector* );
 double c_vv_dot_product ( Vector* a, Vector* b, size_t from, size_t length );
@@ -0,0 +1,727 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "error.h"
+#include "intern.h"
+#include "clustermap.h"
+
+/* Sequence cluster maps.
+ *
+ * The input is memory mapped and scanned line by line without copying;
+ * fields are spans of the mapping, and only labels and cluster names
+ * are kept, interned. Everything else is a flat column by label id or
+ * by cluster id, so a map of 10^8 reads takes a few bytes per read plus
+ * the label text
+ */
+
+ClusterMap*
+c_cm_alloc( void ) {
+    ClusterMap* cm = (ClusterMap*) calloc( 1, sizeof(ClusterMap) );
+
+    if (cm == NULL) {
+        C_ERROR_NULL("Failed to allocate cluster map", C_ENOMEM);
+    }
+
+    cm->labels = c_intern_alloc( 1 << 16 );
+    cm->names  = c_intern_alloc( 1024 );
+
+    if (cm->labels == NULL || cm->names == NULL) {
+        c_cm_free( cm );
+        C_ERROR_NULL("Failed to allocate cluster map", C_ENOMEM);
+    }
+
+    return cm;
+}
+
+void
+c_cm_free( ClusterMap* cm ) {
+    if (cm == NULL) {
+        return;
+    }
+
+    c_intern_free( cm->labels );
+    c_intern_free( cm->names );
+    c_intern_free( cm->samples );
+
+    free( cm->member_cluster );
+    free( cm->member_pctid );
+    free( cm->member_sample );
+    free( cm->sample_count );
+    free( cm->sample_include );
+
+    free( cm->seed );
+    free( cm->seed_len );
+    free( cm->size );
+    free( cm->pctid_avg );
+    free( cm->libflag );
+    free( cm->active );
+    free( cm->order );
+
+    free( cm->ptr );
+    free( cm->members );
+
+    free( cm );
+}
+
+size_t
+c_cm_clusters( ClusterMap* cm ) {
+    return c_intern_size( cm->names );
+}
+
+size_t
+c_cm_labels( ClusterMap* cm ) {
+    return c_intern_size( cm->labels );
+}
+
+#define C_CM_GROW( ptr, type, n )                                  \
+    do {                                                           \
+        type* _p = (type*) realloc( (ptr), (n) * sizeof(type) );   \
+        if (_p == NULL) {                                          \
+            C_ERROR_VAL("Failed to grow cluster map", C_ENOMEM, -1); \
+        }                                                          \
+        (ptr) = _p;                                                \
+    } while (0)
+
+/* id of a label, with its columns in place */
+static int64_t
+c_cm_label( ClusterMap* cm, const char* s, size_t len ) {
+    const size_t  before = c_intern_size( cm->labels );
+    const int64_t id     = c_intern_add( cm->labels, s, len );
+
+    if (id < 0) {
+        return -1;
+    }
+
+    if ((size_t) id >= cm->member_capacity) {
+        const size_t capacity = cm->member_capacity ? cm->member_capacity * 2 : 1 << 16;
+
+        C_CM_GROW( cm->member_cluster, int64_t, capacity );
+        C_CM_GROW( cm->member_pctid,   float,   capacity );
+
+        cm->member_capacity = capacity;
+    }
+
+    if (c_intern_size( cm->labels ) > before) {
+        cm->member_cluster[ id ] = -1;
+        cm->member_pctid[ id ]   = NAN;
+    }
+
+    return id;
+}
+
+/* id of a cluster by name, created with empty columns. fresh is set
+   for new clusters */
+static int64_t
+c_cm_cluster( ClusterMap* cm, const char* s, size_t len, int* fresh ) {
+    const size_t  before = c_intern_size( cm->names );
+    const int64_t id     = c_intern_add( cm->names, s, len );
+
+    if (id < 0) {
+        return -1;
+    }
+
+    if ((size_t) id >= cm->cluster_capacity) {
+        const size_t capacity = cm->cluster_capacity ? cm->cluster_capacity * 2 : 1024;
+
+        C_CM_GROW( cm->seed,      int64_t,  capacity );
+        C_CM_GROW( cm->seed_len,  uint32_t, capacity );
+        C_CM_GROW( cm->size,      uint32_t, capacity );
+        C_CM_GROW( cm->pctid_avg, double,   capacity );
+        C_CM_GROW( cm->libflag,   uint8_t,  capacity );
+        C_CM_GROW( cm->active,    uint8_t,  capacity );
+        C_CM_GROW( cm->order,     uint32_t, capacity );
+
+        cm->cluster_capacity = capacity;
+    }
+
+    *fresh = c_intern_size( cm->names ) > before;
+
+    if (*fresh) {
+        cm->seed[ id ]      = -1;
+        cm->seed_len[ id ]  = 0;
+        cm->size[ id ]      = 0;
+        cm->pctid_avg[ id ] = NAN;
+        cm->libflag[ id ]   = 0;
+        cm->active[ id ]    = 1;
+    }
+
+    return id;
+}
+
+static const char*
+c_cm_map( const char* path, size_t* len ) {
+    const int fd = open( path, O_RDONLY );
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+
+    if (fstat( fd, &st ) != 0) {
+        close( fd );
+        return NULL;
+    }
+
+    *len = (size_t) st.st_size;
+
+    if (*len == 0) {
+        close( fd );
+        return "";
+    }
+
+    void* p = mmap( NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+
+    madvise( p, *len, MADV_SEQUENTIAL );
+
+    return (const char*) p;
+}
+
+static void
+c_cm_unmap( const char* p, size_t len ) {
+    if (len) {
+        munmap( (void*) p, len );
+    }
+}
+
+/* a number from a field span; '*' and empty fields are NAN */
+static double
+c_cm_number( const char* s, size_t len ) {
+    char buf[ 64 ];
+
+    if (len == 0 || len >= sizeof(buf) || (len == 1 && s[0] == '*')) {
+        return NAN;
+    }
+
+    memcpy( buf, s, len );
+    buf[ len ] = '\0';
+
+    return strtod( buf, NULL );
+}
+
+/* split a line span on tabs into at most max spans */
+static size_t
+c_cm_fields( const char* p, const char* end, const char** field, size_t* len, size_t max ) {
+    size_t n = 0;
+
+    while (n < max) {
+        const char* tab = (const char*) memchr( p, '\t', (size_t) (end - p) );
+
+        field[ n ] = p;
+
+        if (tab == NULL) {
+            len[ n++ ] = (size_t) (end - p);
+            break;
+        }
+
+        len[ n++ ] = (size_t) (tab - p);
+        p = tab + 1;
+    }
+
+    return n;
+}
+
+/* one .uc record. -1 out of memory, -2 malformed */
+static int
+c_cm_uc_record( ClusterMap* cm, const char* p, const char* end ) {
+    const char* field[ 10 ];
+    size_t      len[ 10 ];
+
+    if (c_cm_fields( p, end, field, len, 10 ) < 9) {
+        return -2;
+    }
+
+    const char type = p[0];
+
+    /* '*' is no cluster, as for unmatched queries */
+    int64_t c = -1;
+    int     fresh;
+
+    if (!(len[1] == 1 && field[1][0] == '*')) {
+        if ((c = c_cm_cluster( cm, field[1], len[1], &fresh )) < 0) {
+            return -1;
+        }
+    }
+
+    if (type == 'C' || type == 'D') {
+        /* the average identity is in the alignment column for D */
+        if (c >= 0) {
+            cm->pctid_avg[ c ] = type == 'C' ? c_cm_number( field[3], len[3] ) : c_cm_number( field[7], len[7] );
+        }
+
+        return C_SUCCESS;
+    }
+
+    const int64_t l = c_cm_label( cm, field[8], len[8] );
+
+    if (l < 0) {
+        return -1;
+    }
+
+    switch (type) {
+        case 'S':
+        case 'L':
+            if (c < 0) {
+                return -2;
+            }
+
+            if (cm->seed[ c ] < 0) {
+                cm->order[ cm->n_order++ ] = (uint32_t) c;
+            }
+
+            cm->seed[ c ]     = l;
+            cm->seed_len[ c ] = (uint32_t) c_cm_number( field[2], len[2] );
+
+            if (type == 'L') {
+                cm->libflag[ c ] = 1;
+                return C_SUCCESS;
+            }
+
+            cm->size[ c ]++;
+            cm->member_cluster[ l ] = c;
+            break;
+
+        default:
+            /* H, N and R */
+            if (c >= 0) {
+                cm->size[ c ]++;
+            }
+
+            cm->member_cluster[ l ] = c;
+            cm->member_pctid[ l ]   = (float) c_cm_number( field[3], len[3] );
+    }
+
+    return C_SUCCESS;
+}
+
+int64_t
+c_cm_load_uc( ClusterMap* cm, const char* path ) {
+    size_t      size;
+    const char* map = c_cm_map( path, &size );
+
+    if (map == NULL) {
+        return -1;
+    }
+
+    const char* p   = map;
+    const char* end = map + size;
+    int64_t     n   = 0;
+
+    while (p < end) {
+        const char* eol = (const char*) memchr( p, '\n', (size_t) (end - p) );
+        const char* e   = eol ? eol : end;
+
+        if (e > p && e[-1] == '\r') {
+            e--;
+        }
+
+        /* records start with their type and white space */
+        if (e - p > 1 && strchr( "LSHRDCN", p[0] ) && (p[1] == '\t' || p[1] == ' ')) {
+            const int status = c_cm_uc_record( cm, p, e );
+
+            if (status < 0) {
+                c_cm_unmap( map, size );
+                return status;
+            }
+
+            n++;
+        }
+
+        p = eol ? eol + 1 : end;
+    }
+
+    c_cm_unmap( map, size );
+    cm->built = 0;
+
+    return n;
+}
+
+/* OTU <tab> label <tab> label ... */
+int64_t
+c_cm_load_otu_map( ClusterMap* cm, const char* path ) {
+    size_t      size;
+    const char* map = c_cm_map( path, &size );
+
+    if (map == NULL) {
+        return -1;
+    }
+
+    const char* p   = map;
+    const char* end = map + size;
+    int64_t     n   = 0;
+
+    while (p < end) {
+        const char* eol = (const char*) memchr( p, '\n', (size_t) (end - p) );
+        const char* e   = eol ? eol : end;
+        const char* tab = (const char*) memchr( p, '\t', (size_t) (e - p) );
+
+        if (e > p && e[-1] == '\r') {
+            e--;
+        }
+
+        /* numbered OTUs with at least one member */
+        const char* q = p;
+        while (q < e && *q >= '0' && *q <= '9') q++;
+
+        if (tab && q == tab && q > p && tab + 1 < e) {
+            int           fresh;
+            const int64_t c = c_cm_cluster( cm, p, (size_t) (tab - p), &fresh );
+
+            if (c < 0) {
+                c_cm_unmap( map, size );
+                return -1;
+            }
+
+            if (fresh) {
+                cm->order[ cm->n_order++ ] = (uint32_t) c;
+            }
+
+            const char* s = tab + 1;
+
+            while (s < e) {
+                const char* t = (const char*) memchr( s, '\t', (size_t) (e - s) );
+                const char* f = t ? t : e;
+
+                if (f > s) {
+                    const int64_t l = c_cm_label( cm, s, (size_t) (f - s) );
+
+                    if (l < 0) {
+                        c_cm_unmap( map, size );
+                        return -1;
+                    }
+
+                    cm->member_cluster[ l ] = c;
+                    cm->size[ c ]++;
+                }
+
+                s = f + 1;
+            }
+
+            n++;
+        }
+
+        p = eol ? eol + 1 : end;
+    }
+
+    c_cm_unmap( map, size );
+    cm->built = 0;
+
+    return n;
+}
+
+int
+c_cm_build( ClusterMap* cm ) {
+    if (cm->built) {
+        return C_SUCCESS;
+    }
+
+    const size_t K = c_cm_clusters( cm );
+    const size_t L = c_cm_labels( cm );
+
+    free( cm->ptr );
+    free( cm->members );
+
+    cm->ptr     = (size_t*)   calloc( K + 1, sizeof(size_t) );
+    cm->members = (uint32_t*) malloc( (L ? L : 1) * sizeof(uint32_t) );
+
+    if (cm->ptr == NULL || cm->members == NULL) {
+        C_ERROR("Failed to build cluster members", C_ENOMEM);
+    }
+
+    size_t l, c;
+    for (l = 0; l < L; l++) {
+        if (cm->member_cluster[ l ] >= 0) {
+            cm->ptr[ cm->member_cluster[ l ] + 1 ]++;
+        }
+    }
+
+    for (c = 0; c < K; c++) {
+        cm->ptr[ c + 1 ] += cm->ptr[ c ];
+    }
+
+    for (l = 0; l < L; l++) {
+        if (cm->member_cluster[ l ] >= 0) {
+            cm->members[ cm->ptr[ cm->member_cluster[ l ] ]++ ] = (uint32_t) l;
+        }
+    }
+
+    for (c = K; c > 0; c--) {
+        cm->ptr[ c ] = cm->ptr[ c - 1 ];
+    }
+
+    cm->ptr[ 0 ] = 0;
+    cm->built    = 1;
+
+    return C_SUCCESS;
+}
+
+double
+c_cm_value( ClusterMap* cm, size_t c, int column ) {
+    size_t len = 0;
+
+    switch (column) {
+        case C_CM_NUM:     return c_cm_number( c_intern_name( cm->names, c, &len ), len );
+        case C_CM_SIZE:    return (double) cm->size[ c ];
+        case C_CM_SEEDLEN: return (double) cm->seed_len[ c ];
+        default:           return cm->pctid_avg[ c ];
+    }
+}
+
+/* mean identity of the members to their seed */
+double
+c_cm_mean_pctid( ClusterMap* cm, size_t c ) {
+    if (c_cm_build( cm ) != C_SUCCESS) {
+        return NAN;
+    }
+
+    double sum = 0.0;
+    size_t n   = 0;
+
+    size_t i;
+    for (i = cm->ptr[ c ]; i < cm->ptr[ c + 1 ]; i++) {
+        const float v = cm->member_pctid[ cm->members[ i ] ];
+
+        if (!isnan( v )) {
+            sum += v;
+            n++;
+        }
+    }
+
+    return n ? sum / (double) n : NAN;
+}
+
+struct cm_key_struct
+{
+    double   v;
+    uint32_t id;
+};
+
+typedef struct cm_key_struct CMKey;
+
+/* ascending, NAN last, ties by id */
+static int
+c_cm_cmp_key( const void* a, const void* b ) {
+    const CMKey* x = (const CMKey*) a;
+    const CMKey* y = (const CMKey*) b;
+
+    if (isnan( x->v ) || isnan( y->v )) {
+        if (!isnan( x->v )) return -1;
+        if (!isnan( y->v )) return 1;
+    } else if (x->v != y->v) {
+        return x->v < y->v ? -1 : 1;
+    }
+
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+size_t
+c_cm_sort( ClusterMap* cm, int column, int reverse, uint32_t* out ) {
+    const size_t K = c_cm_clusters( cm );
+
+    CMKey* key = (CMKey*) malloc( (K ? K : 1) * sizeof(CMKey) );
+
+    if (key == NULL) {
+        C_ERROR_VAL("Failed to sort clusters", C_ENOMEM, 0);
+    }
+
+    size_t c, n = 0;
+    for (c = 0; c < K; c++) {
+        if (cm->active[ c ]) {
+            const double v = c_cm_value( cm, c, column );
+
+            key[ n ].v  = reverse ? -v : v;
+            key[ n ].id = (uint32_t) c;
+            n++;
+        }
+    }
+
+    qsort( key, n, sizeof(CMKey), &c_cm_cmp_key );
+
+    for (c = 0; c < n; c++) {
+        out[ c ] = key[ c ].id;
+    }
+
+    free( key );
+
+    return n;
+}
+
+size_t
+c_cm_prune( ClusterMap* cm, int column, double min ) {
+    const size_t K = c_cm_clusters( cm );
+    size_t       n = 0;
+
+    size_t c;
+    for (c = 0; c < K; c++) {
+        if (cm->active[ c ] && c_cm_value( cm, c, column ) < min) {
+            cm->active[ c ] = 0;
+            n++;
+        }
+    }
+
+    return n;
+}
+
+int
+c_cm_samples( ClusterMap* cm, const char* delim, size_t delim_len ) {
+    const size_t L = c_cm_labels( cm );
+
+    c_intern_free( cm->samples );
+    free( cm->member_sample );
+    free( cm->sample_count );
+    free( cm->sample_include );
+
+    cm->sample_count   = NULL;
+    cm->sample_include = NULL;
+
+    cm->samples       = c_intern_alloc( 64 );
+    cm->member_sample = (uint32_t*) malloc( (L ? L : 1) * sizeof(uint32_t) );
+
+    if (cm->samples == NULL || cm->member_sample == NULL) {
+        C_ERROR("Failed to allocate samples", C_ENOMEM);
+    }
+
+    size_t l;
+    for (l = 0; l < L; l++) {
+        size_t      len = 0;
+        const char* s = c_intern_name( cm->labels, l, &len );
+        const char* d = NULL;
+
+        size_t i;
+        for (i = 0; delim_len && i + delim_len <= len; i++) {
+            if (s[i] == delim[0] && memcmp( s + i, delim, delim_len ) == 0) {
+                d = s + i;
+                break;
+            }
+        }
+
+        const int64_t id = c_intern_add( cm->samples, s, d ? (size_t) (d - s) : len );
+
+        if (id < 0) {
+            return C_ENOMEM;
+        }
+
+        cm->member_sample[ l ] = (uint32_t) id;
+    }
+
+    return C_SUCCESS;
+}
+
+/* library seeds are only seeds, and never counted */
+static inline int64_t
+c_cm_counted( ClusterMap* cm, size_t l ) {
+    const int64_t c = cm->member_cluster[ l ];
+
+    if (c < 0 || !cm->active[ c ] || (cm->libflag[ c ] && cm->seed[ c ] == (int64_t) l)) {
+        return -1;
+    }
+
+    return c;
+}
+
+int
+c_cm_count_samples( ClusterMap* cm, const uint8_t* include ) {
+    if (cm->member_sample == NULL) {
+        C_ERROR("No samples assigned", C_EINVAL);
+    }
+
+    const size_t K = c_cm_clusters( cm );
+    const size_t L = c_cm_labels( cm );
+    const size_t S = c_intern_size( cm->samples );
+
+    free( cm->sample_count );
+    free( cm->sample_include );
+
+    cm->sample_count   = (uint32_t*) calloc( K * S + 1, sizeof(uint32_t) );
+    cm->sample_include = (uint8_t*)  malloc( S + 1 );
+
+    if (cm->sample_count == NULL || cm->sample_include == NULL) {
+        C_ERROR("Failed to allocate sample counts", C_ENOMEM);
+    }
+
+    if (include) {
+        memcpy( cm->sample_include, include, S );
+    } else {
+        memset( cm->sample_include, 1, S );
+    }
+
+    uint32_t* out = cm->sample_count;
+
+    size_t l;
+    for (l = 0; l < L; l++) {
+        const int64_t  c = c_cm_counted( cm, l );
+        const uint32_t s = cm->member_sample[ l ];
+
+        if (c >= 0 && cm->sample_include[ s ]) {
+            out[ (size_t) c * S + s ]++;
+        }
+    }
+
+    return C_SUCCESS;
+}
+
+int64_t
+c_cm_rarefy( ClusterMap* cm, uint32_t min_size, const uint32_t* order, size_t n, size_t step, uint64_t* out ) {
+    if (cm->member_sample == NULL || step == 0) {
+        C_ERROR_VAL("No samples assigned", C_EINVAL, -1);
+    }
+
+    const size_t K     = c_cm_clusters( cm );
+    const size_t S     = c_intern_size( cm->samples );
+    const size_t words = (K + 63) / 64;
+
+    uint64_t* seen   = (uint64_t*) calloc( S * words + 1, sizeof(uint64_t) );
+    uint64_t* counts = (uint64_t*) calloc( 2 * S + 1, sizeof(uint64_t) );
+
+    if (seen == NULL || counts == NULL) {
+        free( seen );
+        free( counts );
+        C_ERROR_VAL("Failed to allocate rarefaction", C_ENOMEM, -1);
+    }
+
+    int64_t rows  = 0;
+    size_t  taken = 0;
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const int64_t c = c_cm_counted( cm, order[ i ] );
+
+        if (c < 0 || cm->size[ c ] < min_size) {
+            continue;
+        }
+
+        const uint32_t s    = cm->member_sample[ order[ i ] ];
+        uint64_t*      bits = seen + s * words;
+
+        counts[ 2 * s ]++;
+
+        if (!(bits[ c >> 6 ] & (1ULL << (c & 63)))) {
+            bits[ c >> 6 ] |= 1ULL << (c & 63);
+            counts[ 2 * s + 1 ]++;
+        }
+
+        if (++taken % step == 0) {
+            uint64_t* row = out + (size_t) rows * (2 * S + 1);
+
+            row[ 0 ] = taken;
+            memcpy( row + 1, counts, 2 * S * sizeof(uint64_t) );
+            rows++;
+        }
+    }
+
+    free( seen );
+    free( counts );
+
+    return rows;
+}
@@ -0,0 +1,335 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dna.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define C_DNA_X86 1
+#include <immintrin.h>
+#endif
+
+/* Nucleotide kernels.
+ *
+ * Characters are classified by their two nibbles: every class is a
+ * set of high nibbles times a set of low nibbles, so the class bits of
+ * a byte are c_nt_lo[ c & 15 ] & c_nt_hi[ c >> 4 ]. The same pair of
+ * 16 entry tables drives the scalar loops and the byte shuffles of the
+ * SSSE3 and AVX2 kernels, which are picked at run time as for gemm
+ */
+
+#define C_NT_BIT_A    0x01
+#define C_NT_BIT_C    0x02
+#define C_NT_BIT_G    0x04
+#define C_NT_BIT_T    0x08
+#define C_NT_BIT_N    0x10
+#define C_NT_BIT_B    0x20    /* B D H K M */
+#define C_NT_BIT_R    0x40    /* R S V W Y */
+#define C_NT_BIT_GAP  0x80    /* . - */
+
+static const uint8_t c_nt_lo[ 16 ] = {
+    0x00, 0x01, 0x60, 0x42, 0x28, 0x00, 0x40, 0x44,
+    0x20, 0x40, 0x00, 0x20, 0x00, 0xA0, 0x90, 0x00
+};
+
+static const uint8_t c_nt_hi[ 16 ] = {
+    0x00, 0x00, 0x80, 0x00, 0x37, 0x48, 0x37, 0x48,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* 2-bit code by low nibble, and the upper case base of each code */
+static const uint8_t c_nt_code[ 16 ] = {
+    0, 3, 0, 1, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static const uint8_t c_nt_base[ 16 ] = {
+    'T', 'C', 'G', 'A', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static inline uint8_t
+c_dna_class( uint8_t c ) {
+    return c_nt_lo[ c & 15 ] & c_nt_hi[ c >> 4 ];
+}
+
+static inline uint8_t
+c_dna_code( uint8_t c ) {
+    const uint8_t code = c_nt_code[ c & 15 ];
+    return (c & 0xDF) == c_nt_base[ code ] ? code : 0;
+}
+
+/* counts of A C G T N and of unclassified bytes; IUPAC is the rest */
+static void
+c_dna_composition_generic( const uint8_t* s, size_t n, uint64_t* counts ) {
+    uint64_t k[ 6 ] = { 0, 0, 0, 0, 0, 0 };
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const uint8_t bits = c_dna_class( s[i] );
+
+        k[0] += (bits & C_NT_BIT_A) != 0;
+        k[1] += (bits & C_NT_BIT_C) != 0;
+        k[2] += (bits & C_NT_BIT_G) != 0;
+        k[3] += (bits & C_NT_BIT_T) != 0;
+        k[4] += (bits & C_NT_BIT_N) != 0;
+        k[5] += bits == 0;
+    }
+
+    for (i = 0; i < 6; i++) {
+        counts[i] += k[i];
+    }
+}
+
+#ifdef C_DNA_X86
+
+/* byte counters are flushed before they can wrap */
+#define C_DNA_FLUSH 255
+
+__attribute__((target("ssse3")))
+static size_t
+c_dna_composition_ssse3( const uint8_t* s, size_t n, uint64_t* counts ) {
+    const __m128i lo   = _mm_loadu_si128( (const __m128i*) c_nt_lo );
+    const __m128i hi   = _mm_loadu_si128( (const __m128i*) c_nt_hi );
+    const __m128i mask = _mm_set1_epi8( 0x0F );
+    const __m128i zero = _mm_setzero_si128();
+
+    const __m128i bit[ 5 ] = {
+        _mm_set1_epi8( C_NT_BIT_A ), _mm_set1_epi8( C_NT_BIT_C ), _mm_set1_epi8( C_NT_BIT_G ),
+        _mm_set1_epi8( C_NT_BIT_T ), _mm_set1_epi8( C_NT_BIT_N )
+    };
+
+    size_t i = 0;
+
+    while (i + 16 <= n) {
+        __m128i acc[ 6 ];
+        int     j, r;
+
+        for (j = 0; j < 6; j++) {
+            acc[j] = zero;
+        }
+
+        for (r = 0; r < C_DNA_FLUSH && i + 16 <= n; r++, i += 16) {
+            const __m128i v    = _mm_loadu_si128( (const __m128i*) (s + i) );
+            const __m128i bits = _mm_and_si128( _mm_shuffle_epi8( lo, _mm_and_si128( v, mask ) ),
+                                                _mm_shuffle_epi8( hi, _mm_and_si128( _mm_srli_epi16( v, 4 ), mask ) ) );
+
+            /* matches are -1 */
+            for (j = 0; j < 5; j++) {
+                acc[j] = _mm_sub_epi8( acc[j], _mm_cmpeq_epi8( _mm_and_si128( bits, bit[j] ), bit[j] ) );
+            }
+
+            acc[5] = _mm_sub_epi8( acc[5], _mm_cmpeq_epi8( bits, zero ) );
+        }
+
+        for (j = 0; j < 6; j++) {
+            const __m128i sum = _mm_sad_epu8( acc[j], zero );
+            counts[j] += (uint64_t) _mm_cvtsi128_si64( sum ) + (uint64_t) _mm_extract_epi16( sum, 4 );
+        }
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t
+c_dna_composition_avx2( const uint8_t* s, size_t n, uint64_t* counts ) {
+    const __m256i lo   = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*) c_nt_lo ) );
+    const __m256i hi   = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*) c_nt_hi ) );
+    const __m256i mask = _mm256_set1_epi8( 0x0F );
+    const __m256i zero = _mm256_setzero_si256();
+
+    const __m256i bit[ 5 ] = {
+        _mm256_set1_epi8( C_NT_BIT_A ), _mm256_set1_epi8( C_NT_BIT_C ), _mm256_set1_epi8( C_NT_BIT_G ),
+        _mm256_set1_epi8( C_NT_BIT_T ), _mm256_set1_epi8( C_NT_BIT_N )
+    };
+
+    size_t i = 0;
+
+    while (i + 32 <= n) {
+        __m256i acc[ 6 ];
+        int     j, r;
+
+        for (j = 0; j < 6; j++) {
+            acc[j] = zero;
+        }
+
+        for (r = 0; r < C_DNA_FLUSH && i + 32 <= n; r++, i += 32) {
+            const __m256i v    = _mm256_loadu_si256( (const __m256i*) (s + i) );
+            const __m256i bits = _mm256_and_si256( _mm256_shuffle_epi8( lo, _mm256_and_si256( v, mask ) ),
+                                                   _mm256_shuffle_epi8( hi, _mm256_and_si256( _mm256_srli_epi16( v, 4 ), mask ) ) );
+
+            for (j = 0; j < 5; j++) {
+                acc[j] = _mm256_sub_epi8( acc[j], _mm256_cmpeq_epi8( _mm256_and_si256( bits, bit[j] ), bit[j] ) );
+            }
+
+            acc[5] = _mm256_sub_epi8( acc[5], _mm256_cmpeq_epi8( bits, zero ) );
+        }
+
+        for (j = 0; j < 6; j++) {
+            const __m256i sum = _mm256_sad_epu8( acc[j], zero );
+
+            counts[j] += (uint64_t) _mm256_extract_epi64( sum, 0 ) + (uint64_t) _mm256_extract_epi64( sum, 1 )
+                       + (uint64_t) _mm256_extract_epi64( sum, 2 ) + (uint64_t) _mm256_extract_epi64( sum, 3 );
+        }
+    }
+
+    return i;
+}
+
+/* 16 bases into 4 bytes */
+__attribute__((target("ssse3")))
+static size_t
+c_dna_pack_ssse3( const uint8_t* s, size_t n, uint8_t* out ) {
+    const __m128i code  = _mm_loadu_si128( (const __m128i*) c_nt_code );
+    const __m128i base  = _mm_loadu_si128( (const __m128i*) c_nt_base );
+    const __m128i mask  = _mm_set1_epi8( 0x0F );
+    const __m128i upper = _mm_set1_epi8( (char) 0xDF );
+    const __m128i w2    = _mm_set1_epi16( 0x0401 );     /* c0 + 4 c1 */
+    const __m128i w4    = _mm_set1_epi32( 0x00100001 ); /* + 16 (c2 + 4 c3) */
+    const __m128i pick  = _mm_setr_epi8( 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128( (const __m128i*) (s + i) );
+        __m128i       c = _mm_shuffle_epi8( code, _mm_and_si128( v, mask ) );
+
+        /* only real ACGT keep their code */
+        c = _mm_and_si128( c, _mm_cmpeq_epi8( _mm_and_si128( v, upper ), _mm_shuffle_epi8( base, c ) ) );
+        c = _mm_madd_epi16( _mm_maddubs_epi16( c, w2 ), w4 );
+
+        const int32_t packed = _mm_cvtsi128_si32( _mm_shuffle_epi8( c, pick ) );
+        memcpy( out + i / 4, &packed, 4 );
+    }
+
+    return i;
+}
+
+#endif
+
+typedef size_t ( *dna_count_kernel ) ( const uint8_t*, size_t, uint64_t* );
+
+static dna_count_kernel c_dna_count_kernel = NULL;
+static int              c_dna_has_ssse3    = -1;
+
+static void
+c_dna_select_kernels( void ) {
+    if (c_dna_has_ssse3 >= 0) {
+        return;
+    }
+
+#ifdef C_DNA_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        c_dna_count_kernel = &c_dna_composition_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        c_dna_count_kernel = &c_dna_composition_ssse3;
+    }
+
+    c_dna_has_ssse3 = __builtin_cpu_supports("ssse3") ? 1 : 0;
+#else
+    c_dna_has_ssse3 = 0;
+#endif
+}
+
+void
+c_dna_composition( const char* seq, size_t n, uint64_t* counts ) {
+    const uint8_t* s = (const uint8_t*) seq;
+    uint64_t       k[ 6 ] = { 0, 0, 0, 0, 0, 0 };
+    size_t         done   = 0;
+
+    c_dna_select_kernels();
+
+    if (c_dna_count_kernel != NULL) {
+        done = c_dna_count_kernel( s, n, k );
+    }
+
+    c_dna_composition_generic( s + done, n - done, k );
+
+    counts[ C_NT_A ]     = k[0];
+    counts[ C_NT_C ]     = k[1];
+    counts[ C_NT_G ]     = k[2];
+    counts[ C_NT_T ]     = k[3];
+    counts[ C_NT_N ]     = k[4];
+    counts[ C_NT_OTHER ] = k[5];
+    counts[ C_NT_IUPAC ] = n - k[0] - k[1] - k[2] - k[3] - k[4] - k[5];
+}
+
+size_t
+c_dna_packed_size( size_t n ) {
+    return (n + 3) / 4;
+}
+
+void
+c_dna_pack_2bit( const char* seq, size_t n, uint8_t* out ) {
+    const uint8_t* s = (const uint8_t*) seq;
+    size_t         i = 0;
+
+    c_dna_select_kernels();
+
+#ifdef C_DNA_X86
+    if (c_dna_has_ssse3) {
+        i = c_dna_pack_ssse3( s, n, out );
+    }
+#endif
+
+    /* the tail, whole bytes of 4 bases first */
+    for (; i + 4 <= n; i += 4) {
+        out[ i / 4 ] = (uint8_t) (c_dna_code( s[i] ) | c_dna_code( s[i + 1] ) << 2 |
+                                  c_dna_code( s[i + 2] ) << 4 | c_dna_code( s[i + 3] ) << 6);
+    }
+
+    if (i < n) {
+        uint8_t b = 0;
+        size_t  k;
+
+        for (k = 0; i + k < n; k++) {
+            b |= (uint8_t) (c_dna_code( s[i + k] ) << (2 * k));
+        }
+
+        out[ i / 4 ] = b;
+    }
+}
+
+void
+c_dna_unpack_2bit( const uint8_t* bits, size_t n, char* out ) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        out[i] = (char) c_nt_base[ (bits[ i / 4 ] >> (2 * (i % 4))) & 3 ];
+    }
+}
+
+/* complement of the 4 bases of a byte, in reverse order: the 2-bit
+   fields are swapped pairwise and then the nibbles */
+static inline uint8_t
+c_dna_revcomp_byte( uint8_t b ) {
+    b = (uint8_t) ~b;
+    b = (uint8_t) (((b & 0x33) << 2) | ((b & 0xCC) >> 2));
+    return (uint8_t) ((b << 4) | (b >> 4));
+}
+
+void
+c_dna_revcomp_2bit( const uint8_t* bits, size_t n, uint8_t* out ) {
+    const size_t bytes = c_dna_packed_size( n );
+
+    if (bytes == 0) {
+        return;
+    }
+
+    size_t i;
+    for (i = 0; i < bytes; i++) {
+        out[i] = c_dna_revcomp_byte( bits[ bytes - 1 - i ] );
+    }
+
+    /* the padding of the last byte came out in front: move the bases
+       down and clear what is left past n */
+    const unsigned shift = (unsigned) (2 * (4 * bytes - n));
+
+    if (shift) {
+        for (i = 0; i + 1 < bytes; i++) {
+            out[i] = (uint8_t) ((out[i] >> shift) | (out[i + 1] << (8 - shift)));
+        }
+
+        out[ bytes - 1 ] = (uint8_t) (out[ bytes - 1 ] >> shift);
+    }
+}
@@ -0,0 +1,367 @@
+#include <stdlib.h>
+
+#include "data.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "contiguous.h"
+#include "expression.h"
+
+/* Fused evaluation of deferred elementwise expressions.
+ *
+ * Data::Expression flattens an expression tree into a postfix program.
+ * The program is run over blocks of C_EXPR_BLOCK elements: every stack
+ * slot holds one block (or a scalar), so each instruction is a short
+ * vectorizable loop and no full-size temporaries are ever allocated.
+ * Unit-stride operands are read in place, others are gathered into the
+ * slot buffer. Matrices are walked row by row, or as one long vector
+ * when every operand is contiguous
+ */
+
+struct expr_slot_struct
+{
+    const double* ptr;
+    double*       buf;
+    double        value;
+    int           scalar;
+};
+
+typedef struct expr_slot_struct ExprSlot;
+
+typedef const double* ( *expr_load )  ( void* operand, size_t seg, size_t from, size_t len, double* buf );
+typedef void          ( *expr_store ) ( void* dst, size_t seg, size_t from, size_t len, const double* src );
+
+static const double*
+c_expr_load_vector( void* operand, size_t seg, size_t from, size_t len, double* buf ) {
+    Vector* v = (Vector*) operand;
+    size_t  i;
+
+    (void) seg;
+
+    if (v->offsets) {
+        for (i = 0; i < len; i++) {
+            buf[ i ] = c_v_get_quick( v, from + i );
+        }
+        return buf;
+    }
+
+    const double* base = v->elements + v->zero + from * v->stride;
+
+    if (v->stride == 1) {
+        return base;
+    }
+
+    for (i = 0; i < len; i++) {
+        buf[ i ] = base[ i * v->stride ];
+    }
+
+    return buf;
+}
+
+static void
+c_expr_store_vector( void* dst, size_t seg, size_t from, size_t len, const double* src ) {
+    Vector* v = (Vector*) dst;
+    size_t  i;
+
+    (void) seg;
+
+    if (v->offsets) {
+        for (i = 0; i < len; i++) {
+            c_v_set_quick( v, from + i, src[ i ] );
+        }
+        return;
+    }
+
+    double* base = v->elements + v->zero + from * v->stride;
+
+    for (i = 0; i < len; i++) {
+        base[ i * v->stride ] = src[ i ];
+    }
+}
+
+static const double*
+c_expr_load_matrix( void* operand, size_t row, size_t from, size_t len, double* buf ) {
+    Matrix* m = (Matrix*) operand;
+    size_t  i;
+
+    if (m->offsets) {
+        for (i = 0; i < len; i++) {
+            buf[ i ] = c_m_get_quick( m, row, from + i );
+        }
+        return buf;
+    }
+
+    const double* base = m->elements + c_m_index( m, row, from );
+
+    if (m->column_stride == 1) {
+        return base;
+    }
+
+    for (i = 0; i < len; i++) {
+        buf[ i ] = base[ i * m->column_stride ];
+    }
+
+    return buf;
+}
+
+static void
+c_expr_store_matrix( void* dst, size_t row, size_t from, size_t len, const double* src ) {
+    Matrix* m = (Matrix*) dst;
+    size_t  i;
+
+    if (m->offsets) {
+        for (i = 0; i < len; i++) {
+            c_m_set_quick( m, row, from + i, src[ i ] );
+        }
+        return;
+    }
+
+    double* base = m->elements + c_m_index( m, row, from );
+
+    for (i = 0; i < len; i++) {
+        base[ i * m->column_stride ] = src[ i ];
+    }
+}
+
+#define C_EXPR_LOOP( sym )                                                   \
+    if (a->scalar) {                                                         \
+        for (i = 0; i < len; i++) out[ i ] = a->value sym b->ptr[ i ];       \
+    } else if (b->scalar) {                                                  \
+        for (i = 0; i < len; i++) out[ i ] = a->ptr[ i ] sym b->value;       \
+    } else {                                                                 \
+        for (i = 0; i < len; i++) out[ i ] = a->ptr[ i ] sym b->ptr[ i ];    \
+    }
+
+/* a <- a op b, the result goes to the buffer of a */
+static void
+c_expr_binary( int op, size_t len, ExprSlot* a, const ExprSlot* b ) {
+    size_t i;
+
+    if (a->scalar && b->scalar) {
+        switch (op) {
+            case C_EXPR_ADD: a->value += b->value; break;
+            case C_EXPR_SUB: a->value -= b->value; break;
+            case C_EXPR_MUL: a->value *= b->value; break;
+            case C_EXPR_DIV: a->value /= b->value; break;
+        }
+        return;
+    }
+
+    double* out = a->buf;
+
+    switch (op) {
+        case C_EXPR_ADD: C_EXPR_LOOP( + ) break;
+        case C_EXPR_SUB: C_EXPR_LOOP( - ) break;
+        case C_EXPR_MUL: C_EXPR_LOOP( * ) break;
+        case C_EXPR_DIV: C_EXPR_LOOP( / ) break;
+    }
+
+    a->ptr    = out;
+    a->scalar = 0;
+}
+
+/* operand and constant indices, stack depth and opcodes are checked
+   once for the whole program, so the block loop runs unchecked */
+static int
+c_expr_check( const ExprInstr* prog, size_t n_instr, size_t n_operands, size_t n_constants ) {
+    if (n_instr == 0) {
+        C_ERROR("Empty expression", C_EINVAL);
+    }
+
+    size_t sp = 0;
+    size_t k;
+
+    for (k = 0; k < n_instr; k++) {
+        switch (prog[ k ].op) {
+            case C_EXPR_LOAD:
+                if (prog[ k ].arg >= n_operands) {
+                    C_ERROR("Expression operand out of range", C_EINVAL);
+                }
+                sp++;
+                break;
+            case C_EXPR_CONST:
+                if (prog[ k ].arg >= n_constants) {
+                    C_ERROR("Expression constant out of range", C_EINVAL);
+                }
+                sp++;
+                break;
+            case C_EXPR_NEG:
+                if (sp < 1) {
+                    C_ERROR("Malformed expression program", C_EINVAL);
+                }
+                break;
+            case C_EXPR_ADD:
+            case C_EXPR_SUB:
+            case C_EXPR_MUL:
+            case C_EXPR_DIV:
+                if (sp < 2) {
+                    C_ERROR("Malformed expression program", C_EINVAL);
+                }
+                sp--;
+                break;
+            default:
+                C_ERROR("Unknown expression opcode", C_EINVAL);
+        }
+    }
+
+    if (sp != 1) {
+        C_ERROR("Malformed expression program", C_EINVAL);
+    }
+
+    return C_SUCCESS;
+}
+
+static int
+c_expr_run( const ExprInstr* prog, size_t n_instr, void** operands,
+            const double* constants, expr_load load, void* dst, expr_store store,
+            size_t segments, size_t seg_len ) {
+
+    ExprSlot* stack = (ExprSlot*) malloc( n_instr * sizeof(ExprSlot) );
+    double*   bufs  = (double*) malloc( (n_instr + 1) * C_EXPR_BLOCK * sizeof(double) );
+
+    if (stack == 0 || bufs == 0) {
+        free( stack );
+        free( bufs );
+        C_ERROR("Failed to allocate expression stack", C_ENOMEM);
+    }
+
+    /* the last buffer holds broadcast scalar results */
+    double* fill = bufs + n_instr * C_EXPR_BLOCK;
+
+    size_t k;
+    for (k = 0; k < n_instr; k++) {
+        stack[ k ].buf = bufs + k * C_EXPR_BLOCK;
+    }
+
+    size_t seg, from, i;
+
+    for (seg = 0; seg < segments; seg++) {
+        for (from = 0; from < seg_len; from += C_EXPR_BLOCK) {
+            const size_t len = seg_len - from < C_EXPR_BLOCK ? seg_len - from : C_EXPR_BLOCK;
+
+            size_t sp = 0;
+
+            for (k = 0; k < n_instr; k++) {
+                const int    op  = prog[ k ].op;
+                const size_t arg = prog[ k ].arg;
+
+                switch (op) {
+                    case C_EXPR_LOAD:
+                        stack[ sp ].ptr    = ( *load ) ( operands[ arg ], seg, from, len, stack[ sp ].buf );
+                        stack[ sp ].scalar = 0;
+                        sp++;
+                        break;
+                    case C_EXPR_CONST:
+                        stack[ sp ].value  = constants[ arg ];
+                        stack[ sp ].scalar = 1;
+                        sp++;
+                        break;
+                    case C_EXPR_NEG:
+                        if (stack[ sp - 1 ].scalar) {
+                            stack[ sp - 1 ].value = -stack[ sp - 1 ].value;
+                        } else {
+                            double*       out = stack[ sp - 1 ].buf;
+                            const double* in  = stack[ sp - 1 ].ptr;
+
+                            for (i = 0; i < len; i++) out[ i ] = -in[ i ];
+
+                            stack[ sp - 1 ].ptr = out;
+                        }
+                        break;
+                    case C_EXPR_ADD:
+                    case C_EXPR_SUB:
+                    case C_EXPR_MUL:
+                    case C_EXPR_DIV:
+                        c_expr_binary( op, len, &stack[ sp - 2 ], &stack[ sp - 1 ] );
+                        sp--;
+                        break;
+                }
+            }
+
+            if (stack[ 0 ].scalar) {
+                for (i = 0; i < len; i++) fill[ i ] = stack[ 0 ].value;
+                stack[ 0 ].ptr = fill;
+            }
+
+            ( *store ) ( dst, seg, from, len, stack[ 0 ].ptr );
+        }
+    }
+
+    free( stack );
+    free( bufs );
+
+    return C_SUCCESS;
+}
+
+int
+c_expr_eval_vector( const ExprInstr* prog, size_t n_instr, Vector** operands, size_t n_operands,
+                    const double* constants, size_t n_constants, Vector* dst ) {
+    if (c_expr_check( prog, n_instr, n_operands, n_constants ) != C_SUCCESS) {
+        return C_EINVAL;
+    }
+
+    size_t k;
+    for (k = 0; k < n_operands; k++) {
+        if (operands[ k ]->size != dst->size) {
+            C_ERROR("Vectors must have equal length", C_EINVAL);
+        }
+    }
+
+    return c_expr_run( prog, n_instr, (void**) operands, constants,
+                       &c_expr_load_vector, dst, &c_expr_store_vector, 1, dst->size );
+}
+
+int
+c_expr_eval_matrix( const ExprInstr* prog, size_t n_instr, Matrix** operands, size_t n_operands,
+                    const double* constants, size_t n_constants, Matrix* dst ) {
+    if (c_expr_check( prog, n_instr, n_operands, n_constants ) != C_SUCCESS) {
+        return C_EINVAL;
+    }
+
+    int contiguous = c_m_is_contiguous( dst );
+
+    size_t k;
+    for (k = 0; k < n_operands; k++) {
+        if (operands[ k ]->rows != dst->rows || operands[ k ]->columns != dst->columns) {
+            C_ERROR("Matrices must have same dimensions", C_EBADLEN);
+        }
+
+        contiguous = contiguous && c_m_is_contiguous( operands[ k ] );
+    }
+
+    if (!contiguous) {
+        return c_expr_run( prog, n_instr, (void**) operands, constants,
+                           &c_expr_load_matrix, dst, &c_expr_store_matrix, dst->rows, dst->columns );
+    }
+
+    /* every operand is one unbroken block, run it as a single vector */
+    Vector*  vecs  = (Vector*)  calloc( n_operands + 1, sizeof(Vector) );
+    Vector** vptrs = (Vector**) malloc( (n_operands + 1) * sizeof(Vector*) );
+
+    if (vecs == 0 || vptrs == 0) {
+        free( vecs );
+        free( vptrs );
+        C_ERROR("Failed to allocate expression operands", C_ENOMEM);
+    }
+
+    for (k = 0; k <= n_operands; k++) {
+        Matrix* m = k < n_operands ? operands[ k ] : dst;
+
+        vecs[ k ].size      = m->rows * m->columns;
+        vecs[ k ].zero      = c_m_index( m, 0, 0 );
+        vecs[ k ].stride    = 1;
+        vecs[ k ].elements  = m->elements;
+        vecs[ k ].view_flag = 1;
+
+        vptrs[ k ] = &vecs[ k ];
+    }
+
+    const int status = c_expr_run( prog, n_instr, (void**) vptrs, constants,
+                                   &c_expr_load_vector, vptrs[ n_operands ], &c_expr_store_vector,
+                                   1, vecs[ n_operands ].size );
+
+    free( vecs );
+    free( vptrs );
+
+    return status;
+}
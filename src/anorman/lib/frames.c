@@ -0,0 +1,342 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "error.h"
+#include "raster.h"
+#include "frames.h"
+
+/* Frame writer.
+ *
+ * Frames are compressed and written on their own thread, so the caller
+ * only pays for rendering. An animation is a PNG with the APNG chunks:
+ * acTL after the header gives the frame count, which is patched in when
+ * the writer is closed, and each frame is an fcTL chunk followed by its
+ * image data, in IDAT for the first frame and in fdAT after that
+ */
+
+#define C_FW_QUEUE 4
+
+/* one chunk, with optional 4 bytes in front of the data */
+static int
+c_fw_chunk( FILE* fp, const char* type, const uint8_t* prefix, const uint8_t* data, size_t n ) {
+    uint8_t head[ 8 ], crc[ 4 ];
+
+    c_raster_be32( head, (uint32_t) (n + (prefix ? 4 : 0)) );
+    memcpy( head + 4, type, 4 );
+
+    uLong c = crc32( 0L, head + 4, 4 );
+
+    if (prefix) c = crc32( c, prefix, 4 );
+    if (n)      c = crc32( c, data, (uInt) n );
+
+    c_raster_be32( crc, (uint32_t) c );
+
+    return fwrite( head, 8, 1, fp ) == 1
+        && (prefix == NULL || fwrite( prefix, 4, 1, fp ) == 1)
+        && (n == 0 || fwrite( data, n, 1, fp ) == 1)
+        && fwrite( crc, 4, 1, fp ) == 1;
+}
+
+static void
+c_fw_actl( uint8_t* actl, uint32_t frames ) {
+    c_raster_be32( actl, frames );
+    c_raster_be32( actl + 4, 0 );    /* loop forever */
+}
+
+static int
+c_fw_write_frame( FrameWriter* fw, Raster* r, size_t number ) {
+    uint8_t* data;
+    size_t   n;
+
+    if (c_raster_deflate( r, fw->level, &data, &n ) != C_SUCCESS) {
+        return C_EFAULT;
+    }
+
+    int ok = 1;
+
+    if (!fw->animate) {
+        const size_t len = strlen( fw->path ) + 32;
+        char* name = (char*) malloc( len );
+
+        if (name == NULL) {
+            free( data );
+            C_ERROR("Failed to allocate file name", C_ENOMEM);
+        }
+
+        snprintf( name, len, fw->path, (int) number );
+
+        FILE* fp = fopen( name, "wb" );
+        free( name );
+
+        if (fp == NULL) {
+            free( data );
+            return C_EFAULT;
+        }
+
+        uint8_t ihdr[ 13 ];
+        c_raster_ihdr( r, ihdr );
+
+        ok = fwrite( c_raster_signature, 8, 1, fp ) == 1
+          && c_fw_chunk( fp, "IHDR", NULL, ihdr, 13 )
+          && c_fw_chunk( fp, "IDAT", NULL, data, n )
+          && c_fw_chunk( fp, "IEND", NULL, NULL, 0 );
+
+        ok = (fclose( fp ) == 0) && ok;
+        free( data );
+
+        return ok ? C_SUCCESS : C_EFAULT;
+    }
+
+    if (fw->frames == 0) {
+        uint8_t ihdr[ 13 ], actl[ 8 ];
+
+        c_raster_ihdr( r, ihdr );
+        c_fw_actl( actl, 0 );
+
+        fw->width  = r->width;
+        fw->height = r->height;
+
+        ok = fwrite( c_raster_signature, 8, 1, fw->fp ) == 1
+          && c_fw_chunk( fw->fp, "IHDR", NULL, ihdr, 13 );
+
+        fw->actl = ftell( fw->fp );
+        ok = ok && c_fw_chunk( fw->fp, "acTL", NULL, actl, 8 );
+    } else if (r->width != fw->width || r->height != fw->height) {
+        free( data );
+        return C_EINVAL;
+    }
+
+    /* whole frame, shown for delay ms */
+    uint8_t fctl[ 26 ] = { 0 };
+    c_raster_be32( fctl, fw->sequence++ );
+    c_raster_be32( fctl + 4, (uint32_t) r->width );
+    c_raster_be32( fctl + 8, (uint32_t) r->height );
+    fctl[ 20 ] = (uint8_t) (fw->delay >> 8);
+    fctl[ 21 ] = (uint8_t) fw->delay;
+    fctl[ 22 ] = 1000 >> 8;
+    fctl[ 23 ] = 1000 & 0xFF;
+
+    ok = ok && c_fw_chunk( fw->fp, "fcTL", NULL, fctl, 26 );
+
+    if (fw->frames == 0) {
+        ok = ok && c_fw_chunk( fw->fp, "IDAT", NULL, data, n );
+    } else {
+        uint8_t seq[ 4 ];
+        c_raster_be32( seq, fw->sequence++ );
+        ok = ok && c_fw_chunk( fw->fp, "fdAT", seq, data, n );
+    }
+
+    free( data );
+
+    fw->frames++;
+
+    return ok ? C_SUCCESS : C_EFAULT;
+}
+
+static void*
+c_fw_run( void* arg ) {
+    FrameWriter* fw = (FrameWriter*) arg;
+
+    pthread_mutex_lock( &fw->lock );
+
+    for (;;) {
+        while (fw->n == 0 && !fw->closing) {
+            pthread_cond_wait( &fw->ready, &fw->lock );
+        }
+
+        if (fw->n == 0) {
+            break;
+        }
+
+        Raster*      r      = fw->queue[ fw->head ];
+        const size_t number = fw->numbers[ fw->head ];
+
+        pthread_mutex_unlock( &fw->lock );
+
+        const int status = c_fw_write_frame( fw, r, number );
+        c_raster_free( r );
+
+        pthread_mutex_lock( &fw->lock );
+
+        if (status != C_SUCCESS && fw->status == C_SUCCESS) {
+            fw->status = status;
+        }
+
+        fw->head = (fw->head + 1) % fw->capacity;
+        fw->n--;
+
+        pthread_cond_signal( &fw->room );
+    }
+
+    pthread_mutex_unlock( &fw->lock );
+
+    return NULL;
+}
+
+/* The path is used as a printf format for numbered files, so it may
+   hold one %d conversion (flag 0 and a width allowed) and '%%' for any
+   other '%'. 1 for numbered files, 0 for an animation, -1 otherwise */
+static int
+c_fw_numbered( const char* path ) {
+    int conversions = 0;
+    int escapes     = 0;
+
+    const char* p = path;
+
+    while ((p = strchr( p, '%' )) != NULL) {
+        p++;
+
+        if (*p == '%') {
+            escapes++;
+            p++;
+            continue;
+        }
+
+        if (*p == '0') {
+            p++;
+        }
+
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+
+        if (*p != 'd') {
+            return -1;
+        }
+
+        conversions++;
+        p++;
+    }
+
+    if (conversions > 1 || (escapes > 0 && conversions == 0)) {
+        return -1;
+    }
+
+    return conversions;
+}
+
+FrameWriter*
+c_fw_open( const char* path, int level, unsigned delay ) {
+    const int numbered = c_fw_numbered( path );
+
+    /* left to the caller to report */
+    if (numbered < 0) {
+        return NULL;
+    }
+
+    FrameWriter* fw = (FrameWriter*) calloc( 1, sizeof(FrameWriter) );
+
+    if (fw == NULL) {
+        C_ERROR_NULL("Failed to allocate frame writer", C_ENOMEM);
+    }
+
+    fw->path     = strdup( path );
+    fw->animate  = !numbered;
+    fw->level    = level;
+    fw->delay    = delay > 0xFFFF ? 0xFFFF : delay;
+    fw->capacity = C_FW_QUEUE;
+    fw->queue    = (Raster**) calloc( fw->capacity, sizeof(Raster*) );
+    fw->numbers  = (size_t*)  calloc( fw->capacity, sizeof(size_t) );
+
+    if (fw->path == NULL || fw->queue == NULL || fw->numbers == NULL) {
+        free( fw->path );
+        free( fw->queue );
+        free( fw->numbers );
+        free( fw );
+        C_ERROR_NULL("Failed to allocate frame writer", C_ENOMEM);
+    }
+
+    if (fw->animate && (fw->fp = fopen( path, "wb" )) == NULL) {
+        free( fw->path );
+        free( fw->queue );
+        free( fw->numbers );
+        free( fw );
+        return NULL;
+    }
+
+    pthread_mutex_init( &fw->lock, NULL );
+    pthread_cond_init( &fw->ready, NULL );
+    pthread_cond_init( &fw->room, NULL );
+
+    if (pthread_create( &fw->thread, NULL, &c_fw_run, fw ) != 0) {
+        pthread_mutex_destroy( &fw->lock );
+        pthread_cond_destroy( &fw->ready );
+        pthread_cond_destroy( &fw->room );
+
+        if (fw->fp) fclose( fw->fp );
+
+        free( fw->path );
+        free( fw->queue );
+        free( fw->numbers );
+        free( fw );
+        return NULL;
+    }
+
+    return fw;
+}
+
+int
+c_fw_push( FrameWriter* fw, Raster* r, size_t number ) {
+    pthread_mutex_lock( &fw->lock );
+
+    while (fw->n == fw->capacity) {
+        pthread_cond_wait( &fw->room, &fw->lock );
+    }
+
+    const size_t tail = (fw->head + fw->n) % fw->capacity;
+
+    fw->queue[ tail ]   = r;
+    fw->numbers[ tail ] = number;
+    fw->n++;
+
+    const int status = fw->status;
+
+    pthread_cond_signal( &fw->ready );
+    pthread_mutex_unlock( &fw->lock );
+
+    return status;
+}
+
+int
+c_fw_close( FrameWriter* fw ) {
+    pthread_mutex_lock( &fw->lock );
+    fw->closing = 1;
+    pthread_cond_signal( &fw->ready );
+    pthread_mutex_unlock( &fw->lock );
+
+    pthread_join( fw->thread, NULL );
+
+    int status = fw->status;
+
+    if (fw->fp) {
+        int ok = 1;
+
+        if (fw->frames) {
+            uint8_t actl[ 8 ];
+            c_fw_actl( actl, fw->frames );
+
+            ok = c_fw_chunk( fw->fp, "IEND", NULL, NULL, 0 )
+              && fseek( fw->fp, fw->actl, SEEK_SET ) == 0
+              && c_fw_chunk( fw->fp, "acTL", NULL, actl, 8 );
+        }
+
+        ok = (fclose( fw->fp ) == 0) && ok;
+
+        if (!ok && status == C_SUCCESS) {
+            status = C_EFAULT;
+        }
+    }
+
+    pthread_mutex_destroy( &fw->lock );
+    pthread_cond_destroy( &fw->ready );
+    pthread_cond_destroy( &fw->room );
+
+    free( fw->path );
+    free( fw->queue );
+    free( fw->numbers );
+    free( fw );
+
+    return status;
+}
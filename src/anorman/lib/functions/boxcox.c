@@ -0,0 +1,217 @@
+#include <math.h>
+#include <float.h>
+
+#include "error.h"
+#include "threads.h"
+#include "functions/boxcox.h"
+
+/* Box-Cox lambda optimization.
+ *
+ * The profile log-likelihood is the same one used by
+ * Anorman::Math::Common::_BoxCox_lambda_likelihood:
+ *
+ *   L(l) = -(N-1)/2 * log(var(y)) + (l-1) * (N-1)/N * sum(log(x+l2))
+ *
+ * Each column is converted to log(x+l2) once, so an evaluation of
+ * L only costs one exp per element, and the maximum is bracketed
+ * with Brent's method rather than a golden section search
+ */
+
+#define BOXCOX_EPSILON  1e-10
+#define BOXCOX_CGOLD    0.3819660112501051
+#define BOXCOX_MAXITER  100
+
+/* shift parameter that makes all values positive */
+double c_boxcox_shift( const double* x, size_t n ) {
+    double min = DBL_MAX;
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        if (x[ i ] < min) min = x[ i ];
+    }
+
+    return min > 0 ? 0.0 : 1.0 + fabs( min );
+}
+
+/* replaces x with log(x + lambda2) and returns the sum of logs */
+double c_boxcox_prepare( double* x, size_t n, double lambda2 ) {
+    long double log_sum = 0;
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        x[ i ] = log( x[ i ] + lambda2 );
+        log_sum += x[ i ];
+    }
+
+    return (double) log_sum;
+}
+
+double c_boxcox_likelihood( const double* restrict logx, size_t n, double log_sum, double lambda ) {
+    if (n < 2) {
+        return 0.0;
+    }
+
+    /* accumulate around the first value to keep the variance stable */
+    double s1 = 0.0;
+    double s2 = 0.0;
+    size_t i;
+
+    if (fabs( lambda ) > BOXCOX_EPSILON) {
+        const double recip = 1.0 / lambda;
+        const double k     = (exp( lambda * logx[ 0 ] ) - 1.0) * recip;
+
+        for (i = 0; i < n; i++) {
+            const double d = (exp( lambda * logx[ i ] ) - 1.0) * recip - k;
+            s1 += d;
+            s2 += d * d;
+        }
+    } else {
+        const double k = logx[ 0 ];
+
+        for (i = 0; i < n; i++) {
+            const double d = logx[ i ] - k;
+            s1 += d;
+            s2 += d * d;
+        }
+    }
+
+    const double N   = (double) n;
+    const double var = (s2 - s1 * s1 / N) / (N - 1);
+
+    if (!(var > 0)) {
+        return -DBL_MAX;
+    }
+
+    return -((N - 1) / 2) * log( var ) + (lambda - 1) * ((N - 1) / N) * log_sum;
+}
+
+/* Brent's method on -L over [a,b]. x is overwritten with log(x + lambda2).
+ * A NaN lambda2 means it is estimated from the data; any other value,
+ * negative shifts included, is used as given */
+BoxCoxFit c_boxcox_optimize( double* x, size_t n, double a, double b, double tol, double lambda2 ) {
+    BoxCoxFit fit;
+
+    if (isnan( lambda2 )) {
+        lambda2 = c_boxcox_shift( x, n );
+    }
+
+    const double log_sum = c_boxcox_prepare( x, n, lambda2 );
+
+    double v, w, u, fv, fw, fu, fx, xm, tol1, tol2;
+    double d = 0.0;
+    double e = 0.0;
+    double xx;
+
+    xx = v = w = a + BOXCOX_CGOLD * (b - a);
+    fx = fv = fw = -c_boxcox_likelihood( x, n, log_sum, xx );
+
+    int iter;
+    for (iter = 0; iter < BOXCOX_MAXITER; iter++) {
+        xm   = 0.5 * (a + b);
+        tol1 = tol * fabs( xx ) + BOXCOX_EPSILON;
+        tol2 = 2.0 * tol1;
+
+        if (fabs( xx - xm ) <= (tol2 - 0.5 * (b - a))) {
+            break;
+        }
+
+        if (fabs( e ) > tol1) {
+            /* try a parabolic step */
+            double r = (xx - w) * (fx - fv);
+            double q = (xx - v) * (fx - fw);
+            double p = (xx - v) * q - (xx - w) * r;
+
+            q = 2.0 * (q - r);
+            if (q > 0.0) p = -p;
+            q = fabs( q );
+
+            const double etemp = e;
+            e = d;
+
+            if (fabs( p ) >= fabs( 0.5 * q * etemp ) || p <= q * (a - xx) || p >= q * (b - xx)) {
+                e = (xx >= xm) ? a - xx : b - xx;
+                d = BOXCOX_CGOLD * e;
+            } else {
+                d = p / q;
+                u = xx + d;
+                if (u - a < tol2 || b - u < tol2) {
+                    d = (xm - xx) >= 0 ? tol1 : -tol1;
+                }
+            }
+        } else {
+            /* golden section step */
+            e = (xx >= xm) ? a - xx : b - xx;
+            d = BOXCOX_CGOLD * e;
+        }
+
+        u  = (fabs( d ) >= tol1) ? xx + d : xx + (d >= 0 ? tol1 : -tol1);
+        fu = -c_boxcox_likelihood( x, n, log_sum, u );
+
+        if (fu <= fx) {
+            if (u >= xx) a = xx; else b = xx;
+            v = w;  w = xx;  xx = u;
+            fv = fw; fw = fx; fx = fu;
+        } else {
+            if (u < xx) a = u; else b = u;
+            if (fu <= fw || w == xx) {
+                v = w;  w = u;
+                fv = fw; fw = fu;
+            } else if (fu <= fv || v == xx || v == w) {
+                v = u;
+                fv = fu;
+            }
+        }
+    }
+
+    fit.lambda1    = xx;
+    fit.lambda2    = lambda2;
+    fit.likelihood = -fx;
+
+    return fit;
+}
+
+struct boxcox_job_struct
+{
+    double**       columns;
+    const size_t*  sizes;
+    double         lmin;
+    double         lmax;
+    double         tol;
+    double         lambda2;
+    BoxCoxFit*     fits;
+};
+
+typedef struct boxcox_job_struct BoxCoxJob;
+
+static void
+c_boxcox_optimize_range( size_t begin, size_t end, void* arg ) {
+    BoxCoxJob* job = (BoxCoxJob*) arg;
+
+    size_t j;
+    for (j = begin; j < end; j++) {
+        job->fits[ j ] = c_boxcox_optimize( job->columns[ j ], job->sizes[ j ], job->lmin,
+                                            job->lmax, job->tol, job->lambda2 );
+    }
+}
+
+/* optimize several columns in parallel, one column per work item */
+int c_boxcox_optimize_columns( double** columns, const size_t* sizes, size_t ncols,
+                               double lmin, double lmax, double tol, double lambda2,
+                               BoxCoxFit* fits )
+{
+    if (!(lmin < lmax)) {
+        C_ERROR("Lmin must be smaller than Lmax", C_EINVAL);
+    }
+
+    BoxCoxJob job;
+
+    job.columns = columns;
+    job.sizes   = sizes;
+    job.lmin    = lmin;
+    job.lmax    = lmax;
+    job.tol     = tol;
+    job.lambda2 = lambda2;
+    job.fits    = fits;
+
+    return c_parallel_for( ncols, 1, &c_boxcox_optimize_range, &job );
+}
@@ -0,0 +1,390 @@
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "data.h"
+#include "error.h"
+#include "matrix.h"
+#include "threads.h"
+#include "functions/colstats.h"
+
+/* Fused single-pass column statistics.
+ *
+ * Every row updates count, min, max, mean and M2 for all columns at
+ * once (Welford's algorithm). Rows are split into blocks that are
+ * processed by separate threads, and the partial states are merged
+ * with Chan's pairwise update at the end
+ */
+
+#define COLSTATS_MIN_ROWS 4096
+
+ColumnStats* c_colstats_alloc( size_t columns ) {
+    ColumnStats* s;
+
+    if (columns == 0) {
+        C_ERROR_NULL("Number of columns must be positive integer", C_EINVAL);
+    }
+
+    s = (ColumnStats*) malloc( sizeof(ColumnStats) );
+
+    if (s == 0) {
+        C_ERROR_NULL("Failed to allocate column statistics", C_ENOMEM);
+    }
+
+    s->columns = columns;
+    s->min     = (double*) malloc( 4 * columns * sizeof(double) );
+
+    if (s->min == 0) {
+        free( s );
+        C_ERROR_NULL("Failed to allocate column statistics", C_ENOMEM);
+    }
+
+    s->max  = s->min + columns;
+    s->mean = s->max + columns;
+    s->M2   = s->mean + columns;
+
+    c_colstats_reset( s );
+
+    return s;
+}
+
+void c_colstats_free( ColumnStats* s ) {
+    if (!s) {
+        return;
+    }
+
+    free( s->min );
+    free( s );
+}
+
+void c_colstats_reset( ColumnStats* s ) {
+    size_t j;
+
+    s->n = 0;
+
+    for (j = 0; j < s->columns; j++) {
+        s->min[ j ]  =  DBL_MAX;
+        s->max[ j ]  = -DBL_MAX;
+        s->mean[ j ] = 0.0;
+        s->M2[ j ]   = 0.0;
+    }
+}
+
+/* update all columns with one row (stride is the column stride of the row) */
+void c_colstats_add_row( ColumnStats* s, const double* restrict row, size_t stride ) {
+    double* restrict min  = s->min;
+    double* restrict max  = s->max;
+    double* restrict mean = s->mean;
+    double* restrict M2   = s->M2;
+
+    const size_t M   = s->columns;
+    const double inv = 1.0 / (double) ++s->n;
+
+    size_t j;
+
+    if (stride == 1) {
+        for (j = 0; j < M; j++) {
+            const double x = row[ j ];
+            const double d = x - mean[ j ];
+
+            mean[ j ] += d * inv;
+            M2[ j ]   += d * (x - mean[ j ]);
+            min[ j ]   = x < min[ j ] ? x : min[ j ];
+            max[ j ]   = x > max[ j ] ? x : max[ j ];
+        }
+    } else {
+        for (j = 0; j < M; j++) {
+            const double x = row[ j * stride ];
+            const double d = x - mean[ j ];
+
+            mean[ j ] += d * inv;
+            M2[ j ]   += d * (x - mean[ j ]);
+            min[ j ]   = x < min[ j ] ? x : min[ j ];
+            max[ j ]   = x > max[ j ] ? x : max[ j ];
+        }
+    }
+}
+
+/* merge partial state b into a */
+void c_colstats_merge( ColumnStats* a, const ColumnStats* b ) {
+    if (b->n == 0) {
+        return;
+    }
+
+    if (a->n == 0) {
+        a->n = b->n;
+        memcpy( a->min, b->min, 4 * a->columns * sizeof(double) );
+        return;
+    }
+
+    const double na = (double) a->n;
+    const double nb = (double) b->n;
+    const double n  = na + nb;
+
+    size_t j;
+    for (j = 0; j < a->columns; j++) {
+        const double d = b->mean[ j ] - a->mean[ j ];
+
+        a->mean[ j ] += d * nb / n;
+        a->M2[ j ]   += b->M2[ j ] + d * d * na * nb / n;
+        a->min[ j ]   = b->min[ j ] < a->min[ j ] ? b->min[ j ] : a->min[ j ];
+        a->max[ j ]   = b->max[ j ] > a->max[ j ] ? b->max[ j ] : a->max[ j ];
+    }
+
+    a->n += b->n;
+}
+
+double c_colstats_variance( const ColumnStats* s, size_t j ) {
+    return s->n > 1 ? s->M2[ j ] / (double) (s->n - 1) : 0.0;
+}
+
+struct colstats_job_struct
+{
+    Matrix*       A;
+    ColumnStats** partials;
+    size_t        block;
+};
+
+typedef struct colstats_job_struct ColumnStatsJob;
+
+static void
+c_colstats_accumulate( Matrix* A, ColumnStats* s, size_t begin, size_t end ) {
+    size_t i, j;
+
+    if (A->offsets) {
+        /* selections have no fixed stride, so copy each row out first */
+        double* row = (double*) malloc( A->columns * sizeof(double) );
+
+        for (i = begin; i < end; i++) {
+            for (j = 0; j < A->columns; j++) {
+                row[ j ] = c_m_get_quick( A, i, j );
+            }
+            c_colstats_add_row( s, row, 1 );
+        }
+
+        free( row );
+    } else {
+        const double* elems = A->elements + A->row_zero + A->column_zero;
+
+        for (i = begin; i < end; i++) {
+            c_colstats_add_row( s, elems + i * A->row_stride, A->column_stride );
+        }
+    }
+}
+
+static void
+c_colstats_block( size_t begin, size_t end, void* arg ) {
+    ColumnStatsJob* job = (ColumnStatsJob*) arg;
+
+    size_t b;
+    for (b = begin; b < end; b++) {
+        const size_t first = b * job->block;
+        const size_t last  = first + job->block < job->A->rows ? first + job->block : job->A->rows;
+
+        c_colstats_accumulate( job->A, job->partials[ b ], first, last );
+    }
+}
+
+int c_m_column_stats( Matrix* A, ColumnStats* s ) {
+    if (s->columns != A->columns) {
+        C_ERROR("Statistics and matrix must have same number of columns", C_EBADLEN);
+    }
+
+    c_colstats_reset( s );
+
+    const size_t T = c_num_threads();
+
+    if (T <= 1 || A->rows < 2 * COLSTATS_MIN_ROWS) {
+        c_colstats_accumulate( A, s, 0, A->rows );
+        return C_SUCCESS;
+    }
+
+    /* one partial state per block of rows */
+    size_t nblocks = A->rows / COLSTATS_MIN_ROWS;
+    if (nblocks > T) nblocks = T;
+
+    ColumnStatsJob job;
+
+    job.A        = A;
+    job.block    = (A->rows + nblocks - 1) / nblocks;
+    job.partials = (ColumnStats**) malloc( nblocks * sizeof(ColumnStats*) );
+
+    size_t b;
+    for (b = 0; b < nblocks; b++) {
+        job.partials[ b ] = c_colstats_alloc( A->columns );
+    }
+
+    c_parallel_for( nblocks, 1, &c_colstats_block, &job );
+
+    for (b = 0; b < nblocks; b++) {
+        c_colstats_merge( s, job.partials[ b ] );
+        c_colstats_free( job.partials[ b ] );
+    }
+
+    free( job.partials );
+
+    return C_SUCCESS;
+}
+
+/*==========================================
+ P-square quantile sketches (one per column)
+ ===========================================*/
+
+void c_p2_init( P2Quantile* p, double phi ) {
+    p->phi   = phi;
+    p->count = 0;
+
+    p->np[0] = 1;
+    p->np[1] = 1 + 2 * phi;
+    p->np[2] = 1 + 4 * phi;
+    p->np[3] = 3 + 2 * phi;
+    p->np[4] = 5;
+
+    p->dn[0] = 0;
+    p->dn[1] = phi / 2;
+    p->dn[2] = phi;
+    p->dn[3] = (1 + phi) / 2;
+    p->dn[4] = 1;
+}
+
+static double
+c_p2_parabolic( const P2Quantile* p, int i, double d ) {
+    const double n0 = (double) p->pos[ i - 1 ];
+    const double n1 = (double) p->pos[ i ];
+    const double n2 = (double) p->pos[ i + 1 ];
+
+    return p->q[ i ] + d / (n2 - n0) *
+           ((n1 - n0 + d) * (p->q[ i + 1 ] - p->q[ i ]) / (n2 - n1)
+          + (n2 - n1 - d) * (p->q[ i ] - p->q[ i - 1 ]) / (n1 - n0));
+}
+
+void c_p2_add( P2Quantile* p, double x ) {
+    int i, k;
+
+    /* the first five observations are kept sorted */
+    if (p->count < 5) {
+        i = (int) p->count++;
+        while (i > 0 && p->q[ i - 1 ] > x) {
+            p->q[ i ] = p->q[ i - 1 ];
+            i--;
+        }
+        p->q[ i ] = x;
+
+        if (p->count == 5) {
+            for (i = 0; i < 5; i++) p->pos[ i ] = i + 1;
+        }
+        return;
+    }
+
+    p->count++;
+
+    if (x < p->q[0]) {
+        p->q[0] = x;
+        k = 0;
+    } else if (x >= p->q[4]) {
+        p->q[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && x >= p->q[ k + 1 ]) k++;
+    }
+
+    for (i = k + 1; i < 5; i++) p->pos[ i ]++;
+    for (i = 0; i < 5; i++) p->np[ i ] += p->dn[ i ];
+
+    /* adjust the three middle markers */
+    for (i = 1; i < 4; i++) {
+        const double d = p->np[ i ] - (double) p->pos[ i ];
+
+        if ((d >= 1 && p->pos[ i + 1 ] - p->pos[ i ] > 1)
+         || (d <= -1 && p->pos[ i ] - p->pos[ i - 1 ] > 1)) {
+            const int    s  = d >= 0 ? 1 : -1;
+            const double qp = c_p2_parabolic( p, i, (double) s );
+
+            if (p->q[ i - 1 ] < qp && qp < p->q[ i + 1 ]) {
+                p->q[ i ] = qp;
+            } else {
+                /* linear fallback */
+                p->q[ i ] += s * (p->q[ i + s ] - p->q[ i ]) / ((double) p->pos[ i + s ] - (double) p->pos[ i ]);
+            }
+
+            p->pos[ i ] += s;
+        }
+    }
+}
+
+double c_p2_result( const P2Quantile* p ) {
+    if (p->count == 0) {
+        return 0.0;
+    }
+
+    /* exact answer from the sorted buffer for tiny samples */
+    if (p->count <= 5) {
+        const double index = p->phi * (double) (p->count - 1);
+        const size_t lhs   = (size_t) index;
+        const double delta = index - (double) lhs;
+
+        return delta > 0 ? (1 - delta) * p->q[ lhs ] + delta * p->q[ lhs + 1 ] : p->q[ lhs ];
+    }
+
+    return p->q[2];
+}
+
+struct quantile_job_struct
+{
+    Matrix*       A;
+    const double* phis;
+    size_t        nphis;
+    double*       result;
+};
+
+typedef struct quantile_job_struct QuantileJob;
+
+static void
+c_quantile_columns( size_t begin, size_t end, void* arg ) {
+    QuantileJob* job = (QuantileJob*) arg;
+    Matrix* A = job->A;
+
+    P2Quantile* sketch = (P2Quantile*) malloc( job->nphis * sizeof(P2Quantile) );
+
+    size_t i, j, k;
+    for (j = begin; j < end; j++) {
+        for (k = 0; k < job->nphis; k++) {
+            c_p2_init( &sketch[ k ], job->phis[ k ] );
+        }
+
+        for (i = 0; i < A->rows; i++) {
+            const double x = c_m_get_quick( A, i, j );
+
+            for (k = 0; k < job->nphis; k++) {
+                c_p2_add( &sketch[ k ], x );
+            }
+        }
+
+        for (k = 0; k < job->nphis; k++) {
+            job->result[ j * job->nphis + k ] = c_p2_result( &sketch[ k ] );
+        }
+    }
+
+    free( sketch );
+}
+
+/* approximate quantiles of every column. Result is a columns x nphis array */
+int c_m_column_quantiles( Matrix* A, const double* phis, size_t nphis, double* result ) {
+    size_t k;
+
+    for (k = 0; k < nphis; k++) {
+        if (phis[ k ] < 0 || phis[ k ] > 1) {
+            C_ERROR("Quantiles must be in the range [0,1]", C_EDOM);
+        }
+    }
+
+    QuantileJob job;
+
+    job.A      = A;
+    job.phis   = phis;
+    job.nphis  = nphis;
+    job.result = result;
+
+    return c_parallel_for( A->columns, 1, &c_quantile_columns, &job );
+}
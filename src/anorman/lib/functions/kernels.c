@@ -0,0 +1,85 @@
+#include <math.h>
+
+#include "data.h"
+#include "vector.h"
+#include "functions/kernels.h"
+
+/* Kernel definitions. See functions/kernels.h for how these are
+ * expanded. Accumulators are plain doubles so that the contiguous
+ * loops can be vectorized
+ */
+
+/* single vector */
+
+#define SUM_STATE      double acc = 0.0
+#define SUM_BODY       acc += x
+#define SUM_RESULT     acc
+
+#define MIN_STATE      double acc = INFINITY
+#define MIN_BODY       acc = x < acc ? x : acc
+#define MIN_RESULT     acc
+
+#define MAX_STATE      double acc = -INFINITY
+#define MAX_BODY       acc = x > acc ? x : acc
+#define MAX_RESULT     acc
+
+C_V_KERNEL( c_kernel_sum, SUM )
+C_V_KERNEL( c_kernel_min, MIN )
+C_V_KERNEL( c_kernel_max, MAX )
+
+/* vector pairs */
+
+#define MANHATTAN_STATE           double acc = 0.0
+#define MANHATTAN_BODY            acc += fabs( x - y )
+#define MANHATTAN_RESULT          acc
+
+#define SQUARED_EUCLIDEAN_STATE   double acc = 0.0
+#define SQUARED_EUCLIDEAN_BODY    acc += ( x - y ) * ( x - y )
+#define SQUARED_EUCLIDEAN_RESULT  acc
+
+#define MAXIMUM_STATE             double acc = 0.0
+#define MAXIMUM_BODY              acc = fabs( x - y ) > acc ? fabs( x - y ) : acc
+#define MAXIMUM_RESULT            acc
+
+#define CANBERRA_STATE            double acc = 0.0
+#define CANBERRA_BODY             acc += fabs( x - y ) / ( fabs( x ) + fabs( y ) )
+#define CANBERRA_RESULT           acc
+
+#define BRAY_CURTIS_STATE         double num = 0.0, den = 0.0
+#define BRAY_CURTIS_BODY          num += fabs( x - y ); den += x + y
+#define BRAY_CURTIS_RESULT        ( num / den )
+
+#define COSINE_STATE              double ab = 0.0, aa = 0.0, bb = 0.0
+#define COSINE_BODY               ab += x * y; aa += x * x; bb += y * y
+#define COSINE_RESULT             ( 1 - ab / sqrt( aa ) / sqrt( bb ) )
+
+/* param holds the two means */
+#define COMOMENT_STATE            double sxy = 0.0
+#define COMOMENT_BODY             sxy += ( x - param[ 0 ] ) * ( y - param[ 1 ] )
+#define COMOMENT_RESULT           sxy
+
+#define CORRELATION_STATE         double sxy = 0.0, sxx = 0.0, syy = 0.0
+#define CORRELATION_BODY          const double dx = x - param[ 0 ];             \
+                                  const double dy = y - param[ 1 ];             \
+                                  sxy += dx * dy; sxx += dx * dx; syy += dy * dy
+#define CORRELATION_RESULT        ( sxy / sqrt( sxx * syy ) )
+
+/* param[ 0 ] is p. The root is left to the caller */
+#define LP_STATE                  double acc = 0.0
+#define LP_BODY                   acc += pow( fabs( x - y ), param[ 0 ] )
+#define LP_RESULT                 acc
+
+C_VV_KERNEL( c_kernel_manhattan, MANHATTAN )
+C_VV_KERNEL( c_kernel_squared_euclidean, SQUARED_EUCLIDEAN )
+C_VV_KERNEL( c_kernel_maximum, MAXIMUM )
+C_VV_KERNEL( c_kernel_canberra, CANBERRA )
+C_VV_KERNEL( c_kernel_bray_curtis, BRAY_CURTIS )
+C_VV_KERNEL( c_kernel_cosine, COSINE )
+C_VV_KERNEL( c_kernel_comoment, COMOMENT )
+C_VV_KERNEL( c_kernel_correlation, CORRELATION )
+C_VV_KERNEL( c_kernel_lp, LP )
+
+C_VV_KERNEL_UPTO( c_kernel_manhattan_upto, MANHATTAN )
+C_VV_KERNEL_UPTO( c_kernel_squared_euclidean_upto, SQUARED_EUCLIDEAN )
+C_VV_KERNEL_UPTO( c_kernel_maximum_upto, MAXIMUM )
+C_VV_KERNEL_UPTO( c_kernel_lp_upto, LP )
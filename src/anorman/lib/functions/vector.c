@@ -2,6 +2,7 @@
 #include "vector.h"
 #include "functions/functions.h"
 #include "functions/vector.h"
+#include "functions/kernels.h"
 
 double c_v_aggregate( size_t size, Vector* a, dd_func aggr, d_func f ) {
 
@@ -32,15 +33,43 @@ double c_v_aggregate_upto( size_t size, Vector* a, dd_func aggr, d_func f, doubl
 }
 
 double c_v_mean( size_t size, Vector* v ) {
-   return ( c_v_aggregate( size, v, &c_plus, &c_identity ) / (double) size );
+   return c_kernel_sum( size, v ) / (double) size;
     
 }
 
 double c_v_variance( size_t size, Vector* v ) {
-    const double mean = c_v_mean( size, v );
+    /* single pass (Welford) */
+    double mean = 0.0;
+    double M2   = 0.0;
+
+    if (size < 2) {
+        return 0.0;
+    }
+
+    size_t k;
+
+    if (v->offsets) {
+        for (k = 0; k < size; k++) {
+            const double x = c_v_get_quick( v, k );
+            const double d = x - mean;
+
+            mean += d / (double) (k + 1);
+            M2   += d * (x - mean);
+        }
+    } else {
+        const double* elems = v->elements + v->zero;
+        const size_t  s     = v->stride;
+
+        for (k = 0; k < size; k++) {
+            const double x = elems[ k * s ];
+            const double d = x - mean;
+
+            mean += d / (double) (k + 1);
+            M2   += d * (x - mean);
+        }
+    }
 
-    return (c_v_aggregate( size, v, &c_plus, &c_square )
-            - mean * c_v_aggregate( size, v, &c_plus, &c_identity )) / (double) (size - 1);
+    return M2 / (double) (size - 1);
 }
 
 double c_v_stdev( size_t size, Vector* v ) {
@@ -69,10 +98,10 @@ double c_v_variance2( size_t size, Vector* v ) {
 }
 
 double c_v_min( size_t size, Vector* v ) {
-    return( c_v_aggregate( size, v, &c_min, &c_identity ) );
+    return c_kernel_min( size, v );
 }
 
 double c_v_max( size_t size, Vector* v ) {
-    return( c_v_aggregate( size, v, &c_max, &c_identity ) );
+    return c_kernel_max( size, v );
 }
 
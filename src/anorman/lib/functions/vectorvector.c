@@ -3,6 +3,7 @@
 #include "functions/functions.h"
 #include "functions/vector.h"
 #include "functions/vectorvector.h"
+#include "functions/kernels.h"
 
 /* aggregate functions that return a double */
 
@@ -55,27 +56,15 @@ double c_vv_aggregate_upto( size_t size, Vector* a, Vector* b, dd_func aggr, dd_
 }
 
 double c_vv_covariance( size_t size, Vector* a, Vector* b ) {
-    const double ma = c_v_mean( size, a );
-    const double mb = c_v_mean( size, b );
-   
-    long double covariance = 0;
+    const double means[ 2 ] = { c_v_mean( size, a ), c_v_mean( size, b ) };
 
-    size_t i;
-    for (i = 0; i < size; i++) {
-        const long double delta1 = c_v_get_quick( a, i ) - ma;
-        const long double delta2 = c_v_get_quick( b, i ) - mb;
-
-        covariance += ( delta1 * delta2 - covariance) / (double) (i + 1);
-    }
-
-    return covariance * ((double)size / (double)(size -1));
+    return c_kernel_comoment( size, a, b, means ) / (double) (size - 1);
 }
 
 double c_vv_correlation( size_t size, Vector* a, Vector* b ) {
-    const double sa = c_v_stdev( size, a );
-    const double sb = c_v_stdev( size, b );
+    const double means[ 2 ] = { c_v_mean( size, a ), c_v_mean( size, b ) };
 
-    return c_vv_covariance( size, a, b ) / (sa * sb);
+    return c_kernel_correlation( size, a, b, means );
 }
 
 void c_vv_plusmult_assign( size_t size, Vector* a, Vector* b, double multiplicator ) {
@@ -139,54 +128,68 @@ void c_vv_func_assign( size_t size, Vector* a, Vector* b, dd_func function ) {
  *****************************/
 
 
+/* The distances below run on the specialized kernels in kernels.c.
+   c_vv_aggregate_quick and friends remain for arbitrary function pairs */
+
 /* Manhattan distance */
 double c_vv_dist_manhattan( size_t size, Vector* a, Vector* b ) {
-
-    dd_func aggr = (dd_func) &c_plus;
-    dd_func f    = (dd_func) &c_abs_diff;
-
-    return c_vv_aggregate_quick( size, a, b, aggr, f );
+    return c_kernel_manhattan( size, a, b, NULL );
 }
 
 /* Manhattan distance with threshold */
 double c_vv_dist_manhattan_upto( size_t size, Vector* a, Vector* b, double threshold ) {
- 
-    dd_func aggr = (dd_func) &c_plus;
-    dd_func f    = (dd_func) &c_abs_diff;
-
-    return c_vv_aggregate_quick_upto( size, a, b, aggr, f, threshold );
+    return c_kernel_manhattan_upto( size, a, b, NULL, threshold );
 }
 
 /* Euclidean distance */
 double c_vv_dist_euclidean( size_t size, Vector* a, Vector* b ) {
-
     return sqrt( c_vv_squared_dist_euclidean( size, a, b ) ); 
 }
 
 double c_vv_squared_dist_euclidean( size_t size, Vector* a, Vector* b ) {
-
-    dd_func aggr = (dd_func) &c_plus;
-    dd_func    f = (dd_func) &c_square_diff;
-
-    return c_vv_aggregate_quick( size, a, b, aggr, f );
+    return c_kernel_squared_euclidean( size, a, b, NULL );
 }
 
 /* Euclidean distance with threshold */
 double c_vv_dist_euclidean_upto( size_t size, Vector* a, Vector* b, double threshold ) {
+    return sqrt( c_kernel_squared_euclidean_upto( size, a, b, NULL, threshold * threshold ) ); 
+}
+
+/* Squared euclidean distance with threshold */
+double c_vv_dist_squared_euclidean_upto( size_t size, Vector* a, Vector* b, double threshold ) {
+    return c_kernel_squared_euclidean_upto( size, a, b, NULL, threshold ); 
+}
 
-    dd_func aggr = (dd_func) &c_plus;
-    dd_func    f = (dd_func) &c_square_diff;
+/* Maximum (Chebyshev) distance */
+double c_vv_dist_maximum( size_t size, Vector* a, Vector* b ) {
+    return c_kernel_maximum( size, a, b, NULL );
+}
 
-    threshold = (threshold * threshold);
+double c_vv_dist_maximum_upto( size_t size, Vector* a, Vector* b, double threshold ) {
+    return c_kernel_maximum_upto( size, a, b, NULL, threshold );
+}
 
-    return sqrt( c_vv_aggregate_quick_upto( size, a, b, aggr, f, threshold ) ); 
+/* Minkowski distance of order p */
+double c_vv_dist_lp( size_t size, Vector* a, Vector* b, double p ) {
+    return pow( c_kernel_lp( size, a, b, &p ), 1 / p );
 }
 
-/* Euclidean distance with threshold */
-double c_vv_dist_squared_euclidean_upto( size_t size, Vector* a, Vector* b, double threshold ) {
+double c_vv_dist_lp_upto( size_t size, Vector* a, Vector* b, double p, double threshold ) {
+    return pow( c_kernel_lp_upto( size, a, b, &p, pow( threshold, p ) ), 1 / p );
+}
+
+double c_vv_dist_canberra( size_t size, Vector* a, Vector* b ) {
+    return c_kernel_canberra( size, a, b, NULL );
+}
 
-    dd_func aggr = (dd_func) &c_plus;
-    dd_func    f = (dd_func) &c_square_diff;
+double c_vv_dist_bray_curtis( size_t size, Vector* a, Vector* b ) {
+    return c_kernel_bray_curtis( size, a, b, NULL );
+}
+
+double c_vv_dist_cosine( size_t size, Vector* a, Vector* b ) {
+    return c_kernel_cosine( size, a, b, NULL );
+}
 
-    return c_vv_aggregate_quick_upto( size, a, b, aggr, f, threshold ); 
+double c_vv_dist_correlation( size_t size, Vector* a, Vector* b ) {
+    return 1 - c_vv_correlation( size, a, b );
 }
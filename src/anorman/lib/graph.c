@@ -0,0 +1,940 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "error.h"
+#include "threads.h"
+#include "intern.h"
+#include "unionfind.h"
+#include "graph.h"
+
+/* Native assembly graph.
+ *
+ * Node names are interned to dense ids on load and every attribute is a
+ * flat column indexed by node or edge id, so a graph with tens of
+ * millions of edges costs some 40 bytes per edge rather than a blessed
+ * hash per edge and node. Edges are indexed by source and by target
+ * with a counting sort (CSR / CSC). Connected components come from a
+ * lock-free union-find run over the edge columns in parallel, and are
+ * stored as one array of member nodes with offsets per component.
+ * Filters are predicate scans over a column that clear active flags
+ */
+
+#define C_GRAPH_INITIAL 1024
+#define C_GRAPH_FIELDS  6
+
+/* grow an array column to n cells */
+#define C_GRAPH_GROW( ptr, type, n )                               \
+    do {                                                           \
+        type* _p = (type*) realloc( (ptr), (n) * sizeof(type) );   \
+        if (_p == NULL) {                                          \
+            C_ERROR("Failed to grow graph column", C_ENOMEM);      \
+        }                                                          \
+        (ptr) = _p;                                                \
+    } while (0)
+
+AsmGraph*
+c_graph_alloc( void ) {
+    AsmGraph* g = (AsmGraph*) calloc( 1, sizeof(AsmGraph) );
+
+    if (g == NULL) {
+        C_ERROR_NULL("Failed to allocate graph", C_ENOMEM);
+    }
+
+    g->names  = c_intern_alloc( C_GRAPH_INITIAL );
+    g->seqids = c_intern_alloc( C_GRAPH_INITIAL );
+    g->types  = c_intern_alloc( 16 );
+
+    if (!g->names || !g->seqids || !g->types) {
+        c_graph_free( g );
+        C_ERROR_NULL("Failed to allocate graph", C_ENOMEM);
+    }
+
+    return g;
+}
+
+static void
+c_graph_free_index( AsmGraph* g ) {
+    free( g->out_ptr );
+    free( g->out_edge );
+    free( g->in_ptr );
+    free( g->in_edge );
+
+    g->out_ptr  = NULL;
+    g->out_edge = NULL;
+    g->in_ptr   = NULL;
+    g->in_edge  = NULL;
+    g->indexed  = 0;
+}
+
+static void
+c_graph_free_components( AsmGraph* g ) {
+    free( g->component );
+    free( g->comp_ptr );
+    free( g->comp_nodes );
+    free( g->comp_length );
+    free( g->comp_coverage );
+    free( g->comp_edges );
+    free( g->comp_active );
+    free( g->comp_rank );
+    free( g->comp_order );
+
+    g->component     = NULL;
+    g->comp_ptr      = NULL;
+    g->comp_nodes    = NULL;
+    g->comp_length   = NULL;
+    g->comp_coverage = NULL;
+    g->comp_edges    = NULL;
+    g->comp_active   = NULL;
+    g->comp_rank     = NULL;
+    g->comp_order    = NULL;
+
+    g->n_components        = 0;
+    g->n_active_components = 0;
+    g->components_valid    = 0;
+}
+
+static void
+c_graph_free_scratch( AsmGraph* g ) {
+    free( g->visit_stamp );
+    free( g->visit_stack );
+    free( g->visit_pos );
+
+    g->visit_stamp = NULL;
+    g->visit_stack = NULL;
+    g->visit_pos   = NULL;
+    g->stamp       = 0;
+}
+
+void
+c_graph_free( AsmGraph* g ) {
+    if (g == NULL) {
+        return;
+    }
+
+    c_intern_free( g->names );
+    c_intern_free( g->seqids );
+    c_intern_free( g->types );
+
+    free( g->node_seqid );
+    free( g->length );
+    free( g->coverage );
+    free( g->degree );
+    free( g->node_active );
+    free( g->seqid_node );
+
+    free( g->src );
+    free( g->dst );
+    free( g->type );
+    free( g->connections );
+    free( g->ratio );
+    free( g->score );
+    free( g->edge_active );
+
+    c_graph_free_index( g );
+    c_graph_free_components( g );
+    c_graph_free_scratch( g );
+
+    free( g );
+}
+
+static int
+c_graph_reserve_nodes( AsmGraph* g, size_t n ) {
+    if (n <= g->node_capacity) {
+        return C_SUCCESS;
+    }
+
+    size_t capacity = g->node_capacity ? g->node_capacity + g->node_capacity / 2 : C_GRAPH_INITIAL;
+
+    if (capacity < n) {
+        capacity = n;
+    }
+
+    C_GRAPH_GROW( g->node_seqid,  uint32_t, capacity );
+    C_GRAPH_GROW( g->length,      uint64_t, capacity );
+    C_GRAPH_GROW( g->coverage,    double,   capacity );
+    C_GRAPH_GROW( g->degree,      uint32_t, capacity );
+    C_GRAPH_GROW( g->node_active, uint8_t,  capacity );
+    C_GRAPH_GROW( g->seqid_node,  int64_t,  capacity );
+
+    g->node_capacity = capacity;
+
+    return C_SUCCESS;
+}
+
+static int
+c_graph_reserve_edges( AsmGraph* g, size_t n ) {
+    if (n <= g->edge_capacity) {
+        return C_SUCCESS;
+    }
+
+    size_t capacity = g->edge_capacity ? g->edge_capacity + g->edge_capacity / 2 : C_GRAPH_INITIAL;
+
+    if (capacity < n) {
+        capacity = n;
+    }
+
+    C_GRAPH_GROW( g->src,         uint32_t, capacity );
+    C_GRAPH_GROW( g->dst,         uint32_t, capacity );
+    C_GRAPH_GROW( g->type,        uint32_t, capacity );
+    C_GRAPH_GROW( g->connections, uint32_t, capacity );
+    C_GRAPH_GROW( g->ratio,       double,   capacity );
+    C_GRAPH_GROW( g->score,       double,   capacity );
+    C_GRAPH_GROW( g->edge_active, uint8_t,  capacity );
+
+    g->edge_capacity = capacity;
+
+    return C_SUCCESS;
+}
+
+/* a node seen again overwrites the attributes of the first */
+int64_t
+c_graph_add_node( AsmGraph* g, const char* name, size_t name_len, const char* seqid, size_t seqid_len,
+                  uint64_t length, double coverage ) {
+    const int64_t id = c_intern_add( g->names, name, name_len );
+
+    if (id < 0 || c_graph_reserve_nodes( g, (size_t) id + 1 ) != C_SUCCESS) {
+        return -1;
+    }
+
+    const int64_t sid = c_intern_add( g->seqids, seqid, seqid_len );
+
+    if (sid < 0 || c_graph_reserve_nodes( g, (size_t) sid + 1 ) != C_SUCCESS) {
+        return -1;
+    }
+
+    /* the index and traversal scratch are sized by the node count */
+    if ((size_t) id == g->n_nodes) {
+        g->degree[ id ] = 0;
+        g->n_nodes++;
+
+        c_graph_free_scratch( g );
+        g->indexed = 0;
+    }
+
+    g->node_seqid[ id ]  = (uint32_t) sid;
+    g->length[ id ]      = length;
+    g->coverage[ id ]    = coverage;
+    g->node_active[ id ] = 1;
+    g->seqid_node[ sid ] = id;
+
+    g->components_valid = 0;
+
+    return id;
+}
+
+/* -1 if a node is unknown or filtered */
+int64_t
+c_graph_add_edge( AsmGraph* g, const char* node1, size_t len1, const char* node2, size_t len2,
+                  const char* type, size_t type_len, uint32_t connections, double ratio, double score ) {
+    const int64_t a = c_intern_lookup( g->names, node1, len1 );
+    const int64_t b = c_intern_lookup( g->names, node2, len2 );
+
+    if (a < 0 || b < 0 || !g->node_active[ a ] || !g->node_active[ b ]) {
+        return -1;
+    }
+
+    const int64_t t = c_intern_add( g->types, type, type_len );
+
+    if (t < 0 || c_graph_reserve_edges( g, g->n_edges + 1 ) != C_SUCCESS) {
+        return -1;
+    }
+
+    const size_t e = g->n_edges++;
+
+    g->src[ e ]         = (uint32_t) a;
+    g->dst[ e ]         = (uint32_t) b;
+    g->type[ e ]        = (uint32_t) t;
+    g->connections[ e ] = connections;
+    g->ratio[ e ]       = ratio;
+    g->score[ e ]       = score;
+    g->edge_active[ e ] = 1;
+
+    g->degree[ a ]++;
+    g->degree[ b ]++;
+
+    g->indexed          = 0;
+    g->components_valid = 0;
+
+    return (int64_t) e;
+}
+
+/* split a line on tabs in place. Missing fields are empty */
+static void
+c_graph_split( char* line, char** field, size_t* len ) {
+    size_t n = 0;
+    char*  p = line;
+
+    while (n < C_GRAPH_FIELDS) {
+        char* tab = strchr( p, '\t' );
+
+        field[ n ] = p;
+
+        if (tab == NULL) {
+            len[ n++ ] = strlen( p );
+            break;
+        }
+
+        *tab = '\0';
+        len[ n++ ] = (size_t) (tab - p);
+        p = tab + 1;
+    }
+
+    while (n < C_GRAPH_FIELDS) {
+        field[ n ] = p + strlen( p );
+        len[ n++ ] = 0;
+    }
+}
+
+/* read data lines of a file, skipping blank lines and '#' comments.
+   A file that cannot be opened is not reported through C_ERROR, whose
+   default handler aborts the process: the loaders return -1 and
+   Graph::Store croaks with the path instead */
+static FILE*
+c_graph_open( const char* path ) {
+    return fopen( path, "r" );
+}
+
+static char*
+c_graph_next_line( FILE* fp, char** buf, size_t* cap ) {
+    ssize_t n;
+
+    while ((n = getline( buf, cap, fp )) >= 0) {
+        char* line = *buf;
+
+        while (n > 0 && (line[ n - 1 ] == '\n' || line[ n - 1 ] == '\r')) {
+            line[ --n ] = '\0';
+        }
+
+        if (n > 0 && line[ 0 ] != '#') {
+            return line;
+        }
+    }
+
+    return NULL;
+}
+
+/* name, seqid, length, coverage [, degree] */
+int64_t
+c_graph_load_nodes( AsmGraph* g, const char* path ) {
+    FILE* fp = c_graph_open( path );
+
+    if (fp == NULL) {
+        return -1;
+    }
+
+    char*   buf   = NULL;
+    size_t  cap   = 0;
+    int64_t lines = 0;
+    char*   line;
+
+    char*  field[ C_GRAPH_FIELDS ];
+    size_t len[ C_GRAPH_FIELDS ];
+
+    while ((line = c_graph_next_line( fp, &buf, &cap )) != NULL) {
+        c_graph_split( line, field, len );
+
+        if (c_graph_add_node( g, field[0], len[0], field[1], len[1],
+                              strtoull( field[2], NULL, 10 ), strtod( field[3], NULL ) ) < 0) {
+            lines = -1;
+            break;
+        }
+
+        lines++;
+    }
+
+    free( buf );
+    fclose( fp );
+
+    return lines;
+}
+
+/* node1, node2, type, connections, ratio, score */
+int64_t
+c_graph_load_edges( AsmGraph* g, const char* path, size_t* skipped ) {
+    FILE* fp = c_graph_open( path );
+
+    if (fp == NULL) {
+        return -1;
+    }
+
+    char*   buf   = NULL;
+    size_t  cap   = 0;
+    int64_t lines = 0;
+    char*   line;
+
+    char*  field[ C_GRAPH_FIELDS ];
+    size_t len[ C_GRAPH_FIELDS ];
+
+    *skipped = 0;
+
+    while ((line = c_graph_next_line( fp, &buf, &cap )) != NULL) {
+        c_graph_split( line, field, len );
+
+        const int64_t e = c_graph_add_edge( g, field[0], len[0], field[1], len[1], field[2], len[2],
+                                            (uint32_t) strtoul( field[3], NULL, 10 ),
+                                            strtod( field[4], NULL ), strtod( field[5], NULL ) );
+
+        if (e < 0) {
+            (*skipped)++;
+        }
+
+        lines++;
+    }
+
+    free( buf );
+    fclose( fp );
+
+    return lines;
+}
+
+/* counting sort of edge ids by one endpoint column */
+static int
+c_graph_index_by( const uint32_t* key, size_t n_edges, size_t n_nodes, size_t** ptr, uint32_t** edge ) {
+    size_t*   p = (size_t*)   calloc( n_nodes + 1, sizeof(size_t) );
+    uint32_t* e = (uint32_t*) malloc( (n_edges ? n_edges : 1) * sizeof(uint32_t) );
+
+    if (p == NULL || e == NULL) {
+        free( p );
+        free( e );
+        C_ERROR("Failed to index graph edges", C_ENOMEM);
+    }
+
+    size_t i;
+    for (i = 0; i < n_edges; i++) {
+        p[ key[ i ] + 1 ]++;
+    }
+
+    for (i = 0; i < n_nodes; i++) {
+        p[ i + 1 ] += p[ i ];
+    }
+
+    /* fill with p shifted by one, then p[v] ends where it started */
+    for (i = 0; i < n_edges; i++) {
+        e[ p[ key[ i ] ]++ ] = (uint32_t) i;
+    }
+
+    for (i = n_nodes; i > 0; i--) {
+        p[ i ] = p[ i - 1 ];
+    }
+
+    p[ 0 ] = 0;
+
+    *ptr  = p;
+    *edge = e;
+
+    return C_SUCCESS;
+}
+
+int
+c_graph_index( AsmGraph* g ) {
+    if (g->indexed) {
+        return C_SUCCESS;
+    }
+
+    if (g->n_edges > UINT32_MAX) {
+        C_ERROR("Too many edges to index", C_EINVAL);
+    }
+
+    c_graph_free_index( g );
+
+    int status = c_graph_index_by( g->src, g->n_edges, g->n_nodes, &g->out_ptr, &g->out_edge );
+
+    if (status == C_SUCCESS) {
+        status = c_graph_index_by( g->dst, g->n_edges, g->n_nodes, &g->in_ptr, &g->in_edge );
+    }
+
+    if (status != C_SUCCESS) {
+        c_graph_free_index( g );
+        return status;
+    }
+
+    g->indexed = 1;
+
+    return C_SUCCESS;
+}
+
+void
+c_graph_degrees( AsmGraph* g ) {
+    memset( g->degree, 0, g->n_nodes * sizeof(uint32_t) );
+
+    size_t e;
+    for (e = 0; e < g->n_edges; e++) {
+        if (g->edge_active[ e ]) {
+            g->degree[ g->src[ e ] ]++;
+            g->degree[ g->dst[ e ] ]++;
+        }
+    }
+}
+
+struct comp_size_struct
+{
+    size_t   size;
+    uint32_t root;
+};
+
+typedef struct comp_size_struct CompSize;
+
+static int
+c_graph_cmp_comp_size( const void* a, const void* b ) {
+    const CompSize* x = (const CompSize*) a;
+    const CompSize* y = (const CompSize*) b;
+
+    if (x->size != y->size) {
+        return x->size < y->size ? 1 : -1;
+    }
+
+    return (x->root > y->root) - (x->root < y->root);
+}
+
+struct graph_roots_job_struct
+{
+    AsmGraph*  g;
+    UnionFind* uf;
+};
+
+typedef struct graph_roots_job_struct GraphRootsJob;
+
+/* node -> root of its set, -1 for nodes without active edges */
+static void
+c_graph_roots_range( size_t begin, size_t end, void* arg ) {
+    GraphRootsJob* job = (GraphRootsJob*) arg;
+    AsmGraph*      g   = job->g;
+
+    size_t v;
+    for (v = begin; v < end; v++) {
+        g->component[ v ] = g->degree[ v ] ? (int64_t) c_uf_find_atomic( job->uf, (uint32_t) v ) : -1;
+    }
+}
+
+int
+c_graph_components( AsmGraph* g ) {
+    const size_t N = g->n_nodes;
+
+    c_graph_free_components( g );
+    c_graph_degrees( g );
+
+    UnionFind* uf = c_uf_alloc( N );
+
+    if (uf == NULL) {
+        return C_ENOMEM;
+    }
+
+    g->component = (int64_t*) malloc( (N ? N : 1) * sizeof(int64_t) );
+
+    size_t*   sizes = (size_t*)   calloc( N ? N : 1, sizeof(size_t) );
+    CompSize* order = (CompSize*) malloc( (N ? N : 1) * sizeof(CompSize) );
+
+    if (g->component == NULL || sizes == NULL || order == NULL) {
+        c_uf_free( uf );
+        free( sizes );
+        free( order );
+        c_graph_free_components( g );
+        C_ERROR("Failed to allocate components", C_ENOMEM);
+    }
+
+    int status = c_uf_union_edges_atomic( uf, g->src, g->dst, g->edge_active, g->n_edges );
+
+    GraphRootsJob job = { g, uf };
+
+    if (status == C_SUCCESS) {
+        status = c_parallel_for( N, 4096, &c_graph_roots_range, &job );
+    }
+
+    c_uf_free( uf );
+
+    if (status != C_SUCCESS) {
+        free( sizes );
+        free( order );
+        c_graph_free_components( g );
+        return status;
+    }
+
+    size_t v, c, K = 0;
+    for (v = 0; v < N; v++) {
+        if (g->component[ v ] >= 0) {
+            sizes[ g->component[ v ] ]++;
+        }
+    }
+
+    /* roots are the smallest member, so this lists components by first node */
+    for (v = 0; v < N; v++) {
+        if (sizes[ v ]) {
+            order[ K ].size = sizes[ v ];
+            order[ K ].root = (uint32_t) v;
+            K++;
+        }
+    }
+
+    qsort( order, K, sizeof(CompSize), &c_graph_cmp_comp_size );
+
+    g->n_components  = K;
+    g->comp_ptr      = (size_t*)   calloc( K + 1, sizeof(size_t) );
+    g->comp_nodes    = (uint32_t*) malloc( (N ? N : 1) * sizeof(uint32_t) );
+    g->comp_length   = (uint64_t*) calloc( K ? K : 1, sizeof(uint64_t) );
+    g->comp_coverage = (double*)   calloc( K ? K : 1, sizeof(double) );
+    g->comp_edges    = (size_t*)   calloc( K ? K : 1, sizeof(size_t) );
+    g->comp_active   = (uint8_t*)  malloc( K ? K : 1 );
+    g->comp_rank     = (int64_t*)  malloc( (K ? K : 1) * sizeof(int64_t) );
+    g->comp_order    = (uint32_t*) malloc( (K ? K : 1) * sizeof(uint32_t) );
+
+    if (!g->comp_ptr || !g->comp_nodes || !g->comp_length || !g->comp_coverage || !g->comp_edges
+        || !g->comp_active || !g->comp_rank || !g->comp_order) {
+        free( sizes );
+        free( order );
+        c_graph_free_components( g );
+        C_ERROR("Failed to allocate components", C_ENOMEM);
+    }
+
+    /* sizes now maps root -> component id */
+    for (c = 0; c < K; c++) {
+        g->comp_ptr[ c + 1 ] = g->comp_ptr[ c ] + order[ c ].size;
+        sizes[ order[ c ].root ] = c;
+        g->comp_active[ c ] = 1;
+    }
+
+    free( order );
+
+    size_t* fill = (size_t*) malloc( (K ? K : 1) * sizeof(size_t) );
+
+    if (fill == NULL) {
+        free( sizes );
+        c_graph_free_components( g );
+        C_ERROR("Failed to allocate components", C_ENOMEM);
+    }
+
+    memcpy( fill, g->comp_ptr, K * sizeof(size_t) );
+
+    double* weighted = g->comp_coverage;
+
+    for (v = 0; v < N; v++) {
+        if (g->component[ v ] < 0) {
+            continue;
+        }
+
+        c = sizes[ g->component[ v ] ];
+
+        g->component[ v ] = (int64_t) c;
+        g->comp_nodes[ fill[ c ]++ ] = (uint32_t) v;
+        g->comp_length[ c ] += g->length[ v ];
+        weighted[ c ]       += g->coverage[ v ] * (double) g->length[ v ];
+    }
+
+    for (c = 0; c < K; c++) {
+        weighted[ c ] = g->comp_length[ c ] ? weighted[ c ] / (double) g->comp_length[ c ] : 0.0;
+    }
+
+    size_t e;
+    for (e = 0; e < g->n_edges; e++) {
+        if (g->edge_active[ e ]) {
+            g->comp_edges[ g->component[ g->src[ e ] ] ]++;
+        }
+    }
+
+    free( fill );
+    free( sizes );
+
+    g->components_valid = 1;
+
+    c_graph_rank_components( g );
+
+    return C_SUCCESS;
+}
+
+void
+c_graph_drop_edge( AsmGraph* g, uint32_t e ) {
+    if (e >= g->n_edges || !g->edge_active[ e ]) {
+        return;
+    }
+
+    g->edge_active[ e ] = 0;
+    g->degree[ g->src[ e ] ]--;
+    g->degree[ g->dst[ e ] ]--;
+
+    g->components_valid = 0;
+}
+
+void
+c_graph_drop_node( AsmGraph* g, uint32_t v ) {
+    if (v >= g->n_nodes || !g->node_active[ v ] || c_graph_index( g ) != C_SUCCESS) {
+        return;
+    }
+
+    size_t i;
+    for (i = g->out_ptr[ v ]; i < g->out_ptr[ v + 1 ]; i++) {
+        c_graph_drop_edge( g, g->out_edge[ i ] );
+    }
+
+    for (i = g->in_ptr[ v ]; i < g->in_ptr[ v + 1 ]; i++) {
+        c_graph_drop_edge( g, g->in_edge[ i ] );
+    }
+
+    g->node_active[ v ] = 0;
+    g->components_valid = 0;
+}
+
+static inline int
+c_graph_test( double x, int op, double value ) {
+    switch (op) {
+        case C_GRAPH_LT: return x <  value;
+        case C_GRAPH_LE: return x <= value;
+        case C_GRAPH_GT: return x >  value;
+        case C_GRAPH_GE: return x >= value;
+        case C_GRAPH_EQ: return x == value;
+        default:         return x != value;
+    }
+}
+
+static inline double
+c_graph_node_value( AsmGraph* g, int column, size_t v ) {
+    switch (column) {
+        case C_GRAPH_NODE_LENGTH:   return (double) g->length[ v ];
+        case C_GRAPH_NODE_COVERAGE: return g->coverage[ v ];
+        default:                    return (double) g->degree[ v ];
+    }
+}
+
+static inline double
+c_graph_edge_value( AsmGraph* g, int column, size_t e ) {
+    switch (column) {
+        case C_GRAPH_EDGE_CONNECTIONS: return (double) g->connections[ e ];
+        case C_GRAPH_EDGE_RATIO:       return g->ratio[ e ];
+        case C_GRAPH_EDGE_SCORE:       return g->score[ e ];
+        default:                       return (double) g->type[ e ];
+    }
+}
+
+/* nodes failing the predicate are dropped with their edges. Returns the
+   number of nodes dropped */
+size_t
+c_graph_filter_nodes( AsmGraph* g, int column, int op, double value ) {
+    size_t removed = 0;
+
+    size_t v;
+    for (v = 0; v < g->n_nodes; v++) {
+        if (g->node_active[ v ] && !c_graph_test( c_graph_node_value( g, column, v ), op, value )) {
+            g->node_active[ v ] = 0;
+            removed++;
+        }
+    }
+
+    size_t e;
+    for (e = 0; e < g->n_edges; e++) {
+        if (!g->node_active[ g->src[ e ] ] || !g->node_active[ g->dst[ e ] ]) {
+            g->edge_active[ e ] = 0;
+        }
+    }
+
+    c_graph_degrees( g );
+    g->components_valid = 0;
+
+    return removed;
+}
+
+struct graph_filter_job_struct
+{
+    AsmGraph* g;
+    int       column;
+    int       op;
+    double    value;
+    size_t    removed;
+};
+
+typedef struct graph_filter_job_struct GraphFilterJob;
+
+static void
+c_graph_filter_edges_range( size_t begin, size_t end, void* arg ) {
+    GraphFilterJob* job = (GraphFilterJob*) arg;
+    AsmGraph*       g   = job->g;
+    size_t          n   = 0;
+
+    size_t e;
+    for (e = begin; e < end; e++) {
+        if (g->edge_active[ e ] && !c_graph_test( c_graph_edge_value( g, job->column, e ), job->op, job->value )) {
+            g->edge_active[ e ] = 0;
+            n++;
+        }
+    }
+
+    __atomic_fetch_add( &job->removed, n, __ATOMIC_RELAXED );
+}
+
+/* returns the number of edges dropped */
+size_t
+c_graph_filter_edges( AsmGraph* g, int column, int op, double value ) {
+    GraphFilterJob job = { g, column, op, value, 0 };
+
+    c_parallel_for( g->n_edges, 65536, &c_graph_filter_edges_range, &job );
+
+    c_graph_degrees( g );
+    g->components_valid = 0;
+
+    return job.removed;
+}
+
+/* returns the number of components dropped */
+size_t
+c_graph_filter_components( AsmGraph* g, int column, int op, double value ) {
+    size_t removed = 0;
+
+    size_t c;
+    for (c = 0; c < g->n_components; c++) {
+        double x;
+
+        switch (column) {
+            case C_GRAPH_COMP_SIZE:     x = (double) (g->comp_ptr[ c + 1 ] - g->comp_ptr[ c ]); break;
+            case C_GRAPH_COMP_LENGTH:   x = (double) g->comp_length[ c ]; break;
+            case C_GRAPH_COMP_COVERAGE: x = g->comp_coverage[ c ]; break;
+            default:                    x = (double) g->comp_edges[ c ];
+        }
+
+        if (g->comp_active[ c ] && !c_graph_test( x, op, value )) {
+            g->comp_active[ c ] = 0;
+            removed++;
+        }
+    }
+
+    c_graph_rank_components( g );
+
+    return removed;
+}
+
+/* number the active components consecutively, largest first */
+void
+c_graph_rank_components( AsmGraph* g ) {
+    size_t c, k = 0;
+
+    for (c = 0; c < g->n_components; c++) {
+        if (g->comp_active[ c ]) {
+            g->comp_rank[ c ]    = (int64_t) k;
+            g->comp_order[ k++ ] = (uint32_t) c;
+        } else {
+            g->comp_rank[ c ] = -1;
+        }
+    }
+
+    g->n_active_components = k;
+}
+
+static int
+c_graph_alloc_scratch( AsmGraph* g ) {
+    if (g->visit_stamp) {
+        return C_SUCCESS;
+    }
+
+    const size_t N = g->n_nodes ? g->n_nodes : 1;
+
+    g->visit_stamp = (uint32_t*) calloc( N, sizeof(uint32_t) );
+    g->visit_stack = (uint32_t*) malloc( N * sizeof(uint32_t) );
+    g->visit_pos   = (size_t*)   malloc( N * sizeof(size_t) );
+    g->stamp       = 0;
+
+    if (!g->visit_stamp || !g->visit_stack || !g->visit_pos) {
+        c_graph_free_scratch( g );
+        C_ERROR("Failed to allocate traversal scratch", C_ENOMEM);
+    }
+
+    return C_SUCCESS;
+}
+
+/* k-th active neighbour edge of v, over out edges then in edges. Sets
+   *w to the node at the other end; returns 0 when exhausted */
+static inline int
+c_graph_neighbor( AsmGraph* g, uint32_t v, size_t* k, uint32_t* w ) {
+    const size_t n_out = g->out_ptr[ v + 1 ] - g->out_ptr[ v ];
+    const size_t n_in  = g->in_ptr[ v + 1 ] - g->in_ptr[ v ];
+
+    while (*k < n_out + n_in) {
+        const size_t i = (*k)++;
+        uint32_t     e;
+
+        if (i < n_out) {
+            e  = g->out_edge[ g->out_ptr[ v ] + i ];
+            *w = g->dst[ e ];
+        } else {
+            e  = g->in_edge[ g->in_ptr[ v ] + i - n_out ];
+            *w = g->src[ e ];
+        }
+
+        if (g->edge_active[ e ]) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* out must have room for all nodes of the component of start */
+int64_t
+c_graph_traverse( AsmGraph* g, uint32_t start, int dfs, uint32_t* out ) {
+    if (start >= g->n_nodes) {
+        C_ERROR_VAL("No such node", C_EINVAL, -1);
+    }
+
+    if (!g->node_active[ start ]) {
+        return 0;
+    }
+
+    if (c_graph_index( g ) != C_SUCCESS || c_graph_alloc_scratch( g ) != C_SUCCESS) {
+        return -1;
+    }
+
+    /* a new stamp marks everything unvisited */
+    if (++g->stamp == 0) {
+        memset( g->visit_stamp, 0, g->n_nodes * sizeof(uint32_t) );
+        g->stamp = 1;
+    }
+
+    const uint32_t stamp = g->stamp;
+    uint32_t*      seen  = g->visit_stamp;
+    size_t         n     = 0;
+    uint32_t       w;
+
+    seen[ start ] = stamp;
+    out[ n++ ]    = start;
+
+    if (!dfs) {
+        /* out doubles as the queue */
+        size_t head = 0;
+
+        while (head < n) {
+            const uint32_t v = out[ head++ ];
+            size_t         k = 0;
+
+            while (c_graph_neighbor( g, v, &k, &w )) {
+                if (seen[ w ] != stamp) {
+                    seen[ w ]  = stamp;
+                    out[ n++ ] = w;
+                }
+            }
+        }
+
+        return (int64_t) n;
+    }
+
+    /* preorder depth first with an explicit stack of (node, next neighbour) */
+    uint32_t* stack = g->visit_stack;
+    size_t*   pos   = g->visit_pos;
+    size_t    top   = 0;
+
+    stack[ 0 ] = start;
+    pos[ 0 ]   = 0;
+
+    for (;;) {
+        if (c_graph_neighbor( g, stack[ top ], &pos[ top ], &w )) {
+            if (seen[ w ] != stamp) {
+                seen[ w ]  = stamp;
+                out[ n++ ] = w;
+
+                top++;
+                stack[ top ] = w;
+                pos[ top ]   = 0;
+            }
+        } else if (top-- == 0) {
+            break;
+        }
+    }
+
+    return (int64_t) n;
+}
@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "threads.h"
+#include "grow.h"
+
+/* Growing of SOM grids.
+ *
+ * Old neurons keep their weights and are spread over the larger grid;
+ * the neurons inserted between them are interpolated from the old
+ * neurons on either side. Growth is separable: every old grid row is
+ * first widened to the new number of columns, then every new grid row
+ * is taken from the two widened rows around it
+ */
+
+#define C_GROW_MIN_CHUNK 4    /* grid rows per job */
+
+GrowAxis*
+c_grow_axis_alloc( size_t n, size_t m, int toroid, int method ) {
+    if (n == 0 || m < n) {
+        return NULL;
+    }
+
+    GrowAxis* a = (GrowAxis*) calloc( 1, sizeof(GrowAxis) );
+
+    if (a == NULL) {
+        C_ERROR_NULL("Failed to allocate grid axis", C_ENOMEM);
+    }
+
+    a->n     = n;
+    a->m     = m;
+    a->place = (size_t*) malloc( n * sizeof(size_t) );
+    a->lo    = (size_t*) malloc( m * sizeof(size_t) );
+    a->hi    = (size_t*) malloc( m * sizeof(size_t) );
+    a->t     = (double*) malloc( m * sizeof(double) );
+
+    if (a->place == NULL || a->lo == NULL || a->hi == NULL || a->t == NULL) {
+        c_grow_axis_free( a );
+        C_ERROR_NULL("Failed to allocate grid axis", C_ENOMEM);
+    }
+
+    size_t k, j;
+
+    /* planar axes keep both ends in place */
+    for (k = 0; k < n; k++) {
+        if (toroid) {
+            a->place[ k ] = k * m / n;
+        } else {
+            a->place[ k ] = n > 1 ? (k * (m - 1) + (n - 1) / 2) / (n - 1) : 0;
+        }
+    }
+
+    k = 0;
+    for (j = 0; j < m; j++) {
+        while (k + 1 < n && a->place[ k + 1 ] <= j) {
+            k++;
+        }
+
+        const size_t lo   = k;
+        const size_t hi   = k + 1 < n ? k + 1 : (toroid ? 0 : k);
+        const size_t next = k + 1 < n ? a->place[ k + 1 ] : m;
+
+        a->lo[ j ] = lo;
+        a->hi[ j ] = hi;
+
+        if (j == a->place[ lo ] || hi == lo) {
+            a->t[ j ] = 0.0;
+        } else if (method == C_GROW_BILINEAR) {
+            a->t[ j ] = (double) (j - a->place[ lo ]) / (double) (next - a->place[ lo ]);
+        } else {
+            a->t[ j ] = 0.5;
+        }
+    }
+
+    return a;
+}
+
+void
+c_grow_axis_free( GrowAxis* a ) {
+    if (a == NULL) {
+        return;
+    }
+
+    free( a->place );
+    free( a->lo );
+    free( a->hi );
+    free( a->t );
+    free( a );
+}
+
+struct grow_job_struct
+{
+    const double*   src;
+    size_t          src_stride;    /* between neurons */
+    size_t          src_columns;   /* neurons a grid row */
+    double*         dst;
+    size_t          dst_stride;
+    size_t          dst_columns;
+    size_t          dim;
+    const GrowAxis* axis;
+};
+
+typedef struct grow_job_struct GrowJob;
+
+/* dst = (1 - t) * a + t * b over one neuron */
+static void
+c_grow_mix( double* dst, const double* a, const double* b, double t, size_t dim ) {
+    size_t d;
+
+    if (t == 0.0) {
+        memcpy( dst, a, dim * sizeof(double) );
+        return;
+    }
+
+    for (d = 0; d < dim; d++) {
+        dst[ d ] = (1.0 - t) * a[ d ] + t * b[ d ];
+    }
+}
+
+/* old grid rows [begin, end) widened to the new columns */
+static void
+c_grow_columns( size_t begin, size_t end, void* arg ) {
+    const GrowJob*  job = (const GrowJob*) arg;
+    const GrowAxis* ax  = job->axis;
+
+    size_t r, j;
+
+    for (r = begin; r < end; r++) {
+        const double* src = job->src + r * job->src_columns * job->src_stride;
+        double*       dst = job->dst + r * job->dst_columns * job->dst_stride;
+
+        for (j = 0; j < ax->m; j++) {
+            c_grow_mix( dst + j * job->dst_stride,
+                        src + ax->lo[ j ] * job->src_stride,
+                        src + ax->hi[ j ] * job->src_stride,
+                        ax->t[ j ], job->dim );
+        }
+    }
+}
+
+/* new grid rows [begin, end) from the widened old rows */
+static void
+c_grow_rows( size_t begin, size_t end, void* arg ) {
+    const GrowJob*  job = (const GrowJob*) arg;
+    const GrowAxis* ax  = job->axis;
+
+    const size_t row = job->src_columns * job->src_stride;
+
+    size_t i, j;
+
+    for (i = begin; i < end; i++) {
+        const double* a   = job->src + ax->lo[ i ] * row;
+        const double* b   = job->src + ax->hi[ i ] * row;
+        double*       dst = job->dst + i * job->dst_columns * job->dst_stride;
+
+        for (j = 0; j < job->dst_columns; j++) {
+            c_grow_mix( dst + j * job->dst_stride, a + j * job->src_stride, b + j * job->src_stride,
+                        ax->t[ i ], job->dim );
+        }
+    }
+}
+
+int
+c_grow_weights( const double* w, size_t stride, size_t dim, const GrowAxis* rows, const GrowAxis* columns,
+                double* out, size_t out_stride ) {
+    if (dim == 0 || stride < dim || out_stride < dim) {
+        return C_EINVAL;
+    }
+
+    /* old rows at the new width, packed */
+    double* tmp = (double*) malloc( rows->n * columns->m * dim * sizeof(double) );
+
+    if (tmp == NULL) {
+        C_ERROR("Failed to allocate grid buffer", C_ENOMEM);
+    }
+
+    GrowJob job;
+    job.src         = w;
+    job.src_stride  = stride;
+    job.src_columns = columns->n;
+    job.dst         = tmp;
+    job.dst_stride  = dim;
+    job.dst_columns = columns->m;
+    job.dim         = dim;
+    job.axis        = columns;
+
+    c_parallel_for( rows->n, C_GROW_MIN_CHUNK, &c_grow_columns, &job );
+
+    job.src         = tmp;
+    job.src_stride  = dim;
+    job.src_columns = columns->m;
+    job.dst         = out;
+    job.dst_stride  = out_stride;
+    job.axis        = rows;
+
+    c_parallel_for( rows->m, C_GROW_MIN_CHUNK, &c_grow_rows, &job );
+
+    free( tmp );
+
+    return C_SUCCESS;
+}
+
+size_t
+c_grow_index( const GrowAxis* rows, const GrowAxis* columns, size_t index ) {
+    return rows->place[ index / columns->n ] * columns->m + columns->place[ index % columns->n ];
+}
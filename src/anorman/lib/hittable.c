@@ -0,0 +1,565 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include "error.h"
+#include "intern.h"
+#include "hittable.h"
+
+/* Streaming reader for search hit tables.
+ *
+ * Lines are cut into fields in place and parsed straight into typed
+ * records; names, accessions and descriptions are interned, so a record
+ * costs some hundred bytes whatever the line length. Each group (a
+ * query, or a query domain) keeps a min-heap of its top_n hits by bit
+ * score, the worst on top, so that a hit which does not make the cut is
+ * dropped at once and memory grows with the number of queries rather
+ * than the number of lines. Ties keep the earlier hit
+ */
+
+#define C_HIT_FIELDS   24
+#define C_HIT_NONE     UINT32_MAX
+
+HitTable*
+c_hits_alloc( int format, int group_by, size_t top_n ) {
+    if (format < C_HIT_BLAST || format > C_HIT_DOMTBLOUT || top_n == 0) {
+        C_ERROR_NULL("Invalid hit table layout", C_EINVAL);
+    }
+
+    HitTable* h = (HitTable*) calloc( 1, sizeof(HitTable) );
+
+    if (h == NULL) {
+        C_ERROR_NULL("Failed to allocate hit table", C_ENOMEM);
+    }
+
+    h->format   = format;
+    h->group_by = group_by;
+    h->top_n    = top_n;
+
+    h->names  = c_intern_alloc( C_INTERN_DEFAULT_CAPACITY );
+    h->accs   = c_intern_alloc( 16 );
+    h->descs  = c_intern_alloc( 16 );
+    h->groups = c_intern_alloc( C_INTERN_DEFAULT_CAPACITY );
+
+    if (!h->names || !h->accs || !h->descs || !h->groups) {
+        c_hits_free( h );
+        C_ERROR_NULL("Failed to allocate hit table", C_ENOMEM);
+    }
+
+    return h;
+}
+
+void
+c_hits_free( HitTable* h ) {
+    if (h == NULL) {
+        return;
+    }
+
+    c_intern_free( h->names );
+    c_intern_free( h->accs );
+    c_intern_free( h->descs );
+    c_intern_free( h->groups );
+
+    free( h->s_desc );
+    free( h->heap );
+    free( h->count );
+    free( h->scratch );
+    free( h );
+}
+
+static char*
+c_hits_scratch( HitTable* h, size_t size ) {
+    if (size > h->scratch_size) {
+        char* p = (char*) realloc( h->scratch, size );
+
+        if (p == NULL) {
+            C_ERROR_NULL("Failed to grow hit table buffer", C_ENOMEM);
+        }
+
+        h->scratch      = p;
+        h->scratch_size = size;
+    }
+
+    return h->scratch;
+}
+
+static int
+c_hits_reserve_groups( HitTable* h, size_t n ) {
+    if (n <= h->capacity) {
+        return C_SUCCESS;
+    }
+
+    size_t capacity = h->capacity ? h->capacity * 2 : 1024;
+
+    while (capacity < n) {
+        capacity *= 2;
+    }
+
+    HitRecord* heap = (HitRecord*) realloc( h->heap, capacity * h->top_n * sizeof(HitRecord) );
+
+    if (heap == NULL) {
+        C_ERROR("Failed to grow hit table", C_ENOMEM);
+    }
+
+    h->heap = heap;
+
+    size_t* count = (size_t*) realloc( h->count, capacity * sizeof(size_t) );
+
+    if (count == NULL) {
+        C_ERROR("Failed to grow hit table", C_ENOMEM);
+    }
+
+    memset( count + h->capacity, 0, (capacity - h->capacity) * sizeof(size_t) );
+
+    h->count    = count;
+    h->capacity = capacity;
+
+    return C_SUCCESS;
+}
+
+/* fields of a line, cut in place on tabs (BLAST) or runs of white
+   space (HMMER). Returns the number of fields; *rest points after the
+   last one taken */
+static size_t
+c_hits_split( char* line, int tabs, char** field, size_t max, char** rest ) {
+    size_t n = 0;
+    char*  p = line;
+
+    if (!tabs) {
+        while (isspace( (unsigned char) *p )) p++;
+    }
+
+    while (*p && n < max) {
+        field[ n++ ] = p;
+
+        if (tabs) {
+            while (*p && *p != '\t') p++;
+        } else {
+            while (*p && !isspace( (unsigned char) *p )) p++;
+        }
+
+        if (*p) {
+            *p++ = '\0';
+
+            if (!tabs) {
+                while (isspace( (unsigned char) *p )) p++;
+            }
+        }
+    }
+
+    *rest = p;
+
+    return n;
+}
+
+static inline uint32_t
+c_hits_uint( const char* s ) {
+    return (uint32_t) strtoul( s, NULL, 10 );
+}
+
+static int
+c_hits_intern( StrIntern* si, const char* s, uint32_t* id ) {
+    const int64_t i = c_intern_add( si, s, strlen( s ) );
+
+    if (i < 0) {
+        return C_ENOMEM;
+    }
+
+    *id = (uint32_t) i;
+
+    return C_SUCCESS;
+}
+
+/* the remaining words of a HMMER line, joined by single spaces */
+static int
+c_hits_describe( HitTable* h, uint32_t s_id, char* rest ) {
+    const size_t names = c_intern_size( h->names );
+
+    if (names > h->s_desc_capacity) {
+        size_t capacity = h->s_desc_capacity ? h->s_desc_capacity * 2 : 1024;
+
+        while (capacity < names) {
+            capacity *= 2;
+        }
+
+        int64_t* s_desc = (int64_t*) realloc( h->s_desc, capacity * sizeof(int64_t) );
+
+        if (s_desc == NULL) {
+            C_ERROR("Failed to grow hit table", C_ENOMEM);
+        }
+
+        size_t i;
+        for (i = h->s_desc_capacity; i < capacity; i++) {
+            s_desc[ i ] = -1;
+        }
+
+        h->s_desc          = s_desc;
+        h->s_desc_capacity = capacity;
+    }
+
+    /* subjects are HMMs here, described the same on every line */
+    if (h->s_desc[ s_id ] >= 0) {
+        return C_SUCCESS;
+    }
+
+    char* buf = c_hits_scratch( h, strlen( rest ) + 1 );
+
+    if (buf == NULL) {
+        return C_ENOMEM;
+    }
+
+    size_t n = 0;
+    char*  p = rest;
+
+    while (*p) {
+        if (isspace( (unsigned char) *p )) {
+            while (isspace( (unsigned char) *p )) p++;
+
+            if (*p && n) {
+                buf[ n++ ] = ' ';
+            }
+        } else {
+            buf[ n++ ] = *p++;
+        }
+    }
+
+    const int64_t d = c_intern_add( h->descs, buf, n );
+
+    if (d < 0) {
+        return C_ENOMEM;
+    }
+
+    h->s_desc[ s_id ] = d;
+
+    return C_SUCCESS;
+}
+
+static inline int
+c_hits_better( const HitRecord* a, const HitRecord* b ) {
+    return a->bit_score > b->bit_score || (a->bit_score == b->bit_score && a->line < b->line);
+}
+
+/* keep the record if it is among the top_n of its group */
+static void
+c_hits_offer( HitTable* h, size_t group, const HitRecord* r ) {
+    const size_t N    = h->top_n;
+    HitRecord*   heap = h->heap + group * N;
+    size_t       n    = h->count[ group ];
+    size_t       i;
+
+    if (n < N) {
+        /* sift up: parents are worse than their children */
+        i = n;
+
+        while (i > 0) {
+            const size_t parent = (i - 1) / 2;
+
+            if (!c_hits_better( &heap[ parent ], r )) {
+                break;
+            }
+
+            heap[ i ] = heap[ parent ];
+            i = parent;
+        }
+
+        heap[ i ] = *r;
+        h->count[ group ] = n + 1;
+
+        return;
+    }
+
+    if (!c_hits_better( r, &heap[ 0 ] )) {
+        return;
+    }
+
+    /* replace the worst and sift down */
+    i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+
+        if (child >= N) {
+            break;
+        }
+
+        if (child + 1 < N && c_hits_better( &heap[ child ], &heap[ child + 1 ] )) {
+            child++;
+        }
+
+        if (!c_hits_better( r, &heap[ child ] )) {
+            break;
+        }
+
+        heap[ i ] = heap[ child ];
+        i = child;
+    }
+
+    heap[ i ] = *r;
+}
+
+/* c_hits_sort leaves every group best first, a max-heap. Reversed,
+   worst first, each group is a min-heap again for c_hits_offer */
+static void
+c_hits_unsort( HitTable* h ) {
+    const size_t groups = c_intern_size( h->groups );
+
+    size_t g;
+    for (g = 0; g < groups; g++) {
+        HitRecord* heap = h->heap + g * h->top_n;
+        size_t     lo   = 0;
+        size_t     hi   = h->count[ g ];
+
+        while (lo + 1 < hi) {
+            const HitRecord tmp = heap[ lo ];
+
+            heap[ lo++ ] = heap[ --hi ];
+            heap[ hi ]   = tmp;
+        }
+    }
+
+    h->sorted = 0;
+}
+
+int
+c_hits_add_line( HitTable* h, char* line, size_t len ) {
+    char*  field[ C_HIT_FIELDS ];
+    char*  rest;
+    int    status;
+    size_t n;
+
+    HitRecord r;
+
+    while (len > 0 && (line[ len - 1 ] == '\n' || line[ len - 1 ] == '\r')) {
+        line[ --len ] = '\0';
+    }
+
+    if (len == 0 || line[ 0 ] == '#') {
+        return C_SUCCESS;
+    }
+
+    h->lines++;
+
+    memset( &r, 0, sizeof(HitRecord) );
+
+    r.line  = h->lines;
+    r.q_acc = C_HIT_NONE;
+    r.s_acc = C_HIT_NONE;
+
+    switch (h->format) {
+        case C_HIT_BLAST:
+            n = c_hits_split( line, 1, field, 12, &rest );
+
+            if (n < 12) {
+                h->skipped++;
+                return C_EINVAL;
+            }
+
+            if ((status = c_hits_intern( h->names, field[0], &r.q_id )) != C_SUCCESS ||
+                (status = c_hits_intern( h->names, field[1], &r.s_id )) != C_SUCCESS) {
+                return status;
+            }
+
+            r.pct_id     = strtod( field[2], NULL );
+            r.aln_len    = c_hits_uint( field[3] );
+            r.mismatches = c_hits_uint( field[4] );
+            r.gap_open   = c_hits_uint( field[5] );
+            r.q_beg      = c_hits_uint( field[6] );
+            r.q_end      = c_hits_uint( field[7] );
+            r.s_beg      = c_hits_uint( field[8] );
+            r.s_end      = c_hits_uint( field[9] );
+            r.eval       = strtod( field[10], NULL );
+            r.bit_score  = strtod( field[11], NULL );
+            break;
+
+        case C_HIT_TBLOUT:
+            n = c_hits_split( line, 0, field, 18, &rest );
+
+            if (n < 7) {
+                h->skipped++;
+                return C_EINVAL;
+            }
+
+            if ((status = c_hits_intern( h->names, field[0], &r.s_id )) != C_SUCCESS ||
+                (status = c_hits_intern( h->accs,  field[1], &r.s_acc )) != C_SUCCESS ||
+                (status = c_hits_intern( h->names, field[2], &r.q_id )) != C_SUCCESS ||
+                (status = c_hits_intern( h->accs,  field[3], &r.q_acc )) != C_SUCCESS) {
+                return status;
+            }
+
+            r.eval      = strtod( field[4], NULL );
+            r.bit_score = strtod( field[5], NULL );
+            r.bias      = strtod( field[6], NULL );
+
+            if ((status = c_hits_describe( h, r.s_id, n == 18 ? rest : "" )) != C_SUCCESS) {
+                return status;
+            }
+            break;
+
+        default:
+            n = c_hits_split( line, 0, field, 22, &rest );
+
+            if (n < 19) {
+                h->skipped++;
+                return C_EINVAL;
+            }
+
+            if ((status = c_hits_intern( h->names, field[0], &r.s_id )) != C_SUCCESS ||
+                (status = c_hits_intern( h->accs,  field[1], &r.s_acc )) != C_SUCCESS ||
+                (status = c_hits_intern( h->names, field[3], &r.q_id )) != C_SUCCESS ||
+                (status = c_hits_intern( h->accs,  field[4], &r.q_acc )) != C_SUCCESS) {
+                return status;
+            }
+
+            r.s_len     = c_hits_uint( field[2] );
+            r.q_len     = c_hits_uint( field[5] );
+            r.eval      = strtod( field[6], NULL );
+            r.bit_score = strtod( field[7], NULL );
+            r.bias      = strtod( field[8], NULL );
+            r.dom_num   = c_hits_uint( field[9] );
+            r.s_beg     = c_hits_uint( field[15] );
+            r.s_end     = c_hits_uint( field[16] );
+            r.q_beg     = c_hits_uint( field[17] );
+            r.q_end     = c_hits_uint( field[18] );
+
+            if ((status = c_hits_describe( h, r.s_id, n == 22 ? rest : "" )) != C_SUCCESS) {
+                return status;
+            }
+    }
+
+    /* group key: the query name, with the domain number appended */
+    size_t      key_len = 0;
+    const char* key = c_intern_name( h->names, r.q_id, &key_len );
+
+    if (h->group_by == C_HIT_BY_QUERY_DOMAIN) {
+        char* buf = c_hits_scratch( h, key_len + 16 );
+
+        if (buf == NULL) {
+            return C_ENOMEM;
+        }
+
+        memcpy( buf, key, key_len );
+        key_len += (size_t) snprintf( buf + key_len, 16, "\t%u", r.dom_num );
+        key      = buf;
+    }
+
+    const int64_t group = c_intern_add( h->groups, key, key_len );
+
+    if (group < 0 || c_hits_reserve_groups( h, (size_t) group + 1 ) != C_SUCCESS) {
+        return C_ENOMEM;
+    }
+
+    /* a table read after its records were handed out */
+    if (h->sorted) {
+        c_hits_unsort( h );
+    }
+
+    c_hits_offer( h, (size_t) group, &r );
+
+    return C_SUCCESS;
+}
+
+int64_t
+c_hits_read( HitTable* h, const char* path ) {
+    const int use_stdin = strcmp( path, "-" ) == 0;
+    FILE*     fp        = use_stdin ? stdin : fopen( path, "r" );
+
+    /* left to the caller to report */
+    if (fp == NULL) {
+        return -1;
+    }
+
+    const uint64_t before = h->lines;
+
+    char*   buf = NULL;
+    size_t  cap = 0;
+    ssize_t len;
+    int     status = C_SUCCESS;
+
+    while ((len = getline( &buf, &cap, fp )) >= 0) {
+        status = c_hits_add_line( h, buf, (size_t) len );
+
+        /* malformed lines are counted and passed over */
+        if (status != C_SUCCESS && status != C_EINVAL) {
+            break;
+        }
+
+        status = C_SUCCESS;
+    }
+
+    free( buf );
+
+    if (!use_stdin) {
+        fclose( fp );
+    }
+
+    return status == C_SUCCESS ? (int64_t) (h->lines - before) : -1;
+}
+
+static int
+c_hits_cmp( const void* a, const void* b ) {
+    const HitRecord* x = (const HitRecord*) a;
+    const HitRecord* y = (const HitRecord*) b;
+
+    return c_hits_better( x, y ) ? -1 : c_hits_better( y, x ) ? 1 : 0;
+}
+
+void
+c_hits_sort( HitTable* h ) {
+    if (h->sorted) {
+        return;
+    }
+
+    const size_t groups = c_intern_size( h->groups );
+
+    size_t g;
+    for (g = 0; g < groups; g++) {
+        qsort( h->heap + g * h->top_n, h->count[ g ], sizeof(HitRecord), &c_hits_cmp );
+    }
+
+    h->sorted = 1;
+}
+
+size_t
+c_hits_groups( HitTable* h ) {
+    return c_intern_size( h->groups );
+}
+
+size_t
+c_hits_count( HitTable* h, size_t group ) {
+    return group < c_intern_size( h->groups ) ? h->count[ group ] : 0;
+}
+
+HitRecord*
+c_hits_get( HitTable* h, size_t group, size_t k ) {
+    if (k >= c_hits_count( h, group )) {
+        return NULL;
+    }
+
+    c_hits_sort( h );
+
+    return h->heap + group * h->top_n + k;
+}
+
+HitRecord*
+c_hits_next( HitTable* h ) {
+    const size_t groups = c_intern_size( h->groups );
+
+    while (h->next_group < groups) {
+        if (h->next_k < h->count[ h->next_group ]) {
+            return c_hits_get( h, h->next_group, h->next_k++ );
+        }
+
+        h->next_group++;
+        h->next_k = 0;
+    }
+
+    return NULL;
+}
+
+void
+c_hits_rewind( HitTable* h ) {
+    h->next_group = 0;
+    h->next_k     = 0;
+}
@@ -0,0 +1,535 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "error.h"
+#include "threads.h"
+#include "image.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define C_IMG_X86 1
+#include <immintrin.h>
+#endif
+
+/* Toroidal image filtering.
+ *
+ * All kernels are separable, or sums of separable parts, so a 2-D
+ * convolution is a pass along the rows and one down the columns. Along
+ * a row the row is first copied into a buffer padded with the wrapped
+ * pixels of the other end; down the columns whole wrapped rows are
+ * added up. Either way the inner loop is a contiguous multiply-add over
+ * a row, which is what the SIMD kernel does. Rows are spread over the
+ * threads in bands
+ */
+
+#define C_IMG_BAND 16    /* rows per job */
+
+static const double c_img_smooth[ 5 ] = { 1.0 / 16, 4.0 / 16, 6.0 / 16, 4.0 / 16, 1.0 / 16 };
+static const double c_img_diff[ 5 ]   = { 1.0, 2.0, 0.0, -2.0, -1.0 };
+
+/* dst[c] (+)= sum over t of k[t] * src[c + t] */
+typedef void ( *img_kernel ) ( const double* src, double* dst, size_t n, const double* k, size_t taps, int add );
+
+static void
+c_img_kernel_generic( const double* restrict src, double* restrict dst, size_t n,
+                      const double* k, size_t taps, int add ) {
+    size_t c, t;
+
+    for (c = 0; c < n; c++) {
+        double sum = add ? dst[ c ] : 0.0;
+
+        for (t = 0; t < taps; t++) {
+            sum += k[ t ] * src[ c + t ];
+        }
+
+        dst[ c ] = sum;
+    }
+}
+
+#ifdef C_IMG_X86
+__attribute__((target("avx2,fma")))
+static void
+c_img_kernel_avx2( const double* restrict src, double* restrict dst, size_t n,
+                   const double* k, size_t taps, int add ) {
+    size_t c = 0, t;
+
+    for (; c + 8 <= n; c += 8) {
+        __m256d a0 = add ? _mm256_loadu_pd( dst + c )     : _mm256_setzero_pd();
+        __m256d a1 = add ? _mm256_loadu_pd( dst + c + 4 ) : _mm256_setzero_pd();
+
+        for (t = 0; t < taps; t++) {
+            const __m256d kt = _mm256_broadcast_sd( k + t );
+
+            a0 = _mm256_fmadd_pd( kt, _mm256_loadu_pd( src + c + t ), a0 );
+            a1 = _mm256_fmadd_pd( kt, _mm256_loadu_pd( src + c + t + 4 ), a1 );
+        }
+
+        _mm256_storeu_pd( dst + c, a0 );
+        _mm256_storeu_pd( dst + c + 4, a1 );
+    }
+
+    c_img_kernel_generic( src + c, dst + c, n - c, k, taps, add );
+}
+#endif
+
+static img_kernel c_img_kernel = NULL;
+
+static img_kernel
+c_img_get_kernel( void ) {
+    if (c_img_kernel == NULL) {
+        img_kernel f = &c_img_kernel_generic;
+
+#ifdef C_IMG_X86
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            f = &c_img_kernel_avx2;
+        }
+#endif
+        c_img_kernel = f;
+    }
+
+    return c_img_kernel;
+}
+
+static size_t
+c_img_wrap( size_t i, long d, size_t n ) {
+    long j = ((long) i + d) % (long) n;
+    return (size_t) (j < 0 ? j + (long) n : j);
+}
+
+/* row r filtered along its length by a taps wide kernel centred on the
+   pixel, into dst */
+static void
+c_img_row_pass( const double* img, size_t r, size_t C, const double* k, size_t taps, int add, double* dst ) {
+    const size_t h   = taps / 2;
+    const double* row = img + r * C;
+    double* pad       = c_thread_scratch( C + taps );
+
+    size_t c;
+    for (c = 0; c < h; c++) {
+        pad[ c ]         = row[ c_img_wrap( c, -(long) h, C ) ];
+        pad[ h + C + c ] = row[ c_img_wrap( c, 0, C ) ];
+    }
+
+    memcpy( pad + h, row, C * sizeof(double) );
+
+    ( *c_img_kernel ) ( pad, dst, C, k, taps, add );
+}
+
+/* row r of img filtered down the columns by a taps high kernel */
+static void
+c_img_column_pass( const double* img, size_t r, size_t R, size_t C, const double* k, size_t taps, double* dst ) {
+    const size_t h = taps / 2;
+    size_t t;
+
+    for (t = 0; t < taps; t++) {
+        const double* src = img + c_img_wrap( r, (long) t - (long) h, R ) * C;
+        ( *c_img_kernel ) ( src, dst, C, k + t, 1, t > 0 );
+    }
+}
+
+/* one job of several passes over bands of rows */
+struct img_job_struct
+{
+    const double* in;
+    double*       tmp;
+    double*       tmp2;
+    double*       out;
+    int*          dir;
+    size_t        R;
+    size_t        C;
+
+    /* per band */
+    double*       min;
+    double*       max;
+    uint64_t*     hist;
+
+    double        scale;
+    double        shift;
+    double        threshold;
+};
+
+typedef struct img_job_struct ImgJob;
+
+static size_t
+c_img_bands( size_t R ) {
+    return (R + C_IMG_BAND - 1) / C_IMG_BAND;
+}
+
+#define C_IMG_FOR_ROWS( job, b0, b1, r ) \
+    for (r = (b0) * C_IMG_BAND; r < (b1) * C_IMG_BAND && r < (job)->R; r++)
+
+/* blur: rows into tmp */
+static void
+c_img_blur_rows( size_t b0, size_t b1, void* arg ) {
+    ImgJob* job = (ImgJob*) arg;
+    size_t  r;
+
+    C_IMG_FOR_ROWS( job, b0, b1, r ) {
+        c_img_row_pass( job->in, r, job->C, c_img_smooth, 5, 0, job->tmp + r * job->C );
+    }
+}
+
+/* blur: columns of tmp into out */
+static void
+c_img_blur_columns( size_t b0, size_t b1, void* arg ) {
+    ImgJob* job = (ImgJob*) arg;
+    size_t  r;
+
+    C_IMG_FOR_ROWS( job, b0, b1, r ) {
+        c_img_column_pass( job->tmp, r, job->R, job->C, c_img_smooth, 5, job->out + r * job->C );
+    }
+}
+
+int
+c_img_blur( const double* in, double* out, size_t R, size_t C ) {
+    if (R == 0 || C == 0) {
+        return C_SUCCESS;
+    }
+
+    double* tmp = (double*) malloc( R * C * sizeof(double) );
+
+    if (tmp == NULL) {
+        C_ERROR("Failed to allocate image", C_ENOMEM);
+    }
+
+    ImgJob job = { 0 };
+    job.in  = in;
+    job.tmp = tmp;
+    job.out = out;
+    job.R   = R;
+    job.C   = C;
+
+    c_img_get_kernel();
+    c_parallel_for( c_img_bands( R ), 1, &c_img_blur_rows, &job );
+    c_parallel_for( c_img_bands( R ), 1, &c_img_blur_columns, &job );
+
+    free( tmp );
+
+    return C_SUCCESS;
+}
+
+/* 0.5 1 0.5 above and below, 1 -6 1 across */
+static void
+c_img_enhance_rows( size_t b0, size_t b1, void* arg ) {
+    static const double side[ 3 ]   = { 0.5, 1.0, 0.5 };
+    static const double centre[ 3 ] = { 1.0, -6.0, 1.0 };
+
+    ImgJob* job = (ImgJob*) arg;
+    const size_t R = job->R, C = job->C;
+    size_t r;
+
+    C_IMG_FOR_ROWS( job, b0, b1, r ) {
+        double* dst = job->out + r * C;
+
+        c_img_row_pass( job->in, r, C, centre, 3, 0, dst );
+        c_img_row_pass( job->in, c_img_wrap( r, -1, R ), C, side, 3, 1, dst );
+        c_img_row_pass( job->in, c_img_wrap( r,  1, R ), C, side, 3, 1, dst );
+    }
+}
+
+int
+c_img_enhance( const double* in, double* out, size_t R, size_t C ) {
+    ImgJob job = { 0 };
+    job.in  = in;
+    job.out = out;
+    job.R   = R;
+    job.C   = C;
+
+    c_img_get_kernel();
+
+    return c_parallel_for( c_img_bands( R ), 1, &c_img_enhance_rows, &job );
+}
+
+/* Sobel, first pass: every row differentiated (tmp) and smoothed
+   (tmp2) along its length */
+static void
+c_img_sobel_rows( size_t b0, size_t b1, void* arg ) {
+    ImgJob* job = (ImgJob*) arg;
+    size_t  r;
+
+    C_IMG_FOR_ROWS( job, b0, b1, r ) {
+        c_img_row_pass( job->in, r, job->C, c_img_diff, 5, 0, job->tmp + r * job->C );
+        c_img_row_pass( job->in, r, job->C, c_img_smooth, 5, 0, job->tmp2 + r * job->C );
+    }
+}
+
+/* Sobel, second pass: the other way down the columns, then magnitude,
+   direction and the range of magnitudes of each band */
+static void
+c_img_sobel_columns( size_t b0, size_t b1, void* arg ) {
+    ImgJob* job = (ImgJob*) arg;
+    const size_t C = job->C;
+
+    double* gx = c_thread_scratch( 2 * C );
+    double* gy = gx + C;
+    size_t  b, r, c;
+
+    for (b = b0; b < b1; b++) {
+        double lo = INFINITY, hi = -INFINITY;
+
+        C_IMG_FOR_ROWS( job, b, b + 1, r ) {
+            c_img_column_pass( job->tmp, r, job->R, C, c_img_smooth, 5, gx );
+            c_img_column_pass( job->tmp2, r, job->R, C, c_img_diff, 5, gy );
+
+            for (c = 0; c < C; c++) {
+                const double m = sqrt( gx[ c ] * gx[ c ] + gy[ c ] * gy[ c ] );
+
+                if (job->out) {
+                    job->out[ r * C + c ] = m;
+                }
+
+                if (job->dir) {
+                    const int d = (int) (4.0 * (atan2( gy[ c ], gx[ c ] ) + M_PI) / M_PI);
+                    job->dir[ r * C + c ] = d & 7;
+                }
+
+                if (m < lo) lo = m;
+                if (m > hi) hi = m;
+            }
+        }
+
+        if (job->min) {
+            job->min[ b ] = lo;
+            job->max[ b ] = hi;
+        }
+    }
+}
+
+static void
+c_img_sobel_run( ImgJob* job ) {
+    const size_t B = c_img_bands( job->R );
+
+    c_img_get_kernel();
+    c_parallel_for( B, 1, &c_img_sobel_rows, job );
+    c_parallel_for( B, 1, &c_img_sobel_columns, job );
+}
+
+int
+c_img_sobel( const double* in, double* magnitude, int* direction, size_t R, size_t C ) {
+    if (R == 0 || C == 0) {
+        return C_SUCCESS;
+    }
+
+    double* tmp = (double*) malloc( 2 * R * C * sizeof(double) );
+
+    if (tmp == NULL) {
+        C_ERROR("Failed to allocate image", C_ENOMEM);
+    }
+
+    ImgJob job = { 0 };
+    job.in   = in;
+    job.tmp  = tmp;
+    job.tmp2 = tmp + R * C;
+    job.out  = magnitude;
+    job.dir  = direction;
+    job.R    = R;
+    job.C    = C;
+
+    c_img_sobel_run( &job );
+
+    free( tmp );
+
+    return C_SUCCESS;
+}
+
+static int
+c_img_bin( double v ) {
+    return ((int) (255.0 * v)) & 0xFF;
+}
+
+void
+c_img_histogram( const double* in, size_t n, uint64_t* hist ) {
+    size_t i;
+
+    memset( hist, 0, 256 * sizeof(uint64_t) );
+
+    for (i = 0; i < n; i++) {
+        hist[ c_img_bin( in[ i ] ) ]++;
+    }
+}
+
+double
+c_img_otsu( const uint64_t* hist ) {
+    double sum = 0.0, total = 0.0;
+    int    t;
+
+    for (t = 0; t < 256; t++) {
+        sum   += (double) t * (double) hist[ t ];
+        total += (double) hist[ t ];
+    }
+
+    double sumB = 0.0, wB = 0.0, var_max = 0.0;
+    int    threshold = 0;
+
+    for (t = 0; t < 256; t++) {
+        wB += (double) hist[ t ];
+
+        if (wB == 0.0) {
+            continue;
+        }
+
+        const double wF = total - wB;
+
+        if (wF == 0.0) {
+            break;
+        }
+
+        sumB += (double) t * (double) hist[ t ];
+
+        const double mB  = sumB / wB;
+        const double mF  = (sum - sumB) / wF;
+        const double var = wB * wF * (mB - mF) * (mB - mF);
+
+        if (var > var_max) {
+            var_max   = var;
+            threshold = t;
+        }
+    }
+
+    return threshold / 255.0;
+}
+
+/* magnitudes scaled to [0, 1] and counted by band */
+static void
+c_img_scale_bands( size_t b0, size_t b1, void* arg ) {
+    ImgJob* job = (ImgJob*) arg;
+    size_t  b, r, c;
+
+    for (b = b0; b < b1; b++) {
+        uint64_t* hist = job->hist + 256 * b;
+
+        C_IMG_FOR_ROWS( job, b, b + 1, r ) {
+            double* m = job->out + r * job->C;
+
+            for (c = 0; c < job->C; c++) {
+                m[ c ] = (m[ c ] - job->shift) * job->scale;
+                hist[ c_img_bin( m[ c ] ) ]++;
+            }
+        }
+    }
+}
+
+/* neighbour in direction d, as (row, column) steps. Opposite
+   directions are 4 apart */
+static const int c_img_step[ 8 ][ 2 ] = {
+    {  1,  0 }, {  1, -1 }, {  0, -1 }, { -1, -1 },
+    { -1,  0 }, { -1,  1 }, {  0,  1 }, {  1,  1 }
+};
+
+/* non-maximum suppression */
+static void
+c_img_suppress_bands( size_t b0, size_t b1, void* arg ) {
+    ImgJob* job = (ImgJob*) arg;
+    const size_t R = job->R, C = job->C;
+    size_t r, c;
+
+    C_IMG_FOR_ROWS( job, b0, b1, r ) {
+        for (c = 0; c < C; c++) {
+            const double m = job->out[ r * C + c ];
+            const int    d = job->dir[ r * C + c ];
+
+            const int* f = c_img_step[ d ];
+            const int* b = c_img_step[ (d + 4) & 7 ];
+
+            const double mf = job->out[ c_img_wrap( r, f[0], R ) * C + c_img_wrap( c, f[1], C ) ];
+            const double mb = job->out[ c_img_wrap( r, b[0], R ) * C + c_img_wrap( c, b[1], C ) ];
+
+            if (!(m > mf && m > mb && m > job->threshold)) {
+                job->dir[ r * C + c ] = C_IMG_NO_EDGE;
+            }
+        }
+    }
+}
+
+double
+c_img_edges( const double* in, size_t R, size_t C, int blur, double threshold,
+             double* magnitude, int* mask, uint64_t* hist ) {
+    const size_t N = R * C;
+    const size_t B = c_img_bands( R );
+
+    if (N == 0) {
+        return threshold < 0.0 ? 0.0 : threshold;
+    }
+
+    double*   buf    = (double*) malloc( (blur ? 3 : 2) * N * sizeof(double) );
+    double*   mag    = magnitude ? magnitude : (double*) malloc( N * sizeof(double) );
+    double*   range  = (double*) malloc( 2 * B * sizeof(double) );
+    uint64_t* bhist  = (uint64_t*) calloc( 256 * B, sizeof(uint64_t) );
+
+    if (buf == NULL || mag == NULL || range == NULL || bhist == NULL) {
+        C_ERROR_VAL("Failed to allocate image", C_ENOMEM, -1.0);
+    }
+
+    ImgJob job = { 0 };
+    job.R = R;
+    job.C = C;
+
+    c_img_get_kernel();
+
+    if (blur) {
+        job.in  = in;
+        job.tmp = buf;
+        job.out = buf + 2 * N;
+        c_parallel_for( B, 1, &c_img_blur_rows, &job );
+        c_parallel_for( B, 1, &c_img_blur_columns, &job );
+
+        in = buf + 2 * N;
+    }
+
+    /* gradient and range by band */
+    job.in   = in;
+    job.tmp  = buf;
+    job.tmp2 = buf + N;
+    job.out  = mag;
+    job.dir  = mask;
+    job.min  = range;
+    job.max  = range + B;
+
+    c_img_sobel_run( &job );
+
+    double lo = INFINITY, hi = -INFINITY;
+    size_t b;
+
+    for (b = 0; b < B; b++) {
+        if (range[ b ] < lo)     lo = range[ b ];
+        if (range[ B + b ] > hi) hi = range[ B + b ];
+    }
+
+    /* scaled, then counted in the same pass */
+    job.shift = lo;
+    job.scale = hi > lo ? 1.0 / (hi - lo) : 0.0;
+    job.hist  = bhist;
+
+    c_parallel_for( B, 1, &c_img_scale_bands, &job );
+
+    uint64_t total[ 256 ] = { 0 };
+    size_t t;
+
+    for (b = 0; b < B; b++) {
+        for (t = 0; t < 256; t++) {
+            total[ t ] += bhist[ 256 * b + t ];
+        }
+    }
+
+    if (threshold < 0.0) {
+        threshold = c_img_otsu( total );
+    }
+
+    if (hist) {
+        memcpy( hist, total, sizeof(total) );
+    }
+
+    job.threshold = threshold;
+
+    c_parallel_for( B, 1, &c_img_suppress_bands, &job );
+
+    free( buf );
+    free( range );
+    free( bhist );
+
+    if (mag != magnitude) {
+        free( mag );
+    }
+
+    return threshold;
+}
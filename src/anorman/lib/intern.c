@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "error.h"
+#include "intern.h"
+
+/* String interning.
+ *
+ * Node names, sequence ids and other keys are turned into dense integer
+ * ids once, so that everything downstream can use flat arrays indexed by
+ * id instead of hashes keyed by strings. Lookups hash the string with
+ * FNV-1a and probe a power of two table of ids linearly; the table is
+ * kept at most half full
+ */
+
+static inline uint32_t
+c_intern_hash( const char* s, size_t len ) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    size_t i;
+    for (i = 0; i < len; i++) {
+        h ^= (unsigned char) s[ i ];
+        h *= 0x100000001b3ULL;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+
+    return (uint32_t) h;
+}
+
+StrIntern*
+c_intern_alloc( size_t capacity ) {
+    StrIntern* si = (StrIntern*) calloc( 1, sizeof(StrIntern) );
+
+    if (si == NULL) {
+        C_ERROR_NULL("Failed to allocate string table", C_ENOMEM);
+    }
+
+    if (capacity < 16) {
+        capacity = C_INTERN_DEFAULT_CAPACITY;
+    }
+
+    size_t n_slots = 16;
+    while (n_slots < 2 * capacity) {
+        n_slots <<= 1;
+    }
+
+    si->capacity       = capacity;
+    si->arena_capacity = capacity * 16;
+    si->n_slots        = n_slots;
+
+    si->arena   = (char*)     malloc( si->arena_capacity );
+    si->offsets = (size_t*)   malloc( capacity * sizeof(size_t) );
+    si->lengths = (uint32_t*) malloc( capacity * sizeof(uint32_t) );
+    si->hashes  = (uint32_t*) malloc( capacity * sizeof(uint32_t) );
+    si->slots   = (uint32_t*) calloc( n_slots, sizeof(uint32_t) );
+
+    if (!si->arena || !si->offsets || !si->lengths || !si->hashes || !si->slots) {
+        c_intern_free( si );
+        C_ERROR_NULL("Failed to allocate string table", C_ENOMEM);
+    }
+
+    return si;
+}
+
+void
+c_intern_free( StrIntern* si ) {
+    if (si == NULL) {
+        return;
+    }
+
+    free( si->arena );
+    free( si->offsets );
+    free( si->lengths );
+    free( si->hashes );
+    free( si->slots );
+    free( si );
+}
+
+size_t
+c_intern_size( StrIntern* si ) {
+    return si->size;
+}
+
+const char*
+c_intern_name( StrIntern* si, size_t id, size_t* len ) {
+    if (id >= si->size) {
+        return NULL;
+    }
+
+    if (len) {
+        *len = si->lengths[ id ];
+    }
+
+    return si->arena + si->offsets[ id ];
+}
+
+/* slot of a string, or of the free slot where it belongs */
+static size_t
+c_intern_probe( StrIntern* si, const char* s, size_t len, uint32_t h ) {
+    const size_t mask = si->n_slots - 1;
+    size_t       i    = h & mask;
+
+    while (si->slots[ i ]) {
+        const size_t id = si->slots[ i ] - 1;
+
+        if (si->hashes[ id ] == h && si->lengths[ id ] == len
+            && memcmp( si->arena + si->offsets[ id ], s, len ) == 0) {
+            break;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return i;
+}
+
+int64_t
+c_intern_lookup( StrIntern* si, const char* s, size_t len ) {
+    const size_t i = c_intern_probe( si, s, len, c_intern_hash( s, len ) );
+    return si->slots[ i ] ? (int64_t) si->slots[ i ] - 1 : -1;
+}
+
+static int
+c_intern_rehash( StrIntern* si ) {
+    const size_t n_slots = si->n_slots << 1;
+    uint32_t*    slots   = (uint32_t*) calloc( n_slots, sizeof(uint32_t) );
+
+    if (slots == NULL) {
+        C_ERROR("Failed to grow string table", C_ENOMEM);
+    }
+
+    size_t id;
+    for (id = 0; id < si->size; id++) {
+        size_t i = si->hashes[ id ] & (n_slots - 1);
+
+        while (slots[ i ]) {
+            i = (i + 1) & (n_slots - 1);
+        }
+
+        slots[ i ] = (uint32_t) (id + 1);
+    }
+
+    free( si->slots );
+    si->slots   = slots;
+    si->n_slots = n_slots;
+
+    return C_SUCCESS;
+}
+
+static int
+c_intern_reserve( StrIntern* si, size_t len ) {
+    if (si->size == si->capacity) {
+        const size_t capacity = si->capacity + si->capacity / 2;
+
+        size_t* offsets = (size_t*) realloc( si->offsets, capacity * sizeof(size_t) );
+
+        if (offsets == NULL) {
+            C_ERROR("Failed to grow string table", C_ENOMEM);
+        }
+
+        si->offsets = offsets;
+
+        uint32_t* lengths = (uint32_t*) realloc( si->lengths, capacity * sizeof(uint32_t) );
+
+        if (lengths == NULL) {
+            C_ERROR("Failed to grow string table", C_ENOMEM);
+        }
+
+        si->lengths = lengths;
+
+        uint32_t* hashes = (uint32_t*) realloc( si->hashes, capacity * sizeof(uint32_t) );
+
+        if (hashes == NULL) {
+            C_ERROR("Failed to grow string table", C_ENOMEM);
+        }
+
+        si->hashes   = hashes;
+        si->capacity = capacity;
+    }
+
+    if (si->arena_size + len + 1 > si->arena_capacity) {
+        size_t capacity = si->arena_capacity + si->arena_capacity / 2;
+
+        if (capacity < si->arena_size + len + 1) {
+            capacity = si->arena_size + len + 1;
+        }
+
+        char* arena = (char*) realloc( si->arena, capacity );
+
+        if (arena == NULL) {
+            C_ERROR("Failed to grow string arena", C_ENOMEM);
+        }
+
+        si->arena          = arena;
+        si->arena_capacity = capacity;
+    }
+
+    return C_SUCCESS;
+}
+
+int64_t
+c_intern_add( StrIntern* si, const char* s, size_t len ) {
+    const uint32_t h = c_intern_hash( s, len );
+    size_t         i = c_intern_probe( si, s, len, h );
+
+    if (si->slots[ i ]) {
+        return (int64_t) si->slots[ i ] - 1;
+    }
+
+    if (si->size >= UINT32_MAX - 1 || c_intern_reserve( si, len ) != C_SUCCESS) {
+        return -1;
+    }
+
+    const size_t id = si->size++;
+
+    memcpy( si->arena + si->arena_size, s, len );
+    si->arena[ si->arena_size + len ] = '\0';
+
+    si->offsets[ id ] = si->arena_size;
+    si->lengths[ id ] = (uint32_t) len;
+    si->hashes[ id ]  = h;
+    si->arena_size   += len + 1;
+
+    si->slots[ i ] = (uint32_t) (id + 1);
+
+    if (2 * si->size > si->n_slots && c_intern_rehash( si ) != C_SUCCESS) {
+        return -1;
+    }
+
+    return (int64_t) id;
+}
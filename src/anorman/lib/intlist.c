@@ -0,0 +1,384 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "data.h"
+#include "error.h"
+#include "map.h"
+#include "rng.h"
+#include "intlist.h"
+
+/* Growable lists of 32 or 64 bit integers.
+ *
+ * Bestmatch arrays, permutations and data keys hold one small integer
+ * per data row. As Perl arrays that is an SV of 24+ bytes per row; here
+ * it is 4 (or 8) bytes in one flat buffer that grows by half its size
+ * when full, so pushes are amortized O(1). Lookups by value go through
+ * an optional IntDoubleMap from value to first position, which is kept
+ * up to date by push and rebuilt lazily after anything that moves cells.
+ * The map (map.o) is linked from libandata, modules including this file
+ * do not include map.c themselves
+ */
+
+size_t
+c_il_width( int type ) {
+    return type == C_IL_INT64 ? sizeof(int64_t) : sizeof(int32_t);
+}
+
+IntList*
+c_il_alloc( int type, size_t capacity ) {
+    if (type != C_IL_INT32 && type != C_IL_INT64 && type != C_IL_UINT32) {
+        C_ERROR_NULL("Illegal integer list type", C_EINVAL);
+    }
+
+    IntList* l = (IntList*) calloc( 1, sizeof(IntList) );
+
+    if (l == NULL) {
+        C_ERROR_NULL("Failed to allocate integer list", C_ENOMEM);
+    }
+
+    l->type = type;
+
+    if (c_il_reserve( l, capacity ? capacity : C_IL_DEFAULT_CAPACITY ) != C_SUCCESS) {
+        free( l );
+        return NULL;
+    }
+
+    return l;
+}
+
+void
+c_il_free( IntList* l ) {
+    if (l == NULL) {
+        return;
+    }
+
+    c_idm_free( l->index );
+    free( l->elements );
+    free( l );
+}
+
+IntList*
+c_il_copy( IntList* l ) {
+    IntList* copy = c_il_alloc( l->type, l->size );
+
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    memcpy( copy->elements, l->elements, l->size * c_il_width( l->type ) );
+    copy->size = l->size;
+
+    if (l->index) {
+        c_il_use_index( copy, 1 );
+    }
+
+    return copy;
+}
+
+int
+c_il_reserve( IntList* l, size_t n ) {
+    if (n <= l->capacity) {
+        return C_SUCCESS;
+    }
+
+    const size_t width = c_il_width( l->type );
+
+    if (n > SIZE_MAX / width) {
+        C_ERROR("Integer list is too large", C_EINVAL);
+    }
+
+    void* elements = realloc( l->elements, n * width );
+
+    if (elements == NULL) {
+        C_ERROR("Failed to grow integer list", C_ENOMEM);
+    }
+
+    l->elements = elements;
+    l->capacity = n;
+
+    return C_SUCCESS;
+}
+
+/* new cells are zero */
+int
+c_il_resize( IntList* l, size_t n ) {
+    const size_t width = c_il_width( l->type );
+
+    if (n > l->size) {
+        int status = c_il_reserve( l, n );
+
+        if (status != C_SUCCESS) {
+            return status;
+        }
+
+        memset( (char*) l->elements + l->size * width, 0, (n - l->size) * width );
+    }
+
+    l->size        = n;
+    l->index_stale = 1;
+
+    return C_SUCCESS;
+}
+
+void
+c_il_clear( IntList* l ) {
+    l->size = 0;
+
+    if (l->index) {
+        c_idm_clear( l->index );
+        l->index_stale = 0;
+    }
+}
+
+int64_t
+c_il_get( IntList* l, size_t i ) {
+    switch (l->type) {
+        case C_IL_INT64:
+            return ((int64_t*) l->elements)[ i ];
+        case C_IL_UINT32:
+            return (int64_t) ((uint32_t*) l->elements)[ i ];
+        default:
+            return (int64_t) ((int32_t*) l->elements)[ i ];
+    }
+}
+
+static inline void
+c_il_store( IntList* l, size_t i, int64_t x ) {
+    switch (l->type) {
+        case C_IL_INT64:
+            ((int64_t*) l->elements)[ i ] = x;
+            break;
+        case C_IL_UINT32:
+            ((uint32_t*) l->elements)[ i ] = (uint32_t) x;
+            break;
+        default:
+            ((int32_t*) l->elements)[ i ] = (int32_t) x;
+    }
+}
+
+/* x as it reads back from a cell */
+static inline int64_t
+c_il_convert( IntList* l, int64_t x ) {
+    switch (l->type) {
+        case C_IL_INT64:
+            return x;
+        case C_IL_UINT32:
+            return (int64_t) (uint32_t) x;
+        default:
+            return (int64_t) (int32_t) x;
+    }
+}
+
+void
+c_il_set( IntList* l, size_t i, int64_t x ) {
+    c_il_store( l, i, x );
+    l->index_stale = 1;
+}
+
+int
+c_il_push( IntList* l, int64_t x ) {
+    if (l->size == l->capacity) {
+        const size_t grow = l->capacity / 2 > C_IL_DEFAULT_CAPACITY ? l->capacity / 2 : C_IL_DEFAULT_CAPACITY;
+        int status = c_il_reserve( l, l->capacity + grow );
+
+        if (status != C_SUCCESS) {
+            return status;
+        }
+    }
+
+    c_il_store( l, l->size, x );
+
+    /* the first occurrence of a value does not move */
+    if (l->index && !l->index_stale) {
+        const size_t key = (size_t) c_il_get( l, l->size );
+
+        if (!c_idm_contains( l->index, key )) {
+            c_idm_put( l->index, key, (double) (l->size + 1) );
+        }
+    }
+
+    l->size++;
+
+    return C_SUCCESS;
+}
+
+int64_t
+c_il_pop( IntList* l ) {
+    if (l->size == 0) {
+        C_ERROR_VAL("Cannot pop an empty list", C_EINVAL, 0);
+    }
+
+    l->size--;
+    l->index_stale = 1;
+
+    return c_il_get( l, l->size );
+}
+
+int
+c_il_fill_range( IntList* l, int64_t start, size_t n ) {
+    int status = c_il_reserve( l, n );
+
+    if (status != C_SUCCESS) {
+        return status;
+    }
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        c_il_store( l, i, start + (int64_t) i );
+    }
+
+    l->size        = n;
+    l->index_stale = 1;
+
+    return C_SUCCESS;
+}
+
+int
+c_il_assign_bytes( IntList* l, const char* bytes, size_t length ) {
+    const size_t width = c_il_width( l->type );
+
+    if (length % width != 0) {
+        C_ERROR("Packed data is not a whole number of cells", C_EBADLEN);
+    }
+
+    int status = c_il_reserve( l, length / width );
+
+    if (status != C_SUCCESS) {
+        return status;
+    }
+
+    memcpy( l->elements, bytes, length );
+
+    l->size        = length / width;
+    l->index_stale = 1;
+
+    return C_SUCCESS;
+}
+
+static int
+c_il_rebuild_index( IntList* l ) {
+    c_idm_clear( l->index );
+
+    /* backwards, so the first occurrence wins */
+    size_t i = l->size;
+    while (i-- > 0) {
+        int status = c_idm_put( l->index, (size_t) c_il_get( l, i ), (double) (i + 1) );
+
+        if (status != C_SUCCESS) {
+            return status;
+        }
+    }
+
+    l->index_stale = 0;
+
+    return C_SUCCESS;
+}
+
+int
+c_il_use_index( IntList* l, int flag ) {
+    if (!flag) {
+        c_idm_free( l->index );
+        l->index = NULL;
+        return C_SUCCESS;
+    }
+
+    if (l->index == NULL) {
+        l->index = c_idm_alloc( 2 * l->size + C_IDM_DEFAULT_CAPACITY, C_IDM_DEFAULT_MIN_LOAD_FACTOR,
+                                C_IDM_DEFAULT_MAX_LOAD_FACTOR );
+
+        if (l->index == NULL) {
+            return C_ENOMEM;
+        }
+
+        l->index_stale = 1;
+    }
+
+    return C_SUCCESS;
+}
+
+ptrdiff_t
+c_il_index_of( IntList* l, int64_t x ) {
+    size_t i;
+
+    /* values are compared after conversion to the cell type */
+    x = c_il_convert( l, x );
+
+    if (l->index) {
+        if (l->index_stale && c_il_rebuild_index( l ) != C_SUCCESS) {
+            return -1;
+        }
+
+        const double pos = c_idm_get( l->index, (size_t) x );
+
+        return pos > 0.0 ? (ptrdiff_t) pos - 1 : -1;
+    }
+
+    for (i = 0; i < l->size; i++) {
+        if (c_il_get( l, i ) == x) {
+            return (ptrdiff_t) i;
+        }
+    }
+
+    return -1;
+}
+
+static int
+c_il_cmp_int32( const void* a, const void* b ) {
+    const int32_t x = *(const int32_t*) a, y = *(const int32_t*) b;
+    return (x > y) - (x < y);
+}
+
+static int
+c_il_cmp_int64( const void* a, const void* b ) {
+    const int64_t x = *(const int64_t*) a, y = *(const int64_t*) b;
+    return (x > y) - (x < y);
+}
+
+static int
+c_il_cmp_uint32( const void* a, const void* b ) {
+    const uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+    return (x > y) - (x < y);
+}
+
+void
+c_il_sort( IntList* l ) {
+    switch (l->type) {
+        case C_IL_INT64:
+            qsort( l->elements, l->size, sizeof(int64_t), &c_il_cmp_int64 );
+            break;
+        case C_IL_UINT32:
+            qsort( l->elements, l->size, sizeof(uint32_t), &c_il_cmp_uint32 );
+            break;
+        default:
+            qsort( l->elements, l->size, sizeof(int32_t), &c_il_cmp_int32 );
+    }
+
+    l->index_stale = 1;
+}
+
+/* Fisher-Yates on a Philox stream, so the same (seed, stream) gives the
+   same permutation. uint32 lists are shuffled in place without conversion */
+void
+c_il_shuffle( IntList* l, uint64_t seed, uint64_t stream ) {
+    if (l->type == C_IL_UINT32 && l->size <= UINT32_MAX) {
+        c_rng_shuffle_u32( (uint32_t*) l->elements, l->size, seed, stream );
+        l->index_stale = 1;
+        return;
+    }
+
+    Rng r;
+    c_rng_init( &r, seed, stream );
+
+    size_t i;
+    for (i = l->size; i > 1; i--) {
+        const size_t j = i <= UINT32_MAX ? c_rng_bounded( &r, (uint32_t) i )
+                                         : (size_t) (c_rng_next_u64( &r ) % i);
+
+        const int64_t tmp = c_il_get( l, i - 1 );
+        c_il_store( l, i - 1, c_il_get( l, j ) );
+        c_il_store( l, j, tmp );
+    }
+
+    l->index_stale = 1;
+}
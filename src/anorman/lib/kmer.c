@@ -0,0 +1,1071 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "threads.h"
+#include "kmer.h"
+
+/* Canonical k-mer counting.
+ *
+ * A batch of queued sequences is cut into one chunk per thread. Each
+ * chunk is scanned with rolling forward and reverse complement codes
+ * (uint64_t for k <= 31, unsigned __int128 above) and every canonical
+ * k-mer is binned by the hash of its minimizer, the smallest canonical
+ * m-mer inside it. A k-mer and its reverse complement share their
+ * minimizer, and neighbouring k-mers mostly do, so runs of a sequence
+ * land in the same bin.
+ *
+ * Counting gives every bin its own linear probing table. With at least
+ * as many bins as threads, the threads take whole bins and never share
+ * a table; otherwise each bin is filled by all threads at once. Slots
+ * are claimed and counts incremented with compare-and-swap either way,
+ * so the same table code serves both
+ */
+
+#define C_KMER_EMPTY     UINT64_MAX
+#define C_KMER_BUSY      (UINT64_MAX - 1)
+
+#define C_KMER_BATCH     (16 << 20)    /* queued bases per scan */
+#define C_KMER_MINIMIZER 11
+
+typedef unsigned __int128 kmer128_t;
+
+/* 1 + code, 0 for anything but ACGT */
+static const uint8_t c_kmer_base[ 256 ] = {
+    ['A'] = 1, ['C'] = 2, ['G'] = 3, ['T'] = 4,
+    ['a'] = 1, ['c'] = 2, ['g'] = 3, ['t'] = 4
+};
+
+static inline uint64_t
+c_kmer_mix( uint64_t x ) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t
+c_kmer_hash( const uint64_t* key, size_t words ) {
+    return words == 1 ? c_kmer_mix( key[0] ) : c_kmer_mix( key[0] ^ c_kmer_mix( key[1] ) );
+}
+
+static inline int
+c_kmer_cmp( const uint64_t* a, const uint64_t* b, size_t words ) {
+    size_t w;
+    for (w = 0; w < words; w++) {
+        if (a[w] != b[w]) {
+            return a[w] < b[w] ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+#define C_KMER_STORE_64( keys, j, v )  (keys)[ (j) ] = (v)
+
+#define C_KMER_STORE_128( keys, j, v )                   \
+    do {                                                 \
+        (keys)[ 2 * (j) ]     = (uint64_t) ((v) >> 64);  \
+        (keys)[ 2 * (j) + 1 ] = (uint64_t) (v);          \
+    } while (0)
+
+/* Canonical k-mers of s into keys and, unless parts is NULL, their
+   partitions. The minimizer is kept as a monotone queue of m-mer hashes
+   over the k - m + 1 m-mers of the current k-mer. Returns the k-mers */
+#define C_KMER_SCAN( name, type, STORE )                                            \
+static size_t                                                                       \
+name( const KmerCounter* kc, const uint8_t* s, size_t n, uint64_t* keys, uint32_t* parts ) { \
+    const size_t   k      = kc->k;                                                  \
+    const size_t   m      = kc->m;                                                  \
+    const size_t   w      = k - m + 1;                                              \
+    const type     mask   = ((type) 1 << (2 * k)) - 1;                             \
+    const uint64_t m_mask = ((uint64_t) 1 << (2 * m)) - 1;                          \
+                                                                                    \
+    type     fwd = 0, rev = 0;                                                      \
+    uint64_t m_fwd = 0, m_rev = 0;                                                  \
+    size_t   len = 0, j = 0;                                                        \
+                                                                                    \
+    uint64_t q_hash[ 64 ];                                                          \
+    size_t   q_pos[ 64 ];                                                           \
+    size_t   head = 0, tail = 0;                                                    \
+                                                                                    \
+    size_t i;                                                                       \
+    for (i = 0; i < n; i++) {                                                       \
+        const uint8_t b = c_kmer_base[ s[i] ];                                      \
+                                                                                    \
+        if (b == 0) {                                                               \
+            len  = 0;                                                               \
+            head = tail = 0;                                                        \
+            continue;                                                               \
+        }                                                                           \
+                                                                                    \
+        const uint64_t c = b - 1;                                                   \
+                                                                                    \
+        fwd = ((fwd << 2) | (type) c) & mask;                                       \
+        rev = (rev >> 2) | ((type) (3 - c) << (2 * (k - 1)));                       \
+        len++;                                                                      \
+                                                                                    \
+        if (parts) {                                                                \
+            m_fwd = ((m_fwd << 2) | c) & m_mask;                                    \
+            m_rev = (m_rev >> 2) | ((3 - c) << (2 * (m - 1)));                      \
+                                                                                    \
+            if (len >= m) {                                                         \
+                const uint64_t h = c_kmer_mix( m_fwd < m_rev ? m_fwd : m_rev );     \
+                                                                                    \
+                while (tail != head && q_hash[ (tail - 1) & 63 ] >= h) tail--;      \
+                q_hash[ tail & 63 ] = h;                                            \
+                q_pos[ tail & 63 ]  = i;                                            \
+                tail++;                                                             \
+                                                                                    \
+                while (q_pos[ head & 63 ] + w <= i) head++;                         \
+            }                                                                       \
+        }                                                                           \
+                                                                                    \
+        if (len >= k) {                                                             \
+            const type canon = fwd < rev ? fwd : rev;                               \
+                                                                                    \
+            STORE( keys, j, canon );                                                \
+                                                                                    \
+            if (parts) {                                                            \
+                parts[ j ] = (uint32_t) ((q_hash[ head & 63 ] >> 32) % kc->parts);  \
+            }                                                                       \
+                                                                                    \
+            j++;                                                                    \
+        }                                                                           \
+    }                                                                               \
+                                                                                    \
+    return j;                                                                       \
+}
+
+C_KMER_SCAN( c_kmer_scan_64,  uint64_t,  C_KMER_STORE_64 )
+C_KMER_SCAN( c_kmer_scan_128, kmer128_t, C_KMER_STORE_128 )
+
+static size_t
+c_kmer_scan( const KmerCounter* kc, const char* s, size_t n, uint64_t* keys, uint32_t* parts ) {
+    return kc->words == 1 ? c_kmer_scan_64( kc, (const uint8_t*) s, n, keys, parts )
+                          : c_kmer_scan_128( kc, (const uint8_t*) s, n, keys, parts );
+}
+
+KmerCounter*
+c_kc_alloc( size_t k, size_t parts, size_t memory, const char* spill_dir ) {
+    if (k == 0 || k > C_KMER_MAX_K) {
+        C_ERROR_NULL("k-mer size out of range", C_EINVAL);
+    }
+
+    KmerCounter* kc = (KmerCounter*) calloc( 1, sizeof(KmerCounter) );
+
+    if (kc == NULL) {
+        C_ERROR_NULL("Failed to allocate k-mer counter", C_ENOMEM);
+    }
+
+    kc->k      = k;
+    kc->words  = k <= C_KMER_MAX_K64 ? 1 : 2;
+    kc->m      = k < C_KMER_MINIMIZER ? k : C_KMER_MINIMIZER;
+    kc->parts  = parts ? parts : 1;
+    kc->memory = memory;
+
+    kc->bin          = (uint64_t**) calloc( kc->parts, sizeof(uint64_t*) );
+    kc->bin_n        = (size_t*)    calloc( kc->parts, sizeof(size_t) );
+    kc->bin_capacity = (size_t*)    calloc( kc->parts, sizeof(size_t) );
+    kc->spill_n      = (size_t*)    calloc( kc->parts, sizeof(size_t) );
+
+    if (kc->bin == NULL || kc->bin_n == NULL || kc->bin_capacity == NULL || kc->spill_n == NULL) {
+        c_kc_free( kc );
+        C_ERROR_NULL("Failed to allocate k-mer counter", C_ENOMEM);
+    }
+
+    if (spill_dir != NULL) {
+        const size_t len = strlen( spill_dir ) + 64;
+
+        if ((kc->spill_path = (char*) malloc( len )) == NULL) {
+            c_kc_free( kc );
+            C_ERROR_NULL("Failed to allocate k-mer counter", C_ENOMEM);
+        }
+
+        snprintf( kc->spill_path, len, "%s/an_kmers.%ld.%p", spill_dir, (long) getpid(), (void*) kc );
+    }
+
+    return kc;
+}
+
+static void
+c_kmer_spill_name( KmerCounter* kc, size_t p, char* name, size_t len ) {
+    snprintf( name, len, "%s.%zu", kc->spill_path, p );
+}
+
+void
+c_kc_free( KmerCounter* kc ) {
+    if (kc == NULL) {
+        return;
+    }
+
+    size_t p;
+    for (p = 0; kc->bin && p < kc->parts; p++) {
+        free( kc->bin[ p ] );
+
+        if (kc->spill_n && kc->spill_n[ p ]) {
+            char name[ 4096 ];
+            c_kmer_spill_name( kc, p, name, sizeof(name) );
+            unlink( name );
+        }
+    }
+
+    free( kc->bin );
+    free( kc->bin_n );
+    free( kc->bin_capacity );
+    free( kc->spill_n );
+    free( kc->spill_path );
+
+    free( kc->seqs );
+    free( kc->seq_end );
+
+    free( kc->keys );
+    free( kc->counts );
+
+    free( kc );
+}
+
+/* growable k-mer bins of one scan chunk */
+struct kmer_bins_struct
+{
+    uint64_t** bin;
+    size_t*    n;
+    size_t*    capacity;
+    uint64_t*  keys;            /* scan scratch */
+    uint32_t*  parts;
+    size_t     scratch;
+    int        status;
+};
+
+typedef struct kmer_bins_struct KmerBins;
+
+struct kmer_batch_struct
+{
+    KmerCounter* kc;
+    KmerBins*    bins;
+    size_t*      first;         /* sequence range of every chunk */
+};
+
+typedef struct kmer_batch_struct KmerBatch;
+
+static int
+c_kmer_bin_reserve( uint64_t** bin, size_t* capacity, size_t n ) {
+    if (n <= *capacity) {
+        return C_SUCCESS;
+    }
+
+    size_t c = *capacity ? *capacity : 1024;
+    while (c < n) c *= 2;
+
+    uint64_t* b = (uint64_t*) realloc( *bin, c * sizeof(uint64_t) );
+
+    if (b == NULL) {
+        return C_ENOMEM;
+    }
+
+    *bin      = b;
+    *capacity = c;
+
+    return C_SUCCESS;
+}
+
+static void
+c_kmer_scan_chunks( size_t begin, size_t end, void* arg ) {
+    KmerBatch*   batch = (KmerBatch*) arg;
+    KmerCounter* kc    = batch->kc;
+    const size_t W     = kc->words;
+
+    size_t t;
+    for (t = begin; t < end; t++) {
+        KmerBins* bins = batch->bins + t;
+
+        size_t i;
+        for (i = batch->first[ t ]; i < batch->first[ t + 1 ] && bins->status == C_SUCCESS; i++) {
+            const size_t from = i ? kc->seq_end[ i - 1 ] : 0;
+            const size_t len  = kc->seq_end[ i ] - from;
+
+            if (len > bins->scratch) {
+                free( bins->keys );
+                free( bins->parts );
+
+                bins->keys    = (uint64_t*) malloc( len * W * sizeof(uint64_t) );
+                bins->parts   = (uint32_t*) malloc( len * sizeof(uint32_t) );
+                bins->scratch = len;
+
+                if (bins->keys == NULL || bins->parts == NULL) {
+                    bins->scratch = 0;
+                    bins->status  = C_ENOMEM;
+                    break;
+                }
+            }
+
+            const size_t n = c_kmer_scan( kc, kc->seqs + from, len, bins->keys, bins->parts );
+
+            size_t j;
+            for (j = 0; j < n; j++) {
+                const uint32_t p = bins->parts[ j ];
+
+                if (c_kmer_bin_reserve( bins->bin + p, bins->capacity + p, (bins->n[ p ] + 1) * W ) != C_SUCCESS) {
+                    bins->status = C_ENOMEM;
+                    break;
+                }
+
+                memcpy( bins->bin[ p ] + bins->n[ p ] * W, bins->keys + j * W, W * sizeof(uint64_t) );
+                bins->n[ p ]++;
+            }
+        }
+    }
+}
+
+static int
+c_kmer_spill( KmerCounter* kc ) {
+    const size_t W = kc->words;
+
+    size_t p;
+    for (p = 0; p < kc->parts; p++) {
+        if (kc->bin_n[ p ] == 0) {
+            continue;
+        }
+
+        char name[ 4096 ];
+        c_kmer_spill_name( kc, p, name, sizeof(name) );
+
+        FILE* fp = fopen( name, "ab" );
+
+        if (fp == NULL) {
+            return C_EFAULT;
+        }
+
+        const size_t written = fwrite( kc->bin[ p ], W * sizeof(uint64_t), kc->bin_n[ p ], fp );
+
+        if (fclose( fp ) != 0 || written != kc->bin_n[ p ]) {
+            return C_EFAULT;
+        }
+
+        kc->spill_n[ p ] += kc->bin_n[ p ];
+        kc->bin_n[ p ]    = 0;
+    }
+
+    return C_SUCCESS;
+}
+
+/* scan the queued sequences into the bins */
+static int
+c_kmer_flush( KmerCounter* kc ) {
+    if (kc->n_seqs == 0) {
+        return C_SUCCESS;
+    }
+
+    const size_t W = kc->words;
+    const size_t P = kc->parts;
+
+    size_t T = c_num_threads();
+    if (T > kc->n_seqs) T = kc->n_seqs;
+
+    KmerBatch batch;
+    batch.kc    = kc;
+    batch.bins  = (KmerBins*) calloc( T, sizeof(KmerBins) );
+    batch.first = (size_t*)   calloc( T + 1, sizeof(size_t) );
+
+    if (batch.bins == NULL || batch.first == NULL) {
+        free( batch.bins );
+        free( batch.first );
+        C_ERROR("Failed to allocate k-mer scan", C_ENOMEM);
+    }
+
+    /* chunks of about the same number of bases */
+    size_t i, t = 1;
+    for (i = 0; i < kc->n_seqs && t < T; i++) {
+        if (kc->seq_end[ i ] * T >= t * kc->seqs_size) {
+            batch.first[ t++ ] = i + 1;
+        }
+    }
+
+    while (t <= T) {
+        batch.first[ t++ ] = kc->n_seqs;
+    }
+
+    int status = C_SUCCESS;
+
+    for (t = 0; t < T; t++) {
+        batch.bins[ t ].bin      = (uint64_t**) calloc( P, sizeof(uint64_t*) );
+        batch.bins[ t ].n        = (size_t*)    calloc( P, sizeof(size_t) );
+        batch.bins[ t ].capacity = (size_t*)    calloc( P, sizeof(size_t) );
+
+        if (batch.bins[ t ].bin == NULL || batch.bins[ t ].n == NULL || batch.bins[ t ].capacity == NULL) {
+            status = C_ENOMEM;
+        }
+    }
+
+    if (status == C_SUCCESS) {
+        status = c_parallel_for( T, 1, &c_kmer_scan_chunks, &batch );
+    }
+
+    /* chunk bins onto the partition bins, in chunk order */
+    size_t p;
+    for (t = 0; t < T; t++) {
+        KmerBins* bins = batch.bins + t;
+
+        if (status == C_SUCCESS) {
+            status = bins->status;
+        }
+
+        for (p = 0; bins->bin && p < P; p++) {
+            if (status == C_SUCCESS && bins->n[ p ]) {
+                status = c_kmer_bin_reserve( kc->bin + p, kc->bin_capacity + p, (kc->bin_n[ p ] + bins->n[ p ]) * W );
+
+                if (status == C_SUCCESS) {
+                    memcpy( kc->bin[ p ] + kc->bin_n[ p ] * W, bins->bin[ p ], bins->n[ p ] * W * sizeof(uint64_t) );
+                    kc->bin_n[ p ] += bins->n[ p ];
+                    kc->total      += bins->n[ p ];
+                }
+            }
+
+            free( bins->bin[ p ] );
+        }
+
+        free( bins->bin );
+        free( bins->n );
+        free( bins->capacity );
+        free( bins->keys );
+        free( bins->parts );
+    }
+
+    free( batch.bins );
+    free( batch.first );
+
+    kc->seqs_size = 0;
+    kc->n_seqs    = 0;
+
+    if (status != C_SUCCESS) {
+        C_ERROR("Failed to bin k-mers", status);
+    }
+
+    if (kc->memory && kc->spill_path) {
+        size_t bytes = 0;
+
+        for (p = 0; p < P; p++) {
+            bytes += kc->bin_n[ p ] * W * sizeof(uint64_t);
+        }
+
+        if (bytes > kc->memory) {
+            return c_kmer_spill( kc );
+        }
+    }
+
+    return C_SUCCESS;
+}
+
+int
+c_kc_add( KmerCounter* kc, const char* s, size_t n ) {
+    if (kc->counted) {
+        return C_EINVAL;
+    }
+
+    if (kc->seqs_size + n > kc->seqs_capacity) {
+        size_t c = kc->seqs_capacity ? kc->seqs_capacity : 1 << 20;
+        while (c < kc->seqs_size + n) c *= 2;
+
+        char* b = (char*) realloc( kc->seqs, c );
+
+        if (b == NULL) {
+            C_ERROR("Failed to queue sequence", C_ENOMEM);
+        }
+
+        kc->seqs          = b;
+        kc->seqs_capacity = c;
+    }
+
+    if (kc->n_seqs == kc->seq_capacity) {
+        const size_t c = kc->seq_capacity ? 2 * kc->seq_capacity : 1024;
+        size_t*      e = (size_t*) realloc( kc->seq_end, c * sizeof(size_t) );
+
+        if (e == NULL) {
+            C_ERROR("Failed to queue sequence", C_ENOMEM);
+        }
+
+        kc->seq_end      = e;
+        kc->seq_capacity = c;
+    }
+
+    memcpy( kc->seqs + kc->seqs_size, s, n );
+    kc->seqs_size += n;
+    kc->seq_end[ kc->n_seqs++ ] = kc->seqs_size;
+
+    return kc->seqs_size >= C_KMER_BATCH ? c_kmer_flush( kc ) : C_SUCCESS;
+}
+
+/* open addressing table of one partition */
+struct kmer_table_struct
+{
+    uint64_t* keys;             /* capacity x words, C_KMER_EMPTY first word when free */
+    uint32_t* counts;
+    size_t    capacity;
+    size_t    words;
+    int       status;
+};
+
+typedef struct kmer_table_struct KmerTable;
+
+static int
+c_kmer_table_add( KmerTable* t, const uint64_t* key ) {
+    const size_t W    = t->words;
+    const size_t mask = t->capacity - 1;
+
+    size_t slot = (size_t) c_kmer_hash( key, W ) & mask;
+    size_t probes;
+
+    for (probes = 0; probes < t->capacity; probes++, slot = (slot + 1) & mask) {
+        uint64_t* cell = t->keys + slot * W;
+        uint64_t  head = __atomic_load_n( cell, __ATOMIC_ACQUIRE );
+
+        if (head == C_KMER_EMPTY) {
+            /* two word keys are claimed first and published whole */
+            const uint64_t claim = W == 1 ? key[0] : C_KMER_BUSY;
+
+            if (__atomic_compare_exchange_n( cell, &head, claim, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE )) {
+                if (W == 2) {
+                    cell[1] = key[1];
+                    __atomic_store_n( cell, key[0], __ATOMIC_RELEASE );
+                }
+
+                head = key[0];
+            }
+        }
+
+        while (head == C_KMER_BUSY) {
+            head = __atomic_load_n( cell, __ATOMIC_ACQUIRE );
+        }
+
+        if (head == key[0] && (W == 1 || cell[1] == key[1])) {
+            uint32_t c = __atomic_load_n( t->counts + slot, __ATOMIC_RELAXED );
+
+            while (c != UINT32_MAX &&
+                   !__atomic_compare_exchange_n( t->counts + slot, &c, c + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED ))
+                ;
+
+            return C_SUCCESS;
+        }
+    }
+
+    return C_ENOMEM;
+}
+
+struct kmer_fill_struct
+{
+    KmerTable*      table;
+    const uint64_t* bin;
+};
+
+typedef struct kmer_fill_struct KmerFill;
+
+static void
+c_kmer_fill_range( size_t begin, size_t end, void* arg ) {
+    KmerFill*    fill = (KmerFill*) arg;
+    const size_t W    = fill->table->words;
+
+    size_t i;
+    for (i = begin; i < end; i++) {
+        if (c_kmer_table_add( fill->table, fill->bin + i * W ) != C_SUCCESS) {
+            fill->table->status = C_ENOMEM;
+            return;
+        }
+    }
+}
+
+/* sorted distinct k-mers of every partition, merged at the end */
+struct kmer_runs_struct
+{
+    KmerCounter* kc;
+    uint64_t**   keys;
+    uint32_t**   counts;
+    size_t*      n;
+    int          parallel;      /* fill each table with all threads */
+    int          status;
+};
+
+typedef struct kmer_runs_struct KmerRuns;
+
+/* keys, and records led by their key, in ascending order */
+static int
+c_kmer_cmp_64( const void* a, const void* b ) {
+    const uint64_t x = *(const uint64_t*) a;
+    const uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+static int
+c_kmer_cmp_128( const void* a, const void* b ) {
+    return c_kmer_cmp( (const uint64_t*) a, (const uint64_t*) b, 2 );
+}
+
+static int
+c_kmer_count_part( KmerRuns* runs, size_t p ) {
+    KmerCounter* kc = runs->kc;
+    const size_t W  = kc->words;
+
+    /* spilled k-mers come back behind the ones in memory */
+    if (kc->spill_n[ p ]) {
+        const size_t n = kc->bin_n[ p ] + kc->spill_n[ p ];
+
+        if (c_kmer_bin_reserve( kc->bin + p, kc->bin_capacity + p, n * W ) != C_SUCCESS) {
+            return C_ENOMEM;
+        }
+
+        char name[ 4096 ];
+        c_kmer_spill_name( kc, p, name, sizeof(name) );
+
+        FILE* fp = fopen( name, "rb" );
+
+        if (fp == NULL) {
+            return C_EFAULT;
+        }
+
+        const size_t got = fread( kc->bin[ p ] + kc->bin_n[ p ] * W, W * sizeof(uint64_t), kc->spill_n[ p ], fp );
+        fclose( fp );
+        unlink( name );
+
+        if (got != kc->spill_n[ p ]) {
+            return C_EFAULT;
+        }
+
+        kc->bin_n[ p ]  += kc->spill_n[ p ];
+        kc->spill_n[ p ] = 0;
+    }
+
+    const size_t n = kc->bin_n[ p ];
+
+    /* at most half full, and no larger than the k-mer space */
+    size_t capacity = 64;
+    while (capacity < 2 * n && (kc->k >= 31 || capacity < ((size_t) 1 << (2 * kc->k)))) {
+        capacity *= 2;
+    }
+
+    KmerTable table;
+    table.words    = W;
+    table.capacity = capacity;
+    table.status   = C_SUCCESS;
+    table.keys     = (uint64_t*) malloc( capacity * W * sizeof(uint64_t) );
+    table.counts   = (uint32_t*) calloc( capacity, sizeof(uint32_t) );
+
+    if (table.keys == NULL || table.counts == NULL) {
+        free( table.keys );
+        free( table.counts );
+        return C_ENOMEM;
+    }
+
+    memset( table.keys, 0xFF, capacity * W * sizeof(uint64_t) );
+
+    KmerFill fill = { &table, kc->bin[ p ] };
+
+    /* a table short of the threads that failed to start is incomplete */
+    int status = C_SUCCESS;
+
+    if (runs->parallel) {
+        status = c_parallel_for( n, 65536, &c_kmer_fill_range, &fill );
+    } else {
+        c_kmer_fill_range( 0, n, &fill );
+    }
+
+    if (status == C_SUCCESS) {
+        status = table.status;
+    }
+
+    free( kc->bin[ p ] );
+    kc->bin[ p ]          = NULL;
+    kc->bin_n[ p ]        = 0;
+    kc->bin_capacity[ p ] = 0;
+
+    if (status != C_SUCCESS) {
+        free( table.keys );
+        free( table.counts );
+        return status;
+    }
+
+    /* the used slots as records of key words + count, sorted and split
+       again */
+    const size_t R = W + 1;
+    size_t       used = 0, s;
+
+    for (s = 0; s < capacity; s++) {
+        used += table.counts[ s ] != 0;
+    }
+
+    uint64_t* records = (uint64_t*) malloc( (used ? used : 1) * R * sizeof(uint64_t) );
+
+    if (records == NULL) {
+        free( table.keys );
+        free( table.counts );
+        return C_ENOMEM;
+    }
+
+    for (s = 0, used = 0; s < capacity; s++) {
+        if (table.counts[ s ]) {
+            memcpy( records + used * R, table.keys + s * W, W * sizeof(uint64_t) );
+            records[ used * R + W ] = table.counts[ s ];
+            used++;
+        }
+    }
+
+    free( table.keys );
+    free( table.counts );
+
+    qsort( records, used, R * sizeof(uint64_t), W == 1 ? &c_kmer_cmp_64 : &c_kmer_cmp_128 );
+
+    runs->keys[ p ]   = (uint64_t*) malloc( (used ? used : 1) * W * sizeof(uint64_t) );
+    runs->counts[ p ] = (uint32_t*) malloc( (used ? used : 1) * sizeof(uint32_t) );
+    runs->n[ p ]      = used;
+
+    if (runs->keys[ p ] == NULL || runs->counts[ p ] == NULL) {
+        free( records );
+        return C_ENOMEM;
+    }
+
+    for (s = 0; s < used; s++) {
+        memcpy( runs->keys[ p ] + s * W, records + s * R, W * sizeof(uint64_t) );
+        runs->counts[ p ][ s ] = (uint32_t) records[ s * R + W ];
+    }
+
+    free( records );
+
+    return C_SUCCESS;
+}
+
+static void
+c_kmer_count_parts( size_t begin, size_t end, void* arg ) {
+    KmerRuns* runs = (KmerRuns*) arg;
+
+    size_t p;
+    for (p = begin; p < end; p++) {
+        const int status = c_kmer_count_part( runs, p );
+
+        if (status != C_SUCCESS) {
+            runs->status = status;
+        }
+    }
+}
+
+/* k-way merge of the partition runs, which never share a k-mer */
+static int
+c_kmer_merge( KmerCounter* kc, KmerRuns* runs ) {
+    const size_t W = kc->words;
+    const size_t P = kc->parts;
+
+    size_t total = 0, p;
+    for (p = 0; p < P; p++) {
+        total += runs->n[ p ];
+    }
+
+    kc->keys   = (uint64_t*) malloc( (total ? total : 1) * W * sizeof(uint64_t) );
+    kc->counts = (uint32_t*) malloc( (total ? total : 1) * sizeof(uint32_t) );
+    size_t* at = (size_t*)   calloc( P, sizeof(size_t) );
+    size_t* heap = (size_t*) malloc( P * sizeof(size_t) );
+
+    if (kc->keys == NULL || kc->counts == NULL || at == NULL || heap == NULL) {
+        free( at );
+        free( heap );
+        return C_ENOMEM;
+    }
+
+#define C_KMER_HEAD( r ) (runs->keys[ (r) ] + at[ (r) ] * W)
+
+    size_t h = 0;
+    for (p = 0; p < P; p++) {
+        if (runs->n[ p ] == 0) {
+            continue;
+        }
+
+        /* sift up */
+        size_t c = h++;
+        heap[ c ] = p;
+
+        while (c > 0 && c_kmer_cmp( C_KMER_HEAD( heap[ c ] ), C_KMER_HEAD( heap[ (c - 1) / 2 ] ), W ) < 0) {
+            const size_t x = heap[ c ]; heap[ c ] = heap[ (c - 1) / 2 ]; heap[ (c - 1) / 2 ] = x;
+            c = (c - 1) / 2;
+        }
+    }
+
+    size_t n = 0;
+
+    while (h > 0) {
+        const size_t r = heap[0];
+
+        memcpy( kc->keys + n * W, C_KMER_HEAD( r ), W * sizeof(uint64_t) );
+        kc->counts[ n++ ] = runs->counts[ r ][ at[ r ] ];
+
+        if (++at[ r ] == runs->n[ r ]) {
+            heap[0] = heap[ --h ];
+        }
+
+        /* sift down */
+        size_t c = 0;
+
+        for (;;) {
+            size_t l = 2 * c + 1, best = c;
+
+            if (l < h && c_kmer_cmp( C_KMER_HEAD( heap[ l ] ), C_KMER_HEAD( heap[ best ] ), W ) < 0) best = l;
+            if (l + 1 < h && c_kmer_cmp( C_KMER_HEAD( heap[ l + 1 ] ), C_KMER_HEAD( heap[ best ] ), W ) < 0) best = l + 1;
+            if (best == c) break;
+
+            const size_t x = heap[ c ]; heap[ c ] = heap[ best ]; heap[ best ] = x;
+            c = best;
+        }
+    }
+
+#undef C_KMER_HEAD
+
+    free( at );
+    free( heap );
+
+    kc->n = n;
+
+    return C_SUCCESS;
+}
+
+int
+c_kc_count( KmerCounter* kc ) {
+    if (kc->counted) {
+        return C_SUCCESS;
+    }
+
+    int status = c_kmer_flush( kc );
+
+    if (status != C_SUCCESS) {
+        return status;
+    }
+
+    const size_t P = kc->parts;
+
+    KmerRuns runs;
+    runs.kc       = kc;
+    runs.keys     = (uint64_t**) calloc( P, sizeof(uint64_t*) );
+    runs.counts   = (uint32_t**) calloc( P, sizeof(uint32_t*) );
+    runs.n        = (size_t*)    calloc( P, sizeof(size_t) );
+    runs.parallel = P < c_num_threads();
+    runs.status   = C_SUCCESS;
+
+    if (runs.keys == NULL || runs.counts == NULL || runs.n == NULL) {
+        status = C_ENOMEM;
+    } else if (runs.parallel) {
+        c_kmer_count_parts( 0, P, &runs );
+        status = runs.status;
+    } else {
+        status = c_parallel_for( P, 1, &c_kmer_count_parts, &runs );
+
+        if (status == C_SUCCESS) {
+            status = runs.status;
+        }
+    }
+
+    if (status == C_SUCCESS) {
+        status = c_kmer_merge( kc, &runs );
+    }
+
+    size_t p;
+    for (p = 0; runs.keys && p < P; p++) {
+        free( runs.keys[ p ] );
+        free( runs.counts[ p ] );
+    }
+
+    free( runs.keys );
+    free( runs.counts );
+    free( runs.n );
+
+    if (status == C_EFAULT) {
+        /* spill files, left for the caller to report */
+        return status;
+    }
+
+    if (status != C_SUCCESS) {
+        C_ERROR("Failed to count k-mers", status);
+    }
+
+    kc->counted = 1;
+
+    return C_SUCCESS;
+}
+
+/* count file: magic, k, words, distinct k-mers, k-mers seen, then the
+   keys and the counts */
+static const char c_kmer_magic[ 8 ] = "ANKMER1";
+
+int
+c_kc_save( KmerCounter* kc, const char* path ) {
+    if (!kc->counted) {
+        return C_EINVAL;
+    }
+
+    FILE* fp = fopen( path, "wb" );
+
+    if (fp == NULL) {
+        return C_EFAULT;
+    }
+
+    const uint64_t header[ 4 ] = { kc->k, kc->words, kc->n, kc->total };
+
+    int ok = fwrite( c_kmer_magic, sizeof(c_kmer_magic), 1, fp ) == 1
+          && fwrite( header, sizeof(header), 1, fp ) == 1
+          && fwrite( kc->keys, kc->words * sizeof(uint64_t), kc->n, fp ) == kc->n
+          && fwrite( kc->counts, sizeof(uint32_t), kc->n, fp ) == kc->n;
+
+    ok = (fclose( fp ) == 0) && ok;
+
+    return ok ? C_SUCCESS : C_EFAULT;
+}
+
+KmerCounter*
+c_kc_load( const char* path ) {
+    FILE* fp = fopen( path, "rb" );
+
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    char     magic[ 8 ];
+    uint64_t header[ 4 ];
+
+    if (fread( magic, sizeof(magic), 1, fp ) != 1 || memcmp( magic, c_kmer_magic, sizeof(magic) ) != 0 ||
+        fread( header, sizeof(header), 1, fp ) != 1 ||
+        header[0] == 0 || header[0] > C_KMER_MAX_K || header[1] != (header[0] <= C_KMER_MAX_K64 ? 1u : 2u)) {
+        fclose( fp );
+        return NULL;
+    }
+
+    /* the k-mer count must match what is left of the file, so a
+       truncated or corrupt file is never allocated for */
+    const long     start  = ftell( fp );
+    const uint64_t record = header[1] * sizeof(uint64_t) + sizeof(uint32_t);
+
+    if (start < 0 || fseek( fp, 0, SEEK_END ) != 0) {
+        fclose( fp );
+        return NULL;
+    }
+
+    const long end = ftell( fp );
+
+    if (end < start || header[2] != (uint64_t) (end - start) / record ||
+        (uint64_t) (end - start) % record != 0 || fseek( fp, start, SEEK_SET ) != 0) {
+        fclose( fp );
+        return NULL;
+    }
+
+    KmerCounter* kc = c_kc_alloc( (size_t) header[0], 1, 0, NULL );
+
+    if (kc == NULL) {
+        fclose( fp );
+        return NULL;
+    }
+
+    kc->n      = (size_t) header[2];
+    kc->total  = header[3];
+    kc->keys   = (uint64_t*) malloc( (kc->n ? kc->n : 1) * kc->words * sizeof(uint64_t) );
+    kc->counts = (uint32_t*) malloc( (kc->n ? kc->n : 1) * sizeof(uint32_t) );
+
+    if (kc->keys == NULL || kc->counts == NULL) {
+        fclose( fp );
+        c_kc_free( kc );
+        C_ERROR_NULL("Failed to allocate k-mer counts", C_ENOMEM);
+    }
+
+    const int ok = fread( kc->keys, kc->words * sizeof(uint64_t), kc->n, fp ) == kc->n
+                && fread( kc->counts, sizeof(uint32_t), kc->n, fp ) == kc->n;
+
+    fclose( fp );
+
+    if (!ok) {
+        c_kc_free( kc );
+        return NULL;
+    }
+
+    kc->counted = 1;
+
+    return kc;
+}
+
+int
+c_kc_encode( KmerCounter* kc, const char* s, size_t n, uint64_t* key ) {
+    if (n != kc->k) {
+        return C_EINVAL;
+    }
+
+    return c_kmer_scan( kc, s, n, key, NULL ) == 1 ? C_SUCCESS : C_EINVAL;
+}
+
+void
+c_kc_decode( KmerCounter* kc, const uint64_t* key, char* out ) {
+    const kmer128_t v = kc->words == 1 ? (kmer128_t) key[0] : ((kmer128_t) key[0] << 64) | key[1];
+
+    size_t i;
+    for (i = 0; i < kc->k; i++) {
+        out[i] = "ACGT"[ (unsigned) (v >> (2 * (kc->k - 1 - i))) & 3 ];
+    }
+}
+
+int64_t
+c_kc_find( KmerCounter* kc, const uint64_t* key ) {
+    size_t lo = 0, hi = kc->n;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        const int    c   = c_kmer_cmp( kc->keys + mid * kc->words, key, kc->words );
+
+        if (c == 0) {
+            return (int64_t) mid;
+        }
+
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return -1;
+}
+
+int64_t
+c_kc_row( KmerCounter* kc, const char* s, size_t len, uint32_t min_count, size_t* cols, double* vals ) {
+    const size_t W = kc->words;
+
+    if (!kc->counted) {
+        return -1;
+    }
+
+    uint64_t* keys = (uint64_t*) malloc( (len ? len : 1) * W * sizeof(uint64_t) );
+
+    if (keys == NULL) {
+        C_ERROR_VAL("Failed to allocate k-mer row", C_ENOMEM, -1);
+    }
+
+    const size_t n = c_kmer_scan( kc, s, len, keys, NULL );
+
+    qsort( keys, n, W * sizeof(uint64_t), W == 1 ? &c_kmer_cmp_64 : &c_kmer_cmp_128 );
+
+    int64_t nnz = 0;
+    size_t  i   = 0;
+
+    while (i < n) {
+        size_t j = i + 1;
+
+        while (j < n && c_kmer_cmp( keys + j * W, keys + i * W, W ) == 0) j++;
+
+        const int64_t r = c_kc_find( kc, keys + i * W );
+
+        if (r >= 0 && kc->counts[ r ] >= min_count) {
+            cols[ nnz ] = (size_t) r;
+            vals[ nnz ] = (double) (j - i);
+            nnz++;
+        }
+
+        i = j;
+    }
+
+    free( keys );
+
+    return nnz;
+}
@@ -0,0 +1,325 @@
+#include <stdlib.h>
+
+#include "lapack.h"
+
+#include "data.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "linalg/decomp.h"
+
+/* Matrix decompositions backed by LAPACK.
+ *
+ * Each routine copies its input into a column-major work buffer,
+ * hands it to LAPACK and writes the factors back in the same layout
+ * the pure-Perl decompositions in Data::LinAlg use, so either backend
+ * can sit behind the same object. The copies are O(n^2) against the
+ * O(n^3) factorizations and let views and strided matrices through.
+ *
+ * A positive return value is the LAPACK info code of a numerical
+ * failure (not positive definite, exactly singular, no convergence)
+ */
+
+static double*
+c_linalg_to_colmajor( Matrix* A ) {
+    const size_t M = A->rows;
+    const size_t N = A->columns;
+
+    double* buf = (double*) malloc( M * N * sizeof(double) );
+
+    if (buf == 0) {
+        C_ERROR_NULL("Failed to allocate LAPACK work space", C_ENOMEM);
+    }
+
+    size_t i, j;
+    for (j = 0; j < N; j++) {
+        for (i = 0; i < M; i++) {
+            buf[ i + j * M ] = c_m_get_quick( A, i, j );
+        }
+    }
+
+    return buf;
+}
+
+static void
+c_linalg_from_colmajor( const double* buf, size_t ld, Matrix* A ) {
+    size_t i, j;
+    for (i = 0; i < A->rows; i++) {
+        for (j = 0; j < A->columns; j++) {
+            c_m_set_quick( A, i, j, buf[ i + j * ld ] );
+        }
+    }
+}
+
+/* A <- L in the lower triangle and L' in the upper, A = LL' */
+int c_linalg_cholesky( Matrix* A ) {
+    if (A->rows != A->columns) {
+        C_ERROR("Matrix must be square", C_ENOTSQR);
+    }
+
+    const int n = (int) A->rows;
+    int info    = 0;
+
+    double* buf = c_linalg_to_colmajor( A );
+
+    dpotrf_( "L", &n, buf, &n, &info );
+
+    if (info < 0) {
+        free( buf );
+        C_ERROR("Invalid argument to dpotrf", C_EINVAL);
+    }
+
+    size_t i, j;
+    for (j = 0; j < (size_t) n; j++) {
+        for (i = j; i < (size_t) n; i++) {
+            const double L_ij = buf[ i + j * n ];
+
+            c_m_set_quick( A, i, j, L_ij );
+            c_m_set_quick( A, j, i, L_ij );
+        }
+    }
+
+    free( buf );
+
+    return info;
+}
+
+/* A <- LU with partial pivoting. perm[ i ] is the original row now in row i */
+int c_linalg_lu( Matrix* A, size_t* perm, int* signum ) {
+    if (A->rows != A->columns) {
+        C_ERROR("Matrix must be square", C_ENOTSQR);
+    }
+
+    const int n = (int) A->rows;
+    int info    = 0;
+
+    double* buf  = c_linalg_to_colmajor( A );
+    int*    ipiv = (int*) malloc( n * sizeof(int) );
+
+    if (ipiv == 0) {
+        free( buf );
+        C_ERROR("Failed to allocate pivot array", C_ENOMEM);
+    }
+
+    dgetrf_( &n, &n, buf, &n, ipiv, &info );
+
+    if (info < 0) {
+        free( buf );
+        free( ipiv );
+        C_ERROR("Invalid argument to dgetrf", C_EINVAL);
+    }
+
+    c_linalg_from_colmajor( buf, n, A );
+
+    /* replay the row interchanges to get a permutation */
+    size_t i;
+    for (i = 0; i < (size_t) n; i++) {
+        perm[ i ] = i;
+    }
+
+    *signum = 1;
+
+    for (i = 0; i < (size_t) n; i++) {
+        const size_t p = (size_t) ipiv[ i ] - 1;
+
+        if (p != i) {
+            size_t tmp = perm[ i ];
+            perm[ i ]  = perm[ p ];
+            perm[ p ]  = tmp;
+            *signum    = -*signum;
+        }
+    }
+
+    free( buf );
+    free( ipiv );
+
+    return info;
+}
+
+/* A <- R and the Householder vectors below the diagonal, as in the Perl
+   decomposition. tau must hold min(M,N) elements */
+int c_linalg_qr( Matrix* A, Vector* tau ) {
+    const int m = (int) A->rows;
+    const int n = (int) A->columns;
+    const int k = m < n ? m : n;
+
+    if (tau->size != (size_t) k) {
+        C_ERROR("tau must be of length min(rows,columns)", C_EBADLEN);
+    }
+
+    int    info  = 0;
+    int    lwork = -1;
+    double wsize;
+    double* t    = (double*) malloc( k * sizeof(double) );
+    double* buf  = c_linalg_to_colmajor( A );
+
+    /* work space query */
+    dgeqrf_( &m, &n, buf, &m, t, &wsize, &lwork, &info );
+
+    lwork = (int) wsize;
+    double* work = (double*) malloc( lwork * sizeof(double) );
+
+    if (t == 0 || work == 0) {
+        free( t );
+        free( buf );
+        free( work );
+        C_ERROR("Failed to allocate LAPACK work space", C_ENOMEM);
+    }
+
+    dgeqrf_( &m, &n, buf, &m, t, work, &lwork, &info );
+
+    if (info == 0) {
+        c_linalg_from_colmajor( buf, m, A );
+
+        size_t i;
+        for (i = 0; i < (size_t) k; i++) {
+            c_v_set_quick( tau, i, t[ i ] );
+        }
+    }
+
+    free( t );
+    free( buf );
+    free( work );
+
+    if (info < 0) {
+        C_ERROR("Invalid argument to dgeqrf", C_EINVAL);
+    }
+
+    return info;
+}
+
+/* eigenvalues of the symmetric matrix A in ascending order, eigenvectors
+   in the columns of V. A itself is left untouched */
+int c_linalg_symm_eigen( Matrix* A, Vector* eval, Matrix* V ) {
+    if (A->rows != A->columns) {
+        C_ERROR("Matrix must be square", C_ENOTSQR);
+    }
+
+    const int n = (int) A->rows;
+
+    if (eval->size != (size_t) n || V->rows != (size_t) n || V->columns != (size_t) n) {
+        C_ERROR("Result dimensions do not match matrix", C_EBADLEN);
+    }
+
+    int    info   = 0;
+    int    lwork  = -1;
+    int    liwork = -1;
+    int    isize;
+    double wsize;
+
+    double* w   = (double*) malloc( n * sizeof(double) );
+    double* buf = c_linalg_to_colmajor( A );
+
+    dsyevd_( "V", "L", &n, buf, &n, w, &wsize, &lwork, &isize, &liwork, &info );
+
+    lwork  = (int) wsize;
+    liwork = isize;
+
+    double* work  = (double*) malloc( lwork * sizeof(double) );
+    int*    iwork = (int*) malloc( liwork * sizeof(int) );
+
+    if (w == 0 || work == 0 || iwork == 0) {
+        free( w );
+        free( buf );
+        free( work );
+        free( iwork );
+        C_ERROR("Failed to allocate LAPACK work space", C_ENOMEM);
+    }
+
+    dsyevd_( "V", "L", &n, buf, &n, w, work, &lwork, iwork, &liwork, &info );
+
+    if (info == 0) {
+        c_linalg_from_colmajor( buf, n, V );
+
+        size_t i;
+        for (i = 0; i < (size_t) n; i++) {
+            c_v_set_quick( eval, i, w[ i ] );
+        }
+    }
+
+    free( w );
+    free( buf );
+    free( work );
+    free( iwork );
+
+    if (info < 0) {
+        C_ERROR("Invalid argument to dsyevd", C_EINVAL);
+    }
+
+    return info;
+}
+
+/* thin SVD, A = U diag(S) V'. With k = min(M,N), U is M x k, S has k
+   elements in descending order and V is N x k */
+int c_linalg_svd( Matrix* A, Vector* S, Matrix* U, Matrix* V ) {
+    const int m = (int) A->rows;
+    const int n = (int) A->columns;
+    const int k = m < n ? m : n;
+
+    if (S->size != (size_t) k || U->rows != (size_t) m || U->columns != (size_t) k
+     || V->rows != (size_t) n || V->columns != (size_t) k) {
+        C_ERROR("Result dimensions do not match matrix", C_EBADLEN);
+    }
+
+    int    info  = 0;
+    int    lwork = -1;
+    double wsize;
+
+    double* s     = (double*) malloc( k * sizeof(double) );
+    double* u     = (double*) malloc( (size_t) m * k * sizeof(double) );
+    double* vt    = (double*) malloc( (size_t) k * n * sizeof(double) );
+    int*    iwork = (int*) malloc( 8 * k * sizeof(int) );
+    double* buf   = c_linalg_to_colmajor( A );
+
+    if (s == 0 || u == 0 || vt == 0 || iwork == 0) {
+        free( s );
+        free( u );
+        free( vt );
+        free( iwork );
+        free( buf );
+        C_ERROR("Failed to allocate LAPACK work space", C_ENOMEM);
+    }
+
+    dgesdd_( "S", &m, &n, buf, &m, s, u, &m, vt, &k, &wsize, &lwork, iwork, &info );
+
+    lwork = (int) wsize;
+    double* work = (double*) malloc( lwork * sizeof(double) );
+
+    if (work != 0) {
+        dgesdd_( "S", &m, &n, buf, &m, s, u, &m, vt, &k, work, &lwork, iwork, &info );
+    }
+
+    if (work != 0 && info == 0) {
+        c_linalg_from_colmajor( u, m, U );
+
+        size_t i, j;
+        for (i = 0; i < (size_t) k; i++) {
+            c_v_set_quick( S, i, s[ i ] );
+        }
+
+        /* V = VT' */
+        for (i = 0; i < (size_t) n; i++) {
+            for (j = 0; j < (size_t) k; j++) {
+                c_m_set_quick( V, i, j, vt[ j + i * k ] );
+            }
+        }
+    }
+
+    free( s );
+    free( u );
+    free( vt );
+    free( iwork );
+    free( buf );
+
+    if (work == 0) {
+        C_ERROR("Failed to allocate LAPACK work space", C_ENOMEM);
+    }
+
+    free( work );
+
+    if (info < 0) {
+        C_ERROR("Invalid argument to dgesdd", C_EINVAL);
+    }
+
+    return info;
+}
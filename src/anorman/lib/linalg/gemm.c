@@ -0,0 +1,569 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#endif
+
+#include "error.h"
+#include "threads.h"
+#include "linalg/gemm.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define C_GEMM_X86 1
+#include <immintrin.h>
+#endif
+
+/* Packed, register-blocked matrix multiplication.
+ *
+ * Follows the usual GotoBLAS layering: B is cut into KC x NC panels
+ * that are packed into NR wide column strips, A into MC x KC blocks
+ * packed into MR high row strips, and an MR x NR micro-kernel walks a
+ * strip pair keeping its block of C in registers. The packed B panel
+ * lives in L3, the packed A block in L2 and one B strip in L1, so MC,
+ * KC and NC are derived from the cache sizes of the host. The MC loop
+ * is spread over the worker threads, each packing its own A block.
+ *
+ * c_gemm_autotune times a few blockings around the derived ones and
+ * keeps the fastest; c_gemm_save_params / c_gemm_load_params persist
+ * the result so it is only done once per host
+ */
+
+#define MR C_GEMM_MR
+#define NR C_GEMM_NR
+
+/* below this many multiply-adds threads are not worth starting */
+#define C_GEMM_PARALLEL_MIN 262144.0
+
+#define C_GEMM_ALIGN 64
+
+typedef void ( *gemm_kernel ) ( size_t kc, const double* a, const double* b, double* ab );
+
+static size_t      c_gemm_mc     = 0;
+static size_t      c_gemm_kc     = 0;
+static size_t      c_gemm_nc     = 0;
+static gemm_kernel c_gemm_kernel = NULL;
+
+static size_t
+c_gemm_round_up( size_t x, size_t m ) {
+    return ((x + m - 1) / m) * m;
+}
+
+static size_t
+c_gemm_round_down( size_t x, size_t m ) {
+    return x < m ? m : (x / m) * m;
+}
+
+/* size in bytes of the data cache at level 1-3, with common defaults
+   when the system will not tell */
+static size_t
+c_gemm_cache_size( int level ) {
+    long size = 0;
+
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+    switch (level) {
+        case 1: size = sysconf( _SC_LEVEL1_DCACHE_SIZE ); break;
+        case 2: size = sysconf( _SC_LEVEL2_CACHE_SIZE );  break;
+        case 3: size = sysconf( _SC_LEVEL3_CACHE_SIZE );  break;
+    }
+#elif defined(__APPLE__)
+    const char* name = level == 1 ? "hw.l1dcachesize" : level == 2 ? "hw.l2cachesize" : "hw.l3cachesize";
+    int64_t value = 0;
+    size_t  len   = sizeof(value);
+
+    if (sysctlbyname( name, &value, &len, NULL, 0 ) == 0) {
+        size = (long) value;
+    }
+#endif
+
+    if (size <= 0) {
+        size = level == 1 ? 32768 : level == 2 ? 262144 : 4194304;
+    }
+
+    return (size_t) size;
+}
+
+/* one B strip in half of L1, the A block in half of L2 and the B
+   panel in half of L3 */
+static void
+c_gemm_default_params( size_t* mc, size_t* kc, size_t* nc ) {
+    const size_t L1 = c_gemm_cache_size( 1 );
+    const size_t L2 = c_gemm_cache_size( 2 );
+    const size_t L3 = c_gemm_cache_size( 3 );
+
+    size_t k = (L1 / 2) / (NR * sizeof(double));
+
+    if (k < 32)   k = 32;
+    if (k > 1024) k = 1024;
+
+    *kc = k;
+    *mc = c_gemm_round_down( (L2 / 2) / (k * sizeof(double)), MR );
+    *nc = c_gemm_round_down( (L3 / 2) / (k * sizeof(double)), NR );
+}
+
+/* portable micro-kernel, ab <- sum over k of a(:,k) b(k,:) */
+static void
+c_gemm_kernel_generic( size_t kc, const double* restrict a, const double* restrict b,
+                       double* restrict ab ) {
+    double acc[ MR * NR ];
+    size_t i, j, k;
+
+    for (i = 0; i < MR * NR; i++) {
+        acc[ i ] = 0.0;
+    }
+
+    for (k = 0; k < kc; k++) {
+        for (i = 0; i < MR; i++) {
+            const double a_i = a[ i ];
+            for (j = 0; j < NR; j++) {
+                acc[ i * NR + j ] += a_i * b[ j ];
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+
+    memcpy( ab, acc, sizeof(acc) );
+}
+
+#ifdef C_GEMM_X86
+
+#define C_GEMM_AVX2_ROW( r )                                                 \
+    a_r   = _mm256_broadcast_sd( a + r );                                    \
+    c##r##0 = _mm256_fmadd_pd( a_r, b0, c##r##0 );                           \
+    c##r##1 = _mm256_fmadd_pd( a_r, b1, c##r##1 );
+
+#define C_GEMM_AVX2_STORE( r )                                               \
+    _mm256_storeu_pd( ab + r * NR,     c##r##0 );                            \
+    _mm256_storeu_pd( ab + r * NR + 4, c##r##1 );
+
+/* 6 x 8 block in twelve ymm accumulators. B strips are 64 byte aligned */
+__attribute__((target("avx2,fma")))
+static void
+c_gemm_kernel_avx2( size_t kc, const double* restrict a, const double* restrict b,
+                    double* restrict ab ) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+    __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+    __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+    size_t k;
+    for (k = 0; k < kc; k++) {
+        const __m256d b0 = _mm256_load_pd( b );
+        const __m256d b1 = _mm256_load_pd( b + 4 );
+        __m256d a_r;
+
+        C_GEMM_AVX2_ROW( 0 )
+        C_GEMM_AVX2_ROW( 1 )
+        C_GEMM_AVX2_ROW( 2 )
+        C_GEMM_AVX2_ROW( 3 )
+        C_GEMM_AVX2_ROW( 4 )
+        C_GEMM_AVX2_ROW( 5 )
+
+        a += MR;
+        b += NR;
+    }
+
+    C_GEMM_AVX2_STORE( 0 )
+    C_GEMM_AVX2_STORE( 1 )
+    C_GEMM_AVX2_STORE( 2 )
+    C_GEMM_AVX2_STORE( 3 )
+    C_GEMM_AVX2_STORE( 4 )
+    C_GEMM_AVX2_STORE( 5 )
+}
+
+#endif
+
+static void
+c_gemm_init( void ) {
+    if (c_gemm_kernel == NULL) {
+        gemm_kernel kernel = &c_gemm_kernel_generic;
+
+#ifdef C_GEMM_X86
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            kernel = &c_gemm_kernel_avx2;
+        }
+#endif
+        c_gemm_kernel = kernel;
+    }
+
+    if (c_gemm_kc == 0) {
+        c_gemm_default_params( &c_gemm_mc, &c_gemm_kc, &c_gemm_nc );
+    }
+}
+
+static double*
+c_gemm_alloc( size_t n ) {
+    void* p = NULL;
+
+    if (posix_memalign( &p, C_GEMM_ALIGN, n * sizeof(double) ) != 0) {
+        C_ERROR_NULL("Failed to allocate packing buffer", C_ENOMEM);
+    }
+
+    return (double*) p;
+}
+
+/* mc x kc block of A into MR high strips, k major, zero padded */
+static void
+c_gemm_pack_A( size_t mc, size_t kc, const double* A, size_t rsA, size_t csA,
+               double* restrict Ap ) {
+    size_t p, i, k;
+
+    for (p = 0; p < mc; p += MR) {
+        const size_t mr = mc - p < MR ? mc - p : MR;
+        const double* A_p = A + p * rsA;
+
+        for (k = 0; k < kc; k++) {
+            for (i = 0; i < mr; i++) {
+                Ap[ i ] = A_p[ i * rsA + k * csA ];
+            }
+            for (; i < MR; i++) {
+                Ap[ i ] = 0.0;
+            }
+            Ap += MR;
+        }
+    }
+}
+
+/* kc x nc panel of B into NR wide strips, k major, zero padded */
+static void
+c_gemm_pack_B( size_t kc, size_t nc, const double* B, size_t rsB, size_t csB,
+               double* restrict Bp ) {
+    size_t q, j, k;
+
+    for (q = 0; q < nc; q += NR) {
+        const size_t nr = nc - q < NR ? nc - q : NR;
+        const double* B_q = B + q * csB;
+
+        for (k = 0; k < kc; k++) {
+            for (j = 0; j < nr; j++) {
+                Bp[ j ] = B_q[ k * rsB + j * csB ];
+            }
+            for (; j < NR; j++) {
+                Bp[ j ] = 0.0;
+            }
+            Bp += NR;
+        }
+    }
+}
+
+/* C <- alpha * ab + beta * C on the mr x nr corner actually inside C.
+   beta == 0 overwrites C as in BLAS */
+static void
+c_gemm_update( size_t mr, size_t nr, const double* ab, double alpha, double beta,
+               double* C, size_t rsC, size_t csC ) {
+    size_t i, j;
+
+    if (beta == 0.0) {
+        for (i = 0; i < mr; i++) {
+            for (j = 0; j < nr; j++) {
+                C[ i * rsC + j * csC ] = alpha * ab[ i * NR + j ];
+            }
+        }
+    } else {
+        for (i = 0; i < mr; i++) {
+            for (j = 0; j < nr; j++) {
+                double* c = C + i * rsC + j * csC;
+                *c = alpha * ab[ i * NR + j ] + beta * *c;
+            }
+        }
+    }
+}
+
+struct gemm_job_struct
+{
+    size_t        M;
+    size_t        mb;
+    size_t        kc;
+    size_t        nc;
+    double        alpha;
+    double        beta;
+    const double* A;
+    size_t        rsA;
+    size_t        csA;
+    const double* Bp;
+    double*       C;
+    size_t        rsC;
+    size_t        csC;
+    int           status;    /* C_ENOMEM once a packing buffer failed */
+};
+
+typedef struct gemm_job_struct GemmJob;
+
+/* row blocks [begin, end) of the current B panel */
+static void
+c_gemm_row_blocks( size_t begin, size_t end, void* arg ) {
+    const GemmJob* job = (const GemmJob*) arg;
+
+    const size_t kc = job->kc;
+    const size_t nc = job->nc;
+
+    double* Ap = c_gemm_alloc( c_gemm_round_up( job->mb, MR ) * kc );
+    double  ab[ MR * NR ];
+
+    if (Ap == NULL) {
+        __atomic_store_n( &((GemmJob*) arg)->status, C_ENOMEM, __ATOMIC_RELAXED );
+        return;
+    }
+
+    size_t b, i, j;
+
+    for (b = begin; b < end; b++) {
+        const size_t ic = b * job->mb;
+        const size_t mc = job->M - ic < job->mb ? job->M - ic : job->mb;
+
+        c_gemm_pack_A( mc, kc, job->A + ic * job->rsA, job->rsA, job->csA, Ap );
+
+        double* C_b = job->C + ic * job->rsC;
+
+        for (j = 0; j < nc; j += NR) {
+            const size_t nr = nc - j < NR ? nc - j : NR;
+
+            for (i = 0; i < mc; i += MR) {
+                const size_t mr = mc - i < MR ? mc - i : MR;
+
+                ( *c_gemm_kernel ) ( kc, Ap + i * kc, job->Bp + j * kc, ab );
+
+                c_gemm_update( mr, nr, ab, job->alpha, job->beta,
+                               C_b + i * job->rsC + j * job->csC, job->rsC, job->csC );
+            }
+        }
+    }
+
+    free( Ap );
+}
+
+int
+c_gemm( size_t M, size_t N, size_t K, double alpha,
+        const double* A, size_t rsA, size_t csA,
+        const double* B, size_t rsB, size_t csB,
+        double beta, double* C, size_t rsC, size_t csC ) {
+
+    if (M == 0 || N == 0) {
+        return C_SUCCESS;
+    }
+
+    size_t i, j;
+
+    /* nothing to multiply, only scale C */
+    if (K == 0 || alpha == 0.0) {
+        for (i = 0; i < M; i++) {
+            for (j = 0; j < N; j++) {
+                double* c = C + i * rsC + j * csC;
+                *c = beta == 0.0 ? 0.0 : beta * *c;
+            }
+        }
+        return C_SUCCESS;
+    }
+
+    c_gemm_init();
+
+    const int parallel = (double) M * N * K >= C_GEMM_PARALLEL_MIN;
+
+    /* shrink the row blocks so every thread gets at least one */
+    size_t mb = c_gemm_mc;
+
+    if (parallel) {
+        const size_t T   = c_num_threads();
+        const size_t per = c_gemm_round_up( (M + T - 1) / T, MR );
+
+        if (per < mb) mb = per;
+    }
+
+    const size_t nc_max = N < c_gemm_nc ? N : c_gemm_nc;
+    const size_t kc_max = K < c_gemm_kc ? K : c_gemm_kc;
+
+    double* Bp = c_gemm_alloc( kc_max * c_gemm_round_up( nc_max, NR ) );
+
+    if (Bp == NULL) {
+        return C_ENOMEM;
+    }
+
+    GemmJob job;
+
+    job.M     = M;
+    job.mb    = mb;
+    job.alpha = alpha;
+    job.A     = A;
+    job.rsA   = rsA;
+    job.csA   = csA;
+    job.Bp    = Bp;
+    job.rsC   = rsC;
+    job.csC   = csC;
+    job.status = C_SUCCESS;
+
+    const size_t blocks = (M + mb - 1) / mb;
+
+    size_t jc, pc;
+
+    for (jc = 0; jc < N; jc += c_gemm_nc) {
+        const size_t nc = N - jc < c_gemm_nc ? N - jc : c_gemm_nc;
+
+        for (pc = 0; pc < K; pc += c_gemm_kc) {
+            const size_t kc = K - pc < c_gemm_kc ? K - pc : c_gemm_kc;
+
+            c_gemm_pack_B( kc, nc, B + pc * rsB + jc * csB, rsB, csB, Bp );
+
+            /* later K panels accumulate into what the first one wrote */
+            job.kc   = kc;
+            job.nc   = nc;
+            job.beta = pc == 0 ? beta : 1.0;
+            job.A    = A + pc * csA;
+            job.C    = C + jc * csC;
+
+            if (parallel && blocks > 1) {
+                c_parallel_for( blocks, 1, &c_gemm_row_blocks, &job );
+            } else {
+                c_gemm_row_blocks( 0, blocks, &job );
+            }
+
+            if (job.status != C_SUCCESS) {
+                free( Bp );
+                return job.status;
+            }
+        }
+    }
+
+    free( Bp );
+
+    return C_SUCCESS;
+}
+
+void
+c_gemm_get_params( size_t* mc, size_t* kc, size_t* nc ) {
+    c_gemm_init();
+
+    *mc = c_gemm_mc;
+    *kc = c_gemm_kc;
+    *nc = c_gemm_nc;
+}
+
+int
+c_gemm_set_params( size_t mc, size_t kc, size_t nc ) {
+    if (mc == 0 || kc == 0 || nc == 0) {
+        C_ERROR("Blocking parameters must be positive integers", C_EINVAL);
+    }
+
+    c_gemm_mc = c_gemm_round_up( mc, MR );
+    c_gemm_kc = kc;
+    c_gemm_nc = c_gemm_round_up( nc, NR );
+
+    return C_SUCCESS;
+}
+
+/* the file holds a single line "MC KC NC" */
+int
+c_gemm_load_params( const char* path ) {
+    FILE* fh = fopen( path, "r" );
+
+    if (fh == NULL) {
+        return C_EFAULT;
+    }
+
+    size_t mc, kc, nc;
+    const int n = fscanf( fh, "%zu %zu %zu", &mc, &kc, &nc );
+
+    fclose( fh );
+
+    if (n != 3 || mc == 0 || kc == 0 || nc == 0) {
+        C_WARNING("Ignoring malformed GEMM parameter file");
+        return C_EINVAL;
+    }
+
+    return c_gemm_set_params( mc, kc, nc );
+}
+
+int
+c_gemm_save_params( const char* path ) {
+    c_gemm_init();
+
+    FILE* fh = fopen( path, "w" );
+
+    if (fh == NULL) {
+        C_WARNING("Could not write GEMM parameter file");
+        return C_EFAULT;
+    }
+
+    fprintf( fh, "%zu %zu %zu\n", c_gemm_mc, c_gemm_kc, c_gemm_nc );
+    fclose( fh );
+
+    return C_SUCCESS;
+}
+
+static double
+c_gemm_seconds( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+/* time blockings at half, one and two times the cache derived MC and
+   KC on a square problem and keep the fastest */
+int
+c_gemm_autotune( void ) {
+    const size_t n = 480;
+
+    double* A = c_gemm_alloc( n * n );
+    double* B = c_gemm_alloc( n * n );
+    double* C = c_gemm_alloc( n * n );
+
+    size_t i;
+    for (i = 0; i < n * n; i++) {
+        A[ i ] = (double) (i % 17) - 8.0;
+        B[ i ] = (double) (i % 13) - 6.0;
+        C[ i ] = 0.0;
+    }
+
+    c_gemm_init();
+
+    size_t mc0, kc0, nc0;
+    c_gemm_default_params( &mc0, &kc0, &nc0 );
+
+    const size_t scale[ 3 ] = { 1, 2, 4 };
+
+    size_t best_mc = mc0, best_kc = kc0;
+    double best    = -1.0;
+
+    size_t a, b, r;
+    for (a = 0; a < 3; a++) {
+        for (b = 0; b < 3; b++) {
+            const size_t mc = c_gemm_round_down( mc0 * scale[ a ] / 2, MR );
+            const size_t kc = kc0 * scale[ b ] / 2;
+
+            c_gemm_set_params( mc, kc, nc0 );
+
+            /* best of three to ride out noise */
+            double t = -1.0;
+            for (r = 0; r < 3; r++) {
+                const double start = c_gemm_seconds();
+
+                c_gemm( n, n, n, 1.0, A, n, 1, B, n, 1, 0.0, C, n, 1 );
+
+                const double elapsed = c_gemm_seconds() - start;
+
+                if (t < 0.0 || elapsed < t) t = elapsed;
+            }
+
+            if (best < 0.0 || t < best) {
+                best    = t;
+                best_mc = mc;
+                best_kc = kc;
+            }
+        }
+    }
+
+    c_gemm_set_params( best_mc, best_kc, nc0 );
+
+    free( A );
+    free( B );
+    free( C );
+
+    return C_SUCCESS;
+}
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "cblas.h"
+
+#include "data.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "threads.h"
+#include "linalg/mahalanobis.h"
+
+/* Mahalanobis distances from a Cholesky factor S = LL'.
+ *
+ * d(x,y)^2 = (x - y)' S^-1 (x - y) = | L^-1 (x - y) |^2
+ *
+ * so after solving L z = x once for every row of a data set (and of
+ * the weights) all Mahalanobis distances are plain euclidean distances
+ * between the whitened rows. LLT is the combined factor kept by
+ * Data::LinAlg::CholeskyDecomposition, only its lower triangle is read
+ */
+
+#define MAHAL_ROW_BLOCK 1024
+
+/* contiguous copy of the lower triangle of LLT */
+static double*
+c_mahalanobis_factor( Matrix* LLT ) {
+    const size_t M = LLT->rows;
+
+    double* L = (double*) calloc( M * M, sizeof(double) );
+
+    if (L == 0) {
+        C_ERROR_NULL("Failed to allocate Cholesky factor", C_ENOMEM);
+    }
+
+    size_t i, j;
+    for (i = 0; i < M; i++) {
+        for (j = 0; j <= i; j++) {
+            L[ i * M + j ] = c_m_get_quick( LLT, i, j );
+        }
+    }
+
+    return L;
+}
+
+/* X <- X L^-T, i.e. every row x of X is replaced by the solution of L z = x */
+int c_mahalanobis_whiten( Matrix* LLT, Matrix* X ) {
+    const size_t M = LLT->rows;
+    const size_t N = X->rows;
+
+    if (LLT->columns != M) {
+        C_ERROR("Cholesky factor must be square", C_ENOTSQR);
+    }
+
+    if (X->columns != M) {
+        C_ERROR("Data and covariance dimensions do not match", C_EBADLEN);
+    }
+
+    if (N == 0) {
+        return C_SUCCESS;
+    }
+
+    double* L = c_mahalanobis_factor( LLT );
+
+    if (X->offsets == 0 && X->column_stride == 1) {
+        /* solve directly on the packed rows */
+        double* X_data = X->elements + X->row_zero + X->column_zero;
+
+        cblas_dtrsm( CblasRowMajor, CblasRight, CblasLower, CblasTrans, CblasNonUnit,
+                     (int) N, (int) M, 1.0, L, (int) M, X_data, (int) X->row_stride );
+    } else {
+        /* views and selections are staged through a buffer, a block of rows at a time */
+        const size_t block = N < MAHAL_ROW_BLOCK ? N : MAHAL_ROW_BLOCK;
+        double* buf = (double*) malloc( block * M * sizeof(double) );
+
+        if (buf == 0) {
+            free( L );
+            C_ERROR("Failed to allocate whitening buffer", C_ENOMEM);
+        }
+
+        size_t first, i, j;
+        for (first = 0; first < N; first += block) {
+            const size_t n = first + block < N ? block : N - first;
+
+            for (i = 0; i < n; i++) {
+                for (j = 0; j < M; j++) {
+                    buf[ i * M + j ] = c_m_get_quick( X, first + i, j );
+                }
+            }
+
+            cblas_dtrsm( CblasRowMajor, CblasRight, CblasLower, CblasTrans, CblasNonUnit,
+                         (int) n, (int) M, 1.0, L, (int) M, buf, (int) M );
+
+            for (i = 0; i < n; i++) {
+                for (j = 0; j < M; j++) {
+                    c_m_set_quick( X, first + i, j, buf[ i * M + j ] );
+                }
+            }
+        }
+
+        free( buf );
+    }
+
+    free( L );
+
+    return C_SUCCESS;
+}
+
+/* single pair. Uses the calling thread's scratch space, so there are no
+   allocations once the buffer has grown to the vector length */
+double c_mahalanobis_chol( Vector* u, Vector* v, Matrix* LLT ) {
+    const size_t M = u->size;
+
+    if (v->size != M || LLT->rows != M || LLT->columns != M) {
+        C_ERROR_VAL("Vector and covariance dimensions do not match", C_EBADLEN, NAN);
+    }
+
+    double* diff = c_thread_scratch( M );
+
+    size_t i;
+    for (i = 0; i < M; i++) {
+        diff[ i ] = c_v_get_quick( u, i ) - c_v_get_quick( v, i );
+    }
+
+    if (LLT->offsets == 0 && LLT->column_stride == 1) {
+        const double* L = LLT->elements + LLT->row_zero + LLT->column_zero;
+
+        cblas_dtrsv( CblasRowMajor, CblasLower, CblasNoTrans, CblasNonUnit, (int) M, L,
+                     (int) LLT->row_stride, diff, 1 );
+    } else {
+        /* forward substitution through the accessors */
+        size_t j;
+        for (i = 0; i < M; i++) {
+            double sum = diff[ i ];
+
+            for (j = 0; j < i; j++) {
+                sum -= c_m_get_quick( LLT, i, j ) * diff[ j ];
+            }
+
+            diff[ i ] = sum / c_m_get_quick( LLT, i, i );
+        }
+    }
+
+    return sqrt( cblas_ddot( (int) M, diff, 1, diff, 1 ) );
+}
@@ -0,0 +1,375 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cblas.h"
+#include "lapack.h"
+
+#include "data.h"
+#include "error.h"
+#include "matrix.h"
+#include "linalg/pca.h"
+
+/* Truncated PCA.
+ *
+ * Only the top k eigenpairs of the covariance matrix are computed,
+ * either by building the covariance with dsyrk and asking dsyevr for
+ * a subset of the spectrum, or by a randomized range finder on the
+ * centred data (Halko, Martinsson & Tropp 2011).
+ *
+ * Eigenvalues are returned in descending order. Eigenvectors are
+ * returned row-major (M x k), one eigenvector per column
+ */
+
+#define PCA_ROW_BLOCK    1024
+#define PCA_OVERSAMPLE   10
+#define PCA_POWER_ITERS  2
+
+/* copy rows [first, first + n) of A into buf, centred on the means */
+static void
+c_pca_center_rows( Matrix* A, const double* means, size_t first, size_t n, double* buf ) {
+    const size_t M = A->columns;
+
+    size_t i, j;
+    for (i = 0; i < n; i++) {
+        double* row = buf + i * M;
+
+        if (A->offsets) {
+            for (j = 0; j < M; j++) {
+                row[ j ] = c_m_get_quick( A, first + i, j ) - means[ j ];
+            }
+        } else {
+            const double* src = A->elements + A->row_zero + A->column_zero + (first + i) * A->row_stride;
+            const size_t  cs  = A->column_stride;
+
+            for (j = 0; j < M; j++) {
+                row[ j ] = src[ j * cs ] - means[ j ];
+            }
+        }
+    }
+}
+
+/* C (M x M, lower triangle filled) = Xc' Xc / (N - 1), accumulated in row blocks */
+int c_pca_covariance( Matrix* A, const double* means, double* C ) {
+    const size_t N = A->rows;
+    const size_t M = A->columns;
+
+    if (N < 2) {
+        C_ERROR("Need at least two rows to calculate covariance", C_EINVAL);
+    }
+
+    const size_t block = N < PCA_ROW_BLOCK ? N : PCA_ROW_BLOCK;
+    double* buf = (double*) malloc( block * M * sizeof(double) );
+
+    if (buf == 0) {
+        C_ERROR("Failed to allocate PCA work space", C_ENOMEM);
+    }
+
+    const double alpha = 1.0 / (double) (N - 1);
+
+    size_t first;
+    for (first = 0; first < N; first += block) {
+        const size_t n = first + block < N ? block : N - first;
+
+        c_pca_center_rows( A, means, first, n, buf );
+
+        cblas_dsyrk( CblasRowMajor, CblasLower, CblasTrans, (int) M, (int) n, alpha, buf,
+                     (int) M, first == 0 ? 0.0 : 1.0, C, (int) M );
+    }
+
+    /* mirror into the upper triangle */
+    size_t i, j;
+    for (i = 0; i < M; i++) {
+        for (j = i + 1; j < M; j++) {
+            C[ i * M + j ] = C[ j * M + i ];
+        }
+    }
+
+    free( buf );
+
+    return C_SUCCESS;
+}
+
+/* flip each eigenvector so its largest component is positive */
+static void
+c_pca_fix_signs( double* evecs, size_t M, size_t k ) {
+    size_t i, j;
+
+    for (j = 0; j < k; j++) {
+        size_t imax = 0;
+
+        for (i = 1; i < M; i++) {
+            if (fabs( evecs[ i * k + j ] ) > fabs( evecs[ imax * k + j ] )) imax = i;
+        }
+
+        if (evecs[ imax * k + j ] < 0) {
+            for (i = 0; i < M; i++) evecs[ i * k + j ] = -evecs[ i * k + j ];
+        }
+    }
+}
+
+/* top k eigenpairs of a symmetric M x M matrix (C is destroyed) */
+int c_pca_top_eigen( double* C, size_t M, size_t k, double* evals, double* evecs ) {
+    if (k == 0 || k > M) {
+        C_ERROR("Number of components must be between 1 and the matrix dimension", C_EINVAL);
+    }
+
+    const int n     = (int) M;
+    const int il    = (int) (M - k + 1);
+    const int iu    = (int) M;
+    const double vl = 0.0, vu = 0.0, abstol = 0.0;
+
+    int found, info, lwork = -1, liwork = -1, iwork_query;
+    double work_query;
+
+    double* w      = (double*) malloc( M * sizeof(double) );
+    double* z      = (double*) malloc( M * k * sizeof(double) );
+    int*    isuppz = (int*)    malloc( 2 * k * sizeof(int) );
+
+    if (!w || !z || !isuppz) {
+        free( w );
+        free( z );
+        free( isuppz );
+        C_ERROR("Failed to allocate eigen work space", C_ENOMEM);
+    }
+
+    /* a row-major lower triangle is a column-major upper triangle */
+    dsyevr_( "V", "I", "U", &n, C, &n, &vl, &vu, &il, &iu, &abstol, &found, w, z, &n,
+             isuppz, &work_query, &lwork, &iwork_query, &liwork, &info );
+
+    lwork  = (int) work_query;
+    liwork = iwork_query;
+
+    double* work  = (double*) malloc( (size_t) lwork * sizeof(double) );
+    int*    iwork = (int*)    malloc( (size_t) liwork * sizeof(int) );
+
+    if (!work || !iwork) {
+        free( w );
+        free( z );
+        free( isuppz );
+        free( work );
+        free( iwork );
+        C_ERROR("Failed to allocate eigen work space", C_ENOMEM);
+    }
+
+    dsyevr_( "V", "I", "U", &n, C, &n, &vl, &vu, &il, &iu, &abstol, &found, w, z, &n,
+             isuppz, work, &lwork, iwork, &liwork, &info );
+
+    if (info == 0) {
+        /* dsyevr returns ascending eigenvalues, we want them descending */
+        size_t i, j;
+        for (j = 0; j < k; j++) {
+            const size_t src = k - 1 - j;
+
+            evals[ j ] = w[ src ];
+            for (i = 0; i < M; i++) {
+                evecs[ i * k + j ] = z[ src * M + i ];
+            }
+        }
+
+        c_pca_fix_signs( evecs, M, k );
+    }
+
+    free( w );
+    free( z );
+    free( isuppz );
+    free( work );
+    free( iwork );
+
+    if (info != 0) {
+        C_ERROR("dsyevr failed to converge", C_EDOM);
+    }
+
+    return C_SUCCESS;
+}
+
+/* orthonormal basis of the columns of Y (row-major N x l). Q is column-major N x l */
+static int
+c_pca_orthonormalize( const double* Y, size_t N, size_t l, double* Q ) {
+    size_t i, j;
+
+    for (i = 0; i < N; i++) {
+        for (j = 0; j < l; j++) {
+            Q[ j * N + i ] = Y[ i * l + j ];
+        }
+    }
+
+    const int m = (int) N, n = (int) l;
+    int info, lwork = -1;
+    double work_query;
+
+    double* tau = (double*) malloc( l * sizeof(double) );
+
+    if (tau == 0) {
+        C_ERROR("Failed to allocate QR work space", C_ENOMEM);
+    }
+
+    dgeqrf_( &m, &n, Q, &m, tau, &work_query, &lwork, &info );
+
+    lwork = (int) work_query;
+    double* work = (double*) malloc( (size_t) lwork * sizeof(double) );
+
+    if (work == 0) {
+        free( tau );
+        C_ERROR("Failed to allocate QR work space", C_ENOMEM);
+    }
+
+    dgeqrf_( &m, &n, Q, &m, tau, work, &lwork, &info );
+
+    if (info == 0) {
+        dorgqr_( &m, &n, &n, Q, &m, tau, work, &lwork, &info );
+    }
+
+    free( tau );
+    free( work );
+
+    return info == 0 ? C_SUCCESS : C_FAILURE;
+}
+
+/* standard normal numbers from a fixed-seed xorshift generator (Box-Muller) */
+static void
+c_pca_gaussian_fill( double* x, size_t n ) {
+    uint64_t s = 0x9E3779B97F4A7C15ULL;
+
+    size_t i;
+    for (i = 0; i < n; i += 2) {
+        double u1, u2;
+
+        s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+        u1 = ((double) (s >> 11) + 0.5) / 9007199254740992.0;
+        s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+        u2 = ((double) (s >> 11) + 0.5) / 9007199254740992.0;
+
+        const double r = sqrt( -2.0 * log( u1 ) );
+
+        x[ i ] = r * cos( 2 * M_PI * u2 );
+        if (i + 1 < n) x[ i + 1 ] = r * sin( 2 * M_PI * u2 );
+    }
+}
+
+int c_pca_randomized( Matrix* A, const double* means, size_t k, size_t oversample,
+                      size_t power_iters, double* evals, double* evecs )
+{
+    const size_t N = A->rows;
+    const size_t M = A->columns;
+
+    if (k == 0 || k > M) {
+        C_ERROR("Number of components must be between 1 and the matrix dimension", C_EINVAL);
+    }
+
+    if (N < 2) {
+        C_ERROR("Need at least two rows to calculate PCA", C_EINVAL);
+    }
+
+    size_t l = k + oversample;
+    if (l > M) l = M;
+    if (l > N) l = N;
+
+    double* Xc    = (double*) malloc( N * M * sizeof(double) );
+    double* Omega = (double*) malloc( M * l * sizeof(double) );
+    double* Y     = (double*) malloc( N * l * sizeof(double) );
+    double* Q     = (double*) malloc( N * l * sizeof(double) );
+    double* B     = (double*) malloc( l * M * sizeof(double) );
+    double* S     = (double*) malloc( l * l * sizeof(double) );
+    double* U     = (double*) malloc( l * l * sizeof(double) );
+    double* s2    = (double*) malloc( l * sizeof(double) );
+
+    int status = C_SUCCESS;
+
+    if (!Xc || !Omega || !Y || !Q || !B || !S || !U || !s2) {
+        c_error( "Failed to allocate PCA work space", __FILE__, __LINE__, C_ENOMEM );
+        status = C_ENOMEM;
+        goto done;
+    }
+
+    c_pca_center_rows( A, means, 0, N, Xc );
+    c_pca_gaussian_fill( Omega, M * l );
+
+    /* range finder: Y = Xc * Omega */
+    cblas_dgemm( CblasRowMajor, CblasNoTrans, CblasNoTrans, (int) N, (int) l, (int) M,
+                 1.0, Xc, (int) M, Omega, (int) l, 0.0, Y, (int) l );
+
+    if ((status = c_pca_orthonormalize( Y, N, l, Q )) != C_SUCCESS) {
+        goto done;
+    }
+
+    /* power iterations sharpen the spectrum: Y = Xc * (Xc' * Q).
+     * Q is column-major N x l, i.e. row-major l x N (= Q') */
+    size_t q;
+    for (q = 0; q < power_iters; q++) {
+        cblas_dgemm( CblasRowMajor, CblasTrans, CblasTrans, (int) M, (int) l, (int) N,
+                     1.0, Xc, (int) M, Q, (int) N, 0.0, Omega, (int) l );
+        cblas_dgemm( CblasRowMajor, CblasNoTrans, CblasNoTrans, (int) N, (int) l, (int) M,
+                     1.0, Xc, (int) M, Omega, (int) l, 0.0, Y, (int) l );
+
+        if ((status = c_pca_orthonormalize( Y, N, l, Q )) != C_SUCCESS) {
+            goto done;
+        }
+    }
+
+    /* B = Q' * Xc (l x M) and its Gram matrix S = B * B' */
+    cblas_dgemm( CblasRowMajor, CblasNoTrans, CblasNoTrans, (int) l, (int) M, (int) N,
+                 1.0, Q, (int) N, Xc, (int) M, 0.0, B, (int) M );
+
+    cblas_dsyrk( CblasRowMajor, CblasLower, CblasNoTrans, (int) l, (int) M, 1.0, B, (int) M,
+                 0.0, S, (int) l );
+
+    if ((status = c_pca_top_eigen( S, l, k, s2, U )) != C_SUCCESS) {
+        goto done;
+    }
+
+    /* right singular vectors: v_j = B' u_j / sigma_j */
+    size_t i, j, r;
+    for (j = 0; j < k; j++) {
+        const double sigma = sqrt( s2[ j ] > 0 ? s2[ j ] : 0 );
+
+        for (i = 0; i < M; i++) {
+            double v = 0.0;
+
+            for (r = 0; r < l; r++) {
+                v += B[ r * M + i ] * U[ r * k + j ];
+            }
+
+            evecs[ i * k + j ] = sigma > 0 ? v / sigma : 0.0;
+        }
+
+        evals[ j ] = s2[ j ] / (double) (N - 1);
+    }
+
+    c_pca_fix_signs( evecs, M, k );
+
+done:
+    free( Xc );
+    free( Omega );
+    free( Y );
+    free( Q );
+    free( B );
+    free( S );
+    free( U );
+    free( s2 );
+
+    return status;
+}
+
+int c_pca_truncated( Matrix* A, const double* means, size_t k, int method, double* evals, double* evecs ) {
+    if (method == PCA_RANDOMIZED) {
+        return c_pca_randomized( A, means, k, PCA_OVERSAMPLE, PCA_POWER_ITERS, evals, evecs );
+    }
+
+    const size_t M = A->columns;
+    double* C = (double*) malloc( M * M * sizeof(double) );
+
+    if (C == 0) {
+        C_ERROR("Failed to allocate covariance matrix", C_ENOMEM);
+    }
+
+    int status = c_pca_covariance( A, means, C );
+
+    if (status == C_SUCCESS) {
+        status = c_pca_top_eigen( C, M, k, evals, evecs );
+    }
+
+    free( C );
+
+    return status;
+}
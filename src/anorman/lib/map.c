@@ -0,0 +1,443 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "data.h"
+#include "error.h"
+#include "map.h"
+
+/* Open addressing int -> double hash map with double hashing.
+ *
+ * This is the native counterpart of Data::Map (after the colt
+ * OpenIntDoubleHashMap): keys live in one flat array next to their
+ * values and a state byte per slot, collisions step backwards by a
+ * second hash of the key and the table is rehashed to a prime capacity
+ * when the load leaves [min_load_factor, max_load_factor]. It backs the
+ * sparse vectors and matrices, where a missing key reads as 0.0
+ */
+
+/* table sizes, taken from Data::Map::PrimeFinder */
+static const size_t c_idm_primes[] = {
+             3,          5,          7,         11,         17,         23,         31,         37,
+            43,         47,         67,         79,         89,         97,        137,        163,
+           179,        197,        277,        311,        331,        359,        379,        397,
+           433,        557,        599,        631,        673,        719,        761,        797,
+           877,        953,       1039,       1117,       1201,       1277,       1361,       1439,
+          1523,       1597,       1759,       1907,       2081,       2237,       2411,       2557,
+          2729,       2879,       3049,       3203,       3527,       3821,       4177,       4481,
+          4831,       5119,       5471,       5779,       6101,       6421,       7057,       7643,
+          8363,       8963,       9677,      10243,      10949,      11579,      12203,      12853,
+         14143,      15287,      16729,      17929,      19373,      20507,      21911,      23159,
+         24407,      25717,      28289,      30577,      33461,      35863,      38747,      41017,
+         43853,      46327,      48817,      51437,      56591,      61169,      66923,      71741,
+         77509,      82037,      87719,      92657,      97649,     102877,     113189,     122347,
+        133853,     143483,     155027,     164089,     175447,     185323,     195311,     205759,
+        226379,     244703,     267713,     286973,     310081,     328213,     350899,     370661,
+        390647,     411527,     452759,     489407,     535481,     573953,     620171,     656429,
+        701819,     741337,     781301,     823117,     905551,     978821,    1070981,    1147921,
+       1240361,    1312867,    1403641,    1482707,    1562611,    1646237,    1811107,    1957651,
+       2141977,    2295859,    2480729,    2625761,    2807303,    2965421,    3125257,    3292489,
+       3622219,    3915341,    4283963,    4591721,    4961459,    5251529,    5614657,    5930887,
+       6250537,    6584983,    7244441,    7830701,    8567929,    9183457,    9922933,   10503061,
+      11229331,   11861791,   12501169,   13169977,   14488931,   15661423,   17135863,   18366923,
+      19845871,   21006137,   22458671,   23723597,   25002389,   26339969,   28977863,   31322867,
+      34271747,   36733847,   39691759,   42012281,   44917381,   47447201,   50004791,   52679969,
+      57955739,   62645741,   68543509,   73467739,   79383533,   84024581,   89834777,   94894427,
+     100009607,  105359939,  115911563,  125291483,  137087021,  146935499,  158767069,  168049163,
+     179669557,  189788857,  200019221,  210719881,  231823147,  250582987,  274174111,  293871013,
+     317534141,  336098327,  359339171,  379577741,  400038451,  421439783,  463646329,  501165979,
+     548348231,  587742049,  635068283,  672196673,  718678369,  759155483,  800076929,  842879579,
+     927292699, 1002331963, 1096696463, 1175484103, 1270136683, 1344393353, 1437356741, 1518310967,
+    1600153859, 1685759167, 1854585413, 2004663929, 2147483647
+};
+
+#define C_IDM_NUM_PRIMES ( sizeof( c_idm_primes ) / sizeof( c_idm_primes[ 0 ] ) )
+
+size_t
+c_idm_next_prime( size_t n ) {
+    size_t lo = 0, hi = C_IDM_NUM_PRIMES;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (c_idm_primes[ mid ] < n) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo < C_IDM_NUM_PRIMES ? c_idm_primes[ lo ] : c_idm_primes[ C_IDM_NUM_PRIMES - 1 ];
+}
+
+/* k-mer codes and matrix cell indexes are far from random, so mix the
+   bits before reducing modulo the capacity */
+static inline size_t
+c_idm_hash( size_t key ) {
+    uint64_t x = (uint64_t) key;
+
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+
+    return (size_t) x;
+}
+
+static inline void
+c_idm_probe_start( const IntDoubleMap* map, size_t key, size_t* i, size_t* decr ) {
+    const size_t h = c_idm_hash( key );
+
+    *i    = h % map->capacity;
+    *decr = map->capacity > 2 ? h % (map->capacity - 2) : 1;
+
+    if (*decr == 0) *decr = 1;
+}
+
+#define C_IDM_STEP( i, decr, capacity ) \
+    ( (i) >= (decr) ? (i) - (decr) : (i) + (capacity) - (decr) )
+
+static size_t
+c_idm_low_water_mark( size_t capacity, double min_load_factor ) {
+    return (size_t) (capacity * min_load_factor);
+}
+
+static size_t
+c_idm_high_water_mark( size_t capacity, double max_load_factor ) {
+    const size_t high = (size_t) (capacity * max_load_factor);
+    return capacity < 2 ? 0 : (high < capacity - 2 ? high : capacity - 2);
+}
+
+static size_t
+c_idm_grow_capacity( IntDoubleMap* map, size_t size ) {
+    size_t n = (size_t) (4.0 * size / (3.0 * map->min_load_factor + map->max_load_factor));
+    return c_idm_next_prime( n > size + 1 ? n : size + 1 );
+}
+
+static size_t
+c_idm_shrink_capacity( IntDoubleMap* map, size_t size ) {
+    size_t n = (size_t) (4.0 * size / (map->min_load_factor + 3.0 * map->max_load_factor));
+    return c_idm_next_prime( n > size + 1 ? n : size + 1 );
+}
+
+/* slot of key, or capacity if absent */
+static size_t
+c_idm_index_of_key( IntDoubleMap* map, size_t key ) {
+    size_t i, decr;
+    c_idm_probe_start( map, key, &i, &decr );
+
+    const uint8_t* state = map->states;
+
+    while (state[ i ] != C_IDM_FREE && (state[ i ] == C_IDM_REMOVED || map->keys[ i ] != key)) {
+        i = C_IDM_STEP( i, decr, map->capacity );
+    }
+
+    return state[ i ] == C_IDM_FREE ? map->capacity : i;
+}
+
+/* slot to insert key into. found is set when key is already present */
+static size_t
+c_idm_index_of_insertion( IntDoubleMap* map, size_t key, int* found ) {
+    size_t i, decr;
+    c_idm_probe_start( map, key, &i, &decr );
+
+    const uint8_t* state = map->states;
+
+    while (state[ i ] == C_IDM_FULL && map->keys[ i ] != key) {
+        i = C_IDM_STEP( i, decr, map->capacity );
+    }
+
+    /* key may still sit behind a removed slot */
+    if (state[ i ] == C_IDM_REMOVED) {
+        const size_t j = i;
+
+        while (state[ i ] != C_IDM_FREE && (state[ i ] == C_IDM_REMOVED || map->keys[ i ] != key)) {
+            i = C_IDM_STEP( i, decr, map->capacity );
+        }
+
+        if (state[ i ] == C_IDM_FREE) {
+            i = j;
+        }
+    }
+
+    *found = (state[ i ] == C_IDM_FULL);
+
+    return i;
+}
+
+static int
+c_idm_setup( IntDoubleMap* map, size_t capacity ) {
+    map->states = (uint8_t*) calloc( capacity, sizeof(uint8_t) );
+    map->keys   = (size_t*)  malloc( capacity * sizeof(size_t) );
+    map->values = (double*)  malloc( capacity * sizeof(double) );
+
+    if (map->states == NULL || map->keys == NULL || map->values == NULL) {
+        free( map->states );
+        free( map->keys );
+        free( map->values );
+        return C_ENOMEM;
+    }
+
+    map->capacity        = capacity;
+    map->free_entries    = capacity - map->distinct;
+    map->low_water_mark  = c_idm_low_water_mark( capacity, map->min_load_factor );
+    map->high_water_mark = c_idm_high_water_mark( capacity, map->max_load_factor );
+
+    return C_SUCCESS;
+}
+
+static int
+c_idm_rehash( IntDoubleMap* map, size_t capacity ) {
+    uint8_t*     old_states   = map->states;
+    size_t*      old_keys     = map->keys;
+    double*      old_values   = map->values;
+    const size_t old_capacity = map->capacity;
+
+    if (c_idm_setup( map, capacity ) != C_SUCCESS) {
+        map->states = old_states;
+        map->keys   = old_keys;
+        map->values = old_values;
+        C_ERROR("Failed to grow hash map", C_ENOMEM);
+    }
+
+    size_t k;
+    for (k = 0; k < old_capacity; k++) {
+        if (old_states[ k ] == C_IDM_FULL) {
+            size_t i, decr;
+            c_idm_probe_start( map, old_keys[ k ], &i, &decr );
+
+            while (map->states[ i ] != C_IDM_FREE) {
+                i = C_IDM_STEP( i, decr, map->capacity );
+            }
+
+            map->states[ i ] = C_IDM_FULL;
+            map->keys[ i ]   = old_keys[ k ];
+            map->values[ i ] = old_values[ k ];
+        }
+    }
+
+    free( old_states );
+    free( old_keys );
+    free( old_values );
+
+    return C_SUCCESS;
+}
+
+IntDoubleMap*
+c_idm_alloc( size_t capacity, double min_load_factor, double max_load_factor ) {
+    if (min_load_factor < 0.0 || min_load_factor >= 1.0) {
+        C_ERROR_NULL("Illegal min_load_factor", C_EINVAL);
+    }
+
+    if (max_load_factor <= 0.0 || max_load_factor >= 1.0) {
+        C_ERROR_NULL("Illegal max_load_factor", C_EINVAL);
+    }
+
+    if (min_load_factor >= max_load_factor) {
+        C_ERROR_NULL("min_load_factor must be smaller than max_load_factor", C_EINVAL);
+    }
+
+    IntDoubleMap* map = (IntDoubleMap*) calloc( 1, sizeof(IntDoubleMap) );
+
+    if (map == NULL) {
+        C_ERROR_NULL("Failed to allocate hash map", C_ENOMEM);
+    }
+
+    map->min_load_factor = min_load_factor;
+    map->max_load_factor = max_load_factor;
+
+    if (c_idm_setup( map, c_idm_next_prime( capacity ) ) != C_SUCCESS) {
+        free( map );
+        C_ERROR_NULL("Failed to allocate hash map", C_ENOMEM);
+    }
+
+    /* never shrink below the initial capacity */
+    map->low_water_mark = 0;
+
+    return map;
+}
+
+void
+c_idm_free( IntDoubleMap* map ) {
+    if (map == NULL) {
+        return;
+    }
+
+    free( map->states );
+    free( map->keys );
+    free( map->values );
+    free( map );
+}
+
+void
+c_idm_clear( IntDoubleMap* map ) {
+    memset( map->states, C_IDM_FREE, map->capacity );
+
+    map->distinct     = 0;
+    map->free_entries = map->capacity;
+}
+
+IntDoubleMap*
+c_idm_copy( IntDoubleMap* map ) {
+    IntDoubleMap* copy = c_idm_alloc( map->capacity, map->min_load_factor, map->max_load_factor );
+
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    memcpy( copy->states, map->states, map->capacity * sizeof(uint8_t) );
+    memcpy( copy->keys,   map->keys,   map->capacity * sizeof(size_t) );
+    memcpy( copy->values, map->values, map->capacity * sizeof(double) );
+
+    copy->distinct        = map->distinct;
+    copy->free_entries    = map->free_entries;
+    copy->low_water_mark  = map->low_water_mark;
+    copy->high_water_mark = map->high_water_mark;
+
+    return copy;
+}
+
+int
+c_idm_put( IntDoubleMap* map, size_t key, double value ) {
+    if (value == 0.0) {
+        c_idm_remove( map, key );
+        return C_SUCCESS;
+    }
+
+    int found;
+    size_t i = c_idm_index_of_insertion( map, key, &found );
+
+    if (found) {
+        map->values[ i ] = value;
+        return C_SUCCESS;
+    }
+
+    if (map->distinct > map->high_water_mark) {
+        int status = c_idm_rehash( map, c_idm_grow_capacity( map, map->distinct + 1 ) );
+
+        if (status != C_SUCCESS) {
+            return status;
+        }
+
+        return c_idm_put( map, key, value );
+    }
+
+    if (map->states[ i ] == C_IDM_FREE) {
+        map->free_entries--;
+    }
+
+    map->states[ i ] = C_IDM_FULL;
+    map->keys[ i ]   = key;
+    map->values[ i ] = value;
+    map->distinct++;
+
+    /* too many removed slots left behind */
+    if (map->free_entries < 1) {
+        return c_idm_rehash( map, c_idm_grow_capacity( map, map->distinct + 1 ) );
+    }
+
+    return C_SUCCESS;
+}
+
+int
+c_idm_add( IntDoubleMap* map, size_t key, double delta ) {
+    const size_t i = c_idm_index_of_key( map, key );
+
+    if (i == map->capacity) {
+        return c_idm_put( map, key, delta );
+    }
+
+    map->values[ i ] += delta;
+
+    if (map->values[ i ] == 0.0) {
+        c_idm_remove( map, key );
+    }
+
+    return C_SUCCESS;
+}
+
+double
+c_idm_get( IntDoubleMap* map, size_t key ) {
+    const size_t i = c_idm_index_of_key( map, key );
+    return i == map->capacity ? 0.0 : map->values[ i ];
+}
+
+int
+c_idm_contains( IntDoubleMap* map, size_t key ) {
+    return c_idm_index_of_key( map, key ) != map->capacity;
+}
+
+int
+c_idm_remove( IntDoubleMap* map, size_t key ) {
+    const size_t i = c_idm_index_of_key( map, key );
+
+    if (i == map->capacity) {
+        return 0;
+    }
+
+    map->states[ i ] = C_IDM_REMOVED;
+    map->distinct--;
+
+    if (map->distinct < map->low_water_mark) {
+        c_idm_rehash( map, c_idm_shrink_capacity( map, map->distinct ) );
+    }
+
+    return 1;
+}
+
+size_t
+c_idm_size( IntDoubleMap* map ) {
+    return map->distinct;
+}
+
+struct idm_pair_struct
+{
+    size_t key;
+    double value;
+};
+
+typedef struct idm_pair_struct IdmPair;
+
+static int
+c_idm_pair_cmp( const void* a, const void* b ) {
+    const size_t ka = ((const IdmPair*) a)->key;
+    const size_t kb = ((const IdmPair*) b)->key;
+
+    return (ka > kb) - (ka < kb);
+}
+
+size_t
+c_idm_pairs( IntDoubleMap* map, size_t* keys, double* values ) {
+    const size_t n = map->distinct;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    IdmPair* pairs = (IdmPair*) malloc( n * sizeof(IdmPair) );
+
+    if (pairs == NULL) {
+        C_ERROR_VAL("Failed to allocate hash map pairs", C_ENOMEM, 0);
+    }
+
+    size_t i, k = 0;
+    for (i = 0; i < map->capacity; i++) {
+        if (map->states[ i ] == C_IDM_FULL) {
+            pairs[ k ].key   = map->keys[ i ];
+            pairs[ k ].value = map->values[ i ];
+            k++;
+        }
+    }
+
+    qsort( pairs, n, sizeof(IdmPair), &c_idm_pair_cmp );
+
+    for (i = 0; i < n; i++) {
+        if (keys)   keys[ i ]   = pairs[ i ].key;
+        if (values) values[ i ] = pairs[ i ].value;
+    }
+
+    free( pairs );
+
+    return n;
+}
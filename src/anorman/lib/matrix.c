@@ -1,8 +1,14 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "data.h"
 #include "error.h"
 #include "matrix.h"
+#include "memory.h"
+#include "map.h"
+#include "contiguous.h"
+#include "linalg/gemm.h"
 
 Matrix*
 c_m_alloc_from_matrix( Matrix * mm, 
@@ -23,7 +29,7 @@ c_m_alloc_from_matrix( Matrix * mm,
         C_ERROR_VAL ("New matrix exceeds width of the original", C_EINVAL, 0);
     }
 
-    m = ((Matrix*) malloc (sizeof (Matrix)));
+    m = c_matrix_header_alloc();
 
     if (m == 0) {
         C_ERROR_VAL ("Failed to allocate space for matrix struct", C_ENOMEM, 0);
@@ -41,6 +47,54 @@ c_m_alloc_from_matrix( Matrix * mm,
     return m;
 }
 
+/* Row cursors
+ *
+ * A cursor is an ordinary row view of a matrix that is moved from row to
+ * row in place, so loops over rows need one view instead of one per row.
+ * c_m_row_view fills a caller owned Vector (usually on the stack) the
+ * same way. Selected matrices also need caller owned VectorOffsets
+ */
+
+void
+c_m_row_view( Matrix* m, size_t i, Vector* row, VectorOffsets* offs ) {
+    row->size      = m->columns;
+    row->stride    = m->column_stride;
+    row->elements  = m->elements;
+    row->hash_map  = NULL;
+    row->view_flag = 1;
+
+    if (m->offsets) {
+        offs->offset  = m->offsets->offset + m->offsets->row_offsets[ m->row_zero + i * m->row_stride ];
+        offs->offsets = m->offsets->column_offsets;
+
+        row->zero    = m->column_zero;
+        row->offsets = offs;
+    } else {
+        row->zero    = c_m_index( m, i, 0 );
+        row->offsets = NULL;
+    }
+}
+
+int
+c_m_seek_row( Matrix* m, Vector* cursor, size_t i ) {
+    if (i >= m->rows) {
+        C_ERROR("Row index out of bounds", C_EINVAL);
+    }
+
+    if (cursor->elements != m->elements || cursor->size != m->columns
+        || cursor->stride != m->column_stride || (m->offsets == NULL) != (cursor->offsets == NULL)) {
+        C_ERROR("Cursor is not a row view of this matrix", C_EINVAL);
+    }
+
+    if (m->offsets) {
+        cursor->offsets->offset = m->offsets->offset + m->offsets->row_offsets[ m->row_zero + i * m->row_stride ];
+    } else {
+        cursor->zero = c_m_index( m, i, 0 );
+    }
+
+    return C_SUCCESS;
+}
+
 void
 c_m_free( Matrix* m ) {
        
@@ -50,10 +104,15 @@ c_m_free( Matrix* m ) {
     /* do not free elements if
        struct is a view         */
     if (m->elements && !m->view_flag) {
-        free( m->elements );
+        c_elements_free( m->elements );
         m->elements = NULL;
     }
   
+    if (m->hash_map && !m->view_flag) {
+        c_idm_free( m->hash_map );
+        m->hash_map = NULL;
+    }
+
     if (m->offsets) {
         free( m->offsets->row_offsets );
         free( m->offsets->column_offsets );
@@ -61,18 +120,42 @@ c_m_free( Matrix* m ) {
         m->offsets = NULL;
     }
  
-    free( m ); 
+    c_matrix_header_free( m );
 }
 
 void
 c_m_set_all( Matrix* m, double x ) {
     double* elems = m->elements;
 
+    if (m->offsets) {
+        size_t r, c;
+        for (r = 0; r < m->rows; r++) {
+            for (c = 0; c < m->columns; c++) {
+                c_m_set_quick( m, r, c, x );
+            }
+        }
+        return;
+    }
+
     const size_t cs = m->column_stride;
     const size_t rs = m->row_stride;
     size_t index = c_m_index( m, 0,0 );
 
+    if (c_m_is_contiguous( m )) {
+        c_contig_set_all( m->rows * m->columns, elems + index, x );
+        return;
+    }
+
     int row = (int) m->rows;
+
+    if (cs == 1) {
+        while ( --row >= 0) {
+            c_contig_set_all( m->columns, elems + index, x );
+            index += rs;
+        }
+        return;
+    }
+
     while ( --row >= 0) {
         size_t i = index;
 
@@ -115,79 +198,45 @@ c_m_part( Matrix* m,
 }
 
 /* optimized matrix-matrix multiplication (with loop unrolling) */
+/* C <- alpha * A * B + beta * C. Plain and strided matrices go to the
+   packed kernel in linalg/gemm.c, selected views are multiplied directly */
 Matrix* c_mm_mult ( Matrix* A, Matrix* B, Matrix* C, double alpha, double beta) {
     const size_t m = A->rows;
     const size_t n = A->columns;
     const size_t p = B->columns;
 
-    const double* A_elems = A->elements;
-    const double* B_elems = B->elements;
-          double* C_elems = C->elements;
-
-    const size_t cA = A->column_stride;
-    const size_t cB = B->column_stride;
-    const size_t cC = C->column_stride;
-
-    const size_t rA = A->row_stride;
-    const size_t rB = B->row_stride;
-    const size_t rC = C->row_stride;
-
-    static size_t BLOCK_SIZE = 30000;
-           size_t m_optimal = (BLOCK_SIZE - n) / (n+1);
-
-    if (m_optimal <= 0) m_optimal = 1;
-    int blocks = m/m_optimal;
-    size_t rr = 0;
-    if (m % m_optimal != 0) blocks++;
-
-    while ( --blocks >= 0 ) {
-        size_t jB =     c_m_index(B,0,0);
-        size_t indexA = c_m_index(A, rr,0);
-        size_t jC =     c_m_index(C, rr,0);
-        rr += m_optimal;
-        if (blocks == 0) m_optimal += m - rr;
-
-        int j = (int) p;
-        while ( --j >= 0) {
-            size_t iA = indexA;
-            size_t iC = jC;
-            int i = (int) m_optimal;
-            while ( --i >= 0 ) {
-                size_t kA = iA;
-                size_t kB = jB;
-
-                double s = 0.0;
-
-                // loop unrolled 
-                kA -= cA;
-                kB -= rB;
-
-                int k = (int) n % 4;
-                while ( --k >= 0 ) {
-                    s += A_elems[ kA += cA ] * B_elems[ kB += rB ];
-                }
+    if (!A->offsets && !B->offsets && !C->offsets) {
+        const int status = c_gemm( m, p, n, alpha,
+                                   A->elements + c_m_index( A, 0,0 ), A->row_stride, A->column_stride,
+                                   B->elements + c_m_index( B, 0,0 ), B->row_stride, B->column_stride,
+                                   beta,
+                                   C->elements + c_m_index( C, 0,0 ), C->row_stride, C->column_stride );
 
-                k = n / 4;
-                while ( --k >= 0 ) {
-                    s += A_elems[ kA += cA ] * B_elems[ kB += rB ];
-                    s += A_elems[ kA += cA ] * B_elems[ kB += rB ];
-                    s += A_elems[ kA += cA ] * B_elems[ kB += rB ];
-                    s += A_elems[ kA += cA ] * B_elems[ kB += rB ];
-                }
+        if (status != C_SUCCESS) {
+            C_ERROR_NULL("Failed to allocate matrix product buffers", status);
+        }
+
+        return C;
+    }
 
-                C_elems[ iC ] = alpha * s + beta * C_elems[ iC ];
-                iA += rA;
-                iC += rC;
+    size_t i, j, k;
+
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < p; j++) {
+            double s = 0.0;
+
+            for (k = 0; k < n; k++) {
+                s += c_m_get_quick( A, i, k ) * c_m_get_quick( B, k, j );
             }
-            jB += cB;
-            jC += cC;
+
+            const double c = beta == 0.0 ? 0.0 : beta * c_m_get_quick( C, i, j );
+            c_m_set_quick( C, i, j, alpha * s + c );
         }
     }
 
     return C;
 }
 
-/* optimized matrix-vector multiplication (with loop unrolling) */
 Vector* c_mv_mult ( Matrix *A, Vector* y, Vector* z, double alpha, double beta ) {
     const double* A_elems = A->elements;
     const double* y_elems = y->elements;
@@ -230,32 +279,262 @@ Vector* c_mv_mult ( Matrix *A, Vector* y, Vector* z, double alpha, double beta )
     return z;
 }
 
-void c_mm_copy( Matrix* A, Matrix* B) {
+/* Elementwise operations.
+ *
+ * As in vector.c: whole contiguous matrices collapse to a single
+ * restrict-qualified loop (memcpy / memset where possible), matrices
+ * with unit column stride run that loop once per row, anything else
+ * takes the 2-D strided loop and selected views go through c_m_index.
+ * A right-hand operand sharing cells with the left-hand one is staged
+ * into a dense buffer first
+ */
+
+/* 1 if the two matrices may touch the same cell. Compares the address
+   ranges spanned, so interleaved views count as overlapping */
+int c_mm_overlap( Matrix* A, Matrix* B ) {
+    if (A->elements != B->elements || A->rows == 0 || A->columns == 0
+     || B->rows == 0 || B->columns == 0) {
+        return 0;
+    }
+
+    if (A->offsets || B->offsets) {
+        return 1;
+    }
+
+    const size_t A_first = c_m_index( A, 0, 0 );
+    const size_t B_first = c_m_index( B, 0, 0 );
+    const size_t A_last  = c_m_index( A, A->rows - 1, A->columns - 1 );
+    const size_t B_last  = c_m_index( B, B->rows - 1, B->columns - 1 );
+
+    return A_first <= B_last && B_first <= A_last;
+}
+
+/* exactly the same cells in the same order */
+static int c_mm_same_cells( Matrix* A, Matrix* B ) {
+    return A->elements == B->elements && A->offsets == NULL && B->offsets == NULL
+        && c_m_index( A, 0, 0 ) == c_m_index( B, 0, 0 )
+        && (A->row_stride == B->row_stride || A->rows == 1)
+        && (A->column_stride == B->column_stride || A->columns == 1);
+}
+
+/* stage B into a dense row-major matrix S backed by a fresh buffer */
+static int c_m_stage( Matrix* B, Matrix* S ) {
+    const size_t M = B->rows;
+    const size_t N = B->columns;
+
+    double* buf = (double*) malloc( M * N * sizeof(double) );
+
+    if (buf == 0) {
+        C_ERROR("Failed to allocate staging buffer", C_ENOMEM);
+    }
+
+    size_t r, c;
+    for (r = 0; r < M; r++) {
+        for (c = 0; c < N; c++) {
+            buf[ r * N + c ] = c_m_get_quick( B, r, c );
+        }
+    }
+
+    memset( S, 0, sizeof(Matrix) );
+
+    S->rows          = M;
+    S->columns       = N;
+    S->row_stride    = N;
+    S->column_stride = 1;
+    S->elements      = buf;
+
+    return C_SUCCESS;
+}
+
+#define C_MM_ELEMENTWISE( A, B, contig, op )                                  \
+    const size_t M = A->rows;                                                 \
+    const size_t N = A->columns;                                              \
+                                                                              \
+    if (B->rows != M || B->columns != N) {                                    \
+        C_ERROR("Matrices must have same dimensions", C_EBADLEN);             \
+    }                                                                         \
+                                                                              \
+    Matrix staged;                                                            \
+    int    is_staged = 0;                                                     \
+                                                                              \
+    if (c_mm_overlap( A, B ) && !c_mm_same_cells( A, B )) {                   \
+        if (c_m_stage( B, &staged ) != C_SUCCESS) {                           \
+            return C_ENOMEM;                                                  \
+        }                                                                     \
+        B = &staged;                                                          \
+        is_staged = 1;                                                        \
+    }                                                                         \
+                                                                              \
+          double* A_elems = A->elements;                                      \
+    const double* B_elems = B->elements;                                      \
+                                                                              \
+    if (A->offsets || B->offsets) {                                           \
+        size_t r, c;                                                          \
+        for (r = 0; r < M; r++) {                                             \
+            for (c = 0; c < N; c++) {                                         \
+                A_elems[ c_m_index( A, r, c ) ] op c_m_get_quick( B, r, c );  \
+            }                                                                 \
+        }                                                                     \
+    } else {                                                                  \
+        const size_t    A_cs = A->column_stride;                              \
+        const size_t    B_cs = B->column_stride;                              \
+        const size_t    A_rs = A->row_stride;                                 \
+        const size_t    B_rs = B->row_stride;                                 \
+                                                                              \
+        size_t B_index = c_m_index( B, 0,0 );                                 \
+        size_t A_index = c_m_index( A, 0,0 );                                 \
+                                                                              \
+        const int unit = A_cs == 1 && B_cs == 1 && !c_mm_overlap( A, B );     \
+                                                                              \
+        int row = (int) M;                                                    \
+                                                                              \
+        if (unit && c_m_is_contiguous( A ) && c_m_is_contiguous( B )) {       \
+            contig( M * N, A_elems + A_index, B_elems + B_index );            \
+        } else if (unit) {                                                    \
+            while ( --row >= 0) {                                             \
+                contig( N, A_elems + A_index, B_elems + B_index );            \
+                A_index += A_rs;                                              \
+                B_index += B_rs;                                              \
+            }                                                                 \
+        } else {                                                              \
+            while ( --row >= 0) {                                             \
+                size_t i = A_index;                                           \
+                size_t j = B_index;                                           \
+                                                                              \
+                int column = (int) N;                                         \
+                while (--column >= 0) {                                       \
+                    A_elems[ i ] op B_elems[ j ];                             \
+                    i += A_cs;                                                \
+                    j += B_cs;                                                \
+                }                                                             \
+                                                                              \
+                A_index += A_rs;                                              \
+                B_index += B_rs;                                              \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    if (is_staged) {                                                          \
+        free( staged.elements );                                              \
+    }                                                                         \
+                                                                              \
+    return C_SUCCESS;
+
+#define C_M_ELEMENTWISE( A, x, contig, op )                                   \
+    double* elems = A->elements;                                              \
+                                                                              \
+    if (A->offsets) {                                                         \
+        size_t r, c;                                                          \
+        for (r = 0; r < A->rows; r++) {                                       \
+            for (c = 0; c < A->columns; c++) {                                \
+                elems[ c_m_index( A, r, c ) ] op x;                           \
+            }                                                                 \
+        }                                                                     \
+        return C_SUCCESS;                                                     \
+    }                                                                         \
+                                                                              \
+    const size_t cs = A->column_stride;                                       \
+    const size_t rs = A->row_stride;                                          \
+                                                                              \
+    size_t index = c_m_index( A, 0,0 );                                       \
+                                                                              \
+    int row = (int) A->rows;                                                  \
+                                                                              \
+    if (c_m_is_contiguous( A )) {                                             \
+        contig( A->rows * A->columns, elems + index, x );                     \
+    } else if (cs == 1) {                                                     \
+        while ( --row >= 0) {                                                 \
+            contig( A->columns, elems + index, x );                           \
+            index += rs;                                                      \
+        }                                                                     \
+    } else {                                                                  \
+        while ( --row >= 0) {                                                 \
+            size_t i = index;                                                 \
+                                                                              \
+            int column = (int) A->columns;                                    \
+            while (--column >= 0) {                                           \
+                elems[ i ] op x;                                              \
+                i += cs;                                                      \
+            }                                                                 \
+                                                                              \
+            index += rs;                                                      \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    return C_SUCCESS;
+
+int c_mm_copy( Matrix* A, Matrix* B) {
+    if (c_mm_same_cells( A, B )) {
+        return C_SUCCESS;
+    }
+
+    /* memmove copes with overlapping ranges on its own */
+    if (c_m_is_contiguous( A ) && c_m_is_contiguous( B )) {
+        memmove( A->elements + c_m_index( A, 0,0 ), B->elements + c_m_index( B, 0,0 ),
+                 A->rows * A->columns * sizeof(double) );
+        return C_SUCCESS;
+    }
+
+    Matrix staged;
+    int    is_staged = 0;
+
+    if (c_mm_overlap( A, B )) {
+        if (c_m_stage( B, &staged ) != C_SUCCESS) {
+            return C_ENOMEM;
+        }
+        B = &staged;
+        is_staged = 1;
+    }
+
     double* A_elems = A->elements;
     const double* B_elems = B->elements;
 
-    const size_t    A_cs = A->column_stride;
-    const size_t    B_cs = B->column_stride;
-    const size_t    A_rs = A->row_stride;
-    const size_t    B_rs = B->row_stride;
-    size_t B_index = c_m_index( B, 0,0 );
-    size_t A_index = c_m_index( A, 0,0 );
-
-    int row = (int) A->rows;
-    while ( --row >= 0) {
-        size_t i = A_index;
-        size_t j = B_index;
+    if (A->offsets || B->offsets) {
+        size_t r, c;
+        for (r = 0; r < A->rows; r++) {
+            for (c = 0; c < A->columns; c++) {
+                A_elems[ c_m_index( A, r, c ) ] = c_m_get_quick( B, r, c );
+            }
+        }
+    } else {
+        const size_t    A_cs = A->column_stride;
+        const size_t    B_cs = B->column_stride;
+        const size_t    A_rs = A->row_stride;
+        const size_t    B_rs = B->row_stride;
+        size_t B_index = c_m_index( B, 0,0 );
+        size_t A_index = c_m_index( A, 0,0 );
+
+        int row = (int) A->rows;
+
+        if (A_cs == 1 && B_cs == 1) {
+            while ( --row >= 0) {
+                memcpy( A_elems + A_index, B_elems + B_index, A->columns * sizeof(double) );
+                A_index += A_rs;
+                B_index += B_rs;
+            }
+        } else {
+            while ( --row >= 0) {
+                size_t i = A_index;
+                size_t j = B_index;
+
+                int column = (int) A->columns;
+                while (--column >= 0) {
+                    A_elems[ i ] = B_elems[ j ];
+                    i += A_cs;
+                    j += B_cs;
+                }
 
-        int column = (int) A->columns;
-        while (--column >= 0) {
-            A_elems[ i ] = B_elems[ j ];
-            i += A_cs;
-            j += B_cs;
+                A_index += A_rs;
+                B_index += B_rs;
+            }
         }
+    }
 
-        A_index += A_rs;
-        B_index += B_rs;
+    if (is_staged) {
+        free( staged.elements );
     }
+
+    return C_SUCCESS;
 }
  
 double c_m_sum( Matrix* m ) {
@@ -285,210 +564,26 @@ double c_m_sum( Matrix* m ) {
 
 
 int c_mm_add( Matrix* A, Matrix* B) {
-
-    const size_t M = A->rows;
-    const size_t N = A->columns;
-
-    if (B->rows != M || B->columns != N) {
-        C_ERROR("Matrices must have same dimensions", C_EBADLEN);
-    }
-          double* A_elems = A->elements;
-    const double* B_elems = B->elements;
-
-    const size_t    A_cs = A->column_stride;
-    const size_t    B_cs = B->column_stride;
-    const size_t    A_rs = A->row_stride;
-    const size_t    B_rs = B->row_stride;
-
-    size_t B_index = c_m_index( B, 0,0 );
-    size_t A_index = c_m_index( A, 0,0 );
-
-    int row = (int) A->rows;
-    while ( --row >= 0) {
-        size_t i = A_index;
-        size_t j = B_index;
-
-        int column = (int) A->columns;
-        while (--column >= 0) {
-            A_elems[ i ] += B_elems[ j ];
-            i += A_cs;
-            j += B_cs;
-        }
-
-        A_index += A_rs;
-        B_index += B_rs;
-    }
-
-    return C_SUCCESS;
+    C_MM_ELEMENTWISE( A, B, c_contig_add, += )
 }
 
 int c_mm_sub( Matrix* A, Matrix* B) {
-
-    const size_t M = A->rows;
-    const size_t N = A->columns;
-
-    if (B->rows != M || B->columns != N) {
-        C_ERROR("Matrices must have same dimensions", C_EBADLEN);
-    }
-          double* A_elems = A->elements;
-    const double* B_elems = B->elements;
-
-    const size_t    A_cs = A->column_stride;
-    const size_t    B_cs = B->column_stride;
-    const size_t    A_rs = A->row_stride;
-    const size_t    B_rs = B->row_stride;
-
-    size_t B_index = c_m_index( B, 0,0 );
-    size_t A_index = c_m_index( A, 0,0 );
-
-    int row = (int) A->rows;
-    while ( --row >= 0) {
-        size_t i = A_index;
-        size_t j = B_index;
-
-        int column = (int) A->columns;
-        while (--column >= 0) {
-            A_elems[ i ] -= B_elems[ j ];
-            i += A_cs;
-            j += B_cs;
-        }
-
-        A_index += A_rs;
-        B_index += B_rs;
-    }
-
-    return C_SUCCESS;
+    C_MM_ELEMENTWISE( A, B, c_contig_sub, -= )
 }
 
 int c_mm_mul( Matrix* A, Matrix* B) {
-
-    const size_t M = A->rows;
-    const size_t N = A->columns;
-
-    if (B->rows != M || B->columns != N) {
-        C_ERROR("Matrices must have same dimensions", C_EBADLEN);
-    }
-          double* A_elems = A->elements;
-    const double* B_elems = B->elements;
-
-    const size_t    A_cs = A->column_stride;
-    const size_t    B_cs = B->column_stride;
-    const size_t    A_rs = A->row_stride;
-    const size_t    B_rs = B->row_stride;
-
-    size_t B_index = c_m_index( B, 0,0 );
-    size_t A_index = c_m_index( A, 0,0 );
-
-    int row = (int) A->rows;
-    while ( --row >= 0) {
-        size_t i = A_index;
-        size_t j = B_index;
-
-        int column = (int) A->columns;
-        while (--column >= 0) {
-            A_elems[ i ] *= B_elems[ j ];
-            i += A_cs;
-            j += B_cs;
-        }
-
-        A_index += A_rs;
-        B_index += B_rs;
-    }
-
-    return C_SUCCESS;
+    C_MM_ELEMENTWISE( A, B, c_contig_mul, *= )
 }
 
 int c_mm_div( Matrix* A, Matrix* B) {
-
-    const size_t M = A->rows;
-    const size_t N = A->columns;
-
-    if (B->rows != M || B->columns != N) {
-        C_ERROR("Matrices must have same dimensions", C_EBADLEN);
-    }
-          double* A_elems = A->elements;
-    const double* B_elems = B->elements;
-
-    const size_t    A_cs = A->column_stride;
-    const size_t    B_cs = B->column_stride;
-    const size_t    A_rs = A->row_stride;
-    const size_t    B_rs = B->row_stride;
-
-    size_t B_index = c_m_index( B, 0,0 );
-    size_t A_index = c_m_index( A, 0,0 );
-
-    int row = (int) A->rows;
-    while ( --row >= 0) {
-        size_t i = A_index;
-        size_t j = B_index;
-
-        int column = (int) A->columns;
-        while (--column >= 0) {
-            A_elems[ i ] /= B_elems[ j ];
-            i += A_cs;
-            j += B_cs;
-        }
-
-        A_index += A_rs;
-        B_index += B_rs;
-    }
-
-    return C_SUCCESS;
+    C_MM_ELEMENTWISE( A, B, c_contig_div, /= )
 }
 
 int c_m_scale( Matrix* A, double x ) {
-
-    const size_t M = A->rows;
-    const size_t N = A->columns;
-
-    double* elems = A->elements;
-
-    const size_t cs = A->column_stride;
-    const size_t rs = A->row_stride;
-
-    size_t index = c_m_index( A, 0,0 );
-
-    int row = (int) A->rows;
-    while ( --row >= 0) {
-        size_t i = index;
-
-        int column = (int) A->columns;
-        while (--column >= 0) {
-            elems[ i ] *= x;
-            i += cs;
-        }
-
-        index += rs;
-    }
-
-    return C_SUCCESS;
+    C_M_ELEMENTWISE( A, x, c_contig_scale, *= )
 }
 
 int c_m_add_constant( Matrix* A, double x ) {
-
-    const size_t M = A->rows;
-    const size_t N = A->columns;
-
-    double* elems = A->elements;
-
-    const size_t cs = A->column_stride;
-    const size_t rs = A->row_stride;
-
-    size_t index = c_m_index( A, 0,0 );
-
-    int row = (int) A->rows;
-    while ( --row >= 0) {
-        size_t i = index;
-
-        int column = (int) A->columns;
-        while (--column >= 0) {
-            elems[ i ] += x;
-            i += cs;
-        }
-
-        index += rs;
-    }
-
-    return C_SUCCESS;
+    C_M_ELEMENTWISE( A, x, c_contig_add_constant, += )
 }
 
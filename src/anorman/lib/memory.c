@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "data.h"
+#include "error.h"
+#include "memory.h"
+
+/* Allocator for vector and matrix storage.
+ *
+ * Element buffers are zeroed and start on a 64 byte boundary, so rows of
+ * different threads never share a cache line and aligned SIMD loads are
+ * safe on contiguous data. Large buffers are aligned to 2MB and advised
+ * as huge page candidates, which cuts TLB misses on big weight matrices.
+ * Buffers come from posix_memalign and may also be released with free().
+ *
+ * The fixed-size Vector and Matrix headers (one per view) are recycled
+ * through slab pools: memory is taken from the system in chunks of
+ * C_MEM_SLAB_CHUNK headers and freed headers go onto a free list, so
+ * creating and dropping views does not touch malloc once warmed up.
+ *
+ * This file belongs to libandata and must not be #included into Inline
+ * modules: the pools and counters are process wide
+ */
+
+struct slab_node_struct
+{
+    struct slab_node_struct* next;
+};
+
+typedef struct slab_node_struct SlabNode;
+
+struct slab_pool_struct
+{
+    size_t    size;
+    SlabNode* free_list;
+    char      lock;
+};
+
+typedef struct slab_pool_struct SlabPool;
+
+static SlabPool vector_pool = { sizeof(Vector), NULL, 0 };
+static SlabPool matrix_pool = { sizeof(Matrix), NULL, 0 };
+
+static MemStats mem_stats;
+
+static int hugepages = -1;
+
+#define C_MEM_COUNT( field, n ) __atomic_fetch_add( &mem_stats.field, (n), __ATOMIC_RELAXED )
+
+static void
+c_slab_lock( SlabPool* pool ) {
+    while (__atomic_test_and_set( &pool->lock, __ATOMIC_ACQUIRE )) {
+        ;
+    }
+}
+
+static void
+c_slab_unlock( SlabPool* pool ) {
+    __atomic_clear( &pool->lock, __ATOMIC_RELEASE );
+}
+
+/* carve a new chunk into the free list. Called with the pool locked */
+static int
+c_slab_grow( SlabPool* pool ) {
+    const size_t size  = pool->size < sizeof(SlabNode) ? sizeof(SlabNode) : pool->size;
+    char*        chunk = (char*) malloc( C_MEM_SLAB_CHUNK * size );
+
+    if (chunk == NULL) {
+        return C_ENOMEM;
+    }
+
+    size_t i;
+    for (i = 0; i < C_MEM_SLAB_CHUNK; i++) {
+        SlabNode* node  = (SlabNode*) (chunk + i * size);
+        node->next      = pool->free_list;
+        pool->free_list = node;
+    }
+
+    C_MEM_COUNT( slab_chunks, 1 );
+
+    return C_SUCCESS;
+}
+
+static void*
+c_slab_alloc( SlabPool* pool ) {
+    c_slab_lock( pool );
+
+    if (pool->free_list == NULL && c_slab_grow( pool ) != C_SUCCESS) {
+        c_slab_unlock( pool );
+        return NULL;
+    }
+
+    SlabNode* node  = pool->free_list;
+    pool->free_list = node->next;
+
+    c_slab_unlock( pool );
+
+    memset( node, 0, pool->size );
+    C_MEM_COUNT( header_allocs, 1 );
+
+    return (void*) node;
+}
+
+/* headers are never handed back to the system. This also accepts
+   headers that were allocated with malloc */
+static void
+c_slab_free( SlabPool* pool, void* ptr ) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    SlabNode* node = (SlabNode*) ptr;
+
+    c_slab_lock( pool );
+    node->next      = pool->free_list;
+    pool->free_list = node;
+    c_slab_unlock( pool );
+
+    C_MEM_COUNT( header_frees, 1 );
+}
+
+int
+c_mem_hugepages( void ) {
+    if (hugepages < 0) {
+        const char* env = getenv("AN_HUGEPAGES");
+        hugepages = (env == NULL || strtol( env, NULL, 10 ) != 0);
+    }
+
+    return hugepages;
+}
+
+void
+c_mem_set_hugepages( int flag ) {
+    hugepages = flag ? 1 : 0;
+}
+
+double*
+c_elements_alloc( size_t n ) {
+    if (n == 0) {
+        n = 1;
+    }
+
+    if (n > SIZE_MAX / sizeof(double)) {
+        C_ERROR_NULL("Element buffer is too large", C_EINVAL);
+    }
+
+    const size_t bytes = n * sizeof(double);
+    const int    huge  = bytes >= C_MEM_HUGE_MIN && c_mem_hugepages();
+
+    void* ptr;
+    if (posix_memalign( &ptr, huge ? C_MEM_HUGE_PAGE : C_MEM_ALIGN, bytes ) != 0) {
+        C_ERROR_NULL("Failed to allocate elements", C_ENOMEM);
+    }
+
+#ifdef MADV_HUGEPAGE
+    /* advise before the first touch so the pages fault in huge */
+    if (huge) {
+        madvise( ptr, bytes, MADV_HUGEPAGE );
+    }
+#endif
+
+    memset( ptr, 0, bytes );
+
+    C_MEM_COUNT( element_allocs, 1 );
+    C_MEM_COUNT( element_bytes, bytes );
+
+    if (huge) {
+        C_MEM_COUNT( huge_allocs, 1 );
+    }
+
+    return (double*) ptr;
+}
+
+void
+c_elements_free( double* elements ) {
+    if (elements == NULL) {
+        return;
+    }
+
+    free( elements );
+
+    C_MEM_COUNT( element_frees, 1 );
+}
+
+Vector*
+c_vector_header_alloc( void ) {
+    Vector* v = (Vector*) c_slab_alloc( &vector_pool );
+
+    if (v == NULL) {
+        C_ERROR_NULL("Failed to allocate space for vector struct", C_ENOMEM);
+    }
+
+    return v;
+}
+
+void
+c_vector_header_free( Vector* v ) {
+    c_slab_free( &vector_pool, v );
+}
+
+Matrix*
+c_matrix_header_alloc( void ) {
+    Matrix* m = (Matrix*) c_slab_alloc( &matrix_pool );
+
+    if (m == NULL) {
+        C_ERROR_NULL("Failed to allocate space for matrix struct", C_ENOMEM);
+    }
+
+    return m;
+}
+
+void
+c_matrix_header_free( Matrix* m ) {
+    c_slab_free( &matrix_pool, m );
+}
+
+void
+c_mem_stats( MemStats* stats ) {
+    stats->element_allocs = __atomic_load_n( &mem_stats.element_allocs, __ATOMIC_RELAXED );
+    stats->element_frees  = __atomic_load_n( &mem_stats.element_frees,  __ATOMIC_RELAXED );
+    stats->element_bytes  = __atomic_load_n( &mem_stats.element_bytes,  __ATOMIC_RELAXED );
+    stats->huge_allocs    = __atomic_load_n( &mem_stats.huge_allocs,    __ATOMIC_RELAXED );
+    stats->header_allocs  = __atomic_load_n( &mem_stats.header_allocs,  __ATOMIC_RELAXED );
+    stats->header_frees   = __atomic_load_n( &mem_stats.header_frees,   __ATOMIC_RELAXED );
+    stats->slab_chunks    = __atomic_load_n( &mem_stats.slab_chunks,    __ATOMIC_RELAXED );
+}
+
+void
+c_mem_reset_stats( void ) {
+    __atomic_store_n( &mem_stats.element_allocs, 0, __ATOMIC_RELAXED );
+    __atomic_store_n( &mem_stats.element_frees,  0, __ATOMIC_RELAXED );
+    __atomic_store_n( &mem_stats.element_bytes,  0, __ATOMIC_RELAXED );
+    __atomic_store_n( &mem_stats.huge_allocs,    0, __ATOMIC_RELAXED );
+    __atomic_store_n( &mem_stats.header_allocs,  0, __ATOMIC_RELAXED );
+    __atomic_store_n( &mem_stats.header_frees,   0, __ATOMIC_RELAXED );
+    __atomic_store_n( &mem_stats.slab_chunks,    0, __ATOMIC_RELAXED );
+}
@@ -0,0 +1,158 @@
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+
+#include "data.h"
+#include "intlist.h"
+#include "metrics.h"
+
+/* Training quality measures collected during the bestmatch search.
+ *
+ * The search keeps the second best match next to the best one, which
+ * gives the topographic error without a second scan: the early exit
+ * threshold is then the second best distance instead of the best, so
+ * slightly fewer partial distances are abandoned. Counters are plain
+ * fields for the serial online search; parallel searches count into a
+ * local MetricsCounters per range and merge it with atomics when done
+ */
+
+void
+c_bm_scan_init( BMScan* s ) {
+    s->bm      = -1;
+    s->dist    = DBL_MAX;
+    s->bm2     = -1;
+    s->dist2   = DBL_MAX;
+    s->evals   = 0;
+    s->skipped = 0;
+}
+
+/* squared euclidean distance of v to neuron w, abandoned as soon as it
+   exceeds the current threshold */
+void
+c_bm_scan_neuron( BMScan* s, const double* v, const double* w, size_t n, size_t index, int second ) {
+    const double threshold = second ? s->dist2 : s->dist;
+
+    double d = 0.0;
+    size_t k;
+
+    s->evals++;
+
+    for (k = 0; k < n; k++) {
+        const double diff = v[ k ] - w[ k ];
+        d += diff * diff;
+
+        if (d > threshold) {
+            s->skipped++;
+            return;
+        }
+    }
+
+    if (d < s->dist) {
+        s->bm2   = s->bm;
+        s->dist2 = s->dist;
+        s->bm    = (ptrdiff_t) index;
+        s->dist  = d;
+    } else if (second && d < s->dist2) {
+        s->bm2   = (ptrdiff_t) index;
+        s->dist2 = d;
+    }
+}
+
+void
+c_metrics_reset( TrainMetrics* m ) {
+    memset( &m->c, 0, sizeof(MetricsCounters) );
+}
+
+/* neurons a and b touch on the (toroid) rectangular grid, by an edge or
+   a corner. A second best match on the diagonal still keeps the map
+   topology, so only neurons further apart count as an error */
+int
+c_metrics_adjacent( TrainMetrics* m, size_t a, size_t b ) {
+    const size_t ra = a / m->columns, ca = a % m->columns;
+    const size_t rb = b / m->columns, cb = b % m->columns;
+
+    size_t dr = ra > rb ? ra - rb : rb - ra;
+    size_t dc = ca > cb ? ca - cb : cb - ca;
+
+    if (m->toroid) {
+        if (m->rows - dr < dr) {
+            dr = m->rows - dr;
+        }
+
+        if (m->columns - dc < dc) {
+            dc = m->columns - dc;
+        }
+    }
+
+    return dr <= 1 && dc <= 1 && dr + dc > 0;
+}
+
+/* account the scan of data row index */
+void
+c_metrics_record( TrainMetrics* m, MetricsCounters* c, BMScan* s, size_t index ) {
+    if (s->bm < 0) {
+        return;
+    }
+
+    const double qe = sqrt( s->dist );
+
+    c->patterns++;
+    c->qe_sum += qe;
+
+    if (qe > c->qe_max) {
+        c->qe_max = qe;
+    }
+
+    c->dist_evals   += s->evals;
+    c->dist_skipped += s->skipped;
+
+    if (m->columns && s->bm2 >= 0 && !c_metrics_adjacent( m, (size_t) s->bm, (size_t) s->bm2 )) {
+        c->topo_errors++;
+    }
+
+    if (m->previous && index < m->previous->size && c_il_get( m->previous, index ) != (int64_t) s->bm) {
+        c->bm_moved++;
+    }
+}
+
+static void
+c_metrics_add_double( double* dst, double x ) {
+    double old, sum;
+    __atomic_load( dst, &old, __ATOMIC_RELAXED );
+
+    do {
+        sum = old + x;
+    } while (!__atomic_compare_exchange( dst, &old, &sum, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED ));
+}
+
+static void
+c_metrics_max_double( double* dst, double x ) {
+    double old;
+    __atomic_load( dst, &old, __ATOMIC_RELAXED );
+
+    while (x > old && !__atomic_compare_exchange( dst, &old, &x, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED )) {
+        ;
+    }
+}
+
+void
+c_metrics_merge( MetricsCounters* dst, const MetricsCounters* src ) {
+    __atomic_fetch_add( &dst->patterns,     src->patterns,     __ATOMIC_RELAXED );
+    __atomic_fetch_add( &dst->topo_errors,  src->topo_errors,  __ATOMIC_RELAXED );
+    __atomic_fetch_add( &dst->bm_moved,     src->bm_moved,     __ATOMIC_RELAXED );
+    __atomic_fetch_add( &dst->dist_evals,   src->dist_evals,   __ATOMIC_RELAXED );
+    __atomic_fetch_add( &dst->dist_skipped, src->dist_skipped, __ATOMIC_RELAXED );
+
+    c_metrics_add_double( &dst->qe_sum, src->qe_sum );
+    c_metrics_max_double( &dst->qe_max, src->qe_max );
+    c_metrics_add_double( &dst->search_time, src->search_time );
+}
+
+double
+c_metrics_clock( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
@@ -0,0 +1,387 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "error.h"
+#include "threads.h"
+#include "raster.h"
+
+/* Rendering of SOM maps straight into an RGBA buffer.
+ *
+ * The background is drawn a map row at a time, each thread taking a
+ * band of rows: heights are interpolated, looked up in the palette
+ * and written as whole pixels. Tiles are then copied row by row.
+ * Glyphs are stamped in horizontal strips of the image, every thread
+ * walking all points in order and clipping them to its strip, so the
+ * strips never overlap and later points still cover earlier ones
+ */
+
+#define C_RASTER_STRIP 32    /* image rows per glyph job */
+
+Raster*
+c_raster_alloc( size_t width, size_t height ) {
+    Raster* r = (Raster*) calloc( 1, sizeof(Raster) );
+
+    if (r == NULL) {
+        C_ERROR_NULL("Failed to allocate raster", C_ENOMEM);
+    }
+
+    r->width  = width;
+    r->height = height;
+    r->pixels = (uint8_t*) calloc( (width && height) ? width * height : 1, 4 );
+
+    if (r->pixels == NULL) {
+        free( r );
+        C_ERROR_NULL("Failed to allocate raster", C_ENOMEM);
+    }
+
+    return r;
+}
+
+void
+c_raster_free( Raster* r ) {
+    if (r == NULL) {
+        return;
+    }
+
+    free( r->pixels );
+    free( r );
+}
+
+static void
+c_raster_put( Raster* r, size_t x, size_t y, const uint8_t* rgb ) {
+    uint8_t* p = r->pixels + 4 * (y * r->width + x);
+
+    p[0] = rgb[0];
+    p[1] = rgb[1];
+    p[2] = rgb[2];
+    p[3] = 0xFF;
+}
+
+struct raster_bg_struct
+{
+    Raster*        r;
+    const double*  heights;
+    size_t         rows;
+    size_t         columns;
+    size_t         zoom;
+    int            tiled;
+    const uint8_t* palette;
+    size_t         colors;
+};
+
+typedef struct raster_bg_struct RasterBackground;
+
+static const uint8_t*
+c_raster_color( const RasterBackground* bg, double h ) {
+    long i = (long) (h * (double) bg->colors);
+
+    if (i < 0)                     i = 0;
+    if (i >= (long) bg->colors)    i = (long) bg->colors - 1;
+
+    return bg->palette + 3 * i;
+}
+
+/* map rows [begin, end). Zoomed, a height spreads over zoom x zoom
+   pixels interpolated towards its right and lower neighbours, shifted
+   by half a cell on toroids */
+static void
+c_raster_background_rows( size_t begin, size_t end, void* arg ) {
+    const RasterBackground* bg = (const RasterBackground*) arg;
+
+    const size_t H = bg->rows, W = bg->columns, z = bg->zoom;
+    const size_t shift = bg->tiled ? z / 2 : 0;
+
+    size_t y, x, yz, xz;
+
+    for (y = begin; y < end; y++) {
+        const size_t y1 = bg->tiled ? (y + 1) % H : (y + 1 < H ? y + 1 : y);
+
+        for (x = 0; x < W; x++) {
+            const size_t x1 = bg->tiled ? (x + 1) % W : (x + 1 < W ? x + 1 : x);
+
+            const double ul = bg->heights[ y * W + x ];
+            const double ur = bg->heights[ y * W + x1 ];
+            const double ll = bg->heights[ y1 * W + x ];
+            const double lr = bg->heights[ y1 * W + x1 ];
+
+            for (yz = 0; yz < z; yz++) {
+                const double fy = (double) yz / (double) z;
+                const size_t iy = (y * z + yz + shift) % (H * z);
+
+                for (xz = 0; xz < z; xz++) {
+                    const double fx = (double) xz / (double) z;
+                    const size_t ix = (x * z + xz + shift) % (W * z);
+
+                    const double h = (1 - fy) * ((1 - fx) * ul + fx * ur)
+                                   + fy       * ((1 - fx) * ll + fx * lr);
+
+                    c_raster_put( bg->r, ix, iy, c_raster_color( bg, h ) );
+                }
+            }
+        }
+    }
+}
+
+/* image rows [begin, end) of the first tile copied into the others */
+static void
+c_raster_tile_rows( size_t begin, size_t end, void* arg ) {
+    Raster* r = ((const RasterBackground*) arg)->r;
+
+    const size_t half = r->width / 2 * 4;
+    size_t y;
+
+    for (y = begin; y < end; y++) {
+        uint8_t* src = r->pixels + y * r->width * 4;
+
+        memcpy( src + half, src, half );
+        memcpy( r->pixels + (y + r->height / 2) * r->width * 4, src, 2 * half );
+    }
+}
+
+int
+c_raster_background( Raster* r, const double* heights, size_t rows, size_t columns, size_t zoom,
+                     int tiled, const uint8_t* palette, size_t colors ) {
+    const size_t tiles = tiled ? 2 : 1;
+
+    if (zoom == 0 || colors == 0 || r->width != tiles * zoom * columns || r->height != tiles * zoom * rows) {
+        return C_EINVAL;
+    }
+
+    RasterBackground bg;
+    bg.r       = r;
+    bg.heights = heights;
+    bg.rows    = rows;
+    bg.columns = columns;
+    bg.zoom    = zoom;
+    bg.tiled   = tiled;
+    bg.palette = palette;
+    bg.colors  = colors;
+
+    c_parallel_for( rows, 1, &c_raster_background_rows, &bg );
+
+    if (tiled) {
+        c_parallel_for( r->height / 2, C_RASTER_STRIP, &c_raster_tile_rows, &bg );
+    }
+
+    return C_SUCCESS;
+}
+
+struct raster_stamp_struct
+{
+    Raster*             r;
+    const RasterGlyphs* g;
+};
+
+typedef struct raster_stamp_struct RasterStamp;
+
+/* one glyph at image position (x, y), clipped to rows [y0, y1) */
+static void
+c_raster_glyph( Raster* r, const RasterGlyphs* g, long x, long y, size_t y0, size_t y1, const uint8_t* rgb ) {
+    const long s = (long) g->size;
+    long top, bottom, left, right;
+
+    if (g->circle) {
+        /* as GD's filledEllipse, centred with radius size / 2 */
+        top    = y - s / 2;
+        bottom = y + s / 2 + 1;
+        left   = x - s / 2;
+        right  = x + s / 2 + 1;
+    } else {
+        top    = y;
+        bottom = y + s;
+        left   = x;
+        right  = x + s;
+    }
+
+    if (top < (long) y0)             top    = (long) y0;
+    if (bottom > (long) y1)          bottom = (long) y1;
+    if (left < 0)                    left   = 0;
+    if (right > (long) r->width)     right  = (long) r->width;
+
+    const double a = s / 2.0;
+    long i, j;
+
+    for (i = top; i < bottom; i++) {
+        for (j = left; j < right; j++) {
+            if (g->circle) {
+                const double dx = (double) (j - x) / a;
+                const double dy = (double) (i - y) / a;
+
+                if (dx * dx + dy * dy > 1.0) {
+                    continue;
+                }
+            }
+
+            c_raster_put( r, (size_t) j, (size_t) i, rgb );
+        }
+    }
+}
+
+static void
+c_raster_glyph_strips( size_t begin, size_t end, void* arg ) {
+    const RasterStamp*  st = (const RasterStamp*) arg;
+    const RasterGlyphs* g  = st->g;
+
+    const size_t y0 = begin * C_RASTER_STRIP;
+    const size_t y1 = end * C_RASTER_STRIP < st->r->height ? end * C_RASTER_STRIP : st->r->height;
+
+    const long w = (long) (g->map_columns * g->zoom);
+    const long h = (long) (g->map_rows * g->zoom);
+    const long s = (long) g->size;
+
+    size_t i;
+    for (i = 0; i < g->n; i++) {
+        const long x = (long) g->columns[ i ] * (long) g->zoom;
+        const long y = (long) g->rows[ i ] * (long) g->zoom;
+
+        const size_t   c   = g->classes[ i ] < g->colors ? g->classes[ i ] : 0;
+        const uint8_t* rgb = g->palette + 3 * c;
+
+        int t;
+        for (t = 0; t < (g->tiled ? 4 : 1); t++) {
+            const long ty = (t & 2) ? (y + h) % (2 * h) : y;
+            const long tx = (t & 1) ? (x + w) % (2 * w) : x;
+
+            /* strips a glyph cannot touch */
+            if (ty + s < (long) y0 || ty - s >= (long) y1) {
+                continue;
+            }
+
+            c_raster_glyph( st->r, g, tx, ty, y0, y1, rgb );
+        }
+    }
+}
+
+int
+c_raster_glyphs( Raster* r, const RasterGlyphs* g ) {
+    if (g->n == 0) {
+        return C_SUCCESS;
+    }
+
+    if (g->colors == 0 || g->zoom == 0) {
+        return C_EINVAL;
+    }
+
+    RasterStamp st;
+    st.r = r;
+    st.g = g;
+
+    return c_parallel_for( (r->height + C_RASTER_STRIP - 1) / C_RASTER_STRIP, 1, &c_raster_glyph_strips, &st );
+}
+
+const uint8_t c_raster_signature[ 8 ] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+void
+c_raster_be32( uint8_t* p, uint32_t v ) {
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+/* length, type, data and CRC of one chunk at p. Returns its size */
+static size_t
+c_raster_chunk( uint8_t* p, const char* type, const uint8_t* data, size_t len ) {
+    c_raster_be32( p, (uint32_t) len );
+    memcpy( p + 4, type, 4 );
+
+    if (len) {
+        memcpy( p + 8, data, len );
+    }
+
+    c_raster_be32( p + 8 + len, (uint32_t) crc32( 0L, p + 4, (uInt) (len + 4) ) );
+
+    return len + 12;
+}
+
+int
+c_raster_deflate( const Raster* r, int level, uint8_t** out, size_t* out_len ) {
+    const size_t stride = 4 * r->width + 1;
+    const size_t raw_n  = stride * r->height;
+
+    /* scanlines with filter type 0 */
+    uint8_t* raw = (uint8_t*) malloc( raw_n ? raw_n : 1 );
+
+    if (raw == NULL) {
+        C_ERROR("Failed to allocate PNG", C_ENOMEM);
+    }
+
+    size_t y;
+    for (y = 0; y < r->height; y++) {
+        raw[ y * stride ] = 0;
+        memcpy( raw + y * stride + 1, r->pixels + y * r->width * 4, 4 * r->width );
+    }
+
+    uLongf   n   = compressBound( (uLong) raw_n );
+    uint8_t* buf = (uint8_t*) malloc( n );
+
+    if (buf == NULL) {
+        free( raw );
+        C_ERROR("Failed to allocate PNG", C_ENOMEM);
+    }
+
+    const int status = compress2( buf, &n, raw, (uLong) raw_n, level < 0 ? 1 : level > 9 ? 9 : level );
+
+    free( raw );
+
+    if (status != Z_OK) {
+        free( buf );
+        return C_EFAULT;
+    }
+
+    *out     = buf;
+    *out_len = (size_t) n;
+
+    return C_SUCCESS;
+}
+
+void
+c_raster_ihdr( const Raster* r, uint8_t* ihdr ) {
+    c_raster_be32( ihdr, (uint32_t) r->width );
+    c_raster_be32( ihdr + 4, (uint32_t) r->height );
+    ihdr[ 8 ]  = 8;    /* bit depth */
+    ihdr[ 9 ]  = 6;    /* RGBA */
+    ihdr[ 10 ] = 0;
+    ihdr[ 11 ] = 0;
+    ihdr[ 12 ] = 0;
+}
+
+int
+c_raster_png( const Raster* r, int level, uint8_t** out, size_t* out_len ) {
+    uint8_t* idat;
+    size_t   idat_n;
+
+    const int status = c_raster_deflate( r, level, &idat, &idat_n );
+
+    if (status != C_SUCCESS) {
+        return status;
+    }
+
+    /* signature, IHDR, IDAT and IEND */
+    uint8_t* png = (uint8_t*) malloc( 8 + 25 + (12 + idat_n) + 12 );
+
+    if (png == NULL) {
+        free( idat );
+        C_ERROR("Failed to allocate PNG", C_ENOMEM);
+    }
+
+    uint8_t ihdr[ 13 ];
+    c_raster_ihdr( r, ihdr );
+
+    size_t n = 0;
+
+    memcpy( png, c_raster_signature, 8 );
+    n += 8;
+    n += c_raster_chunk( png + n, "IHDR", ihdr, 13 );
+    n += c_raster_chunk( png + n, "IDAT", idat, idat_n );
+    n += c_raster_chunk( png + n, "IEND", NULL, 0 );
+
+    free( idat );
+
+    *out     = png;
+    *out_len = n;
+
+    return C_SUCCESS;
+}
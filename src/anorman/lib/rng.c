@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "data.h"
+#include "error.h"
+#include "vector.h"
+#include "threads.h"
+#include "rng.h"
+
+/* Counter-based random numbers for training and weight initialization.
+ *
+ * A Philox4x32-10 stream is a pure function of (seed, stream, position),
+ * so a fill can be cut into blocks that are drawn by different threads
+ * and still give the same numbers as a single threaded run. Weight
+ * columns use their column index as stream and SOM epochs use the epoch
+ * number, which makes a whole run reproducible from one recorded seed.
+ *
+ * Gaussian deviates use the 128 layer Ziggurat of Marsaglia and Tsang
+ * (2000); all but about 1% of the draws cost one multiplication
+ */
+
+#define C_PHILOX_M0 0xD2511F53U
+#define C_PHILOX_M1 0xCD9E8D57U
+#define C_PHILOX_W0 0x9E3779B9U
+#define C_PHILOX_W1 0xBB67AE85U
+
+static inline void
+c_philox_round( uint32_t* ctr, const uint32_t* key ) {
+    const uint64_t p0 = (uint64_t) C_PHILOX_M0 * ctr[0];
+    const uint64_t p1 = (uint64_t) C_PHILOX_M1 * ctr[2];
+
+    const uint32_t c1 = ctr[1];
+    const uint32_t c3 = ctr[3];
+
+    ctr[0] = (uint32_t) (p1 >> 32) ^ c1 ^ key[0];
+    ctr[1] = (uint32_t) p1;
+    ctr[2] = (uint32_t) (p0 >> 32) ^ c3 ^ key[1];
+    ctr[3] = (uint32_t) p0;
+}
+
+static void
+c_philox4x32_10( const uint32_t* in, const uint32_t* key_in, uint32_t* out ) {
+    uint32_t key[2] = { key_in[0], key_in[1] };
+
+    out[0] = in[0];
+    out[1] = in[1];
+    out[2] = in[2];
+    out[3] = in[3];
+
+    int r;
+    for (r = 0; r < 10; r++) {
+        c_philox_round( out, key );
+        key[0] += C_PHILOX_W0;
+        key[1] += C_PHILOX_W1;
+    }
+}
+
+void
+c_rng_init( Rng* r, uint64_t seed, uint64_t stream ) {
+    r->key[0] = (uint32_t) seed;
+    r->key[1] = (uint32_t) (seed >> 32);
+    r->ctr[0] = 0;
+    r->ctr[1] = 0;
+    r->ctr[2] = (uint32_t) stream;
+    r->ctr[3] = (uint32_t) (stream >> 32);
+    r->have   = 0;
+}
+
+/* restart at the beginning of substream n of the current stream */
+void
+c_rng_substream( Rng* r, uint32_t n ) {
+    r->ctr[0] = 0;
+    r->ctr[1] = n;
+    r->have   = 0;
+}
+
+uint32_t
+c_rng_next_u32( Rng* r ) {
+    if (r->have == 0) {
+        c_philox4x32_10( r->ctr, r->key, r->buf );
+        r->ctr[0]++;
+        r->have = 4;
+    }
+
+    return r->buf[ --r->have ];
+}
+
+uint64_t
+c_rng_next_u64( Rng* r ) {
+    const uint64_t hi = c_rng_next_u32( r );
+    return (hi << 32) | c_rng_next_u32( r );
+}
+
+double
+c_rng_uniform( Rng* r ) {
+    return (double) (c_rng_next_u64( r ) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Lemire's multiply and reject */
+uint32_t
+c_rng_bounded( Rng* r, uint32_t n ) {
+    uint64_t m = (uint64_t) c_rng_next_u32( r ) * n;
+    uint32_t l = (uint32_t) m;
+
+    if (l < n) {
+        const uint32_t t = -n % n;
+
+        while (l < t) {
+            m = (uint64_t) c_rng_next_u32( r ) * n;
+            l = (uint32_t) m;
+        }
+    }
+
+    return (uint32_t) (m >> 32);
+}
+
+/* (0,1), safe for log() */
+static inline double
+c_rng_open_uniform( Rng* r ) {
+    return ((double) c_rng_next_u32( r ) + 0.5) * (1.0 / 4294967296.0);
+}
+
+/* Ziggurat tables, built once per process */
+static uint32_t zig_kn[128];
+static double   zig_wn[128];
+static double   zig_fn[128];
+
+static pthread_once_t zig_once = PTHREAD_ONCE_INIT;
+
+#define C_ZIG_R 3.442619855899
+
+static void
+c_zig_setup( void ) {
+    const double m1 = 2147483648.0;
+    const double vn = 9.91256303526217e-3;
+
+    double dn = C_ZIG_R;
+    double tn = dn;
+    double q  = vn / exp( -0.5 * dn * dn );
+
+    zig_kn[0]   = (uint32_t) ((dn / q) * m1);
+    zig_kn[1]   = 0;
+    zig_wn[0]   = q / m1;
+    zig_wn[127] = dn / m1;
+    zig_fn[0]   = 1.0;
+    zig_fn[127] = exp( -0.5 * dn * dn );
+
+    int i;
+    for (i = 126; i >= 1; i--) {
+        dn = sqrt( -2.0 * log( vn / dn + exp( -0.5 * dn * dn ) ) );
+
+        zig_kn[ i + 1 ] = (uint32_t) ((dn / tn) * m1);
+        tn = dn;
+        zig_fn[ i ] = exp( -0.5 * dn * dn );
+        zig_wn[ i ] = dn / m1;
+    }
+}
+
+/* the slow path: wedges and the tail beyond C_ZIG_R */
+static double
+c_zig_fix( Rng* r, int32_t hz, uint32_t iz ) {
+    for (;;) {
+        double x = hz * zig_wn[ iz ];
+
+        if (iz == 0) {
+            double y;
+
+            do {
+                x = -log( c_rng_open_uniform( r ) ) / C_ZIG_R;
+                y = -log( c_rng_open_uniform( r ) );
+            } while (y + y < x * x);
+
+            return hz > 0 ? C_ZIG_R + x : -C_ZIG_R - x;
+        }
+
+        if (zig_fn[ iz ] + c_rng_open_uniform( r ) * (zig_fn[ iz - 1 ] - zig_fn[ iz ]) < exp( -0.5 * x * x )) {
+            return x;
+        }
+
+        hz = (int32_t) c_rng_next_u32( r );
+        iz = hz & 127;
+
+        if ((uint32_t) llabs( (long long) hz ) < zig_kn[ iz ]) {
+            return hz * zig_wn[ iz ];
+        }
+    }
+}
+
+double
+c_rng_gaussian( Rng* r ) {
+    pthread_once( &zig_once, &c_zig_setup );
+
+    const int32_t  hz = (int32_t) c_rng_next_u32( r );
+    const uint32_t iz = hz & 127;
+
+    if ((uint32_t) llabs( (long long) hz ) < zig_kn[ iz ]) {
+        return hz * zig_wn[ iz ];
+    }
+
+    return c_zig_fix( r, hz, iz );
+}
+
+struct rng_fill_job_struct
+{
+    Vector*  v;
+    double   a;
+    double   b;
+    uint64_t seed;
+    uint64_t stream;
+    int      gaussian;
+};
+
+typedef struct rng_fill_job_struct RngFillJob;
+
+/* blocks [begin, end) of the vector, one substream per block */
+static void
+c_rng_fill_range( size_t begin, size_t end, void* arg ) {
+    RngFillJob* job = (RngFillJob*) arg;
+    Vector*     v   = job->v;
+
+    Rng r;
+    c_rng_init( &r, job->seed, job->stream );
+
+    size_t b;
+    for (b = begin; b < end; b++) {
+        const size_t from = b * C_RNG_BLOCK;
+        const size_t to   = from + C_RNG_BLOCK < v->size ? from + C_RNG_BLOCK : v->size;
+
+        c_rng_substream( &r, (uint32_t) b );
+
+        size_t i;
+        if (job->gaussian) {
+            for (i = from; i < to; i++) {
+                v->elements[ c_v_index( v, i ) ] = job->a + job->b * c_rng_gaussian( &r );
+            }
+        } else {
+            for (i = from; i < to; i++) {
+                v->elements[ c_v_index( v, i ) ] = job->a + (job->b - job->a) * c_rng_uniform( &r );
+            }
+        }
+    }
+}
+
+static int
+c_rng_fill( Vector* v, double a, double b, uint64_t seed, uint64_t stream, int gaussian ) {
+    if (v->elements == NULL) {
+        C_ERROR("Cannot fill a vector without dense storage", C_EINVAL);
+    }
+
+    if (gaussian) {
+        pthread_once( &zig_once, &c_zig_setup );
+    }
+
+    RngFillJob   job    = { v, a, b, seed, stream, gaussian };
+    const size_t blocks = (v->size + C_RNG_BLOCK - 1) / C_RNG_BLOCK;
+
+    return c_parallel_for( blocks, 1, &c_rng_fill_range, &job );
+}
+
+/* uniform on [lo,hi) */
+int
+c_rng_fill_uniform( Vector* v, double lo, double hi, uint64_t seed, uint64_t stream ) {
+    return c_rng_fill( v, lo, hi, seed, stream, 0 );
+}
+
+int
+c_rng_fill_gaussian( Vector* v, double mean, double sd, uint64_t seed, uint64_t stream ) {
+    return c_rng_fill( v, mean, sd, seed, stream, 1 );
+}
+
+/* the same (seed, stream) gives the same permutation */
+void
+c_rng_shuffle_u32( uint32_t* a, size_t n, uint64_t seed, uint64_t stream ) {
+    Rng r;
+    c_rng_init( &r, seed, stream );
+
+    size_t i;
+    for (i = n; i > 1; i--) {
+        const size_t   j   = c_rng_bounded( &r, (uint32_t) i );
+        const uint32_t tmp = a[ i - 1 ];
+
+        a[ i - 1 ] = a[ j ];
+        a[ j ]     = tmp;
+    }
+}
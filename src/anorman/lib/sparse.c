@@ -0,0 +1,532 @@
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "data.h"
+#include "error.h"
+#include "vector.h"
+#include "matrix.h"
+#include "memory.h"
+#include "map.h"
+#include "threads.h"
+#include "sparse.h"
+
+/* Sparse vectors, matrices and compressed sparse rows.
+ *
+ * High-k composition profiles have 4^k/2 columns but only a few thousand
+ * non-zero cells per sequence. They are collected in hash maps and then
+ * frozen into CSR form, whose rows are read directly against dense
+ * weight vectors: x.w costs nnz(x) operations and the squared distance
+ * follows from |x|^2 - 2 x.w + |w|^2 with |w|^2 computed once per
+ * neuron, so a profile is never expanded to its full width
+ */
+
+/* base pointer and stride of a dense vector, or NULL for selections */
+static inline const double*
+c_sp_dense_base( Vector* d, size_t* stride ) {
+    if (d->offsets || d->elements == NULL) {
+        return NULL;
+    }
+
+    *stride = d->stride;
+
+    return d->elements + d->zero;
+}
+
+Vector*
+c_sv_alloc( size_t size ) {
+    Vector* v = c_vector_header_alloc();
+
+    if (v == NULL) {
+        return NULL;
+    }
+
+    v->hash_map = c_idm_alloc( C_IDM_DEFAULT_CAPACITY, C_IDM_DEFAULT_MIN_LOAD_FACTOR,
+                               C_IDM_DEFAULT_MAX_LOAD_FACTOR );
+
+    if (v->hash_map == NULL) {
+        c_vector_header_free( v );
+        return NULL;
+    }
+
+    v->size   = size;
+    v->stride = 1;
+
+    return v;
+}
+
+Matrix*
+c_sm_alloc( size_t rows, size_t columns ) {
+    if (columns != 0 && rows > SIZE_MAX / columns) {
+        C_ERROR_NULL("Sparse matrix is too large", C_EINVAL);
+    }
+
+    Matrix* m = c_matrix_header_alloc();
+
+    if (m == NULL) {
+        return NULL;
+    }
+
+    m->hash_map = c_idm_alloc( C_IDM_DEFAULT_CAPACITY, C_IDM_DEFAULT_MIN_LOAD_FACTOR,
+                               C_IDM_DEFAULT_MAX_LOAD_FACTOR );
+
+    if (m->hash_map == NULL) {
+        c_matrix_header_free( m );
+        return NULL;
+    }
+
+    m->rows          = rows;
+    m->columns       = columns;
+    m->row_stride    = columns;
+    m->column_stride = 1;
+
+    return m;
+}
+
+double
+c_sv_get( Vector* v, size_t i ) {
+    return c_idm_get( v->hash_map, i );
+}
+
+int
+c_sv_set( Vector* v, size_t i, double x ) {
+    return c_idm_put( v->hash_map, i, x );
+}
+
+double
+c_sm_get( Matrix* m, size_t i, size_t j ) {
+    return c_idm_get( m->hash_map, i * m->columns + j );
+}
+
+int
+c_sm_set( Matrix* m, size_t i, size_t j, double x ) {
+    return c_idm_put( m->hash_map, i * m->columns + j, x );
+}
+
+/* walk the smaller map, look up the larger one */
+double
+c_sv_dot_sparse( Vector* a, Vector* b ) {
+    if (c_idm_size( a->hash_map ) > c_idm_size( b->hash_map )) {
+        Vector* tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    const IntDoubleMap* map = a->hash_map;
+
+    double sum = 0.0;
+    size_t k;
+
+    for (k = 0; k < map->capacity; k++) {
+        if (map->states[ k ] == C_IDM_FULL) {
+            sum += map->values[ k ] * c_idm_get( b->hash_map, map->keys[ k ] );
+        }
+    }
+
+    return sum;
+}
+
+double
+c_sv_dot_dense( Vector* s, Vector* d ) {
+    const IntDoubleMap* map = s->hash_map;
+
+    size_t stride;
+    const double* base = c_sp_dense_base( d, &stride );
+
+    double sum = 0.0;
+    size_t k;
+
+    for (k = 0; k < map->capacity; k++) {
+        if (map->states[ k ] == C_IDM_FULL) {
+            const size_t j = map->keys[ k ];
+            sum += map->values[ k ] * (base ? base[ j * stride ] : c_v_get_quick( d, j ));
+        }
+    }
+
+    return sum;
+}
+
+double
+c_sv_norm2( Vector* s ) {
+    const IntDoubleMap* map = s->hash_map;
+
+    double sum = 0.0;
+    size_t k;
+
+    for (k = 0; k < map->capacity; k++) {
+        if (map->states[ k ] == C_IDM_FULL) {
+            sum += map->values[ k ] * map->values[ k ];
+        }
+    }
+
+    return sum;
+}
+
+/* |s - d|^2, given |d|^2 */
+double
+c_sv_sqdist_dense( Vector* s, Vector* d, double d_norm2 ) {
+    const double dist = c_sv_norm2( s ) - 2.0 * c_sv_dot_dense( s, d ) + d_norm2;
+    return dist > 0.0 ? dist : 0.0;
+}
+
+void
+c_sv_to_dense( Vector* s, Vector* d ) {
+    const IntDoubleMap* map = s->hash_map;
+
+    size_t i, k;
+    for (i = 0; i < d->size; i++) {
+        c_v_set_quick( d, i, 0.0 );
+    }
+
+    for (k = 0; k < map->capacity; k++) {
+        if (map->states[ k ] == C_IDM_FULL) {
+            c_v_set_quick( d, map->keys[ k ], map->values[ k ] );
+        }
+    }
+}
+
+CSRMatrix*
+c_csr_alloc( size_t rows, size_t columns, size_t nnz ) {
+    CSRMatrix* csr = (CSRMatrix*) calloc( 1, sizeof(CSRMatrix) );
+
+    if (csr == NULL) {
+        C_ERROR_NULL("Failed to allocate CSR matrix", C_ENOMEM);
+    }
+
+    csr->rows    = rows;
+    csr->columns = columns;
+    csr->nnz     = nnz;
+    csr->row_ptr = (size_t*) calloc( rows + 1, sizeof(size_t) );
+    csr->col_idx = (size_t*) malloc( (nnz ? nnz : 1) * sizeof(size_t) );
+    csr->values  = c_elements_alloc( nnz );
+
+    if (csr->row_ptr == NULL || csr->col_idx == NULL || csr->values == NULL) {
+        c_csr_free( csr );
+        C_ERROR_NULL("Failed to allocate CSR matrix", C_ENOMEM);
+    }
+
+    return csr;
+}
+
+void
+c_csr_free( CSRMatrix* csr ) {
+    if (csr == NULL) {
+        return;
+    }
+
+    free( csr->row_ptr );
+    free( csr->col_idx );
+    c_elements_free( csr->values );
+    free( csr );
+}
+
+CSRMatrix*
+c_csr_from_sparse( Matrix* m ) {
+    const size_t nnz = c_idm_size( m->hash_map );
+
+    CSRMatrix* csr = c_csr_alloc( m->rows, m->columns, nnz );
+
+    if (csr == NULL) {
+        return NULL;
+    }
+
+    /* cell keys sort in row-major order */
+    size_t* keys = (size_t*) malloc( (nnz ? nnz : 1) * sizeof(size_t) );
+
+    if (keys == NULL) {
+        c_csr_free( csr );
+        C_ERROR_NULL("Failed to allocate CSR matrix", C_ENOMEM);
+    }
+
+    c_idm_pairs( m->hash_map, keys, csr->values );
+
+    size_t k;
+    for (k = 0; k < nnz; k++) {
+        const size_t i = keys[ k ] / m->columns;
+
+        csr->col_idx[ k ] = keys[ k ] % m->columns;
+        csr->row_ptr[ i + 1 ]++;
+    }
+
+    for (k = 0; k < m->rows; k++) {
+        csr->row_ptr[ k + 1 ] += csr->row_ptr[ k ];
+    }
+
+    free( keys );
+
+    return csr;
+}
+
+/* one map per row, keyed by column */
+CSRMatrix*
+c_csr_from_maps( IntDoubleMap** maps, size_t rows, size_t columns ) {
+    size_t i, k, nnz = 0;
+
+    for (i = 0; i < rows; i++) {
+        nnz += maps[ i ] ? c_idm_size( maps[ i ] ) : 0;
+    }
+
+    CSRMatrix* csr = c_csr_alloc( rows, columns, nnz );
+
+    if (csr == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < rows; i++) {
+        const size_t from = csr->row_ptr[ i ];
+        const size_t n    = maps[ i ] ? c_idm_pairs( maps[ i ], csr->col_idx + from, csr->values + from ) : 0;
+
+        for (k = from; k < from + n; k++) {
+            if (csr->col_idx[ k ] >= columns) {
+                c_csr_free( csr );
+                C_ERROR_NULL("Column index out of bounds", C_EINVAL);
+            }
+        }
+
+        csr->row_ptr[ i + 1 ] = from + n;
+    }
+
+    return csr;
+}
+
+double
+c_csr_get( CSRMatrix* csr, size_t i, size_t j ) {
+    size_t lo = csr->row_ptr[ i ];
+    size_t hi = csr->row_ptr[ i + 1 ];
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (csr->col_idx[ mid ] < j) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return (lo < csr->row_ptr[ i + 1 ] && csr->col_idx[ lo ] == j) ? csr->values[ lo ] : 0.0;
+}
+
+double
+c_csr_row_dot( CSRMatrix* csr, size_t i, Vector* d ) {
+    const size_t  end = csr->row_ptr[ i + 1 ];
+    const size_t* col = csr->col_idx;
+    const double* val = csr->values;
+
+    size_t stride;
+    const double* base = c_sp_dense_base( d, &stride );
+
+    double sum = 0.0;
+    size_t k;
+
+    if (base && stride == 1) {
+        for (k = csr->row_ptr[ i ]; k < end; k++) {
+            sum += val[ k ] * base[ col[ k ] ];
+        }
+    } else if (base) {
+        for (k = csr->row_ptr[ i ]; k < end; k++) {
+            sum += val[ k ] * base[ col[ k ] * stride ];
+        }
+    } else {
+        for (k = csr->row_ptr[ i ]; k < end; k++) {
+            sum += val[ k ] * c_v_get_quick( d, col[ k ] );
+        }
+    }
+
+    return sum;
+}
+
+double
+c_csr_row_norm2( CSRMatrix* csr, size_t i ) {
+    const size_t  end = csr->row_ptr[ i + 1 ];
+    const double* val = csr->values;
+
+    double sum = 0.0;
+    size_t k;
+
+    for (k = csr->row_ptr[ i ]; k < end; k++) {
+        sum += val[ k ] * val[ k ];
+    }
+
+    return sum;
+}
+
+/* |x_i - d|^2, given |d|^2 */
+double
+c_csr_row_sqdist( CSRMatrix* csr, size_t i, Vector* d, double d_norm2 ) {
+    const double dist = c_csr_row_norm2( csr, i ) - 2.0 * c_csr_row_dot( csr, i, d ) + d_norm2;
+    return dist > 0.0 ? dist : 0.0;
+}
+
+void
+c_csr_row_to_dense( CSRMatrix* csr, size_t i, Vector* d ) {
+    size_t j, k;
+
+    for (j = 0; j < d->size; j++) {
+        c_v_set_quick( d, j, 0.0 );
+    }
+
+    for (k = csr->row_ptr[ i ]; k < csr->row_ptr[ i + 1 ]; k++) {
+        c_v_set_quick( d, csr->col_idx[ k ], csr->values[ k ] );
+    }
+}
+
+/* d += alpha * x_i */
+void
+c_csr_row_axpy( CSRMatrix* csr, size_t i, double alpha, Vector* d ) {
+    size_t k;
+
+    for (k = csr->row_ptr[ i ]; k < csr->row_ptr[ i + 1 ]; k++) {
+        const size_t j = csr->col_idx[ k ];
+        c_v_set_quick( d, j, c_v_get_quick( d, j ) + alpha * csr->values[ k ] );
+    }
+}
+
+int
+c_csr_column_stats( CSRMatrix* csr, double* minima, double* maxima, double* means, double* variances ) {
+    const size_t M = csr->columns;
+    const size_t N = csr->rows;
+
+    size_t* count = (size_t*) calloc( M ? M : 1, sizeof(size_t) );
+
+    if (count == NULL) {
+        C_ERROR("Failed to allocate column counts", C_ENOMEM);
+    }
+
+    size_t j, k;
+
+    for (j = 0; j < M; j++) {
+        minima[ j ]    = DBL_MAX;
+        maxima[ j ]    = -DBL_MAX;
+        means[ j ]     = 0.0;
+        variances[ j ] = 0.0;
+    }
+
+    for (k = 0; k < csr->nnz; k++) {
+        const size_t c = csr->col_idx[ k ];
+        const double x = csr->values[ k ];
+
+        count[ c ]++;
+        means[ c ] += x;
+
+        if (x < minima[ c ]) minima[ c ] = x;
+        if (x > maxima[ c ]) maxima[ c ] = x;
+    }
+
+    for (j = 0; j < M; j++) {
+        means[ j ] = N ? means[ j ] / (double) N : 0.0;
+
+        /* a column with fewer non-zeros than rows also holds zeros */
+        if (count[ j ] < N) {
+            if (minima[ j ] > 0.0) minima[ j ] = 0.0;
+            if (maxima[ j ] < 0.0) maxima[ j ] = 0.0;
+        }
+    }
+
+    /* squared deviations about the mean, the zeros all at once */
+    for (k = 0; k < csr->nnz; k++) {
+        const size_t c = csr->col_idx[ k ];
+        const double d = csr->values[ k ] - means[ c ];
+
+        variances[ c ] += d * d;
+    }
+
+    for (j = 0; j < M; j++) {
+        variances[ j ] += (double) (N - count[ j ]) * means[ j ] * means[ j ];
+        variances[ j ]  = N > 1 ? variances[ j ] / (double) (N - 1) : 0.0;
+    }
+
+    free( count );
+
+    return C_SUCCESS;
+}
+
+void
+c_m_row_norms2( Matrix* m, double* norms ) {
+    size_t i, j;
+
+    for (i = 0; i < m->rows; i++) {
+        double sum = 0.0;
+
+        for (j = 0; j < m->columns; j++) {
+            const double x = c_m_get_quick( m, i, j );
+            sum += x * x;
+        }
+
+        norms[ i ] = sum;
+    }
+}
+
+size_t
+c_csr_row_bestmatch( CSRMatrix* csr, size_t i, Matrix* W, const double* w_norms2, double* dist ) {
+    Vector        row;
+    VectorOffsets row_offsets;
+
+    const double x_norm2 = c_csr_row_norm2( csr, i );
+
+    size_t best = 0, n;
+    double best_dist = DBL_MAX;
+
+    for (n = 0; n < W->rows; n++) {
+        c_m_row_view( W, n, &row, &row_offsets );
+
+        const double d = x_norm2 - 2.0 * c_csr_row_dot( csr, i, &row ) + w_norms2[ n ];
+
+        if (d < best_dist) {
+            best_dist = d;
+            best      = n;
+        }
+    }
+
+    if (dist) {
+        *dist = best_dist > 0.0 ? best_dist : 0.0;
+    }
+
+    return best;
+}
+
+struct csr_bestmatch_job_struct
+{
+    CSRMatrix*    csr;
+    Matrix*       W;
+    const double* w_norms2;
+    size_t*       index;
+    double*       dist;
+};
+
+typedef struct csr_bestmatch_job_struct CSRBestmatchJob;
+
+static void
+c_csr_bestmatch_range( size_t begin, size_t end, void* arg ) {
+    CSRBestmatchJob* job = (CSRBestmatchJob*) arg;
+
+    size_t i;
+    for (i = begin; i < end; i++) {
+        job->index[ i ] = c_csr_row_bestmatch( job->csr, i, job->W, job->w_norms2,
+                                               job->dist ? &job->dist[ i ] : NULL );
+    }
+}
+
+/* index (and squared distance) of the best matching row of W for every row */
+int
+c_csr_bestmatches( CSRMatrix* csr, Matrix* W, size_t* index, double* dist ) {
+    if (csr->columns != W->columns) {
+        C_ERROR("Matrices must have the same number of columns", C_EBADLEN);
+    }
+
+    double* w_norms2 = (double*) malloc( (W->rows ? W->rows : 1) * sizeof(double) );
+
+    if (w_norms2 == NULL) {
+        C_ERROR("Failed to allocate neuron norms", C_ENOMEM);
+    }
+
+    c_m_row_norms2( W, w_norms2 );
+
+    CSRBestmatchJob job = { csr, W, w_norms2, index, dist };
+
+    const int status = c_parallel_for( csr->rows, 16, &c_csr_bestmatch_range, &job );
+
+    free( w_norms2 );
+
+    return status;
+}
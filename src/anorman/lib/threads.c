@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "error.h"
+#include "threads.h"
+
+/* Minimal fork-join helper around pthreads. The number of
+ * workers is taken from $AN_THREADS, or the number of online
+ * CPUs if it is not set. Workers must not touch the Perl API
+ */
+
+struct range_job_struct
+{
+    size_t     begin;
+    size_t     end;
+    range_func f;
+    void*      arg;
+};
+
+typedef struct range_job_struct RangeJob;
+
+size_t
+c_num_threads( void ) {
+    const char* env = getenv("AN_THREADS");
+
+    if (env) {
+        long n = strtol( env, NULL, 10 );
+        return n > 0 ? (size_t) n : 1;
+    }
+
+    long n = sysconf( _SC_NPROCESSORS_ONLN );
+
+    return n > 0 ? (size_t) n : 1;
+}
+
+static void*
+c_range_job_run( void* data ) {
+    RangeJob* job = (RangeJob*) data;
+
+    ( *job->f ) ( job->begin, job->end, job->arg );
+
+    return NULL;
+}
+
+int
+c_parallel_for( size_t n, size_t min_chunk, range_func f, void* arg ) {
+    if (n == 0) {
+        return C_SUCCESS;
+    }
+
+    if (min_chunk == 0) min_chunk = 1;
+
+    size_t T = c_num_threads();
+
+    if (T > (n + min_chunk - 1) / min_chunk) {
+        T = (n + min_chunk - 1) / min_chunk;
+    }
+
+    /* not worth spawning anything */
+    if (T <= 1) {
+        ( *f ) ( 0, n, arg );
+        return C_SUCCESS;
+    }
+
+    pthread_t* threads = (pthread_t*) malloc( T * sizeof(pthread_t) );
+    RangeJob*  jobs    = (RangeJob*)  malloc( T * sizeof(RangeJob) );
+
+    if (threads == 0 || jobs == 0) {
+        free( threads );
+        free( jobs );
+        C_ERROR("Failed to allocate thread pool", C_ENOMEM);
+    }
+
+    const size_t chunk = n / T;
+    const size_t extra = n % T;
+
+    size_t t, begin = 0;
+
+    for (t = 0; t < T; t++) {
+        jobs[ t ].begin = begin;
+        jobs[ t ].end   = begin + chunk + (t < extra ? 1 : 0);
+        jobs[ t ].f     = f;
+        jobs[ t ].arg   = arg;
+        begin = jobs[ t ].end;
+    }
+
+    /* the calling thread takes the first chunk itself */
+    for (t = 1; t < T; t++) {
+        if (pthread_create( &threads[ t ], NULL, &c_range_job_run, &jobs[ t ] ) != 0) {
+            /* run it inline if we could not get a thread */
+            c_range_job_run( &jobs[ t ] );
+            jobs[ t ].f = NULL;
+        }
+    }
+
+    c_range_job_run( &jobs[ 0 ] );
+
+    for (t = 1; t < T; t++) {
+        if (jobs[ t ].f != NULL) {
+            pthread_join( threads[ t ], NULL );
+        }
+    }
+
+    free( threads );
+    free( jobs );
+
+    return C_SUCCESS;
+}
+
+/* Per-thread scratch space for small kernels that are called once
+ * per element pair. The buffer only ever grows and is released when
+ * the thread exits
+ */
+
+struct scratch_struct
+{
+    double* data;
+    size_t  size;
+};
+
+static pthread_key_t  c_scratch_key;
+static pthread_once_t c_scratch_once = PTHREAD_ONCE_INIT;
+
+static void
+c_scratch_free( void* data ) {
+    struct scratch_struct* s = (struct scratch_struct*) data;
+
+    free( s->data );
+    free( s );
+}
+
+static void
+c_scratch_key_init( void ) {
+    pthread_key_create( &c_scratch_key, &c_scratch_free );
+}
+
+double*
+c_thread_scratch( size_t n ) {
+    pthread_once( &c_scratch_once, &c_scratch_key_init );
+
+    struct scratch_struct* s = (struct scratch_struct*) pthread_getspecific( c_scratch_key );
+
+    if (s == NULL) {
+        s = (struct scratch_struct*) calloc( 1, sizeof(struct scratch_struct) );
+
+        if (s == NULL) {
+            C_ERROR_NULL("Failed to allocate scratch space", C_ENOMEM);
+        }
+
+        pthread_setspecific( c_scratch_key, s );
+    }
+
+    if (s->size < n) {
+        double* data = (double*) realloc( s->data, n * sizeof(double) );
+
+        if (data == NULL) {
+            C_ERROR_NULL("Failed to allocate scratch space", C_ENOMEM);
+        }
+
+        s->data = data;
+        s->size = n;
+    }
+
+    return s->data;
+}
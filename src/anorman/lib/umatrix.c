@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "error.h"
+#include "threads.h"
+#include "umatrix.h"
+
+#define C_UMX_MIN_CHUNK 64    /* neurons per job */
+
+UMatrix*
+c_umx_alloc( size_t rows, size_t columns, size_t dim, int toroid ) {
+    const size_t N = rows * columns;
+
+    UMatrix* u = (UMatrix*) calloc( 1, sizeof(UMatrix) );
+
+    if (u == NULL) {
+        C_ERROR_NULL("Failed to allocate U-matrix", C_ENOMEM);
+    }
+
+    u->rows    = rows;
+    u->columns = columns;
+    u->dim     = dim;
+    u->toroid  = toroid;
+
+    u->last    = (double*)  malloc( ((N && dim) ? N * dim : 1) * sizeof(double) );
+    u->right   = (double*)  calloc( N ? N : 1, sizeof(double) );
+    u->down    = (double*)  calloc( N ? N : 1, sizeof(double) );
+    u->changed = (uint8_t*) calloc( N ? N : 1, 1 );
+
+    if (u->last == NULL || u->right == NULL || u->down == NULL || u->changed == NULL) {
+        c_umx_free( u );
+        C_ERROR_NULL("Failed to allocate U-matrix", C_ENOMEM);
+    }
+
+    return u;
+}
+
+void
+c_umx_free( UMatrix* u ) {
+    if (u == NULL) {
+        return;
+    }
+
+    free( u->last );
+    free( u->right );
+    free( u->down );
+    free( u->changed );
+    free( u );
+}
+
+struct umx_job_struct
+{
+    UMatrix*      u;
+    const double* w;
+    size_t        stride;
+    double*       out;
+    size_t*       n_changed;    /* per chunk of neurons */
+};
+
+typedef struct umx_job_struct UMatrixJob;
+
+static double
+c_umx_distance( const double* a, const double* b, size_t n ) {
+    double sum = 0.0;
+    size_t k;
+
+    for (k = 0; k < n; k++) {
+        const double d = a[ k ] - b[ k ];
+        sum += d * d;
+    }
+
+    return sqrt( sum );
+}
+
+/* weights compared with, and copied over, the last seen. Jobs are
+   numbered in chunks of neurons to count changes per chunk */
+static void
+c_umx_diff( size_t begin, size_t end, void* arg ) {
+    UMatrixJob* job = (UMatrixJob*) arg;
+    UMatrix*    u   = job->u;
+
+    const size_t N     = u->rows * u->columns;
+    const size_t bytes = u->dim * sizeof(double);
+    size_t j, i;
+
+    for (j = begin; j < end; j++) {
+        const size_t last_i = (j + 1) * C_UMX_MIN_CHUNK < N ? (j + 1) * C_UMX_MIN_CHUNK : N;
+        size_t n = 0;
+
+        for (i = j * C_UMX_MIN_CHUNK; i < last_i; i++) {
+            const double* w    = job->w + i * job->stride;
+            double*       last = u->last + i * u->dim;
+
+            if (!u->primed || memcmp( w, last, bytes ) != 0) {
+                memcpy( last, w, bytes );
+                u->changed[ i ] = 1;
+                n++;
+            } else {
+                u->changed[ i ] = 0;
+            }
+        }
+
+        job->n_changed[ j ] = n;
+    }
+}
+
+/* edges to the right and down of changed neurons or with a changed
+   neuron at the other end */
+static void
+c_umx_edges( size_t begin, size_t end, void* arg ) {
+    UMatrixJob* job = (UMatrixJob*) arg;
+    UMatrix*    u   = job->u;
+
+    const size_t R = u->rows, C = u->columns;
+    size_t i;
+
+    for (i = begin; i < end; i++) {
+        const size_t r  = i / C, c = i % C;
+        const size_t ir = r * C + (c + 1) % C;
+        const size_t id = ((r + 1) % R) * C + c;
+
+        if (u->changed[ i ] || u->changed[ ir ]) {
+            u->right[ i ] = c_umx_distance( u->last + i * u->dim, u->last + ir * u->dim, u->dim );
+        }
+
+        if (u->changed[ i ] || u->changed[ id ]) {
+            u->down[ i ] = c_umx_distance( u->last + i * u->dim, u->last + id * u->dim, u->dim );
+        }
+    }
+}
+
+static void
+c_umx_heights( size_t begin, size_t end, void* arg ) {
+    UMatrixJob* job = (UMatrixJob*) arg;
+    UMatrix*    u   = job->u;
+
+    const size_t R = u->rows, C = u->columns;
+    size_t i;
+
+    for (i = begin; i < end; i++) {
+        const size_t r = i / C, c = i % C;
+
+        double sum = 0.0;
+        int    n   = 0;
+
+        if (u->toroid || c + 1 < C) { sum += u->right[ i ]; n++; }
+        if (u->toroid || r + 1 < R) { sum += u->down[ i ];  n++; }
+        if (u->toroid || c > 0)     { sum += u->right[ r * C + (c + C - 1) % C ];   n++; }
+        if (u->toroid || r > 0)     { sum += u->down[ ((r + R - 1) % R) * C + c ]; n++; }
+
+        job->out[ i ] = n ? sum / n : 0.0;
+    }
+}
+
+size_t
+c_umx_update( UMatrix* u, const double* w, size_t stride, double* out ) {
+    const size_t N = u->rows * u->columns;
+
+    if (N == 0) {
+        return 0;
+    }
+
+    const size_t J = (N + C_UMX_MIN_CHUNK - 1) / C_UMX_MIN_CHUNK;
+    size_t* counts = (size_t*) calloc( J, sizeof(size_t) );
+
+    if (counts == NULL) {
+        C_ERROR_VAL("Failed to allocate U-matrix", C_ENOMEM, 0);
+    }
+
+    UMatrixJob job;
+    job.u         = u;
+    job.w         = w;
+    job.stride    = stride;
+    job.out       = out;
+    job.n_changed = counts;
+
+    c_parallel_for( J, 1, &c_umx_diff, &job );
+
+    size_t j, changed = 0;
+
+    for (j = 0; j < J; j++) {
+        changed += counts[ j ];
+    }
+
+    free( counts );
+
+    u->primed = 1;
+
+    if (changed) {
+        c_parallel_for( N, C_UMX_MIN_CHUNK, &c_umx_edges, &job );
+    }
+
+    c_parallel_for( N, C_UMX_MIN_CHUNK, &c_umx_heights, &job );
+
+    /* scaled to [0, 1] */
+    double lo = out[0], hi = out[0];
+    size_t i;
+
+    for (i = 1; i < N; i++) {
+        if (out[ i ] < lo) lo = out[ i ];
+        if (out[ i ] > hi) hi = out[ i ];
+    }
+
+    if (hi > lo) {
+        for (i = 0; i < N; i++) {
+            out[ i ] = (out[ i ] - lo) / (hi - lo);
+        }
+    }
+
+    return changed;
+}
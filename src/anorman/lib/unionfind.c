@@ -0,0 +1,244 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "error.h"
+#include "threads.h"
+#include "unionfind.h"
+
+/* Union-find over dense integer ids.
+ *
+ * Two flavours share the parent array. The sequential one links the
+ * smaller set below the root of the larger and halves paths on find.
+ * The concurrent one updates parents with compare-and-swap only, so
+ * edges can be united from several threads without locks. There a root
+ * is always linked below the smaller root id, which keeps the forest
+ * acyclic under races and makes the final root of every set its
+ * smallest member whatever the thread interleaving
+ */
+
+UnionFind*
+c_uf_alloc( size_t size ) {
+    UnionFind* uf = (UnionFind*) calloc( 1, sizeof(UnionFind) );
+
+    if (uf == NULL) {
+        C_ERROR_NULL("Failed to allocate union-find", C_ENOMEM);
+    }
+
+    if (c_uf_resize( uf, size ) != C_SUCCESS) {
+        c_uf_free( uf );
+        return NULL;
+    }
+
+    return uf;
+}
+
+void
+c_uf_free( UnionFind* uf ) {
+    if (uf == NULL) {
+        return;
+    }
+
+    free( uf->parent );
+    free( uf->sizes );
+    free( uf );
+}
+
+int
+c_uf_resize( UnionFind* uf, size_t size ) {
+    if (size > UINT32_MAX) {
+        C_ERROR("Too many elements for union-find", C_EINVAL);
+    }
+
+    if (size <= uf->size) {
+        return C_SUCCESS;
+    }
+
+    if (size > uf->capacity) {
+        size_t capacity = uf->capacity ? uf->capacity + uf->capacity / 2 : 16;
+
+        if (capacity < size) {
+            capacity = size;
+        }
+
+        if (capacity > UINT32_MAX) {
+            capacity = UINT32_MAX;
+        }
+
+        uint32_t* parent = (uint32_t*) realloc( uf->parent, capacity * sizeof(uint32_t) );
+
+        if (parent == NULL) {
+            C_ERROR("Failed to grow union-find", C_ENOMEM);
+        }
+
+        uf->parent = parent;
+
+        uint32_t* sizes = (uint32_t*) realloc( uf->sizes, capacity * sizeof(uint32_t) );
+
+        if (sizes == NULL) {
+            C_ERROR("Failed to grow union-find", C_ENOMEM);
+        }
+
+        uf->sizes    = sizes;
+        uf->capacity = capacity;
+    }
+
+    size_t i;
+    for (i = uf->size; i < size; i++) {
+        uf->parent[ i ] = (uint32_t) i;
+        uf->sizes[ i ]  = 1;
+    }
+
+    uf->n_sets += size - uf->size;
+    uf->size    = size;
+
+    return C_SUCCESS;
+}
+
+uint32_t
+c_uf_find( UnionFind* uf, uint32_t x ) {
+    uint32_t* parent = uf->parent;
+
+    while (parent[ x ] != x) {
+        parent[ x ] = parent[ parent[ x ] ];
+        x = parent[ x ];
+    }
+
+    return x;
+}
+
+int
+c_uf_union( UnionFind* uf, uint32_t a, uint32_t b ) {
+    a = c_uf_find( uf, a );
+    b = c_uf_find( uf, b );
+
+    if (a == b) {
+        return 0;
+    }
+
+    /* a becomes the root of the larger set, the smaller id on ties */
+    if (uf->sizes[ a ] < uf->sizes[ b ] || (uf->sizes[ a ] == uf->sizes[ b ] && b < a)) {
+        const uint32_t t = a;
+        a = b;
+        b = t;
+    }
+
+    uf->parent[ b ] = a;
+    uf->sizes[ a ] += uf->sizes[ b ];
+    uf->n_sets--;
+
+    return 1;
+}
+
+size_t
+c_uf_set_size( UnionFind* uf, uint32_t x ) {
+    return uf->sizes[ c_uf_find( uf, x ) ];
+}
+
+size_t
+c_uf_union_edges( UnionFind* uf, const uint32_t* src, const uint32_t* dst, size_t n ) {
+    size_t merged = 0;
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        merged += c_uf_union( uf, src[ i ], dst[ i ] );
+    }
+
+    return merged;
+}
+
+uint32_t
+c_uf_find_atomic( UnionFind* uf, uint32_t x ) {
+    uint32_t* parent = uf->parent;
+
+    for (;;) {
+        uint32_t p = __atomic_load_n( &parent[ x ], __ATOMIC_RELAXED );
+
+        if (p == x) {
+            return x;
+        }
+
+        const uint32_t gp = __atomic_load_n( &parent[ p ], __ATOMIC_RELAXED );
+
+        /* halving: point x at its grandparent. Losing the race is harmless */
+        if (gp != p) {
+            __atomic_compare_exchange_n( &parent[ x ], &p, gp, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED );
+        }
+
+        x = gp;
+    }
+}
+
+/* returns 1 if two sets were merged */
+int
+c_uf_union_atomic( UnionFind* uf, uint32_t a, uint32_t b ) {
+    for (;;) {
+        a = c_uf_find_atomic( uf, a );
+        b = c_uf_find_atomic( uf, b );
+
+        if (a == b) {
+            return 0;
+        }
+
+        if (a < b) {
+            const uint32_t t = a;
+            a = b;
+            b = t;
+        }
+
+        /* a may have been linked meanwhile, then try again from its root */
+        uint32_t expected = a;
+        if (__atomic_compare_exchange_n( &uf->parent[ a ], &expected, b, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED )) {
+            return 1;
+        }
+    }
+}
+
+struct uf_edges_job_struct
+{
+    UnionFind*      uf;
+    const uint32_t* src;
+    const uint32_t* dst;
+    const uint8_t*  active;
+};
+
+typedef struct uf_edges_job_struct UFEdgesJob;
+
+static void
+c_uf_union_edges_range( size_t begin, size_t end, void* arg ) {
+    UFEdgesJob* job = (UFEdgesJob*) arg;
+
+    size_t i;
+    for (i = begin; i < end; i++) {
+        if (job->active == NULL || job->active[ i ]) {
+            c_uf_union_atomic( job->uf, job->src[ i ], job->dst[ i ] );
+        }
+    }
+}
+
+int
+c_uf_union_edges_atomic( UnionFind* uf, const uint32_t* src, const uint32_t* dst, const uint8_t* active, size_t n ) {
+    UFEdgesJob job = { uf, src, dst, active };
+
+    const int status = c_parallel_for( n, 4096, &c_uf_union_edges_range, &job );
+
+    c_uf_recount( uf );
+
+    return status;
+}
+
+void
+c_uf_recount( UnionFind* uf ) {
+    memset( uf->sizes, 0, uf->size * sizeof(uint32_t) );
+
+    size_t i, n_sets = 0;
+    for (i = 0; i < uf->size; i++) {
+        uf->sizes[ c_uf_find( uf, (uint32_t) i ) ]++;
+    }
+
+    for (i = 0; i < uf->size; i++) {
+        n_sets += uf->parent[ i ] == i;
+    }
+
+    uf->n_sets = n_sets;
+}
@@ -1,166 +1,184 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "data.h"
 #include "error.h"
 #include "vector.h"
+#include "memory.h"
+#include "map.h"
+#include "contiguous.h"
 
 /* quick retrieval and assignement 
  * NOTE: "quick" function assumes that 
  * all passed index values are within bounds
  */
 
-/* arithmetic operations */
+/* arithmetic operations
+ *
+ * Elementwise operations pick one of three loops: unit-stride operands
+ * go through the restrict-qualified loops in contiguous.h (memcpy /
+ * memset where possible), strided operands through index arithmetic and
+ * index-selected views through c_v_index. When the right-hand operand
+ * shares cells with the left-hand one it is staged into a buffer first,
+ * so a[ i ] op= b[ i ] always sees the original b
+ */
 
+/* 1 if the two vectors may touch the same cell. Selected views are
+   assumed to overlap when they share elements */
 int
-c_vv_add ( Vector *a, Vector *b ) {
-    const size_t N = a->size;
-
-    if (N != b->size) {
-        C_ERROR("Vectors must have equal length", C_EINVAL );        
-    } 
-
-    const size_t a_stride = a->stride;
-    const size_t b_stride = b->stride;
-
-    size_t a_index = a->zero;
-    size_t b_index = b->zero;
+c_vv_overlap ( Vector *a, Vector *b ) {
+    if (a->elements != b->elements || a->size == 0 || b->size == 0) {
+        return 0;
+    }
 
-          double *a_elem = a->elements;
-    const double *b_elem = b->elements;
-    
-    size_t i;
+    if (a->offsets || b->offsets) {
+        return 1;
+    }
 
-    for(i = 0; i < N; i++ ) {
-        a_elem[ a_index ] += b_elem[ b_index ];
-        a_index += a_stride;
-        b_index += b_stride;
-    } 
+    const size_t a_last = a->zero + (a->size - 1) * a->stride;
+    const size_t b_last = b->zero + (b->size - 1) * b->stride;
 
-    return C_SUCCESS;
+    return a->zero <= b_last && b->zero <= a_last;
 }
 
-int
-c_vv_sub ( Vector *a, Vector *b ) {
-    const size_t N = a->size;
+/* exactly the same cells in the same order */
+static int
+c_vv_same_cells ( Vector *a, Vector *b ) {
+    return a->elements == b->elements && a->offsets == NULL && b->offsets == NULL
+        && a->zero == b->zero && (a->stride == b->stride || a->size == 1);
+}
 
-    if (N != b->size) {
-        C_ERROR("Vectors must have equal length", C_EINVAL );        
-    } 
+/* stage b into a unit-stride vector s backed by a fresh buffer */
+static int
+c_v_stage ( Vector *b, Vector *s ) {
+    const size_t N = b->size;
 
-    const size_t a_stride = a->stride;
-    const size_t b_stride = b->stride;
+    double *buf = (double *) malloc( N * sizeof(double) );
 
-    size_t a_index = a->zero;
-    size_t b_index = b->zero;
+    if (buf == 0) {
+        C_ERROR("Failed to allocate staging buffer", C_ENOMEM );
+    }
 
-          double *a_elem = a->elements;
-    const double *b_elem = b->elements;
-    
     size_t i;
+    for (i = 0; i < N; i++) {
+        buf[ i ] = c_v_get_quick( b, i );
+    }
 
-    for(i = 0; i < N; i++ ) {
-        a_elem[ a_index ] -= b_elem[ b_index ];
-        a_index += a_stride;
-        b_index += b_stride;
-    } 
+    s->size      = N;
+    s->zero      = 0;
+    s->stride    = 1;
+    s->elements  = buf;
+    s->offsets   = NULL;
+    s->view_flag = 0;
 
     return C_SUCCESS;
 }
 
-int
-c_vv_mul ( Vector *a, Vector *b ) {
-    const size_t N = a->size;
-
-    if (N != b->size) {
-        C_ERROR("Vectors must have equal length", C_EINVAL );        
-    } 
-
-    const size_t a_stride = a->stride;
-    const size_t b_stride = b->stride;
+#define C_VV_ELEMENTWISE( a, b, contig, op )                                  \
+    const size_t N = a->size;                                                 \
+                                                                              \
+    if (N != b->size) {                                                       \
+        C_ERROR("Vectors must have equal length", C_EINVAL );                 \
+    }                                                                         \
+                                                                              \
+    Vector staged;                                                            \
+    int    is_staged = 0;                                                     \
+                                                                              \
+    if (c_vv_overlap( a, b ) && !c_vv_same_cells( a, b )) {                   \
+        if (c_v_stage( b, &staged ) != C_SUCCESS) {                           \
+            return C_ENOMEM;                                                  \
+        }                                                                     \
+        b = &staged;                                                          \
+        is_staged = 1;                                                        \
+    }                                                                         \
+                                                                              \
+    size_t i;                                                                 \
+                                                                              \
+    if (a->offsets || b->offsets) {                                           \
+        for (i = 0; i < N; i++) {                                             \
+            a->elements[ c_v_index( a, i ) ] op c_v_get_quick( b, i );        \
+        }                                                                     \
+    } else if (a->stride == 1 && b->stride == 1 && !c_vv_overlap( a, b )) {   \
+        contig( N, a->elements + a->zero, b->elements + b->zero );            \
+    } else {                                                                  \
+        const size_t a_stride = a->stride;                                    \
+        const size_t b_stride = b->stride;                                    \
+                                                                              \
+        size_t a_index = a->zero;                                             \
+        size_t b_index = b->zero;                                             \
+                                                                              \
+              double *a_elem = a->elements;                                   \
+        const double *b_elem = b->elements;                                   \
+                                                                              \
+        for (i = 0; i < N; i++) {                                             \
+            a_elem[ a_index ] op b_elem[ b_index ];                           \
+            a_index += a_stride;                                              \
+            b_index += b_stride;                                              \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    if (is_staged) {                                                          \
+        free( staged.elements );                                              \
+    }                                                                         \
+                                                                              \
+    return C_SUCCESS;
 
-    size_t a_index = a->zero;
-    size_t b_index = b->zero;
+#define C_V_ELEMENTWISE( a, x, contig, op )                                   \
+    const size_t N = a->size;                                                 \
+                                                                              \
+    size_t i;                                                                 \
+                                                                              \
+    if (a->offsets) {                                                         \
+        for (i = 0; i < N; i++) {                                             \
+            a->elements[ c_v_index( a, i ) ] op x;                            \
+        }                                                                     \
+    } else if (a->stride == 1) {                                              \
+        contig( N, a->elements + a->zero, x );                                \
+    } else {                                                                  \
+        const size_t a_stride = a->stride;                                    \
+                                                                              \
+        size_t a_index = a->zero;                                             \
+                                                                              \
+        double *a_elem = a->elements;                                         \
+                                                                              \
+        for (i = 0; i < N; i++) {                                             \
+            a_elem[ a_index ] op x;                                           \
+            a_index += a_stride;                                              \
+        }                                                                     \
+    }                                                                         \
+                                                                              \
+    return C_SUCCESS;
 
-          double *a_elem = a->elements;
-    const double *b_elem = b->elements;
-    
-    size_t i;
+int
+c_vv_add ( Vector *a, Vector *b ) {
+    C_VV_ELEMENTWISE( a, b, c_contig_add, += )
+}
 
-    for(i = 0; i < N; i++ ) {
-        a_elem[ a_index ] *= b_elem[ b_index ];
-        a_index += a_stride;
-        b_index += b_stride;
-    } 
+int
+c_vv_sub ( Vector *a, Vector *b ) {
+    C_VV_ELEMENTWISE( a, b, c_contig_sub, -= )
+}
 
-    return C_SUCCESS;
+int
+c_vv_mul ( Vector *a, Vector *b ) {
+    C_VV_ELEMENTWISE( a, b, c_contig_mul, *= )
 }
 
 int
 c_vv_div ( Vector *a, Vector *b ) {
-    const size_t N = a->size;
-
-    if (N != b->size) {
-        C_ERROR("Vectors must have equal length", C_EINVAL );        
-    } 
-
-    const size_t a_stride = a->stride;
-    const size_t b_stride = b->stride;
-
-    size_t a_index = a->zero;
-    size_t b_index = b->zero;
-
-          double *a_elem = a->elements;
-    const double *b_elem = b->elements;
-    
-    size_t i;
-
-    for(i = 0; i < N; i++ ) {
-        a_elem[ a_index ] /= b_elem[ b_index ];
-        a_index += a_stride;
-        b_index += b_stride;
-    } 
-
-    return C_SUCCESS;
+    C_VV_ELEMENTWISE( a, b, c_contig_div, /= )
 }
 
-
 int
 c_v_scale ( Vector *a, const double x ) {
-    const size_t N = a->size;
-    const size_t a_stride = a->stride;
-
-    size_t a_index = a->zero;
-
-    double *a_elem = a->elements;
-    
-    size_t i;
-
-    for (i = 0; i < N; i++) {
-        a_elem[ a_index ] *= x;
-        a_index += a_stride;
-    }
-
-    return C_SUCCESS; 
+    C_V_ELEMENTWISE( a, x, c_contig_scale, *= )
 }
 
 int
 c_v_add_constant ( Vector *a, const double x ) {
-    const size_t N = a->size;
-    const size_t a_stride = a->stride;
-
-    size_t a_index = a->zero;
-
-    double *a_elem = a->elements;
-    
-    size_t i;
-
-    for (i = 0; i < N; i++) {
-        a_elem[ a_index ] += x;
-        a_index += a_stride;
-    }
-
-    return C_SUCCESS; 
+    C_V_ELEMENTWISE( a, x, c_contig_add_constant, += )
 }
 
 int
@@ -171,43 +189,98 @@ c_vv_copy ( Vector *a, Vector *b ) {
         C_ERROR("Vectors must have equal length", C_EINVAL );        
     } 
 
-    const size_t a_stride = a->stride;
-    const size_t b_stride = b->stride;
+    if (c_vv_same_cells( a, b )) {
+        return C_SUCCESS;
+    }
+
+    /* memmove copes with overlapping ranges on its own */
+    if (c_v_is_contiguous( a ) && c_v_is_contiguous( b )) {
+        memmove( a->elements + a->zero, b->elements + b->zero, N * sizeof(double) );
+        return C_SUCCESS;
+    }
 
-    size_t a_index = a->zero;
-    size_t b_index = b->zero;
+    Vector staged;
+    int    is_staged = 0;
+
+    if (c_vv_overlap( a, b )) {
+        if (c_v_stage( b, &staged ) != C_SUCCESS) {
+            return C_ENOMEM;
+        }
+        b = &staged;
+        is_staged = 1;
+    }
 
-          double *a_elem = a->elements;
-    const double *b_elem = b->elements;
-    
     size_t i;
 
-    for(i = 0; i < N; i++ ) {
-        a_elem[ a_index ] = b_elem[ b_index ];
-        a_index += a_stride;
-        b_index += b_stride;
-    } 
+    if (a->offsets || b->offsets) {
+        for (i = 0; i < N; i++) {
+            c_v_set_quick( a, i, c_v_get_quick( b, i ) );
+        }
+    } else {
+        const size_t a_stride = a->stride;
+        const size_t b_stride = b->stride;
+
+        size_t a_index = a->zero;
+        size_t b_index = b->zero;
+
+              double *a_elem = a->elements;
+        const double *b_elem = b->elements;
+
+        for(i = 0; i < N; i++ ) {
+            a_elem[ a_index ] = b_elem[ b_index ];
+            a_index += a_stride;
+            b_index += b_stride;
+        }
+    }
+
+    if (is_staged) {
+        free( staged.elements );
+    }
 
     return C_SUCCESS;
 }
 
 int
 c_vv_swap ( Vector *a, Vector *b ) {
+    if (a->size != b->size) {
+        C_ERROR("Vector lengths must be equal", C_EINVAL );
+    }
+
+    const size_t size = a->size;
+
+    if (c_vv_same_cells( a, b )) {
+        return C_SUCCESS;
+    }
+
+    if (c_v_is_contiguous( a ) && c_v_is_contiguous( b ) && !c_vv_overlap( a, b )) {
+        c_contig_swap( size, a->elements + a->zero, b->elements + b->zero );
+        return C_SUCCESS;
+    }
+
+    /* overlapping swaps are order dependent, go element by element as before */
+    size_t k;
+
+    if (a->offsets || b->offsets) {
+        for (k = 0; k < size; k++) {
+            const size_t i = c_v_index( a, k );
+            const size_t j = c_v_index( b, k );
+
+            double tmp = a->elements[ i ];
+            a->elements[ i ] = b->elements[ j ];
+            b->elements[ j ] = tmp;
+        }
+
+        return C_SUCCESS;
+    }
+
     double *a_elems = a->elements;
     double *b_elems = b->elements;
 
-    const size_t size  = a->size;
     const size_t a_str = a->stride;
     const size_t b_str = b->stride;
 
-    size_t i = c_v_index(a, 0);
-    size_t j = c_v_index(b, 0);
-
-    if (a->size != b->size) {
-        C_ERROR("Vector lengths must be equal", C_EINVAL );
-    }
-    
-    size_t k;
+    size_t i = a->zero;
+    size_t j = b->zero;
 
     for (k = 0; k < size; k++) {
         double tmp = a_elems[ i ];
@@ -296,7 +369,7 @@ c_v_alloc( Vector* v, const size_t n ) {
         return v->elements;
     }
 
-    _ELEMS = (double *) calloc (1, n * sizeof (double));
+    _ELEMS = c_elements_alloc( n );
 
     if (_ELEMS == 0) {
         C_ERROR_VAL("Failed to allocate elements for vector", C_ENOMEM, 0);
@@ -325,7 +398,7 @@ c_v_alloc_from_vector( Vector * w,
         C_ERROR_VAL ("New vector extends past end of elements", C_EINVAL, 0);
     }
 
-    v = ((Vector*) malloc (sizeof (Vector)));
+    v = c_vector_header_alloc();
 
     if (v == 0) {
         C_ERROR_VAL ("Failed to allocate space for vector struct", C_ENOMEM, 0);
@@ -347,10 +420,22 @@ c_v_set_all( Vector* v, double x ) {
     const size_t n = v->size;
     const size_t s = v->stride;
 
-    size_t i = c_v_index( v, 0 );
-
     size_t k;
 
+    if (v->offsets) {
+        for (k = 0; k < n; k++ ) {
+            c_v_set_quick( v, k, x );
+        }
+        return;
+    }
+
+    if (s == 1) {
+        c_contig_set_all( n, elem + v->zero, x );
+        return;
+    }
+
+    size_t i = v->zero;
+
     for (k = 0; k < n; k++ ) {
         elem[ i ] = x;
         i += s;
@@ -367,17 +452,22 @@ c_v_free( Vector* v ) {
     /* do not free elements if
        struct is a view         */
     if (v->elements && !v->view_flag) {
-        free( v->elements );
+        c_elements_free( v->elements );
 	v->elements = NULL;
     }
   
+    if (v->hash_map && !v->view_flag) {
+        c_idm_free( v->hash_map );
+        v->hash_map = NULL;
+    }
+
     if (v->offsets) {
         free(v->offsets->offsets);
         free(v->offsets);
         v->offsets = NULL;
     } 
 
-    free( v );
+    c_vector_header_free( v );
 }
 
 void